@@ -0,0 +1,168 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Instance culling for grfx::CullPass.
+//
+// Each thread tests the world space bounding box of one instance against
+// the view frustum and, if enabled, against a Hi-Z pyramid holding the
+// farthest depth of each texel footprint. With CULL_FLAG_COMPACT the draw
+// arguments of visible instances are appended to DrawArgs and counted in
+// DrawCount. Otherwise every instance keeps its slot and culled instances
+// are written with an instance count of 0.
+
+#define CULL_FLAG_COMPACT   0x1
+#define CULL_FLAG_OCCLUSION 0x2
+
+struct CullParams
+{
+    float4x4 ViewProjection;
+    uint     InstanceCount;
+    uint     Flags;
+    uint     HiZMipCount;
+    uint     _pad0;
+    float2   HiZSize;
+};
+
+struct InstanceBounds
+{
+    float3 Min;
+    uint   _pad0;
+    float3 Max;
+    uint   _pad1;
+};
+
+// Matches grfx::DrawIndexedIndirectCommand
+struct DrawIndexedArgs
+{
+    uint IndexCount;
+    uint InstanceCount;
+    uint FirstIndex;
+    int  VertexOffset;
+    uint FirstInstance;
+};
+
+#if defined(__spirv__)
+[[vk::push_constant]]
+#endif
+ConstantBuffer<CullParams> Params : register(b0);
+
+StructuredBuffer<InstanceBounds>    Bounds        : register(t1);
+StructuredBuffer<DrawIndexedArgs>   DrawTemplates : register(t2);
+RWStructuredBuffer<DrawIndexedArgs> DrawArgs      : register(u3);
+RWByteAddressBuffer                 DrawCount     : register(u4);
+Texture2D<float>                    HiZ           : register(t5);
+
+bool IsOutsideFrustum(float3 bmin, float3 bmax)
+{
+    // Rows of the view projection matrix, see ppx::Frustum::Set
+    float4 r0 = Params.ViewProjection[0];
+    float4 r1 = Params.ViewProjection[1];
+    float4 r2 = Params.ViewProjection[2];
+    float4 r3 = Params.ViewProjection[3];
+
+    float4 planes[6] = {
+        r3 + r0, // Left
+        r3 - r0, // Right
+        r3 + r1, // Bottom
+        r3 - r1, // Top
+        r2,      // Near
+        r3 - r2  // Far
+    };
+
+    [unroll]
+    for (uint i = 0; i < 6; ++i) {
+        // Corner furthest along the plane normal
+        float3 p = float3(
+            (planes[i].x >= 0) ? bmax.x : bmin.x,
+            (planes[i].y >= 0) ? bmax.y : bmin.y,
+            (planes[i].z >= 0) ? bmax.z : bmin.z);
+        if ((dot(planes[i].xyz, p) + planes[i].w) < 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool IsOccluded(float3 bmin, float3 bmax)
+{
+    float2 uvMin = float2(1, 1);
+    float2 uvMax = float2(0, 0);
+    float  zMin  = 1;
+
+    [unroll]
+    for (uint i = 0; i < 8; ++i) {
+        float3 corner = float3(
+            (i & 1) ? bmax.x : bmin.x,
+            (i & 2) ? bmax.y : bmin.y,
+            (i & 4) ? bmax.z : bmin.z);
+        float4 clip = mul(Params.ViewProjection, float4(corner, 1));
+        // Box crosses the near plane, can't be tested reliably
+        if (clip.w <= 0) {
+            return false;
+        }
+        float3 ndc = clip.xyz / clip.w;
+        float2 uv  = float2(ndc.x * 0.5 + 0.5, 0.5 - ndc.y * 0.5);
+        uvMin      = min(uvMin, uv);
+        uvMax      = max(uvMax, uv);
+        zMin       = min(zMin, ndc.z);
+    }
+
+    uvMin = saturate(uvMin);
+    uvMax = saturate(uvMax);
+
+    // Pick the level where the projected rectangle covers at most 2x2 texels
+    float2 extent = (uvMax - uvMin) * Params.HiZSize;
+    float  level  = ceil(log2(max(max(extent.x, extent.y), 1)));
+    uint   mip    = min((uint)level, Params.HiZMipCount - 1);
+
+    uint2 mipSize = max(uint2(Params.HiZSize) >> mip, uint2(1, 1));
+    uint2 t0      = min(uint2(uvMin * mipSize), mipSize - 1);
+    uint2 t1      = min(uint2(uvMax * mipSize), mipSize - 1);
+
+    float zFar = HiZ.Load(int3(t0.x, t0.y, mip));
+    zFar       = max(zFar, HiZ.Load(int3(t1.x, t0.y, mip)));
+    zFar       = max(zFar, HiZ.Load(int3(t0.x, t1.y, mip)));
+    zFar       = max(zFar, HiZ.Load(int3(t1.x, t1.y, mip)));
+
+    return zMin > zFar;
+}
+
+[numthreads(64, 1, 1)]
+void csmain(uint3 tid : SV_DispatchThreadID)
+{
+    uint index = tid.x;
+    if (index >= Params.InstanceCount) {
+        return;
+    }
+
+    InstanceBounds bounds = Bounds[index];
+
+    bool visible = !IsOutsideFrustum(bounds.Min, bounds.Max);
+    if (visible && (Params.Flags & CULL_FLAG_OCCLUSION)) {
+        visible = !IsOccluded(bounds.Min, bounds.Max);
+    }
+
+    DrawIndexedArgs args = DrawTemplates[index];
+    if (Params.Flags & CULL_FLAG_COMPACT) {
+        if (visible) {
+            uint slot = 0;
+            DrawCount.InterlockedAdd(0, 1, slot);
+            DrawArgs[slot] = args;
+        }
+    }
+    else {
+        args.InstanceCount = visible ? args.InstanceCount : 0;
+        DrawArgs[index]    = args;
+    }
+}
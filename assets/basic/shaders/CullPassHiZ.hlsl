@@ -0,0 +1,54 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Hi-Z pyramid reduction for grfx::CullPass.
+//
+// Writes one level of the pyramid from the level above it, or from the
+// depth buffer for level 0. Every destination texel stores the farthest
+// depth of its source footprint. The footprint is rounded outwards so
+// levels with odd dimensions stay conservative.
+
+struct HiZParams
+{
+    uint2 SrcSize;
+    uint2 DstSize;
+};
+
+#if defined(__spirv__)
+[[vk::push_constant]]
+#endif
+ConstantBuffer<HiZParams> Params : register(b0);
+
+Texture2D<float>   Src : register(t1);
+RWTexture2D<float> Dst : register(u2);
+
+[numthreads(8, 8, 1)]
+void csmain(uint3 tid : SV_DispatchThreadID)
+{
+    if (any(tid.xy >= Params.DstSize)) {
+        return;
+    }
+
+    uint2 begin = (tid.xy * Params.SrcSize) / Params.DstSize;
+    uint2 end   = min(((tid.xy + 1) * Params.SrcSize + Params.DstSize - 1) / Params.DstSize, Params.SrcSize);
+
+    float zFar = 0;
+    for (uint y = begin.y; y < end.y; ++y) {
+        for (uint x = begin.x; x < end.x; ++x) {
+            zFar = max(zFar, Src.Load(int3(x, y, 0)));
+        }
+    }
+
+    Dst[tid.xy] = zFar;
+}
@@ -12,6 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#define MAX_CASCADE_COUNT 4
+
 //
 // Keep things easy for now and use 16-byte aligned types
 //
@@ -22,16 +24,19 @@ struct SceneData
     float4   Ambient;      // Object's ambient intensity
     
     float4x4 CameraViewProjectionMatrix; // Camera's view projection matrix
+    float4x4 CameraViewMatrix;           // Camera's view matrix
     
-    float4   LightPosition;             // Light's position
-    float4x4 LightViewProjectionMatrix; // Light's view projection matrix
+    float4   LightPosition;                                  // Light's position
+    float4x4 LightViewProjectionMatrices[MAX_CASCADE_COUNT]; // Light's view projection matrix of each cascade
+    float4   CascadeSplits;                                  // Camera view depth where each cascade ends
     
-    uint4    UsePCF; // Enable/disable PCF
+    uint4    UsePCF;         // Enable/disable PCF
+    uint4    CascadeOptions; // x = cascade count, y = tint cascades
 };
 
 ConstantBuffer<SceneData> Scene : register(b0);
 
-Texture2D                 ShadowDepthTexture : register(t1);
+Texture2DArray            ShadowDepthTexture : register(t1); // One layer per cascade
 SamplerComparisonState    ShadowDepthSampler : register(s2);
 
 struct VSOutput {
@@ -39,7 +44,7 @@ struct VSOutput {
 	float4 Position   : SV_POSITION;
 	float3 Color      : COLOR;
     float3 Normal     : NORMAL;
-    float4 PositionLS : POSITIONLS;
+    float  ViewDepth  : VIEWDEPTH;
 };
 
 VSOutput vsmain(
@@ -59,25 +64,25 @@ VSOutput vsmain(
 	result.Color  = Color;
     result.Normal = mul(Scene.NormalMatrix, float4(Normal, 0)).xyz;
     
-    // Transform world space psoition into light's view
-    result.PositionLS = mul(Scene.LightViewProjectionMatrix, result.PositionWS);
+    // Distance along the camera's view direction, selects the cascade
+    result.ViewDepth = -mul(Scene.CameraViewMatrix, result.PositionWS).z;
     
 	return result;
 }
 
 #define PCF_SIZE 16
 
-float ShadowPCF(float2 uv, float lightDepth)
+float ShadowPCF(float2 uv, uint cascade, float lightDepth)
 {
-    float2 dim = (float2)0;
-    ShadowDepthTexture.GetDimensions(dim.x, dim.y);
-    float2 invDim = 1.0 / dim;
+    float3 dim = (float3)0;
+    ShadowDepthTexture.GetDimensions(dim.x, dim.y, dim.z);
+    float2 invDim = 1.0 / dim.xy;
     
     float sum = 0.0;
     for (uint y = 0; y < PCF_SIZE; ++y) {
         for (uint x = 0; x < PCF_SIZE; ++x) {
             float2 offset = (float2(x, y) - (float2(PCF_SIZE, PCF_SIZE) / 2.0f)) * invDim;
-            sum += ShadowDepthTexture.SampleCmpLevelZero(ShadowDepthSampler, uv + offset, lightDepth).r;  
+            sum += ShadowDepthTexture.SampleCmpLevelZero(ShadowDepthSampler, float3(uv + offset, cascade), lightDepth).r;  
         }    
     }
       
@@ -90,39 +95,63 @@ float4 psmain(VSOutput input) : SV_TARGET
     // Lower values may introduce artifacts
     const float bias = 0.0015;
 
-    // Position in light space
-    float4 positionLS = input.PositionLS;
-
-    // Complete projection into NDC
-    positionLS.xyz = positionLS.xyz / positionLS.w;
-    
-    // Readjust to [0, 1] for texture sampling
-    positionLS.x =  positionLS.x / 2.0 + 0.5;
-    positionLS.y = -positionLS.y / 2.0 + 0.5;
-    
-    // Calculate depth in light space
-    float depth = positionLS.z - bias;
+    // First cascade that reaches this far, past the last one there are no shadows
+    uint cascadeCount = Scene.CascadeOptions.x;
+    uint cascade      = cascadeCount;
+    for (uint i = 0; i < cascadeCount; ++i) {
+        if (input.ViewDepth <= Scene.CascadeSplits[i]) {
+            cascade = i;
+            break;
+        }
+    }
 
     // Assume 
     float shadowFactor = 1;
 
-    bool isInBoundsX = (positionLS.x >= 0) && (positionLS.x < 1);
-    bool isInBoundsY = (positionLS.y >= 0) && (positionLS.y < 1);
-    bool isInBoundsZ = (positionLS.z >= 0) && (positionLS.z < 1);
-    if (isInBoundsX && isInBoundsY && isInBoundsZ) {
-        shadowFactor = ShadowDepthTexture.SampleCmpLevelZero(ShadowDepthSampler, positionLS.xy, depth);
-        if (Scene.UsePCF.x) {
-            shadowFactor = ShadowPCF(positionLS.xy, depth);
+    if (cascade < cascadeCount) {
+        // Position in light space
+        float4 positionLS = mul(Scene.LightViewProjectionMatrices[cascade], input.PositionWS);
+
+        // Complete projection into NDC
+        positionLS.xyz = positionLS.xyz / positionLS.w;
+    
+        // Readjust to [0, 1] for texture sampling
+        positionLS.x =  positionLS.x / 2.0 + 0.5;
+        positionLS.y = -positionLS.y / 2.0 + 0.5;
+    
+        // Calculate depth in light space
+        float depth = positionLS.z - bias;
+
+        bool isInBoundsX = (positionLS.x >= 0) && (positionLS.x < 1);
+        bool isInBoundsY = (positionLS.y >= 0) && (positionLS.y < 1);
+        bool isInBoundsZ = (positionLS.z >= 0) && (positionLS.z < 1);
+        if (isInBoundsX && isInBoundsY && isInBoundsZ) {
+            shadowFactor = ShadowDepthTexture.SampleCmpLevelZero(ShadowDepthSampler, float3(positionLS.xy, cascade), depth);
+            if (Scene.UsePCF.x) {
+                shadowFactor = ShadowPCF(positionLS.xy, cascade, depth);
+            }
         }
     }
 
-    // Calculate diffuse lighting
-    float3 L       = normalize(Scene.LightPosition.xyz - input.PositionWS.xyz);
+    // Calculate diffuse lighting, the light is directional and shines
+    // from its position towards the origin
+    float3 L       = normalize(Scene.LightPosition.xyz);
     float3 N       = input.Normal;    
     float  diffuse = saturate(dot(N, L));
     
     // Final output color
     float  ambient = Scene.Ambient.x;   
     float3 Co       = (diffuse * shadowFactor + ambient)  * input.Color;
+
+    // Tint each cascade to show the splits
+    if (Scene.CascadeOptions.y && (cascade < cascadeCount)) {
+        const float3 kCascadeTints[MAX_CASCADE_COUNT] = {
+            float3(1.0, 0.6, 0.6),
+            float3(0.6, 1.0, 0.6),
+            float3(0.6, 0.6, 1.0),
+            float3(1.0, 1.0, 0.6),
+        };
+        Co *= kCascadeTints[cascade];
+    }
 	return float4(Co, 1);
 }
\ No newline at end of file
@@ -0,0 +1,89 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Builds mip level N of every array layer from level N - 1. Used by
+// ppx::MipGenerator, one dispatch per image and level with the layers in z.
+
+struct GenerateMipsParams
+{
+    uint2 srcSize;
+    uint2 dstSize;
+    uint  srgb;
+};
+
+#if defined(__spirv__)
+[[vk::push_constant]]
+#endif
+ConstantBuffer<GenerateMipsParams> Params : register(b2);
+
+Texture2DArray<float4> SrcTex : register(t0);
+#if defined(__spirv__)
+// Written through views of 8, 16 and 32 bit formats
+[[vk::image_format("unknown")]]
+#endif
+RWTexture2DArray<float4> DstTex : register(u1);
+
+float3 SrgbToLinear(float3 c)
+{
+    return lerp(pow((c + 0.055) / 1.055, 2.4), c / 12.92, step(c, 0.04045));
+}
+
+float3 LinearToSrgb(float3 c)
+{
+    return lerp(1.055 * pow(c, 1.0 / 2.4) - 0.055, c * 12.92, step(c, 0.0031308));
+}
+
+float4 LoadSource(int2 xy, uint layer)
+{
+    float4 value = SrcTex.Load(int4(xy, layer, 0));
+    if (Params.srgb != 0) {
+        value.rgb = SrgbToLinear(value.rgb);
+    }
+    return value;
+}
+
+[numthreads(8, 8, 1)]
+void csmain(uint3 tid : SV_DispatchThreadID)
+{
+    if (any(tid.xy >= Params.dstSize)) {
+        return;
+    }
+
+    // Footprint of the destination texel in source texels: 2x2 texels for
+    // even sizes, up to 3 texels with partial weights along odd sizes so
+    // that every source texel contributes equally to the level.
+    float2 scale = float2(Params.srcSize) / float2(Params.dstSize);
+    float2 begin = float2(tid.xy) * scale;
+    float2 end   = begin + scale;
+    int2   first = int2(floor(begin));
+    int2   last  = min(int2(ceil(end)) - 1, int2(Params.srcSize) - 1);
+
+    float4 sum   = 0;
+    float  total = 0;
+    for (int y = first.y; y <= last.y; ++y) {
+        float wy = min(end.y, y + 1.0) - max(begin.y, (float)y);
+        for (int x = first.x; x <= last.x; ++x) {
+            float wx = min(end.x, x + 1.0) - max(begin.x, (float)x);
+            sum += (wx * wy) * LoadSource(int2(x, y), tid.z);
+            total += wx * wy;
+        }
+    }
+
+    float4 result = sum / total;
+    if (Params.srgb != 0) {
+        result.rgb = LinearToSrgb(saturate(result.rgb));
+    }
+    DstTex[tid] = result;
+}
@@ -0,0 +1,45 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "VirtualTexture.hlsli"
+
+struct SceneData
+{
+    float4x4             MVP;
+    VirtualTextureParams VT;
+};
+
+ConstantBuffer<SceneData> Scene     : register(b0);
+Texture2D<uint4>          PageTable : register(t1);
+Texture2D                 Atlas     : register(t2);
+SamplerState              Sampler0  : register(s3);
+
+struct VSOutput {
+	float4 Position : SV_POSITION;
+	float2 TexCoord : TEXCOORD;
+};
+
+VSOutput vsmain(float4 Position : POSITION, float2 TexCoord : TEXCOORD0)
+{
+	VSOutput result;
+	result.Position = mul(Scene.MVP, Position);
+	result.TexCoord = TexCoord;
+	return result;
+}
+
+float4 psmain(VSOutput input) : SV_TARGET
+{
+	return SampleVirtualTexture(Scene.VT, PageTable, Atlas, Sampler0, input.TexCoord);
+}
@@ -0,0 +1,84 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef VIRTUAL_TEXTURE_HLSLI
+#define VIRTUAL_TEXTURE_HLSLI
+
+// Must match ppx::VirtualTextureShaderParams
+struct VirtualTextureParams
+{
+    float2 virtualSize;
+    float2 pageCount;
+    float2 atlasSize;
+    float  tileSize;
+    float  tileBorder;
+    uint   maxLevel;
+    float  feedbackLodBias;
+    float2 padding;
+};
+
+// Mip level of the virtual texture, computed from the derivatives in virtual
+// texel space since the page table and the atlas have no useful mip chain.
+float VirtualTextureLod(VirtualTextureParams params, float2 uv, float bias)
+{
+    float2 dx = ddx(uv * params.virtualSize);
+    float2 dy = ddy(uv * params.virtualSize);
+    float  d  = max(dot(dx, dx), dot(dy, dy));
+    return clamp(0.5 * log2(max(d, 1e-8)) + bias, 0.0, (float)params.maxLevel);
+}
+
+// Pages covering the texture at level
+float2 VirtualTexturePageCount(VirtualTextureParams params, uint level)
+{
+    return max(floor(params.pageCount / exp2((float)level)), 1.0);
+}
+
+float4 SampleVirtualTexture(
+    VirtualTextureParams params,
+    Texture2D<uint4>     pageTable,
+    Texture2D            atlas,
+    SamplerState         atlasSampler,
+    float2               uv)
+{
+    // Stay inside the last page on the right and bottom edges
+    uv = clamp(uv, 0.0, 0.99999);
+
+    uint   level = (uint)VirtualTextureLod(params, uv, 0.0);
+    uint2  page  = (uint2)(uv * VirtualTexturePageCount(params, level));
+    uint4  entry = pageTable.Load(int3(page, level));
+    if (entry.a == 0) {
+        return float4(0, 0, 0, 1);
+    }
+
+    // The entry may point at an ancestor of the requested page, in which
+    // case the position inside the tile is relative to that ancestor.
+    float2 inTile       = frac(uv * VirtualTexturePageCount(params, entry.b));
+    float  physicalSize = params.tileSize + 2.0 * params.tileBorder;
+    float2 atlasTexel   = (float2)entry.rg * physicalSize + params.tileBorder + inTile * params.tileSize;
+    return atlas.SampleLevel(atlasSampler, atlasTexel / params.atlasSize, 0);
+}
+
+// Value written to the feedback target: the tile key plus one, 0 is
+// reserved for texels that were not covered.
+uint VirtualTextureFeedback(VirtualTextureParams params, float2 uv)
+{
+    uv = clamp(uv, 0.0, 0.99999);
+
+    uint  level = (uint)VirtualTextureLod(params, uv, params.feedbackLodBias);
+    uint2 page  = (uint2)(uv * VirtualTexturePageCount(params, level));
+    return ((level << 28) | (page.y << 14) | page.x) + 1;
+}
+
+#endif // VIRTUAL_TEXTURE_HLSLI
@@ -0,0 +1,33 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Writes one draw argument structure per triangle. Layout matches
+// grfx::DrawIndirectCommand (VkDrawIndirectCommand / D3D12_DRAW_ARGUMENTS),
+// 16 bytes per draw. The draw count is derived from the buffer size.
+RWByteAddressBuffer DrawArgs : register(u0);
+
+[numthreads(64, 1, 1)]
+void csmain(uint3 tid : SV_DispatchThreadID)
+{
+    uint bufferSize = 0;
+    DrawArgs.GetDimensions(bufferSize);
+
+    uint drawCount = bufferSize / 16;
+    if (tid.x >= drawCount) {
+        return;
+    }
+
+    uint offset = tid.x * 16;
+    DrawArgs.Store4(offset, uint4(3, 1, 0, 0)); // vertexCount, instanceCount, firstVertex, firstInstance
+}
@@ -57,6 +57,16 @@ float3 SampleIBLTexture(
     return color;
 }
 
+float3 SampleIBLTexture(
+    TextureCube  iblTexture,
+    SamplerState iblSampler,
+    float3       dir,
+    float        lod)
+{
+    float3 color = iblTexture.SampleLevel(iblSampler, dir, lod).rgb;
+    return color;
+}
+
 float3 ApproxIndirectDFGPolynomial(float3 specularColor, float gloss, float NoV)
 {
     float x = gloss;
@@ -134,8 +144,8 @@ float3 Light_GGX_Direct(
 
 float3 Light_GGX_Indirect(
     float        envLevelCount,        // Number of mips in prefiltered environment texture
-    Texture2D    envTexture,           // Prefiltered environment texture (mipmap)
-    Texture2D    irrTexture,           // Preconvolved irradiance texture
+    TextureCube  envTexture,           // Prefiltered environment cube map (mipmap)
+    TextureCube  irrTexture,           // Preconvolved irradiance cube map
     SamplerState samplerUWrapVClamped, // Sampler wrap on U and clamped on V
     Texture2D    brdfLutTexture,       // BRDF integration LUT texture
     SamplerState samplerClamped,       // Sampler clamped on both U and V
@@ -165,7 +175,7 @@ float3 Light_GGX_Indirect(
     // Specular BRDF
     float3 specularBRDF = 0;
     {
-        float  lod              = envLevelCount * roughness;
+        float  lod              = (envLevelCount - 1.0) * sqrt(roughness); // Levels are prefiltered by perceptual roughness
         float3 prefilteredColor = SampleIBLTexture(envTexture, samplerUWrapVClamped, R, lod);
         prefilteredColor        = min(prefilteredColor, float3(10.0, 10.0, 10.0));
 
@@ -186,8 +196,8 @@ float3 Light_GGX_Indirect(
 
 float3 Light_GGX_Indirect_ApproxPolynomial(
     float        envLevelCount,        // Number of mips in prefiltered environment texture
-    Texture2D    envTexture,           // Prefiltered environment texture (mipmap)
-    Texture2D    irrTexture,           // Preconvolved irradiance texture
+    TextureCube  envTexture,           // Prefiltered environment cube map (mipmap)
+    TextureCube  irrTexture,           // Preconvolved irradiance cube map
     SamplerState samplerUWrapVClamped, // Sampler wrap on U and clamped on V
     float3       N,                    // Surface normal from vertex attribute or normal map
     float3       V,                    // Normalized light direction
@@ -215,7 +225,7 @@ float3 Light_GGX_Indirect_ApproxPolynomial(
     // Specular BRDF
     float3 specularBRDF = 0;
     {
-        float  lod              = envLevelCount * roughness;
+        float  lod              = (envLevelCount - 1.0) * sqrt(roughness); // Levels are prefiltered by perceptual roughness
         float3 prefilteredColor = SampleIBLTexture(envTexture, samplerUWrapVClamped, R, lod);
         prefilteredColor        = min(prefilteredColor, float3(10.0, 10.0, 10.0));
 
@@ -234,8 +244,8 @@ float3 Light_GGX_Indirect_ApproxPolynomial(
 
 float3 Light_GGX_Indirect_ApproxKaris(
     float        envLevelCount,        // Number of mips in prefiltered environment texture
-    Texture2D    envTexture,           // Prefiltered environment texture (mipmap)
-    Texture2D    irrTexture,           // Preconvolved irradiance texture
+    TextureCube  envTexture,           // Prefiltered environment cube map (mipmap)
+    TextureCube  irrTexture,           // Preconvolved irradiance cube map
     SamplerState samplerUWrapVClamped, // Sampler wrap on U and clamped on V
     float3       N,                    // Surface normal from vertex attribute or normal map
     float3       V,                    // Normalized light direction
@@ -263,7 +273,7 @@ float3 Light_GGX_Indirect_ApproxKaris(
     // Specular BRDF
     float3 specularBRDF = 0;
     {
-        float  lod              = envLevelCount * roughness;
+        float  lod              = (envLevelCount - 1.0) * sqrt(roughness); // Levels are prefiltered by perceptual roughness
         float3 prefilteredColor = SampleIBLTexture(envTexture, samplerUWrapVClamped, R, lod);
         prefilteredColor        = min(prefilteredColor, float3(10.0, 10.0, 10.0));
 
@@ -42,6 +42,21 @@
 #define RENDER_CURRENT_VELOCITY_TEXTURE_REGISTER   t15 // FLOCKING_SPACE
 #define RENDER_OUTPUT_POSITION_TEXTURE_REGISTER    u16 // FLOCKING_SPACE
 #define RENDER_OUTPUT_VELOCITY_TEXTURE_REGISTER    u17 // FLOCKING_SPACE
+#define RENDER_FLOCKING_DRAW_DATA_REGISTER         b26 // FLOCKING_SPACE, push constants
+
+// Flocking grid, see Flocking.hlsli. Buffers written by one pass and read
+// by the next use the same register number with a different type.
+#define FLOCKING_GRID_FISH_CELLS_RW_REGISTER       u18
+#define FLOCKING_GRID_FISH_CELLS_REGISTER          t18
+#define FLOCKING_GRID_CELL_COUNTS_RW_REGISTER      u19
+#define FLOCKING_GRID_CELL_COUNTS_REGISTER         t19
+#define FLOCKING_GRID_SCAN_INPUT_REGISTER          t20
+#define FLOCKING_GRID_SCAN_OUTPUT_REGISTER         u21
+#define FLOCKING_GRID_SCAN_SUMS_REGISTER           u22
+#define FLOCKING_GRID_CELL_STARTS_REGISTER         t23
+#define FLOCKING_GRID_BLOCK_OFFSETS_REGISTER       t24
+#define FLOCKING_GRID_SORTED_FISH_RW_REGISTER      u25
+#define FLOCKING_GRID_SORTED_FISH_REGISTER         t25
 
 // -------------------------------------------------------------------------------------------------
 // VS/PS Input and Output
@@ -108,6 +123,13 @@ struct ModelData
 // Flocking
 // -------------------------------------------------------------------------------------------------
 
+// Fish drawn by one draw call are an instance range of the flock, the
+// shaders add firstInstance to SV_InstanceID.
+struct FlockingDrawData
+{
+    uint firstInstance;
+};
+
 struct FlockingData
 {
     int    resX;
@@ -121,8 +143,12 @@ struct FlockingData
     float  timeDelta;
     float3 predPos;
     float3 camPos;
+    uint   gridCellCount; // Power of two
 };
 
+// Values scanned by one group of FlockingGridScan.hlsl
+#define FLOCKING_GRID_SCAN_BLOCK_SIZE 1024
+
 // -------------------------------------------------------------------------------------------------
 // Material
 // -------------------------------------------------------------------------------------------------
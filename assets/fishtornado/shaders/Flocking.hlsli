@@ -0,0 +1,159 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef FLOCKING_HLSLI
+#define FLOCKING_HLSLI
+
+//
+// Shared by the flocking compute shaders. Expects the including shader to
+// declare the flocking constants as:
+//
+//   ConstantBuffer<FlockingData> Flocking : register(RENDER_FLOCKING_DATA_REGISTER, space0);
+//
+
+// -------------------------------------------------------------------------------------------------
+// Grid
+// -------------------------------------------------------------------------------------------------
+
+//
+// Fish are binned into cells of zoneRadius size, so every neighbor within
+// the zone of a fish is in one of the 3x3x3 cells around it. Cells are
+// spatially hashed into Flocking.gridCellCount buckets: the flock is not
+// bounded so the cell coordinates are not either.
+//
+
+// Entry of the sorted fish buffer, 32 bytes
+struct SortedFish
+{
+    float3 position;
+    uint   index; // Texel index of the fish, y * resX + x
+    float3 velocity;
+    uint   padding;
+};
+
+int3 GridCell(float3 position)
+{
+    return (int3)floor(position / Flocking.zoneRadius);
+}
+
+uint GridHash(int3 cell)
+{
+    uint3 c = (uint3)cell;
+    return ((c.x * 73856093) ^ (c.y * 19349663) ^ (c.z * 83492791)) & (Flocking.gridCellCount - 1);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Velocity
+// -------------------------------------------------------------------------------------------------
+
+// Apply the attraction, alignment, and repulsion forces of a neighbor
+void AccumulateNeighbor(
+    float3       myPos,
+    float        accMulti,
+    float3       pos,
+    float3       vel,
+    inout float3 acc,
+    inout float  crowded)
+{
+    float  zoneRadSqrd = (Flocking.zoneRadius * Flocking.zoneRadius);
+    float3 dir         = myPos - pos;
+    float  distSqrd    = dot(dir, dir);
+
+    if (distSqrd < zoneRadSqrd) {
+        float3 dirNorm  = normalize(dir);
+        float  percent  = distSqrd / zoneRadSqrd;
+        float  crowdPer = 1.0 - percent;
+
+        if (percent < Flocking.minThresh) {
+            float F = (Flocking.minThresh / percent - 1.0) * accMulti;
+            acc += dirNorm * F;
+            crowded += crowdPer; //  * 2.0
+        }
+        else if (percent < Flocking.maxThresh) {
+            float threshDelta     = Flocking.maxThresh - Flocking.minThresh;
+            float adjustedPercent = (percent - Flocking.minThresh) / threshDelta;
+            float F               = (1.0 - (cos(adjustedPercent * 6.28318) * -0.5 + 0.5)) * accMulti;
+            acc += normalize(vel) * F;
+            crowded += crowdPer * 0.5;
+        }
+        else {
+            float threshDelta     = 1.0 - Flocking.maxThresh;
+            float adjustedPercent = (percent - Flocking.maxThresh) / threshDelta;
+            float F               = (1.0 - (cos(adjustedPercent * 6.28318) * -0.5 + 0.5)) * accMulti;
+            acc += -dirNorm * F;
+            crowded += crowdPer * 0.25;
+        }
+    }
+}
+
+// Apply the predator, camera, center and speed limit terms to the
+// accumulated neighbor forces. Returns the new velocity and crowd value.
+float4 FinishVelocity(float3 myPos, float3 myVel, float myCrowd, float3 acc, float crowded)
+{
+    acc.y *= 0.960;
+    acc.y -= 0.005;
+
+    // Avoid predator
+    float3 dirToPred   = myPos - Flocking.predPos;
+    float  distToPred  = length(dirToPred);
+    float  distPredPer = max(1.0 - (distToPred / 200.0), 0.0);
+    crowded += distPredPer * 10.0;
+    acc += (normalize(dirToPred) * float3(1.0, 0.25, 1.0)) * distPredPer * Flocking.timeDelta * 25.0;
+
+    // Avoid camera
+    float3 dirToCam   = myPos - Flocking.camPos;
+    float  distToCam  = length(dirToCam);
+    float  distCamPer = max(1.0 - (distToCam / 60.0), 0.0);
+    crowded += distCamPer * 50.0;
+    acc += (normalize(dirToCam) * float3(1.0, 0.25, 1.0)) * distCamPer * Flocking.timeDelta * 5.0;
+
+    // Pull to center line
+    float2 centerLine = float2(sin(Flocking.time * 0.0002 + myPos.y * 0.01), sin(Flocking.time * 0.0002 - 1.5 + myPos.y * 0.01)) * 80.0;
+    myVel.xz -= (myPos.xz - centerLine) * Flocking.timeDelta * 0.0025; //0.005;
+
+    // Pull to center point
+    myVel -= normalize(myPos - float3(0.0, 150.0, 0.0)) * Flocking.timeDelta * 0.1; //0.2;
+
+    myVel += acc * Flocking.timeDelta;
+    myCrowd -= (myCrowd - crowded) * (Flocking.timeDelta);
+
+    // Set speed limit
+    float  newMaxSpeed = clamp(Flocking.maxSpeed + myCrowd * 0.001, Flocking.minSpeed, 5.0);
+    float  velLength   = length(myVel);
+    float3 velNorm     = normalize(myVel);
+
+    if (velLength < Flocking.minSpeed) {
+        myVel = velNorm * Flocking.minSpeed;
+    }
+    else if (velLength > newMaxSpeed) {
+        myVel = velNorm * newMaxSpeed;
+    }
+
+    float3 nextPos = myPos + myVel * Flocking.timeDelta;
+
+    // Avoid floor and sky planes
+    if (nextPos.y > 470.0) {
+        myVel.y -= (myPos.y - 470.0) * 0.01;
+    }
+
+    if (nextPos.y < 50.0) {
+        myVel.y -= (myPos.y - 50.0) * 0.01;
+    }
+
+    myVel.y *= 0.999;
+
+    return float4(myVel, myCrowd);
+}
+
+#endif // FLOCKING_HLSLI
@@ -0,0 +1,38 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Config.hlsli"
+
+ConstantBuffer<FlockingData> Flocking          : register(RENDER_FLOCKING_DATA_REGISTER, space0);             // Flocking params
+Texture2D<float4>            InPositionTexture : register(RENDER_PREVIOUS_POSITION_TEXTURE_REGISTER, space0); // Previous position
+RWStructuredBuffer<uint2>    OutFishCells      : register(FLOCKING_GRID_FISH_CELLS_RW_REGISTER, space0);      // Cell hash and rank in cell per fish
+RWStructuredBuffer<uint>     OutCellCounts     : register(FLOCKING_GRID_CELL_COUNTS_RW_REGISTER, space0);     // Fish per cell, cleared to zero
+
+#include "Flocking.hlsli"
+
+// -------------------------------------------------------------------------------------------------
+
+// First pass of the counting sort: counts the fish of every cell. The rank of
+// the fish within its cell is kept so the scatter pass needs no atomics.
+[numthreads(8, 8, 1)]
+void csmain(uint3 tid : SV_DispatchThreadID)
+{
+    float3 myPos = InPositionTexture[tid.xy].xyz;
+    uint   hash  = GridHash(GridCell(myPos));
+
+    uint rank = 0;
+    InterlockedAdd(OutCellCounts[hash], 1, rank);
+
+    OutFishCells[tid.y * Flocking.resX + tid.x] = uint2(hash, rank);
+}
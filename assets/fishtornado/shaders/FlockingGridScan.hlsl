@@ -0,0 +1,72 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Config.hlsli"
+
+#define SCAN_THREADS             256
+#define SCAN_ELEMENTS_PER_THREAD (FLOCKING_GRID_SCAN_BLOCK_SIZE / SCAN_THREADS)
+
+StructuredBuffer<uint>   InValues      : register(FLOCKING_GRID_SCAN_INPUT_REGISTER, space0);  // Values to scan
+RWStructuredBuffer<uint> OutPrefixSums : register(FLOCKING_GRID_SCAN_OUTPUT_REGISTER, space0); // Exclusive prefix sums within each group
+RWStructuredBuffer<uint> OutGroupSums  : register(FLOCKING_GRID_SCAN_SUMS_REGISTER, space0);   // Total of each group
+
+groupshared uint sThreadSums[SCAN_THREADS];
+
+// -------------------------------------------------------------------------------------------------
+
+// Exclusive prefix sum of blocks of FLOCKING_GRID_SCAN_BLOCK_SIZE values.
+// Every thread sums its own values serially, the thread sums are then scanned
+// in group shared memory. Scanning the group sums with a second dispatch
+// gives the offset to add to each block.
+[numthreads(SCAN_THREADS, 1, 1)]
+void csmain(uint3 gid : SV_GroupID, uint gi : SV_GroupIndex)
+{
+    uint count  = 0;
+    uint stride = 0;
+    InValues.GetDimensions(count, stride);
+
+    uint first = (gid.x * SCAN_THREADS + gi) * SCAN_ELEMENTS_PER_THREAD;
+
+    uint values[SCAN_ELEMENTS_PER_THREAD];
+    uint threadSum = 0;
+    for (uint i = 0; i < SCAN_ELEMENTS_PER_THREAD; ++i) {
+        uint index = first + i;
+        values[i]  = (index < count) ? InValues[index] : 0;
+        threadSum += values[i];
+    }
+
+    sThreadSums[gi] = threadSum;
+    GroupMemoryBarrierWithGroupSync();
+
+    // Inclusive scan of the thread sums
+    for (uint offset = 1; offset < SCAN_THREADS; offset <<= 1) {
+        uint value = (gi >= offset) ? sThreadSums[gi - offset] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        sThreadSums[gi] += value;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    uint prefix = sThreadSums[gi] - threadSum;
+    for (uint i = 0; i < SCAN_ELEMENTS_PER_THREAD; ++i) {
+        uint index = first + i;
+        if (index < count) {
+            OutPrefixSums[index] = prefix;
+        }
+        prefix += values[i];
+    }
+
+    if (gi == (SCAN_THREADS - 1)) {
+        OutGroupSums[gid.x] = sThreadSums[gi];
+    }
+}
@@ -0,0 +1,47 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Config.hlsli"
+
+ConstantBuffer<FlockingData> Flocking          : register(RENDER_FLOCKING_DATA_REGISTER, space0);             // Flocking params
+Texture2D<float4>            InPositionTexture : register(RENDER_PREVIOUS_POSITION_TEXTURE_REGISTER, space0); // Previous position
+Texture2D<float4>            InVelocityTexture : register(RENDER_PREVIOUS_VELOCITY_TEXTURE_REGISTER, space0); // Previous velocity
+StructuredBuffer<uint2>      InFishCells       : register(FLOCKING_GRID_FISH_CELLS_REGISTER, space0);         // Cell hash and rank in cell per fish
+StructuredBuffer<uint>       InCellStarts      : register(FLOCKING_GRID_CELL_STARTS_REGISTER, space0);        // Prefix sums of cell counts within blocks
+StructuredBuffer<uint>       InBlockOffsets    : register(FLOCKING_GRID_BLOCK_OFFSETS_REGISTER, space0);      // Prefix sums of block totals
+
+#include "Flocking.hlsli"
+
+RWStructuredBuffer<SortedFish> OutSortedFish : register(FLOCKING_GRID_SORTED_FISH_RW_REGISTER, space0); // Fish sorted by cell
+
+// -------------------------------------------------------------------------------------------------
+
+// Last pass of the counting sort: copies every fish to its slot so the fish of
+// a cell are contiguous and can be read without going through the textures.
+[numthreads(8, 8, 1)]
+void csmain(uint3 tid : SV_DispatchThreadID)
+{
+    uint  index    = tid.y * Flocking.resX + tid.x;
+    uint2 fishCell = InFishCells[index];
+    uint  hash     = fishCell.x;
+    uint  dst      = InCellStarts[hash] + InBlockOffsets[hash / FLOCKING_GRID_SCAN_BLOCK_SIZE] + fishCell.y;
+
+    SortedFish fish;
+    fish.position = InPositionTexture[tid.xy].xyz;
+    fish.index    = index;
+    fish.velocity = InVelocityTexture[tid.xy].xyz;
+    fish.padding  = 0;
+
+    OutSortedFish[dst] = fish;
+}
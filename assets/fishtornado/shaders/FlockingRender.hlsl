@@ -31,6 +31,11 @@ Texture2D<float4>            PrevPositionTex  : register(RENDER_PREVIOUS_POSITIO
 Texture2D<float4>            CurrPositionTex  : register(RENDER_CURRENT_POSITION_TEXTURE_REGISTER,  FLOCKING_SPACE);
 Texture2D<float4>            CurrVelocityTex  : register(RENDER_CURRENT_VELOCITY_TEXTURE_REGISTER,  FLOCKING_SPACE);
 
+#if defined(__spirv__)
+[[vk::push_constant]]
+#endif
+ConstantBuffer<FlockingDrawData> FlockingDraw : register(RENDER_FLOCKING_DRAW_DATA_REGISTER, FLOCKING_SPACE);
+
 // -------------------------------------------------------------------------------------------------
 
 float getSinVal(float z, float randPer)
@@ -45,6 +50,8 @@ float getSinVal(float z, float randPer)
 
 VSOutput vsmain(VSInput input, uint instanceId : SV_InstanceID)
 {
+    instanceId += FlockingDraw.firstInstance;
+
     // Texture data
     uint2  xy        = uint2((instanceId % Flocking.resX), (instanceId / Flocking.resY));
     float4 prevPos   = PrevPositionTex[xy];
@@ -21,6 +21,11 @@ Texture2D<float4>            PrevPositionTex : register(RENDER_PREVIOUS_POSITION
 Texture2D<float4>            CurrPositionTex : register(RENDER_CURRENT_POSITION_TEXTURE_REGISTER, FLOCKING_SPACE);
 Texture2D<float4>            CurrVelocityTex : register(RENDER_CURRENT_VELOCITY_TEXTURE_REGISTER, FLOCKING_SPACE);
 
+#if defined(__spirv__)
+[[vk::push_constant]]
+#endif
+ConstantBuffer<FlockingDrawData> FlockingDraw : register(RENDER_FLOCKING_DRAW_DATA_REGISTER, FLOCKING_SPACE);
+
 // -------------------------------------------------------------------------------------------------
 
 float getSinVal(float z, float randPer)
@@ -35,6 +40,8 @@ float getSinVal(float z, float randPer)
 
 float4 vsmain(float4 position : POSITION, uint instanceId : SV_InstanceID) : SV_POSITION
 {
+    instanceId += FlockingDraw.firstInstance;
+
     // Texture data
     uint2  xy        = uint2((instanceId % Flocking.resX), (instanceId / Flocking.resY));
     float4 prevPos   = PrevPositionTex[xy];
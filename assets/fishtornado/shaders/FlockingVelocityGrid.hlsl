@@ -0,0 +1,83 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Config.hlsli"
+
+ConstantBuffer<FlockingData> Flocking           : register(RENDER_FLOCKING_DATA_REGISTER, space0);             // Flocking params
+Texture2D<float4>            InPositionTexture  : register(RENDER_PREVIOUS_POSITION_TEXTURE_REGISTER, space0); // Previous position
+Texture2D<float4>            InVelocityTexture  : register(RENDER_PREVIOUS_VELOCITY_TEXTURE_REGISTER, space0); // Previous velocity
+RWTexture2D<float4>          OutVelocityTexture : register(RENDER_OUTPUT_VELOCITY_TEXTURE_REGISTER, space0);   // Out velocity
+StructuredBuffer<uint>       InCellCounts       : register(FLOCKING_GRID_CELL_COUNTS_REGISTER, space0);        // Fish per cell
+StructuredBuffer<uint>       InCellStarts       : register(FLOCKING_GRID_CELL_STARTS_REGISTER, space0);        // Prefix sums of cell counts within blocks
+StructuredBuffer<uint>       InBlockOffsets     : register(FLOCKING_GRID_BLOCK_OFFSETS_REGISTER, space0);      // Prefix sums of block totals
+
+#include "Flocking.hlsli"
+
+StructuredBuffer<SortedFish> InSortedFish : register(FLOCKING_GRID_SORTED_FISH_REGISTER, space0); // Fish sorted by cell
+
+// -------------------------------------------------------------------------------------------------
+
+// Same as FlockingVelocity.hlsl but only visits the fish of the 3x3x3 cells
+// around this fish, which contain every fish within its zone.
+[numthreads(8, 8, 1)]
+void csmain(uint3 tid : SV_DispatchThreadID)
+{
+    float4 vPos       = InPositionTexture[tid.xy];
+    float3 myPos      = vPos.xyz;
+    float  leadership = vPos.a;
+    float  accMulti   = leadership * Flocking.timeDelta * 1.5; // Cinder version used 0.5 multiplier
+
+    float4 vVel    = InVelocityTexture[tid.xy];
+    float3 myVel   = vVel.xyz;
+    float  myCrowd = vVel.a;
+
+    float3 acc = (float3)0;
+
+    uint  myX     = tid.x;
+    uint  myY     = tid.y;
+    float crowded = 5.0;
+
+    int3 myCell = GridCell(myPos);
+    for (int z = -1; z <= 1; ++z) {
+        for (int y = -1; y <= 1; ++y) {
+            for (int x = -1; x <= 1; ++x) {
+                int3 cell  = myCell + int3(x, y, z);
+                uint hash  = GridHash(cell);
+                uint start = InCellStarts[hash] + InBlockOffsets[hash / FLOCKING_GRID_SCAN_BLOCK_SIZE];
+                uint end   = start + InCellCounts[hash];
+
+                for (uint i = start; i < end; ++i) {
+                    SortedFish fish = InSortedFish[i];
+
+                    // Skip fish of other cells that share the hash, this also
+                    // keeps cells that hash to the same bucket from being
+                    // visited twice.
+                    if (any(GridCell(fish.position) != cell)) {
+                        continue;
+                    }
+
+                    // Keep the same neighbors as FlockingVelocity.hlsl, which
+                    // skips the fish of its own row and column.
+                    uint fishX = fish.index % (uint)Flocking.resX;
+                    uint fishY = fish.index / (uint)Flocking.resX;
+                    if ((fishX != myX) && (fishY != myY)) {
+                        AccumulateNeighbor(myPos, accMulti, fish.position, fish.velocity, acc, crowded);
+                    }
+                }
+            }
+        }
+    }
+
+    OutVelocityTexture[tid.xy] = FinishVelocity(myPos, myVel, myCrowd, acc, crowded);
+}
@@ -78,13 +78,16 @@ struct CSInput
     float curl;
 
     float2 normalizationScale;
+    uint   parity;
 };
 
-ConstantBuffer<CSInput> Params : register(b0);
+// Shader inputs are sub-allocated from a ring buffer and bound through their
+// own descriptor set (set 1), all other resources are in set 0.
+ConstantBuffer<CSInput> Params : register(b0, space1);
 
 SamplerState ClampSampler : register(s1);
 
-// Used by clear.hlsl and splat.hlsl.
+// Used by clear.hlsl, splat.hlsl, restriction.hlsl and prolongation.hlsl.
 Texture2D UTexture : register(t2);
 
 // Used by vorticity.hlsl, advection.hlsl, curl.hlsl, divergence.hlsl, gradient_subtract.hlsl.
@@ -101,10 +104,10 @@ Texture2D UBloom : register(t6);
 Texture2D USunrays : register(t7);
 Texture2D UDithering : register(t8);
 
-// Used by gradient_subtract.hlsl, pressure.hlsl.
+// Used by gradient_subtract.hlsl, pressure.hlsl, gauss_seidel.hlsl, residual.hlsl and prolongation.hlsl.
 Texture2D UPressure : register(t9);
 
-// Used by pressure.hlsl.
+// Used by pressure.hlsl, gauss_seidel.hlsl and residual.hlsl.
 Texture2D UDivergence : register(t10);
 
 // The output generated by every shader.
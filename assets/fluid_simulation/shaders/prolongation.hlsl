@@ -0,0 +1,19 @@
+// Copyright 2023 Google LLC
+//
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#include "config.hlsli"
+
+// Adds the error computed on the next coarser level, bilinearly interpolated,
+// to the pressure of this level.
+[numthreads(1, 1, 1)] void csmain(uint2 tid
+                                  : SV_DispatchThreadID) {
+    Coord coord = BaseVS(tid, Params.normalizationScale, Params.texelSize);
+
+    float pressure   = UPressure.SampleLevel(ClampSampler, coord.vUv, 0).x;
+    float correction = UTexture.SampleLevel(ClampSampler, coord.vUv, 0).x;
+
+    Output[coord.xy] = float4(pressure + correction, 0.0, 0.0, 1.0);
+}
@@ -0,0 +1,37 @@
+// Copyright 2023 Google LLC
+//
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#include "config.hlsli"
+
+// Restricts a residual to the right-hand side of the next coarser level.
+// Coarse levels are rounded up when a side is odd, so a coarse cell does not
+// always cover exactly 2x2 fine cells. Each fine cell is weighted by the area of
+// it the coarse cell overlaps, which sums the residual over the coarse cell. This
+// is the average scaled by the squared grid spacing, since every level solves
+// the equation in its own texel units.
+[numthreads(1, 1, 1)] void csmain(uint2 tid
+                                  : SV_DispatchThreadID) {
+    uint2 fineSize;
+    uint2 coarseSize;
+    UTexture.GetDimensions(fineSize.x, fineSize.y);
+    Output.GetDimensions(coarseSize.x, coarseSize.y);
+
+    float2 ratio = float2(fineSize) / float2(coarseSize);
+    float2 lo    = float2(tid) * ratio;
+    float2 hi    = float2(tid + 1) * ratio;
+    uint2  end   = min(uint2(ceil(hi)), fineSize);
+
+    float residual = 0.0;
+    for (uint y = uint(lo.y); y < end.y; ++y) {
+        float wy = min(float(y + 1), hi.y) - max(float(y), lo.y);
+        for (uint x = uint(lo.x); x < end.x; ++x) {
+            float wx = min(float(x + 1), hi.x) - max(float(x), lo.x);
+            residual += wx * wy * UTexture.Load(int3(x, y, 0)).x;
+        }
+    }
+
+    Output[tid] = float4(residual, 0.0, 0.0, 1.0);
+}
@@ -40,6 +40,28 @@
 #define MATERIAL_IBL_MAP_TEXTURE_REGISTER     t12
 #define MATERIAL_ENV_MAP_TEXTURE_REGISTER     t13
 
+//
+// Tiled light culling, see LightCulling.hlsl. The screen is split into
+// tiles of LIGHT_CULLING_TILE_SIZE pixels. Each tile owns
+// LIGHT_CULLING_TILE_STRIDE uints of the tile lights buffer: the number
+// of lights that touch the tile followed by their indices. The stats
+// buffer counts the tiles that had more lights than fit, and the lights
+// they dropped.
+//
+#define LIGHT_CULLING_SPACE                space1
+#define LIGHT_CULLING_CONSTANTS_REGISTER   b23
+#define LIGHT_CULLING_DEPTH_REGISTER       t24
+#define LIGHT_CULLING_TILE_LIGHTS_REGISTER u25
+#define LIGHT_CULLING_STATS_REGISTER       u26
+
+#define LIGHT_CULLING_TILE_SIZE           16
+#define LIGHT_CULLING_MAX_LIGHTS_PER_TILE 255
+#define LIGHT_CULLING_TILE_STRIDE         (LIGHT_CULLING_MAX_LIGHTS_PER_TILE + 1)
+
+#define LIGHT_CULLING_STATS_OVERFLOW_TILE_COUNT_INDEX 0
+#define LIGHT_CULLING_STATS_DROPPED_LIGHT_COUNT_INDEX 1
+#define LIGHT_CULLING_STATS_COUNT                     2
+
 #define PI 3.1415292
 
 struct SceneData
@@ -52,6 +74,7 @@ struct SceneData
     float    ambient;
     float    iblLevelCount;
     float    envLevelCount;
+    uint     unboundedLightCount; // Lights [0, unboundedLightCount) are not culled
 };
 
 struct Light
@@ -60,6 +83,15 @@ struct Light
     float3 position;
     float3 color;
     float  intensity;
+    float  radius; // 0 = unbounded, never culled
+    float3 padding;
+};
+
+struct LightCullingData
+{
+    float4x4 inverseViewProjectionMatrix;
+    uint2    screenSize;
+    uint2    tileCount;
 };
 
 struct MaterialData
@@ -32,11 +32,15 @@ Texture2D    IBLTex         : register(GBUFFER_ENV_REGISTER,     GBUFFER_SPACE);
 Texture2D    EnvMapTex      : register(GBUFFER_IBL_REGISTER,     GBUFFER_SPACE);
 SamplerState ClampedSampler : register(GBUFFER_SAMPLER_REGISTER, GBUFFER_SPACE);
 
+StructuredBuffer<uint> TileLights : register(GBUFFER_TILE_LIGHTS_REGISTER, GBUFFER_SPACE);
+
 cbuffer GBufferData : register(GBUFFER_CONSTANTS_REGISTER, GBUFFER_SPACE)
 {
     uint enableIBL;
     uint enableEnv;
     uint debugAttrIndex;
+    uint enableTiledLighting; // Shade the lights of the tile lists written by LightCulling.hlsl
+    uint tileCountX;
 };
 
 // -------------------------------------------------------------------------------------------------
@@ -112,7 +116,54 @@ float3 Environment(Texture2D tex, float3 coord, float lod)
     return color;
 }
 
-float3 PBR(GBuffer gbuffer)
+//
+// Contribution of a single light. Bounded lights fade out smoothly to
+// zero at their radius so culling them outside of it is not visible.
+//
+float3 DirectLighting(Light light, float3 P, float3 N, float3 Lo, float cosLo, float3 albedo, float3 F0, float roughness, float metalness)
+{
+    float3 Lv   = light.position - P;
+    float3 Li   = normalize(Lv);                 // Incoming light direction
+    float3 Lrad = light.color * light.intensity; // Light radiance
+    float3 Lh   = normalize(Li + Lo);            // Half-vector between Li and Lo
+    float  cosLi = saturate(dot(N, Li));
+    float  cosLh = saturate(dot(N, Lh));
+
+    if (light.radius > 0.0) {
+        float distSq = dot(Lv, Lv);
+        float x      = distSq / (light.radius * light.radius);
+        float window = saturate(1.0 - x * x);
+        Lrad *= (window * window) / (distSq + 1.0);
+    }
+
+    // Calculate Fresnel term for direct lighting 
+    float3 F = FresnelSchlick(F0, saturate(dot(Lh, Lo)));
+    // Calculate normal distribution for specular BRDF
+    float  D = DistributionGGX(cosLh, roughness);
+    // Calculate geometric attenuation for specular BRDF
+    float  G = GASmithSchlickGGX(cosLi, cosLo, roughness);
+
+    // Diffuse scattering happens due to light being refracted multiple times by a dielectric medium.
+    // Metals on the other hand either reflect or absorb energy, so diffuse contribution is always zero.
+    // To be energy conserving we must scale diffuse BRDF contribution based on Fresnel factor & metalness.
+    //
+    float3 kD = lerp(float3(1, 1, 1) - F, float3(0, 0, 0), metalness);
+
+    // Lambert diffuse BRDF
+    // 
+    // We don't scale by 1/PI for lighting & material units to be more convenient.
+    //   See: https://seblagarde.wordpress.com/2012/01/08/pi-or-not-to-pi-in-game-lighting-equation/
+    //
+    float3 diffuseBRDF = kD * albedo;
+
+    // Calculate specular BRDF
+    float3 specularBRDF = (F * D * G) / max(0.00001, 4.0 * cosLi * cosLo);
+    
+    // Light's total contribution
+    return (diffuseBRDF + specularBRDF) * Lrad * cosLi;
+}
+
+float3 PBR(GBuffer gbuffer, uint2 tile)
 {
     float3 P  = gbuffer.position;
     float3 N  = gbuffer.normal;
@@ -136,38 +187,23 @@ float3 PBR(GBuffer gbuffer)
 
     // Calculate direct lighting
     float3 directLighting = (float3)0;
-    for (uint i = 0; i < Scene.lightCount; ++i) {
-        float3 Li   = normalize(Lights[i].position - P); // Incoming light direction
-        float  Lrad = Lights[i].intensity;               // Light radiance
-        float3 Lh   = normalize(Li + Lo);                // Half-vector between Li and Lo
-        float  cosLi = saturate(dot(N, Li));
-        float  cosLh = saturate(dot(N, Lh));
-
-        // Calculate Fresnel term for direct lighting 
-        float3 F = FresnelSchlick(F0, saturate(dot(Lh, Lo)));
-        // Calculate normal distribution for specular BRDF
-        float  D = DistributionGGX(cosLh, roughness);
-        // Calculate geometric attenuation for specular BRDF
-        float  G = GASmithSchlickGGX(cosLi, cosLo, roughness);
-
-        // Diffuse scattering happens due to light being refracted multiple times by a dielectric medium.
-        // Metals on the other hand either reflect or absorb energy, so diffuse contribution is always zero.
-        // To be energy conserving we must scale diffuse BRDF contribution based on Fresnel factor & metalness.
-        //
-        float3 kD = lerp(float3(1, 1, 1) - F, float3(0, 0, 0), metalness);
-
-        // Lambert diffuse BRDF
-        // 
-        // We don't scale by 1/PI for lighting & material units to be more convenient.
-        //   See: https://seblagarde.wordpress.com/2012/01/08/pi-or-not-to-pi-in-game-lighting-equation/
-        //
-        float3 diffuseBRDF = kD * albedo;
+    if (enableTiledLighting == 1) {
+        // Unbounded lights are not in the tile lists
+        for (uint i = 0; i < Scene.unboundedLightCount; ++i) {
+            directLighting += DirectLighting(Lights[i], P, N, Lo, cosLo, albedo, F0, roughness, metalness);
+        }
 
-        // Calculate specular BRDF
-        float3 specularBRDF = (F * D * G) / max(0.00001, 4.0 * cosLi * cosLo);
-    
-        // Accumulate light's total contribution
-        directLighting += (diffuseBRDF + specularBRDF) * Lrad * cosLi;
+        uint tileBase   = (tile.y * tileCountX + tile.x) * LIGHT_CULLING_TILE_STRIDE;
+        uint lightCount = TileLights[tileBase];
+        for (uint i = 0; i < lightCount; ++i) {
+            uint lightIndex = TileLights[tileBase + 1 + i];
+            directLighting += DirectLighting(Lights[lightIndex], P, N, Lo, cosLo, albedo, F0, roughness, metalness);
+        }
+    }
+    else {
+        for (uint i = 0; i < Scene.lightCount; ++i) {
+            directLighting += DirectLighting(Lights[i], P, N, Lo, cosLo, albedo, F0, roughness, metalness);
+        }
     }
 
     // Calculate indirect lighting
@@ -229,7 +265,7 @@ float4 psmain(float4 Position : SV_POSITION, float2 TexCoord : TEXCOORD) : SV_TA
     
     GBuffer gbuffer = UnpackGBuffer(packed);
     
-    float3 color = PBR(gbuffer);
+    float3 color = PBR(gbuffer, (uint2)Position.xy / LIGHT_CULLING_TILE_SIZE);
 
     return float4(color, 1.0);
 }
\ No newline at end of file
@@ -23,12 +23,13 @@
 // The register numbers are purposely incremental to
 // achieve compatibility between D3D12 and Vulkan.
 //
-#define GBUFFER_RT0_REGISTER     t16
-#define GBUFFER_RT1_REGISTER     t17
-#define GBUFFER_RT2_REGISTER     t18
-#define GBUFFER_RT3_REGISTER     t19
-#define GBUFFER_ENV_REGISTER     t20
-#define GBUFFER_IBL_REGISTER     t21
+#define GBUFFER_RT0_REGISTER         t16
+#define GBUFFER_RT1_REGISTER         t17
+#define GBUFFER_RT2_REGISTER         t18
+#define GBUFFER_RT3_REGISTER         t19
+#define GBUFFER_ENV_REGISTER         t20
+#define GBUFFER_IBL_REGISTER         t21
+#define GBUFFER_TILE_LIGHTS_REGISTER t22
 
 #define GBUFFER_SAMPLER_REGISTER s6
 
@@ -0,0 +1,166 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//
+// Tiled light culling
+//
+// One thread group per screen tile. The group reduces the tile's depth
+// range, bounds the part of the view frustum between the nearest and the
+// farthest depth with a world space box, and keeps the lights whose
+// sphere of influence touches that box. DeferredLight.hlsl only shades
+// the lights in the list of the pixel's tile.
+//
+// The first Scene.unboundedLightCount lights are shaded by every pixel and
+// are not culled. Lists are built in light index order, a tile that
+// touches more than LIGHT_CULLING_MAX_LIGHTS_PER_TILE lights keeps the
+// lowest indices and is counted in CullingStats.
+//
+// Tiles without geometry get an empty list.
+//
+
+#include "Config.hlsli"
+
+ConstantBuffer<SceneData>        Scene        : register(SCENE_CONSTANTS_REGISTER,           SCENE_DATA_SPACE);
+StructuredBuffer<Light>          Lights       : register(LIGHT_DATA_REGISTER,                SCENE_DATA_SPACE);
+ConstantBuffer<LightCullingData> Culling      : register(LIGHT_CULLING_CONSTANTS_REGISTER,   LIGHT_CULLING_SPACE);
+Texture2D                        DepthTex     : register(LIGHT_CULLING_DEPTH_REGISTER,       LIGHT_CULLING_SPACE);
+RWStructuredBuffer<uint>         TileLights   : register(LIGHT_CULLING_TILE_LIGHTS_REGISTER, LIGHT_CULLING_SPACE);
+RWStructuredBuffer<uint>         CullingStats : register(LIGHT_CULLING_STATS_REGISTER,       LIGHT_CULLING_SPACE);
+
+#define GROUP_THREAD_COUNT (LIGHT_CULLING_TILE_SIZE * LIGHT_CULLING_TILE_SIZE)
+#define GROUP_MASK_COUNT   (GROUP_THREAD_COUNT / 32)
+
+groupshared uint gsMinDepth;
+groupshared uint gsMaxDepth;
+groupshared uint gsLightCount;
+groupshared uint gsLightIndices[LIGHT_CULLING_MAX_LIGHTS_PER_TILE];
+groupshared uint gsVisibleMask[GROUP_MASK_COUNT];
+
+// Screen position in pixels and depth to world space
+float3 Unproject(float2 screenPos, float depth)
+{
+    float2 ndc = float2(screenPos.x / Culling.screenSize.x * 2.0 - 1.0, 1.0 - screenPos.y / Culling.screenSize.y * 2.0);
+    float4 pos = mul(Culling.inverseViewProjectionMatrix, float4(ndc, depth, 1.0));
+    return pos.xyz / pos.w;
+}
+
+bool SphereIntersectsBox(float3 center, float radius, float3 boxMin, float3 boxMax)
+{
+    float3 closest = clamp(center, boxMin, boxMax);
+    float3 d       = center - closest;
+    return dot(d, d) <= (radius * radius);
+}
+
+[numthreads(LIGHT_CULLING_TILE_SIZE, LIGHT_CULLING_TILE_SIZE, 1)]
+void csmain(uint3 groupId : SV_GroupID, uint3 dispatchThreadId : SV_DispatchThreadID, uint groupIndex : SV_GroupIndex)
+{
+    if (groupIndex == 0) {
+        gsMinDepth   = asuint(1.0);
+        gsMaxDepth   = 0;
+        gsLightCount = 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // Depth range of the tile, the cleared depth is the background
+    if (all(dispatchThreadId.xy < Culling.screenSize)) {
+        float depth = DepthTex.Load(int3(dispatchThreadId.xy, 0)).r;
+        if (depth < 1.0) {
+            InterlockedMin(gsMinDepth, asuint(depth));
+            InterlockedMax(gsMaxDepth, asuint(depth));
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    float minDepth    = asfloat(gsMinDepth);
+    float maxDepth    = asfloat(gsMaxDepth);
+    bool  hasGeometry = (minDepth <= maxDepth);
+
+    // World space box around the corners of the tile's frustum slice
+    float2 tileMin = (float2)(groupId.xy * LIGHT_CULLING_TILE_SIZE);
+    float2 tileMax = (float2)min((groupId.xy + 1) * LIGHT_CULLING_TILE_SIZE, Culling.screenSize);
+
+    float3 corners[8] = {
+        Unproject(float2(tileMin.x, tileMin.y), minDepth),
+        Unproject(float2(tileMax.x, tileMin.y), minDepth),
+        Unproject(float2(tileMin.x, tileMax.y), minDepth),
+        Unproject(float2(tileMax.x, tileMax.y), minDepth),
+        Unproject(float2(tileMin.x, tileMin.y), maxDepth),
+        Unproject(float2(tileMax.x, tileMin.y), maxDepth),
+        Unproject(float2(tileMin.x, tileMax.y), maxDepth),
+        Unproject(float2(tileMax.x, tileMax.y), maxDepth),
+    };
+
+    float3 boxMin = corners[0];
+    float3 boxMax = corners[0];
+    for (uint i = 1; i < 8; ++i) {
+        boxMin = min(boxMin, corners[i]);
+        boxMax = max(boxMax, corners[i]);
+    }
+
+    // Every thread tests one light of a chunk. A visible light's slot is
+    // the number of visible lights with a lower index, which keeps the list
+    // sorted and makes the lights that don't fit independent of thread
+    // scheduling. The loop bounds are the same for the whole group.
+    uint maskIndex = groupIndex / 32;
+    uint maskBit   = 1u << (groupIndex % 32);
+    for (uint chunkBase = Scene.unboundedLightCount; chunkBase < Scene.lightCount; chunkBase += GROUP_THREAD_COUNT) {
+        if (groupIndex < GROUP_MASK_COUNT) {
+            gsVisibleMask[groupIndex] = 0;
+        }
+        GroupMemoryBarrierWithGroupSync();
+
+        uint lightIndex = chunkBase + groupIndex;
+        bool visible    = false;
+        if (hasGeometry && (lightIndex < Scene.lightCount)) {
+            Light light = Lights[lightIndex];
+            visible     = (light.radius <= 0.0) || SphereIntersectsBox(light.position, light.radius, boxMin, boxMax);
+        }
+        if (visible) {
+            InterlockedOr(gsVisibleMask[maskIndex], maskBit);
+        }
+        GroupMemoryBarrierWithGroupSync();
+
+        if (visible) {
+            uint slot = gsLightCount + countbits(gsVisibleMask[maskIndex] & (maskBit - 1));
+            for (uint i = 0; i < maskIndex; ++i) {
+                slot += countbits(gsVisibleMask[i]);
+            }
+            if (slot < LIGHT_CULLING_MAX_LIGHTS_PER_TILE) {
+                gsLightIndices[slot] = lightIndex;
+            }
+        }
+        GroupMemoryBarrierWithGroupSync();
+
+        if (groupIndex == 0) {
+            for (uint i = 0; i < GROUP_MASK_COUNT; ++i) {
+                gsLightCount += countbits(gsVisibleMask[i]);
+            }
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    // Lights past LIGHT_CULLING_MAX_LIGHTS_PER_TILE are dropped
+    uint tileBase   = (groupId.y * Culling.tileCount.x + groupId.x) * LIGHT_CULLING_TILE_STRIDE;
+    uint lightCount = min(gsLightCount, LIGHT_CULLING_MAX_LIGHTS_PER_TILE);
+    if (groupIndex == 0) {
+        TileLights[tileBase] = lightCount;
+        if (gsLightCount > LIGHT_CULLING_MAX_LIGHTS_PER_TILE) {
+            InterlockedAdd(CullingStats[LIGHT_CULLING_STATS_OVERFLOW_TILE_COUNT_INDEX], 1);
+            InterlockedAdd(CullingStats[LIGHT_CULLING_STATS_DROPPED_LIGHT_COUNT_INDEX], gsLightCount - LIGHT_CULLING_MAX_LIGHTS_PER_TILE);
+        }
+    }
+    for (uint i = groupIndex; i < lightCount; i += GROUP_THREAD_COUNT) {
+        TileLights[tileBase + 1 + i] = gsLightIndices[i];
+    }
+}
@@ -18,19 +18,19 @@ struct TransformData
 };
 
 ConstantBuffer<TransformData> Transform : register(b0);
-Texture2D                     Tex0      : register(t1);
+TextureCube                   Tex0      : register(t1);
 SamplerState                  Sampler0  : register(s2);
 
 struct VSOutput {
-	float4 Position : SV_POSITION;
-	float2 TexCoord : TEXCOORD;
+	float4 Position  : SV_POSITION;
+	float3 Direction : TEXCOORD;
 };
 
 VSOutput vsmain(float4 Position : POSITION, float2 TexCoord : TEXCOORD0)
 {
 	VSOutput result;
-	result.Position = mul(Transform.M, Position);
-	result.TexCoord = TexCoord;
+	result.Position  = mul(Transform.M, Position);
+	result.Direction = Position.xyz;
 	return result;
 }
 
@@ -43,7 +43,7 @@ float3 ACESFilm(float3 x){
 
 float4 psmain(VSOutput input) : SV_TARGET
 {   
-    float3 color = Tex0.Sample(Sampler0, input.TexCoord, 0).rgb;
+    float3 color = Tex0.SampleLevel(Sampler0, input.Direction, 0).rgb;
     color = ACESFilm(color);
     color = pow(color, 1 / 2.2);
     return float4(color, 1);    
@@ -25,8 +25,8 @@ Texture2D    AlbedoTex      : register(ALBEDO_TEXTURE_REGISTER,     MATERIAL_RES
 Texture2D    RoughnessTex   : register(ROUGHNESS_TEXTURE_REGISTER,  MATERIAL_RESOURCES_SPACE);
 Texture2D    MetalnessTex   : register(METALNESS_TEXTURE_REGISTER,  MATERIAL_RESOURCES_SPACE);
 Texture2D    NormalMapTex   : register(NORMAL_MAP_TEXTURE_REGISTER, MATERIAL_RESOURCES_SPACE);
-Texture2D    IrrMapTex      : register(IRR_MAP_TEXTURE_REGISTER,    MATERIAL_RESOURCES_SPACE);
-Texture2D    EnvMapTex      : register(ENV_MAP_TEXTURE_REGISTER,    MATERIAL_RESOURCES_SPACE);
+TextureCube  IrrMapTex      : register(IRR_MAP_TEXTURE_REGISTER,    MATERIAL_RESOURCES_SPACE);
+TextureCube  EnvMapTex      : register(ENV_MAP_TEXTURE_REGISTER,    MATERIAL_RESOURCES_SPACE);
 Texture2D    BRDFLUTTex     : register(BRDF_LUT_TEXTURE_REGISTER,   MATERIAL_RESOURCES_SPACE);
 SamplerState ClampedSampler : register(CLAMPED_SAMPLER_REGISTER,    MATERIAL_RESOURCES_SPACE);
 
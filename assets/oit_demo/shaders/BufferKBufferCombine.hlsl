@@ -0,0 +1,61 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define IS_SHADER
+#include "Common.hlsli"
+#include "FullscreenVS.hlsli"
+
+Texture2D                TailTexture  : register(CUSTOM_TEXTURE_0_REGISTER);
+RWTexture2D<uint>        DepthTexture : register(CUSTOM_UAV_0_REGISTER);
+RWTexture2D<uint>        ColorTexture : register(CUSTOM_UAV_1_REGISTER);
+RWStructuredBuffer<uint> StatsBuffer  : register(CUSTOM_UAV_2_REGISTER);
+
+float4 psmain(VSOutput input) : SV_TARGET
+{
+    // Reset the counters for the next frame, they were copied after the gather
+    StatsBuffer[BUFFER_STATS_FRAGMENT_COUNT_INDEX] = 0U;
+    StatsBuffer[BUFFER_STATS_OVERFLOW_COUNT_INDEX] = 0U;
+
+    float4 color = float4(0.0f, 0.0f, 0.0f, 1.0f);
+
+    // Start with the tail: its fragments share the mesh opacity, so their
+    // coverage is exact and only their order is approximated.
+    {
+        const float4 tail = TailTexture.Load(int3(input.position.xy, 0));
+        if(tail.a > 0.0f)
+        {
+            const float tailCoverage = 1.0f - pow(max(0.0f, 1.0f - g_Globals.meshOpacity), tail.a);
+            MergeColor(color, float4(tail.rgb / tail.a, tailCoverage));
+        }
+    }
+
+    // Merge the stored layers back to front, and reset them for the next frame
+    uint2 layerIndex = (uint2)input.position.xy;
+    layerIndex.y *= BUFFER_K_BUFFER_SIZE_PER_PIXEL;
+    layerIndex.y += BUFFER_K_BUFFER_SIZE_PER_PIXEL - 1;
+    for(int i = BUFFER_K_BUFFER_SIZE_PER_PIXEL - 1; i >= 0; --i)
+    {
+        const uint layerColor = ColorTexture[layerIndex];
+        if(layerColor != BUFFER_K_BUFFER_EMPTY_COLOR)
+        {
+            MergeColor(color, UnpackColor(layerColor));
+        }
+        DepthTexture[layerIndex] = BUFFER_K_BUFFER_EMPTY_DEPTH;
+        ColorTexture[layerIndex] = BUFFER_K_BUFFER_EMPTY_COLOR;
+        layerIndex.y -= 1U;
+    }
+
+    color.a = 1.0f - color.a;
+    return color;
+}
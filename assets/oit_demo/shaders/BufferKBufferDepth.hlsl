@@ -0,0 +1,45 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define IS_SHADER
+#include "Common.hlsli"
+#include "TransparencyVS.hlsli"
+
+Texture2D         OpaqueDepthTexture : register(CUSTOM_TEXTURE_0_REGISTER);
+RWTexture2D<uint> DepthTexture       : register(CUSTOM_UAV_0_REGISTER);
+
+void psmain(VSOutput input)
+{
+    // Test fragment against opaque depth
+    {
+        const float opaqueDepth = OpaqueDepthTexture.Load(int3(input.position.xy, 0)).r;
+        clip(input.position.z < opaqueDepth ? 1.0f : -1.0f);
+    }
+
+    // Insert the depth in the sorted layers of the pixel (front to back).
+    // Each layer keeps the nearest of its depth and the incoming one, the
+    // other moves on to the next layer, so the layers end up holding the
+    // nearest depths of the pixel whatever the fragment order.
+    const int layersCount = min(g_Globals.bufferKBufferLayersCount, BUFFER_K_BUFFER_SIZE_PER_PIXEL);
+    uint2     layerIndex  = (uint2)input.position.xy;
+    layerIndex.y *= BUFFER_K_BUFFER_SIZE_PER_PIXEL;
+    uint depth = asuint(input.position.z);
+    for(int i = 0; i < layersCount && depth != BUFFER_K_BUFFER_EMPTY_DEPTH; ++i)
+    {
+        uint previousDepth = 0;
+        InterlockedMin(DepthTexture[layerIndex], depth, previousDepth);
+        depth = max(depth, previousDepth);
+        layerIndex.y += 1U;
+    }
+}
@@ -0,0 +1,64 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define IS_SHADER
+#include "Common.hlsli"
+#include "TransparencyVS.hlsli"
+
+Texture2D                OpaqueDepthTexture : register(CUSTOM_TEXTURE_0_REGISTER);
+RWTexture2D<uint>        DepthTexture       : register(CUSTOM_UAV_0_REGISTER);
+RWTexture2D<uint>        ColorTexture       : register(CUSTOM_UAV_1_REGISTER);
+RWStructuredBuffer<uint> StatsBuffer        : register(CUSTOM_UAV_2_REGISTER);
+
+float4 psmain(VSOutput input) : SV_TARGET
+{
+    // Test fragment against opaque depth
+    {
+        const float opaqueDepth = OpaqueDepthTexture.Load(int3(input.position.xy, 0)).r;
+        clip(input.position.z < opaqueDepth ? 1.0f : -1.0f);
+    }
+
+    InterlockedAdd(StatsBuffer[BUFFER_STATS_FRAGMENT_COUNT_INDEX], 1U);
+
+    // Store the color in the layer that kept the fragment depth. Fragments
+    // with equal depths share layers, the first free one is taken.
+    const uint depth      = asuint(input.position.z);
+    const uint color      = PackColor(float4(input.color, g_Globals.meshOpacity));
+    const int layersCount = min(g_Globals.bufferKBufferLayersCount, BUFFER_K_BUFFER_SIZE_PER_PIXEL);
+    uint2      layerIndex = (uint2)input.position.xy;
+    layerIndex.y *= BUFFER_K_BUFFER_SIZE_PER_PIXEL;
+    for(int i = 0; i < layersCount; ++i)
+    {
+        const uint layerDepth = DepthTexture[layerIndex];
+        if(layerDepth > depth)
+        {
+            break;
+        }
+        if(layerDepth == depth)
+        {
+            uint previousColor = 0;
+            InterlockedCompareExchange(ColorTexture[layerIndex], BUFFER_K_BUFFER_EMPTY_COLOR, color, previousColor);
+            if(previousColor == BUFFER_K_BUFFER_EMPTY_COLOR)
+            {
+                return (float4)0.0f;
+            }
+        }
+        layerIndex.y += 1U;
+    }
+
+    // The fragment is behind the stored layers: add it to the tail, which is
+    // blended as a weighted average behind them. Alpha counts the fragments.
+    InterlockedAdd(StatsBuffer[BUFFER_STATS_OVERFLOW_COUNT_INDEX], 1U);
+    return float4(input.color, 1.0f);
+}
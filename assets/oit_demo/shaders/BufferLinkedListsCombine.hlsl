@@ -22,8 +22,9 @@ RWStructuredBuffer<uint>  AtomicCounter         : register(CUSTOM_UAV_2_REGISTER
 
 float4 psmain(VSOutput input) : SV_TARGET
 {
-    // Reset the atomic counter for the next frame
-    AtomicCounter[0] = 0;
+    // Reset the atomic counters for the next frame, they were copied after the gather
+    AtomicCounter[BUFFER_STATS_FRAGMENT_COUNT_INDEX] = 0;
+    AtomicCounter[BUFFER_STATS_OVERFLOW_COUNT_INDEX] = 0;
 
     // Get the first fragment index in the linked list
     uint fragmentIndex = LinkedListHeadTexture[input.position.xy];
@@ -29,9 +29,9 @@ void psmain(VSOutput input)
         clip(input.position.z < opaqueDepth ? 1.0f : -1.0f);
     }
 
-    // Find the next fragment index
+    // Find the next fragment index, the counter also counts the fragments
     uint nextFragmentIndex = 0;
-    InterlockedAdd(AtomicCounter[0], 1U, nextFragmentIndex);
+    InterlockedAdd(AtomicCounter[BUFFER_STATS_FRAGMENT_COUNT_INDEX], 1U, nextFragmentIndex);
 
     // Ignore the fragment if the fragment buffer is full
     uint fragmentBufferMaxElementCount = 0;
@@ -40,6 +40,7 @@ void psmain(VSOutput input)
     const uint fragmentBufferElementCount = min((fragmentBufferMaxElementCount / BUFFER_LISTS_FRAGMENT_BUFFER_MAX_SCALE) * g_Globals.bufferListsFragmentBufferScale, fragmentBufferMaxElementCount);
     if(nextFragmentIndex >= fragmentBufferElementCount)
     {
+        InterlockedAdd(AtomicCounter[BUFFER_STATS_OVERFLOW_COUNT_INDEX], 1U);
         clip(-1.0f);
     }
 
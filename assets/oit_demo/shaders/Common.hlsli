@@ -38,6 +38,8 @@
 
 #define DEPTH_PEELING_LAYERS_COUNT              8
 #define DEPTH_PEELING_DEPTH_TEXTURES_COUNT      2
+#define DEPTH_PEELING_DUAL_PASSES_COUNT         (DEPTH_PEELING_LAYERS_COUNT / 2)
+#define DEPTH_PEELING_DUAL_EMPTY_DEPTH          -1.0f
 
 #define BUFFER_BUCKETS_SIZE_PER_PIXEL           8
 
@@ -45,6 +47,15 @@
 #define BUFFER_LISTS_SORTED_FRAGMENT_MAX_COUNT  64
 #define BUFFER_LISTS_INVALID_INDEX              0xFFFFFFFFU
 
+#define BUFFER_K_BUFFER_SIZE_PER_PIXEL          8
+#define BUFFER_K_BUFFER_EMPTY_DEPTH             0xFFFFFFFFU
+#define BUFFER_K_BUFFER_EMPTY_COLOR             0U
+
+// Fragment counters written by the buffer algorithms and read back by the sample
+#define BUFFER_STATS_FRAGMENT_COUNT_INDEX       0
+#define BUFFER_STATS_OVERFLOW_COUNT_INDEX       1
+#define BUFFER_STATS_COUNT                      2
+
 struct ShaderGlobals
 {
     float4x4 backgroundMVP;
@@ -61,9 +72,9 @@ struct ShaderGlobals
     int      bufferBucketsFragmentsMaxCount;
     int      bufferListsFragmentBufferScale;
     int      bufferListsSortedFragmentMaxCount;
-    int      _intUnused0;
-    int      _intUnused1;
-    int      _intUnused2;
+    int      bufferKBufferLayersCount;
+    int      depthPeelingFrontLayersCount;
+    int      depthPeelingBackLayersCount;
 };
 
 #if defined(IS_SHADER)
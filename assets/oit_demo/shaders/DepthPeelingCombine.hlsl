@@ -24,7 +24,12 @@ float4 psmain(VSOutput input) : SV_TARGET
     float4 color = float4(0.0f, 0.0f, 0.0f, 1.0f);
     for(int i = g_Globals.depthPeelingBackLayerIndex; i >= g_Globals.depthPeelingFrontLayerIndex; --i)
     {
-        MergeColor(color, LayerTextures[i].Sample(NearestSampler, input.uv));
+        // Front layers fill the textures from the start, dual peeling back
+        // layers from the end. The others were not peeled this frame.
+        if(i < g_Globals.depthPeelingFrontLayersCount || i >= DEPTH_PEELING_LAYERS_COUNT - g_Globals.depthPeelingBackLayersCount)
+        {
+            MergeColor(color, LayerTextures[i].Sample(NearestSampler, input.uv));
+        }
     }
     color.a = 1.0f - color.a;
     return color;
@@ -0,0 +1,61 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "DepthPeelingDual.hlsli"
+
+Texture2D PreviousDepthTexture : register(CUSTOM_TEXTURE_1_REGISTER);
+
+struct PSOutput
+{
+    float4 depth : SV_TARGET0;
+    float4 front : SV_TARGET1;
+    float4 back  : SV_TARGET2;
+};
+
+// Extracts the nearest fragment to the front layer, the farthest one to the
+// back layer, and writes the depth of the others for the next pass
+PSOutput psmain(VSOutput input)
+{
+    const float2 uv = TestOpaqueDepth(input);
+
+    // Fragments outside of the range were peeled by the previous passes
+    const float2 previousDepth = PreviousDepthTexture.Sample(NearestSampler, uv).rg;
+    const float  nearestDepth  = -previousDepth.r;
+    const float  farthestDepth = previousDepth.g;
+    const float  depth         = input.position.z;
+    clip(depth >= nearestDepth && depth <= farthestDepth ? 1.0f : -1.0f);
+
+    // Outputs are neutral for the MAX blending unless written below
+    PSOutput output;
+    output.depth = float4(DEPTH_PEELING_DUAL_EMPTY_DEPTH, DEPTH_PEELING_DUAL_EMPTY_DEPTH, 0.0f, 0.0f);
+    output.front = (float4)0.0f;
+    output.back  = (float4)0.0f;
+
+    // The front layer wins when a single fragment is left
+    const float4 color = float4(input.color, g_Globals.meshOpacity);
+    if(depth == nearestDepth)
+    {
+        output.front = color;
+    }
+    else if(depth == farthestDepth)
+    {
+        output.back = color;
+    }
+    else
+    {
+        output.depth = float4(-depth, depth, 0.0f, 0.0f);
+    }
+    return output;
+}
@@ -58,6 +58,13 @@ private:
     ppx::grfx::PipelineInterfacePtr mPipelineInterface;
     ppx::grfx::GraphicsPipelinePtr  mPipeline;
     ppx::grfx::BufferPtr            mVertexBuffer;
+    grfx::DescriptorPoolPtr         mDescriptorPool;
+    grfx::ShaderModulePtr           mArgsCS;
+    grfx::DescriptorSetLayoutPtr    mArgsDescriptorSetLayout;
+    grfx::DescriptorSetPtr          mArgsDescriptorSet;
+    grfx::PipelineInterfacePtr      mArgsPipelineInterface;
+    grfx::ComputePipelinePtr        mArgsPipeline;
+    grfx::BufferPtr                 mIndirectArgsBuffer;
     grfx::Viewport                  mViewport;
     grfx::Rect                      mScissorRect;
     grfx::VertexBinding             mVertexBinding;
@@ -66,6 +73,7 @@ private:
     // Options
     uint32_t mNumTriangles;
     bool     mUseInstancedDraw;
+    bool     mUseIndirectDraw;
 
     // Stats
     uint64_t                 mGpuWorkDuration    = 0;
@@ -78,6 +86,8 @@ private:
         float    cpuFrameTime;
     };
     std::deque<PerFrameRegister> mFrameRegisters;
+
+    void SetupIndirectArgs();
 };
 
 void ProjApp::Config(ppx::ApplicationSettings& settings)
@@ -114,6 +124,14 @@ void ProjApp::Setup()
     // Whether to make an instanced call for all triangles or use separate draw calls.
     mUseInstancedDraw = cl_options.GetExtraOptionValueOrDefault<bool>("instanced-draw", false);
 
+    // Whether to issue all triangles as a single multi-draw indirect call whose
+    // arguments are written every frame by a compute shader.
+    mUseIndirectDraw = cl_options.GetExtraOptionValueOrDefault<bool>("indirect-draw", false);
+    if (mUseInstancedDraw && mUseIndirectDraw) {
+        mUseIndirectDraw = false;
+        PPX_LOG_WARN("instanced-draw and indirect-draw are mutually exclusive, using instanced-draw");
+    }
+
     // Name of the CSV output file
     mCSVFileName = cl_options.GetExtraOptionValueOrDefault<std::string>("stats-file", "stats.csv");
     if (mCSVFileName.empty()) {
@@ -218,6 +236,68 @@ void ProjApp::Setup()
         gpCreateInfo.pPipelineInterface                 = mPipelineInterface;
         PPX_CHECKED_CALL(GetDevice()->CreateGraphicsPipeline(&gpCreateInfo, &mPipeline));
     }
+
+    if (mUseIndirectDraw) {
+        SetupIndirectArgs();
+    }
+}
+
+void ProjApp::SetupIndirectArgs()
+{
+    // Argument buffer: written by compute, consumed by DrawIndirect
+    {
+        grfx::BufferCreateInfo bufferCreateInfo           = {};
+        bufferCreateInfo.size                             = mNumTriangles * sizeof(grfx::DrawIndirectCommand);
+        bufferCreateInfo.usageFlags.bits.rawStorageBuffer = true;
+        bufferCreateInfo.usageFlags.bits.indirectBuffer   = true;
+        bufferCreateInfo.memoryUsage                      = grfx::MEMORY_USAGE_GPU_ONLY;
+        bufferCreateInfo.initialState                     = grfx::RESOURCE_STATE_INDIRECT_ARGUMENT;
+        PPX_CHECKED_CALL(GetDevice()->CreateBuffer(&bufferCreateInfo, &mIndirectArgsBuffer));
+    }
+
+    // Descriptors
+    {
+        grfx::DescriptorPoolCreateInfo poolCreateInfo = {};
+        poolCreateInfo.rawStorageBuffer               = 1;
+        PPX_CHECKED_CALL(GetDevice()->CreateDescriptorPool(&poolCreateInfo, &mDescriptorPool));
+
+        grfx::DescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding(0, grfx::DESCRIPTOR_TYPE_RAW_STORAGE_BUFFER));
+        PPX_CHECKED_CALL(GetDevice()->CreateDescriptorSetLayout(&layoutCreateInfo, &mArgsDescriptorSetLayout));
+
+        PPX_CHECKED_CALL(GetDevice()->AllocateDescriptorSet(mDescriptorPool, mArgsDescriptorSetLayout, &mArgsDescriptorSet));
+
+        grfx::WriteDescriptor write = {};
+        write.binding               = 0;
+        write.type                  = grfx::DESCRIPTOR_TYPE_RAW_STORAGE_BUFFER;
+        write.bufferOffset          = 0;
+        write.bufferRange           = PPX_WHOLE_SIZE;
+        write.pBuffer               = mIndirectArgsBuffer;
+        PPX_CHECKED_CALL(mArgsDescriptorSet->UpdateDescriptors(1, &write));
+    }
+
+    // Compute pipeline
+    {
+        std::vector<char> bytecode = LoadShader("benchmarks/shaders", "DrawCallIndirectArgs.cs");
+        PPX_ASSERT_MSG(!bytecode.empty(), "CS shader bytecode load failed");
+        grfx::ShaderModuleCreateInfo shaderCreateInfo = {static_cast<uint32_t>(bytecode.size()), bytecode.data()};
+        PPX_CHECKED_CALL(GetDevice()->CreateShaderModule(&shaderCreateInfo, &mArgsCS));
+
+        grfx::PipelineInterfaceCreateInfo piCreateInfo = {};
+        piCreateInfo.setCount                          = 1;
+        piCreateInfo.sets[0].set                       = 0;
+        piCreateInfo.sets[0].pLayout                   = mArgsDescriptorSetLayout;
+        PPX_CHECKED_CALL(GetDevice()->CreatePipelineInterface(&piCreateInfo, &mArgsPipelineInterface));
+
+        grfx::ComputePipelineCreateInfo cpCreateInfo = {};
+        cpCreateInfo.CS                              = {mArgsCS.Get(), "csmain"};
+        cpCreateInfo.pPipelineInterface              = mArgsPipelineInterface;
+        PPX_CHECKED_CALL(GetDevice()->CreateComputePipeline(&cpCreateInfo, &mArgsPipeline));
+    }
+
+    if (!GetDevice()->MultiDrawIndirectSupported()) {
+        PPX_LOG_WARN("Multi draw indirect is not supported, indirect draws will be issued one at a time");
+    }
 }
 
 void ProjApp::Render()
@@ -253,6 +333,15 @@ void ProjApp::Render()
         frame.cmd->SetScissors(renderPass->GetScissor());
         frame.cmd->SetViewports(renderPass->GetViewport());
 
+        // Generate draw arguments on the GPU
+        if (mUseIndirectDraw) {
+            frame.cmd->BufferResourceBarrier(mIndirectArgsBuffer, grfx::RESOURCE_STATE_INDIRECT_ARGUMENT, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+            frame.cmd->BindComputeDescriptorSets(mArgsPipelineInterface, 1, &mArgsDescriptorSet);
+            frame.cmd->BindComputePipeline(mArgsPipeline);
+            frame.cmd->Dispatch((mNumTriangles + 63) / 64, 1, 1);
+            frame.cmd->BufferResourceBarrier(mIndirectArgsBuffer, grfx::RESOURCE_STATE_UNORDERED_ACCESS, grfx::RESOURCE_STATE_INDIRECT_ARGUMENT);
+        }
+
         frame.cmd->TransitionImageLayout(renderPass->GetRenderTargetImage(0), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_PRESENT, grfx::RESOURCE_STATE_RENDER_TARGET);
         frame.cmd->BeginRenderPass(renderPass);
         {
@@ -264,6 +353,9 @@ void ProjApp::Render()
             if (mUseInstancedDraw) {
                 frame.cmd->Draw(3, mNumTriangles, 0, 0);
             }
+            else if (mUseIndirectDraw) {
+                frame.cmd->DrawIndirect(mIndirectArgsBuffer, 0, mNumTriangles);
+            }
             else {
                 for (uint32_t i = 0; i < mNumTriangles; ++i) {
                     frame.cmd->Draw(3, 1, 0, 0);
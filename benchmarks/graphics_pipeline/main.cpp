@@ -100,6 +100,29 @@ static constexpr std::array<const char*, 2> kAvailableVertexAttrLayouts = {
     "Interleaved",
     "Position_Planar"};
 
+static constexpr std::array<const char*, 3> kAvailableSceneSizes = {
+    "Small",
+    "Medium",
+    "Large"};
+
+// Distance between neighbouring spheres for each scene size
+static constexpr std::array<float, 3> kSceneSizeGridSteps = {
+    10.0f,
+    20.0f,
+    40.0f};
+
+// Half of the culling bounds extent of a unit sphere, slightly larger than the
+// radius to account for half float positions.
+static constexpr float kSphereBoundsRadius = 1.25f;
+
+static constexpr std::array<const char*, 3> kAvailableCullingModes = {
+    "None",
+    "Frustum",
+    "Frustum_HiZ"};
+
+static constexpr size_t kCullingModeNone       = 0;
+static constexpr size_t kCullingModeFrustumHiZ = 2;
+
 static constexpr uint32_t kPipelineCount = kAvailablePsShaders.size() * kAvailableVsShaders.size() * kAvailableVbFormats.size() * kAvailableVertexAttrLayouts.size();
 
 static constexpr uint32_t kMeshCount = kAvailableVbFormats.size() * kAvailableVertexAttrLayouts.size();
@@ -184,6 +207,13 @@ private:
     std::array<grfx::ShaderModulePtr, kAvailablePsShaders.size()> mPsShaders;
     std::array<grfx::MeshPtr, kMeshCount>                         mSphereMeshes;
     uint32_t                                                      mSphereIndexCount;
+    std::vector<AABB>                                             mSphereBounds;
+    std::vector<grfx::DrawIndexedIndirectCommand>                 mSphereDraws;
+    grfx::ShaderModulePtr                                         mCullCS;
+    grfx::ShaderModulePtr                                         mCullHiZCS;
+    grfx::CullPassPtr                                             mCullPass;
+    std::vector<grfx::SampledImageViewPtr>                        mDepthViews;
+    uint32_t                                                      mCullInstanceCount = 0;
 
 private:
     std::shared_ptr<KnobDropdown<std::string>> pKnobVs;
@@ -195,6 +225,8 @@ private:
     std::shared_ptr<KnobSlider<int>>           pNoiseQuadsCount;
     std::shared_ptr<KnobCheckbox>              pAlphaBlend;
     std::shared_ptr<KnobCheckbox>              pDepthTestWrite;
+    std::shared_ptr<KnobDropdown<std::string>> pSceneSize;
+    std::shared_ptr<KnobDropdown<std::string>> pCullingMode;
 
 private:
     void ProcessInput();
@@ -207,6 +239,10 @@ private:
 
     void CreateSpherePipelines();
 
+    void CreateSphereMeshes();
+
+    void SetupCulling();
+
     void SetupNoiseQuads();
 };
 
@@ -306,6 +342,14 @@ void ProjApp::InitKnobs()
     pDepthTestWrite = GetKnobManager().CreateKnob<ppx::KnobCheckbox>("depth-test-write", true);
     pDepthTestWrite->SetDisplayName("Depth Test & Write");
     pDepthTestWrite->SetFlagDescription("Enable depth test and depth write for spheres (Default: enabled).");
+
+    pSceneSize = GetKnobManager().CreateKnob<ppx::KnobDropdown<std::string>>("scene-size", 0, kAvailableSceneSizes);
+    pSceneSize->SetDisplayName("Scene Size");
+    pSceneSize->SetFlagDescription("Select the spacing of the sphere grid. Larger scenes leave more spheres outside of the view.");
+
+    pCullingMode = GetKnobManager().CreateKnob<ppx::KnobDropdown<std::string>>("culling", 0, kAvailableCullingModes);
+    pCullingMode->SetDisplayName("GPU Culling");
+    pCullingMode->SetFlagDescription("Select GPU culling of spheres. When enabled spheres are drawn with one indirect draw per sphere and `drawcall-count` is ignored.");
 }
 
 void ProjApp::Config(ppx::ApplicationSettings& settings)
@@ -336,6 +380,137 @@ int8_t MapFloatToInt8(float x)
     return static_cast<int8_t>((x + 1.0f) * 127.5f - 128.0f);
 }
 
+void ProjApp::CreateSphereMeshes()
+{
+    // 3D grid
+    Grid grid;
+    grid.xSize = static_cast<uint32_t>(std::cbrt(kMaxSphereInstanceCount));
+    grid.ySize = grid.xSize;
+    grid.zSize = static_cast<uint32_t>(std::ceil(kMaxSphereInstanceCount / static_cast<float>(grid.xSize * grid.ySize)));
+    grid.step  = kSceneSizeGridSteps[pSceneSize->GetIndex()];
+
+    // Get sphere indices
+    std::vector<uint32_t> sphereIndices(kMaxSphereInstanceCount);
+    std::iota(sphereIndices.begin(), sphereIndices.end(), 0);
+    // Shuffle using the `mersenne_twister` deterministic random number generator to obtain
+    // the same sphere indices for a given `kMaxSphereInstanceCount`.
+    Shuffle(sphereIndices.begin(), sphereIndices.end(), std::mt19937(kSeed));
+
+    TriMesh mesh                     = TriMesh::CreateSphere(/* radius = */ 1, /* longitudeSegments = */ 10, /* latitudeSegments = */ 10, TriMeshOptions().Indices().TexCoords().Normals().Tangents());
+    mSphereIndexCount                = mesh.GetCountIndices();
+    const uint32_t sphereVertexCount = mesh.GetCountPositions();
+    const uint32_t sphereTriCount    = mesh.GetCountTriangles();
+
+    mSphereBounds.resize(kMaxSphereInstanceCount);
+    mSphereDraws.resize(kMaxSphereInstanceCount);
+
+    Geometry lowPrecisionInterleaved;
+    PPX_CHECKED_CALL(Geometry::Create(GeometryOptions::InterleavedU32(grfx::FORMAT_R16G16B16_FLOAT).AddTexCoord(grfx::FORMAT_R16G16_FLOAT).AddNormal(grfx::FORMAT_R8G8B8A8_SNORM).AddTangent(grfx::FORMAT_R8G8B8A8_SNORM), &lowPrecisionInterleaved));
+
+    Geometry lowPrecisionPositionPlanar;
+    PPX_CHECKED_CALL(Geometry::Create(GeometryOptions::PositionPlanarU32(grfx::FORMAT_R16G16B16_FLOAT).AddTexCoord(grfx::FORMAT_R16G16_FLOAT).AddNormal(grfx::FORMAT_R8G8B8A8_SNORM).AddTangent(grfx::FORMAT_R8G8B8A8_SNORM), &lowPrecisionPositionPlanar));
+
+    Geometry highPrecisionInterleaved;
+    PPX_CHECKED_CALL(Geometry::Create(GeometryOptions::InterleavedU32().AddTexCoord().AddNormal().AddTangent(), &highPrecisionInterleaved));
+
+    Geometry highPrecisionPositionPlanar;
+    PPX_CHECKED_CALL(Geometry::Create(GeometryOptions::PositionPlanarU32().AddTexCoord().AddNormal().AddTangent(), &highPrecisionPositionPlanar));
+
+    for (uint32_t i = 0; i < kMaxSphereInstanceCount; i++) {
+        uint32_t index = sphereIndices[i];
+        uint32_t x     = (index % (grid.xSize * grid.ySize)) / grid.ySize;
+        uint32_t y     = index % grid.ySize;
+        uint32_t z     = index / (grid.xSize * grid.ySize);
+
+        // Model matrix to be applied to the sphere mesh
+        const float3 center      = float3(x * grid.step, y * grid.step, z * grid.step);
+        float4x4     modelMatrix = glm::translate(center);
+
+        // Bounds and draw arguments of the sphere for GPU culling, padded to
+        // cover the rounding of low precision positions.
+        mSphereBounds[i] = AABB(center - float3(kSphereBoundsRadius), center + float3(kSphereBoundsRadius));
+        mSphereDraws[i]  = {mSphereIndexCount, 1, i * mSphereIndexCount, 0, 0};
+
+        // Copy a sphere mesh to create a giant vertex buffer
+        // Iterate through the meshes vertx data and add it to the geometry
+        for (uint32_t vertexIndex = 0; vertexIndex < sphereVertexCount; ++vertexIndex) {
+            TriMeshVertexData vertexData = {};
+            mesh.GetVertexData(vertexIndex, &vertexData);
+            vertexData.position = modelMatrix * float4(vertexData.position, 1);
+
+            TriMeshVertexDataCompressed vertexDataCompressed;
+            vertexDataCompressed.position = half3(glm::packHalf1x16(vertexData.position.x), glm::packHalf1x16(vertexData.position.y), glm::packHalf1x16(vertexData.position.z));
+            vertexDataCompressed.texCoord = half2(glm::packHalf1x16(vertexData.texCoord.x), glm::packHalf1x16(vertexData.texCoord.y));
+            vertexDataCompressed.normal   = i8vec4(MapFloatToInt8(vertexData.normal.x), MapFloatToInt8(vertexData.normal.y), MapFloatToInt8(vertexData.normal.z), MapFloatToInt8(1.0f));
+            vertexDataCompressed.tangent  = i8vec4(MapFloatToInt8(vertexData.tangent.x), MapFloatToInt8(vertexData.tangent.y), MapFloatToInt8(vertexData.tangent.z), MapFloatToInt8(vertexData.tangent.a));
+            lowPrecisionInterleaved.AppendVertexData(vertexDataCompressed);
+            lowPrecisionPositionPlanar.AppendVertexData(vertexDataCompressed);
+
+            highPrecisionInterleaved.AppendVertexData(vertexData);
+            highPrecisionPositionPlanar.AppendVertexData(vertexData);
+        }
+        // Iterate the meshes triangles and add the vertex indices
+        for (uint32_t triIndex = 0; triIndex < sphereTriCount; ++triIndex) {
+            uint32_t v0 = PPX_VALUE_IGNORED;
+            uint32_t v1 = PPX_VALUE_IGNORED;
+            uint32_t v2 = PPX_VALUE_IGNORED;
+            mesh.GetTriangle(triIndex, v0, v1, v2);
+            lowPrecisionInterleaved.AppendIndicesTriangle(v0 + i * sphereVertexCount, v1 + i * sphereVertexCount, v2 + i * sphereVertexCount);
+            lowPrecisionPositionPlanar.AppendIndicesTriangle(v0 + i * sphereVertexCount, v1 + i * sphereVertexCount, v2 + i * sphereVertexCount);
+            highPrecisionInterleaved.AppendIndicesTriangle(v0 + i * sphereVertexCount, v1 + i * sphereVertexCount, v2 + i * sphereVertexCount);
+            highPrecisionPositionPlanar.AppendIndicesTriangle(v0 + i * sphereVertexCount, v1 + i * sphereVertexCount, v2 + i * sphereVertexCount);
+        }
+    }
+
+    // Release the meshes of the previous scene size
+    for (grfx::MeshPtr& sphereMesh : mSphereMeshes) {
+        if (!sphereMesh.IsNull()) {
+            GetDevice()->DestroyMesh(sphereMesh);
+            sphereMesh.Reset();
+        }
+    }
+
+    // Create a giant vertex buffer to accommodate all copies of the sphere mesh
+    const uint32_t lowPrecisionInterleavedIndex = 0;
+    PPX_CHECKED_CALL(grfx_util::CreateMeshFromGeometry(GetGraphicsQueue(), &lowPrecisionInterleaved, &mSphereMeshes[lowPrecisionInterleavedIndex]));
+    const uint32_t lowPrecisionPositionPlanarIndex = 1;
+    PPX_CHECKED_CALL(grfx_util::CreateMeshFromGeometry(GetGraphicsQueue(), &lowPrecisionPositionPlanar, &mSphereMeshes[lowPrecisionPositionPlanarIndex]));
+    const uint32_t highPrecisionInterleavedIndex = 2;
+    PPX_CHECKED_CALL(grfx_util::CreateMeshFromGeometry(GetGraphicsQueue(), &highPrecisionInterleaved, &mSphereMeshes[highPrecisionInterleavedIndex]));
+    const uint32_t highPrecisionPositionPlanarIndex = 3;
+    PPX_CHECKED_CALL(grfx_util::CreateMeshFromGeometry(GetGraphicsQueue(), &highPrecisionPositionPlanar, &mSphereMeshes[highPrecisionPositionPlanarIndex]));
+}
+
+void ProjApp::SetupCulling()
+{
+    std::vector<char> bytecode = LoadShader("basic/shaders", "CullPass.cs");
+    PPX_ASSERT_MSG(!bytecode.empty(), "CS shader bytecode load failed");
+    grfx::ShaderModuleCreateInfo shaderCreateInfo = {static_cast<uint32_t>(bytecode.size()), bytecode.data()};
+    PPX_CHECKED_CALL(GetDevice()->CreateShaderModule(&shaderCreateInfo, &mCullCS));
+
+    bytecode = LoadShader("basic/shaders", "CullPassHiZ.cs");
+    PPX_ASSERT_MSG(!bytecode.empty(), "CS shader bytecode load failed");
+    shaderCreateInfo = {static_cast<uint32_t>(bytecode.size()), bytecode.data()};
+    PPX_CHECKED_CALL(GetDevice()->CreateShaderModule(&shaderCreateInfo, &mCullHiZCS));
+
+    // Sampled views of the swapchain depth images for building the Hi-Z pyramid
+    grfx::SwapchainPtr swapchain = GetSwapchain();
+    mDepthViews.resize(swapchain->GetImageCount());
+    for (uint32_t i = 0; i < swapchain->GetImageCount(); ++i) {
+        grfx::SampledImageViewCreateInfo viewCreateInfo = grfx::SampledImageViewCreateInfo::GuessFromImage(swapchain->GetDepthImage(i));
+        PPX_CHECKED_CALL(GetDevice()->CreateSampledImageView(&viewCreateInfo, &mDepthViews[i]));
+    }
+
+    grfx::CullPassCreateInfo createInfo = {};
+    createInfo.CS                       = {mCullCS, "csmain"};
+    createInfo.HiZCS                    = {mCullHiZCS, "csmain"};
+    createInfo.maxInstanceCount         = kMaxSphereInstanceCount;
+    createInfo.depthWidth               = swapchain->GetWidth();
+    createInfo.depthHeight              = swapchain->GetHeight();
+    createInfo.maxDepthViewCount        = swapchain->GetImageCount();
+    PPX_CHECKED_CALL(GetDevice()->CreateCullPass(&createInfo, &mCullPass));
+}
+
 void ProjApp::Setup()
 {
     // Cameras
@@ -419,87 +594,10 @@ void ProjApp::Setup()
     }
 
     // Meshes for sphere instances
-    {
-        // 3D grid
-        Grid grid;
-        grid.xSize = static_cast<uint32_t>(std::cbrt(kMaxSphereInstanceCount));
-        grid.ySize = grid.xSize;
-        grid.zSize = static_cast<uint32_t>(std::ceil(kMaxSphereInstanceCount / static_cast<float>(grid.xSize * grid.ySize)));
-        grid.step  = 10.0f;
-
-        // Get sphere indices
-        std::vector<uint32_t> sphereIndices(kMaxSphereInstanceCount);
-        std::iota(sphereIndices.begin(), sphereIndices.end(), 0);
-        // Shuffle using the `mersenne_twister` deterministic random number generator to obtain
-        // the same sphere indices for a given `kMaxSphereInstanceCount`.
-        Shuffle(sphereIndices.begin(), sphereIndices.end(), std::mt19937(kSeed));
-
-        TriMesh mesh                     = TriMesh::CreateSphere(/* radius = */ 1, /* longitudeSegments = */ 10, /* latitudeSegments = */ 10, TriMeshOptions().Indices().TexCoords().Normals().Tangents());
-        mSphereIndexCount                = mesh.GetCountIndices();
-        const uint32_t sphereVertexCount = mesh.GetCountPositions();
-        const uint32_t sphereTriCount    = mesh.GetCountTriangles();
-
-        Geometry lowPrecisionInterleaved;
-        PPX_CHECKED_CALL(Geometry::Create(GeometryOptions::InterleavedU32(grfx::FORMAT_R16G16B16_FLOAT).AddTexCoord(grfx::FORMAT_R16G16_FLOAT).AddNormal(grfx::FORMAT_R8G8B8A8_SNORM).AddTangent(grfx::FORMAT_R8G8B8A8_SNORM), &lowPrecisionInterleaved));
-
-        Geometry lowPrecisionPositionPlanar;
-        PPX_CHECKED_CALL(Geometry::Create(GeometryOptions::PositionPlanarU32(grfx::FORMAT_R16G16B16_FLOAT).AddTexCoord(grfx::FORMAT_R16G16_FLOAT).AddNormal(grfx::FORMAT_R8G8B8A8_SNORM).AddTangent(grfx::FORMAT_R8G8B8A8_SNORM), &lowPrecisionPositionPlanar));
-
-        Geometry highPrecisionInterleaved;
-        PPX_CHECKED_CALL(Geometry::Create(GeometryOptions::InterleavedU32().AddTexCoord().AddNormal().AddTangent(), &highPrecisionInterleaved));
+    CreateSphereMeshes();
 
-        Geometry highPrecisionPositionPlanar;
-        PPX_CHECKED_CALL(Geometry::Create(GeometryOptions::PositionPlanarU32().AddTexCoord().AddNormal().AddTangent(), &highPrecisionPositionPlanar));
-
-        for (uint32_t i = 0; i < kMaxSphereInstanceCount; i++) {
-            uint32_t index = sphereIndices[i];
-            uint32_t x     = (index % (grid.xSize * grid.ySize)) / grid.ySize;
-            uint32_t y     = index % grid.ySize;
-            uint32_t z     = index / (grid.xSize * grid.ySize);
-
-            // Model matrix to be applied to the sphere mesh
-            float4x4 modelMatrix = glm::translate(float3(x * grid.step, y * grid.step, z * grid.step));
-
-            // Copy a sphere mesh to create a giant vertex buffer
-            // Iterate through the meshes vertx data and add it to the geometry
-            for (uint32_t vertexIndex = 0; vertexIndex < sphereVertexCount; ++vertexIndex) {
-                TriMeshVertexData vertexData = {};
-                mesh.GetVertexData(vertexIndex, &vertexData);
-                vertexData.position = modelMatrix * float4(vertexData.position, 1);
-
-                TriMeshVertexDataCompressed vertexDataCompressed;
-                vertexDataCompressed.position = half3(glm::packHalf1x16(vertexData.position.x), glm::packHalf1x16(vertexData.position.y), glm::packHalf1x16(vertexData.position.z));
-                vertexDataCompressed.texCoord = half2(glm::packHalf1x16(vertexData.texCoord.x), glm::packHalf1x16(vertexData.texCoord.y));
-                vertexDataCompressed.normal   = i8vec4(MapFloatToInt8(vertexData.normal.x), MapFloatToInt8(vertexData.normal.y), MapFloatToInt8(vertexData.normal.z), MapFloatToInt8(1.0f));
-                vertexDataCompressed.tangent  = i8vec4(MapFloatToInt8(vertexData.tangent.x), MapFloatToInt8(vertexData.tangent.y), MapFloatToInt8(vertexData.tangent.z), MapFloatToInt8(vertexData.tangent.a));
-                lowPrecisionInterleaved.AppendVertexData(vertexDataCompressed);
-                lowPrecisionPositionPlanar.AppendVertexData(vertexDataCompressed);
-
-                highPrecisionInterleaved.AppendVertexData(vertexData);
-                highPrecisionPositionPlanar.AppendVertexData(vertexData);
-            }
-            // Iterate the meshes triangles and add the vertex indices
-            for (uint32_t triIndex = 0; triIndex < sphereTriCount; ++triIndex) {
-                uint32_t v0 = PPX_VALUE_IGNORED;
-                uint32_t v1 = PPX_VALUE_IGNORED;
-                uint32_t v2 = PPX_VALUE_IGNORED;
-                mesh.GetTriangle(triIndex, v0, v1, v2);
-                lowPrecisionInterleaved.AppendIndicesTriangle(v0 + i * sphereVertexCount, v1 + i * sphereVertexCount, v2 + i * sphereVertexCount);
-                lowPrecisionPositionPlanar.AppendIndicesTriangle(v0 + i * sphereVertexCount, v1 + i * sphereVertexCount, v2 + i * sphereVertexCount);
-                highPrecisionInterleaved.AppendIndicesTriangle(v0 + i * sphereVertexCount, v1 + i * sphereVertexCount, v2 + i * sphereVertexCount);
-                highPrecisionPositionPlanar.AppendIndicesTriangle(v0 + i * sphereVertexCount, v1 + i * sphereVertexCount, v2 + i * sphereVertexCount);
-            }
-        }
-        // Create a giant vertex buffer to accommodate all copies of the sphere mesh
-        const uint32_t lowPrecisionInterleavedIndex = 0;
-        PPX_CHECKED_CALL(grfx_util::CreateMeshFromGeometry(GetGraphicsQueue(), &lowPrecisionInterleaved, &mSphereMeshes[lowPrecisionInterleavedIndex]));
-        const uint32_t lowPrecisionPositionPlanarIndex = 1;
-        PPX_CHECKED_CALL(grfx_util::CreateMeshFromGeometry(GetGraphicsQueue(), &lowPrecisionPositionPlanar, &mSphereMeshes[lowPrecisionPositionPlanarIndex]));
-        const uint32_t highPrecisionInterleavedIndex = 2;
-        PPX_CHECKED_CALL(grfx_util::CreateMeshFromGeometry(GetGraphicsQueue(), &highPrecisionInterleaved, &mSphereMeshes[highPrecisionInterleavedIndex]));
-        const uint32_t highPrecisionPositionPlanarIndex = 3;
-        PPX_CHECKED_CALL(grfx_util::CreateMeshFromGeometry(GetGraphicsQueue(), &highPrecisionPositionPlanar, &mSphereMeshes[highPrecisionPositionPlanarIndex]));
-    }
+    // GPU culling
+    SetupCulling();
 
     // Uniform buffers
     {
@@ -828,6 +926,14 @@ void ProjApp::ProcessKnobs()
     if (rebuildSpherePipeline) {
         CreateSpherePipelines();
     }
+
+    if (pSceneSize->DigestUpdate()) {
+        // The previous frame may still be reading the sphere meshes
+        PPX_CHECKED_CALL(GetDevice()->WaitIdle());
+        CreateSphereMeshes();
+        // Force the new bounds to be uploaded to the cull pass
+        mCullInstanceCount = 0;
+    }
 }
 
 struct SkyBoxData
@@ -872,6 +978,12 @@ void ProjApp::Render()
     // Snapshot some valid values for current frame
     uint32_t currentSphereCount   = pSphereInstanceCount->GetValue();
     uint32_t currentDrawCallCount = pDrawCallCount->GetValue();
+    size_t   currentCullingMode   = pCullingMode->GetIndex();
+
+    if ((currentCullingMode != kCullingModeNone) && (mCullInstanceCount != currentSphereCount)) {
+        PPX_CHECKED_CALL(mCullPass->SetInstances(currentSphereCount, mSphereBounds.data(), mSphereDraws.data()));
+        mCullInstanceCount = currentSphereCount;
+    }
 
     UpdateGUI();
 
@@ -881,6 +993,13 @@ void ProjApp::Render()
         // Write start timestamp
         frame.cmd->WriteTimestamp(frame.timestampQuery, grfx::PIPELINE_STAGE_TOP_OF_PIPE_BIT, /* queryIndex = */ 0);
 
+        // =====================================================================
+        // GPU culling
+        // =====================================================================
+        if (currentCullingMode != kCullingModeNone) {
+            mCullPass->Cull(frame.cmd, mCamera.GetViewProjectionMatrix(), /* enableOcclusion = */ currentCullingMode == kCullingModeFrustumHiZ);
+        }
+
         // =====================================================================
         // Scene renderpass
         // =====================================================================
@@ -919,40 +1038,60 @@ void ProjApp::Render()
             frame.cmd->BindIndexBuffer(mSphereMeshes[vbFormatIndex * vaLayoutCount + vaLayoutIndex]);
             frame.cmd->BindVertexBuffers(mSphereMeshes[vbFormatIndex * vaLayoutCount + vaLayoutIndex]);
             {
-                uint32_t indicesPerDrawCall = (currentSphereCount * mSphereIndexCount) / currentDrawCallCount;
-                // Make `indicesPerDrawCall` multiple of 3 given that each consecutive three vertices (3*i + 0, 3*i + 1, 3*i + 2)
-                // defines a single triangle primitive (PRIMITIVE_TOPOLOGY_TRIANGLE_LIST).
-                indicesPerDrawCall -= indicesPerDrawCall % 3;
-                for (uint32_t i = 0; i < currentDrawCallCount; i++) {
-                    SphereData data                 = {};
-                    data.modelMatrix                = float4x4(1.0f);
-                    data.ITModelMatrix              = glm::inverse(glm::transpose(data.modelMatrix));
-                    data.ambient                    = float4(0.3f);
-                    data.cameraViewProjectionMatrix = mCamera.GetViewProjectionMatrix();
-                    data.lightPosition              = float4(mLightPosition, 0.0f);
-                    data.eyePosition                = float4(mCamera.GetEyePosition(), 0.0f);
-                    mDrawCallUniformBuffers[i]->CopyFromSource(sizeof(data), &data);
-
-                    frame.cmd->PushGraphicsUniformBuffer(mSphere.pipelineInterface, /* binding = */ 0, /* set = */ 0, /* bufferOffset = */ 0, mDrawCallUniformBuffers[i]);
+                SphereData data                 = {};
+                data.modelMatrix                = float4x4(1.0f);
+                data.ITModelMatrix              = glm::inverse(glm::transpose(data.modelMatrix));
+                data.ambient                    = float4(0.3f);
+                data.cameraViewProjectionMatrix = mCamera.GetViewProjectionMatrix();
+                data.lightPosition              = float4(mLightPosition, 0.0f);
+                data.eyePosition                = float4(mCamera.GetEyePosition(), 0.0f);
+
+                auto pushSphereDescriptors = [&](grfx::Buffer* pUniformBuffer) {
+                    frame.cmd->PushGraphicsUniformBuffer(mSphere.pipelineInterface, /* binding = */ 0, /* set = */ 0, /* bufferOffset = */ 0, pUniformBuffer);
                     frame.cmd->PushGraphicsSampledImage(mSphere.pipelineInterface, /* binding = */ 1, /* set = */ 0, mAlbedoTexture.sampledImageView);
                     frame.cmd->PushGraphicsSampler(mSphere.pipelineInterface, /* binding = */ 2, /* set = */ 0, mAlbedoTexture.sampler);
                     frame.cmd->PushGraphicsSampledImage(mSphere.pipelineInterface, /* binding = */ 3, /* set = */ 0, mNormalMapTexture.sampledImageView);
                     frame.cmd->PushGraphicsSampler(mSphere.pipelineInterface, /* binding = */ 4, /* set = */ 0, mNormalMapTexture.sampler);
                     frame.cmd->PushGraphicsSampledImage(mSphere.pipelineInterface, /* binding = */ 5, /* set = */ 0, mMetalRoughnessTexture.sampledImageView);
                     frame.cmd->PushGraphicsSampler(mSphere.pipelineInterface, /* binding = */ 6, /* set = */ 0, mMetalRoughnessTexture.sampler);
+                };
 
-                    uint32_t indexCount = indicesPerDrawCall;
-                    // Add the remaining indices to the last drawcall
-                    if (i == currentDrawCallCount - 1) {
-                        indexCount += (currentSphereCount * mSphereIndexCount - currentDrawCallCount * indicesPerDrawCall);
+                if (currentCullingMode != kCullingModeNone) {
+                    // One indirect draw per sphere, generated by the cull pass
+                    mDrawCallUniformBuffers[0]->CopyFromSource(sizeof(data), &data);
+                    pushSphereDescriptors(mDrawCallUniformBuffers[0]);
+                    mCullPass->Draw(frame.cmd);
+                }
+                else {
+                    uint32_t indicesPerDrawCall = (currentSphereCount * mSphereIndexCount) / currentDrawCallCount;
+                    // Make `indicesPerDrawCall` multiple of 3 given that each consecutive three vertices (3*i + 0, 3*i + 1, 3*i + 2)
+                    // defines a single triangle primitive (PRIMITIVE_TOPOLOGY_TRIANGLE_LIST).
+                    indicesPerDrawCall -= indicesPerDrawCall % 3;
+                    for (uint32_t i = 0; i < currentDrawCallCount; i++) {
+                        mDrawCallUniformBuffers[i]->CopyFromSource(sizeof(data), &data);
+                        pushSphereDescriptors(mDrawCallUniformBuffers[i]);
+
+                        uint32_t indexCount = indicesPerDrawCall;
+                        // Add the remaining indices to the last drawcall
+                        if (i == currentDrawCallCount - 1) {
+                            indexCount += (currentSphereCount * mSphereIndexCount - currentDrawCallCount * indicesPerDrawCall);
+                        }
+                        uint32_t firstIndex = i * indicesPerDrawCall;
+                        frame.cmd->DrawIndexed(indexCount, /* instanceCount = */ 1, firstIndex);
                     }
-                    uint32_t firstIndex = i * indicesPerDrawCall;
-                    frame.cmd->DrawIndexed(indexCount, /* instanceCount = */ 1, firstIndex);
                 }
             }
         }
         frame.cmd->EndRenderPass();
 
+        // Build the Hi-Z pyramid from this frame's depth, it is used to cull the next frame
+        if (currentCullingMode == kCullingModeFrustumHiZ) {
+            grfx::ImagePtr depthImage = swapchain->GetDepthImage(imageIndex);
+            frame.cmd->TransitionImageLayout(depthImage, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+            mCullPass->BuildHiZ(frame.cmd, mDepthViews[imageIndex]);
+            frame.cmd->TransitionImageLayout(depthImage, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
+        }
+
         // =====================================================================
         // Fullscreen quads renderpasses
         // =====================================================================
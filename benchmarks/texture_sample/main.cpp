@@ -75,10 +75,12 @@ private:
     // Textures
     uint32_t                                    mNumImages;
     std::vector<ppx::grfx::ImagePtr>            mImages;
+    std::vector<ppx::grfx::TexturePtr>          mTextures;
     std::vector<ppx::grfx::SampledImageViewPtr> mSampledImageViews;
     ppx::grfx::SamplerPtr                       mSampler;
     std::string                                 mSamplerFilterType;
     std::string                                 mSamplerMipmapFilterType;
+    ppx::grfx::Format                           mCompressionFormat = ppx::grfx::FORMAT_UNDEFINED;
 
     // Drawn rectangle sizes (number of mipmaps of target resolution)
     uint32_t mNumRectSizes = 0;
@@ -153,6 +155,21 @@ void ProjApp::Setup()
     // This value is validated once the image is created and the mip level count is known.
     mForcedMipLevel = cl_options.GetExtraOptionValueOrDefault<int32_t>("force-mip-level", -1);
 
+    // Block compression applied to the textures at load time. Encoded results are cached on disk.
+    std::string compression = cl_options.GetExtraOptionValueOrDefault<std::string>("texture-compression", "none");
+    if (compression == "bc1") {
+        mCompressionFormat = grfx::FORMAT_BC1_RGB_UNORM;
+    }
+    else if (compression == "bc3") {
+        mCompressionFormat = grfx::FORMAT_BC3_UNORM;
+    }
+    else if (compression == "bc7") {
+        mCompressionFormat = grfx::FORMAT_BC7_UNORM;
+    }
+    else if (compression != "none") {
+        PPX_LOG_WARN("Invalid texture compression (must be `none`, `bc1`, `bc3` or `bc7`), defaulting to: none");
+    }
+
     // Per frame data
     {
         PerFrame frame = {};
@@ -259,9 +276,24 @@ void ProjApp::Setup()
 
         grfx_util::ImageOptions options = grfx_util::ImageOptions().MipLevelCount(PPX_REMAINING_MIP_LEVELS);
 
+        grfx_util::TextureOptions textureOptions = grfx_util::TextureOptions()
+                                                       .MipLevelCount(PPX_REMAINING_MIP_LEVELS)
+                                                       .Compress(mCompressionFormat)
+                                                       .CompressionCacheDirectory(std::filesystem::temp_directory_path() / "ppx_texture_cache");
+
         for (uint32_t i = 0; i < mNumImages; ++i) {
+            const std::filesystem::path path = GetAssetPath("benchmarks/textures/bricks_" + res + ".png");
+
             grfx::ImagePtr image;
-            PPX_CHECKED_CALL(grfx_util::CreateImageFromFile(GetDevice()->GetGraphicsQueue(), GetAssetPath("benchmarks/textures/bricks_" + res + ".png"), &image, options, false));
+            if (mCompressionFormat != grfx::FORMAT_UNDEFINED) {
+                grfx::TexturePtr texture;
+                PPX_CHECKED_CALL(grfx_util::CreateTextureFromFile(GetDevice()->GetGraphicsQueue(), path, &texture, textureOptions));
+                mTextures.push_back(texture);
+                image = texture->GetImage();
+            }
+            else {
+                PPX_CHECKED_CALL(grfx_util::CreateImageFromFile(GetDevice()->GetGraphicsQueue(), path, &image, options, false));
+            }
             mImages.push_back(image);
 
             grfx::SampledImageViewPtr        imageView;
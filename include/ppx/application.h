@@ -17,11 +17,13 @@
 
 #include "ppx/base_application.h"
 #include "ppx/command_line_parser.h"
+#include "ppx/frame_capture.h"
 #include "ppx/fs.h"
 #include "ppx/imgui_impl.h"
 #include "ppx/knob.h"
 #include "ppx/math_config.h"
 #include "ppx/metrics.h"
+#include "ppx/mip_generator.h"
 #include "ppx/timer.h"
 #include "ppx/window.h"
 #include "ppx/xr_component.h"
@@ -245,6 +247,9 @@ struct StandardOptions
 
     std::shared_ptr<KnobFlag<std::string>> pScreenshotPath;
     std::shared_ptr<KnobFlag<std::string>> pMetricsFilename;
+    std::shared_ptr<KnobFlag<std::string>> pCaptureFormat;
+    std::shared_ptr<KnobFlag<std::string>> pCaptureFrames;
+    std::shared_ptr<KnobFlag<std::string>> pCapturePath;
 
     std::shared_ptr<KnobFlag<std::pair<int, int>>> pResolution;
 #if defined(PPX_BUILD_XR)
@@ -377,6 +382,8 @@ protected:
     // Thus it should always be called once per frame.
     virtual void UpdateMetrics() {}
 
+    //! Queues a copy of the current swapchain image, it is written
+    //! asynchronously once the GPU has finished the frame.
     void TakeScreenshot();
 
     void DrawImGui(grfx::CommandBuffer* pCommandBuffer);
@@ -421,6 +428,12 @@ public:
     std::vector<char> LoadShader(const std::filesystem::path& baseDir, const std::filesystem::path& baseName) const;
     Result            CreateShader(const std::filesystem::path& baseDir, const std::filesystem::path& baseName, grfx::ShaderModule** ppShaderModule) const;
 
+    // Shared compute mip generator, created from basic/shaders/GenerateMips.cs
+    // before Setup() and registered as the device's default generator.
+    // Returns nullptr if the shader is not available, callers fall back to
+    // building mips on the CPU.
+    MipGenerator* GetMipGenerator();
+
     Window*           GetWindow() const { return mWindow.get(); }
     grfx::InstancePtr GetInstance() const { return mInstance; }
     grfx::DevicePtr   GetDevice() const { return mDevice; }
@@ -520,6 +533,10 @@ private:
     // Initializes standard knobs
     void InitStandardKnobs();
 
+    // Queues screenshots and captures requested for the current frame.
+    void UpdateFrameCapture();
+    void CaptureSwapchainImage(const std::filesystem::path& path);
+
 private:
     friend struct WindowEvents;
     //
@@ -555,6 +572,13 @@ private:
     grfx::SurfacePtr                mSurface                    = nullptr; // Requires enableDisplay
     std::vector<grfx::SwapchainPtr> mSwapchains;                           // Requires enableDisplay
     std::unique_ptr<ImGuiImpl>      mImGui;
+    std::unique_ptr<MipGenerator>   mMipGenerator;
+    bool                            mMipGeneratorFailed = false;
+    std::unique_ptr<FrameCapture>   mFrameCapture;
+    FrameCaptureEncoding            mCaptureEncoding   = FRAME_CAPTURE_ENCODING_PPM;
+    bool                            mCaptureFrames     = false;
+    uint64_t                        mCaptureFrameStart = 0;
+    uint64_t                        mCaptureFrameCount = 0;
     KnobManager                     mKnobManager;
 
     uint64_t          mFrameCount        = 0;
@@ -0,0 +1,218 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ppx_async_compute_h
+#define ppx_async_compute_h
+
+#include "ppx/config.h"
+#include "ppx/metrics.h"
+#include "ppx/grfx/grfx_command.h"
+#include "ppx/grfx/grfx_query.h"
+#include "ppx/grfx/grfx_queue.h"
+#include "ppx/grfx/grfx_sync.h"
+
+#include <vector>
+
+namespace ppx {
+
+class Application;
+
+//! @enum AsyncComputeWork
+//!
+//! Kind of work a command buffer records. Compute work runs on the compute
+//! queue while async compute is enabled and on the graphics queue
+//! otherwise, graphics work always runs on the graphics queue.
+//!
+enum AsyncComputeWork
+{
+    ASYNC_COMPUTE_WORK_GRAPHICS = 0,
+    ASYNC_COMPUTE_WORK_COMPUTE  = 1,
+    ASYNC_COMPUTE_WORK_COUNT    = 2,
+};
+
+//! @struct AsyncComputeSpan
+//!
+//! GPU time between the start and the end of a command buffer's work, in
+//! milliseconds from an arbitrary origin shared by all spans of a frame.
+//!
+struct AsyncComputeSpan
+{
+    double beginMs = 0;
+    double endMs   = 0;
+};
+
+//! @struct AsyncComputeStats
+//!
+//! Busy times count overlapping spans of the same kind once.
+//!
+struct AsyncComputeStats
+{
+    double graphicsBusyMs = 0;     //! Time graphics work ran
+    double computeBusyMs  = 0;     //! Time compute work ran
+    double overlapMs      = 0;     //! Time graphics and compute work ran at the same time
+    double frameMs        = 0;     //! First start to last end of any work
+    double overlapRatio   = 0;     //! overlapMs / computeBusyMs, 0 without compute work
+    bool   asyncCompute   = false; //! Compute work ran on the compute queue
+};
+
+//! @struct AsyncComputeSchedulerCreateInfo
+//!
+//!
+struct AsyncComputeSchedulerCreateInfo
+{
+    grfx::Queue* pGraphicsQueue = nullptr;
+    grfx::Queue* pComputeQueue  = nullptr; //! Async compute is unavailable when null
+    uint32_t     frameCount     = 1;       //! Frames in flight
+    uint32_t     semaphoreCount = 0;       //! Semaphores of each frame, see GetSemaphore()
+    uint32_t     maxSpanCount   = 16;      //! Timestamped command buffers of each kind in a frame
+    //! Record queue family ownership transfers between the queues. Vulkan
+    //! requires them for the contents of exclusive resources to be defined
+    //! on the other queue, many drivers work without them.
+    bool queueFamilyTransfers = true;
+};
+
+//! @class AsyncComputeScheduler
+//!
+//! Runs compute work of a frame on the compute queue next to graphics work,
+//! or on the graphics queue when async compute is disabled, and measures
+//! how much of the two actually overlapped.
+//!
+//! A frame goes:
+//!   1. BeginFrame() once the frame's fence has been waited on. Reads the
+//!      timestamps of the last frame that used the same index into
+//!      GetStats() and latches IsEnabled() for the frame.
+//!   2. Record work between BeginWork() and EndWork(). Resources handed
+//!      between kinds of work are released by the command buffer giving
+//!      them up and acquired by the one taking them over, with the
+//!      Release*() and Acquire*() functions.
+//!   3. Submit() each command buffer to the queue for its kind of work,
+//!      ordering them with the frame's semaphores from GetSemaphore().
+//!   4. ResolveTimestamps() in the frame's last graphics command buffer,
+//!      submitted after all other work of the frame completed.
+//!
+//! Timestamps of the two queues are assumed to come from the same clock,
+//! which holds for the graphics and compute queues of the GPUs the samples
+//! run on. DX12 queues can report different frequencies, each span is
+//! converted with the frequency of its queue.
+//!
+class AsyncComputeScheduler
+{
+public:
+    AsyncComputeScheduler() {}
+    ~AsyncComputeScheduler() {}
+
+    Result Initialize(grfx::Device* pDevice, const AsyncComputeSchedulerCreateInfo& createInfo);
+    void   Shutdown();
+
+    //! Takes effect at the next BeginFrame(). Ignored without a compute queue.
+    void SetEnabled(bool enabled) { mRequestEnabled = enabled; }
+    bool IsAvailable() const { return mComputeQueue != nullptr; }
+    //! Async compute state of the current frame
+    bool IsEnabled() const { return mEnabled; }
+
+    grfx::Queue* GetGraphicsQueue() const { return mGraphicsQueue; }
+    //! Queue that runs compute work in the current frame
+    grfx::Queue* GetComputeQueue() const { return mEnabled ? mComputeQueue : mGraphicsQueue; }
+    grfx::Queue* GetQueue(AsyncComputeWork work) const;
+
+    void BeginFrame(uint32_t frameIndex);
+
+    //! The frame's semaphores, index is less than semaphoreCount
+    grfx::Semaphore* GetSemaphore(uint32_t index) const;
+
+    Result Submit(AsyncComputeWork work, const grfx::SubmitInfo* pSubmitInfo);
+
+    //! Timestamps around the work of a command buffer, one span of a kind
+    //! can be open at a time. Spans past maxSpanCount are not measured.
+    void BeginWork(grfx::CommandBuffer* pCommandBuffer, AsyncComputeWork work);
+    void EndWork(grfx::CommandBuffer* pCommandBuffer, AsyncComputeWork work);
+    void ResolveTimestamps(grfx::CommandBuffer* pCommandBuffer);
+
+    //! Graphics work hands resources over to compute work
+    void ReleaseToCompute(grfx::CommandBuffer* pCommandBuffer, const grfx::Image* pImage, grfx::ResourceState state) const;
+    void ReleaseToCompute(grfx::CommandBuffer* pCommandBuffer, const grfx::Buffer* pBuffer, grfx::ResourceState state) const;
+    void AcquireFromGraphics(grfx::CommandBuffer* pCommandBuffer, const grfx::Image* pImage, grfx::ResourceState state) const;
+    void AcquireFromGraphics(grfx::CommandBuffer* pCommandBuffer, const grfx::Buffer* pBuffer, grfx::ResourceState state) const;
+
+    //! Compute work hands resources over to graphics work
+    void ReleaseToGraphics(grfx::CommandBuffer* pCommandBuffer, const grfx::Image* pImage, grfx::ResourceState state) const;
+    void ReleaseToGraphics(grfx::CommandBuffer* pCommandBuffer, const grfx::Buffer* pBuffer, grfx::ResourceState state) const;
+    void AcquireFromCompute(grfx::CommandBuffer* pCommandBuffer, const grfx::Image* pImage, grfx::ResourceState state) const;
+    void AcquireFromCompute(grfx::CommandBuffer* pCommandBuffer, const grfx::Buffer* pBuffer, grfx::ResourceState state) const;
+
+    //! Stats of the last frame read by BeginFrame(), HasStats() is false
+    //! until a frame with timestamps completed.
+    bool                     HasStats() const { return mHasStats; }
+    const AsyncComputeStats& GetStats() const { return mStats; }
+
+    //! Adds the overlap ratio, busy time and frame time metrics to the
+    //! application's active metrics run. RecordMetrics() records the stats
+    //! of the last frame.
+    void AddMetrics(Application* pApp);
+    void RecordMetrics(Application* pApp, double seconds) const;
+
+    static AsyncComputeStats ComputeStats(const std::vector<AsyncComputeSpan>& graphicsSpans, const std::vector<AsyncComputeSpan>& computeSpans);
+
+private:
+    struct Timestamps
+    {
+        grfx::QueryPtr query;
+        uint32_t       spanCount = 0;
+        bool           spanOpen  = false;
+    };
+
+    struct PerFrame
+    {
+        Timestamps                      timestamps[ASYNC_COMPUTE_WORK_COUNT];
+        std::vector<grfx::SemaphorePtr> semaphores;
+        bool                            asyncCompute = false;
+        bool                            resolved     = false;
+    };
+
+    void TransferOwnership(
+        grfx::CommandBuffer* pCommandBuffer,
+        const grfx::Image*   pImage,
+        grfx::ResourceState  state,
+        const grfx::Queue*   pSrcQueue,
+        const grfx::Queue*   pDstQueue) const;
+    void TransferOwnership(
+        grfx::CommandBuffer* pCommandBuffer,
+        const grfx::Buffer*  pBuffer,
+        grfx::ResourceState  state,
+        const grfx::Queue*   pSrcQueue,
+        const grfx::Queue*   pDstQueue) const;
+    void ReadTimestamps(PerFrame& frame);
+
+private:
+    grfx::Device*         mDevice               = nullptr;
+    grfx::Queue*          mGraphicsQueue        = nullptr;
+    grfx::Queue*          mComputeQueue         = nullptr;
+    uint32_t              mMaxSpanCount         = 0;
+    bool                  mQueueFamilyTransfers = true;
+    bool                  mRequestEnabled       = true;
+    bool                  mEnabled              = false;
+    std::vector<PerFrame> mPerFrame;
+    uint32_t              mFrameIndex = 0;
+    AsyncComputeStats     mStats;
+    bool                  mHasStats = false;
+
+    metrics::MetricID mOverlapRatioMetric = metrics::kInvalidMetricID;
+    metrics::MetricID mGraphicsBusyMetric = metrics::kInvalidMetricID;
+    metrics::MetricID mComputeBusyMetric  = metrics::kInvalidMetricID;
+    metrics::MetricID mFrameTimeMetric    = metrics::kInvalidMetricID;
+};
+
+} // namespace ppx
+
+#endif // ppx_async_compute_h
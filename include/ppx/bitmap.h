@@ -17,15 +17,57 @@
 
 #include "ppx/config.h"
 #include "ppx/grfx/grfx_format.h"
+#include "ppx/pixel_conversion.h"
 
 #include "stb_image_resize.h"
 
 #include <filesystem>
+#include <type_traits>
 
 namespace ppx {
 
+class BitmapView;
+
+//! @class BitmapLoadOptions
+//!
+//! Controls the format Bitmap::LoadFile() produces. The defaults match the
+//! historical behavior: every image is expanded to RGBA, 8-bit files load as
+//! RGBA_UINT8 and Radiance files load as RGBA_FLOAT.
+//!
+class BitmapLoadOptions
+{
+public:
+    BitmapLoadOptions() {}
+    ~BitmapLoadOptions() {}
+
+    // clang-format off
+    //! Number of channels to load, 0 keeps the file's channel count. 3 channel results are expanded to 4 unless AllowRGB() is set.
+    BitmapLoadOptions& ChannelCount(uint32_t count) { mChannelCount = count; return *this; }
+    //! Keeps 3 channel images as RGB. Few GPUs can sample 3 channel 8-bit formats, so only set this if the consumer can.
+    BitmapLoadOptions& AllowRGB(bool value = true) { mAllowRGB = value; return *this; }
+    //! Loads 16-bit PNG files as UINT16 instead of truncating them to 8 bits.
+    BitmapLoadOptions& Preserve16Bit(bool value = true) { mPreserve16Bit = value; return *this; }
+    //! Stores Radiance files as 16-bit float instead of 32-bit float.
+    BitmapLoadOptions& HalfFloat(bool value = true) { mHalfFloat = value; return *this; }
+    // clang-format on
+
+    //! Keeps the file's channel count and bit depth, stores HDR as half.
+    static BitmapLoadOptions Native() { return BitmapLoadOptions().ChannelCount(0).Preserve16Bit().HalfFloat(); }
+
+private:
+    uint32_t mChannelCount  = 4;
+    bool     mAllowRGB      = false;
+    bool     mPreserve16Bit = false;
+    bool     mHalfFloat     = false;
+
+    friend class Bitmap;
+};
+
 //! @class Bitmap
 //!
+//! Copies are deep: the copy always has internal storage. Moves transfer
+//! the storage, whether it is internal, external or loaded by stbi, without
+//! touching the pixels.
 //!
 class Bitmap
 {
@@ -37,6 +79,7 @@ public:
         DATA_TYPE_UINT16,
         DATA_TYPE_UINT32,
         DATA_TYPE_FLOAT,
+        DATA_TYPE_FLOAT16,
     };
 
     enum Format
@@ -58,15 +101,21 @@ public:
         FORMAT_RG_FLOAT,
         FORMAT_RGB_FLOAT,
         FORMAT_RGBA_FLOAT,
+        FORMAT_R_FLOAT16,
+        FORMAT_RG_FLOAT16,
+        FORMAT_RGB_FLOAT16,
+        FORMAT_RGBA_FLOAT16,
     };
 
     // ---------------------------------------------------------------------------------------------
 
     Bitmap();
     Bitmap(const Bitmap& obj);
+    Bitmap(Bitmap&& obj) noexcept;
     ~Bitmap();
 
     Bitmap& operator=(const Bitmap& rhs);
+    Bitmap& operator=(Bitmap&& rhs) noexcept;
 
     //! Creates a bitmap with internal storage.
     static Result Create(uint32_t width, uint32_t height, Bitmap::Format format, Bitmap* pBitmap);
@@ -93,6 +142,12 @@ public:
     char*          GetData() const { return mData; }
     uint64_t       GetFootprintSize(uint32_t rowStrideAlignment = 1) const;
 
+    //! Returns a view of all pixels, valid until the storage is released.
+    BitmapView GetView() const;
+    //! Returns a view of a sub-rectangle, or an empty view if the rectangle
+    //! is not inside the bitmap.
+    BitmapView GetView(uint32_t x, uint32_t y, uint32_t width, uint32_t height) const;
+
     Result Resize(uint32_t width, uint32_t height);
     Result ScaleTo(Bitmap* pTargetBitmap) const;
     Result ScaleTo(Bitmap* pTargetBitmap, stbir_filter filterType) const;
@@ -123,8 +178,9 @@ public:
     static uint32_t         FormatSize(Bitmap::Format value);
     static uint64_t         StorageFootprint(uint32_t width, uint32_t height, Bitmap::Format format);
 
-    static Result GetFileProperties(const std::filesystem::path& path, uint32_t* pWidth, uint32_t* pHeight, Bitmap::Format* pFormat);
-    static Result LoadFile(const std::filesystem::path& path, Bitmap* pBitmap);
+    //! Returns the format LoadFile() would produce for \b path with \b options.
+    static Result GetFileProperties(const std::filesystem::path& path, uint32_t* pWidth, uint32_t* pHeight, Bitmap::Format* pFormat, const BitmapLoadOptions& options = BitmapLoadOptions());
+    static Result LoadFile(const std::filesystem::path& path, Bitmap* pBitmap, const BitmapLoadOptions& options = BitmapLoadOptions());
     static Result SaveFilePNG(const std::filesystem::path& path, const Bitmap* pBitmap);
     static bool   IsBitmapFile(const std::filesystem::path& path);
 
@@ -195,6 +251,7 @@ private:
     void   InternalCtor();
     Result InternalInitialize(uint32_t width, uint32_t height, Bitmap::Format format, uint32_t rowStride, char* pExternalStorage);
     Result InternalCopy(const Bitmap& obj);
+    void   InternalMove(Bitmap& obj);
     void   FreeStbiDataIfNeeded();
 
     // Stbi-specific functions/wrappers.
@@ -203,6 +260,8 @@ private:
     static char* StbiLoad(const std::filesystem::path& path, Bitmap::Format format, int* pWidth, int* pHeight, int* pChannels, int desiredChannels);
     // These arugments mirror those for stbi_info.
     static Result StbiInfo(const std::filesystem::path& path, int* pX, int* pY, int* pComp);
+    // Resolves the format LoadFile() produces for a file with the given properties.
+    static Bitmap::Format LoadFormat(int fileChannels, bool is16Bit, bool isRadiance, const BitmapLoadOptions& options);
 
 private:
     uint32_t          mWidth           = 0;
@@ -216,6 +275,49 @@ private:
     std::vector<char> mInternalStorage = {};
 };
 
+//! @class BitmapView
+//!
+//! Non-owning reference to a rectangle of pixels. Rows may be padded or be
+//! part of a larger image, so always step with GetRowStride(). Views are
+//! cheap to copy and never allocate.
+//!
+class BitmapView
+{
+public:
+    BitmapView() {}
+    //! If \b rowStride is 0, default row stride for format is used.
+    BitmapView(char* pData, uint32_t width, uint32_t height, Bitmap::Format format, uint32_t rowStride = 0);
+
+    // Returns true if dimensions are greater than zero, format is valid, and data is not null
+    bool IsOk() const;
+
+    uint32_t       GetWidth() const { return mWidth; }
+    uint32_t       GetHeight() const { return mHeight; }
+    Bitmap::Format GetFormat() const { return mFormat; }
+    uint32_t       GetPixelStride() const { return mPixelStride; }
+    uint32_t       GetRowStride() const { return mRowStride; }
+    char*          GetData() const { return mData; }
+    //! True when rows follow each other without padding.
+    bool           IsTightlyPacked() const { return mRowStride == mWidth * mPixelStride; }
+
+    char* GetPixelAddress(uint32_t x, uint32_t y) const;
+
+    //! Returns an empty view if the rectangle is not inside this view.
+    BitmapView GetSubView(uint32_t x, uint32_t y, uint32_t width, uint32_t height) const;
+
+    //! Copies the pixels row by row into \b dst, which must have the same
+    //! size and format.
+    Result CopyTo(const BitmapView& dst) const;
+
+private:
+    char*          mData        = nullptr;
+    uint32_t       mWidth       = 0;
+    uint32_t       mHeight      = 0;
+    Bitmap::Format mFormat      = Bitmap::FORMAT_UNDEFINED;
+    uint32_t       mPixelStride = 0;
+    uint32_t       mRowStride   = 0;
+};
+
 template <typename PixelDataType>
 void Bitmap::Fill(PixelDataType r, PixelDataType g, PixelDataType b, PixelDataType a)
 {
@@ -226,16 +328,20 @@ void Bitmap::Fill(PixelDataType r, PixelDataType g, PixelDataType b, PixelDataTy
 
     const uint32_t channelCount = Bitmap::ChannelCount(mFormat);
 
-    char* pData = mData;
-    for (uint32_t y = 0; y < mHeight; ++y) {
-        for (uint32_t x = 0; x < mWidth; ++x) {
-            PixelDataType* pPixelData = reinterpret_cast<PixelDataType*>(pData);
-            for (uint32_t c = 0; c < channelCount; ++c) {
-                pPixelData[c] = rgba[c];
-            }
-            pData += mPixelStride;
+    // Build one pixel, half float bitmaps are filled from float values
+    const void* pPixel  = rgba;
+    uint16_t    half[4] = {};
+    if constexpr (std::is_same_v<PixelDataType, float>) {
+        if (Bitmap::ChannelDataType(mFormat) == Bitmap::DATA_TYPE_FLOAT16) {
+            ConvertFloatToHalf(rgba, half, channelCount);
+            pPixel = half;
         }
     }
+    PPX_ASSERT_MSG((pPixel == half) || (sizeof(PixelDataType) * channelCount == mPixelStride), "fill value type does not match format");
+
+    for (uint32_t y = 0; y < mHeight; ++y) {
+        FillPixels(mData + static_cast<size_t>(y) * mRowStride, pPixel, mPixelStride, mWidth);
+    }
 }
 
 } // namespace ppx
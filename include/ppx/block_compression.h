@@ -0,0 +1,118 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ppx_block_compression_h
+#define ppx_block_compression_h
+
+#include "ppx/config.h"
+#include "ppx/mipmap.h"
+#include "ppx/grfx/grfx_format.h"
+
+#include <filesystem>
+#include <vector>
+
+namespace ppx {
+
+class JobSystem;
+
+//! @class CompressedMipmap
+//!
+//! Mip chain encoded in a block compressed format. Each level is stored as
+//! tightly packed rows of 4x4 blocks; levels smaller than a block still
+//! occupy one full block per row and column.
+//!
+class CompressedMipmap
+{
+public:
+    CompressedMipmap() {}
+
+    bool IsOk() const { return (mFormat != grfx::FORMAT_UNDEFINED) && !mLevels.empty(); }
+
+    grfx::Format GetFormat() const { return mFormat; }
+    uint32_t     GetLevelCount() const { return CountU32(mLevels); }
+    uint32_t     GetWidth(uint32_t level) const;
+    uint32_t     GetHeight(uint32_t level) const;
+    uint32_t     GetBlockCountX(uint32_t level) const;
+    uint32_t     GetBlockCountY(uint32_t level) const;
+    //! Size in bytes of a row of blocks.
+    uint32_t     GetRowStride(uint32_t level) const;
+    uint64_t     GetDataSize(uint32_t level) const;
+    const char*  GetData(uint32_t level) const;
+    char*        GetData(uint32_t level);
+
+    //! Allocates storage for a mip chain of \b width x \b height, halving
+    //! each dimension per level.
+    Result Initialize(uint32_t width, uint32_t height, grfx::Format format, uint32_t levelCount);
+
+    static Result LoadFile(const std::filesystem::path& path, CompressedMipmap* pMipmap);
+    static Result SaveFile(const std::filesystem::path& path, const CompressedMipmap* pMipmap);
+
+private:
+    struct Level
+    {
+        uint32_t width  = 0;
+        uint32_t height = 0;
+        uint64_t offset = 0;
+        uint64_t size   = 0;
+    };
+
+    grfx::Format       mFormat = grfx::FORMAT_UNDEFINED;
+    std::vector<Level> mLevels;
+    std::vector<char>  mData;
+};
+
+//! @fn IsBlockCompressionSupported
+//!
+//! Returns true for the formats the CPU encoder can produce: BC1, BC3, BC7
+//! (UNORM and SRGB), BC4_UNORM and BC5_UNORM. SRGB variants encode the
+//! stored values as-is, so the source is expected to already be sRGB.
+//!
+bool IsBlockCompressionSupported(grfx::Format format);
+
+//! @fn CompressMipmap
+//!
+//! Encodes every level of \b mipmap into \b format. Sources must have 8 bit,
+//! 16 bit or float channels; missing channels read as 0 (alpha as opaque).
+//! Blocks are encoded on \b pJobSystem, or on a temporary pool sized to the
+//! machine if \b pJobSystem is null. Callers compressing several mipmaps
+//! should pass a pool they own so it is not started for every mipmap.
+//!
+Result CompressMipmap(
+    const Mipmap&     mipmap,
+    grfx::Format      format,
+    CompressedMipmap* pCompressed,
+    JobSystem*        pJobSystem = nullptr);
+
+//! @fn CompressMipmapCached
+//!
+//! Same as CompressMipmap() but looks the result up in \b cacheDirectory
+//! first. Entries are keyed on the source pixels, the target format and the
+//! encoder version, so stale entries are never returned. Failing to read or
+//! write the cache is not an error, the mipmap is encoded instead.
+//!
+Result CompressMipmapCached(
+    const Mipmap&                mipmap,
+    grfx::Format                 format,
+    const std::filesystem::path& cacheDirectory,
+    CompressedMipmap*            pCompressed,
+    JobSystem*                   pJobSystem = nullptr);
+
+//! Encodes a single 4x4 block of RGBA8 texels, stored row by row, into
+//! \b pBlock. \b pBlock must hold 8 bytes for BC1/BC4 and 16 bytes for
+//! BC3/BC5/BC7.
+Result CompressBlock(grfx::Format format, const uint8_t* pTexels, char* pBlock);
+
+} // namespace ppx
+
+#endif // ppx_block_compression_h
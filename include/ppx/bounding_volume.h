@@ -21,6 +21,7 @@ namespace ppx {
 
 class AABB;
 class OBB;
+class Frustum;
 
 //! @class AABB
 //!
@@ -188,6 +189,68 @@ private:
     float3 mW      = float3(0, 0, 1);
 };
 
+//! @class Frustum
+//!
+//! @brief View frustum described by six inward facing planes
+//!
+//! Each plane is stored as float4(normal, distance) so that a point P lies
+//! on the inner side of the plane when dot(normal, P) + distance >= 0.
+//! Planes are extracted from a view projection matrix that maps depth to
+//! [0, 1], which is the convention used throughout ppx.
+//!
+class Frustum
+{
+public:
+    enum Plane
+    {
+        PLANE_LEFT   = 0,
+        PLANE_RIGHT  = 1,
+        PLANE_BOTTOM = 2,
+        PLANE_TOP    = 3,
+        PLANE_NEAR   = 4,
+        PLANE_FAR    = 5,
+        PLANE_COUNT  = 6,
+    };
+
+    Frustum() {}
+
+    Frustum(const float4x4& viewProjectionMatrix)
+    {
+        Set(viewProjectionMatrix);
+    }
+
+    ~Frustum() {}
+
+    void Set(const float4x4& viewProjectionMatrix);
+
+    const float4& GetPlane(Plane plane) const
+    {
+        return mPlanes[plane];
+    }
+
+    const float4* GetPlanes() const
+    {
+        return mPlanes;
+    }
+
+    //! @fn bool Contains(const float3& pos) const
+    //!
+    //! Returns true if \b pos is inside or on the boundary of the frustum.
+    //!
+    bool Contains(const float3& pos) const;
+
+    //! @fn bool Intersects(const AABB& aabb) const
+    //!
+    //! Conservative test: returns false only if \b aabb is entirely outside
+    //! of at least one plane. Boxes near the frustum corners may be reported
+    //! as intersecting even though they are not visible.
+    //!
+    bool Intersects(const AABB& aabb) const;
+
+private:
+    float4 mPlanes[PLANE_COUNT] = {};
+};
+
 } // namespace ppx
 
 #endif // ppx_bounding_volume_h
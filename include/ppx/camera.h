@@ -16,6 +16,7 @@
 #define ppx_camera_h
 
 #include "ppx/math_config.h"
+#include "ppx/bounding_volume.h"
 
 #define PPX_CAMERA_DEFAULT_NEAR_CLIP      0.1f
 #define PPX_CAMERA_DEFAULT_FAR_CLIP       10000.0f
@@ -47,6 +48,12 @@ public:
     const float4x4& GetProjectionMatrix() const { return mProjectionMatrix; }
     const float4x4& GetViewProjectionMatrix() const { return mViewProjectionMatrix; }
 
+    //! @fn Frustum GetFrustum() const
+    //!
+    //! Returns the world space frustum of the current view projection matrix.
+    //!
+    Frustum GetFrustum() const { return Frustum(mViewProjectionMatrix); }
+
     float3 WorldToViewPoint(const float3& worldPoint) const;
     float3 WorldToViewVector(const float3& worldVector) const;
 
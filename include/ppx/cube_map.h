@@ -0,0 +1,164 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ppx_cube_map_h
+#define ppx_cube_map_h
+
+#include "ppx/config.h"
+#include "ppx/bitmap.h"
+
+#include <filesystem>
+#include <vector>
+
+namespace ppx {
+
+class JobSystem;
+
+//! Face order of CubeMap, matches the array layers of a cube image.
+enum CubeMapFace
+{
+    CUBE_MAP_FACE_POS_X = 0,
+    CUBE_MAP_FACE_NEG_X = 1,
+    CUBE_MAP_FACE_POS_Y = 2,
+    CUBE_MAP_FACE_NEG_Y = 3,
+    CUBE_MAP_FACE_POS_Z = 4,
+    CUBE_MAP_FACE_NEG_Z = 5,
+    CUBE_MAP_FACE_COUNT = 6,
+};
+
+//! @class CubeMap
+//!
+//! Six square faces of RGBA float texels with a mip chain. Each face of a
+//! level is stored as tightly packed rows, the six faces of a level are
+//! contiguous so a level can be uploaded with a single copy per face.
+//!
+//! The functions below run on the CPU and split their work across
+//! \b pJobSystem. A null \b pJobSystem starts a pool for the duration of
+//! the call, so pass one when processing several images. There is no
+//! compute shader path: ComputeIBLCubeMapsCached() keeps its results on
+//! disk, so the filtering runs once per source image.
+//!
+class CubeMap
+{
+public:
+    CubeMap() {}
+
+    bool IsOk() const { return (mFaceSize > 0) && !mLevelOffsets.empty(); }
+
+    uint32_t     GetLevelCount() const { return CountU32(mLevelOffsets); }
+    uint32_t     GetFaceSize(uint32_t level = 0) const;
+    //! Size in bytes of one face of \b level.
+    uint64_t     GetFaceDataSize(uint32_t level) const;
+    const float* GetTexels(uint32_t face, uint32_t level) const;
+    float*       GetTexels(uint32_t face, uint32_t level);
+
+    //! Returns an RGBA_FLOAT bitmap that references the texels of a face.
+    Bitmap GetFaceBitmap(uint32_t face, uint32_t level);
+
+    //! Allocates zeroed storage, each level halves the face size.
+    Result Initialize(uint32_t faceSize, uint32_t levelCount);
+
+    static Result LoadFile(const std::filesystem::path& path, CubeMap* pCubeMap);
+    static Result SaveFile(const std::filesystem::path& path, const CubeMap* pCubeMap);
+
+private:
+    uint32_t              mFaceSize = 0;
+    std::vector<uint64_t> mLevelOffsets; // In floats
+    std::vector<float>    mData;
+};
+
+//! @fn ApplyCubeFaceOp
+//!
+//! Rotates (clockwise) or mirrors a face. \b op is a grfx_util::CubeFaceOp.
+//! \b pDst must not alias \b src and must have its format and size, with
+//! width and height swapped for 90 and 270 degree rotations. Works on any
+//! bitmap format.
+//!
+Result ApplyCubeFaceOp(const Bitmap& src, uint32_t op, Bitmap* pDst);
+
+//! @fn ConvertLatLongToCubeMap
+//!
+//! Resamples an equirectangular (latitude-longitude) image of any bitmap
+//! format into level 0 of \b pCubeMap with bilinear filtering. +Y is up and
+//! the center of the image faces -Z. The remaining levels are box filtered.
+//!
+Result ConvertLatLongToCubeMap(
+    const Bitmap& latLong,
+    uint32_t      faceSize,
+    uint32_t      levelCount,
+    CubeMap*      pCubeMap,
+    JobSystem*    pJobSystem = nullptr);
+
+//! @fn GenerateCubeMapMips
+//!
+//! Box filters every level from the level above it.
+//!
+void GenerateCubeMapMips(CubeMap* pCubeMap, JobSystem* pJobSystem = nullptr);
+
+//! @fn ComputeIrradianceCubeMap
+//!
+//! Cosine convolution of \b environment, evaluated from its projection onto
+//! the first 9 spherical harmonics. The cost is one pass over the source
+//! texels, independent of \b faceSize.
+//!
+Result ComputeIrradianceCubeMap(
+    const CubeMap& environment,
+    uint32_t       faceSize,
+    CubeMap*       pIrradiance,
+    JobSystem*     pJobSystem = nullptr);
+
+//! @fn ComputePrefilteredCubeMap
+//!
+//! GGX prefiltered specular environment for split sum image based lighting.
+//! Level N is filtered with roughness N / (levelCount - 1), level 0 is a
+//! copy of the environment. Samples read lower mips of \b environment
+//! according to their PDF, so \b environment should have a full mip chain.
+//!
+Result ComputePrefilteredCubeMap(
+    const CubeMap& environment,
+    uint32_t       faceSize,
+    uint32_t       levelCount,
+    uint32_t       sampleCount,
+    CubeMap*       pPrefiltered,
+    JobSystem*     pJobSystem = nullptr);
+
+//! @struct IBLCubeMapOptions
+//!
+//!
+struct IBLCubeMapOptions
+{
+    uint32_t environmentSize        = 512;
+    uint32_t irradianceSize         = 32;
+    uint32_t prefilteredLevelCount  = 6;
+    uint32_t prefilteredSampleCount = 64;
+};
+
+//! @fn ComputeIBLCubeMapsCached
+//!
+//! Converts \b latLong to an irradiance and a prefiltered environment cube
+//! map. If \b cacheDirectory is not empty the results are stored there,
+//! keyed by a hash of the source texels and the options, and loaded instead
+//! of recomputed on later calls.
+//!
+Result ComputeIBLCubeMapsCached(
+    const Bitmap&                latLong,
+    const IBLCubeMapOptions&     options,
+    const std::filesystem::path& cacheDirectory,
+    CubeMap*                     pIrradiance,
+    CubeMap*                     pPrefiltered,
+    JobSystem*                   pJobSystem = nullptr);
+
+} // namespace ppx
+
+#endif // ppx_cube_map_h
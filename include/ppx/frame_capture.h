@@ -0,0 +1,204 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ppx_frame_capture_h
+#define ppx_frame_capture_h
+
+#include "ppx/config.h"
+#include "ppx/grfx/grfx_buffer.h"
+#include "ppx/grfx/grfx_command.h"
+#include "ppx/grfx/grfx_image.h"
+#include "ppx/grfx/grfx_queue.h"
+#include "ppx/grfx/grfx_sync.h"
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace ppx {
+
+enum FrameCaptureEncoding
+{
+    FRAME_CAPTURE_ENCODING_PPM = 0,
+    FRAME_CAPTURE_ENCODING_PNG = 1,
+    //! Tightly packed rows in the format of the captured image, no header.
+    FRAME_CAPTURE_ENCODING_RAW = 2,
+};
+
+//! Parses "ppm", "png" or "raw".
+Result ParseFrameCaptureEncoding(std::string_view valueStr, FrameCaptureEncoding* pEncoding);
+
+//! File extension for \b encoding, including the dot.
+const char* GetFrameCaptureExtension(FrameCaptureEncoding encoding);
+
+//! Parses a "<start>:<count>" frame range, e.g. "100:10" captures frames 100
+//! to 109. A count of 0 captures every frame from start on.
+Result ParseFrameRange(std::string_view valueStr, uint64_t* pStart, uint64_t* pCount);
+
+//! @fn WriteCapturedFrame
+//!
+//! Encodes a 2D image read back from the GPU. PNG supports 8-bit RGBA and
+//! BGRA formats and drops alpha, PPM supports the formats of ExportToPPM()
+//! and RAW supports any uncompressed format.
+//!
+Result WriteCapturedFrame(
+    std::ostream&        outputStream,
+    FrameCaptureEncoding encoding,
+    grfx::Format         format,
+    const void*          pTexels,
+    uint32_t             width,
+    uint32_t             height,
+    uint32_t             rowPitch);
+
+Result WriteCapturedFrame(
+    const std::filesystem::path& path,
+    FrameCaptureEncoding         encoding,
+    grfx::Format                 format,
+    const void*                  pTexels,
+    uint32_t                     width,
+    uint32_t                     height,
+    uint32_t                     rowPitch);
+
+//! @struct FrameCaptureCreateInfo
+//!
+//!
+struct FrameCaptureCreateInfo
+{
+    //! Number of readback buffers. Captures of consecutive frames stall only
+    //! once all of them are waiting for the GPU or the encoder.
+    uint32_t             ringSize = 4;
+    FrameCaptureEncoding encoding = FRAME_CAPTURE_ENCODING_PPM;
+};
+
+//! @class FrameCapture
+//!
+//! Reads images back to the CPU without stalling the render thread. Each
+//! capture takes a buffer of a ring: the copy is recorded on the GPU, the
+//! buffer is mapped once its fence has signaled and the pixels are encoded
+//! and written on a worker thread. Poll() hands completed copies to the
+//! worker and recycles written buffers, call it once per frame.
+//!
+//! Copies can be recorded into the frame's own command buffer with
+//! RecordCopy() followed by SubmitRecordedCopies() after that command
+//! buffer has been submitted, or with Capture() which records and submits
+//! a small command buffer of its own. Neither waits for the GPU.
+//!
+//! Images must be 2D. The ring buffers are sized for the largest image seen
+//! so far and are reallocated when a larger one is captured.
+//!
+class FrameCapture
+{
+public:
+    FrameCapture() {}
+    ~FrameCapture();
+
+    Result Initialize(grfx::Device* pDevice, const FrameCaptureCreateInfo& createInfo);
+    //! Waits for every pending capture to be written.
+    void   Shutdown();
+
+    FrameCaptureEncoding GetEncoding() const { return mCreateInfo.encoding; }
+
+    //! Records a copy of \b pImage, which is in \b imageState and returns to
+    //! it, into \b pCommandBuffer. The capture is written to \b path.
+    Result RecordCopy(
+        grfx::CommandBuffer*         pCommandBuffer,
+        grfx::Image*                 pImage,
+        grfx::ResourceState          imageState,
+        const std::filesystem::path& path);
+
+    //! Marks the copies recorded since the last call as submitted. Must be
+    //! called after the command buffers holding them were submitted to
+    //! \b pQueue.
+    Result SubmitRecordedCopies(grfx::Queue* pQueue);
+
+    //! Records and submits a copy of \b pImage to \b pQueue.
+    Result Capture(
+        grfx::Queue*                 pQueue,
+        grfx::Image*                 pImage,
+        grfx::ResourceState          imageState,
+        const std::filesystem::path& path);
+
+    //! Non blocking. Returns the first error of a failed write, if any.
+    Result Poll();
+
+    //! Blocks until every submitted capture has been written.
+    Result Flush();
+
+    uint64_t GetWrittenCount() const { return mWrittenCount; }
+
+private:
+    enum SlotState
+    {
+        SLOT_STATE_FREE      = 0,
+        SLOT_STATE_RECORDED  = 1, // Copy recorded, fence not yet submitted
+        SLOT_STATE_SUBMITTED = 2, // Waiting for the fence
+        SLOT_STATE_ENCODING  = 3, // Mapped, owned by the encoder thread
+        SLOT_STATE_WRITTEN   = 4, // Ready to be unmapped and reused
+    };
+
+    struct Slot
+    {
+        grfx::BufferPtr        buffer;
+        grfx::CommandBufferPtr commandBuffer;
+        grfx::FencePtr         fence;
+        uint64_t               bufferSize = 0;
+        SlotState              state      = SLOT_STATE_FREE;
+        uint64_t               sequence   = 0; // Submission order
+        grfx::Format           format     = grfx::FORMAT_UNDEFINED;
+        uint32_t               width      = 0;
+        uint32_t               height     = 0;
+        uint32_t               rowPitch   = 0;
+        const void*            pTexels    = nullptr;
+        std::filesystem::path  path;
+        Result                 writeResult = ppx::SUCCESS;
+    };
+
+    Result AcquireSlot(grfx::Image* pImage, uint32_t* pSlotIndex);
+    void   RecordSlotCopy(
+        grfx::CommandBuffer*         pCommandBuffer,
+        uint32_t                     slotIndex,
+        grfx::Image*                 pImage,
+        grfx::ResourceState          imageState,
+        const std::filesystem::path& path);
+    Result CheckSubmitted(bool wait);
+    Result RecycleWritten();
+    void   EncoderThreadFunc();
+
+private:
+    grfx::Device*          mDevice = nullptr;
+    FrameCaptureCreateInfo mCreateInfo;
+    grfx::Queue*           mCommandBufferQueue = nullptr;
+    std::vector<Slot>      mSlots;
+    std::vector<uint32_t>  mRecordedSlots;
+    uint64_t               mNextSequence = 0;
+    uint64_t               mWrittenCount = 0;
+
+    // Encoder thread state, guarded by mEncoderMutex. Slot fields are only
+    // touched by the thread that owns the slot according to its state.
+    std::thread             mEncoderThread;
+    std::mutex              mEncoderMutex;
+    std::condition_variable mEncoderCondition;
+    std::condition_variable mWrittenCondition;
+    std::deque<uint32_t>    mEncodeQueue;
+    bool                    mStopEncoder = false;
+};
+
+} // namespace ppx
+
+#endif // ppx_frame_capture_h
@@ -0,0 +1,345 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ppx_frame_graph_h
+#define ppx_frame_graph_h
+
+#include "ppx/grfx/grfx_config.h"
+#include "ppx/grfx/grfx_command.h"
+#include "ppx/grfx/grfx_draw_pass.h"
+#include "ppx/grfx/grfx_texture.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace ppx {
+
+class FrameGraph;
+class FrameGraphPassContext;
+
+//! @struct FrameGraphResource
+//!
+//! Handle to a texture declared in a FrameGraph. Handles are only valid
+//! until the next call to FrameGraph::Reset().
+//!
+struct FrameGraphResource
+{
+    uint32_t index = UINT32_MAX;
+
+    bool IsValid() const { return index != UINT32_MAX; }
+};
+
+//! @struct FrameGraphTextureDesc
+//!
+//! Description of a transient texture. Usage flags implied by the accesses
+//! declared on the resource are added by the graph; usageFlags only needs to
+//! carry usages the graph cannot see (e.g. copies recorded by hand).
+//!
+struct FrameGraphTextureDesc
+{
+    uint32_t              width           = 0;
+    uint32_t              height          = 0;
+    grfx::Format          format          = grfx::FORMAT_UNDEFINED;
+    uint32_t              mipLevelCount   = 1;
+    uint32_t              arrayLayerCount = 1;
+    grfx::ImageUsageFlags usageFlags      = {};
+};
+
+enum FrameGraphPassType
+{
+    FRAME_GRAPH_PASS_TYPE_GRAPHICS = 0,
+    FRAME_GRAPH_PASS_TYPE_COMPUTE  = 1,
+};
+
+enum FrameGraphLoadOp
+{
+    FRAME_GRAPH_LOAD_OP_LOAD  = 0,
+    FRAME_GRAPH_LOAD_OP_CLEAR = 1,
+};
+
+using FrameGraphExecuteFn = std::function<void(FrameGraphPassContext&)>;
+
+//! @class FrameGraphPassBuilder
+//!
+//! Returned by FrameGraph::AddPass() to declare what the pass reads and
+//! writes. Declarations drive pass ordering, culling, transient texture
+//! lifetimes and barrier placement.
+//!
+//! A read sees the last write declared before it. A read of a transient
+//! texture declared before any pass writes it sees the result of all
+//! writes, so producers may be added after their consumers. A read of an
+//! imported resource declared before any write sees the content the
+//! resource had before the graph ran.
+//!
+//! Accesses declared with RESOURCE_STATE_UNDEFINED only create a dependency,
+//! the pass is then responsible for the state of the resource itself.
+//!
+//! Passes with render targets or a depth stencil get a grfx::DrawPass built
+//! by the graph, which is begun before and ended after the execute callback.
+//!
+class FrameGraphPassBuilder
+{
+public:
+    FrameGraphPassBuilder& Read(
+        FrameGraphResource  resource,
+        grfx::ResourceState state = grfx::RESOURCE_STATE_SHADER_RESOURCE);
+
+    FrameGraphPassBuilder& Write(
+        FrameGraphResource  resource,
+        grfx::ResourceState state);
+
+    FrameGraphPassBuilder& SetRenderTarget(
+        uint32_t                     index,
+        FrameGraphResource           resource,
+        FrameGraphLoadOp             loadOp     = FRAME_GRAPH_LOAD_OP_CLEAR,
+        grfx::RenderTargetClearValue clearValue = {0, 0, 0, 0});
+
+    FrameGraphPassBuilder& SetDepthStencil(
+        FrameGraphResource           resource,
+        FrameGraphLoadOp             loadOp     = FRAME_GRAPH_LOAD_OP_CLEAR,
+        grfx::DepthStencilClearValue clearValue = {1.0f, 0xFF},
+        grfx::ResourceState          state      = grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
+
+    //! Keeps the pass even if nothing it writes is consumed, e.g. for passes
+    //! that write buffers or read back data outside the graph.
+    FrameGraphPassBuilder& SetSideEffect();
+
+private:
+    friend class FrameGraph;
+
+    FrameGraphPassBuilder(FrameGraph* pGraph, uint32_t passIndex)
+        : mGraph(pGraph), mPassIndex(passIndex) {}
+
+private:
+    FrameGraph* mGraph     = nullptr;
+    uint32_t    mPassIndex = 0;
+};
+
+//! @class FrameGraphPassContext
+//!
+//! Passed to execute callbacks; resolves handles to the physical objects
+//! chosen by FrameGraph::Compile().
+//!
+class FrameGraphPassContext
+{
+public:
+    grfx::CommandBuffer* GetCommandBuffer() const { return mCommandBuffer; }
+    grfx::Texture*       GetTexture(FrameGraphResource resource) const;
+    grfx::Image*         GetImage(FrameGraphResource resource) const;
+
+    //! Returns nullptr if the pass did not declare any attachments.
+    grfx::DrawPass* GetDrawPass() const { return mDrawPass; }
+
+private:
+    friend class FrameGraph;
+
+    FrameGraphPassContext(const FrameGraph* pGraph, grfx::CommandBuffer* pCommandBuffer, grfx::DrawPass* pDrawPass)
+        : mGraph(pGraph), mCommandBuffer(pCommandBuffer), mDrawPass(pDrawPass) {}
+
+private:
+    const FrameGraph*    mGraph         = nullptr;
+    grfx::CommandBuffer* mCommandBuffer = nullptr;
+    grfx::DrawPass*      mDrawPass      = nullptr;
+};
+
+//! @struct FrameGraphStats
+//!
+//! transientMemorySize is what the physical textures used by the last
+//! compile occupy; unaliasedTransientMemorySize is what they would occupy
+//! if every transient resource had its own texture.
+//!
+struct FrameGraphStats
+{
+    uint32_t passCount                    = 0;
+    uint32_t culledPassCount              = 0;
+    uint32_t transientResourceCount       = 0;
+    uint32_t physicalTextureCount         = 0;
+    uint64_t transientMemorySize          = 0;
+    uint64_t unaliasedTransientMemorySize = 0;
+};
+
+//! @class FrameGraph
+//!
+//! Declarative layer over DrawPass and RenderPass. A frame is described by
+//! importing the textures that outlive the frame, declaring transient
+//! textures and adding passes with their reads and writes. Compile() then:
+//!   - sorts passes topologically by their read/write dependencies, passes
+//!     that do not depend on each other keep their declaration order,
+//!   - culls passes whose results never reach an imported resource or a
+//!     pass marked as having side effects,
+//!   - computes the lifetime of each transient texture and assigns it a
+//!     physical texture, sharing one texture between transients with the
+//!     same description whose lifetimes do not overlap.
+//! Execute() records the surviving passes. Barriers are requested through
+//! the command buffer's resource state tracker, which batches them, so the
+//! command buffer must have resource state tracking enabled.
+//!
+//! The graph can be rebuilt every frame: Reset() drops passes and resources
+//! but keeps physical textures and draw passes for reuse by later compiles.
+//! Physical textures are shared by every Execute(), applications with more
+//! than one frame in flight should use one FrameGraph per frame.
+//!
+//! grfx has no placed resources, so transients share whole textures rather
+//! than memory ranges. All passes are recorded into the command buffer given
+//! to Execute(); FRAME_GRAPH_PASS_TYPE_COMPUTE only documents intent.
+//!
+class FrameGraph
+{
+public:
+    FrameGraph() {}
+    ~FrameGraph() {}
+
+    Result Initialize(grfx::Device* pDevice);
+    void   Shutdown();
+
+    //! Drops passes and resources declared since the last Reset().
+    void Reset();
+
+    //! Imported resources keep their content across frames and count as
+    //! graph outputs. If finalState is not RESOURCE_STATE_UNDEFINED the
+    //! resource is transitioned to it at the end of Execute().
+    FrameGraphResource ImportTexture(
+        const std::string&  name,
+        grfx::Texture*      pTexture,
+        grfx::ResourceState finalState = grfx::RESOURCE_STATE_UNDEFINED);
+
+    FrameGraphResource ImportImage(
+        const std::string&  name,
+        grfx::Image*        pImage,
+        grfx::ResourceState finalState = grfx::RESOURCE_STATE_UNDEFINED);
+
+    FrameGraphResource CreateTexture(const std::string& name, const FrameGraphTextureDesc& desc);
+
+    FrameGraphPassBuilder AddPass(
+        const std::string&  name,
+        FrameGraphPassType  type,
+        FrameGraphExecuteFn executeFn);
+
+    //! @fn Schedule
+    //!
+    //! Orders and culls passes and plans which transient resources share a
+    //! physical texture, without creating any GPU objects. Compile() calls
+    //! this first; it is public so graphs can be inspected without a device.
+    //! Fails if a transient texture is read but never written or if the
+    //! dependencies form a cycle.
+    //!
+    Result Schedule();
+
+    Result Compile();
+    void   Execute(grfx::CommandBuffer* pCommandBuffer);
+
+    //! Destroys physical textures and draw passes the last compile did not
+    //! use, e.g. after a resize or after an imported texture was recreated.
+    //! The GPU must be done with them.
+    void ReleaseUnusedResources();
+
+    bool IsPassCulled(const std::string& name) const;
+
+    //! Position of the pass in execution order, culled passes included
+    uint32_t GetPassExecutionIndex(const std::string& name) const;
+
+    grfx::Texture* GetTexture(FrameGraphResource resource) const;
+    grfx::Image*   GetImage(FrameGraphResource resource) const;
+
+    const FrameGraphStats& GetStats() const { return mStats; }
+
+private:
+    friend class FrameGraphPassBuilder;
+
+    struct Access
+    {
+        uint32_t            resource = UINT32_MAX;
+        grfx::ResourceState state    = grfx::RESOURCE_STATE_UNDEFINED;
+        bool                read     = false;
+        bool                write    = false;
+    };
+
+    struct Attachment
+    {
+        uint32_t                     resource = UINT32_MAX;
+        FrameGraphLoadOp             loadOp   = FRAME_GRAPH_LOAD_OP_LOAD;
+        grfx::RenderTargetClearValue rtvClear = {};
+        grfx::DepthStencilClearValue dsvClear = {};
+        grfx::ResourceState          state    = grfx::RESOURCE_STATE_UNDEFINED;
+    };
+
+    struct Pass
+    {
+        std::string         name;
+        FrameGraphPassType  type = FRAME_GRAPH_PASS_TYPE_GRAPHICS;
+        FrameGraphExecuteFn executeFn;
+        std::vector<Access> accesses;
+        uint32_t            renderTargetCount                     = 0;
+        Attachment          renderTargets[PPX_MAX_RENDER_TARGETS] = {};
+        Attachment          depthStencil                          = {};
+        bool                sideEffect                            = false;
+        bool                culled                                = false;
+        grfx::DrawPass*     pDrawPass                             = nullptr;
+    };
+
+    // firstPass and lastPass are positions in mExecutionOrder
+    struct Resource
+    {
+        std::string           name;
+        bool                  imported     = false;
+        grfx::Texture*        pTexture     = nullptr;
+        grfx::Image*          pImage       = nullptr;
+        grfx::ResourceState   finalState   = grfx::RESOURCE_STATE_UNDEFINED;
+        FrameGraphTextureDesc desc         = {};
+        grfx::ResourceState   initialState = grfx::RESOURCE_STATE_UNDEFINED;
+        uint32_t              physical     = UINT32_MAX;
+        uint32_t              firstPass    = UINT32_MAX;
+        uint32_t              lastPass     = 0;
+    };
+
+    struct PhysicalTexture
+    {
+        FrameGraphTextureDesc desc         = {};
+        grfx::ResourceState   initialState = grfx::RESOURCE_STATE_UNDEFINED;
+        grfx::TexturePtr      texture;
+        uint32_t              freeAfter = 0;
+        bool                  used      = false;
+    };
+
+    struct CachedDrawPass
+    {
+        grfx::DrawPassCreateInfo2 createInfo = {};
+        grfx::DrawPassPtr         drawPass;
+        bool                      used = false;
+    };
+
+    void   AddAccess(uint32_t passIndex, FrameGraphResource resource, grfx::ResourceState state, bool read, bool write);
+    Result SortPasses();
+    void   CullPasses();
+    void   ComputeLifetimes();
+    void   AssignPhysicalTextures();
+    Result CreatePhysicalTextures();
+    Result AssignDrawPasses();
+    void   RequireAccessStates(grfx::CommandBuffer* pCommandBuffer, const Pass& pass) const;
+
+private:
+    grfx::Device*                mDevice = nullptr;
+    std::vector<Pass>            mPasses;
+    std::vector<uint32_t>        mExecutionOrder;
+    std::vector<Resource>        mResources;
+    std::vector<PhysicalTexture> mPhysicalTextures;
+    std::vector<CachedDrawPass>  mDrawPasses;
+    bool                         mCompiled = false;
+    FrameGraphStats              mStats    = {};
+};
+
+} // namespace ppx
+
+#endif // ppx_frame_graph_h
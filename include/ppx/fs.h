@@ -60,6 +60,8 @@ class File
         STREAM_HANDLE = 1,
         // The file is accessible through an Android asset handle.
         ASSET_HANDLE = 2,
+        // The file is memory mapped by the OS.
+        MAPPED_HANDLE = 3,
     };
 
 public:
@@ -79,6 +81,13 @@ public:
     // - This class supports RAII. File will be closed on destroy.
     bool Open(const std::filesystem::path& path);
 
+    // Same as `File::Open()`, but asks the OS to memory-map regular files.
+    // Falls back to `File::Open()` if the file cannot be mapped (e.g. empty files),
+    // callers must still check `File::IsMapped()`.
+    // Pages of a mapped file are loaded on first access and can be dropped by the OS
+    // under memory pressure, which keeps the resident size of large files bounded.
+    bool OpenMapped(const std::filesystem::path& path);
+
     // Reads `size` bytes from the file into `buffer`.
     // buffer: a pointer to a buffer with at least `count` writable bytes.
     // count: the maximum number of bytes to write to `buffer`.
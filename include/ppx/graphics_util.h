@@ -19,13 +19,17 @@
 #include "ppx/grfx/grfx_queue.h"
 #include "ppx/grfx/grfx_texture.h"
 #include "ppx/bitmap.h"
+#include "ppx/block_compression.h"
+#include "ppx/cube_map.h"
 #include "ppx/geometry.h"
+#include "ppx/mip_generator.h"
 #include "ppx/mipmap.h"
 #include "gli/gli.hpp"
 
 #include <array>
 #include <filesystem>
 #include <type_traits>
+#include <vector>
 
 namespace ppx {
 namespace grfx_util {
@@ -39,11 +43,13 @@ public:
     // clang-format off
     ImageOptions& AdditionalUsage(grfx::ImageUsageFlags flags) { mAdditionalUsage = flags; return *this; }
     ImageOptions& MipLevelCount(uint32_t levelCount) { mMipLevelCount = levelCount; return *this; }
+    ImageOptions& LoadOptions(const BitmapLoadOptions& options) { mLoadOptions = options; return *this; }
     // clang-format on
 
 private:
     grfx::ImageUsageFlags mAdditionalUsage = grfx::ImageUsageFlags();
     uint32_t              mMipLevelCount   = PPX_REMAINING_MIP_LEVELS;
+    BitmapLoadOptions     mLoadOptions     = BitmapLoadOptions();
 
     friend Result CreateImageFromBitmap(
         grfx::Queue*        pQueue,
@@ -113,6 +119,19 @@ Result CreateImageFromBitmapGpu(
 
 // -------------------------------------------------------------------------------------------------
 
+//! @class TextureOptions
+//!
+//! Block compression runs on the JobSystem set with CompressionJobSystem().
+//! Without one, every compressed texture starts and stops its own worker
+//! pool, so callers creating many textures should pass a pool they own.
+//! CreateTexturesFromBitmaps() shares a single pool between its textures.
+//!
+//! Mips are built on the GPU with the generator set by GpuMipGenerator(), or
+//! with the device's default generator (grfx::Device::GetDefaultMipGenerator,
+//! set by the Application) when none is set. The generator must belong to
+//! the device of the queue the texture is created on. Formats the device
+//! cannot write as storage images get CPU mips, GpuMips(false) forces them.
+//!
 class TextureOptions
 {
 public:
@@ -123,12 +142,24 @@ public:
     TextureOptions& AdditionalUsage(grfx::ImageUsageFlags flags) { mAdditionalUsage = flags; return *this; }
     TextureOptions& InitialState(grfx::ResourceState state) { mInitialState = state; return *this; }
     TextureOptions& MipLevelCount(uint32_t levelCount) { mMipLevelCount = levelCount; return *this; }
+    TextureOptions& Compress(grfx::Format format) { mCompressFormat = format; return *this; }
+    TextureOptions& CompressionCacheDirectory(const std::filesystem::path& path) { mCompressionCacheDirectory = path; return *this; }
+    TextureOptions& CompressionJobSystem(JobSystem* pJobSystem) { mCompressionJobSystem = pJobSystem; return *this; }
+    TextureOptions& LoadOptions(const BitmapLoadOptions& options) { mLoadOptions = options; return *this; }
+    TextureOptions& GpuMips(bool enable) { mGpuMips = enable; return *this; }
+    TextureOptions& GpuMipGenerator(MipGenerator* pMipGenerator) { mGpuMipGenerator = pMipGenerator; return *this; }
     // clang-format on
 
 private:
-    grfx::ImageUsageFlags mAdditionalUsage = grfx::ImageUsageFlags();
-    grfx::ResourceState   mInitialState    = grfx::ResourceState::RESOURCE_STATE_SHADER_RESOURCE;
-    uint32_t              mMipLevelCount   = 1;
+    grfx::ImageUsageFlags mAdditionalUsage           = grfx::ImageUsageFlags();
+    grfx::ResourceState   mInitialState              = grfx::ResourceState::RESOURCE_STATE_SHADER_RESOURCE;
+    uint32_t              mMipLevelCount             = 1;
+    grfx::Format          mCompressFormat            = grfx::FORMAT_UNDEFINED;
+    std::filesystem::path mCompressionCacheDirectory = {};
+    JobSystem*            mCompressionJobSystem      = nullptr;
+    BitmapLoadOptions     mLoadOptions               = BitmapLoadOptions();
+    bool                  mGpuMips                   = true;
+    MipGenerator*         mGpuMipGenerator           = nullptr;
 
     friend Result CreateTextureFromBitmap(
         grfx::Queue*          pQueue,
@@ -136,6 +167,19 @@ private:
         grfx::Texture**       ppTexture,
         const TextureOptions& options);
 
+    friend Result CreateTexturesFromBitmaps(
+        grfx::Queue*                      pQueue,
+        const std::vector<const Bitmap*>& bitmaps,
+        std::vector<grfx::TexturePtr>*    pTextures,
+        const TextureOptions&             options);
+
+    friend Result CreateTextureFromBitmapImpl(
+        grfx::Queue*                    pQueue,
+        const Bitmap*                   pBitmap,
+        grfx::Texture**                 ppTexture,
+        const TextureOptions&           options,
+        std::vector<MipGeneratorImage>* pDeferredMips);
+
     friend Result CreateTextureFromMipmap(
         grfx::Queue*          pQueue,
         const Mipmap*         pMipmap,
@@ -147,6 +191,12 @@ private:
         const std::filesystem::path& path,
         grfx::Texture**              ppTexture,
         const TextureOptions&        options);
+
+    friend Result CreateTextureFromCompressedMipmap(
+        grfx::Queue*            pQueue,
+        const CompressedMipmap* pMipmap,
+        grfx::Texture**         ppTexture,
+        const TextureOptions&   options);
 };
 
 //! @fn CreateTextureFromBitmap
@@ -170,6 +220,18 @@ Result CreateTextureFromBitmap(
     grfx::Texture**       ppTexture,
     const TextureOptions& options = TextureOptions());
 
+//! @fn CreateTexturesFromBitmaps
+//!
+//! Creates one texture per bitmap and appends them to pTextures. Mips that
+//! are built on the GPU (see TextureOptions::GpuMipGenerator) are generated for all
+//! textures with a single submit.
+//!
+Result CreateTexturesFromBitmaps(
+    grfx::Queue*                      pQueue,
+    const std::vector<const Bitmap*>& bitmaps,
+    std::vector<grfx::TexturePtr>*    pTextures,
+    const TextureOptions&             options = TextureOptions());
+
 //! @fn CreateTextureFromMipmap
 //!
 //! Mip level count from pMipmap is used. Mip level count from options is ignored.
@@ -180,6 +242,17 @@ Result CreateTextureFromMipmap(
     grfx::Texture**       ppTexture,
     const TextureOptions& options = TextureOptions());
 
+//! @fn CreateTextureFromCompressedMipmap
+//!
+//! Uploads every level of pMipmap with a single copy. Mip level count from
+//! options is ignored, compression options are ignored.
+//!
+Result CreateTextureFromCompressedMipmap(
+    grfx::Queue*            pQueue,
+    const CompressedMipmap* pMipmap,
+    grfx::Texture**         ppTexture,
+    const TextureOptions&   options = TextureOptions());
+
 //! @fn CreateTextureFromFile
 //!
 //!
@@ -322,6 +395,15 @@ Strip Vertical:
     |  5  |
     |_____|
 
+Equirectangular:
+     _________________________
+    |                         |
+    |   latitude-longitude    |
+    |   panorama, 2:1         |
+    |_________________________|
+
+    Not split into cells, the faces are resampled from the panorama.
+
 */
 // clang-format on
 enum CubeImageLayout
@@ -335,6 +417,7 @@ enum CubeImageLayout
     CUBE_IMAGE_LAYOUT_LAT_LONG_VERTICAL      = 6,
     CUBE_IMAGE_LAYOUT_STRIP_HORIZONTAL       = 7,
     CUBE_IMAGE_LAYOUT_STRIP_VERTICAL         = 8,
+    CUBE_IMAGE_LAYOUT_EQUIRECTANGULAR        = 9,
     CUBE_IMAGE_LAYOUT_CROSS_HORIZONTAL       = CUBE_IMAGE_LAYOUT_CROSS_HORIZONTAL_LEFT,
     CUBE_IMAGE_LAYOUT_CROSS_VERTICAL         = CUBE_IMAGE_LAYOUT_CROSS_VERTICAL_TOP,
     CUBE_IMAGE_LAYOUT_LAT_LONG               = CUBE_IMAGE_LAYOUT_LAT_LONG_HORIZONTAL,
@@ -361,21 +444,21 @@ enum CubeFaceOp
 //!
 //! Example - Use subimage 0 with 90 degrees CW rotation for posX face:
 //!   layout = CUBE_IMAGE_LAYOUT_CROSS_HORIZONTAL;
-//!   posX   = PPX_ENCODE_CUBE_FACE(0, CUBE_FACE_OP_ROTATE_90, :CUBE_FACE_OP_NONE);
+//!   posX   = PPX_ENCODE_CUBE_FACE(0, CUBE_FACE_OP_ROTATE_90, CUBE_FACE_OP_NONE);
 //!
 #define PPX_CUBE_OP_MASK           0xFF
 #define PPX_CUBE_OP_SUBIMAGE_SHIFT 0
 #define PPX_CUBE_OP_OP1_SHIFT      8
 #define PPX_CUBE_OP_OP2_SHIFT      16
 
-#define PPX_ENCODE_CUBE_FACE(SUBIMAGE, OP1, OP2)              \
-    (SUBIMAGE & PPX_CUBE_OP_MASK) |                           \
-        ((OP1 & PPX_CUBE_OP_MASK) << PPX_CUBE_OP_OP1_SHIFT) | \
-        ((OP1 & PPX_CUBE_OP_MASK) << PPX_CUBE_OP_OP2_SHIFT)
+#define PPX_ENCODE_CUBE_FACE(SUBIMAGE, OP1, OP2)             \
+    (((SUBIMAGE) & PPX_CUBE_OP_MASK) |                       \
+     (((OP1) & PPX_CUBE_OP_MASK) << PPX_CUBE_OP_OP1_SHIFT) | \
+     (((OP2) & PPX_CUBE_OP_MASK) << PPX_CUBE_OP_OP2_SHIFT))
 
-#define PPX_DECODE_CUBE_FACE_SUBIMAGE(FACE) (FACE >> PPX_CUBE_OP_SUBIMAGE_SHIFT) & PPX_CUBE_OP_MASK
-#define PPX_DECODE_CUBE_FACE_OP1(FACE)      (FACE >> PPX_CUBE_OP_OP1_SHIFT) & PPX_CUBE_OP_MASK
-#define PPX_DECODE_CUBE_FACE_OP2(FACE)      (FACE >> PPX_CUBE_OP_OP2_SHIFT) & PPX_CUBE_OP_MASK
+#define PPX_DECODE_CUBE_FACE_SUBIMAGE(FACE) (((FACE) >> PPX_CUBE_OP_SUBIMAGE_SHIFT) & PPX_CUBE_OP_MASK)
+#define PPX_DECODE_CUBE_FACE_OP1(FACE)      (((FACE) >> PPX_CUBE_OP_OP1_SHIFT) & PPX_CUBE_OP_MASK)
+#define PPX_DECODE_CUBE_FACE_OP2(FACE)      (((FACE) >> PPX_CUBE_OP_OP2_SHIFT) & PPX_CUBE_OP_MASK)
 
 //! @struct CubeMapCreateInfo
 //!
@@ -393,14 +476,48 @@ struct CubeMapCreateInfo
 
 //! @fn CreateCubeMapFromFile
 //!
+//! Grid layouts are split into faces on \b pJobSystem, with the face ops of
+//! \b pCreateInfo applied. The image must divide into square cells and the
+//! cube image keeps the format of the loaded bitmap.
+//! CUBE_IMAGE_LAYOUT_EQUIRECTANGULAR images are resampled into an
+//! R32G32B32A32_FLOAT cube map with a face size of half the image height.
+//! Other layouts fail with ERROR_INVALID_CREATE_ARGUMENT. A null
+//! \b pJobSystem starts a pool for the duration of the call.
 //!
 Result CreateCubeMapFromFile(
     grfx::Queue*                 pQueue,
     const std::filesystem::path& path,
     const CubeMapCreateInfo*     pCreateInfo,
     grfx::Image**                ppImage,
+    const grfx::ImageUsageFlags& additionalImageUsage = grfx::ImageUsageFlags(),
+    JobSystem*                   pJobSystem           = nullptr);
+
+//! @fn CreateCubeMapFromCubeMap
+//!
+//! Uploads every level of \b pCubeMap into an R32G32B32A32_FLOAT cube image.
+//!
+Result CreateCubeMapFromCubeMap(
+    grfx::Queue*                 pQueue,
+    const CubeMap*               pCubeMap,
+    grfx::Image**                ppImage,
     const grfx::ImageUsageFlags& additionalImageUsage = grfx::ImageUsageFlags());
 
+//! @fn CreateIBLCubeMapsFromFile
+//!
+//! Creates an irradiance and a prefiltered environment cube image from a
+//! lat-long image, see ComputeIBLCubeMapsCached(). \b path is either the
+//! image or an *.ibl file, whose environment mip strip provides the base
+//! level. Pass an empty \b cacheDirectory to always filter.
+//!
+Result CreateIBLCubeMapsFromFile(
+    grfx::Queue*                 pQueue,
+    const std::filesystem::path& path,
+    const IBLCubeMapOptions&     options,
+    const std::filesystem::path& cacheDirectory,
+    grfx::Image**                ppIrradianceImage,
+    grfx::Image**                ppEnvironmentImage,
+    JobSystem*                   pJobSystem = nullptr);
+
 // -------------------------------------------------------------------------------------------------
 
 //! @fn CreateMeshFromGeometry
@@ -18,6 +18,8 @@
 #include "ppx/grfx/dx12/dx12_config.h"
 #include "ppx/grfx/grfx_command.h"
 
+#include <atomic>
+
 namespace ppx {
 namespace grfx {
 namespace dx12 {
@@ -31,13 +33,17 @@ public:
 
     typename D3D12GraphicsCommandListPtr::InterfaceType* GetDxCommandList() const { return mCommandList.Get(); }
 
-    virtual Result Begin() override;
-    virtual Result End() override;
-
 private:
+    virtual Result BeginImpl(const grfx::CommandBufferInheritanceInfo* pInheritanceInfo) override;
+    virtual Result EndImpl() override;
+
     virtual void BeginRenderPassImpl(const grfx::RenderPassBeginInfo* pBeginInfo) override;
     virtual void EndRenderPassImpl() override;
 
+    virtual void ExecuteCommandsImpl(
+        uint32_t                          commandBufferCount,
+        const grfx::CommandBuffer* const* ppCommandBuffers) override;
+
     virtual void PushDescriptorImpl(
         grfx::CommandType              pipelineBindPoint,
         const grfx::PipelineInterface* pInterface,
@@ -50,25 +56,13 @@ private:
         const grfx::StorageImageView*  pStorageImageView,
         const grfx::Sampler*           pSampler) override;
 
-public:
-    virtual void TransitionImageLayout(
-        const grfx::Image*  pImage,
-        uint32_t            mipLevel,
-        uint32_t            mipLevelCount,
-        uint32_t            arrayLayer,
-        uint32_t            arrayLayerCount,
-        grfx::ResourceState beforeState,
-        grfx::ResourceState afterState,
-        const grfx::Queue*  pSrcQueue,
-        const grfx::Queue*  pDstQueue) override;
-
-    virtual void BufferResourceBarrier(
-        const grfx::Buffer* pBuffer,
-        grfx::ResourceState beforeState,
-        grfx::ResourceState afterState,
-        const grfx::Queue*  pSrcQueue = nullptr,
-        const grfx::Queue*  pDstQueue = nullptr) override;
+    virtual void ResourceBarrierImpl(
+        uint32_t                   imageBarrierCount,
+        const grfx::ImageBarrier*  pImageBarriers,
+        uint32_t                   bufferBarrierCount,
+        const grfx::BufferBarrier* pBufferBarriers) override;
 
+public:
     virtual void SetViewports(
         uint32_t              viewportCount,
         const grfx::Viewport* pViewports) override;
@@ -127,6 +121,30 @@ public:
         uint32_t groupCountY,
         uint32_t groupCountZ) override;
 
+    virtual void DrawIndirect(
+        const grfx::Buffer* pArgBuffer,
+        uint64_t            offset,
+        uint32_t            drawCount,
+        uint32_t            stride) override;
+
+    virtual void DrawIndexedIndirect(
+        const grfx::Buffer* pArgBuffer,
+        uint64_t            offset,
+        uint32_t            drawCount,
+        uint32_t            stride) override;
+
+    virtual void DrawIndexedIndirectCount(
+        const grfx::Buffer* pArgBuffer,
+        uint64_t            offset,
+        const grfx::Buffer* pCountBuffer,
+        uint64_t            countOffset,
+        uint32_t            maxDrawCount,
+        uint32_t            stride) override;
+
+    virtual void DispatchIndirect(
+        const grfx::Buffer* pArgBuffer,
+        uint64_t            offset) override;
+
     virtual void CopyBufferToBuffer(
         const grfx::BufferToBufferCopyInfo* pCopyInfo,
         grfx::Buffer*                       pSrcBuffer,
@@ -186,14 +204,19 @@ private:
         size_t&                           rdtCountSampler);
 
 private:
-    D3D12GraphicsCommandListPtr    mCommandList;
-    D3D12CommandAllocatorPtr       mCommandAllocator;
-    UINT                           mHeapSizeCBVSRVUAV = 0;
-    UINT                           mHeapSizeSampler   = 0;
-    D3D12DescriptorHeapPtr         mHeapCBVSRVUAV;
-    D3D12DescriptorHeapPtr         mHeapSampler;
-    UINT                           mHeapOffsetCBVSRVUAV      = 0;
-    UINT                           mHeapOffsetSampler        = 0;
+    D3D12GraphicsCommandListPtr mCommandList;
+    D3D12CommandAllocatorPtr    mCommandAllocator;
+    UINT                        mHeapSizeCBVSRVUAV = 0;
+    UINT                        mHeapSizeSampler   = 0;
+    D3D12DescriptorHeapPtr      mHeapCBVSRVUAV;
+    D3D12DescriptorHeapPtr      mHeapSampler;
+
+    // Bundles write their descriptors into the heaps of the primary that
+    // executes them, possibly from several threads at once, so ranges in
+    // the heaps are reserved atomically.
+    dx12::CommandBuffer*           mHeapOwner = nullptr;
+    std::atomic<UINT>              mHeapOffsetCBVSRVUAV      = 0;
+    std::atomic<UINT>              mHeapOffsetSampler        = 0;
     const grfx::PipelineInterface* mCurrentGraphicsInterface = nullptr;
     const grfx::PipelineInterface* mCurrentComputeInterface  = nullptr;
 
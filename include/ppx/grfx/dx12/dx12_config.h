@@ -50,6 +50,7 @@ using DXGIInfoQueuePtr            = CComPtr<IDXGIInfoQueue>;
 using DXGISwapChainPtr            = CComPtr<IDXGISwapChain4>;
 using D3D12CommandAllocatorPtr    = CComPtr<ID3D12CommandAllocator>;
 using D3D12CommandQueuePtr        = CComPtr<ID3D12CommandQueue>;
+using D3D12CommandSignaturePtr    = CComPtr<ID3D12CommandSignature>;
 using D3D12DebugPtr               = CComPtr<ID3D12Debug>;
 using D3D12DescriptorHeapPtr      = CComPtr<ID3D12DescriptorHeap>;
 using D3D12DevicePtr              = CComPtr<ID3D12Device5>;
@@ -19,6 +19,8 @@
 #include "ppx/grfx/dx12/dx12_descriptor_helper.h"
 #include "ppx/grfx/grfx_device.h"
 
+#include <unordered_map>
+
 namespace ppx {
 namespace grfx {
 namespace dx12 {
@@ -59,12 +61,21 @@ public:
         const IID& pRootSignatureDeserializerInterface,
         void**     ppRootSignatureDeserializer);
 
+    //! Returns a command signature for ExecuteIndirect with a single
+    //! argument of \b type and a byte stride of \b stride. Signatures
+    //! are created on first use and cached for the device's lifetime.
+    //!
+    ID3D12CommandSignature* GetIndirectCommandSignature(D3D12_INDIRECT_ARGUMENT_TYPE type, UINT stride);
+
     virtual Result WaitIdle() override;
 
     virtual bool PipelineStatsAvailable() const override;
     virtual bool DynamicRenderingSupported() const override;
     virtual bool IndependentBlendingSupported() const override;
     virtual bool FragmentStoresAndAtomicsSupported() const override;
+    virtual bool MultiDrawIndirectSupported() const override;
+    virtual bool DrawIndirectCountSupported() const override;
+    virtual bool StorageImageWriteSupported(grfx::Format format) const override;
 
 protected:
     virtual Result AllocateObject(grfx::Buffer** ppObject) override;
@@ -117,6 +128,9 @@ private:
     std::mutex                   mQueryResolveMutex;
 
     D3D12_RENDER_PASS_TIER mRenderPassTier;
+
+    std::unordered_map<uint64_t, D3D12CommandSignaturePtr> mIndirectCommandSignatures;
+    std::mutex                                             mIndirectCommandSignatureMutex;
 };
 
 } // namespace dx12
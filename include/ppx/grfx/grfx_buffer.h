@@ -46,6 +46,7 @@ public:
     uint64_t                      GetSize() const { return mCreateInfo.size; }
     uint32_t                      GetStructuredElementStride() const { return mCreateInfo.structuredElementStride; }
     const grfx::BufferUsageFlags& GetUsageFlags() const { return mCreateInfo.usageFlags; }
+    grfx::ResourceState           GetInitialState() const { return mCreateInfo.initialState; }
 
     virtual Result MapMemory(uint64_t offset, void** ppMappedAddress) = 0;
     virtual void   UnmapMemory()                                      = 0;
@@ -37,6 +37,7 @@
 //
 
 #include "ppx/grfx/grfx_config.h"
+#include "ppx/grfx/grfx_resource_state_tracker.h"
 
 namespace ppx {
 namespace grfx {
@@ -162,6 +163,43 @@ struct ImageToImageCopyInfo
     } extent;
 };
 
+//! @struct DrawIndirectCommand
+//!
+//! Layout matches VkDrawIndirectCommand and D3D12_DRAW_ARGUMENTS so
+//! argument buffers written by shaders work on both APIs.
+//!
+struct DrawIndirectCommand
+{
+    uint32_t vertexCount   = 0;
+    uint32_t instanceCount = 0;
+    uint32_t firstVertex   = 0;
+    uint32_t firstInstance = 0;
+};
+
+//! @struct DrawIndexedIndirectCommand
+//!
+//! Layout matches VkDrawIndexedIndirectCommand and D3D12_DRAW_INDEXED_ARGUMENTS.
+//!
+struct DrawIndexedIndirectCommand
+{
+    uint32_t indexCount    = 0;
+    uint32_t instanceCount = 0;
+    uint32_t firstIndex    = 0;
+    int32_t  vertexOffset  = 0;
+    uint32_t firstInstance = 0;
+};
+
+//! @struct DispatchIndirectCommand
+//!
+//! Layout matches VkDispatchIndirectCommand and D3D12_DISPATCH_ARGUMENTS.
+//!
+struct DispatchIndirectCommand
+{
+    uint32_t groupCountX = 0;
+    uint32_t groupCountY = 0;
+    uint32_t groupCountZ = 0;
+};
+
 // -------------------------------------------------------------------------------------------------
 
 struct RenderPassBeginInfo
@@ -170,11 +208,16 @@ struct RenderPassBeginInfo
     // The value of RTVClearCount cannot be less than the number
     // of RTVs in pRenderPass.
     //
+    // If secondaryCommandBuffers is true the contents of the render
+    // pass are recorded in secondary command buffers and the only
+    // command allowed until EndRenderPass is ExecuteCommands.
+    //
     const grfx::RenderPass*      pRenderPass                            = nullptr;
     grfx::Rect                   renderArea                             = {};
     uint32_t                     RTVClearCount                          = 0;
     grfx::RenderTargetClearValue RTVClearValues[PPX_MAX_RENDER_TARGETS] = {0.0f, 0.0f, 0.0f, 0.0f};
     grfx::DepthStencilClearValue DSVClearValue                          = {1.0f, 0xFF};
+    bool                         secondaryCommandBuffers                = false;
 };
 
 // -------------------------------------------------------------------------------------------------
@@ -200,6 +243,27 @@ public:
     grfx::CommandType GetCommandType() const;
 };
 
+//! @struct CommandBufferInheritanceInfo
+//!
+//! Passed to Begin when recording a secondary command buffer.
+//!
+//! \b pRenderPass is the render pass the secondary command buffer will
+//! be executed in. Vulkan only requires it to be compatible, so any of
+//! the render passes of a DrawPass can be used regardless of clear flags.
+//!
+//! \b pPrimaryCommandBuffer is the command buffer that will execute the
+//! secondary command buffer. D3D12 bundles must use the descriptor heaps
+//! of the command list that executes them, so descriptors bound in the
+//! secondary command buffer are written to the primary's heaps. The
+//! primary must have been begun before and the secondary must be executed
+//! before the primary is begun again. Vulkan ignores it.
+//!
+struct CommandBufferInheritanceInfo
+{
+    const grfx::RenderPass* pRenderPass           = nullptr;
+    grfx::CommandBuffer*    pPrimaryCommandBuffer = nullptr;
+};
+
 // -------------------------------------------------------------------------------------------------
 
 namespace internal {
@@ -226,17 +290,62 @@ namespace internal {
 //!
 //! Vulkan does not use 'samplerDescriptorCount' or 'samplerDescriptorCount'.
 //!
+//! Secondary command buffers do not have heaps of their own, see
+//! grfx::CommandBufferInheritanceInfo.
+//!
 struct CommandBufferCreateInfo
 {
     const grfx::CommandPool* pPool                   = nullptr;
     uint32_t                 resourceDescriptorCount = PPX_DEFAULT_RESOURCE_DESCRIPTOR_COUNT;
     uint32_t                 samplerDescriptorCount  = PPX_DEFAULT_SAMPLE_DESCRIPTOR_COUNT;
+    grfx::CommandBufferLevel level                   = grfx::COMMAND_BUFFER_LEVEL_PRIMARY;
 };
 
 } // namespace internal
 
 //! @class CommandBuffer
 //!
+//! Resource state tracking
+//!
+//! Tracking is opt-in, see SetResourceStateTrackingEnabled. When enabled
+//! the command buffer remembers the last known state of every image
+//! subresource and buffer it has transitioned. RequireResourceState
+//! looks up the before state, drops transitions that would not change
+//! anything and defers the rest. Requiring UNORDERED_ACCESS or GENERAL
+//! again is not dropped, it defers a barrier that orders shader writes
+//! made in that state (a UAV barrier on D3D12). Deferred barriers are
+//! recorded as a single batch by FlushBarriers, which is called
+//! automatically before BeginRenderPass, Dispatch, copies and End.
+//!
+//! A resource seen for the first time is assumed to be in the initial
+//! state it was created with. Tracked states persist across Begin so a
+//! command buffer that is re-recorded every frame continues where the
+//! previous recording left off. If a resource is transitioned by a
+//! different command buffer, use SetResourceState to tell the tracker.
+//!
+//! TransitionImageLayout and BufferResourceBarrier keep working while
+//! tracking is enabled, they flush deferred barriers first and update
+//! the tracked state.
+//!
+//! Secondary command buffers
+//!
+//! Secondary command buffers (Vulkan secondary command buffers, D3D12
+//! bundles) record the contents of a render pass that a primary command
+//! buffer begins with RenderPassBeginInfo::secondaryCommandBuffers and
+//! executes with ExecuteCommands. They are begun with the render pass
+//! they continue and cannot begin render passes, record barriers,
+//! queries or copies.
+//!
+//! Viewports and scissors must be set on the primary before beginning
+//! the render pass as well as in each secondary: Vulkan secondaries do
+//! not inherit them and D3D12 bundles cannot set them. Pipeline and
+//! descriptor bindings of the primary are undefined after
+//! ExecuteCommands.
+//!
+//! Every command buffer created by grfx::Queue has its own command pool
+//! (D3D12 command allocator), so different command buffers can be
+//! recorded on different threads without locking. A command buffer
+//! must only be recorded by one thread at a time.
 //!
 class CommandBuffer
     : public grfx::DeviceObject<grfx::internal::CommandBufferCreateInfo>
@@ -245,13 +354,28 @@ public:
     CommandBuffer() {}
     virtual ~CommandBuffer() {}
 
-    virtual Result Begin() = 0;
-    virtual Result End()   = 0;
+    //! @fn Begin
+    //!
+    //! \b pInheritanceInfo is required for secondary command buffers and
+    //! ignored for primary command buffers.
+    //!
+    Result Begin(const grfx::CommandBufferInheritanceInfo* pInheritanceInfo = nullptr);
+    Result End();
 
     void BeginRenderPass(const grfx::RenderPassBeginInfo* pBeginInfo);
     void EndRenderPass();
 
     grfx::CommandType GetCommandType() { return mCreateInfo.pPool->GetCommandType(); }
+    bool              IsSecondary() const { return mCreateInfo.level == grfx::COMMAND_BUFFER_LEVEL_SECONDARY; }
+
+    //! @fn ExecuteCommands
+    //!
+    //! Executes secondary command buffers inside the current render pass,
+    //! which must have been begun with secondaryCommandBuffers set.
+    //!
+    void ExecuteCommands(
+        uint32_t                          commandBufferCount,
+        const grfx::CommandBuffer* const* ppCommandBuffers);
 
     //! @fn TransitionImageLayout
     //!
@@ -265,7 +389,7 @@ public:
     //! D3D12 ignores both \b pSrcQueue and \b pDstQueue since they're not
     //! relevant.
     //!
-    virtual void TransitionImageLayout(
+    void TransitionImageLayout(
         const grfx::Image*  pImage,
         uint32_t            mipLevel,
         uint32_t            mipLevelCount,
@@ -274,18 +398,96 @@ public:
         grfx::ResourceState beforeState,
         grfx::ResourceState afterState,
         const grfx::Queue*  pSrcQueue = nullptr,
-        const grfx::Queue*  pDstQueue = nullptr) = 0;
+        const grfx::Queue*  pDstQueue = nullptr);
 
     //
     // See comment at function \b TransitionImageLayout for details
     // on queue ownership transfer.
     //
-    virtual void BufferResourceBarrier(
+    void BufferResourceBarrier(
         const grfx::Buffer* pBuffer,
         grfx::ResourceState beforeState,
         grfx::ResourceState afterState,
         const grfx::Queue*  pSrcQueue = nullptr,
-        const grfx::Queue*  pDstQueue = nullptr) = 0;
+        const grfx::Queue*  pDstQueue = nullptr);
+
+    // ---------------------------------------------------------------------------------------------
+    // Resource state tracking, see class comment for details
+    // ---------------------------------------------------------------------------------------------
+    void SetResourceStateTrackingEnabled(bool enabled);
+    bool IsResourceStateTrackingEnabled() const { return mResourceStateTrackingEnabled; }
+
+    //! @fn SetResourceState
+    //!
+    //! Tells the tracker the current state of a resource without
+    //! recording a barrier.
+    //!
+    void SetResourceState(
+        const grfx::Image*  pImage,
+        uint32_t            mipLevel,
+        uint32_t            mipLevelCount,
+        uint32_t            arrayLayer,
+        uint32_t            arrayLayerCount,
+        grfx::ResourceState state);
+
+    void SetResourceState(
+        const grfx::Buffer* pBuffer,
+        grfx::ResourceState state);
+
+    grfx::ResourceState GetResourceState(
+        const grfx::Image* pImage,
+        uint32_t           mipLevel   = 0,
+        uint32_t           arrayLayer = 0) const;
+
+    grfx::ResourceState GetResourceState(const grfx::Buffer* pBuffer) const;
+
+    //! @fn RequireResourceState
+    //!
+    //! Defers a transition of the subresources to \b state. Cannot be
+    //! called inside a render pass, require the states a render pass
+    //! needs before beginning it.
+    //!
+    void RequireResourceState(
+        const grfx::Image*  pImage,
+        uint32_t            mipLevel,
+        uint32_t            mipLevelCount,
+        uint32_t            arrayLayer,
+        uint32_t            arrayLayerCount,
+        grfx::ResourceState state);
+
+    void RequireResourceState(
+        const grfx::Buffer* pBuffer,
+        grfx::ResourceState state);
+
+    void RequireResourceState(
+        const grfx::RenderPass* pRenderPass,
+        grfx::ResourceState     renderTargetState,
+        grfx::ResourceState     depthStencilTargetState);
+
+    void RequireResourceState(
+        const grfx::DrawPass* pDrawPass,
+        grfx::ResourceState   renderTargetState,
+        grfx::ResourceState   depthStencilTargetState);
+
+    //! @fn FlushBarriers
+    //!
+    //! Records all deferred barriers as one batch.
+    //!
+    void FlushBarriers();
+
+    //! @fn GetBarrierCount
+    //!
+    //! Number of image and buffer barriers recorded since Begin, including
+    //! the ones recorded by TransitionImageLayout and BufferResourceBarrier.
+    //!
+    uint32_t GetBarrierCount() const { return mBarrierCount; }
+
+    //! @fn GetBarrierBatchCount
+    //!
+    //! Number of barrier commands (vkCmdPipelineBarrier or
+    //! ID3D12GraphicsCommandList::ResourceBarrier) recorded since Begin.
+    //!
+    uint32_t GetBarrierBatchCount() const { return mBarrierBatchCount; }
 
     virtual void SetViewports(
         uint32_t              viewportCount,
@@ -435,6 +637,52 @@ public:
         uint32_t groupCountY,
         uint32_t groupCountZ) = 0;
 
+    //! @fn DrawIndirect
+    //!
+    //! Reads \b drawCount grfx::DrawIndirectCommand structures from
+    //! \b pArgBuffer starting at \b offset, each \b stride bytes apart.
+    //! \b pArgBuffer must be created with usageFlags.bits.indirectBuffer
+    //! and be in RESOURCE_STATE_INDIRECT_ARGUMENT.
+    //!
+    //! If the device does not support multi draw indirect (see
+    //! Device::MultiDrawIndirectSupported) a \b drawCount greater than 1
+    //! is emulated with one indirect draw per command.
+    //!
+    //! D3D12: \b stride must be at least the size of the argument structure.
+    //!
+    virtual void DrawIndirect(
+        const grfx::Buffer* pArgBuffer,
+        uint64_t            offset,
+        uint32_t            drawCount,
+        uint32_t            stride = sizeof(grfx::DrawIndirectCommand)) = 0;
+
+    //
+    // See comment at function \b DrawIndirect for details.
+    //
+    virtual void DrawIndexedIndirect(
+        const grfx::Buffer* pArgBuffer,
+        uint64_t            offset,
+        uint32_t            drawCount,
+        uint32_t            stride = sizeof(grfx::DrawIndexedIndirectCommand)) = 0;
+
+    //! @fn DrawIndexedIndirectCount
+    //!
+    //! Same as DrawIndexedIndirect but the number of draws is read on the
+    //! GPU from a uint32_t at \b countOffset in \b pCountBuffer, clamped
+    //! to \b maxDrawCount. Requires Device::DrawIndirectCountSupported.
+    //!
+    virtual void DrawIndexedIndirectCount(
+        const grfx::Buffer* pArgBuffer,
+        uint64_t            offset,
+        const grfx::Buffer* pCountBuffer,
+        uint64_t            countOffset,
+        uint32_t            maxDrawCount,
+        uint32_t            stride = sizeof(grfx::DrawIndexedIndirectCommand)) = 0;
+
+    virtual void DispatchIndirect(
+        const grfx::Buffer* pArgBuffer,
+        uint64_t            offset) = 0;
+
     virtual void CopyBufferToBuffer(
         const grfx::BufferToBufferCopyInfo* pCopyInfo,
         grfx::Buffer*                       pSrcBuffer,
@@ -492,7 +740,7 @@ public:
         const grfx::DrawPass*           pDrawPass,
         const grfx::DrawPassClearFlags& clearFlags = grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_ALL);
 
-    virtual void TransitionImageLayout(
+    void TransitionImageLayout(
         const grfx::Texture* pTexture,
         uint32_t             mipLevel,
         uint32_t             mipLevelCount,
@@ -503,6 +751,14 @@ public:
         const grfx::Queue*   pSrcQueue = nullptr,
         const grfx::Queue*   pDstQueue = nullptr);
 
+    void RequireResourceState(
+        const grfx::Texture* pTexture,
+        uint32_t             mipLevel,
+        uint32_t             mipLevelCount,
+        uint32_t             arrayLayer,
+        uint32_t             arrayLayerCount,
+        grfx::ResourceState  state);
+
     void TransitionImageLayout(
         grfx::RenderPass*   pRenderPass,
         grfx::ResourceState renderTargetBeforeState,
@@ -550,9 +806,27 @@ public:
     void Draw(const grfx::FullscreenQuad* pQuad, uint32_t setCount, const grfx::DescriptorSet* const* ppSets);
 
 private:
+    virtual Result BeginImpl(const grfx::CommandBufferInheritanceInfo* pInheritanceInfo) = 0;
+    virtual Result EndImpl()                                                             = 0;
+
     virtual void BeginRenderPassImpl(const grfx::RenderPassBeginInfo* pBeginInfo) = 0;
     virtual void EndRenderPassImpl()                                              = 0;
 
+    virtual void ExecuteCommandsImpl(
+        uint32_t                          commandBufferCount,
+        const grfx::CommandBuffer* const* ppCommandBuffers) = 0;
+
+    //
+    // Records \b imageBarrierCount and \b bufferBarrierCount barriers with a
+    // single API call. Barriers that don't change state or queue family are
+    // skipped by the implementation.
+    //
+    virtual void ResourceBarrierImpl(
+        uint32_t                   imageBarrierCount,
+        const grfx::ImageBarrier*  pImageBarriers,
+        uint32_t                   bufferBarrierCount,
+        const grfx::BufferBarrier* pBufferBarriers) = 0;
+
     virtual void PushDescriptorImpl(
         grfx::CommandType              pipelineBindPoint,
         const grfx::PipelineInterface* pInterface,
@@ -565,7 +839,21 @@ private:
         const grfx::StorageImageView*  pStorageImageView,
         const grfx::Sampler*           pSampler) = 0;
 
-    const grfx::RenderPass* mCurrentRenderPass = nullptr;
+    void RecordBarriers(
+        uint32_t                   imageBarrierCount,
+        const grfx::ImageBarrier*  pImageBarriers,
+        uint32_t                   bufferBarrierCount,
+        const grfx::BufferBarrier* pBufferBarriers);
+
+    const grfx::RenderPass* mCurrentRenderPass                 = nullptr;
+    bool                    mCurrentRenderPassUsesSecondaries = false;
+
+    bool                             mResourceStateTrackingEnabled = false;
+    grfx::ResourceStateTracker       mStateTracker;
+    std::vector<grfx::ImageBarrier>  mFlushImageBarriers;
+    std::vector<grfx::BufferBarrier> mFlushBufferBarriers;
+    uint32_t                         mBarrierCount      = 0;
+    uint32_t                         mBarrierBatchCount = 0;
 };
 
 } // namespace grfx
@@ -29,6 +29,7 @@ class Buffer;
 class CommandBuffer;
 class CommandPool;
 class ComputePipeline;
+class CullPass;
 class DescriptorPool;
 class DescriptorSet;
 class DescriptorSet;
@@ -77,6 +78,7 @@ using BufferPtr              = ObjPtr<Buffer>;
 using CommandBufferPtr       = ObjPtr<CommandBuffer>;
 using CommandPoolPtr         = ObjPtr<CommandPool>;
 using ComputePipelinePtr     = ObjPtr<ComputePipeline>;
+using CullPassPtr            = ObjPtr<CullPass>;
 using DescriptorPoolPtr      = ObjPtr<DescriptorPool>;
 using DescriptorSetPtr       = ObjPtr<DescriptorSet>;
 using DescriptorSetLayoutPtr = ObjPtr<DescriptorSetLayout>;
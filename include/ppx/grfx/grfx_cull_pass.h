@@ -0,0 +1,147 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ppx_grfx_cull_pass_h
+#define ppx_grfx_cull_pass_h
+
+#include "ppx/grfx/grfx_buffer.h"
+#include "ppx/grfx/grfx_command.h"
+#include "ppx/grfx/grfx_descriptor.h"
+#include "ppx/grfx/grfx_image.h"
+#include "ppx/grfx/grfx_pipeline.h"
+#include "ppx/bounding_volume.h"
+
+#include <unordered_map>
+
+namespace ppx {
+namespace grfx {
+
+//! @struct CullPassCreateInfo
+//!
+//! \b CS is required. \b HiZCS is optional, occlusion culling is not
+//! available without it. \b depthWidth and \b depthHeight are the
+//! dimensions of the depth buffers passed to CullPass::BuildHiZ.
+//!
+struct CullPassCreateInfo
+{
+    grfx::ShaderStageInfo CS                = {};   // Use basic/shaders/CullPass.hlsl (csmain) for now
+    grfx::ShaderStageInfo HiZCS             = {};   // Use basic/shaders/CullPassHiZ.hlsl (csmain) for now
+    uint32_t              maxInstanceCount  = 0;
+    uint32_t              depthWidth        = 0;
+    uint32_t              depthHeight       = 0;
+    uint32_t              maxDepthViewCount = 3;    // Distinct depth views passed to BuildHiZ, e.g. one per swapchain image
+    bool                  enableCompaction  = true; // Ignored if the device doesn't support DrawIndexedIndirectCount
+};
+
+//! @class CullPass
+//!
+//! GPU instance culling that feeds DrawIndexedIndirect.
+//!
+//! Each instance is a world space bounding box and the draw arguments
+//! to use if it's visible. Cull() tests every instance against the view
+//! frustum and, optionally, against a Hi-Z pyramid built from a depth
+//! buffer by BuildHiZ(). The pyramid is normally built from the previous
+//! frame's depth, so objects that become visible this frame may pop in
+//! one frame late.
+//!
+//! With compaction visible draws are packed to the front of the argument
+//! buffer and their number is written to the count buffer. Without it
+//! every instance keeps its slot and culled draws have an instance count
+//! of 0.
+//!
+//! Usage:
+//!   SetInstances() - whenever the instance set changes, not while a
+//!                    previous Cull() is still executing on the GPU
+//!   Cull()         - outside of a render pass
+//!   Draw()         - inside a render pass, pipeline and buffers bound
+//!   BuildHiZ()     - outside of a render pass, depth in SHADER_RESOURCE
+//!
+class CullPass
+    : public grfx::DeviceObject<grfx::CullPassCreateInfo>
+{
+public:
+    CullPass() {}
+    virtual ~CullPass() {}
+
+    uint32_t        GetInstanceCount() const { return mInstanceCount; }
+    bool            IsCompactionEnabled() const { return mCompactionEnabled; }
+    bool            IsOcclusionSupported() const { return !mHiZPipeline.IsNull(); }
+    grfx::BufferPtr GetDrawArgsBuffer() const { return mDrawArgsBuffer; }
+    grfx::BufferPtr GetDrawCountBuffer() const { return mDrawCountBuffer; }
+    grfx::ImagePtr  GetHiZImage() const { return mHiZImage; }
+
+    Result SetInstances(
+        uint32_t                                instanceCount,
+        const ppx::AABB*                        pBounds,
+        const grfx::DrawIndexedIndirectCommand* pDraws);
+
+    //! @fn void Cull(grfx::CommandBuffer* pCommandBuffer, const float4x4& viewProjectionMatrix, bool enableOcclusion)
+    //!
+    //! Occlusion culling is skipped until BuildHiZ() has been recorded at
+    //! least once.
+    //!
+    void Cull(
+        grfx::CommandBuffer* pCommandBuffer,
+        const float4x4&      viewProjectionMatrix,
+        bool                 enableOcclusion);
+
+    //! @fn void Draw(grfx::CommandBuffer* pCommandBuffer)
+    //!
+    //! Records the indirect draw for the result of the last Cull().
+    //!
+    void Draw(grfx::CommandBuffer* pCommandBuffer);
+
+    void BuildHiZ(
+        grfx::CommandBuffer*          pCommandBuffer,
+        const grfx::SampledImageView* pDepthView);
+
+protected:
+    virtual Result CreateApiObjects(const grfx::CullPassCreateInfo* pCreateInfo) override;
+    virtual void   DestroyApiObjects() override;
+
+private:
+    Result GetHiZDepthDescriptorSet(const grfx::SampledImageView* pDepthView, grfx::DescriptorSet** ppSet);
+
+private:
+    uint32_t                               mInstanceCount     = 0;
+    bool                                   mCompactionEnabled = false;
+    bool                                   mHiZValid          = false;
+    uint32_t                               mHiZMipLevelCount  = 0;
+    grfx::BufferPtr                        mBoundsBuffer;
+    grfx::BufferPtr                        mDrawTemplatesBuffer;
+    grfx::BufferPtr                        mDrawArgsBuffer;
+    grfx::BufferPtr                        mDrawCountBuffer;
+    grfx::BufferPtr                        mZeroBuffer;
+    grfx::ImagePtr                         mHiZImage;
+    grfx::SampledImageViewPtr              mHiZSampledView;
+    std::vector<grfx::SampledImageViewPtr> mHiZMipSampledViews;
+    std::vector<grfx::StorageImageViewPtr> mHiZMipStorageViews;
+    grfx::DescriptorPoolPtr                mDescriptorPool;
+    grfx::DescriptorSetLayoutPtr           mCullDescriptorSetLayout;
+    grfx::DescriptorSetPtr                 mCullDescriptorSet;
+    grfx::PipelineInterfacePtr             mCullPipelineInterface;
+    grfx::ComputePipelinePtr               mCullPipeline;
+    grfx::DescriptorSetLayoutPtr           mHiZDescriptorSetLayout;
+    std::vector<grfx::DescriptorSetPtr>    mHiZMipDescriptorSets;
+    grfx::PipelineInterfacePtr             mHiZPipelineInterface;
+    grfx::ComputePipelinePtr               mHiZPipeline;
+
+    // Level 0 of the pyramid reads from the depth view, keyed by view
+    std::unordered_map<const grfx::SampledImageView*, grfx::DescriptorSetPtr> mHiZDepthDescriptorSets;
+};
+
+} // namespace grfx
+} // namespace ppx
+
+#endif // ppx_grfx_cull_pass_h
@@ -18,6 +18,7 @@
 #include "ppx/grfx/grfx_config.h"
 #include "ppx/grfx/grfx_buffer.h"
 #include "ppx/grfx/grfx_command.h"
+#include "ppx/grfx/grfx_cull_pass.h"
 #include "ppx/grfx/grfx_descriptor.h"
 #include "ppx/grfx/grfx_draw_pass.h"
 #include "ppx/grfx/grfx_fullscreen_quad.h"
@@ -34,6 +35,9 @@
 #include "ppx/grfx/grfx_texture.h"
 
 namespace ppx {
+
+class MipGenerator;
+
 namespace grfx {
 
 //! @struct DeviceCreateInfo
@@ -68,6 +72,12 @@ public:
 
     grfx::GpuPtr GetGpu() const { return mCreateInfo.pGpu; }
 
+    //! Generator the grfx_util texture helpers build mips with when their
+    //! options do not name one. The device does not own it, the owner must
+    //! reset it before destroying the generator.
+    void          SetDefaultMipGenerator(MipGenerator* pMipGenerator) { mDefaultMipGenerator = pMipGenerator; }
+    MipGenerator* GetDefaultMipGenerator() const { return mDefaultMipGenerator; }
+
     const char*    GetDeviceName() const;
     grfx::VendorId GetDeviceVendorId() const;
 
@@ -80,6 +90,9 @@ public:
     Result CreateComputePipeline(const grfx::ComputePipelineCreateInfo* pCreateInfo, grfx::ComputePipeline** ppComputePipeline);
     void   DestroyComputePipeline(const grfx::ComputePipeline* pComputePipeline);
 
+    Result CreateCullPass(const grfx::CullPassCreateInfo* pCreateInfo, grfx::CullPass** ppCullPass);
+    void   DestroyCullPass(const grfx::CullPass* pCullPass);
+
     Result CreateDepthStencilView(const grfx::DepthStencilViewCreateInfo* pCreateInfo, grfx::DepthStencilView** ppDepthStencilView);
     void   DestroyDepthStencilView(const grfx::DepthStencilView* pDepthStencilView);
 
@@ -158,7 +171,8 @@ public:
         const grfx::CommandPool* pPool,
         grfx::CommandBuffer**    ppCommandBuffer,
         uint32_t                 resourceDescriptorCount = PPX_DEFAULT_RESOURCE_DESCRIPTOR_COUNT,
-        uint32_t                 samplerDescriptorCount  = PPX_DEFAULT_SAMPLE_DESCRIPTOR_COUNT);
+        uint32_t                 samplerDescriptorCount  = PPX_DEFAULT_SAMPLE_DESCRIPTOR_COUNT,
+        grfx::CommandBufferLevel level                   = grfx::COMMAND_BUFFER_LEVEL_PRIMARY);
     void FreeCommandBuffer(const grfx::CommandBuffer* pCommandBuffer);
 
     Result AllocateDescriptorSet(grfx::DescriptorPool* pPool, const grfx::DescriptorSetLayout* pLayout, grfx::DescriptorSet** ppSet);
@@ -184,6 +198,11 @@ public:
     virtual bool DynamicRenderingSupported() const = 0;
     virtual bool IndependentBlendingSupported() const = 0;
     virtual bool FragmentStoresAndAtomicsSupported() const = 0;
+    virtual bool MultiDrawIndirectSupported() const = 0;
+    virtual bool DrawIndirectCountSupported() const = 0;
+    //! Images of \b format can be written from shaders through a storage
+    //! image declared without a format qualifier.
+    virtual bool StorageImageWriteSupported(grfx::Format format) const = 0;
 
 protected:
     virtual Result Create(const grfx::DeviceCreateInfo* pCreateInfo) override;
@@ -214,6 +233,7 @@ protected:
     virtual Result AllocateObject(grfx::StorageImageView** ppObject)    = 0;
     virtual Result AllocateObject(grfx::Swapchain** ppObject)           = 0;
 
+    virtual Result AllocateObject(grfx::CullPass** ppObject);
     virtual Result AllocateObject(grfx::DrawPass** ppObject);
     virtual Result AllocateObject(grfx::FullscreenQuad** ppObject);
     virtual Result AllocateObject(grfx::Mesh** ppObject);
@@ -245,6 +265,7 @@ protected:
     std::vector<grfx::CommandBufferPtr>       mCommandBuffers;
     std::vector<grfx::CommandPoolPtr>         mCommandPools;
     std::vector<grfx::ComputePipelinePtr>     mComputePipelines;
+    std::vector<grfx::CullPassPtr>            mCullPasses;
     std::vector<grfx::DepthStencilViewPtr>    mDepthStencilViews;
     std::vector<grfx::DescriptorPoolPtr>      mDescriptorPools;
     std::vector<grfx::DescriptorSetPtr>       mDescriptorSets;
@@ -272,6 +293,7 @@ protected:
     std::vector<grfx::QueuePtr>               mGraphicsQueues;
     std::vector<grfx::QueuePtr>               mComputeQueues;
     std::vector<grfx::QueuePtr>               mTransferQueues;
+    MipGenerator*                             mDefaultMipGenerator = nullptr;
 };
 
 } // namespace grfx
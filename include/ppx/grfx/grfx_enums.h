@@ -183,6 +183,12 @@ enum CompareOp
     COMPARE_OP_ALWAYS           = 7,
 };
 
+enum CommandBufferLevel
+{
+    COMMAND_BUFFER_LEVEL_PRIMARY   = 0,
+    COMMAND_BUFFER_LEVEL_SECONDARY = 1,
+};
+
 enum CommandType
 {
     COMMAND_TYPE_UNDEFINED = 0,
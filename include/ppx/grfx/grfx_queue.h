@@ -70,6 +70,12 @@ public:
         grfx::CommandBuffer** ppCommandBuffer,
         uint32_t              resourceDescriptorCount = PPX_DEFAULT_RESOURCE_DESCRIPTOR_COUNT,
         uint32_t              samplerDescriptorCount  = PPX_DEFAULT_SAMPLE_DESCRIPTOR_COUNT);
+
+    // Secondary command buffers use the descriptor heaps of the primary
+    // command buffer that executes them, see grfx::CommandBufferInheritanceInfo.
+    Result CreateSecondaryCommandBuffer(grfx::CommandBuffer** ppCommandBuffer);
+
+    // Destroys primary and secondary command buffers
     void DestroyCommandBuffer(const grfx::CommandBuffer* pCommandBuffer);
 
     // In place copy of buffer to buffer
@@ -92,6 +98,13 @@ public:
         grfx::ResourceState                             stateBefore,
         grfx::ResourceState                             stateAfter);
 
+private:
+    Result CreateCommandBuffer(
+        grfx::CommandBufferLevel level,
+        uint32_t                 resourceDescriptorCount,
+        uint32_t                 samplerDescriptorCount,
+        grfx::CommandBuffer**    ppCommandBuffer);
+
 private:
     struct CommandSet
     {
@@ -0,0 +1,153 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ppx_grfx_resource_state_tracker_h
+#define ppx_grfx_resource_state_tracker_h
+
+#include "ppx/grfx/grfx_config.h"
+
+#include <unordered_map>
+
+namespace ppx {
+namespace grfx {
+
+//! @struct ImageBarrier
+//!
+//! Transition of a range of image subresources. \b mipLevelCount and
+//! \b arrayLayerCount must be resolved, PPX_REMAINING_MIP_LEVELS and
+//! PPX_REMAINING_ARRAY_LAYERS are not accepted here.
+//!
+struct ImageBarrier
+{
+    const grfx::Image*  pImage          = nullptr;
+    uint32_t            mipLevel        = 0;
+    uint32_t            mipLevelCount   = 0;
+    uint32_t            arrayLayer      = 0;
+    uint32_t            arrayLayerCount = 0;
+    grfx::ResourceState beforeState     = grfx::RESOURCE_STATE_UNDEFINED;
+    grfx::ResourceState afterState      = grfx::RESOURCE_STATE_UNDEFINED;
+    const grfx::Queue*  pSrcQueue       = nullptr;
+    const grfx::Queue*  pDstQueue       = nullptr;
+};
+
+//! @struct BufferBarrier
+//!
+//!
+struct BufferBarrier
+{
+    const grfx::Buffer* pBuffer     = nullptr;
+    grfx::ResourceState beforeState = grfx::RESOURCE_STATE_UNDEFINED;
+    grfx::ResourceState afterState  = grfx::RESOURCE_STATE_UNDEFINED;
+    const grfx::Queue*  pSrcQueue   = nullptr;
+    const grfx::Queue*  pDstQueue   = nullptr;
+};
+
+//! @fn IsUnorderedAccessBarrier
+//!
+//! Returns true for a barrier that keeps a resource in
+//! RESOURCE_STATE_UNORDERED_ACCESS or RESOURCE_STATE_GENERAL. Shaders can
+//! write resources in those states, so such a barrier still orders the
+//! writes before later accesses: Vulkan records a memory barrier and
+//! D3D12 a UAV barrier. Barriers between any other equal states do
+//! nothing and are dropped.
+//!
+bool IsUnorderedAccessBarrier(grfx::ResourceState beforeState, grfx::ResourceState afterState);
+
+//! @class ResourceStateTracker
+//!
+//! Remembers the last known state of image subresources and buffers and
+//! turns state requirements into deferred barriers, see the resource
+//! state tracking section of the CommandBuffer class comment.
+//!
+//! A resource seen for the first time is assumed to be in the initial
+//! state it was created with. Requiring the current state defers
+//! nothing, except for UNORDERED_ACCESS and GENERAL which defer a
+//! barrier ordering earlier writes, see IsUnorderedAccessBarrier.
+//! Requiring a subresource that already has a deferred barrier updates
+//! that barrier instead of adding a second one.
+//!
+class ResourceStateTracker
+{
+public:
+    ResourceStateTracker() {}
+    ~ResourceStateTracker() {}
+
+    //! Forgets all tracked states and deferred barriers
+    void Reset();
+
+    //! Drops deferred barriers, tracked states are kept
+    void ClearPendingBarriers();
+
+    //! Sets the tracked state without deferring a barrier
+    void SetState(
+        const grfx::Image*  pImage,
+        uint32_t            mipLevel,
+        uint32_t            mipLevelCount,
+        uint32_t            arrayLayer,
+        uint32_t            arrayLayerCount,
+        grfx::ResourceState state);
+
+    void SetState(
+        const grfx::Buffer* pBuffer,
+        grfx::ResourceState state);
+
+    grfx::ResourceState GetState(
+        const grfx::Image* pImage,
+        uint32_t           mipLevel,
+        uint32_t           arrayLayer) const;
+
+    grfx::ResourceState GetState(const grfx::Buffer* pBuffer) const;
+
+    void Require(
+        const grfx::Image*  pImage,
+        uint32_t            mipLevel,
+        uint32_t            mipLevelCount,
+        uint32_t            arrayLayer,
+        uint32_t            arrayLayerCount,
+        grfx::ResourceState state);
+
+    void Require(
+        const grfx::Buffer* pBuffer,
+        grfx::ResourceState state);
+
+    bool HasPendingBarriers() const { return !mPendingImageBarriers.empty() || !mPendingBufferBarriers.empty(); }
+
+    //! @fn TakePendingBarriers
+    //!
+    //! Moves the deferred barriers into \b pImageBarriers and
+    //! \b pBufferBarriers, replacing their contents. Transitions that were
+    //! undone before being taken are dropped, and image barriers with the
+    //! same transition on neighbouring subresources are merged: mip levels
+    //! within an array layer first, then array layers with the same mip
+    //! range. A whole image transition ends up as a single barrier.
+    //!
+    void TakePendingBarriers(
+        std::vector<grfx::ImageBarrier>*  pImageBarriers,
+        std::vector<grfx::BufferBarrier>* pBufferBarriers);
+
+private:
+    std::vector<grfx::ResourceState>* GetImageStates(const grfx::Image* pImage);
+
+private:
+    // Image states are indexed by (arrayLayer * mipLevelCount + mipLevel)
+    std::unordered_map<const grfx::Image*, std::vector<grfx::ResourceState>> mImageStates;
+    std::unordered_map<const grfx::Buffer*, grfx::ResourceState>             mBufferStates;
+    std::vector<grfx::ImageBarrier>                                          mPendingImageBarriers;
+    std::vector<grfx::BufferBarrier>                                         mPendingBufferBarriers;
+};
+
+} // namespace grfx
+} // namespace ppx
+
+#endif // ppx_grfx_resource_state_tracker_h
@@ -38,6 +38,8 @@ public:
     Fence() {}
     virtual ~Fence() {}
 
+    //! \b timeout is in nanoseconds. Returns ERROR_WAIT_TIMED_OUT if the
+    //! fence is not signaled in time, so a timeout of 0 polls the fence.
     virtual Result Wait(uint64_t timeout = UINT64_MAX) = 0;
     virtual Result Reset()                             = 0;
 
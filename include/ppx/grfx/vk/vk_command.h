@@ -31,13 +31,17 @@ public:
 
     VkCommandBufferPtr GetVkCommandBuffer() const { return mCommandBuffer; }
 
-    virtual Result Begin() override;
-    virtual Result End() override;
-
 private:
+    virtual Result BeginImpl(const grfx::CommandBufferInheritanceInfo* pInheritanceInfo) override;
+    virtual Result EndImpl() override;
+
     virtual void BeginRenderPassImpl(const grfx::RenderPassBeginInfo* pBeginInfo) override;
     virtual void EndRenderPassImpl() override;
 
+    virtual void ExecuteCommandsImpl(
+        uint32_t                          commandBufferCount,
+        const grfx::CommandBuffer* const* ppCommandBuffers) override;
+
     virtual void PushDescriptorImpl(
         grfx::CommandType              pipelineBindPoint,
         const grfx::PipelineInterface* pInterface,
@@ -50,25 +54,13 @@ private:
         const grfx::StorageImageView*  pStorageImageView,
         const grfx::Sampler*           pSampler) override;
 
-public:
-    virtual void TransitionImageLayout(
-        const grfx::Image*  pImage,
-        uint32_t            mipLevel,
-        uint32_t            mipLevelCount,
-        uint32_t            arrayLayer,
-        uint32_t            arrayLayerCount,
-        grfx::ResourceState beforeState,
-        grfx::ResourceState afterState,
-        const grfx::Queue*  pSrcQueue,
-        const grfx::Queue*  pDstQueue) override;
-
-    virtual void BufferResourceBarrier(
-        const grfx::Buffer* pBuffer,
-        grfx::ResourceState beforeState,
-        grfx::ResourceState afterState,
-        const grfx::Queue*  pSrcQueue = nullptr,
-        const grfx::Queue*  pDstQueue = nullptr) override;
+    virtual void ResourceBarrierImpl(
+        uint32_t                   imageBarrierCount,
+        const grfx::ImageBarrier*  pImageBarriers,
+        uint32_t                   bufferBarrierCount,
+        const grfx::BufferBarrier* pBufferBarriers) override;
 
+public:
     virtual void SetViewports(
         uint32_t              viewportCount,
         const grfx::Viewport* pViewports) override;
@@ -127,6 +119,30 @@ public:
         uint32_t groupCountY,
         uint32_t groupCountZ) override;
 
+    virtual void DrawIndirect(
+        const grfx::Buffer* pArgBuffer,
+        uint64_t            offset,
+        uint32_t            drawCount,
+        uint32_t            stride) override;
+
+    virtual void DrawIndexedIndirect(
+        const grfx::Buffer* pArgBuffer,
+        uint64_t            offset,
+        uint32_t            drawCount,
+        uint32_t            stride) override;
+
+    virtual void DrawIndexedIndirectCount(
+        const grfx::Buffer* pArgBuffer,
+        uint64_t            offset,
+        const grfx::Buffer* pCountBuffer,
+        uint64_t            countOffset,
+        uint32_t            maxDrawCount,
+        uint32_t            stride) override;
+
+    virtual void DispatchIndirect(
+        const grfx::Buffer* pArgBuffer,
+        uint64_t            offset) override;
+
     virtual void CopyBufferToBuffer(
         const grfx::BufferToBufferCopyInfo* pCopyInfo,
         grfx::Buffer*                       pSrcBuffer,
@@ -44,6 +44,9 @@ public:
     virtual bool DynamicRenderingSupported() const override;
     virtual bool IndependentBlendingSupported() const override;
     virtual bool FragmentStoresAndAtomicsSupported() const override;
+    virtual bool MultiDrawIndirectSupported() const override;
+    virtual bool DrawIndirectCountSupported() const override;
+    virtual bool StorageImageWriteSupported(grfx::Format format) const override;
 
     void ResetQueryPoolEXT(
         VkQueryPool queryPool,
@@ -102,6 +105,7 @@ private:
     bool                     mHasExtendedDynamicState   = false;
     bool                     mHasUnrestrictedDepthRange = false;
     bool                     mHasDynamicRendering       = false;
+    bool                     mHasDrawIndirectCount      = false;
     PFN_vkResetQueryPoolEXT  mFnResetQueryPoolEXT       = nullptr;
     uint32_t                 mGraphicsQueueFamilyIndex  = 0;
     uint32_t                 mComputeQueueFamilyIndex   = 0;
@@ -109,7 +113,8 @@ private:
     uint32_t                 mMaxPushDescriptors        = 0;
 };
 
-extern PFN_vkCmdPushDescriptorSetKHR CmdPushDescriptorSetKHR;
+extern PFN_vkCmdPushDescriptorSetKHR        CmdPushDescriptorSetKHR;
+extern PFN_vkCmdDrawIndexedIndirectCountKHR CmdDrawIndexedIndirectCountKHR;
 
 } // namespace vk
 } // namespace grfx
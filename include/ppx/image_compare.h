@@ -0,0 +1,112 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ppx_image_compare_h
+#define ppx_image_compare_h
+
+#include "ppx/config.h"
+#include "ppx/bitmap.h"
+
+namespace ppx {
+
+class JobSystem;
+
+enum ImageCompareMetric
+{
+    IMAGE_COMPARE_METRIC_DIFFERENCE = 0, // Largest channel difference
+    IMAGE_COMPARE_METRIC_SSIM       = 1, // 1 - SSIM
+    IMAGE_COMPARE_METRIC_FLIP       = 2,
+};
+
+//! @struct ImageCompareOptions
+//!
+//!
+struct ImageCompareOptions
+{
+    //! A pixel counts as different if any channel differs by more than this
+    //! many 8-bit steps.
+    uint32_t threshold = 0;
+
+    //! Optional tolerance mask of the size of the images, only its first
+    //! channel is read and 8-bit values are expected. A value of 255 excludes
+    //! the pixel from every metric, other values raise the threshold of that
+    //! pixel to at least the mask value.
+    const Bitmap* pMask = nullptr;
+
+    //! Alpha is ignored by default: swapchain readbacks often leave it
+    //! undefined.
+    bool compareAlpha = false;
+
+    bool computeSSIM = true;
+    bool computeFLIP = false;
+
+    //! Fills ImageCompareResult::heatmap with \b heatmapMetric. FLIP and
+    //! SSIM heatmaps require the metric to be computed.
+    bool               generateHeatmap = false;
+    ImageCompareMetric heatmapMetric   = IMAGE_COMPARE_METRIC_DIFFERENCE;
+};
+
+//! @struct ImageCompareResult
+//!
+//! Errors are normalized to [0, 1] unless noted otherwise. Pixels excluded
+//! by the mask are not counted anywhere.
+//!
+struct ImageCompareResult
+{
+    uint64_t pixelCount          = 0;
+    uint64_t differentPixelCount = 0;
+    float    maxDifference       = 0;
+    double   meanAbsoluteError   = 0;
+    double   meanSquaredError    = 0;
+    //! In dB, infinity if the images are identical.
+    double   psnr                = 0;
+    //! Mean SSIM of 8x8 windows of luma, 1 for identical images.
+    double   ssim                = 1;
+    double   meanFLIP            = 0;
+    float    maxFLIP             = 0;
+    //! RGBA_UINT8, black for no error and white for the largest. Excluded
+    //! pixels are dark blue.
+    Bitmap   heatmap;
+};
+
+//! @fn CompareImages
+//!
+//! Compares \b test against \b reference, which must have the same size.
+//! Both are compared as 8-bit RGBA: other formats are converted first,
+//! float values are clamped to [0, 1].
+//!
+//! - Differences, MSE and PSNR use a SIMD kernel over the 8-bit pixels.
+//! - SSIM is evaluated on BT.601 luma over 8x8 windows placed every 4
+//!   pixels, from integer sums of 4x4 cells.
+//! - FLIP follows the color pipeline of NVIDIA's FLIP: a spatial prefilter
+//!   in YyCxCz, Hunt adjusted HyAB distance in L*a*b* and the same error
+//!   redistribution. The feature term compares Sobel edge strength of the
+//!   luminance instead of FLIP's edge and point detectors, and the filter
+//!   is a fixed 5 tap binomial rather than viewing distance dependent
+//!   contrast sensitivity functions. Values are comparable between runs of
+//!   this implementation, not with the reference FLIP tool. FLIP costs
+//!   far more per pixel than the other metrics and is off by default.
+//!
+//! Rows are split across \b pJobSystem, or a temporary one if null.
+//!
+Result CompareImages(
+    const Bitmap&              reference,
+    const Bitmap&              test,
+    const ImageCompareOptions& options,
+    ImageCompareResult*        pResult,
+    JobSystem*                 pJobSystem = nullptr);
+
+} // namespace ppx
+
+#endif // ppx_image_compare_h
@@ -0,0 +1,77 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ppx_job_system_h
+#define ppx_job_system_h
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ppx {
+
+//! @class JobSystem
+//!
+//! Fixed pool of worker threads that runs batches of jobs. Run() hands out
+//! job indices to the workers and to the calling thread, and returns once
+//! every job of the batch has finished. Jobs of a batch must not call Run()
+//! on the same JobSystem.
+//!
+//! The job function receives the job index and the index of the thread
+//! running it, in [0, GetThreadCount()). The calling thread is always
+//! thread index 0, so per-thread data can be indexed without locking.
+//!
+class JobSystem
+{
+public:
+    using JobFn = std::function<void(uint32_t jobIndex, uint32_t threadIndex)>;
+
+    JobSystem() {}
+    ~JobSystem();
+
+    //! Starts \b workerCount threads in addition to the calling thread.
+    //! A worker count of 0 runs every job on the calling thread.
+    void Initialize(uint32_t workerCount);
+    void Shutdown();
+
+    uint32_t GetThreadCount() const { return static_cast<uint32_t>(mWorkers.size()) + 1; }
+
+    void Run(uint32_t jobCount, const JobFn& fn);
+
+    //! Number of workers that leaves one hardware thread for the calling thread.
+    static uint32_t GetDefaultWorkerCount();
+
+private:
+    void WorkerLoop(uint32_t threadIndex);
+    void RunJobs(uint32_t threadIndex);
+
+private:
+    std::vector<std::thread> mWorkers;
+    std::mutex               mMutex;
+    std::condition_variable  mWakeCondition;
+    std::condition_variable  mDoneCondition;
+    const JobFn*             mFn            = nullptr;
+    uint32_t                 mJobCount      = 0;
+    uint32_t                 mNextJob       = 0;
+    uint32_t                 mFinishedCount = 0;
+    uint64_t                 mBatchId       = 0;
+    bool                     mStopping      = false;
+};
+
+} // namespace ppx
+
+#endif // ppx_job_system_h
@@ -0,0 +1,119 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ppx_mip_generator_h
+#define ppx_mip_generator_h
+
+#include "ppx/config.h"
+#include "ppx/grfx/grfx_command.h"
+#include "ppx/grfx/grfx_descriptor.h"
+#include "ppx/grfx/grfx_image.h"
+#include "ppx/grfx/grfx_pipeline.h"
+#include "ppx/grfx/grfx_queue.h"
+#include "ppx/grfx/grfx_shader.h"
+
+#include <vector>
+
+namespace ppx {
+
+//! @struct MipGeneratorImage
+//!
+//! An image whose mip chain is built from level 0. Every array layer is
+//! processed, which covers texture arrays and the 6 faces of cube maps.
+//!
+struct MipGeneratorImage
+{
+    grfx::Image*        pImage      = nullptr;
+    grfx::ResourceState stateBefore = grfx::RESOURCE_STATE_SHADER_RESOURCE;
+    grfx::ResourceState stateAfter  = grfx::RESOURCE_STATE_SHADER_RESOURCE;
+    //! Level 0 holds sRGB encoded data in a UNORM format: filter in linear
+    //! space and encode the results again.
+    bool srgb = false;
+};
+
+//! @class MipGenerator
+//!
+//! Builds mip chains on the GPU with a compute shader
+//! (assets/basic/shaders/GenerateMips.hlsl). Any number of images is
+//! recorded into one command buffer: all images get level 1 before any gets
+//! level 2, so there is one barrier per level and image rather than a
+//! submit and wait per level. Odd sizes use a box filter with partial
+//! weights so every source texel contributes equally.
+//!
+//! Images must be 2D or cube images created with sampled and storage usage
+//! in a format for which IsFormatSupported() returns true on the
+//! generator's device.
+//!
+//! Views and descriptor sets of a recording are kept until
+//! ReleaseRecordedResources() is called, which must wait until the command
+//! buffer has completed. GenerateMips() records, submits, waits and
+//! releases in one call.
+//!
+class MipGenerator
+{
+public:
+    MipGenerator() {}
+    ~MipGenerator() {}
+
+    //! \b shaderBytecode is GenerateMips.cs compiled for the device's API.
+    Result Initialize(grfx::Device* pDevice, const std::vector<char>& shaderBytecode);
+    void   Shutdown();
+
+    grfx::Device* GetDevice() const { return mDevice; }
+
+    //! Formats the shader can filter. Whether a device can also write them
+    //! through a storage image is checked by the non-static overload.
+    static bool IsFormatFilterable(grfx::Format format);
+
+    //! True if \b format is filterable and the generator's device can write
+    //! it from a compute shader without a format qualifier.
+    bool IsFormatSupported(grfx::Format format) const;
+
+    Result RecordGenerateMips(grfx::CommandBuffer* pCommandBuffer, const std::vector<MipGeneratorImage>& images);
+    void   ReleaseRecordedResources();
+
+    Result GenerateMips(grfx::Queue* pQueue, const std::vector<MipGeneratorImage>& images);
+
+private:
+    struct Dispatch
+    {
+        grfx::SampledImageViewPtr srcView;
+        grfx::StorageImageViewPtr dstView;
+        grfx::DescriptorSetPtr    descriptorSet;
+    };
+
+    struct Batch
+    {
+        grfx::DescriptorPoolPtr descriptorPool;
+        std::vector<Dispatch>   dispatches;
+    };
+
+    Result RecordDispatch(
+        grfx::CommandBuffer*     pCommandBuffer,
+        Batch&                   batch,
+        const MipGeneratorImage& image,
+        uint32_t                 level);
+
+private:
+    grfx::Device*                mDevice = nullptr;
+    grfx::ShaderModulePtr        mShader;
+    grfx::DescriptorSetLayoutPtr mDescriptorSetLayout;
+    grfx::PipelineInterfacePtr   mPipelineInterface;
+    grfx::ComputePipelinePtr     mPipeline;
+    std::vector<Batch>           mBatches;
+};
+
+} // namespace ppx
+
+#endif // ppx_mip_generator_h
@@ -36,6 +36,8 @@ namespace ppx {
 //!   | ... |               |
 //!   +-----+---------------+
 //!
+//! Mipmaps are move-only since the mips reference the shared storage.
+//!
 class Mipmap
 {
 public:
@@ -48,8 +50,19 @@ public:
     // This should only be used for temporary mipmaps which will be destroyed prior to the creation of any new mipmap.
     Mipmap(const Bitmap& bitmap, uint32_t levelCount, bool useStaticPool);
     Mipmap(const Bitmap& bitmap, uint32_t levelCount);
+    // Takes over the storage of \b bitmap as level 0 instead of copying it.
+    Mipmap(Bitmap&& bitmap, uint32_t levelCount, bool useStaticPool);
+    Mipmap(Bitmap&& bitmap, uint32_t levelCount);
+    // Level 0 references the pixels of \b level0, which must outlive the mipmap.
+    Mipmap(const BitmapView& level0, uint32_t levelCount, bool useStaticPool);
+    Mipmap(const BitmapView& level0, uint32_t levelCount);
+    Mipmap(Mipmap&&)      = default;
+    Mipmap(const Mipmap&) = delete;
     ~Mipmap() {}
 
+    Mipmap& operator=(Mipmap&&)      = default;
+    Mipmap& operator=(const Mipmap&) = delete;
+
     // Returns true if there's at least one mip level, format is valid, and storage is valid
     bool IsOk() const;
 
@@ -65,9 +78,17 @@ public:
     static Result   LoadFile(const std::filesystem::path& path, uint32_t baseWidth, uint32_t baseHeight, Mipmap* pMipmap, uint32_t levelCount = PPX_REMAINING_MIP_LEVELS);
     static Result   SaveFile(const std::filesystem::path& path, const Mipmap* pMipmap, uint32_t levelCount = PPX_REMAINING_MIP_LEVELS);
 
+private:
+    // Creates the mips from \b firstLevel on in the storage, level 0 is left
+    // empty when \b firstLevel is 1.
+    void InitializeLevels(uint32_t width, uint32_t height, Bitmap::Format format, uint32_t levelCount, uint32_t firstLevel);
+    // Box filters every level after level 0.
+    void GenerateLevels();
+
 private:
     std::vector<char>   mData;
     std::vector<Bitmap> mMips;
+    bool                mLevel0IsAdopted = false;
 
     // Static, shared-memory pool for temporary mipmap generation.
     // NOTE: This is designed for single-threaded use ONLY as it's an unprotected memory block!
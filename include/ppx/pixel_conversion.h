@@ -0,0 +1,76 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ppx_pixel_conversion_h
+#define ppx_pixel_conversion_h
+
+#include <cstddef>
+#include <cstdint>
+
+// Row conversion kernels shared by Bitmap, the image loaders and the
+// exporters. Every function processes a contiguous run of values or pixels,
+// so callers convert row by row and handle row strides themselves. SIMD
+// paths are selected at compile time (SSE2, SSSE3, AVX2, F16C or NEON) and
+// produce the same results as the scalar fallbacks.
+//
+// Unless noted otherwise source and destination must not overlap.
+
+namespace ppx {
+
+//! Swaps the first and third channel of 4 channel 8-bit pixels,
+//! RGBA <-> BGRA. \b pSrc and \b pDst may be the same.
+void SwizzleRB8(const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount);
+
+//! Drops the fourth channel of 4 channel 8-bit pixels. With \b swapRB the
+//! first and third channel are swapped too, which turns BGRA into RGB.
+//! \b pSrc and \b pDst may be the same.
+void PackRGBA8ToRGB8(const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount, bool swapRB = false);
+
+//! Appends a fourth channel with value \b alpha to 3 channel 8-bit pixels.
+void ExpandRGB8ToRGBA8(const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount, uint8_t alpha = 0xFF);
+
+//! Adds 128 to every byte, mapping signed 8-bit values onto [0, 255].
+//! \b pSrc and \b pDst may be the same.
+void BiasSigned8(const uint8_t* pSrc, uint8_t* pDst, size_t count);
+
+//! Same rounding and special value handling as FloatToHalf().
+void ConvertFloatToHalf(const float* pSrc, uint16_t* pDst, size_t count);
+//! Same results as HalfToFloat().
+void ConvertHalfToFloat(const uint16_t* pSrc, float* pDst, size_t count);
+
+//! Maps [0, 255] to [0, 1].
+void ConvertUnorm8ToFloat(const uint8_t* pSrc, float* pDst, size_t count);
+//! Clamps to [0, 1] and rounds to nearest, NaN becomes 0.
+void ConvertFloatToUnorm8(const float* pSrc, uint8_t* pDst, size_t count);
+//! Maps [0, 65535] to [0, 1].
+void ConvertUnorm16ToFloat(const uint16_t* pSrc, float* pDst, size_t count);
+//! Clamps to [0, 1] and rounds to nearest, NaN becomes 0.
+void ConvertFloatToUnorm16(const float* pSrc, uint16_t* pDst, size_t count);
+
+float SRGBToLinear(float value);
+float LinearToSRGB(float value);
+
+//! Decodes sRGB encoded 8-bit pixels to linear floats. With 4 channels the
+//! fourth is alpha and is converted linearly.
+void DecodeSRGB8(const uint8_t* pSrc, float* pDst, size_t pixelCount, uint32_t channelCount);
+//! Encodes linear float pixels as sRGB 8-bit. With 4 channels the fourth is
+//! alpha and is converted linearly.
+void EncodeSRGB8(const float* pSrc, uint8_t* pDst, size_t pixelCount, uint32_t channelCount);
+
+//! Writes \b pixelCount copies of the \b pixelSize bytes at \b pPixel.
+void FillPixels(void* pDst, const void* pPixel, uint32_t pixelSize, size_t pixelCount);
+
+} // namespace ppx
+
+#endif // ppx_pixel_conversion_h
@@ -0,0 +1,84 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ppx_streaming_texture_h
+#define ppx_streaming_texture_h
+
+#include "ppx/config.h"
+#include "ppx/texture_container.h"
+#include "ppx/grfx/grfx_image.h"
+#include "ppx/grfx/grfx_queue.h"
+
+#include <filesystem>
+#include <vector>
+
+namespace ppx {
+
+//! @class StreamingTexture
+//!
+//! Uploads a DDS or KTX2 file to the GPU one mip level at a time, smallest
+//! level first, copying straight from the memory mapped file. The image is
+//! created with the full mip chain; the sampled image view only covers the
+//! levels that are resident, so the texture can be bound as soon as the
+//! smallest level is uploaded and gains detail as Update() is called.
+//!
+//! Each call to Update() copies at most a byte budget worth of levels (but
+//! always at least one), which bounds both the time spent per frame and the
+//! amount of the file paged in at once.
+//!
+//! When the resident range grows a new view is created. Descriptors that
+//! reference GetSampledImageView() must be rewritten when Update() reports a
+//! change. Previous views are kept alive until Shutdown() since in-flight
+//! frames may still reference them.
+//!
+class StreamingTexture
+{
+public:
+    StreamingTexture() {}
+    ~StreamingTexture() {}
+
+    //! Opens \b path, creates the image in RESOURCE_STATE_SHADER_RESOURCE
+    //! and uploads the smallest levels within \b initialByteBudget.
+    Result Initialize(grfx::Queue* pQueue, const std::filesystem::path& path, uint64_t initialByteBudget = 0);
+    void   Shutdown();
+
+    //! Uploads pending levels, smallest first, within \b byteBudget. Sets
+    //! \b pViewChanged to true if GetSampledImageView() returns a new view.
+    Result Update(uint64_t byteBudget, bool* pViewChanged = nullptr);
+
+    grfx::ImagePtr            GetImage() const { return mImage; }
+    grfx::SampledImageViewPtr GetSampledImageView() const { return mSampledImageView; }
+    //! Most detailed level that can be sampled, 0 once fully resident.
+    uint32_t                  GetResidentLevel() const { return mResidentLevel; }
+    uint32_t                  GetLevelCount() const { return mContainer.GetLevelCount(); }
+    bool                      IsFullyResident() const { return mResidentLevel == 0; }
+    uint64_t                  GetResidentBytes() const { return mResidentBytes; }
+
+private:
+    Result UploadLevels(uint32_t firstLevel, uint32_t levelCount);
+    Result UpdateSampledImageView();
+
+private:
+    grfx::Queue*                           mQueue = nullptr;
+    TextureContainer                       mContainer;
+    grfx::ImagePtr                         mImage;
+    grfx::SampledImageViewPtr              mSampledImageView;
+    std::vector<grfx::SampledImageViewPtr> mRetiredViews;
+    uint32_t                               mResidentLevel = 0;
+    uint64_t                               mResidentBytes = 0;
+};
+
+} // namespace ppx
+
+#endif // ppx_streaming_texture_h
@@ -0,0 +1,106 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ppx_texture_container_h
+#define ppx_texture_container_h
+
+#include "ppx/config.h"
+#include "ppx/fs.h"
+#include "ppx/grfx/grfx_format.h"
+
+#include <filesystem>
+#include <vector>
+
+namespace ppx {
+
+enum TextureContainerType
+{
+    TEXTURE_CONTAINER_TYPE_UNDEFINED = 0,
+    TEXTURE_CONTAINER_TYPE_DDS       = 1,
+    TEXTURE_CONTAINER_TYPE_KTX2      = 2,
+};
+
+//! @struct TextureContainerLevel
+//!
+//! Location of one mip level in the file. Rows are rows of blocks for
+//! compressed formats and rows of texels otherwise; levels smaller than a
+//! block still hold one full block.
+//!
+struct TextureContainerLevel
+{
+    uint32_t width     = 0; // [pixels]
+    uint32_t height    = 0; // [pixels]
+    uint32_t rowStride = 0; // [bytes]
+    uint32_t rowCount  = 0;
+    uint64_t offset    = 0; // [bytes] from the start of the file
+    uint64_t size      = 0; // [bytes]
+};
+
+//! @class TextureContainer
+//!
+//! Reads the header of a DDS or KTX2 file and locates its mip levels
+//! without decoding or copying the payload. The file is memory mapped when
+//! the platform allows it, so level data is only paged in when it is read.
+//! On platforms without mapping the whole file is read into memory.
+//!
+//! Only single layer 2D textures are supported. KTX2 files must not use
+//! supercompression.
+//!
+class TextureContainer
+{
+public:
+    TextureContainer() {}
+    ~TextureContainer() {}
+
+    Result Open(const std::filesystem::path& path);
+
+    bool IsOk() const { return !mLevels.empty(); }
+    bool IsMapped() const { return mFile.IsMapped(); }
+
+    TextureContainerType GetType() const { return mType; }
+    grfx::Format         GetFormat() const { return mFormat; }
+    uint32_t             GetWidth() const { return mLevels.empty() ? 0 : mLevels[0].width; }
+    uint32_t             GetHeight() const { return mLevels.empty() ? 0 : mLevels[0].height; }
+    uint32_t             GetLevelCount() const { return CountU32(mLevels); }
+
+    const TextureContainerLevel& GetLevel(uint32_t level) const;
+    //! Returns a pointer to the tightly packed rows of \b level.
+    const char* GetLevelData(uint32_t level) const;
+
+    //! Returns true if \b path has a .dds or .ktx2 extension.
+    static bool IsContainerFile(const std::filesystem::path& path);
+
+    //! Parses a container already in memory; \b pData must outlive any use
+    //! of the returned level offsets. Exposed for tests.
+    Result Parse(const char* pData, size_t size);
+
+private:
+    Result ParseDDS(const char* pData, size_t size);
+    Result ParseKTX2(const char* pData, size_t size);
+    Result AddLevel(uint32_t level, uint64_t offset, uint64_t size, size_t fileSize);
+
+private:
+    fs::File                           mFile;
+    std::vector<char>                  mFileData;
+    const char*                        mData       = nullptr;
+    TextureContainerType               mType       = TEXTURE_CONTAINER_TYPE_UNDEFINED;
+    grfx::Format                       mFormat     = grfx::FORMAT_UNDEFINED;
+    uint32_t                           mBaseWidth  = 0;
+    uint32_t                           mBaseHeight = 0;
+    std::vector<TextureContainerLevel> mLevels;
+};
+
+} // namespace ppx
+
+#endif // ppx_texture_container_h
@@ -17,6 +17,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <iomanip>
 #include <sstream>
 #include <vector>
@@ -231,6 +232,85 @@ inline std::string FloatString(float value, int precision = 6, int width = 6)
     return ss.str();
 }
 
+//! Converts an IEEE 754 single precision float to half precision, rounding
+//! to nearest even. Values out of range become infinity, NaN stays NaN.
+inline uint16_t FloatToHalf(float value)
+{
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign     = (bits >> 16) & 0x8000;
+    const uint32_t exponent = (bits >> 23) & 0xFF;
+    uint32_t       mantissa = bits & 0x7FFFFF;
+
+    // Inf or NaN
+    if (exponent == 0xFF) {
+        return static_cast<uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    }
+
+    int32_t halfExponent = static_cast<int32_t>(exponent) - 127 + 15;
+    // Overflow
+    if (halfExponent >= 0x1F) {
+        return static_cast<uint16_t>(sign | 0x7C00);
+    }
+    // Denormal or underflow
+    if (halfExponent <= 0) {
+        if (halfExponent < -10) {
+            return static_cast<uint16_t>(sign);
+        }
+        mantissa |= 0x800000;
+        const uint32_t shift   = static_cast<uint32_t>(14 - halfExponent);
+        uint32_t       half    = mantissa >> shift;
+        const uint32_t rest    = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if ((rest > halfway) || ((rest == halfway) && (half & 1))) {
+            ++half;
+        }
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    uint32_t       half = (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+    const uint32_t rest = mantissa & 0x1FFF;
+    if ((rest > 0x1000) || ((rest == 0x1000) && (half & 1))) {
+        // Carry into the exponent is intended, it rounds up to the next
+        // power of two or to infinity.
+        ++half;
+    }
+    return static_cast<uint16_t>(sign | half);
+}
+
+//! Converts a half precision float to single precision. Exact.
+inline float HalfToFloat(uint16_t value)
+{
+    const uint32_t sign     = static_cast<uint32_t>(value & 0x8000) << 16;
+    uint32_t       exponent = (value >> 10) & 0x1F;
+    uint32_t       mantissa = value & 0x3FF;
+
+    uint32_t bits = 0;
+    if (exponent == 0x1F) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else if (exponent != 0) {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    else if (mantissa != 0) {
+        // Denormal, normalize it
+        exponent = 127 - 15 + 1;
+        while ((mantissa & 0x400) == 0) {
+            mantissa <<= 1;
+            --exponent;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+    else {
+        bits = sign;
+    }
+
+    float result = 0;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
 } // namespace ppx
 
 #endif // ppx_util_h
@@ -0,0 +1,339 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ppx_virtual_texture_h
+#define ppx_virtual_texture_h
+
+#include "ppx/config.h"
+#include "ppx/mipmap.h"
+#include "ppx/grfx/grfx_buffer.h"
+#include "ppx/grfx/grfx_command.h"
+#include "ppx/grfx/grfx_draw_pass.h"
+#include "ppx/grfx/grfx_image.h"
+
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ppx {
+
+//! @struct VirtualTextureTile
+//!
+//! Address of a tile in the virtual texture. x and y are in tiles at the
+//! given level.
+//!
+struct VirtualTextureTile
+{
+    uint32_t level = 0;
+    uint32_t x     = 0;
+    uint32_t y     = 0;
+
+    //! Same packing as the value written by the feedback pass, minus one:
+    //! 4 bits of level and 14 bits for each coordinate.
+    uint32_t GetKey() const { return (level << 28) | (y << 14) | x; }
+
+    VirtualTextureTile GetParent() const { return {level + 1, x >> 1, y >> 1}; }
+
+    static VirtualTextureTile FromKey(uint32_t key) { return {key >> 28, key & 0x3FFF, (key >> 14) & 0x3FFF}; }
+};
+
+//! @class VirtualTextureTileSource
+//!
+//! Produces the texels of a tile. ReadTile() is called from the loader
+//! thread and must not touch graphics objects.
+//!
+class VirtualTextureTileSource
+{
+public:
+    virtual ~VirtualTextureTileSource() {}
+
+    //! Writes (tileSize + 2 * border)^2 RGBA8 texels, row by row, covering
+    //! the tile and \b border texels around it. Texels outside the level are
+    //! clamped to the edge.
+    virtual Result ReadTile(const VirtualTextureTile& tile, uint32_t tileSize, uint32_t border, uint8_t* pTexels) = 0;
+};
+
+//! @class MipmapTileSource
+//!
+//! Tile source backed by an RGBA8 Mipmap kept in memory. The mipmap must
+//! outlive the source and have at least as many levels as the virtual
+//! texture.
+//!
+class MipmapTileSource
+    : public VirtualTextureTileSource
+{
+public:
+    MipmapTileSource(const Mipmap* pMipmap)
+        : mMipmap(pMipmap) {}
+
+    virtual Result ReadTile(const VirtualTextureTile& tile, uint32_t tileSize, uint32_t border, uint8_t* pTexels) override;
+
+private:
+    const Mipmap* mMipmap = nullptr;
+};
+
+//! @class VirtualTextureTileCache
+//!
+//! CPU side LRU cache of tile texels. Lookups move the tile to the front;
+//! inserting into a full cache drops the least recently used tile.
+//!
+class VirtualTextureTileCache
+{
+public:
+    VirtualTextureTileCache() {}
+
+    void     SetCapacity(uint32_t tileCount);
+    uint32_t GetCapacity() const { return mCapacity; }
+    uint32_t GetSize() const { return static_cast<uint32_t>(mLookup.size()); }
+
+    //! Returns the tile texels, or nullptr if the tile is not cached.
+    //! Updates the hit and miss counters.
+    const std::vector<uint8_t>* Find(uint32_t key);
+    bool                        Contains(uint32_t key) const { return mLookup.find(key) != mLookup.end(); }
+    void                        Insert(uint32_t key, std::vector<uint8_t>&& texels);
+
+    uint64_t GetHitCount() const { return mHitCount; }
+    uint64_t GetMissCount() const { return mMissCount; }
+    void     ResetCounters();
+
+private:
+    struct Entry
+    {
+        uint32_t             key = 0;
+        std::vector<uint8_t> texels;
+    };
+
+    uint32_t                                                 mCapacity = 0;
+    std::list<Entry>                                         mEntries;
+    std::unordered_map<uint32_t, std::list<Entry>::iterator> mLookup;
+    uint64_t                                                 mHitCount  = 0;
+    uint64_t                                                 mMissCount = 0;
+};
+
+//! @class VirtualTexturePageTable
+//!
+//! Tracks which tiles occupy the slots of the physical atlas and builds the
+//! page table contents. The page table has one mip level per virtual level
+//! and one RGBA8_UINT texel per page: (slot x, slot y, resident level, 1).
+//! Pages whose tile is not resident point to the closest resident ancestor,
+//! so the page table always resolves to something that can be sampled once
+//! the coarsest tile is resident. Texels with alpha 0 have no resident
+//! ancestor.
+//!
+//! Slots are recycled least recently used first. Tiles touched during the
+//! current frame and pinned tiles are never evicted.
+//!
+class VirtualTexturePageTable
+{
+public:
+    VirtualTexturePageTable() {}
+
+    //! \b pageCountX and \b pageCountY are the page counts of level 0 and
+    //! must be powers of two. Slot counts are limited to 256 per axis.
+    Result Initialize(uint32_t pageCountX, uint32_t pageCountY, uint32_t slotCountX, uint32_t slotCountY);
+
+    uint32_t GetLevelCount() const { return mLevelCount; }
+    uint32_t GetPageCountX(uint32_t level) const { return std::max<uint32_t>(mPageCountX >> level, 1); }
+    uint32_t GetPageCountY(uint32_t level) const { return std::max<uint32_t>(mPageCountY >> level, 1); }
+    uint32_t GetSlotCount() const { return CountU32(mSlots); }
+    uint32_t GetResidentCount() const { return static_cast<uint32_t>(mLookup.size()); }
+    bool     IsValid(const VirtualTextureTile& tile) const;
+
+    bool IsResident(const VirtualTextureTile& tile) const { return mLookup.find(tile.GetKey()) != mLookup.end(); }
+    //! Marks a resident tile as used during \b frame. Returns false if the
+    //! tile is not resident.
+    bool Touch(const VirtualTextureTile& tile, uint64_t frame);
+    //! Assigns a slot to \b tile. Returns false if every slot holds a tile
+    //! that is pinned or was used during \b frame.
+    bool Allocate(const VirtualTextureTile& tile, uint64_t frame, bool pinned, uint32_t* pSlotX, uint32_t* pSlotY);
+
+    bool IsDirty() const { return mDirty; }
+    void ClearDirty() { mDirty = false; }
+
+    //! Entry offset of \b level in the array written by BuildEntries().
+    uint32_t GetLevelOffset(uint32_t level) const { return mLevelOffsets[level]; }
+    //! Writes every level, level 0 first, rows of pages tightly packed.
+    void     BuildEntries(std::vector<uint32_t>& entries) const;
+
+private:
+    struct Slot
+    {
+        uint32_t key           = UINT32_MAX;
+        uint64_t lastUsedFrame = 0;
+        bool     pinned        = false;
+    };
+
+    uint32_t                               mPageCountX = 0;
+    uint32_t                               mPageCountY = 0;
+    uint32_t                               mLevelCount = 0;
+    uint32_t                               mSlotCountX = 0;
+    std::vector<uint32_t>                  mLevelOffsets;
+    std::vector<Slot>                      mSlots;
+    std::unordered_map<uint32_t, uint32_t> mLookup; // key -> slot index
+    bool                                   mDirty = false;
+};
+
+//! @struct VirtualTextureCreateInfo
+//!
+//! width and height must be tileSize times a power of two. The feedback
+//! target is renderWidth x renderHeight divided by feedbackDivisor.
+//!
+struct VirtualTextureCreateInfo
+{
+    uint32_t                  width              = 0;   // [texels]
+    uint32_t                  height             = 0;   // [texels]
+    uint32_t                  tileSize           = 128; // [texels] excluding the border
+    uint32_t                  tileBorder         = 1;   // [texels] on each side
+    grfx::Format              format             = grfx::FORMAT_R8G8B8A8_UNORM;
+    uint32_t                  atlasTileCountX    = 16;
+    uint32_t                  atlasTileCountY    = 16;
+    uint32_t                  cacheTileCount     = 512;
+    uint32_t                  maxUploadsPerFrame = 8;
+    uint32_t                  maxPendingLoads    = 256;
+    uint32_t                  renderWidth        = 0;
+    uint32_t                  renderHeight       = 0;
+    uint32_t                  feedbackDivisor    = 8;
+    uint32_t                  frameCount         = 1;
+    VirtualTextureTileSource* pSource            = nullptr;
+};
+
+//! @struct VirtualTextureShaderParams
+//!
+//! Matches VirtualTextureParams in VirtualTexture.hlsli.
+//!
+struct VirtualTextureShaderParams
+{
+    float    virtualSize[2];
+    float    pageCount[2];
+    float    atlasSize[2];
+    float    tileSize;
+    float    tileBorder;
+    uint32_t maxLevel;
+    float    feedbackLodBias;
+    float    padding[2];
+};
+
+//! @struct VirtualTextureStats
+//!
+//! Counters for the last call to VirtualTexture::Update().
+//!
+struct VirtualTextureStats
+{
+    uint32_t requestedTiles = 0; // Unique tiles in the feedback
+    uint32_t residentHits   = 0; // Requested tiles already in the atlas
+    uint32_t cacheHits      = 0; // Missing tiles found in the CPU cache
+    uint32_t cacheMisses    = 0; // Missing tiles sent to the loader
+    uint32_t uploadedTiles  = 0;
+    uint64_t uploadedBytes  = 0; // Atlas and page table bytes staged
+    uint32_t residentTiles  = 0;
+    uint32_t pendingLoads   = 0;
+
+    float GetPageHitRate() const { return (requestedTiles > 0) ? static_cast<float>(residentHits) / static_cast<float>(requestedTiles) : 1.0f; }
+    float GetCacheHitRate() const { return ((cacheHits + cacheMisses) > 0) ? static_cast<float>(cacheHits) / static_cast<float>(cacheHits + cacheMisses) : 1.0f; }
+};
+
+//! @class VirtualTexture
+//!
+//! Tile based virtual texture built from ordinary images, so it runs on any
+//! device including software rasterizers: a physical tile atlas, a page
+//! table texture and a feedback render target.
+//!
+//! Each frame the application:
+//!   1. waits for the frame's fence and calls Update(), which reads back
+//!      the feedback of that frame, queues missing tiles on the loader
+//!      thread and stages tiles that are ready along with the page table,
+//!   2. calls RecordUploads() outside of any render pass,
+//!   3. renders the scene into GetFeedbackDrawPass() with a shader that
+//!      outputs VirtualTextureFeedback() and calls RecordFeedbackReadback(),
+//!   4. renders the scene sampling with SampleVirtualTexture().
+//!
+//! Uploads are recorded into the application's command buffer; at most
+//! maxUploadsPerFrame tiles are uploaded per frame, coarsest first. The
+//! coarsest tile is loaded during Initialize() and stays resident.
+//!
+class VirtualTexture
+{
+public:
+    VirtualTexture() {}
+    ~VirtualTexture() {}
+
+    Result Initialize(grfx::Device* pDevice, const VirtualTextureCreateInfo& createInfo);
+    void   Shutdown();
+
+    Result Update(uint32_t frameIndex);
+    void   RecordUploads(grfx::CommandBuffer* pCommandBuffer, uint32_t frameIndex);
+    void   RecordFeedbackReadback(grfx::CommandBuffer* pCommandBuffer, uint32_t frameIndex);
+
+    grfx::DrawPassPtr          GetFeedbackDrawPass() const { return mFeedbackDrawPass; }
+    grfx::SampledImageViewPtr  GetPageTableView() const { return mPageTableView; }
+    grfx::SampledImageViewPtr  GetAtlasView() const { return mAtlasView; }
+    VirtualTextureShaderParams GetShaderParams() const;
+    const VirtualTextureStats& GetStats() const { return mStats; }
+
+private:
+    struct PerFrame
+    {
+        grfx::BufferPtr                          stagingBuffer;
+        grfx::BufferPtr                          feedbackBuffer;
+        uint32_t                                 feedbackRowPitch = 0;
+        bool                                     feedbackPending  = false;
+        std::vector<grfx::BufferToImageCopyInfo> atlasCopies;
+        std::vector<grfx::BufferToImageCopyInfo> pageTableCopies;
+    };
+
+    uint32_t GetPhysicalTileSize() const { return mCreateInfo.tileSize + 2 * mCreateInfo.tileBorder; }
+    void     ReadFeedback(PerFrame& frame, std::vector<uint32_t>& requests);
+    void     StageTile(PerFrame& frame, char* pStagingData, uint32_t slotX, uint32_t slotY, const std::vector<uint8_t>& texels);
+    void     StagePageTable(PerFrame& frame, char* pStagingData);
+    void     QueueLoads(const std::vector<uint32_t>& keys);
+    void     LoaderThreadFunc();
+
+private:
+    grfx::Device*            mDevice = nullptr;
+    VirtualTextureCreateInfo mCreateInfo;
+    VirtualTexturePageTable  mPageTable;
+    VirtualTextureTileCache  mCache;
+    VirtualTextureStats      mStats;
+    uint64_t                 mFrameNumber            = 0;
+    uint32_t                 mRowStrideAlignment     = 1;
+    uint32_t                 mOffsetAlignment        = 1;
+    uint64_t                 mTileStagingSize        = 0; // [bytes] per tile
+    uint64_t                 mPageTableStagingOffset = 0; // [bytes] after the tiles
+
+    grfx::ImagePtr            mAtlas;
+    grfx::SampledImageViewPtr mAtlasView;
+    grfx::ImagePtr            mPageTableImage;
+    grfx::SampledImageViewPtr mPageTableView;
+    grfx::DrawPassPtr         mFeedbackDrawPass;
+    std::vector<PerFrame>     mPerFrame;
+    std::vector<uint32_t>     mPageTableEntries;
+
+    // Loader thread state, guarded by mLoaderMutex
+    std::thread                                            mLoaderThread;
+    std::mutex                                             mLoaderMutex;
+    std::condition_variable                                mLoaderCondition;
+    std::deque<uint32_t>                                   mLoadQueue;
+    std::unordered_set<uint32_t>                           mQueuedKeys;
+    std::vector<std::pair<uint32_t, std::vector<uint8_t>>> mCompletedLoads;
+    bool                                                   mStopLoader = false;
+};
+
+} // namespace ppx
+
+#endif // ppx_virtual_texture_h
@@ -14,6 +14,7 @@
 
 #include "ppx/ppx.h"
 #include "ppx/graphics_util.h"
+#include "ppx/streaming_texture.h"
 using namespace ppx;
 
 #if defined(USE_DX12)
@@ -22,6 +23,9 @@ const grfx::Api kApi = grfx::API_DX_12_0;
 const grfx::Api kApi = grfx::API_VK_1_1;
 #endif
 
+// Upper bound on the texture data uploaded per frame with --stream-textures.
+constexpr uint64_t kStreamingBytesPerFrame = 256 * 1024;
+
 struct ShapeDesc
 {
     const char* texturePath;
@@ -46,6 +50,7 @@ public:
     virtual void Config(ppx::ApplicationSettings& settings) override;
     virtual void Setup() override;
     virtual void Render() override;
+    virtual void Shutdown() override;
 
 private:
     struct PerFrame
@@ -66,6 +71,8 @@ private:
         ppx::grfx::SamplerPtr          sampler;
         ppx::grfx::SampledImageViewPtr sampledImageView;
         float3                         homeLoc;
+
+        std::unique_ptr<ppx::StreamingTexture> streamingTexture;
     };
 
     std::vector<PerFrame>             mPerFrame;
@@ -78,6 +85,10 @@ private:
     ppx::grfx::DescriptorSetLayoutPtr mDescriptorSetLayout;
     grfx::VertexBinding               mVertexBinding;
     std::vector<TexturedShape>        mShapes;
+    bool                              mStreamTextures = false;
+
+private:
+    void UpdateStreamingTextures();
 };
 
 void ProjApp::Config(ppx::ApplicationSettings& settings)
@@ -91,6 +102,10 @@ void ProjApp::Config(ppx::ApplicationSettings& settings)
 
 void ProjApp::Setup()
 {
+    // Stream mip levels from the memory mapped files, smallest first, instead of loading them up front.
+    const auto& clOptions = GetExtraOptions();
+    mStreamTextures       = clOptions.HasExtraOption("stream-textures") && clOptions.GetExtraOptionValueOrDefault<bool>("stream-textures", true);
+
     // Uniform buffer
     int id = 1;
     for (const auto& texture : textures) {
@@ -105,11 +120,21 @@ void ProjApp::Setup()
 
         // Texture image, view, and sampler
         {
-            grfx_util::ImageOptions options = grfx_util::ImageOptions().MipLevelCount(PPX_REMAINING_MIP_LEVELS);
-            PPX_CHECKED_CALL(grfx_util::CreateImageFromFile(GetDevice()->GetGraphicsQueue(), GetAssetPath(texture.texturePath), &shape.image));
+            if (mStreamTextures) {
+                // Only the smallest level is uploaded here, the rest arrives in Render()
+                shape.streamingTexture = std::make_unique<StreamingTexture>();
+                PPX_CHECKED_CALL(shape.streamingTexture->Initialize(GetDevice()->GetGraphicsQueue(), GetAssetPath(texture.texturePath)));
+
+                shape.image            = shape.streamingTexture->GetImage();
+                shape.sampledImageView = shape.streamingTexture->GetSampledImageView();
+            }
+            else {
+                grfx_util::ImageOptions options = grfx_util::ImageOptions().MipLevelCount(PPX_REMAINING_MIP_LEVELS);
+                PPX_CHECKED_CALL(grfx_util::CreateImageFromFile(GetDevice()->GetGraphicsQueue(), GetAssetPath(texture.texturePath), &shape.image));
 
-            grfx::SampledImageViewCreateInfo viewCreateInfo = grfx::SampledImageViewCreateInfo::GuessFromImage(shape.image);
-            PPX_CHECKED_CALL(GetDevice()->CreateSampledImageView(&viewCreateInfo, &shape.sampledImageView));
+                grfx::SampledImageViewCreateInfo viewCreateInfo = grfx::SampledImageViewCreateInfo::GuessFromImage(shape.image);
+                PPX_CHECKED_CALL(GetDevice()->CreateSampledImageView(&viewCreateInfo, &shape.sampledImageView));
+            }
 
             grfx::SamplerCreateInfo samplerCreateInfo = {};
             samplerCreateInfo.magFilter               = grfx::FILTER_LINEAR;
@@ -122,7 +147,7 @@ void ProjApp::Setup()
 
         shape.homeLoc = texture.homeLoc;
         shape.id      = id++;
-        mShapes.push_back(shape);
+        mShapes.push_back(std::move(shape));
     }
 
     // Descriptor
@@ -302,6 +327,11 @@ void ProjApp::Render()
     // Wait for and reset render complete fence
     PPX_CHECKED_CALL(frame.renderCompleteFence->WaitAndReset());
 
+    // Descriptor sets are no longer in use, more detailed views can be bound.
+    if (mStreamTextures) {
+        UpdateStreamingTextures();
+    }
+
     // Update uniform buffers.
     for (auto& shape : mShapes) {
         float    t   = GetElapsedSeconds();
@@ -367,4 +397,43 @@ void ProjApp::Render()
     PPX_CHECKED_CALL(swapchain->Present(imageIndex, 1, &frame.renderCompleteSemaphore));
 }
 
+void ProjApp::Shutdown()
+{
+    for (auto& shape : mShapes) {
+        if (shape.streamingTexture) {
+            shape.streamingTexture->Shutdown();
+        }
+    }
+}
+
+void ProjApp::UpdateStreamingTextures()
+{
+    // The budget is shared by all textures so the per-frame cost stays bounded.
+    uint64_t budget = kStreamingBytesPerFrame;
+    for (auto& shape : mShapes) {
+        if (!shape.streamingTexture || shape.streamingTexture->IsFullyResident()) {
+            continue;
+        }
+
+        const uint64_t residentBytes = shape.streamingTexture->GetResidentBytes();
+        bool           viewChanged   = false;
+        PPX_CHECKED_CALL(shape.streamingTexture->Update(budget, &viewChanged));
+        if (viewChanged) {
+            shape.sampledImageView = shape.streamingTexture->GetSampledImageView();
+
+            grfx::WriteDescriptor write = {};
+            write.binding               = 1;
+            write.type                  = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            write.pImageView            = shape.sampledImageView;
+            PPX_CHECKED_CALL(shape.descriptorSet->UpdateDescriptors(1, &write));
+        }
+
+        const uint64_t uploaded = shape.streamingTexture->GetResidentBytes() - residentBytes;
+        budget -= std::min(budget, uploaded);
+        if (budget == 0) {
+            break;
+        }
+    }
+}
+
 SETUP_APPLICATION(ProjApp)
\ No newline at end of file
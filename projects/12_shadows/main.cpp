@@ -25,6 +25,18 @@ const grfx::Api kApi = grfx::API_VK_1_1;
 
 #define kShadowMapSize 1024
 
+// Must match MAX_CASCADE_COUNT in DiffuseShadow.hlsl
+static const uint32_t kMaxCascadeCount = 4;
+
+// Cascades cover the camera's view from its near plane out to this depth
+static const float kShadowDistance = 40.0f;
+
+// Casters between the light and the bounds of a cascade still need to
+// land in its shadow map, so the near plane is pulled back by this much
+static const float kShadowCasterMargin = 20.0f;
+
+static const float kDefaultCascadeSplitLambda = 0.75f;
+
 class ProjApp
     : public ppx::Application
 {
@@ -34,6 +46,8 @@ public:
     virtual void Render() override;
 
 protected:
+    virtual void SetupMetrics() override;
+    virtual void UpdateMetrics() override;
     virtual void DrawGui() override;
 
 private:
@@ -44,18 +58,40 @@ private:
         grfx::FencePtr         imageAcquiredFence;
         grfx::SemaphorePtr     renderCompleteSemaphore;
         grfx::FencePtr         renderCompleteFence;
+        grfx::QueryPtr         timestampQuery; // Start and end of every cascade
     };
 
     struct Entity
     {
-        float3                 translate = float3(0, 0, 0);
-        float3                 rotate    = float3(0, 0, 0);
-        float3                 scale     = float3(1, 1, 1);
+        float3                 translate       = float3(0, 0, 0);
+        float3                 rotate          = float3(0, 0, 0);
+        float3                 scale           = float3(1, 1, 1);
+        float4x4               modelMatrix     = float4x4(0);
+        float4x4               prevModelMatrix = float4x4(0);
+        bool                   moved           = false;
+        float3                 boundsCenter    = float3(0); // Object space bounding sphere
+        float                  boundsRadius    = 0;
         grfx::MeshPtr          mesh;
         grfx::DescriptorSetPtr drawDescriptorSet;
         grfx::BufferPtr        drawUniformBuffer;
-        grfx::DescriptorSetPtr shadowDescriptorSet;
-        grfx::BufferPtr        shadowUniformBuffer;
+        grfx::DescriptorSetPtr shadowDescriptorSets[kMaxCascadeCount];
+        grfx::BufferPtr        shadowUniformBuffers[kMaxCascadeCount];
+    };
+
+    struct Cascade
+    {
+        grfx::DepthStencilViewPtr depthStencilView; // Layer of the shadow image
+        grfx::RenderPassPtr       renderPass;
+        float                     splitDepth           = 0;           // Camera view depth where the cascade ends
+        float2                    boundsMin            = float2(0);   // Light view space XY bounds of the projection
+        float2                    boundsMax            = float2(0);   // Light view space XY bounds of the projection
+        float                     nearDepth            = 0;           // Light view depth range of the projection
+        float                     farDepth             = 0;           // Light view depth range of the projection
+        float4x4                  viewProjectionMatrix = float4x4(0); // Light's view projection matrix
+        bool                      cached               = false;       // Shadow map is up to date
+        bool                      rendered             = false;       // Shadow map is redrawn this frame
+        uint32_t                  drawCount            = 0;           // Casters drawn this frame
+        uint64_t                  gpuTime              = 0;           // Timestamp ticks of the previous frame
     };
 
     std::vector<PerFrame>        mPerFrame;
@@ -72,17 +108,31 @@ private:
     grfx::DescriptorSetLayoutPtr mShadowSetLayout;
     grfx::PipelineInterfacePtr   mShadowPipelineInterface;
     grfx::GraphicsPipelinePtr    mShadowPipeline;
-    grfx::RenderPassPtr          mShadowRenderPass;
+    grfx::ImagePtr               mShadowImage; // One layer per cascade
     grfx::SampledImageViewPtr    mShadowImageView;
     grfx::SamplerPtr             mShadowSampler;
+    Cascade                      mCascades[kMaxCascadeCount];
+    float4x4                     mLightViewMatrix    = float4x4(1);
+    int                          mCascadeCount       = static_cast<int>(kMaxCascadeCount);
+    float                        mCascadeSplitLambda = kDefaultCascadeSplitLambda;
+    bool                         mCacheShadows       = true;
+    bool                         mVisualizeCascades  = false;
+    uint32_t                     mShadowDrawCount    = 0;
 
     grfx::DescriptorSetLayoutPtr mLightSetLayout;
     grfx::PipelineInterfacePtr   mLightPipelineInterface;
     grfx::GraphicsPipelinePtr    mLightPipeline;
     Entity                       mLight;
-    float3                       mLightPosition = float3(0, 5, 5);
-    PerspCamera                  mLightCamera;
-    bool                         mUsePCF = false;
+    float3                       mLightPosition  = float3(0, 5, 5);
+    bool                         mUsePCF         = false;
+    bool                         mAnimateLight   = true;
+    bool                         mAnimateObjects = false;
+    float                        mLightTime      = 0;
+    float                        mObjectTime     = 0;
+    float                        mLastFrameTime  = 0;
+
+    ppx::metrics::MetricID       mShadowDrawCountMetric = ppx::metrics::kInvalidMetricID;
+    ppx::metrics::MetricID       mCascadeTimeMetrics[kMaxCascadeCount];
 
 private:
     void SetupEntity(
@@ -91,6 +141,8 @@ private:
         const grfx::DescriptorSetLayout* pDrawSetLayout,
         const grfx::DescriptorSetLayout* pShadowSetLayout,
         Entity*                          pEntity);
+    void UpdateCascades();
+    bool CasterOverlapsCascade(const Entity& entity, const float4x4& modelMatrix, const Cascade& cascade) const;
 };
 
 void ProjApp::Config(ppx::ApplicationSettings& settings)
@@ -113,26 +165,20 @@ void ProjApp::SetupEntity(
     PPX_CHECKED_CALL(Geometry::Create(mesh, &geo));
     PPX_CHECKED_CALL(grfx_util::CreateMeshFromGeometry(GetGraphicsQueue(), &geo, &pEntity->mesh));
 
+    // Bounding sphere for culling casters against the cascades
+    pEntity->boundsCenter = (mesh.GetBoundingBoxMin() + mesh.GetBoundingBoxMax()) / 2.0f;
+    pEntity->boundsRadius = glm::length(mesh.GetBoundingBoxMax() - mesh.GetBoundingBoxMin()) / 2.0f;
+
     // Draw uniform buffer
     grfx::BufferCreateInfo bufferCreateInfo        = {};
-    bufferCreateInfo.size                          = RoundUp(512, PPX_CONSTANT_BUFFER_ALIGNMENT);
+    bufferCreateInfo.size                          = RoundUp(1024, PPX_CONSTANT_BUFFER_ALIGNMENT);
     bufferCreateInfo.usageFlags.bits.uniformBuffer = true;
     bufferCreateInfo.memoryUsage                   = grfx::MEMORY_USAGE_CPU_TO_GPU;
     PPX_CHECKED_CALL(GetDevice()->CreateBuffer(&bufferCreateInfo, &pEntity->drawUniformBuffer));
 
-    // Shadow uniform buffer
-    bufferCreateInfo                               = {};
-    bufferCreateInfo.size                          = PPX_MINIMUM_UNIFORM_BUFFER_SIZE;
-    bufferCreateInfo.usageFlags.bits.uniformBuffer = true;
-    bufferCreateInfo.memoryUsage                   = grfx::MEMORY_USAGE_CPU_TO_GPU;
-    PPX_CHECKED_CALL(GetDevice()->CreateBuffer(&bufferCreateInfo, &pEntity->shadowUniformBuffer));
-
     // Draw descriptor set
     PPX_CHECKED_CALL(GetDevice()->AllocateDescriptorSet(pDescriptorPool, pDrawSetLayout, &pEntity->drawDescriptorSet));
 
-    // Shadow descriptor set
-    PPX_CHECKED_CALL(GetDevice()->AllocateDescriptorSet(pDescriptorPool, pShadowSetLayout, &pEntity->shadowDescriptorSet));
-
     // Update draw descriptor set
     grfx::WriteDescriptor write = {};
     write.binding               = 0;
@@ -142,22 +188,41 @@ void ProjApp::SetupEntity(
     write.pBuffer               = pEntity->drawUniformBuffer;
     PPX_CHECKED_CALL(pEntity->drawDescriptorSet->UpdateDescriptors(1, &write));
 
-    // Update shadow descriptor set
-    write              = {};
-    write.binding      = 0;
-    write.type         = grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    write.bufferOffset = 0;
-    write.bufferRange  = PPX_WHOLE_SIZE;
-    write.pBuffer      = pEntity->shadowUniformBuffer;
-    PPX_CHECKED_CALL(pEntity->shadowDescriptorSet->UpdateDescriptors(1, &write));
+    // Shadow uniform buffer and descriptor set for each cascade
+    for (uint32_t i = 0; i < kMaxCascadeCount; ++i) {
+        bufferCreateInfo                               = {};
+        bufferCreateInfo.size                          = PPX_MINIMUM_UNIFORM_BUFFER_SIZE;
+        bufferCreateInfo.usageFlags.bits.uniformBuffer = true;
+        bufferCreateInfo.memoryUsage                   = grfx::MEMORY_USAGE_CPU_TO_GPU;
+        PPX_CHECKED_CALL(GetDevice()->CreateBuffer(&bufferCreateInfo, &pEntity->shadowUniformBuffers[i]));
+
+        PPX_CHECKED_CALL(GetDevice()->AllocateDescriptorSet(pDescriptorPool, pShadowSetLayout, &pEntity->shadowDescriptorSets[i]));
+
+        write              = {};
+        write.binding      = 0;
+        write.type         = grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        write.bufferOffset = 0;
+        write.bufferRange  = PPX_WHOLE_SIZE;
+        write.pBuffer      = pEntity->shadowUniformBuffers[i];
+        PPX_CHECKED_CALL(pEntity->shadowDescriptorSets[i]->UpdateDescriptors(1, &write));
+    }
 }
 
 void ProjApp::Setup()
 {
-    // Cameras
+    // Options
     {
-        mCamera      = PerspCamera(60.0f, GetWindowAspect());
-        mLightCamera = PerspCamera(60.0f, 1.0f, 1.0f, 100.0f);
+        const auto& clOptions = GetExtraOptions();
+        mCascadeCount         = static_cast<int>(std::min(std::max(clOptions.GetExtraOptionValueOrDefault<uint32_t>("cascade-count", kMaxCascadeCount), 1u), kMaxCascadeCount));
+        mCascadeSplitLambda   = std::min(std::max(clOptions.GetExtraOptionValueOrDefault<float>("cascade-split-lambda", kDefaultCascadeSplitLambda), 0.0f), 1.0f);
+        mCacheShadows         = clOptions.GetExtraOptionValueOrDefault<bool>("cache-shadows", true);
+        mAnimateLight         = clOptions.GetExtraOptionValueOrDefault<bool>("animate-light", true);
+        mAnimateObjects       = clOptions.GetExtraOptionValueOrDefault<bool>("animate-objects", false);
+    }
+
+    // Camera
+    {
+        mCamera = PerspCamera(60.0f, GetWindowAspect());
     }
 
     // Create descriptor pool large enough for this project
@@ -288,25 +353,35 @@ void ProjApp::Setup()
         GetDevice()->DestroyShaderModule(VS);
     }
 
-    // Shadow render pass
+    // Shadow map, one render pass for each cascade's layer
     {
-        grfx::RenderPassCreateInfo2 createInfo                        = {};
-        createInfo.width                                              = kShadowMapSize;
-        createInfo.height                                             = kShadowMapSize;
-        createInfo.depthStencilFormat                                 = grfx::FORMAT_D32_FLOAT;
-        createInfo.depthStencilUsageFlags.bits.depthStencilAttachment = true;
-        createInfo.depthStencilUsageFlags.bits.sampled                = true;
-        createInfo.depthStencilClearValue                             = {1.0f, 0xFF};
-        createInfo.depthLoadOp                                        = grfx::ATTACHMENT_LOAD_OP_CLEAR;
-        createInfo.depthStoreOp                                       = grfx::ATTACHMENT_STORE_OP_STORE;
-        createInfo.depthStencilInitialState                           = grfx::RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-
-        PPX_CHECKED_CALL(GetDevice()->CreateRenderPass(&createInfo, &mShadowRenderPass));
+        grfx::ImageCreateInfo imageCreateInfo = grfx::ImageCreateInfo::DepthStencilTarget(kShadowMapSize, kShadowMapSize, grfx::FORMAT_D32_FLOAT);
+        imageCreateInfo.arrayLayerCount       = kMaxCascadeCount;
+        imageCreateInfo.initialState          = grfx::RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+        PPX_CHECKED_CALL(GetDevice()->CreateImage(&imageCreateInfo, &mShadowImage));
+
+        for (uint32_t i = 0; i < kMaxCascadeCount; ++i) {
+            Cascade& cascade = mCascades[i];
+
+            grfx::DepthStencilViewCreateInfo dsvCreateInfo = grfx::DepthStencilViewCreateInfo::GuessFromImage(mShadowImage);
+            dsvCreateInfo.arrayLayer                       = i;
+            dsvCreateInfo.arrayLayerCount                  = 1;
+            dsvCreateInfo.depthLoadOp                      = grfx::ATTACHMENT_LOAD_OP_CLEAR;
+            dsvCreateInfo.depthStoreOp                     = grfx::ATTACHMENT_STORE_OP_STORE;
+            PPX_CHECKED_CALL(GetDevice()->CreateDepthStencilView(&dsvCreateInfo, &cascade.depthStencilView));
+
+            grfx::RenderPassCreateInfo rpCreateInfo = {};
+            rpCreateInfo.width                      = kShadowMapSize;
+            rpCreateInfo.height                     = kShadowMapSize;
+            rpCreateInfo.pDepthStencilView          = cascade.depthStencilView;
+            rpCreateInfo.depthStencilClearValue     = {1.0f, 0xFF};
+            PPX_CHECKED_CALL(GetDevice()->CreateRenderPass(&rpCreateInfo, &cascade.renderPass));
+        }
     }
 
     // Update draw objects with shadow information
     {
-        grfx::SampledImageViewCreateInfo ivCreateInfo = grfx::SampledImageViewCreateInfo::GuessFromImage(mShadowRenderPass->GetDepthStencilImage());
+        grfx::SampledImageViewCreateInfo ivCreateInfo = grfx::SampledImageViewCreateInfo::GuessFromImage(mShadowImage);
         PPX_CHECKED_CALL(GetDevice()->CreateSampledImageView(&ivCreateInfo, &mShadowImageView));
 
         grfx::SamplerCreateInfo samplerCreateInfo = {};
@@ -427,10 +502,101 @@ void ProjApp::Setup()
         fenceCreateInfo = {true}; // Create signaled
         PPX_CHECKED_CALL(GetDevice()->CreateFence(&fenceCreateInfo, &frame.renderCompleteFence));
 
+        grfx::QueryCreateInfo queryCreateInfo = {};
+        queryCreateInfo.type                  = grfx::QUERY_TYPE_TIMESTAMP;
+        queryCreateInfo.count                 = 2 * kMaxCascadeCount;
+        PPX_CHECKED_CALL(GetDevice()->CreateQuery(&queryCreateInfo, &frame.timestampQuery));
+
         mPerFrame.push_back(frame);
     }
 }
 
+void ProjApp::UpdateCascades()
+{
+    // The light is directional and shines from its position towards the
+    // origin. Its view stays at the origin, only the projection of each
+    // cascade follows the camera.
+    float3 lightDir  = glm::normalize(-mLightPosition);
+    float3 up        = (std::abs(lightDir.y) > 0.99f) ? float3(0, 0, 1) : float3(0, 1, 0);
+    mLightViewMatrix = glm::lookAt(float3(0, 0, 0), lightDir, up);
+
+    const float4x4  invCameraView = glm::inverse(mCamera.GetViewMatrix());
+    const float4x4& P             = mCamera.GetProjectionMatrix();
+    const float     tanHalfX      = 1.0f / P[0][0];
+    const float     tanHalfY      = 1.0f / P[1][1];
+    const float     nearDepth     = PPX_CAMERA_DEFAULT_NEAR_CLIP;
+    const float     farDepth      = kShadowDistance;
+    const uint32_t  cascadeCount  = static_cast<uint32_t>(mCascadeCount);
+
+    float prevSplitDepth = nearDepth;
+    for (uint32_t i = 0; i < cascadeCount; ++i) {
+        Cascade& cascade = mCascades[i];
+
+        // Practical split scheme: lambda blends between logarithmic splits,
+        // which keep the texel density even, and uniform splits.
+        float p            = static_cast<float>(i + 1) / static_cast<float>(cascadeCount);
+        float logSplit     = nearDepth * std::pow(farDepth / nearDepth, p);
+        float uniformSplit = nearDepth + (farDepth - nearDepth) * p;
+        cascade.splitDepth = mCascadeSplitLambda * logSplit + (1.0f - mCascadeSplitLambda) * uniformSplit;
+
+        // Bounding sphere of the cascade's slice of the camera frustum. Its
+        // size doesn't change as the camera turns, so neither does the size
+        // of a shadow map texel.
+        float3 corners[8];
+        float3 center = float3(0);
+        for (uint32_t j = 0; j < 8; ++j) {
+            float d    = (j < 4) ? prevSplitDepth : cascade.splitDepth;
+            float x    = ((j & 1) ? 1.0f : -1.0f) * d * tanHalfX;
+            float y    = ((j & 2) ? 1.0f : -1.0f) * d * tanHalfY;
+            corners[j] = float3(invCameraView * float4(x, y, -d, 1));
+            center += corners[j];
+        }
+        center /= 8.0f;
+
+        float radius = 0;
+        for (uint32_t j = 0; j < 8; ++j) {
+            radius = std::max(radius, glm::length(corners[j] - center));
+        }
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        // Snap the center to whole texels in light view space so the shadow
+        // edges don't shimmer as the camera moves.
+        float  texelSize = (2.0f * radius) / static_cast<float>(kShadowMapSize);
+        float3 centerLS  = float3(mLightViewMatrix * float4(center, 1));
+        centerLS.x       = std::floor(centerLS.x / texelSize) * texelSize;
+        centerLS.y       = std::floor(centerLS.y / texelSize) * texelSize;
+
+        cascade.boundsMin = float2(centerLS) - float2(radius);
+        cascade.boundsMax = float2(centerLS) + float2(radius);
+        cascade.nearDepth = -centerLS.z - radius - kShadowCasterMargin;
+        cascade.farDepth  = -centerLS.z + radius;
+
+        float4x4 lightProjectionMatrix = glm::ortho(cascade.boundsMin.x, cascade.boundsMax.x, cascade.boundsMin.y, cascade.boundsMax.y, cascade.nearDepth, cascade.farDepth);
+        float4x4 viewProjectionMatrix  = lightProjectionMatrix * mLightViewMatrix;
+
+        // Any change of the projection or the light invalidates the cascade
+        if (viewProjectionMatrix != cascade.viewProjectionMatrix) {
+            cascade.viewProjectionMatrix = viewProjectionMatrix;
+            cascade.cached               = false;
+        }
+
+        prevSplitDepth = cascade.splitDepth;
+    }
+}
+
+bool ProjApp::CasterOverlapsCascade(const Entity& entity, const float4x4& modelMatrix, const Cascade& cascade) const
+{
+    float  scale    = std::max(entity.scale.x, std::max(entity.scale.y, entity.scale.z));
+    float  radius   = entity.boundsRadius * scale;
+    float3 centerLS = float3(mLightViewMatrix * modelMatrix * float4(entity.boundsCenter, 1));
+    float  depth    = -centerLS.z;
+
+    bool overlapsX = ((centerLS.x + radius) >= cascade.boundsMin.x) && ((centerLS.x - radius) <= cascade.boundsMax.x);
+    bool overlapsY = ((centerLS.y + radius) >= cascade.boundsMin.y) && ((centerLS.y - radius) <= cascade.boundsMax.y);
+    bool overlapsZ = ((depth + radius) >= cascade.nearDepth) && ((depth - radius) <= cascade.farDepth);
+    return overlapsX && overlapsY && overlapsZ;
+}
+
 void ProjApp::Render()
 {
     PerFrame& frame = mPerFrame[0];
@@ -446,16 +612,40 @@ void ProjApp::Render()
     // Wait for and reset render complete fence
     PPX_CHECKED_CALL(frame.renderCompleteFence->WaitAndReset());
 
+    // Read query results
+    if (GetFrameCount() > 0) {
+        uint64_t data[2 * kMaxCascadeCount] = {0};
+        PPX_CHECKED_CALL(frame.timestampQuery->GetData(data, 2 * kMaxCascadeCount * sizeof(uint64_t)));
+        for (uint32_t i = 0; i < kMaxCascadeCount; ++i) {
+            mCascades[i].gpuTime = data[2 * i + 1] - data[2 * i];
+        }
+    }
+
+    // Reset query
+    frame.timestampQuery->Reset(0, 2 * kMaxCascadeCount);
+
+    // Advance animations
+    float frameTime = GetElapsedSeconds();
+    float deltaTime = frameTime - mLastFrameTime;
+    mLastFrameTime  = frameTime;
+    if (mAnimateLight) {
+        mLightTime += deltaTime;
+    }
+    if (mAnimateObjects) {
+        mObjectTime += deltaTime;
+    }
+
     // Update light position
-    float t        = GetElapsedSeconds() / 2.0f;
+    float t        = mLightTime / 2.0f;
     float r        = 7.0f;
     mLightPosition = float3(r * cos(t), 5.0f, r * sin(t));
 
     // Update camera(s)
     mCamera.LookAt(float3(5, 7, 7), float3(0, 1, 0));
-    mLightCamera.LookAt(mLightPosition, float3(0, 0, 0));
 
-    // Update uniform buffers
+    // Update model matrices
+    mCube.rotate.y     = mObjectTime;
+    bool anyCasterMoved = false;
     for (size_t i = 0; i < mEntities.size(); ++i) {
         Entity* pEntity = mEntities[i];
 
@@ -466,16 +656,58 @@ void ProjApp::Render()
         float4x4 S = glm::scale(pEntity->scale);
         float4x4 M = T * R * S;
 
+        pEntity->prevModelMatrix = pEntity->modelMatrix;
+        pEntity->modelMatrix     = M;
+        pEntity->moved           = (M != pEntity->prevModelMatrix);
+        anyCasterMoved           = anyCasterMoved || pEntity->moved;
+    }
+
+    // Update cascades and find the ones that need to be redrawn
+    UpdateCascades();
+    for (uint32_t i = 0; i < kMaxCascadeCount; ++i) {
+        Cascade& cascade  = mCascades[i];
+        cascade.rendered  = false;
+        cascade.drawCount = 0;
+
+        // Inactive cascades aren't kept up to date
+        if (i >= static_cast<uint32_t>(mCascadeCount)) {
+            cascade.cached = cascade.cached && !anyCasterMoved;
+            continue;
+        }
+
+        if (!mCacheShadows) {
+            cascade.cached = false;
+        }
+
+        // A caster that moves invalidates the cascades it leaves and enters
+        for (size_t j = 0; j < mEntities.size(); ++j) {
+            const Entity* pEntity = mEntities[j];
+            if (pEntity->moved && (CasterOverlapsCascade(*pEntity, pEntity->prevModelMatrix, cascade) || CasterOverlapsCascade(*pEntity, pEntity->modelMatrix, cascade))) {
+                cascade.cached = false;
+            }
+        }
+
+        cascade.rendered = !cascade.cached;
+    }
+
+    // Update uniform buffers
+    for (size_t i = 0; i < mEntities.size(); ++i) {
+        Entity*         pEntity = mEntities[i];
+        const float4x4& M       = pEntity->modelMatrix;
+
         // Draw uniform buffers
         struct Scene
         {
-            float4x4 ModelMatrix;                // Transforms object space to world space
-            float4x4 NormalMatrix;               // Transforms object space to normal space
-            float4   Ambient;                    // Object's ambient intensity
-            float4x4 CameraViewProjectionMatrix; // Camera's view projection matrix
-            float4   LightPosition;              // Light's position
-            float4x4 LightViewProjectionMatrix;  // Light's view projection matrix
-            uint4    UsePCF;                     // Enable/disable PCF
+            float4x4 ModelMatrix;                                   // Transforms object space to world space
+            float4x4 NormalMatrix;                                  // Transforms object space to normal space
+            float4   Ambient;                                       // Object's ambient intensity
+            float4x4 CameraViewProjectionMatrix;                    // Camera's view projection matrix
+            float4x4 CameraViewMatrix;                              // Camera's view matrix
+            float4   LightPosition;                                 // Light's position
+            float4x4 LightViewProjectionMatrices[kMaxCascadeCount]; // Light's view projection matrix of each cascade
+            float4   CascadeSplits;                                 // Camera view depth where each cascade ends
+            uint4    UsePCF;                                        // Enable/disable PCF
+            uint4    CascadeOptions;                                // x = cascade count, y = tint cascades
         };
 
         Scene scene                      = {};
@@ -483,17 +715,28 @@ void ProjApp::Render()
         scene.NormalMatrix               = glm::inverseTranspose(M);
         scene.Ambient                    = float4(0.3f);
         scene.CameraViewProjectionMatrix = mCamera.GetViewProjectionMatrix();
+        scene.CameraViewMatrix           = mCamera.GetViewMatrix();
         scene.LightPosition              = float4(mLightPosition, 0);
-        scene.LightViewProjectionMatrix  = mLightCamera.GetViewProjectionMatrix();
-        scene.UsePCF                     = uint4(mUsePCF);
+        for (uint32_t j = 0; j < kMaxCascadeCount; ++j) {
+            scene.LightViewProjectionMatrices[j] = mCascades[j].viewProjectionMatrix;
+            scene.CascadeSplits[j]               = mCascades[j].splitDepth;
+        }
+        scene.UsePCF         = uint4(mUsePCF);
+        scene.CascadeOptions = uint4(static_cast<uint32_t>(mCascadeCount), mVisualizeCascades, 0, 0);
 
         pEntity->drawUniformBuffer->CopyFromSource(sizeof(scene), &scene);
 
-        // Shadow uniform buffers
-        float4x4 PV  = mLightCamera.GetViewProjectionMatrix();
-        float4x4 MVP = PV * M; // Yes - the other is reversed
+        // Shadow uniform buffers, only for the cascades that are redrawn
+        for (uint32_t j = 0; j < kMaxCascadeCount; ++j) {
+            if (!mCascades[j].rendered) {
+                continue;
+            }
+
+            const float4x4& PV  = mCascades[j].viewProjectionMatrix;
+            float4x4        MVP = PV * M; // Yes - the other is reversed
 
-        pEntity->shadowUniformBuffer->CopyFromSource(sizeof(MVP), &MVP);
+            pEntity->shadowUniformBuffers[j]->CopyFromSource(sizeof(MVP), &MVP);
+        }
     }
 
     // Update light uniform buffer
@@ -512,27 +755,49 @@ void ProjApp::Render()
         PPX_ASSERT_MSG(!renderPass.IsNull(), "render pass object is null");
 
         // =====================================================================
-        //  Render shadow pass
+        //  Render shadow cascades
         // =====================================================================
-        frame.cmd->TransitionImageLayout(mShadowRenderPass->GetDepthStencilImage(), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_PIXEL_SHADER_RESOURCE, grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
-        frame.cmd->BeginRenderPass(mShadowRenderPass);
-        {
-            frame.cmd->SetScissors(mShadowRenderPass->GetScissor());
-            frame.cmd->SetViewports(mShadowRenderPass->GetViewport());
-
-            // Draw entities
-            frame.cmd->BindGraphicsPipeline(mShadowPipeline);
-            for (size_t i = 0; i < mEntities.size(); ++i) {
-                Entity* pEntity = mEntities[i];
-
-                frame.cmd->BindGraphicsDescriptorSets(mShadowPipelineInterface, 1, &pEntity->shadowDescriptorSet);
-                frame.cmd->BindIndexBuffer(pEntity->mesh);
-                frame.cmd->BindVertexBuffers(pEntity->mesh);
-                frame.cmd->DrawIndexed(pEntity->mesh->GetIndexCount());
+        //
+        // Cached cascades keep their layer of the shadow map from an earlier
+        // frame. Timestamps are written for every cascade so that skipped
+        // ones read as zero.
+        //
+        mShadowDrawCount = 0;
+        for (uint32_t i = 0; i < kMaxCascadeCount; ++i) {
+            Cascade& cascade = mCascades[i];
+
+            frame.cmd->WriteTimestamp(frame.timestampQuery, grfx::PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 2 * i);
+            if (cascade.rendered) {
+                frame.cmd->TransitionImageLayout(mShadowImage, 0, 1, i, 1, grfx::RESOURCE_STATE_PIXEL_SHADER_RESOURCE, grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
+                frame.cmd->BeginRenderPass(cascade.renderPass);
+                {
+                    frame.cmd->SetScissors(cascade.renderPass->GetScissor());
+                    frame.cmd->SetViewports(cascade.renderPass->GetViewport());
+
+                    // Draw the casters that can land in the cascade
+                    frame.cmd->BindGraphicsPipeline(mShadowPipeline);
+                    for (size_t j = 0; j < mEntities.size(); ++j) {
+                        Entity* pEntity = mEntities[j];
+                        if (!CasterOverlapsCascade(*pEntity, pEntity->modelMatrix, cascade)) {
+                            continue;
+                        }
+
+                        frame.cmd->BindGraphicsDescriptorSets(mShadowPipelineInterface, 1, &pEntity->shadowDescriptorSets[i]);
+                        frame.cmd->BindIndexBuffer(pEntity->mesh);
+                        frame.cmd->BindVertexBuffers(pEntity->mesh);
+                        frame.cmd->DrawIndexed(pEntity->mesh->GetIndexCount());
+                        ++cascade.drawCount;
+                    }
+                }
+                frame.cmd->EndRenderPass();
+                frame.cmd->TransitionImageLayout(mShadowImage, 0, 1, i, 1, grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE, grfx::RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+                cascade.cached = true;
             }
+            frame.cmd->WriteTimestamp(frame.timestampQuery, grfx::PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 2 * i + 1);
+
+            mShadowDrawCount += cascade.drawCount;
         }
-        frame.cmd->EndRenderPass();
-        frame.cmd->TransitionImageLayout(mShadowRenderPass->GetDepthStencilImage(), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE, grfx::RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
         // =====================================================================
         //  Render scene
@@ -567,6 +832,9 @@ void ProjApp::Render()
         }
         frame.cmd->EndRenderPass();
         frame.cmd->TransitionImageLayout(renderPass->GetRenderTargetImage(0), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_PRESENT);
+
+        // Resolve queries
+        frame.cmd->ResolveQueryData(frame.timestampQuery, 0, 2 * kMaxCascadeCount);
     }
     PPX_CHECKED_CALL(frame.cmd->End());
 
@@ -584,11 +852,82 @@ void ProjApp::Render()
     PPX_CHECKED_CALL(swapchain->Present(imageIndex, 1, &frame.renderCompleteSemaphore));
 }
 
+void ProjApp::SetupMetrics()
+{
+    Application::SetupMetrics();
+    if (!HasActiveMetricsRun()) {
+        return;
+    }
+
+    ppx::metrics::MetricMetadata metadata = {ppx::metrics::MetricType::GAUGE, "Shadow Draw Calls", "draws", ppx::metrics::MetricInterpretation::LOWER_IS_BETTER, {0.f, std::numeric_limits<double>::max()}};
+    mShadowDrawCountMetric                = AddMetric(metadata);
+    PPX_ASSERT_MSG(mShadowDrawCountMetric != ppx::metrics::kInvalidMetricID, "Failed to add Shadow Draw Calls metric");
+
+    for (uint32_t i = 0; i < kMaxCascadeCount; ++i) {
+        std::string name       = "Shadow Cascade " + std::to_string(i) + " GPU Time";
+        metadata               = {ppx::metrics::MetricType::GAUGE, name, "ms", ppx::metrics::MetricInterpretation::LOWER_IS_BETTER, {0.f, 10000.f}};
+        mCascadeTimeMetrics[i] = AddMetric(metadata);
+        PPX_ASSERT_MSG(mCascadeTimeMetrics[i] != ppx::metrics::kInvalidMetricID, "Failed to add " << name << " metric");
+    }
+}
+
+void ProjApp::UpdateMetrics()
+{
+    if (!HasActiveMetricsRun()) {
+        return;
+    }
+
+    ppx::metrics::MetricData data = {ppx::metrics::MetricType::GAUGE};
+    data.gauge.seconds            = GetElapsedSeconds();
+
+    data.gauge.value = static_cast<double>(mShadowDrawCount);
+    RecordMetricData(mShadowDrawCountMetric, data);
+
+    uint64_t frequency = 0;
+    GetGraphicsQueue()->GetTimestampFrequency(&frequency);
+    if ((GetFrameCount() == 0) || (frequency == 0)) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < static_cast<uint32_t>(mCascadeCount); ++i) {
+        data.gauge.value = static_cast<double>(mCascades[i].gpuTime) / static_cast<double>(frequency) * 1000.0;
+        RecordMetricData(mCascadeTimeMetrics[i], data);
+    }
+}
+
 void ProjApp::DrawGui()
 {
     ImGui::Separator();
 
     ImGui::Checkbox("Use PCF Shadows", &mUsePCF);
+    ImGui::SliderInt("Cascades", &mCascadeCount, 1, static_cast<int>(kMaxCascadeCount));
+    ImGui::SliderFloat("Cascade Split Lambda", &mCascadeSplitLambda, 0.0f, 1.0f);
+    ImGui::Checkbox("Visualize Cascades", &mVisualizeCascades);
+    ImGui::Checkbox("Cache Shadows", &mCacheShadows);
+    ImGui::Checkbox("Animate Light", &mAnimateLight);
+    ImGui::Checkbox("Animate Objects", &mAnimateObjects);
+
+    ImGui::Separator();
+
+    ImGui::Columns(2);
+
+    uint64_t frequency = 0;
+    GetGraphicsQueue()->GetTimestampFrequency(&frequency);
+    for (uint32_t i = 0; i < static_cast<uint32_t>(mCascadeCount); ++i) {
+        const Cascade& cascade = mCascades[i];
+
+        ImGui::Text("Cascade %u (%.1f)", i, cascade.splitDepth);
+        ImGui::NextColumn();
+        ImGui::Text("%s, %u draws, %f ms", cascade.rendered ? "rendered" : "cached", cascade.drawCount, static_cast<float>(cascade.gpuTime / static_cast<double>(frequency)) * 1000.0f);
+        ImGui::NextColumn();
+    }
+
+    ImGui::Text("Shadow Draw Calls");
+    ImGui::NextColumn();
+    ImGui::Text("%u", mShadowDrawCount);
+    ImGui::NextColumn();
+
+    ImGui::Columns(1);
 }
 
 SETUP_APPLICATION(ProjApp)
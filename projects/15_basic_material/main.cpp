@@ -15,6 +15,7 @@
 #include "ppx/ppx.h"
 #include "ppx/camera.h"
 #include "ppx/graphics_util.h"
+#include "ppx/job_system.h"
 
 #include <filesystem>
 
@@ -141,8 +142,10 @@ private:
 
     struct IBLResources
     {
-        grfx::TexturePtr irradianceTexture;
-        grfx::TexturePtr environmentTexture;
+        grfx::ImagePtr            irradianceImage;
+        grfx::ImagePtr            environmentImage;
+        grfx::SampledImageViewPtr irradianceView;
+        grfx::SampledImageViewPtr environmentView;
     };
     std::vector<IBLResources> mIBLResources;
     grfx::TexturePtr          mBRDFLUTTexture;
@@ -294,6 +297,7 @@ private:
         MaterialResources&           materialResources);
     void SetupMaterials();
     void SetupIBL();
+    void SetupIBLResources(const std::filesystem::path& iblPath, const std::filesystem::path& cacheDirectory, JobSystem* pJobSystem);
 
 protected:
     virtual void DrawGui() override;
@@ -331,6 +335,9 @@ void ProjApp::SetupMaterialResources(
 {
     PPX_CHECKED_CALL(GetDevice()->AllocateDescriptorSet(mDescriptorPool, mMaterialResourcesLayout, &materialResources.set));
 
+    // Roughness and metalness are only sampled from the red channel, load them as single channel textures
+    const grfx_util::TextureOptions scalarMapOptions = grfx_util::TextureOptions().LoadOptions(BitmapLoadOptions().ChannelCount(1));
+
     // Albedo
     {
         PPX_CHECKED_CALL(grfx_util::CreateTextureFromFile(GetDevice()->GetGraphicsQueue(), GetAssetPath(albedoPath), &materialResources.albedoTexture));
@@ -345,7 +352,7 @@ void ProjApp::SetupMaterialResources(
 
     // Roughness
     {
-        PPX_CHECKED_CALL(grfx_util::CreateTextureFromFile(GetDevice()->GetGraphicsQueue(), GetAssetPath(roughnessPath), &materialResources.roughnessTexture));
+        PPX_CHECKED_CALL(grfx_util::CreateTextureFromFile(GetDevice()->GetGraphicsQueue(), GetAssetPath(roughnessPath), &materialResources.roughnessTexture, scalarMapOptions));
 
         grfx::WriteDescriptor write = {};
         write.binding               = ROUGHNESS_TEXTURE_REGISTER;
@@ -357,7 +364,7 @@ void ProjApp::SetupMaterialResources(
 
     // Metalness
     {
-        PPX_CHECKED_CALL(grfx_util::CreateTextureFromFile(GetDevice()->GetGraphicsQueue(), GetAssetPath(metalnessPath), &materialResources.metalnessTexture));
+        PPX_CHECKED_CALL(grfx_util::CreateTextureFromFile(GetDevice()->GetGraphicsQueue(), GetAssetPath(metalnessPath), &materialResources.metalnessTexture, scalarMapOptions));
 
         grfx::WriteDescriptor write = {};
         write.binding               = METALNESS_TEXTURE_REGISTER;
@@ -385,7 +392,7 @@ void ProjApp::SetupMaterialResources(
         write.binding               = IRR_MAP_TEXTURE_REGISTER;
         write.arrayIndex            = 0;
         write.type                  = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-        write.pImageView            = mIBLResources[mCurrentIBLIndex].irradianceTexture->GetSampledImageView();
+        write.pImageView            = mIBLResources[mCurrentIBLIndex].irradianceView;
         PPX_CHECKED_CALL(materialResources.set->UpdateDescriptors(1, &write));
     }
 
@@ -395,7 +402,7 @@ void ProjApp::SetupMaterialResources(
         write.binding               = ENV_MAP_TEXTURE_REGISTER;
         write.arrayIndex            = 0;
         write.type                  = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-        write.pImageView            = mIBLResources[mCurrentIBLIndex].environmentTexture->GetSampledImageView();
+        write.pImageView            = mIBLResources[mCurrentIBLIndex].environmentView;
         PPX_CHECKED_CALL(materialResources.set->UpdateDescriptors(1, &write));
     }
 
@@ -523,90 +530,68 @@ void ProjApp::SetupMaterials()
     }
 }
 
+void ProjApp::SetupIBLResources(const std::filesystem::path& iblPath, const std::filesystem::path& cacheDirectory, JobSystem* pJobSystem)
+{
+    IBLResources reses = {};
+    PPX_CHECKED_CALL(grfx_util::CreateIBLCubeMapsFromFile(
+        GetDevice()->GetGraphicsQueue(),
+        GetAssetPath(iblPath),
+        IBLCubeMapOptions(),
+        cacheDirectory,
+        &reses.irradianceImage,
+        &reses.environmentImage,
+        pJobSystem));
+
+    grfx::SampledImageViewCreateInfo viewCreateInfo = grfx::SampledImageViewCreateInfo::GuessFromImage(reses.irradianceImage);
+    PPX_CHECKED_CALL(GetDevice()->CreateSampledImageView(&viewCreateInfo, &reses.irradianceView));
+
+    viewCreateInfo = grfx::SampledImageViewCreateInfo::GuessFromImage(reses.environmentImage);
+    PPX_CHECKED_CALL(GetDevice()->CreateSampledImageView(&viewCreateInfo, &reses.environmentView));
+
+    mIBLResources.push_back(reses);
+}
+
 void ProjApp::SetupIBL()
 {
     // BRDF LUT
     PPX_CHECKED_CALL(grfx_util::CreateTextureFromFile(
         GetDevice()->GetGraphicsQueue(),
         GetAssetPath("common/textures/ppx/brdf_lut.hdr"),
-        &mBRDFLUTTexture));
+        &mBRDFLUTTexture,
+        grfx_util::TextureOptions().LoadOptions(BitmapLoadOptions().HalfFloat())));
+
+    // The environments are filtered into cube maps on the CPU, the results
+    // are cached so only the first run pays for it
+    std::error_code       ec;
+    std::filesystem::path cacheDirectory = std::filesystem::temp_directory_path(ec);
+    if (!ec) {
+        cacheDirectory /= "ppx_ibl_cache";
+    }
+    cacheDirectory = GetExtraOptions().GetExtraOptionValueOrDefault<std::string>("ibl-cache-dir", cacheDirectory.string());
+
+    JobSystem jobSystem;
+    jobSystem.Initialize(JobSystem::GetDefaultWorkerCount());
 
     // Old Depot - good mix of diffused over head and bright exterior lighting from windows
-    {
-        IBLResources reses = {};
-        PPX_CHECKED_CALL(grfx_util::CreateIBLTexturesFromFile(
-            GetDevice()->GetGraphicsQueue(),
-            GetAssetPath("poly_haven/ibl/old_depot_4k.ibl"),
-            &reses.irradianceTexture,
-            &reses.environmentTexture));
-        mIBLResources.push_back(reses);
-    }
+    SetupIBLResources("poly_haven/ibl/old_depot_4k.ibl", cacheDirectory, &jobSystem);
 
     // Palermo Square - almost fully difuse exterior lighting
-    {
-        IBLResources reses = {};
-        PPX_CHECKED_CALL(grfx_util::CreateIBLTexturesFromFile(
-            GetDevice()->GetGraphicsQueue(),
-            GetAssetPath("poly_haven/ibl/palermo_square_4k.ibl"),
-            &reses.irradianceTexture,
-            &reses.environmentTexture));
-        mIBLResources.push_back(reses);
-    }
+    SetupIBLResources("poly_haven/ibl/palermo_square_4k.ibl", cacheDirectory, &jobSystem);
 
     // Venice Sunset - Golden Hour at beach
-    {
-        IBLResources reses = {};
-        PPX_CHECKED_CALL(grfx_util::CreateIBLTexturesFromFile(
-            GetDevice()->GetGraphicsQueue(),
-            GetAssetPath("poly_haven/ibl/venice_sunset_4k.ibl"),
-            &reses.irradianceTexture,
-            &reses.environmentTexture));
-        mIBLResources.push_back(reses);
-    }
+    SetupIBLResources("poly_haven/ibl/venice_sunset_4k.ibl", cacheDirectory, &jobSystem);
 
     // Hilly Terrain - Clear blue sky on hills
-    {
-        IBLResources reses = {};
-        PPX_CHECKED_CALL(grfx_util::CreateIBLTexturesFromFile(
-            GetDevice()->GetGraphicsQueue(),
-            GetAssetPath("poly_haven/ibl/hilly_terrain_01_4k.ibl"),
-            &reses.irradianceTexture,
-            &reses.environmentTexture));
-        mIBLResources.push_back(reses);
-    }
+    SetupIBLResources("poly_haven/ibl/hilly_terrain_01_4k.ibl", cacheDirectory, &jobSystem);
 
     // Neon Photo Studio - interior artificial lighting
-    {
-        IBLResources reses = {};
-        PPX_CHECKED_CALL(grfx_util::CreateIBLTexturesFromFile(
-            GetDevice()->GetGraphicsQueue(),
-            GetAssetPath("poly_haven/ibl/neon_photostudio_4k.ibl"),
-            &reses.irradianceTexture,
-            &reses.environmentTexture));
-        mIBLResources.push_back(reses);
-    }
+    SetupIBLResources("poly_haven/ibl/neon_photostudio_4k.ibl", cacheDirectory, &jobSystem);
 
     // Sky Lit Garage - diffused overhead exterior lighting
-    {
-        IBLResources reses = {};
-        PPX_CHECKED_CALL(grfx_util::CreateIBLTexturesFromFile(
-            GetDevice()->GetGraphicsQueue(),
-            GetAssetPath("poly_haven/ibl/skylit_garage_4k.ibl"),
-            &reses.irradianceTexture,
-            &reses.environmentTexture));
-        mIBLResources.push_back(reses);
-    }
+    SetupIBLResources("poly_haven/ibl/skylit_garage_4k.ibl", cacheDirectory, &jobSystem);
 
     // Noon Grass - harsh overhead exterior lighting
-    {
-        IBLResources reses = {};
-        PPX_CHECKED_CALL(grfx_util::CreateIBLTexturesFromFile(
-            GetDevice()->GetGraphicsQueue(),
-            GetAssetPath("poly_haven/ibl/noon_grass_4k.ibl"),
-            &reses.irradianceTexture,
-            &reses.environmentTexture));
-        mIBLResources.push_back(reses);
-    }
+    SetupIBLResources("poly_haven/ibl/noon_grass_4k.ibl", cacheDirectory, &jobSystem);
 }
 
 void ProjApp::Setup()
@@ -821,7 +806,7 @@ void ProjApp::Setup()
         writes[1].binding    = 1;
         writes[1].arrayIndex = 0;
         writes[1].type       = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-        writes[1].pImageView = mIBLResources[mCurrentIBLIndex].environmentTexture->GetSampledImageView();
+        writes[1].pImageView = mIBLResources[mCurrentIBLIndex].environmentView;
         // Sampler
         writes[2].binding    = 2;
         writes[2].arrayIndex = 0;
@@ -1152,7 +1137,7 @@ void ProjApp::Render()
         pSceneData->eyePosition          = mCamera.GetEyePosition();
         pSceneData->lightCount           = 4;
         pSceneData->ambient              = mAmbient;
-        pSceneData->envLevelCount        = static_cast<float>(mIBLResources[mCurrentIBLIndex].environmentTexture->GetMipLevelCount());
+        pSceneData->envLevelCount        = static_cast<float>(mIBLResources[mCurrentIBLIndex].environmentImage->GetMipLevelCount());
         pSceneData->useBRDFLUT           = mUseBRDFLUT;
 
         mCpuSceneConstants->UnmapMemory();
@@ -1295,7 +1280,7 @@ void ProjApp::Render()
             write.binding               = IRR_MAP_TEXTURE_REGISTER;
             write.arrayIndex            = 0;
             write.type                  = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-            write.pImageView            = mIBLResources[mCurrentIBLIndex].irradianceTexture->GetSampledImageView();
+            write.pImageView            = mIBLResources[mCurrentIBLIndex].irradianceView;
             PPX_CHECKED_CALL(materialResources->UpdateDescriptors(1, &write));
 
             // Environment map
@@ -1303,7 +1288,7 @@ void ProjApp::Render()
             write.binding    = ENV_MAP_TEXTURE_REGISTER;
             write.arrayIndex = 0;
             write.type       = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-            write.pImageView = mIBLResources[mCurrentIBLIndex].environmentTexture->GetSampledImageView();
+            write.pImageView = mIBLResources[mCurrentIBLIndex].environmentView;
             PPX_CHECKED_CALL(materialResources->UpdateDescriptors(1, &write));
         }
 
@@ -1312,7 +1297,7 @@ void ProjApp::Render()
         write.binding               = 1;
         write.arrayIndex            = 0;
         write.type                  = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-        write.pImageView            = mIBLResources[mCurrentIBLIndex].environmentTexture->GetSampledImageView();
+        write.pImageView            = mIBLResources[mCurrentIBLIndex].environmentView;
         PPX_CHECKED_CALL(mEnvDrawSet->UpdateDescriptors(1, &write));
     }
 
@@ -43,9 +43,27 @@
 #define GBUFFER_ENV_REGISTER 20 // DeferredLight only
 #define GBUFFER_IBL_REGISTER 21 // DeferredLight only
 
+// t#
+#define GBUFFER_TILE_LIGHTS_REGISTER 22 // DeferredLight only
+
 // s#
 #define GBUFFER_SAMPLER_REGISTER 6 // DeferredLight only
 
+// b#, t#, u#
+#define LIGHT_CULLING_CONSTANTS_REGISTER   23 // LightCulling only
+#define LIGHT_CULLING_DEPTH_REGISTER       24 // LightCulling only
+#define LIGHT_CULLING_TILE_LIGHTS_REGISTER 25 // LightCulling only
+#define LIGHT_CULLING_STATS_REGISTER       26 // LightCulling only
+
+// Tiled light culling, must match Config.hlsli
+#define LIGHT_CULLING_TILE_SIZE           16
+#define LIGHT_CULLING_MAX_LIGHTS_PER_TILE 255
+#define LIGHT_CULLING_TILE_STRIDE         (LIGHT_CULLING_MAX_LIGHTS_PER_TILE + 1)
+
+#define LIGHT_CULLING_STATS_OVERFLOW_TILE_COUNT_INDEX 0
+#define LIGHT_CULLING_STATS_DROPPED_LIGHT_COUNT_INDEX 1
+#define LIGHT_CULLING_STATS_COUNT                     2
+
 // GBuffer Attributes
 #define GBUFFER_POSITION     0
 #define GBUFFER_NORMAL       1
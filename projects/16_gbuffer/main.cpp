@@ -31,6 +31,26 @@ const grfx::Api kApi = grfx::API_VK_1_1;
 
 bool gUpdateOnce = false;
 
+// The first lights are the original unbounded key lights, they are shaded
+// by every pixel. The point lights added by --point-light-count are
+// bounded and get culled.
+const uint32_t kKeyLightCount          = 5;
+const uint32_t kMaxPointLightCount     = 4096;
+const uint32_t kDefaultPointLightCount = 256;
+const uint32_t kMaxLightCount          = kKeyLightCount + kMaxPointLightCount;
+const float    kPointLightRadius       = 1.5f;
+
+PPX_HLSL_PACK_BEGIN();
+struct HlslLight
+{
+    hlsl_uint<4>    type;
+    hlsl_float3<12> position;
+    hlsl_float3<12> color;
+    hlsl_float<4>   intensity;
+    hlsl_float<16>  radius;
+};
+PPX_HLSL_PACK_END();
+
 class ProjApp
     : public ppx::Application
 {
@@ -40,6 +60,8 @@ public:
     virtual void MouseMove(int32_t x, int32_t y, int32_t dx, int32_t dy, uint32_t buttons) override;
     virtual void Shutdown() override;
     virtual void Render() override;
+    virtual void SetupMetrics() override;
+    virtual void UpdateMetrics() override;
 
 private:
     struct PerFrame
@@ -55,8 +77,14 @@ private:
 #endif
     };
 
-    grfx::PipelineStatistics mPipelineStatistics = {};
-    uint64_t                 mTotalGpuFrameTime  = 0;
+    grfx::PipelineStatistics mPipelineStatistics  = {};
+    uint64_t                 mTotalGpuFrameTime   = 0;
+    uint64_t                 mLightCullingGpuTime = 0;
+    uint64_t                 mLightingGpuTime     = 0;
+    uint32_t                 mOverflowTileCount   = 0; // Tiles that dropped lights in the previous frame
+    uint32_t                 mDroppedLightCount   = 0;
+    uint32_t                 mBarrierCount        = 0;
+    uint32_t                 mBarrierBatchCount   = 0;
 
     std::vector<PerFrame>        mPerFrame;
     grfx::DescriptorPoolPtr      mDescriptorPool;
@@ -81,6 +109,26 @@ private:
     grfx::FullscreenQuadPtr      mGBufferLightQuad;
     grfx::FullscreenQuadPtr      mDebugDrawQuad;
 
+    // Tiled light culling
+    grfx::DescriptorSetLayoutPtr mLightCullingLayout;
+    grfx::DescriptorSetPtr       mLightCullingSet;
+    grfx::PipelineInterfacePtr   mLightCullingPipelineInterface;
+    grfx::ComputePipelinePtr     mLightCullingPipeline;
+    grfx::BufferPtr              mLightCullingConstants;
+    grfx::BufferPtr              mTileLightsBuffer;
+    grfx::BufferPtr              mLightCullingStatsBuffer;
+    grfx::BufferPtr              mLightCullingStatsClearBuffer;
+    grfx::BufferPtr              mLightCullingStatsReadbackBuffer;
+    bool                         mLightCullingStatsCopied = false;
+    uint32_t                     mTileCountX          = 0;
+    uint32_t                     mTileCountY          = 0;
+    bool                         mEnableTiledLighting = true;
+    int                          mPointLightCount     = kDefaultPointLightCount;
+
+    ppx::metrics::MetricID mLightCullingTimeMetric = ppx::metrics::kInvalidMetricID;
+    ppx::metrics::MetricID mLightingTimeMetric     = ppx::metrics::kInvalidMetricID;
+    ppx::metrics::MetricID mOverflowTileMetric     = ppx::metrics::kInvalidMetricID;
+
     grfx::DescriptorSetLayoutPtr mDrawToSwapchainLayout;
     grfx::DescriptorSetPtr       mDrawToSwapchainSet;
     grfx::FullscreenQuadPtr      mDrawToSwapchain;
@@ -113,6 +161,7 @@ private:
     void SetupEntities();
     void SetupGBufferPasses();
     void SetupGBufferLightQuad();
+    void SetupLightCulling();
     void SetupDebugDraw();
     void SetupDrawToSwapchain();
     void UpdateConstants();
@@ -136,6 +185,7 @@ void ProjApp::SetupPerFrame()
         PerFrame frame = {};
 
         PPX_CHECKED_CALL(GetGraphicsQueue()->CreateCommandBuffer(&frame.cmd));
+        frame.cmd->SetResourceStateTrackingEnabled(true);
 
         grfx::SemaphoreCreateInfo semaCreateInfo = {};
         PPX_CHECKED_CALL(GetDevice()->CreateSemaphore(&semaCreateInfo, &frame.imageAcquiredSemaphore));
@@ -151,7 +201,7 @@ void ProjApp::SetupPerFrame()
 #ifdef ENABLE_GPU_QUERIES
         grfx::QueryCreateInfo queryCreateInfo = {};
         queryCreateInfo.type                  = grfx::QUERY_TYPE_TIMESTAMP;
-        queryCreateInfo.count                 = 2;
+        queryCreateInfo.count                 = 4;
         PPX_CHECKED_CALL(GetDevice()->CreateQuery(&queryCreateInfo, &frame.timestampQuery));
 
         // Pipeline statistics query pool
@@ -287,6 +337,23 @@ void ProjApp::SetupGBufferPasses()
 
         PPX_CHECKED_CALL(GetDevice()->CreateDrawPass(&createInfo, &mGBufferLightPass));
     }
+
+    // Tile lights buffer, written by the light culling pass and read by the
+    // light pass. See LIGHT_CULLING_TILE_STRIDE for the layout of a tile.
+    {
+        mTileCountX = (mGBufferRenderPass->GetWidth() + LIGHT_CULLING_TILE_SIZE - 1) / LIGHT_CULLING_TILE_SIZE;
+        mTileCountY = (mGBufferRenderPass->GetHeight() + LIGHT_CULLING_TILE_SIZE - 1) / LIGHT_CULLING_TILE_SIZE;
+
+        grfx::BufferCreateInfo createInfo             = {};
+        createInfo.size                               = mTileCountX * mTileCountY * LIGHT_CULLING_TILE_STRIDE * sizeof(uint32_t);
+        createInfo.structuredElementStride            = sizeof(uint32_t);
+        createInfo.usageFlags.bits.roStructuredBuffer = true;
+        createInfo.usageFlags.bits.rwStructuredBuffer = true;
+        createInfo.memoryUsage                        = grfx::MEMORY_USAGE_GPU_ONLY;
+        createInfo.initialState                       = grfx::RESOURCE_STATE_SHADER_RESOURCE;
+
+        PPX_CHECKED_CALL(GetDevice()->CreateBuffer(&createInfo, &mTileLightsBuffer));
+    }
 }
 
 void ProjApp::SetupGBufferLightQuad()
@@ -320,6 +387,119 @@ void ProjApp::SetupGBufferLightQuad()
     PPX_CHECKED_CALL(GetDevice()->CreateFullscreenQuad(&createInfo, &mGBufferLightQuad));
 }
 
+void ProjApp::SetupLightCulling()
+{
+    // Constants
+    {
+        grfx::BufferCreateInfo bufferCreateInfo        = {};
+        bufferCreateInfo.size                          = PPX_MINIMUM_UNIFORM_BUFFER_SIZE;
+        bufferCreateInfo.usageFlags.bits.uniformBuffer = true;
+        bufferCreateInfo.memoryUsage                   = grfx::MEMORY_USAGE_CPU_TO_GPU;
+
+        PPX_CHECKED_CALL(GetDevice()->CreateBuffer(&bufferCreateInfo, &mLightCullingConstants));
+    }
+
+    // Stats, see LIGHT_CULLING_STATS_*. They are zeroed from the clear
+    // buffer before every dispatch and copied out after it.
+    {
+        grfx::BufferCreateInfo bufferCreateInfo             = {};
+        bufferCreateInfo.size                               = std::max<uint64_t>(LIGHT_CULLING_STATS_COUNT * sizeof(uint32_t), PPX_MINIMUM_STRUCTURED_BUFFER_SIZE);
+        bufferCreateInfo.structuredElementStride            = sizeof(uint32_t);
+        bufferCreateInfo.usageFlags.bits.rwStructuredBuffer = true;
+        bufferCreateInfo.usageFlags.bits.transferSrc        = true;
+        bufferCreateInfo.usageFlags.bits.transferDst        = true;
+        bufferCreateInfo.memoryUsage                        = grfx::MEMORY_USAGE_GPU_ONLY;
+        bufferCreateInfo.initialState                       = grfx::RESOURCE_STATE_UNORDERED_ACCESS;
+        PPX_CHECKED_CALL(GetDevice()->CreateBuffer(&bufferCreateInfo, &mLightCullingStatsBuffer));
+
+        bufferCreateInfo                             = {};
+        bufferCreateInfo.size                        = LIGHT_CULLING_STATS_COUNT * sizeof(uint32_t);
+        bufferCreateInfo.usageFlags.bits.transferSrc = true;
+        bufferCreateInfo.memoryUsage                 = grfx::MEMORY_USAGE_CPU_TO_GPU;
+        bufferCreateInfo.initialState                = grfx::RESOURCE_STATE_COPY_SRC;
+        PPX_CHECKED_CALL(GetDevice()->CreateBuffer(&bufferCreateInfo, &mLightCullingStatsClearBuffer));
+
+        void* pMappedAddress = nullptr;
+        PPX_CHECKED_CALL(mLightCullingStatsClearBuffer->MapMemory(0, &pMappedAddress));
+        memset(pMappedAddress, 0, LIGHT_CULLING_STATS_COUNT * sizeof(uint32_t));
+        mLightCullingStatsClearBuffer->UnmapMemory();
+
+        bufferCreateInfo                             = {};
+        bufferCreateInfo.size                        = LIGHT_CULLING_STATS_COUNT * sizeof(uint32_t);
+        bufferCreateInfo.usageFlags.bits.transferDst = true;
+        bufferCreateInfo.memoryUsage                 = grfx::MEMORY_USAGE_GPU_TO_CPU;
+        bufferCreateInfo.initialState                = grfx::RESOURCE_STATE_COPY_DST;
+        PPX_CHECKED_CALL(GetDevice()->CreateBuffer(&bufferCreateInfo, &mLightCullingStatsReadbackBuffer));
+    }
+
+    // Descriptors
+    {
+        // clang-format off
+        grfx::DescriptorSetLayoutCreateInfo createInfo = {};
+        createInfo.bindings.push_back({grfx::DescriptorBinding{LIGHT_CULLING_CONSTANTS_REGISTER,   grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER,       1, grfx::SHADER_STAGE_CS}});
+        createInfo.bindings.push_back({grfx::DescriptorBinding{LIGHT_CULLING_DEPTH_REGISTER,       grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE,        1, grfx::SHADER_STAGE_CS}});
+        createInfo.bindings.push_back({grfx::DescriptorBinding{LIGHT_CULLING_TILE_LIGHTS_REGISTER, grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER, 1, grfx::SHADER_STAGE_CS}});
+        createInfo.bindings.push_back({grfx::DescriptorBinding{LIGHT_CULLING_STATS_REGISTER,       grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER, 1, grfx::SHADER_STAGE_CS}});
+        PPX_CHECKED_CALL(GetDevice()->CreateDescriptorSetLayout(&createInfo, &mLightCullingLayout));
+        // clang-format on
+
+        PPX_CHECKED_CALL(GetDevice()->AllocateDescriptorSet(mDescriptorPool, mLightCullingLayout, &mLightCullingSet));
+        mLightCullingSet->SetName("Light Culling");
+
+        grfx::WriteDescriptor writes[4] = {};
+        writes[0].binding               = LIGHT_CULLING_CONSTANTS_REGISTER;
+        writes[0].type                  = grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        writes[0].bufferOffset          = 0;
+        writes[0].bufferRange           = PPX_WHOLE_SIZE;
+        writes[0].pBuffer               = mLightCullingConstants;
+        writes[1].binding               = LIGHT_CULLING_DEPTH_REGISTER;
+        writes[1].arrayIndex            = 0;
+        writes[1].type                  = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        writes[1].pImageView            = mGBufferRenderPass->GetDepthStencilTexture()->GetSampledImageView();
+
+        writes[2].binding                = LIGHT_CULLING_TILE_LIGHTS_REGISTER;
+        writes[2].type                   = grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER;
+        writes[2].bufferOffset           = 0;
+        writes[2].bufferRange            = PPX_WHOLE_SIZE;
+        writes[2].structuredElementCount = mTileCountX * mTileCountY * LIGHT_CULLING_TILE_STRIDE;
+        writes[2].pBuffer                = mTileLightsBuffer;
+
+        writes[3].binding                = LIGHT_CULLING_STATS_REGISTER;
+        writes[3].type                   = grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER;
+        writes[3].bufferOffset           = 0;
+        writes[3].bufferRange            = PPX_WHOLE_SIZE;
+        writes[3].structuredElementCount = LIGHT_CULLING_STATS_COUNT;
+        writes[3].pBuffer                = mLightCullingStatsBuffer;
+
+        PPX_CHECKED_CALL(mLightCullingSet->UpdateDescriptors(4, writes));
+    }
+
+    // Pipeline
+    {
+        grfx::ShaderModulePtr CS;
+
+        std::vector<char> bytecode = LoadShader("gbuffer/shaders", "LightCulling.cs");
+        PPX_ASSERT_MSG(!bytecode.empty(), "CS shader bytecode load failed");
+        grfx::ShaderModuleCreateInfo shaderCreateInfo = {static_cast<uint32_t>(bytecode.size()), bytecode.data()};
+        PPX_CHECKED_CALL(GetDevice()->CreateShaderModule(&shaderCreateInfo, &CS));
+
+        grfx::PipelineInterfaceCreateInfo piCreateInfo = {};
+        piCreateInfo.setCount                          = 2;
+        piCreateInfo.sets[0].set                       = 0;
+        piCreateInfo.sets[0].pLayout                   = mSceneDataLayout;
+        piCreateInfo.sets[1].set                       = 1;
+        piCreateInfo.sets[1].pLayout                   = mLightCullingLayout;
+        PPX_CHECKED_CALL(GetDevice()->CreatePipelineInterface(&piCreateInfo, &mLightCullingPipelineInterface));
+
+        grfx::ComputePipelineCreateInfo cpCreateInfo = {};
+        cpCreateInfo.CS                              = {CS.Get(), "csmain"};
+        cpCreateInfo.pPipelineInterface              = mLightCullingPipelineInterface;
+        PPX_CHECKED_CALL(GetDevice()->CreateComputePipeline(&cpCreateInfo, &mLightCullingPipeline));
+
+        GetDevice()->DestroyShaderModule(CS);
+    }
+}
+
 void ProjApp::SetupDebugDraw()
 {
     grfx::ShaderModulePtr VS;
@@ -412,6 +592,21 @@ void ProjApp::SetupDrawToSwapchain()
 
 void ProjApp::Setup()
 {
+    // Options
+    {
+        const auto& clOptions = GetExtraOptions();
+        uint32_t    pointLightCount = clOptions.GetExtraOptionValueOrDefault<uint32_t>("point-light-count", kDefaultPointLightCount);
+        if (pointLightCount > kMaxPointLightCount) {
+            PPX_LOG_WARN("--point-light-count " << pointLightCount << " is clamped to " << kMaxPointLightCount);
+            pointLightCount = kMaxPointLightCount;
+        }
+        if (pointLightCount > LIGHT_CULLING_MAX_LIGHTS_PER_TILE) {
+            PPX_LOG_WARN("--point-light-count " << pointLightCount << " is more than a tile holds (" << LIGHT_CULLING_MAX_LIGHTS_PER_TILE << "), crowded tiles drop their highest light indices");
+        }
+        mPointLightCount     = static_cast<int>(pointLightCount);
+        mEnableTiledLighting = clOptions.GetExtraOptionValueOrDefault<bool>("tiled-light-culling", true);
+    }
+
     // Cameras
     {
         mCamera = PerspCamera(60.0f, GetWindowAspect());
@@ -456,14 +651,15 @@ void ProjApp::Setup()
     {
         // clang-format off
         grfx::DescriptorSetLayoutCreateInfo createInfo = {};
-        createInfo.bindings.push_back({grfx::DescriptorBinding{GBUFFER_RT0_REGISTER,       grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE,  1, grfx::SHADER_STAGE_ALL_GRAPHICS}});
-        createInfo.bindings.push_back({grfx::DescriptorBinding{GBUFFER_RT1_REGISTER,       grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE,  1, grfx::SHADER_STAGE_ALL_GRAPHICS}});
-        createInfo.bindings.push_back({grfx::DescriptorBinding{GBUFFER_RT2_REGISTER,       grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE,  1, grfx::SHADER_STAGE_ALL_GRAPHICS}});
-        createInfo.bindings.push_back({grfx::DescriptorBinding{GBUFFER_RT3_REGISTER,       grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE,  1, grfx::SHADER_STAGE_ALL_GRAPHICS}});
-        createInfo.bindings.push_back({grfx::DescriptorBinding{GBUFFER_ENV_REGISTER,       grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE,  1, grfx::SHADER_STAGE_ALL_GRAPHICS}});
-        createInfo.bindings.push_back({grfx::DescriptorBinding{GBUFFER_IBL_REGISTER,       grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE,  1, grfx::SHADER_STAGE_ALL_GRAPHICS}});
-        createInfo.bindings.push_back({grfx::DescriptorBinding{GBUFFER_SAMPLER_REGISTER,   grfx::DESCRIPTOR_TYPE_SAMPLER,        1, grfx::SHADER_STAGE_ALL_GRAPHICS}});
-        createInfo.bindings.push_back({grfx::DescriptorBinding{GBUFFER_CONSTANTS_REGISTER, grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, grfx::SHADER_STAGE_ALL_GRAPHICS}});
+        createInfo.bindings.push_back({grfx::DescriptorBinding{GBUFFER_RT0_REGISTER,         grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE,      1, grfx::SHADER_STAGE_ALL_GRAPHICS}});
+        createInfo.bindings.push_back({grfx::DescriptorBinding{GBUFFER_RT1_REGISTER,         grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE,      1, grfx::SHADER_STAGE_ALL_GRAPHICS}});
+        createInfo.bindings.push_back({grfx::DescriptorBinding{GBUFFER_RT2_REGISTER,         grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE,      1, grfx::SHADER_STAGE_ALL_GRAPHICS}});
+        createInfo.bindings.push_back({grfx::DescriptorBinding{GBUFFER_RT3_REGISTER,         grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE,      1, grfx::SHADER_STAGE_ALL_GRAPHICS}});
+        createInfo.bindings.push_back({grfx::DescriptorBinding{GBUFFER_ENV_REGISTER,         grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE,      1, grfx::SHADER_STAGE_ALL_GRAPHICS}});
+        createInfo.bindings.push_back({grfx::DescriptorBinding{GBUFFER_IBL_REGISTER,         grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE,      1, grfx::SHADER_STAGE_ALL_GRAPHICS}});
+        createInfo.bindings.push_back({grfx::DescriptorBinding{GBUFFER_SAMPLER_REGISTER,     grfx::DESCRIPTOR_TYPE_SAMPLER,            1, grfx::SHADER_STAGE_ALL_GRAPHICS}});
+        createInfo.bindings.push_back({grfx::DescriptorBinding{GBUFFER_CONSTANTS_REGISTER,   grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER,     1, grfx::SHADER_STAGE_ALL_GRAPHICS}});
+        createInfo.bindings.push_back({grfx::DescriptorBinding{GBUFFER_TILE_LIGHTS_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER, 1, grfx::SHADER_STAGE_ALL_GRAPHICS}});
         PPX_CHECKED_CALL(GetDevice()->CreateDescriptorSetLayout(&createInfo, &mGBufferReadLayout));
         // clang-format on
 
@@ -472,7 +668,7 @@ void ProjApp::Setup()
         mGBufferReadSet->SetName("GBuffer Read");
 
         // Write descriptors
-        grfx::WriteDescriptor writes[8] = {};
+        grfx::WriteDescriptor writes[9] = {};
         writes[0].binding               = GBUFFER_RT0_REGISTER;
         writes[0].arrayIndex            = 0;
         writes[0].type                  = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
@@ -509,7 +705,14 @@ void ProjApp::Setup()
         writes[7].bufferRange  = PPX_WHOLE_SIZE;
         writes[7].pBuffer      = mGBufferDrawAttrConstants;
 
-        PPX_CHECKED_CALL(mGBufferReadSet->UpdateDescriptors(8, writes));
+        writes[8].binding                = GBUFFER_TILE_LIGHTS_REGISTER;
+        writes[8].type                   = grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER;
+        writes[8].bufferOffset           = 0;
+        writes[8].bufferRange            = PPX_WHOLE_SIZE;
+        writes[8].structuredElementCount = mTileCountX * mTileCountY * LIGHT_CULLING_TILE_STRIDE;
+        writes[8].pBuffer                = mTileLightsBuffer;
+
+        PPX_CHECKED_CALL(mGBufferReadSet->UpdateDescriptors(9, writes));
     }
 
     // Create per frame objects
@@ -531,13 +734,13 @@ void ProjApp::Setup()
 
         // Light constants
         bufferCreateInfo                             = {};
-        bufferCreateInfo.size                        = PPX_MINIMUM_STRUCTURED_BUFFER_SIZE;
+        bufferCreateInfo.size                        = std::max<uint64_t>(kMaxLightCount * sizeof(HlslLight), PPX_MINIMUM_STRUCTURED_BUFFER_SIZE);
         bufferCreateInfo.usageFlags.bits.transferSrc = true;
         bufferCreateInfo.memoryUsage                 = grfx::MEMORY_USAGE_CPU_TO_GPU;
-        bufferCreateInfo.structuredElementStride     = 32;
+        bufferCreateInfo.structuredElementStride     = sizeof(HlslLight);
         PPX_CHECKED_CALL(GetDevice()->CreateBuffer(&bufferCreateInfo, &mCpuLightConstants));
 
-        bufferCreateInfo.structuredElementStride            = 32;
+        bufferCreateInfo.structuredElementStride            = sizeof(HlslLight);
         bufferCreateInfo.usageFlags.bits.transferDst        = true;
         bufferCreateInfo.usageFlags.bits.roStructuredBuffer = true;
         bufferCreateInfo.memoryUsage                        = grfx::MEMORY_USAGE_GPU_ONLY;
@@ -545,8 +748,9 @@ void ProjApp::Setup()
 
         // Descriptor set layout
         grfx::DescriptorSetLayoutCreateInfo createInfo = {};
-        createInfo.bindings.push_back({grfx::DescriptorBinding{SCENE_CONSTANTS_REGISTER, grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, grfx::SHADER_STAGE_ALL_GRAPHICS}});
-        createInfo.bindings.push_back({grfx::DescriptorBinding{LIGHT_DATA_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER, 1, grfx::SHADER_STAGE_ALL_GRAPHICS}});
+        // Also read by the light culling compute pass
+        createInfo.bindings.push_back({grfx::DescriptorBinding{SCENE_CONSTANTS_REGISTER, grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, grfx::SHADER_STAGE_ALL}});
+        createInfo.bindings.push_back({grfx::DescriptorBinding{LIGHT_DATA_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER, 1, grfx::SHADER_STAGE_ALL}});
         PPX_CHECKED_CALL(GetDevice()->CreateDescriptorSetLayout(&createInfo, &mSceneDataLayout));
 
         // Allocate descriptor set
@@ -566,7 +770,7 @@ void ProjApp::Setup()
         writes[1].type                   = grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER;
         writes[1].bufferOffset           = 0;
         writes[1].bufferRange            = PPX_WHOLE_SIZE;
-        writes[1].structuredElementCount = 1;
+        writes[1].structuredElementCount = kMaxLightCount;
         writes[1].pBuffer                = mGpuLightConstants;
         PPX_CHECKED_CALL(mSceneDataSet->UpdateDescriptors(2, writes));
     }
@@ -583,6 +787,9 @@ void ProjApp::Setup()
     // Setup GBuffer lighting
     SetupGBufferLightQuad();
 
+    // Setup light culling compute pass
+    SetupLightCulling();
+
     // Setup fullscreen quad for debug
     SetupDebugDraw();
 
@@ -625,6 +832,7 @@ void ProjApp::UpdateConstants()
             hlsl_float<4>     ambient;
             hlsl_float<4>     iblLevelCount;
             hlsl_float<4>     envLevelCount;
+            hlsl_uint<4>      unboundedLightCount;
         };
         PPX_HLSL_PACK_END();
 
@@ -634,10 +842,11 @@ void ProjApp::UpdateConstants()
         HlslSceneData* pSceneData        = static_cast<HlslSceneData*>(pMappedAddress);
         pSceneData->viewProjectionMatrix = mCamera.GetViewProjectionMatrix();
         pSceneData->eyePosition          = mCamera.GetEyePosition();
-        pSceneData->lightCount           = 5;
+        pSceneData->lightCount           = kKeyLightCount + static_cast<uint32_t>(mPointLightCount);
         pSceneData->ambient              = 0.0f;
         pSceneData->iblLevelCount        = 0;
         pSceneData->envLevelCount        = 0;
+        pSceneData->unboundedLightCount  = kKeyLightCount;
 
         mCpuSceneConstants->UnmapMemory();
 
@@ -647,16 +856,6 @@ void ProjApp::UpdateConstants()
 
     // Light constants
     {
-        PPX_HLSL_PACK_BEGIN();
-        struct HlslLight
-        {
-            hlsl_uint<4>    type;
-            hlsl_float3<12> position;
-            hlsl_float3<12> color;
-            hlsl_float<4>   intensity;
-        };
-        PPX_HLSL_PACK_END();
-
         void* pMappedAddress = nullptr;
         PPX_CHECKED_CALL(mCpuLightConstants->MapMemory(0, &pMappedAddress));
 
@@ -668,14 +867,37 @@ void ProjApp::UpdateConstants()
         pLight[2].position = float3(1, 10, 3) * float3(sin(t / 2), 1, cos(t / 2));
         pLight[3].position = float3(-1, 0, 15) * float3(sin(t / 3), 1, cos(t / 3));
         pLight[4].position = float3(-1, 2, -5) * float3(sin(t / 4), 1, cos(t / 4));
-        pLight[5].position = float3(-6, 3, -4) * float3(sin(t / 5), 1, cos(t / 5));
 
         pLight[0].intensity = 0.5f;
         pLight[1].intensity = 0.25f;
         pLight[2].intensity = 0.5f;
         pLight[3].intensity = 0.25f;
         pLight[4].intensity = 0.5f;
-        pLight[5].intensity = 0.25f;
+
+        for (uint32_t i = 0; i < kKeyLightCount; ++i) {
+            pLight[i].color  = float3(1);
+            pLight[i].radius = 0.0f;
+        }
+
+        // Point lights circle over the floor at fixed per light radii,
+        // heights and speeds. Their intensity goes down as more of them
+        // are added to keep the scene from saturating.
+        float pointIntensity = 2.0f * std::min(1.0f, 64.0f / static_cast<float>(std::max(mPointLightCount, 1)));
+        for (uint32_t i = 0; i < static_cast<uint32_t>(mPointLightCount); ++i) {
+            float h = static_cast<float>(i) * 0.618034f;
+            h       = h - floor(h);
+
+            float orbit = 0.75f + 4.0f * fmod(static_cast<float>(i) * 0.381966f, 1.0f);
+            float speed = (0.1f + 0.4f * fmod(static_cast<float>(i) * 0.754878f, 1.0f)) * ((i % 2) ? 1.0f : -1.0f);
+            float a     = h * 2.0f * kPi + t * speed;
+            float y     = 0.25f + 2.0f * fmod(static_cast<float>(i) * 0.569840f, 1.0f);
+
+            HlslLight& light = pLight[kKeyLightCount + i];
+            light.position   = float3(orbit * cos(a), y, orbit * sin(a));
+            light.color      = float3(0.6f) + 0.4f * glm::cos(2.0f * kPi * (float3(h) + float3(0.0f, 0.333f, 0.667f)));
+            light.intensity  = pointIntensity;
+            light.radius     = kPointLightRadius;
+        }
 
         mCpuLightConstants->UnmapMemory();
 
@@ -696,6 +918,8 @@ void ProjApp::UpdateConstants()
             hlsl_uint<4> enableIBL;
             hlsl_uint<4> enableEnv;
             hlsl_uint<4> debugAttrIndex;
+            hlsl_uint<4> enableTiledLighting;
+            hlsl_uint<4> tileCountX;
         };
         PPX_HLSL_PACK_END();
 
@@ -708,8 +932,33 @@ void ProjApp::UpdateConstants()
         pGBufferData->enableEnv      = mEnableEnv;
         pGBufferData->debugAttrIndex = mGBufferAttrIndex;
 
+        pGBufferData->enableTiledLighting = mEnableTiledLighting;
+        pGBufferData->tileCountX          = mTileCountX;
+
         mGBufferDrawAttrConstants->UnmapMemory();
     }
+
+    // Light culling constants
+    {
+        PPX_HLSL_PACK_BEGIN();
+        struct HlslLightCullingData
+        {
+            hlsl_float4x4<64> inverseViewProjectionMatrix;
+            hlsl_uint2<8>     screenSize;
+            hlsl_uint2<8>     tileCount;
+        };
+        PPX_HLSL_PACK_END();
+
+        void* pMappedAddress = nullptr;
+        PPX_CHECKED_CALL(mLightCullingConstants->MapMemory(0, &pMappedAddress));
+
+        HlslLightCullingData* pCullingData        = static_cast<HlslLightCullingData*>(pMappedAddress);
+        pCullingData->inverseViewProjectionMatrix = glm::inverse(mCamera.GetViewProjectionMatrix());
+        pCullingData->screenSize                  = uint2(mGBufferRenderPass->GetWidth(), mGBufferRenderPass->GetHeight());
+        pCullingData->tileCount                   = uint2(mTileCountX, mTileCountY);
+
+        mLightCullingConstants->UnmapMemory();
+    }
 }
 
 void ProjApp::Render()
@@ -730,19 +979,35 @@ void ProjApp::Render()
     // Update constants
     UpdateConstants();
 
+    // Read light culling stats of the previous frame
+    if (mLightCullingStatsCopied) {
+        void* pMappedAddress = nullptr;
+        PPX_CHECKED_CALL(mLightCullingStatsReadbackBuffer->MapMemory(0, &pMappedAddress));
+        const uint32_t* pStats = static_cast<const uint32_t*>(pMappedAddress);
+        mOverflowTileCount     = pStats[LIGHT_CULLING_STATS_OVERFLOW_TILE_COUNT_INDEX];
+        mDroppedLightCount     = pStats[LIGHT_CULLING_STATS_DROPPED_LIGHT_COUNT_INDEX];
+        mLightCullingStatsReadbackBuffer->UnmapMemory();
+    }
+    else {
+        mOverflowTileCount = 0;
+        mDroppedLightCount = 0;
+    }
+
 #ifdef ENABLE_GPU_QUERIES
     // Read query results
     if (GetFrameCount() > 0) {
-        uint64_t data[2] = {0};
-        PPX_CHECKED_CALL(frame.timestampQuery->GetData(data, 2 * sizeof(uint64_t)));
-        mTotalGpuFrameTime = data[1] - data[0];
+        uint64_t data[4] = {0};
+        PPX_CHECKED_CALL(frame.timestampQuery->GetData(data, 4 * sizeof(uint64_t)));
+        mTotalGpuFrameTime   = data[3] - data[0];
+        mLightCullingGpuTime = data[2] - data[1];
+        mLightingGpuTime     = data[3] - data[2];
         if (GetDevice()->PipelineStatsAvailable()) {
             PPX_CHECKED_CALL(frame.pipelineStatsQuery->GetData(&mPipelineStatistics, sizeof(grfx::PipelineStatistics)));
         }
     }
 
     // Reset query
-    frame.timestampQuery->Reset(0, 2);
+    frame.timestampQuery->Reset(0, 4);
     if (GetDevice()->PipelineStatsAvailable()) {
         frame.pipelineStatsQuery->Reset(0, 1);
     }
@@ -757,11 +1022,9 @@ void ProjApp::Render()
         // =====================================================================
         //  GBuffer render
         // =====================================================================
-        frame.cmd->TransitionImageLayout(
+        frame.cmd->RequireResourceState(
             mGBufferRenderPass,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
             grfx::RESOURCE_STATE_RENDER_TARGET,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
             grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
         frame.cmd->BeginRenderPass(mGBufferRenderPass, grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_RENDER_TARGETS | grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_DEPTH);
         {
@@ -784,21 +1047,54 @@ void ProjApp::Render()
 #endif
         }
         frame.cmd->EndRenderPass();
-        frame.cmd->TransitionImageLayout(
-            mGBufferRenderPass,
-            grfx::RESOURCE_STATE_RENDER_TARGET,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE);
+#ifdef ENABLE_GPU_QUERIES
+        frame.cmd->WriteTimestamp(frame.timestampQuery, grfx::PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 1);
+#endif
+
+        // =====================================================================
+        //  Light culling
+        // =====================================================================
+        // Builds the light list of every screen tile from the gbuffer depth,
+        // the light pass only shades the lights of the pixel's tile.
+        if (mEnableTiledLighting) {
+            frame.cmd->RequireResourceState(mGBufferRenderPass->GetDepthStencilTexture()->GetImage(), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+            frame.cmd->RequireResourceState(mTileLightsBuffer, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+
+            grfx::BufferToBufferCopyInfo statsCopyInfo = {};
+            statsCopyInfo.size                         = LIGHT_CULLING_STATS_COUNT * sizeof(uint32_t);
+            frame.cmd->RequireResourceState(mLightCullingStatsBuffer, grfx::RESOURCE_STATE_COPY_DST);
+            frame.cmd->CopyBufferToBuffer(&statsCopyInfo, mLightCullingStatsClearBuffer, mLightCullingStatsBuffer);
+            frame.cmd->RequireResourceState(mLightCullingStatsBuffer, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+
+            grfx::DescriptorSet* sets[2] = {nullptr};
+            sets[0]                      = mSceneDataSet;
+            sets[1]                      = mLightCullingSet;
+            frame.cmd->BindComputeDescriptorSets(mLightCullingPipelineInterface, 2, sets);
+            frame.cmd->BindComputePipeline(mLightCullingPipeline);
+            frame.cmd->Dispatch(mTileCountX, mTileCountY, 1);
+
+            frame.cmd->RequireResourceState(mLightCullingStatsBuffer, grfx::RESOURCE_STATE_COPY_SRC);
+            frame.cmd->CopyBufferToBuffer(&statsCopyInfo, mLightCullingStatsBuffer, mLightCullingStatsReadbackBuffer);
+        }
+        mLightCullingStatsCopied = mEnableTiledLighting;
+#ifdef ENABLE_GPU_QUERIES
+        frame.cmd->WriteTimestamp(frame.timestampQuery, grfx::PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 2);
+#endif
 
         // =====================================================================
         //  GBuffer light
         // =====================================================================
-        frame.cmd->TransitionImageLayout(
+        // The light pass shares the depth buffer with the gbuffer pass, the
+        // tracker takes it to depth read from depth write or, when the light
+        // culling pass ran, from shader resource. All of these transitions
+        // are recorded as one batch by BeginRenderPass.
+        frame.cmd->RequireResourceState(mTileLightsBuffer, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+        for (uint32_t i = 0; i < mGBufferRenderPass->GetRenderTargetCount(); ++i) {
+            frame.cmd->RequireResourceState(mGBufferRenderPass->GetRenderTargetTexture(i)->GetImage(), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+        }
+        frame.cmd->RequireResourceState(
             mGBufferLightPass,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
             grfx::RESOURCE_STATE_RENDER_TARGET,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
             grfx::RESOURCE_STATE_DEPTH_STENCIL_READ);
         frame.cmd->BeginRenderPass(mGBufferLightPass, grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_RENDER_TARGETS);
         {
@@ -816,15 +1112,10 @@ void ProjApp::Render()
         }
         frame.cmd->EndRenderPass();
 #ifdef ENABLE_GPU_QUERIES
-        frame.cmd->WriteTimestamp(frame.timestampQuery, grfx::PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 1);
+        frame.cmd->WriteTimestamp(frame.timestampQuery, grfx::PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 3);
 #endif
 
-        frame.cmd->TransitionImageLayout(
-            mGBufferLightPass,
-            grfx::RESOURCE_STATE_RENDER_TARGET,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_DEPTH_STENCIL_READ,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE);
+        frame.cmd->RequireResourceState(mGBufferLightRenderTarget->GetImage(), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE);
 
         // =====================================================================
         //  Blit to swapchain
@@ -835,7 +1126,7 @@ void ProjApp::Render()
         frame.cmd->SetScissors(renderPass->GetScissor());
         frame.cmd->SetViewports(renderPass->GetViewport());
 
-        frame.cmd->TransitionImageLayout(renderPass->GetRenderTargetImage(0), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_PRESENT, grfx::RESOURCE_STATE_RENDER_TARGET);
+        frame.cmd->RequireResourceState(renderPass->GetRenderTargetImage(0), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_RENDER_TARGET);
         frame.cmd->BeginRenderPass(renderPass);
         {
             // Draw gbuffer light output to swapchain
@@ -846,17 +1137,20 @@ void ProjApp::Render()
             DrawImGui(frame.cmd);
         }
         frame.cmd->EndRenderPass();
-        frame.cmd->TransitionImageLayout(renderPass->GetRenderTargetImage(0), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_PRESENT);
+        frame.cmd->RequireResourceState(renderPass->GetRenderTargetImage(0), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_PRESENT);
     }
 #ifdef ENABLE_GPU_QUERIES
     // Resolve queries
-    frame.cmd->ResolveQueryData(frame.timestampQuery, 0, 2);
+    frame.cmd->ResolveQueryData(frame.timestampQuery, 0, 4);
     if (GetDevice()->PipelineStatsAvailable()) {
         frame.cmd->ResolveQueryData(frame.pipelineStatsQuery, 0, 1);
     }
 #endif
     PPX_CHECKED_CALL(frame.cmd->End());
 
+    mBarrierCount      = frame.cmd->GetBarrierCount();
+    mBarrierBatchCount = frame.cmd->GetBarrierBatchCount();
+
     grfx::SubmitInfo submitInfo     = {};
     submitInfo.commandBufferCount   = 1;
     submitInfo.ppCommandBuffers     = &frame.cmd;
@@ -871,6 +1165,51 @@ void ProjApp::Render()
     PPX_CHECKED_CALL(swapchain->Present(imageIndex, 1, &frame.renderCompleteSemaphore));
 }
 
+void ProjApp::SetupMetrics()
+{
+    Application::SetupMetrics();
+    if (!HasActiveMetricsRun()) {
+        return;
+    }
+
+    ppx::metrics::MetricMetadata metadata = {ppx::metrics::MetricType::GAUGE, "Light Culling GPU Time", "ms", ppx::metrics::MetricInterpretation::LOWER_IS_BETTER, {0.f, 10000.f}};
+    mLightCullingTimeMetric               = AddMetric(metadata);
+    PPX_ASSERT_MSG(mLightCullingTimeMetric != ppx::metrics::kInvalidMetricID, "Failed to add Light Culling GPU Time metric");
+
+    metadata            = {ppx::metrics::MetricType::GAUGE, "Lighting GPU Time", "ms", ppx::metrics::MetricInterpretation::LOWER_IS_BETTER, {0.f, 10000.f}};
+    mLightingTimeMetric = AddMetric(metadata);
+    PPX_ASSERT_MSG(mLightingTimeMetric != ppx::metrics::kInvalidMetricID, "Failed to add Lighting GPU Time metric");
+
+    metadata            = {ppx::metrics::MetricType::GAUGE, "Light Culling Overflow Tiles", "tiles", ppx::metrics::MetricInterpretation::LOWER_IS_BETTER, {0.f, std::numeric_limits<double>::max()}};
+    mOverflowTileMetric = AddMetric(metadata);
+    PPX_ASSERT_MSG(mOverflowTileMetric != ppx::metrics::kInvalidMetricID, "Failed to add Light Culling Overflow Tiles metric");
+}
+
+void ProjApp::UpdateMetrics()
+{
+    if (!HasActiveMetricsRun() || (GetFrameCount() == 0)) {
+        return;
+    }
+
+    uint64_t frequency = 0;
+    GetGraphicsQueue()->GetTimestampFrequency(&frequency);
+    if (frequency == 0) {
+        return;
+    }
+
+    ppx::metrics::MetricData data = {ppx::metrics::MetricType::GAUGE};
+    data.gauge.seconds            = GetElapsedSeconds();
+
+    data.gauge.value = static_cast<double>(mLightCullingGpuTime) / static_cast<double>(frequency) * 1000.0;
+    RecordMetricData(mLightCullingTimeMetric, data);
+
+    data.gauge.value = static_cast<double>(mLightingGpuTime) / static_cast<double>(frequency) * 1000.0;
+    RecordMetricData(mLightingTimeMetric, data);
+
+    data.gauge.value = static_cast<double>(mOverflowTileCount);
+    RecordMetricData(mOverflowTileMetric, data);
+}
+
 void ProjApp::DrawGui()
 {
     ImGui::Separator();
@@ -894,6 +1233,11 @@ void ProjApp::DrawGui()
 
     ImGui::Separator();
 
+    ImGui::Checkbox("Tiled Light Culling", &mEnableTiledLighting);
+    ImGui::SliderInt("Point Lights", &mPointLightCount, 0, static_cast<int>(kMaxPointLightCount));
+
+    ImGui::Separator();
+
     ImGui::Columns(2);
 
     uint64_t frequency = 0;
@@ -903,6 +1247,31 @@ void ProjApp::DrawGui()
     ImGui::Text("%f ms ", static_cast<float>(mTotalGpuFrameTime / static_cast<double>(frequency)) * 1000.0f);
     ImGui::NextColumn();
 
+    ImGui::Text("Light Culling GPU Time");
+    ImGui::NextColumn();
+    ImGui::Text("%f ms ", static_cast<float>(mLightCullingGpuTime / static_cast<double>(frequency)) * 1000.0f);
+    ImGui::NextColumn();
+
+    ImGui::Text("Lighting GPU Time");
+    ImGui::NextColumn();
+    ImGui::Text("%f ms ", static_cast<float>(mLightingGpuTime / static_cast<double>(frequency)) * 1000.0f);
+    ImGui::NextColumn();
+
+    ImGui::Text("Tiles");
+    ImGui::NextColumn();
+    ImGui::Text("%u x %u", mTileCountX, mTileCountY);
+    ImGui::NextColumn();
+
+    ImGui::Text("Overflow Tiles / Dropped Lights");
+    ImGui::NextColumn();
+    ImGui::Text("%u / %u", mOverflowTileCount, mDroppedLightCount);
+    ImGui::NextColumn();
+
+    ImGui::Text("Barriers / Batches");
+    ImGui::NextColumn();
+    ImGui::Text("%u / %u", mBarrierCount, mBarrierBatchCount);
+    ImGui::NextColumn();
+
     ImGui::Separator();
 
     ImGui::Text("IAVertices");
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "ppx/ppx.h"
+#include "ppx/async_compute.h"
 #include "ppx/camera.h"
 #include "ppx/graphics_util.h"
 
@@ -28,12 +29,16 @@ class ProjApp
     : public ppx::Application
 {
 public:
+    virtual void InitKnobs() override;
     virtual void Config(ppx::ApplicationSettings& settings) override;
     virtual void Setup() override;
+    virtual void Shutdown() override;
     virtual void Render() override;
 
 protected:
     virtual void DrawGui() override;
+    virtual void SetupMetrics() override;
+    virtual void UpdateMetrics() override;
 
 private:
     void SetupComposition();
@@ -55,7 +60,6 @@ private:
             grfx::DescriptorSetPtr descriptorSet;
             grfx::BufferPtr        constants;
             grfx::DrawPassPtr      drawPass;
-            grfx::SemaphorePtr     completeSemaphore;
         };
 
         std::array<RenderData, 4> renderData;
@@ -63,13 +67,13 @@ private:
         // Compute pipeline objects.
         struct ComputeData
         {
-            grfx::CommandBufferPtr    cmd;
+            grfx::CommandBufferPtr    cmd;      // Graphics queue
+            grfx::CommandBufferPtr    asyncCmd; // Compute queue
             grfx::DescriptorSetPtr    descriptorSet;
             grfx::BufferPtr           constants;
             grfx::ImagePtr            outputImage;
             grfx::SampledImageViewPtr outputImageSampledView;
             grfx::StorageImageViewPtr outputImageStorageView;
-            grfx::SemaphorePtr        completeSemaphore;
         };
         std::array<ComputeData, 4> computeData;
 
@@ -115,10 +119,10 @@ private:
     grfx::SamplerPtr mLinearSampler;
     grfx::SamplerPtr mNearestSampler;
 
-    // This will be a compute queue if async compute is enabled,
-    // or a graphics queue otherwise.
-    grfx::QueuePtr mComputeQueue;
-    grfx::QueuePtr mGraphicsQueue;
+    // Picks the queue compute work runs on every frame, and owns the
+    // semaphores between the rendering, compute and composition steps:
+    // RenderCompleteSemaphore() and ComputeCompleteSemaphore().
+    AsyncComputeScheduler mScheduler;
 
     grfx::DescriptorPoolPtr mDescriptorPool;
 
@@ -138,10 +142,31 @@ private:
     grfx::DescriptorSetLayoutPtr mDrawToSwapchainLayout;
     grfx::FullscreenQuadPtr      mDrawToSwapchainPipeline;
 
-    bool mAsyncComputeEnabled     = true;
-    bool mUseQueueFamilyTransfers = true;
+    std::shared_ptr<KnobCheckbox> pEnableAsyncCompute;
+    bool                          mUseQueueFamilyTransfers = true;
 };
 
+namespace {
+
+grfx::Semaphore* RenderCompleteSemaphore(const AsyncComputeScheduler& scheduler, size_t quadIndex)
+{
+    return scheduler.GetSemaphore(static_cast<uint32_t>(2 * quadIndex));
+}
+
+grfx::Semaphore* ComputeCompleteSemaphore(const AsyncComputeScheduler& scheduler, size_t quadIndex)
+{
+    return scheduler.GetSemaphore(static_cast<uint32_t>(2 * quadIndex + 1));
+}
+
+} // namespace
+
+void ProjApp::InitKnobs()
+{
+    pEnableAsyncCompute = GetKnobManager().CreateKnob<ppx::KnobCheckbox>("enable-async-compute", true);
+    pEnableAsyncCompute->SetDisplayName("Async Compute");
+    pEnableAsyncCompute->SetFlagDescription("Runs the image filtering steps on the compute queue. When disabled, compute work is executed synchronously on the same graphics queue where graphics work is scheduled.");
+}
+
 void ProjApp::Config(ppx::ApplicationSettings& settings)
 {
     settings.appName                       = "23_async_compute";
@@ -159,16 +184,22 @@ void ProjApp::Setup()
 {
     auto cl_options = GetExtraOptions();
 
-    // Whether async compute is used or not.
-    mAsyncComputeEnabled = cl_options.GetExtraOptionValueOrDefault<bool>("enable-async-compute", true);
-
     // Whether to use queue family transfers in Vulkan (not required in DX12).
     mUseQueueFamilyTransfers = cl_options.GetExtraOptionValueOrDefault<bool>("use-queue-family-transfers", true);
 
     mCamera = PerspCamera(60.0f, GetWindowAspect());
 
-    mGraphicsQueue = GetGraphicsQueue();
-    mComputeQueue  = mAsyncComputeEnabled ? GetComputeQueue() : mGraphicsQueue;
+    // Async compute scheduler. Async compute can be toggled at runtime, so
+    // the compute steps have command buffers on both queues.
+    {
+        AsyncComputeSchedulerCreateInfo createInfo = {};
+        createInfo.pGraphicsQueue                  = GetGraphicsQueue();
+        createInfo.pComputeQueue                   = GetComputeQueue();
+        createInfo.frameCount                      = mNumFramesInFlight;
+        createInfo.semaphoreCount                  = 8;
+        createInfo.queueFamilyTransfers            = mUseQueueFamilyTransfers;
+        PPX_CHECKED_CALL(mScheduler.Initialize(GetDevice(), createInfo));
+    }
 
     // Per frame data
     for (uint32_t i = 0; i < mNumFramesInFlight; ++i) {
@@ -176,17 +207,18 @@ void ProjApp::Setup()
         grfx::SemaphoreCreateInfo semaCreateInfo = {};
 
         for (uint32_t d = 0; d < frame.renderData.size(); ++d) {
-            PPX_CHECKED_CALL(mGraphicsQueue->CreateCommandBuffer(&frame.renderData[d].cmd));
-            PPX_CHECKED_CALL(mGraphicsQueue->CreateCommandBuffer(&frame.composeData[d].cmd));
-            PPX_CHECKED_CALL(mComputeQueue->CreateCommandBuffer(&frame.computeData[d].cmd));
+            PPX_CHECKED_CALL(GetGraphicsQueue()->CreateCommandBuffer(&frame.renderData[d].cmd));
+            PPX_CHECKED_CALL(GetGraphicsQueue()->CreateCommandBuffer(&frame.composeData[d].cmd));
+            PPX_CHECKED_CALL(GetGraphicsQueue()->CreateCommandBuffer(&frame.computeData[d].cmd));
+            if (mScheduler.IsAvailable()) {
+                PPX_CHECKED_CALL(GetComputeQueue()->CreateCommandBuffer(&frame.computeData[d].asyncCmd));
+            }
 
-            PPX_CHECKED_CALL(GetDevice()->CreateSemaphore(&semaCreateInfo, &frame.renderData[d].completeSemaphore));
-            PPX_CHECKED_CALL(GetDevice()->CreateSemaphore(&semaCreateInfo, &frame.computeData[d].completeSemaphore));
             PPX_CHECKED_CALL(GetDevice()->CreateSemaphore(&semaCreateInfo, &frame.composeData[d].completeSemaphore));
         }
 
         // Use the graphics queue for drawing to the swapchain.
-        PPX_CHECKED_CALL(mGraphicsQueue->CreateCommandBuffer(&frame.drawToSwapchainData.cmd));
+        PPX_CHECKED_CALL(GetGraphicsQueue()->CreateCommandBuffer(&frame.drawToSwapchainData.cmd));
 
         grfx::FenceCreateInfo fenceCreateInfo = {};
         PPX_CHECKED_CALL(GetDevice()->CreateFence(&fenceCreateInfo, &frame.imageAcquiredFence));
@@ -694,6 +726,11 @@ void ProjApp::SetupDrawToSwapchain()
     }
 }
 
+void ProjApp::Shutdown()
+{
+    mScheduler.Shutdown();
+}
+
 void ProjApp::MouseMove(int32_t x, int32_t y, int32_t dx, int32_t dy, uint32_t buttons)
 {
     if (buttons & ppx::MOUSE_BUTTON_LEFT) {
@@ -728,6 +765,11 @@ void ProjApp::Render()
 
     uint32_t imageIndex = AcquireFrame(frame);
 
+    // The frame's previous work has completed, read its timestamps and
+    // pick the queue for this frame's compute work.
+    mScheduler.SetEnabled(pEnableAsyncCompute->GetValue());
+    mScheduler.BeginFrame(GetInFlightFrameIndex());
+
     UpdateTransforms(frame);
 
     for (size_t quadIndex = 0; quadIndex < 4; ++quadIndex) {
@@ -767,6 +809,8 @@ void ProjApp::DrawScene(PerFrame& frame, size_t quadIndex)
     PerFrame::RenderData& renderData = frame.renderData[quadIndex];
     PPX_CHECKED_CALL(renderData.cmd->Begin());
     {
+        mScheduler.BeginWork(renderData.cmd, ASYNC_COMPUTE_WORK_GRAPHICS);
+
         renderData.cmd->SetScissors(renderData.drawPass->GetScissor());
         renderData.cmd->SetViewports(renderData.drawPass->GetViewport());
 
@@ -788,67 +832,68 @@ void ProjApp::DrawScene(PerFrame& frame, size_t quadIndex)
         renderData.cmd->TransitionImageLayout(renderData.drawPass->GetRenderTargetTexture(0), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_SHADER_RESOURCE);
 
         // Release from graphics queue to compute queue.
-        if (mUseQueueFamilyTransfers) {
-            renderData.cmd->TransitionImageLayout(renderData.drawPass->GetRenderTargetTexture(0), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_SHADER_RESOURCE, mGraphicsQueue, mComputeQueue);
-        }
+        mScheduler.ReleaseToCompute(renderData.cmd, renderData.drawPass->GetRenderTargetTexture(0)->GetImage(), grfx::RESOURCE_STATE_SHADER_RESOURCE);
+
+        mScheduler.EndWork(renderData.cmd, ASYNC_COMPUTE_WORK_GRAPHICS);
     }
     PPX_CHECKED_CALL(renderData.cmd->End());
 
+    const grfx::Semaphore* pSignalSemaphore = RenderCompleteSemaphore(mScheduler, quadIndex);
+
     grfx::SubmitInfo submitInfo     = {};
     submitInfo.commandBufferCount   = 1;
     submitInfo.ppCommandBuffers     = &renderData.cmd;
     submitInfo.signalSemaphoreCount = 1;
-    submitInfo.ppSignalSemaphores   = &renderData.completeSemaphore;
+    submitInfo.ppSignalSemaphores   = &pSignalSemaphore;
 
-    PPX_CHECKED_CALL(GetGraphicsQueue()->Submit(&submitInfo));
+    PPX_CHECKED_CALL(mScheduler.Submit(ASYNC_COMPUTE_WORK_GRAPHICS, &submitInfo));
 }
 
 void ProjApp::RunCompute(PerFrame& frame, size_t quadIndex)
 {
     PerFrame::ComputeData& computeData = frame.computeData[quadIndex];
     PerFrame::RenderData&  renderData  = frame.renderData[quadIndex];
+    grfx::CommandBufferPtr cmd         = mScheduler.IsEnabled() ? computeData.asyncCmd : computeData.cmd;
 
-    PPX_CHECKED_CALL(computeData.cmd->Begin());
+    PPX_CHECKED_CALL(cmd->Begin());
     {
+        mScheduler.BeginWork(cmd, ASYNC_COMPUTE_WORK_COMPUTE);
+
         // Acquire from graphics queue to compute queue.
-        if (mUseQueueFamilyTransfers) {
-            computeData.cmd->TransitionImageLayout(renderData.drawPass->GetRenderTargetTexture(0), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_SHADER_RESOURCE, mGraphicsQueue, mComputeQueue);
-        }
+        mScheduler.AcquireFromGraphics(cmd, renderData.drawPass->GetRenderTargetTexture(0)->GetImage(), grfx::RESOURCE_STATE_SHADER_RESOURCE);
 
-        computeData.cmd->TransitionImageLayout(computeData.outputImage, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+        cmd->TransitionImageLayout(computeData.outputImage, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
         {
             grfx::DescriptorSet* sets[1] = {nullptr};
             sets[0]                      = computeData.descriptorSet;
-            computeData.cmd->BindComputeDescriptorSets(mComputePipelineInterface, 1, sets);
-            computeData.cmd->BindComputePipeline(mComputePipeline);
+            cmd->BindComputeDescriptorSets(mComputePipelineInterface, 1, sets);
+            cmd->BindComputePipeline(mComputePipeline);
             uint32_t dispatchX = static_cast<uint32_t>(std::ceil(computeData.outputImage->GetWidth() / 32.0));
             uint32_t dispatchY = static_cast<uint32_t>(std::ceil(computeData.outputImage->GetHeight() / 32.0));
             for (int i = 0; i < mComputeLoad; ++i)
-                computeData.cmd->Dispatch(dispatchX, dispatchY, 1);
+                cmd->Dispatch(dispatchX, dispatchY, 1);
         }
-        computeData.cmd->TransitionImageLayout(computeData.outputImage, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_UNORDERED_ACCESS, grfx::RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        cmd->TransitionImageLayout(computeData.outputImage, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_UNORDERED_ACCESS, grfx::RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
         // Release from compute queue to graphics queue.
-        if (mUseQueueFamilyTransfers) {
-            computeData.cmd->TransitionImageLayout(computeData.outputImage, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, grfx::RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, mComputeQueue, mGraphicsQueue);
-        }
+        mScheduler.ReleaseToGraphics(cmd, computeData.outputImage, grfx::RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+        mScheduler.EndWork(cmd, ASYNC_COMPUTE_WORK_COMPUTE);
     }
-    PPX_CHECKED_CALL(computeData.cmd->End());
+    PPX_CHECKED_CALL(cmd->End());
+
+    const grfx::Semaphore* pWaitSemaphore   = RenderCompleteSemaphore(mScheduler, quadIndex);
+    const grfx::Semaphore* pSignalSemaphore = ComputeCompleteSemaphore(mScheduler, quadIndex);
 
     grfx::SubmitInfo submitInfo     = {};
     submitInfo.commandBufferCount   = 1;
-    submitInfo.ppCommandBuffers     = &computeData.cmd;
+    submitInfo.ppCommandBuffers     = &cmd;
     submitInfo.waitSemaphoreCount   = 1;
-    submitInfo.ppWaitSemaphores     = &renderData.completeSemaphore;
+    submitInfo.ppWaitSemaphores     = &pWaitSemaphore;
     submitInfo.signalSemaphoreCount = 1;
-    submitInfo.ppSignalSemaphores   = &computeData.completeSemaphore;
+    submitInfo.ppSignalSemaphores   = &pSignalSemaphore;
 
-    if (mAsyncComputeEnabled) {
-        PPX_CHECKED_CALL(GetComputeQueue()->Submit(&submitInfo));
-    }
-    else {
-        PPX_CHECKED_CALL(GetGraphicsQueue()->Submit(&submitInfo));
-    }
+    PPX_CHECKED_CALL(mScheduler.Submit(ASYNC_COMPUTE_WORK_COMPUTE, &submitInfo));
 }
 
 void ProjApp::Compose(PerFrame& frame, size_t quadIndex)
@@ -858,15 +903,15 @@ void ProjApp::Compose(PerFrame& frame, size_t quadIndex)
 
     PPX_CHECKED_CALL(composeData.cmd->Begin());
     {
+        mScheduler.BeginWork(composeData.cmd, ASYNC_COMPUTE_WORK_GRAPHICS);
+
         grfx::DrawPassPtr renderPass = frame.composeDrawPass;
 
         composeData.cmd->SetScissors(renderPass->GetScissor());
         composeData.cmd->SetViewports(renderPass->GetViewport());
 
         // Acquire from compute queue to graphics queue.
-        if (mUseQueueFamilyTransfers) {
-            composeData.cmd->TransitionImageLayout(computeData.outputImage, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, grfx::RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, mComputeQueue, mGraphicsQueue);
-        }
+        mScheduler.AcquireFromCompute(composeData.cmd, computeData.outputImage, grfx::RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
         composeData.cmd->BeginRenderPass(renderPass, 0 /* do not clear render target */);
         {
@@ -880,18 +925,22 @@ void ProjApp::Compose(PerFrame& frame, size_t quadIndex)
             composeData.cmd->Draw(6);
         }
         composeData.cmd->EndRenderPass();
+
+        mScheduler.EndWork(composeData.cmd, ASYNC_COMPUTE_WORK_GRAPHICS);
     }
     PPX_CHECKED_CALL(composeData.cmd->End());
 
+    const grfx::Semaphore* pWaitSemaphore = ComputeCompleteSemaphore(mScheduler, quadIndex);
+
     grfx::SubmitInfo submitInfo     = {};
     submitInfo.commandBufferCount   = 1;
     submitInfo.ppCommandBuffers     = &composeData.cmd;
     submitInfo.waitSemaphoreCount   = 1;
-    submitInfo.ppWaitSemaphores     = &computeData.completeSemaphore;
+    submitInfo.ppWaitSemaphores     = &pWaitSemaphore;
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.ppSignalSemaphores   = &composeData.completeSemaphore;
 
-    PPX_CHECKED_CALL(GetGraphicsQueue()->Submit(&submitInfo));
+    PPX_CHECKED_CALL(mScheduler.Submit(ASYNC_COMPUTE_WORK_GRAPHICS, &submitInfo));
 }
 
 void ProjApp::BlitAndPresent(PerFrame& frame, uint32_t swapchainImageIndex)
@@ -903,6 +952,8 @@ void ProjApp::BlitAndPresent(PerFrame& frame, uint32_t swapchainImageIndex)
 
     PPX_CHECKED_CALL(cmd->Begin());
     {
+        mScheduler.BeginWork(cmd, ASYNC_COMPUTE_WORK_GRAPHICS);
+
         cmd->SetScissors(renderPass->GetScissor());
         cmd->SetViewports(renderPass->GetViewport());
         cmd->TransitionImageLayout(renderPass->GetRenderTargetImage(0), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_PRESENT, grfx::RESOURCE_STATE_RENDER_TARGET);
@@ -919,6 +970,11 @@ void ProjApp::BlitAndPresent(PerFrame& frame, uint32_t swapchainImageIndex)
         cmd->EndRenderPass();
         cmd->TransitionImageLayout(frame.composeDrawPass->GetRenderTargetTexture(0), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_PIXEL_SHADER_RESOURCE, grfx::RESOURCE_STATE_RENDER_TARGET);
         cmd->TransitionImageLayout(renderPass->GetRenderTargetImage(0), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_PRESENT);
+
+        // All other work of the frame completed before this command buffer
+        // runs, see the wait semaphores below.
+        mScheduler.EndWork(cmd, ASYNC_COMPUTE_WORK_GRAPHICS);
+        mScheduler.ResolveTimestamps(cmd);
     }
     PPX_CHECKED_CALL(cmd->End());
 
@@ -938,7 +994,7 @@ void ProjApp::BlitAndPresent(PerFrame& frame, uint32_t swapchainImageIndex)
     submitInfo.ppSignalSemaphores   = &frame.renderCompleteSemaphore;
     submitInfo.pFence               = frame.renderCompleteFence;
 
-    PPX_CHECKED_CALL(GetGraphicsQueue()->Submit(&submitInfo));
+    PPX_CHECKED_CALL(mScheduler.Submit(ASYNC_COMPUTE_WORK_GRAPHICS, &submitInfo));
 
     PPX_CHECKED_CALL(GetSwapchain()->Present(swapchainImageIndex, 1, &frame.renderCompleteSemaphore));
 }
@@ -949,6 +1005,53 @@ void ProjApp::DrawGui()
 
     ImGui::SliderInt("Graphics Load", &mGraphicsLoad, 1, 500);
     ImGui::SliderInt("Compute Load", &mComputeLoad, 1, 20);
+
+    ImGui::Separator();
+
+    if (!mScheduler.IsAvailable()) {
+        ImGui::Text("No compute queue, async compute is unavailable");
+    }
+    if (mScheduler.HasStats()) {
+        const AsyncComputeStats& stats = mScheduler.GetStats();
+
+        ImGui::Columns(2);
+        ImGui::Text("Compute Queue");
+        ImGui::NextColumn();
+        ImGui::Text("%s", stats.asyncCompute ? "Compute" : "Graphics");
+        ImGui::NextColumn();
+        ImGui::Text("Graphics Busy");
+        ImGui::NextColumn();
+        ImGui::Text("%.3f ms", stats.graphicsBusyMs);
+        ImGui::NextColumn();
+        ImGui::Text("Compute Busy");
+        ImGui::NextColumn();
+        ImGui::Text("%.3f ms", stats.computeBusyMs);
+        ImGui::NextColumn();
+        ImGui::Text("Overlap");
+        ImGui::NextColumn();
+        ImGui::Text("%.3f ms", stats.overlapMs);
+        ImGui::NextColumn();
+        ImGui::Text("Overlap Ratio");
+        ImGui::NextColumn();
+        ImGui::Text("%.2f", stats.overlapRatio);
+        ImGui::NextColumn();
+        ImGui::Text("GPU Frame Time");
+        ImGui::NextColumn();
+        ImGui::Text("%.3f ms", stats.frameMs);
+        ImGui::NextColumn();
+        ImGui::Columns(1);
+    }
+}
+
+void ProjApp::SetupMetrics()
+{
+    Application::SetupMetrics();
+    mScheduler.AddMetrics(this);
+}
+
+void ProjApp::UpdateMetrics()
+{
+    mScheduler.RecordMetrics(this, GetElapsedSeconds());
 }
 
 SETUP_APPLICATION(ProjApp)
@@ -33,6 +33,9 @@ public:
 protected:
     virtual void DrawGui() override;
 
+private:
+    void RunMipLoadTest(uint32_t textureCount);
+
 private:
     struct PerFrame
     {
@@ -68,6 +71,15 @@ private:
         "Bilinear",
         "Other",
     };
+
+    // Results of --mip-load-test
+    struct
+    {
+        uint32_t textureCount = 0;
+        bool     gpuAvailable = false;
+        double   cpuMs        = 0;
+        double   gpuMs        = 0;
+    } mLoadTest;
 };
 
 void ProjApp::Config(ppx::ApplicationSettings& settings)
@@ -247,6 +259,49 @@ void ProjApp::Setup()
         memcpy(pAddr, vertexData.data(), dataSize);
         mVertexBuffer->UnmapMemory();
     }
+
+    const auto& clOptions = GetExtraOptions();
+    if (clOptions.HasExtraOption("mip-load-test")) {
+        RunMipLoadTest(std::max<uint32_t>(clOptions.GetExtraOptionValueOrDefault<uint32_t>("mip-load-test", 100), 1));
+    }
+}
+
+void ProjApp::RunMipLoadTest(uint32_t textureCount)
+{
+    Bitmap bitmap;
+    PPX_CHECKED_CALL(Bitmap::LoadFile(GetAssetPath("basic/textures/hanging_lights.jpg"), &bitmap));
+    std::vector<const Bitmap*> bitmaps(textureCount, &bitmap);
+
+    // Full mip chains, built on the CPU and uploaded level by level vs.
+    // level 0 uploads and one batched compute submit for all textures.
+    auto loadTextures = [&](bool gpuMips) -> double {
+        const auto options = grfx_util::TextureOptions().MipLevelCount(PPX_REMAINING_MIP_LEVELS).GpuMips(gpuMips);
+
+        Timer timer;
+        timer.Start();
+        std::vector<grfx::TexturePtr> textures;
+        PPX_CHECKED_CALL(grfx_util::CreateTexturesFromBitmaps(GetGraphicsQueue(), bitmaps, &textures, options));
+        const double elapsedMs = timer.MillisSinceStart();
+
+        for (auto& texture : textures) {
+            GetDevice()->DestroyTexture(texture);
+        }
+        return elapsedMs;
+    };
+
+    mLoadTest.textureCount = textureCount;
+    mLoadTest.gpuAvailable = !IsNull(GetMipGenerator());
+    mLoadTest.cpuMs        = loadTextures(false);
+    mLoadTest.gpuMs        = loadTextures(true);
+
+    PPX_LOG_INFO("Mip load test: " << textureCount << " textures of " << bitmap.GetWidth() << "x" << bitmap.GetHeight());
+    PPX_LOG_INFO("   CPU mips: " << mLoadTest.cpuMs << " ms");
+    if (mLoadTest.gpuAvailable) {
+        PPX_LOG_INFO("   GPU mips: " << mLoadTest.gpuMs << " ms");
+    }
+    else {
+        PPX_LOG_WARN("   GPU mips: unavailable, GenerateMips shader was not found");
+    }
 }
 
 void ProjApp::Render()
@@ -377,6 +432,18 @@ void ProjApp::DrawGui()
         }
         ImGui::EndCombo();
     }
+
+    if (mLoadTest.textureCount > 0) {
+        ImGui::Separator();
+        ImGui::Text("Load test (%u textures)", mLoadTest.textureCount);
+        ImGui::Text("CPU mips: %.1f ms", mLoadTest.cpuMs);
+        if (mLoadTest.gpuAvailable) {
+            ImGui::Text("GPU mips: %.1f ms", mLoadTest.gpuMs);
+        }
+        else {
+            ImGui::Text("GPU mips: unavailable");
+        }
+    }
 }
 
 SETUP_APPLICATION(ProjApp)
@@ -0,0 +1,551 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ppx/ppx.h"
+#include "ppx/virtual_texture.h"
+using namespace ppx;
+
+#if defined(USE_DX12)
+const grfx::Api kApi = grfx::API_DX_12_0;
+#elif defined(USE_VK)
+const grfx::Api kApi = grfx::API_VK_1_1;
+#endif
+
+// Size of the procedural texture, far more than would fit in the atlas
+constexpr uint32_t kVirtualTextureSize = 16384;
+constexpr uint32_t kTileSize           = 128;
+constexpr float    kPlaneSize          = 200.0f;
+
+//! Generates tiles on the fly: a grid with coordinates encoded in color and a
+//! different tint per level, which makes the resident level of each area of
+//! the screen easy to see.
+class ProceduralTileSource
+    : public VirtualTextureTileSource
+{
+public:
+    ProceduralTileSource(uint32_t size)
+        : mSize(size) {}
+
+    virtual Result ReadTile(const VirtualTextureTile& tile, uint32_t tileSize, uint32_t border, uint8_t* pTexels) override
+    {
+        static const uint8_t kLevelTints[][3] = {
+            {255, 255, 255},
+            {255, 200, 200},
+            {200, 255, 200},
+            {200, 200, 255},
+            {255, 255, 180},
+            {255, 180, 255},
+            {180, 255, 255},
+            {230, 230, 230},
+        };
+        const uint8_t* tint = kLevelTints[tile.level % 8];
+
+        const int32_t  maxCoord  = static_cast<int32_t>(std::max<uint32_t>(mSize >> tile.level, 1)) - 1;
+        const int32_t  originX   = static_cast<int32_t>(tile.x * tileSize) - static_cast<int32_t>(border);
+        const int32_t  originY   = static_cast<int32_t>(tile.y * tileSize) - static_cast<int32_t>(border);
+        const uint32_t texelSize = tileSize + 2 * border;
+
+        for (uint32_t row = 0; row < texelSize; ++row) {
+            // Level 0 coordinates so every level shows the same pattern
+            const uint32_t y = static_cast<uint32_t>(std::clamp(originY + static_cast<int32_t>(row), 0, maxCoord)) << tile.level;
+            for (uint32_t col = 0; col < texelSize; ++col) {
+                const uint32_t x = static_cast<uint32_t>(std::clamp(originX + static_cast<int32_t>(col), 0, maxCoord)) << tile.level;
+
+                const bool     line    = ((x % 512) < (4u << tile.level)) || ((y % 512) < (4u << tile.level));
+                const bool     checker = (((x / 2048) + (y / 2048)) % 2) == 0;
+                const uint8_t  r       = static_cast<uint8_t>((x * 255) / mSize);
+                const uint8_t  g       = static_cast<uint8_t>((y * 255) / mSize);
+                const uint8_t  b       = checker ? 160 : 64;
+                uint8_t*       pTexel  = pTexels + (row * texelSize + col) * 4;
+
+                pTexel[0] = line ? 0 : static_cast<uint8_t>((r * tint[0]) / 255);
+                pTexel[1] = line ? 0 : static_cast<uint8_t>((g * tint[1]) / 255);
+                pTexel[2] = line ? 0 : static_cast<uint8_t>((b * tint[2]) / 255);
+                pTexel[3] = 255;
+            }
+        }
+
+        return ppx::SUCCESS;
+    }
+
+private:
+    uint32_t mSize = 0;
+};
+
+class ProjApp
+    : public ppx::Application
+{
+public:
+    virtual void Config(ppx::ApplicationSettings& settings) override;
+    virtual void Setup() override;
+    virtual void Shutdown() override;
+    virtual void Render() override;
+
+protected:
+    virtual void SetupMetrics() override;
+    virtual void UpdateMetrics() override;
+    virtual void DrawGui() override;
+
+private:
+    Result SetupImageSource(const std::string& path);
+
+private:
+    struct PerFrame
+    {
+        ppx::grfx::CommandBufferPtr cmd;
+        ppx::grfx::SemaphorePtr     imageAcquiredSemaphore;
+        ppx::grfx::FencePtr         imageAcquiredFence;
+        ppx::grfx::SemaphorePtr     renderCompleteSemaphore;
+        ppx::grfx::FencePtr         renderCompleteFence;
+    };
+
+    struct alignas(16) SceneData
+    {
+        float4x4                   MVP;
+        VirtualTextureShaderParams VT;
+    };
+
+    std::vector<PerFrame>                     mPerFrame;
+    ppx::grfx::ShaderModulePtr                mVS;
+    ppx::grfx::ShaderModulePtr                mPS;
+    ppx::grfx::ShaderModulePtr                mFeedbackVS;
+    ppx::grfx::ShaderModulePtr                mFeedbackPS;
+    ppx::grfx::PipelineInterfacePtr           mPipelineInterface;
+    ppx::grfx::GraphicsPipelinePtr            mPipeline;
+    ppx::grfx::GraphicsPipelinePtr            mFeedbackPipeline;
+    ppx::grfx::BufferPtr                      mVertexBuffer;
+    ppx::grfx::DescriptorPoolPtr              mDescriptorPool;
+    ppx::grfx::DescriptorSetLayoutPtr         mDescriptorSetLayout;
+    ppx::grfx::DescriptorSetPtr               mDescriptorSet;
+    ppx::grfx::BufferPtr                      mUniformBuffer;
+    ppx::grfx::SamplerPtr                     mSampler;
+    grfx::VertexBinding                       mVertexBinding;
+    std::unique_ptr<Mipmap>                   mMipmap;
+    std::unique_ptr<VirtualTextureTileSource> mTileSource;
+    VirtualTexture                            mVirtualTexture;
+    uint32_t                                  mVirtualTextureSize = kVirtualTextureSize;
+    float                                     mCameraTime         = 0;
+    float                                     mCameraHeight       = 4.0f;
+    bool                                      mPauseCamera        = false;
+
+    struct
+    {
+        metrics::MetricID pageHitRate   = metrics::kInvalidMetricID;
+        metrics::MetricID cacheHitRate  = metrics::kInvalidMetricID;
+        metrics::MetricID uploadedBytes = metrics::kInvalidMetricID;
+    } mMetrics;
+};
+
+void ProjApp::Config(ppx::ApplicationSettings& settings)
+{
+    settings.appName                    = "29_virtual_texture";
+    settings.enableImGui                = true;
+    settings.grfx.api                   = kApi;
+    settings.grfx.swapchain.depthFormat = grfx::FORMAT_D32_FLOAT;
+    settings.grfx.enableDebug           = false;
+}
+
+Result ProjApp::SetupImageSource(const std::string& path)
+{
+    Bitmap bitmap;
+    Result ppxres = Bitmap::LoadFile(path, &bitmap);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    const uint32_t width     = bitmap.GetWidth();
+    const uint32_t height    = bitmap.GetHeight();
+    const uint32_t pageCount = width / kTileSize;
+    if ((width != height) || ((width % kTileSize) != 0) || (pageCount == 0) || ((pageCount & (pageCount - 1)) != 0)) {
+        PPX_LOG_ERROR("Virtual texture image must be square with a power of two multiple of " << kTileSize << " texels per side: " << path);
+        return ppx::ERROR_IMAGE_INVALID_FORMAT;
+    }
+
+    mMipmap = std::make_unique<Mipmap>(std::move(bitmap), Mipmap::CalculateLevelCount(width, height));
+    if (!mMipmap->IsOk()) {
+        return ppx::ERROR_FAILED;
+    }
+
+    mTileSource         = std::make_unique<MipmapTileSource>(mMipmap.get());
+    mVirtualTextureSize = width;
+    return ppx::SUCCESS;
+}
+
+void ProjApp::Setup()
+{
+    // Tile source: an image loaded into memory if one is given, otherwise a
+    // procedural texture generated tile by tile.
+    const auto& clOptions = GetExtraOptions();
+    if (clOptions.HasExtraOption("vt-image")) {
+        const std::string path = clOptions.GetExtraOptionValueOrDefault<std::string>("vt-image", "");
+        if (Failed(SetupImageSource(path))) {
+            PPX_LOG_WARN("Falling back to the procedural virtual texture");
+        }
+    }
+    if (!mTileSource) {
+        mTileSource = std::make_unique<ProceduralTileSource>(kVirtualTextureSize);
+    }
+
+    // Virtual texture
+    {
+        VirtualTextureCreateInfo ci = {};
+        ci.width                    = mVirtualTextureSize;
+        ci.height                   = mVirtualTextureSize;
+        ci.tileSize                 = kTileSize;
+        ci.renderWidth              = GetWindowWidth();
+        ci.renderHeight             = GetWindowHeight();
+        ci.frameCount               = 1;
+        ci.pSource                  = mTileSource.get();
+        PPX_CHECKED_CALL(mVirtualTexture.Initialize(GetDevice(), ci));
+    }
+
+    // Uniform buffer
+    {
+        grfx::BufferCreateInfo bufferCreateInfo        = {};
+        bufferCreateInfo.size                          = PPX_MINIMUM_UNIFORM_BUFFER_SIZE;
+        bufferCreateInfo.usageFlags.bits.uniformBuffer = true;
+        bufferCreateInfo.memoryUsage                   = grfx::MEMORY_USAGE_CPU_TO_GPU;
+
+        PPX_CHECKED_CALL(GetDevice()->CreateBuffer(&bufferCreateInfo, &mUniformBuffer));
+    }
+
+    // Atlas sampler, tiles have a border so filtering stays inside a tile
+    {
+        grfx::SamplerCreateInfo samplerCreateInfo = {};
+        samplerCreateInfo.magFilter               = grfx::FILTER_LINEAR;
+        samplerCreateInfo.minFilter               = grfx::FILTER_LINEAR;
+        samplerCreateInfo.mipmapMode              = grfx::SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerCreateInfo.addressModeU            = grfx::SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerCreateInfo.addressModeV            = grfx::SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerCreateInfo.addressModeW            = grfx::SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        PPX_CHECKED_CALL(GetDevice()->CreateSampler(&samplerCreateInfo, &mSampler));
+    }
+
+    // Descriptor, shared by the feedback and the main pipeline
+    {
+        grfx::DescriptorPoolCreateInfo poolCreateInfo = {};
+        poolCreateInfo.uniformBuffer                  = 1;
+        poolCreateInfo.sampledImage                   = 2;
+        poolCreateInfo.sampler                        = 1;
+        PPX_CHECKED_CALL(GetDevice()->CreateDescriptorPool(&poolCreateInfo, &mDescriptorPool));
+
+        grfx::DescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding(0, grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER));
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding(1, grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE));
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding(2, grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE));
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding(3, grfx::DESCRIPTOR_TYPE_SAMPLER));
+        PPX_CHECKED_CALL(GetDevice()->CreateDescriptorSetLayout(&layoutCreateInfo, &mDescriptorSetLayout));
+
+        PPX_CHECKED_CALL(GetDevice()->AllocateDescriptorSet(mDescriptorPool, mDescriptorSetLayout, &mDescriptorSet));
+
+        grfx::WriteDescriptor write = {};
+        write.binding               = 0;
+        write.type                  = grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        write.bufferOffset          = 0;
+        write.bufferRange           = PPX_WHOLE_SIZE;
+        write.pBuffer               = mUniformBuffer;
+        PPX_CHECKED_CALL(mDescriptorSet->UpdateDescriptors(1, &write));
+
+        write            = {};
+        write.binding    = 1;
+        write.type       = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        write.pImageView = mVirtualTexture.GetPageTableView();
+        PPX_CHECKED_CALL(mDescriptorSet->UpdateDescriptors(1, &write));
+
+        write            = {};
+        write.binding    = 2;
+        write.type       = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        write.pImageView = mVirtualTexture.GetAtlasView();
+        PPX_CHECKED_CALL(mDescriptorSet->UpdateDescriptors(1, &write));
+
+        write          = {};
+        write.binding  = 3;
+        write.type     = grfx::DESCRIPTOR_TYPE_SAMPLER;
+        write.pSampler = mSampler;
+        PPX_CHECKED_CALL(mDescriptorSet->UpdateDescriptors(1, &write));
+    }
+
+    // Pipelines
+    {
+        std::vector<char> bytecode = LoadShader("basic/shaders", "VirtualTexture.vs");
+        PPX_ASSERT_MSG(!bytecode.empty(), "VS shader bytecode load failed");
+        grfx::ShaderModuleCreateInfo shaderCreateInfo = {static_cast<uint32_t>(bytecode.size()), bytecode.data()};
+        PPX_CHECKED_CALL(GetDevice()->CreateShaderModule(&shaderCreateInfo, &mVS));
+
+        bytecode = LoadShader("basic/shaders", "VirtualTexture.ps");
+        PPX_ASSERT_MSG(!bytecode.empty(), "PS shader bytecode load failed");
+        shaderCreateInfo = {static_cast<uint32_t>(bytecode.size()), bytecode.data()};
+        PPX_CHECKED_CALL(GetDevice()->CreateShaderModule(&shaderCreateInfo, &mPS));
+
+        bytecode = LoadShader("basic/shaders", "VirtualTextureFeedback.vs");
+        PPX_ASSERT_MSG(!bytecode.empty(), "VS shader bytecode load failed");
+        shaderCreateInfo = {static_cast<uint32_t>(bytecode.size()), bytecode.data()};
+        PPX_CHECKED_CALL(GetDevice()->CreateShaderModule(&shaderCreateInfo, &mFeedbackVS));
+
+        bytecode = LoadShader("basic/shaders", "VirtualTextureFeedback.ps");
+        PPX_ASSERT_MSG(!bytecode.empty(), "PS shader bytecode load failed");
+        shaderCreateInfo = {static_cast<uint32_t>(bytecode.size()), bytecode.data()};
+        PPX_CHECKED_CALL(GetDevice()->CreateShaderModule(&shaderCreateInfo, &mFeedbackPS));
+
+        grfx::PipelineInterfaceCreateInfo piCreateInfo = {};
+        piCreateInfo.setCount                          = 1;
+        piCreateInfo.sets[0].set                       = 0;
+        piCreateInfo.sets[0].pLayout                   = mDescriptorSetLayout;
+        PPX_CHECKED_CALL(GetDevice()->CreatePipelineInterface(&piCreateInfo, &mPipelineInterface));
+
+        mVertexBinding.AppendAttribute({"POSITION", 0, grfx::FORMAT_R32G32B32_FLOAT, 0, PPX_APPEND_OFFSET_ALIGNED, grfx::VERTEX_INPUT_RATE_VERTEX});
+        mVertexBinding.AppendAttribute({"TEXCOORD", 1, grfx::FORMAT_R32G32_FLOAT, 0, PPX_APPEND_OFFSET_ALIGNED, grfx::VERTEX_INPUT_RATE_VERTEX});
+
+        grfx::GraphicsPipelineCreateInfo2 gpCreateInfo  = {};
+        gpCreateInfo.VS                                 = {mVS.Get(), "vsmain"};
+        gpCreateInfo.PS                                 = {mPS.Get(), "psmain"};
+        gpCreateInfo.vertexInputState.bindingCount      = 1;
+        gpCreateInfo.vertexInputState.bindings[0]       = mVertexBinding;
+        gpCreateInfo.topology                           = grfx::PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        gpCreateInfo.polygonMode                        = grfx::POLYGON_MODE_FILL;
+        gpCreateInfo.cullMode                           = grfx::CULL_MODE_NONE;
+        gpCreateInfo.frontFace                          = grfx::FRONT_FACE_CCW;
+        gpCreateInfo.depthReadEnable                    = true;
+        gpCreateInfo.depthWriteEnable                   = true;
+        gpCreateInfo.blendModes[0]                      = grfx::BLEND_MODE_NONE;
+        gpCreateInfo.outputState.renderTargetCount      = 1;
+        gpCreateInfo.outputState.renderTargetFormats[0] = GetSwapchain()->GetColorFormat();
+        gpCreateInfo.outputState.depthStencilFormat     = GetSwapchain()->GetDepthFormat();
+        gpCreateInfo.pPipelineInterface                 = mPipelineInterface;
+        PPX_CHECKED_CALL(GetDevice()->CreateGraphicsPipeline(&gpCreateInfo, &mPipeline));
+
+        grfx::DrawPassPtr feedbackPass                  = mVirtualTexture.GetFeedbackDrawPass();
+        gpCreateInfo.VS                                 = {mFeedbackVS.Get(), "vsmain"};
+        gpCreateInfo.PS                                 = {mFeedbackPS.Get(), "psmain"};
+        gpCreateInfo.outputState.renderTargetFormats[0] = feedbackPass->GetRenderTargetTexture(0)->GetImageFormat();
+        gpCreateInfo.outputState.depthStencilFormat     = feedbackPass->GetDepthStencilTexture()->GetImageFormat();
+        PPX_CHECKED_CALL(GetDevice()->CreateGraphicsPipeline(&gpCreateInfo, &mFeedbackPipeline));
+    }
+
+    // Per frame data
+    {
+        PerFrame frame = {};
+
+        PPX_CHECKED_CALL(GetGraphicsQueue()->CreateCommandBuffer(&frame.cmd));
+
+        grfx::SemaphoreCreateInfo semaCreateInfo = {};
+        PPX_CHECKED_CALL(GetDevice()->CreateSemaphore(&semaCreateInfo, &frame.imageAcquiredSemaphore));
+
+        grfx::FenceCreateInfo fenceCreateInfo = {};
+        PPX_CHECKED_CALL(GetDevice()->CreateFence(&fenceCreateInfo, &frame.imageAcquiredFence));
+
+        PPX_CHECKED_CALL(GetDevice()->CreateSemaphore(&semaCreateInfo, &frame.renderCompleteSemaphore));
+
+        fenceCreateInfo = {true}; // Create signaled
+        PPX_CHECKED_CALL(GetDevice()->CreateFence(&fenceCreateInfo, &frame.renderCompleteFence));
+
+        mPerFrame.push_back(frame);
+    }
+
+    // Ground plane
+    {
+        const float s = kPlaneSize;
+        // clang-format off
+        std::vector<float> vertexData = {
+            -s, 0.0f, -s,   0.0f, 0.0f,
+            -s, 0.0f,  s,   0.0f, 1.0f,
+             s, 0.0f, -s,   1.0f, 0.0f,
+            -s, 0.0f,  s,   0.0f, 1.0f,
+             s, 0.0f,  s,   1.0f, 1.0f,
+             s, 0.0f, -s,   1.0f, 0.0f,
+        };
+        // clang-format on
+        uint32_t dataSize = ppx::SizeInBytesU32(vertexData);
+
+        grfx::BufferCreateInfo bufferCreateInfo       = {};
+        bufferCreateInfo.size                         = dataSize;
+        bufferCreateInfo.usageFlags.bits.vertexBuffer = true;
+        bufferCreateInfo.memoryUsage                  = grfx::MEMORY_USAGE_CPU_TO_GPU;
+
+        PPX_CHECKED_CALL(GetDevice()->CreateBuffer(&bufferCreateInfo, &mVertexBuffer));
+
+        void* pAddr = nullptr;
+        PPX_CHECKED_CALL(mVertexBuffer->MapMemory(0, &pAddr));
+        memcpy(pAddr, vertexData.data(), dataSize);
+        mVertexBuffer->UnmapMemory();
+    }
+}
+
+void ProjApp::Shutdown()
+{
+    // Stops the loader thread, which reads from mTileSource
+    mVirtualTexture.Shutdown();
+}
+
+void ProjApp::SetupMetrics()
+{
+    Application::SetupMetrics();
+    if (!HasActiveMetricsRun()) {
+        return;
+    }
+
+    ppx::metrics::MetricMetadata metadata = {ppx::metrics::MetricType::GAUGE, "VT Page Hit Rate", "%", ppx::metrics::MetricInterpretation::HIGHER_IS_BETTER, {0.f, 100.f}};
+    mMetrics.pageHitRate                  = AddMetric(metadata);
+    PPX_ASSERT_MSG(mMetrics.pageHitRate != ppx::metrics::kInvalidMetricID, "Failed to add VT Page Hit Rate metric");
+
+    metadata              = {ppx::metrics::MetricType::GAUGE, "VT Tile Cache Hit Rate", "%", ppx::metrics::MetricInterpretation::HIGHER_IS_BETTER, {0.f, 100.f}};
+    mMetrics.cacheHitRate = AddMetric(metadata);
+    PPX_ASSERT_MSG(mMetrics.cacheHitRate != ppx::metrics::kInvalidMetricID, "Failed to add VT Tile Cache Hit Rate metric");
+
+    metadata               = {ppx::metrics::MetricType::GAUGE, "VT Upload Bytes", "bytes", ppx::metrics::MetricInterpretation::LOWER_IS_BETTER, {0.f, 1000000000.f}};
+    mMetrics.uploadedBytes = AddMetric(metadata);
+    PPX_ASSERT_MSG(mMetrics.uploadedBytes != ppx::metrics::kInvalidMetricID, "Failed to add VT Upload Bytes metric");
+}
+
+void ProjApp::UpdateMetrics()
+{
+    if (!HasActiveMetricsRun()) {
+        return;
+    }
+
+    const VirtualTextureStats& stats = mVirtualTexture.GetStats();
+
+    ppx::metrics::MetricData data = {ppx::metrics::MetricType::GAUGE};
+    data.gauge.seconds            = GetElapsedSeconds();
+
+    data.gauge.value = 100.0 * stats.GetPageHitRate();
+    RecordMetricData(mMetrics.pageHitRate, data);
+    data.gauge.value = 100.0 * stats.GetCacheHitRate();
+    RecordMetricData(mMetrics.cacheHitRate, data);
+    data.gauge.value = static_cast<double>(stats.uploadedBytes);
+    RecordMetricData(mMetrics.uploadedBytes, data);
+}
+
+void ProjApp::Render()
+{
+    PerFrame& frame = mPerFrame[0];
+
+    grfx::SwapchainPtr swapchain = GetSwapchain();
+
+    uint32_t imageIndex = UINT32_MAX;
+    PPX_CHECKED_CALL(swapchain->AcquireNextImage(UINT64_MAX, frame.imageAcquiredSemaphore, frame.imageAcquiredFence, &imageIndex));
+
+    // Wait for and reset image acquired fence
+    PPX_CHECKED_CALL(frame.imageAcquiredFence->WaitAndReset());
+
+    // Wait for and reset render complete fence
+    PPX_CHECKED_CALL(frame.renderCompleteFence->WaitAndReset());
+
+    // The previous frame is done: consume its feedback and stage new tiles
+    PPX_CHECKED_CALL(mVirtualTexture.Update(0));
+
+    // Fly low over the plane so that the view spans many levels
+    if (!mPauseCamera) {
+        mCameraTime += GetPrevFrameTime() / 1000.0f;
+    }
+    {
+        const float t      = mCameraTime * 0.05f;
+        const float radius = 0.6f * kPlaneSize;
+        float3      eye    = float3(radius * cos(t), mCameraHeight, radius * sin(2.0f * t) * 0.5f);
+        float3      target = float3(radius * cos(t + 0.1f), 0.0f, radius * sin(2.0f * (t + 0.1f)) * 0.5f);
+
+        float4x4 P = glm::perspective(glm::radians(60.0f), GetWindowAspect(), 0.1f, 2.0f * kPlaneSize);
+        float4x4 V = glm::lookAt(eye, target, float3(0, 1, 0));
+
+        SceneData scene = {};
+        scene.MVP       = P * V;
+        scene.VT        = mVirtualTexture.GetShaderParams();
+
+        void* pData = nullptr;
+        PPX_CHECKED_CALL(mUniformBuffer->MapMemory(0, &pData));
+        memcpy(pData, &scene, sizeof(SceneData));
+        mUniformBuffer->UnmapMemory();
+    }
+
+    // Build command buffer
+    PPX_CHECKED_CALL(frame.cmd->Begin());
+    {
+        mVirtualTexture.RecordUploads(frame.cmd, 0);
+
+        // Feedback pass at reduced resolution
+        grfx::DrawPassPtr feedbackPass = mVirtualTexture.GetFeedbackDrawPass();
+        frame.cmd->BeginRenderPass(feedbackPass, grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_ALL);
+        {
+            frame.cmd->SetScissors(feedbackPass->GetScissor());
+            frame.cmd->SetViewports(feedbackPass->GetViewport());
+            frame.cmd->BindGraphicsPipeline(mFeedbackPipeline);
+            frame.cmd->BindGraphicsDescriptorSets(mPipelineInterface, 1, &mDescriptorSet);
+            frame.cmd->BindVertexBuffers(1, &mVertexBuffer, &mVertexBinding.GetStride());
+            frame.cmd->Draw(6, 1, 0, 0);
+        }
+        frame.cmd->EndRenderPass();
+        mVirtualTexture.RecordFeedbackReadback(frame.cmd, 0);
+
+        grfx::RenderPassPtr renderPass = swapchain->GetRenderPass(imageIndex);
+        PPX_ASSERT_MSG(!renderPass.IsNull(), "render pass object is null");
+
+        grfx::RenderPassBeginInfo beginInfo = {};
+        beginInfo.pRenderPass               = renderPass;
+        beginInfo.renderArea                = renderPass->GetRenderArea();
+        beginInfo.RTVClearCount             = 1;
+        beginInfo.RTVClearValues[0]         = {{0.4f, 0.5f, 0.6f, 0}};
+        beginInfo.DSVClearValue             = {1.0f, 0xFF};
+
+        frame.cmd->TransitionImageLayout(renderPass->GetRenderTargetImage(0), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_PRESENT, grfx::RESOURCE_STATE_RENDER_TARGET);
+        frame.cmd->BeginRenderPass(&beginInfo);
+        {
+            frame.cmd->SetScissors(GetScissor());
+            frame.cmd->SetViewports(GetViewport());
+            frame.cmd->BindGraphicsPipeline(mPipeline);
+            frame.cmd->BindGraphicsDescriptorSets(mPipelineInterface, 1, &mDescriptorSet);
+            frame.cmd->BindVertexBuffers(1, &mVertexBuffer, &mVertexBinding.GetStride());
+            frame.cmd->Draw(6, 1, 0, 0);
+
+            // Draw ImGui
+            DrawDebugInfo();
+            DrawImGui(frame.cmd);
+        }
+        frame.cmd->EndRenderPass();
+        frame.cmd->TransitionImageLayout(renderPass->GetRenderTargetImage(0), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_PRESENT);
+    }
+    PPX_CHECKED_CALL(frame.cmd->End());
+
+    grfx::SubmitInfo submitInfo     = {};
+    submitInfo.commandBufferCount   = 1;
+    submitInfo.ppCommandBuffers     = &frame.cmd;
+    submitInfo.waitSemaphoreCount   = 1;
+    submitInfo.ppWaitSemaphores     = &frame.imageAcquiredSemaphore;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.ppSignalSemaphores   = &frame.renderCompleteSemaphore;
+    submitInfo.pFence               = frame.renderCompleteFence;
+
+    PPX_CHECKED_CALL(GetGraphicsQueue()->Submit(&submitInfo));
+
+    PPX_CHECKED_CALL(swapchain->Present(imageIndex, 1, &frame.renderCompleteSemaphore));
+}
+
+void ProjApp::DrawGui()
+{
+    const VirtualTextureStats& stats = mVirtualTexture.GetStats();
+
+    ImGui::Separator();
+    ImGui::Text("Virtual size      : %u x %u", mVirtualTextureSize, mVirtualTextureSize);
+    ImGui::Text("Requested tiles   : %u", stats.requestedTiles);
+    ImGui::Text("Page hit rate     : %.1f%%", 100.0f * stats.GetPageHitRate());
+    ImGui::Text("Tile cache hits   : %u / %u", stats.cacheHits, stats.cacheHits + stats.cacheMisses);
+    ImGui::Text("Uploaded          : %u tiles, %llu bytes", stats.uploadedTiles, static_cast<unsigned long long>(stats.uploadedBytes));
+    ImGui::Text("Resident tiles    : %u", stats.residentTiles);
+    ImGui::Text("Pending loads     : %u", stats.pendingLoads);
+
+    ImGui::Separator();
+    ImGui::Checkbox("Pause camera", &mPauseCamera);
+    ImGui::SliderFloat("Camera height", &mCameraHeight, 0.5f, 50.0f);
+}
+
+SETUP_APPLICATION(ProjApp)
@@ -37,5 +37,16 @@
 // u#
 #define RENDER_OUTPUT_POSITION_TEXTURE_REGISTER 16
 #define RENDER_OUTPUT_VELOCITY_TEXTURE_REGISTER 17
+// push constants
+#define RENDER_FLOCKING_DRAW_DATA_REGISTER 26
+// Flocking grid, bound as t# or u# depending on the pass
+#define FLOCKING_GRID_FISH_CELLS_REGISTER    18
+#define FLOCKING_GRID_CELL_COUNTS_REGISTER   19
+#define FLOCKING_GRID_SCAN_INPUT_REGISTER    20
+#define FLOCKING_GRID_SCAN_OUTPUT_REGISTER   21
+#define FLOCKING_GRID_SCAN_SUMS_REGISTER     22
+#define FLOCKING_GRID_CELL_STARTS_REGISTER   23
+#define FLOCKING_GRID_BLOCK_OFFSETS_REGISTER 24
+#define FLOCKING_GRID_SORTED_FISH_REGISTER   25
 
 #endif //CONFIG_H
@@ -0,0 +1,457 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CpuFlocking.h"
+
+#include "ppx/job_system.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define FISHTORNADO_SSE2
+#include <emmintrin.h>
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(__aarch64__)
+#define FISHTORNADO_NEON
+#include <arm_neon.h>
+#endif
+
+// Fish handed to each job
+static const uint32_t kFishPerJob = 256;
+
+// The hash table has about one bucket per fish, like the GPU grid
+static const uint32_t kMinCellCount = 1024;
+static const uint32_t kMaxCellCount = 1024 * 1024;
+
+static int32_t GridCoord(float value, float zoneRadius)
+{
+    return static_cast<int32_t>(std::floor(value / zoneRadius));
+}
+
+// Same as GridHash() in Flocking.hlsli
+static uint32_t GridHash(int32_t x, int32_t y, int32_t z, uint32_t cellCount)
+{
+    uint32_t hash = (static_cast<uint32_t>(x) * 73856093u) ^ (static_cast<uint32_t>(y) * 19349663u) ^ (static_cast<uint32_t>(z) * 83492791u);
+    return hash & (cellCount - 1);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Neighbor filtering
+// -------------------------------------------------------------------------------------------------
+
+// Sorted fish, see CpuFlocking
+struct Candidates
+{
+    const float*   posX;
+    const float*   posY;
+    const float*   posZ;
+    const int32_t* cellX;
+    const int32_t* cellY;
+    const int32_t* cellZ;
+    const int32_t* column;
+    const int32_t* row;
+};
+
+// Fish whose neighbors are searched and the cell being visited
+struct NeighborQuery
+{
+    float   x;
+    float   y;
+    float   z;
+    int32_t cellX;
+    int32_t cellY;
+    int32_t cellZ;
+    int32_t column;
+    int32_t row;
+    float   zoneRadSqrd;
+};
+
+// A candidate is a neighbor if it is in the visited cell, which skips fish of
+// other cells sharing the hash, and within the zone. Like FlockingVelocity.hlsl,
+// fish in the same row or column of the texture are skipped.
+static bool FilterCandidate(const Candidates& c, uint32_t j, const NeighborQuery& q, float* pDistSqrd)
+{
+    const float dx = q.x - c.posX[j];
+    const float dy = q.y - c.posY[j];
+    const float dz = q.z - c.posZ[j];
+    *pDistSqrd     = dx * dx + dy * dy + dz * dz;
+
+    const bool sameCell = (c.cellX[j] == q.cellX) && (c.cellY[j] == q.cellY) && (c.cellZ[j] == q.cellZ);
+    return sameCell && (c.column[j] != q.column) && (c.row[j] != q.row) && (*pDistSqrd < q.zoneRadSqrd);
+}
+
+// FilterCandidate() for candidates j to j + 3, bit i of the result is set if
+// candidate j + i is a neighbor.
+static uint32_t FilterCandidates4(const Candidates& c, uint32_t j, const NeighborQuery& q, float* pDistSqrd)
+{
+#if defined(FISHTORNADO_SSE2)
+    const __m128 dx = _mm_sub_ps(_mm_set1_ps(q.x), _mm_loadu_ps(c.posX + j));
+    const __m128 dy = _mm_sub_ps(_mm_set1_ps(q.y), _mm_loadu_ps(c.posY + j));
+    const __m128 dz = _mm_sub_ps(_mm_set1_ps(q.z), _mm_loadu_ps(c.posZ + j));
+    const __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+    _mm_storeu_ps(pDistSqrd, d2);
+
+    const auto load = [](const int32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); };
+
+    __m128i sameCell = _mm_cmpeq_epi32(load(c.cellX + j), _mm_set1_epi32(q.cellX));
+    sameCell         = _mm_and_si128(sameCell, _mm_cmpeq_epi32(load(c.cellY + j), _mm_set1_epi32(q.cellY)));
+    sameCell         = _mm_and_si128(sameCell, _mm_cmpeq_epi32(load(c.cellZ + j), _mm_set1_epi32(q.cellZ)));
+
+    const __m128i sameRowOrColumn = _mm_or_si128(
+        _mm_cmpeq_epi32(load(c.column + j), _mm_set1_epi32(q.column)),
+        _mm_cmpeq_epi32(load(c.row + j), _mm_set1_epi32(q.row)));
+
+    __m128 mask = _mm_castsi128_ps(_mm_andnot_si128(sameRowOrColumn, sameCell));
+    mask        = _mm_and_ps(mask, _mm_cmplt_ps(d2, _mm_set1_ps(q.zoneRadSqrd)));
+    return static_cast<uint32_t>(_mm_movemask_ps(mask));
+#elif defined(FISHTORNADO_NEON)
+    const float32x4_t dx = vsubq_f32(vdupq_n_f32(q.x), vld1q_f32(c.posX + j));
+    const float32x4_t dy = vsubq_f32(vdupq_n_f32(q.y), vld1q_f32(c.posY + j));
+    const float32x4_t dz = vsubq_f32(vdupq_n_f32(q.z), vld1q_f32(c.posZ + j));
+    const float32x4_t d2 = vaddq_f32(vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy)), vmulq_f32(dz, dz));
+    vst1q_f32(pDistSqrd, d2);
+
+    uint32x4_t sameCell = vceqq_s32(vld1q_s32(c.cellX + j), vdupq_n_s32(q.cellX));
+    sameCell            = vandq_u32(sameCell, vceqq_s32(vld1q_s32(c.cellY + j), vdupq_n_s32(q.cellY)));
+    sameCell            = vandq_u32(sameCell, vceqq_s32(vld1q_s32(c.cellZ + j), vdupq_n_s32(q.cellZ)));
+
+    const uint32x4_t sameRowOrColumn = vorrq_u32(
+        vceqq_s32(vld1q_s32(c.column + j), vdupq_n_s32(q.column)),
+        vceqq_s32(vld1q_s32(c.row + j), vdupq_n_s32(q.row)));
+
+    uint32x4_t mask = vbicq_u32(sameCell, sameRowOrColumn);
+    mask            = vandq_u32(mask, vcltq_f32(d2, vdupq_n_f32(q.zoneRadSqrd)));
+
+    static const uint32_t kLaneBits[4] = {1, 2, 4, 8};
+    return vaddvq_u32(vandq_u32(mask, vld1q_u32(kLaneBits)));
+#else
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < 4; ++i) {
+        mask |= FilterCandidate(c, j + i, q, &pDistSqrd[i]) ? (1u << i) : 0;
+    }
+    return mask;
+#endif
+}
+
+// -------------------------------------------------------------------------------------------------
+// Forces, see Flocking.hlsli
+// -------------------------------------------------------------------------------------------------
+
+static void AccumulateNeighbor(
+    const CpuFlockingParams& params,
+    const float3&            myPos,
+    float                    accMulti,
+    const float3&            pos,
+    const float3&            velDir,
+    float                    distSqrd,
+    float3&                  acc,
+    float&                   crowded)
+{
+    const float  zoneRadSqrd = params.zoneRadius * params.zoneRadius;
+    const float3 dirNorm     = (myPos - pos) / std::sqrt(distSqrd);
+    const float  percent     = distSqrd / zoneRadSqrd;
+    const float  crowdPer    = 1.0f - percent;
+
+    if (percent < params.minThresh) {
+        float F = (params.minThresh / percent - 1.0f) * accMulti;
+        acc += dirNorm * F;
+        crowded += crowdPer;
+    }
+    else if (percent < params.maxThresh) {
+        float threshDelta     = params.maxThresh - params.minThresh;
+        float adjustedPercent = (percent - params.minThresh) / threshDelta;
+        float F               = (1.0f - (std::cos(adjustedPercent * 6.28318f) * -0.5f + 0.5f)) * accMulti;
+        acc += velDir * F;
+        crowded += crowdPer * 0.5f;
+    }
+    else {
+        float threshDelta     = 1.0f - params.maxThresh;
+        float adjustedPercent = (percent - params.maxThresh) / threshDelta;
+        float F               = (1.0f - (std::cos(adjustedPercent * 6.28318f) * -0.5f + 0.5f)) * accMulti;
+        acc += -dirNorm * F;
+        crowded += crowdPer * 0.25f;
+    }
+}
+
+static float4 FinishVelocity(const CpuFlockingParams& params, const float3& myPos, float3 myVel, float myCrowd, float3 acc, float crowded)
+{
+    acc.y *= 0.960f;
+    acc.y -= 0.005f;
+
+    // Avoid predator
+    float3 dirToPred   = myPos - params.predPos;
+    float  distToPred  = glm::length(dirToPred);
+    float  distPredPer = std::max(1.0f - (distToPred / 200.0f), 0.0f);
+    crowded += distPredPer * 10.0f;
+    acc += (glm::normalize(dirToPred) * float3(1.0f, 0.25f, 1.0f)) * distPredPer * params.timeDelta * 25.0f;
+
+    // Avoid camera
+    float3 dirToCam   = myPos - params.camPos;
+    float  distToCam  = glm::length(dirToCam);
+    float  distCamPer = std::max(1.0f - (distToCam / 60.0f), 0.0f);
+    crowded += distCamPer * 50.0f;
+    acc += (glm::normalize(dirToCam) * float3(1.0f, 0.25f, 1.0f)) * distCamPer * params.timeDelta * 5.0f;
+
+    // Pull to center line
+    float2 centerLine = float2(std::sin(params.time * 0.0002f + myPos.y * 0.01f), std::sin(params.time * 0.0002f - 1.5f + myPos.y * 0.01f)) * 80.0f;
+    myVel.x -= (myPos.x - centerLine.x) * params.timeDelta * 0.0025f;
+    myVel.z -= (myPos.z - centerLine.y) * params.timeDelta * 0.0025f;
+
+    // Pull to center point
+    myVel -= glm::normalize(myPos - float3(0.0f, 150.0f, 0.0f)) * params.timeDelta * 0.1f;
+
+    myVel += acc * params.timeDelta;
+    myCrowd -= (myCrowd - crowded) * params.timeDelta;
+
+    // Set speed limit
+    float  newMaxSpeed = std::clamp(params.maxSpeed + myCrowd * 0.001f, params.minSpeed, 5.0f);
+    float  velLength   = glm::length(myVel);
+    float3 velNorm     = glm::normalize(myVel);
+
+    if (velLength < params.minSpeed) {
+        myVel = velNorm * params.minSpeed;
+    }
+    else if (velLength > newMaxSpeed) {
+        myVel = velNorm * newMaxSpeed;
+    }
+
+    float3 nextPos = myPos + myVel * params.timeDelta;
+
+    // Avoid floor and sky planes
+    if (nextPos.y > 470.0f) {
+        myVel.y -= (myPos.y - 470.0f) * 0.01f;
+    }
+
+    if (nextPos.y < 50.0f) {
+        myVel.y -= (myPos.y - 50.0f) * 0.01f;
+    }
+
+    myVel.y *= 0.999f;
+
+    return float4(myVel, myCrowd);
+}
+
+// -------------------------------------------------------------------------------------------------
+// CpuFlocking
+// -------------------------------------------------------------------------------------------------
+
+void CpuFlocking::Initialize(const Bitmap& position, const Bitmap& velocity, ppx::JobSystem* pJobSystem)
+{
+    PPX_ASSERT_MSG(position.GetFormat() == Bitmap::FORMAT_RGBA_FLOAT, "position must be RGBA_FLOAT");
+    PPX_ASSERT_MSG(velocity.GetFormat() == Bitmap::FORMAT_RGBA_FLOAT, "velocity must be RGBA_FLOAT");
+    PPX_ASSERT_MSG((position.GetWidth() == velocity.GetWidth()) && (position.GetHeight() == velocity.GetHeight()), "position and velocity size mismatch");
+
+    mResX      = position.GetWidth();
+    mResY      = position.GetHeight();
+    mFishCount = mResX * mResY;
+    mJobSystem = pJobSystem;
+
+    mCellCount = kMinCellCount;
+    while ((mCellCount < mFishCount) && (mCellCount < kMaxCellCount)) {
+        mCellCount <<= 1;
+    }
+
+    for (std::vector<float>* pArray : {&mPosX, &mPosY, &mPosZ, &mLeadership, &mVelX, &mVelY, &mVelZ, &mCrowd, &mSortedPosX, &mSortedPosY, &mSortedPosZ, &mSortedVelDirX, &mSortedVelDirY, &mSortedVelDirZ}) {
+        pArray->resize(mFishCount);
+    }
+    for (std::vector<int32_t>* pArray : {&mCellX, &mCellY, &mCellZ, &mSortedCellX, &mSortedCellY, &mSortedCellZ, &mSortedColumn, &mSortedRow}) {
+        pArray->resize(mFishCount);
+    }
+    mCellHash.resize(mFishCount);
+    mCellStarts.resize(mCellCount + 1);
+    mCellCursors.resize(mCellCount);
+
+    for (uint32_t y = 0; y < mResY; ++y) {
+        const float* pPosRow = reinterpret_cast<const float*>(position.GetPixelAddress(0, y));
+        const float* pVelRow = reinterpret_cast<const float*>(velocity.GetPixelAddress(0, y));
+        for (uint32_t x = 0; x < mResX; ++x) {
+            const uint32_t i = y * mResX + x;
+            mPosX[i]         = pPosRow[4 * x + 0];
+            mPosY[i]         = pPosRow[4 * x + 1];
+            mPosZ[i]         = pPosRow[4 * x + 2];
+            mLeadership[i]   = pPosRow[4 * x + 3];
+            mVelX[i]         = pVelRow[4 * x + 0];
+            mVelY[i]         = pVelRow[4 * x + 1];
+            mVelZ[i]         = pVelRow[4 * x + 2];
+            mCrowd[i]        = pVelRow[4 * x + 3];
+        }
+    }
+}
+
+template <typename Fn>
+void CpuFlocking::ForEachRange(const Fn& fn)
+{
+    const uint32_t jobCount = (mFishCount + kFishPerJob - 1) / kFishPerJob;
+    mJobSystem->Run(jobCount, [&](uint32_t jobIndex, uint32_t) {
+        const uint32_t first = jobIndex * kFishPerJob;
+        fn(first, std::min(mFishCount, first + kFishPerJob));
+    });
+}
+
+void CpuFlocking::BuildGrid(float zoneRadius)
+{
+    ForEachRange([&](uint32_t first, uint32_t end) {
+        for (uint32_t i = first; i < end; ++i) {
+            mCellX[i]    = GridCoord(mPosX[i], zoneRadius);
+            mCellY[i]    = GridCoord(mPosY[i], zoneRadius);
+            mCellZ[i]    = GridCoord(mPosZ[i], zoneRadius);
+            mCellHash[i] = GridHash(mCellX[i], mCellY[i], mCellZ[i], mCellCount);
+        }
+    });
+
+    // Counting sort by hash, serial: it is a small part of the step
+    std::fill(mCellStarts.begin(), mCellStarts.end(), 0);
+    for (uint32_t i = 0; i < mFishCount; ++i) {
+        ++mCellStarts[mCellHash[i] + 1];
+    }
+    for (uint32_t h = 0; h < mCellCount; ++h) {
+        mCellStarts[h + 1] += mCellStarts[h];
+    }
+    std::copy(mCellStarts.begin(), mCellStarts.end() - 1, mCellCursors.begin());
+
+    for (uint32_t i = 0; i < mFishCount; ++i) {
+        const uint32_t dst = mCellCursors[mCellHash[i]]++;
+        const float3   vel = float3(mVelX[i], mVelY[i], mVelZ[i]);
+        const float3   dir = vel / glm::length(vel);
+
+        mSortedPosX[dst]    = mPosX[i];
+        mSortedPosY[dst]    = mPosY[i];
+        mSortedPosZ[dst]    = mPosZ[i];
+        mSortedVelDirX[dst] = dir.x;
+        mSortedVelDirY[dst] = dir.y;
+        mSortedVelDirZ[dst] = dir.z;
+        mSortedCellX[dst]   = mCellX[i];
+        mSortedCellY[dst]   = mCellY[i];
+        mSortedCellZ[dst]   = mCellZ[i];
+        mSortedColumn[dst]  = static_cast<int32_t>(i % mResX);
+        mSortedRow[dst]     = static_cast<int32_t>(i / mResX);
+    }
+}
+
+void CpuFlocking::UpdateFish(const CpuFlockingParams& params, uint32_t first, uint32_t end)
+{
+    const Candidates c = {
+        mSortedPosX.data(),
+        mSortedPosY.data(),
+        mSortedPosZ.data(),
+        mSortedCellX.data(),
+        mSortedCellY.data(),
+        mSortedCellZ.data(),
+        mSortedColumn.data(),
+        mSortedRow.data()};
+
+    float distSqrd[4];
+
+    for (uint32_t i = first; i < end; ++i) {
+        const float3 myPos    = float3(mPosX[i], mPosY[i], mPosZ[i]);
+        const float  accMulti = mLeadership[i] * params.timeDelta * 1.5f;
+
+        float3 acc     = float3(0.0f);
+        float  crowded = 5.0f;
+
+        NeighborQuery q = {};
+        q.x             = myPos.x;
+        q.y             = myPos.y;
+        q.z             = myPos.z;
+        q.column        = static_cast<int32_t>(i % mResX);
+        q.row           = static_cast<int32_t>(i / mResX);
+        q.zoneRadSqrd   = params.zoneRadius * params.zoneRadius;
+
+        const auto accumulate = [&](uint32_t j, float d2) {
+            const float3 pos    = float3(c.posX[j], c.posY[j], c.posZ[j]);
+            const float3 velDir = float3(mSortedVelDirX[j], mSortedVelDirY[j], mSortedVelDirZ[j]);
+            AccumulateNeighbor(params, myPos, accMulti, pos, velDir, d2, acc, crowded);
+        };
+
+        // The zone is one cell wide, so every neighbor is in the 3x3x3 cells
+        // around the fish.
+        for (int32_t z = -1; z <= 1; ++z) {
+            for (int32_t y = -1; y <= 1; ++y) {
+                for (int32_t x = -1; x <= 1; ++x) {
+                    q.cellX = mCellX[i] + x;
+                    q.cellY = mCellY[i] + y;
+                    q.cellZ = mCellZ[i] + z;
+
+                    const uint32_t hash     = GridHash(q.cellX, q.cellY, q.cellZ, mCellCount);
+                    const uint32_t cellEnd  = mCellStarts[hash + 1];
+                    uint32_t       j        = mCellStarts[hash];
+
+                    for (; (j + 4) <= cellEnd; j += 4) {
+                        const uint32_t mask = FilterCandidates4(c, j, q, distSqrd);
+                        for (uint32_t lane = 0; mask >> lane; ++lane) {
+                            if (mask & (1u << lane)) {
+                                accumulate(j + lane, distSqrd[lane]);
+                            }
+                        }
+                    }
+                    for (; j < cellEnd; ++j) {
+                        if (FilterCandidate(c, j, q, &distSqrd[0])) {
+                            accumulate(j, distSqrd[0]);
+                        }
+                    }
+                }
+            }
+        }
+
+        const float4 vel = FinishVelocity(params, myPos, float3(mVelX[i], mVelY[i], mVelZ[i]), mCrowd[i], acc, crowded);
+        mVelX[i]         = vel.x;
+        mVelY[i]         = vel.y;
+        mVelZ[i]         = vel.z;
+        mCrowd[i]        = vel.w;
+
+        // See FlockingPosition.hlsl. Neighbors are read from the sorted copy,
+        // so the fish can be moved in place.
+        const float s = vel.w * 0.1f * params.timeDelta;
+        mPosX[i] += vel.x * s;
+        mPosY[i] += vel.y * s;
+        mPosZ[i] += vel.z * s;
+    }
+}
+
+void CpuFlocking::Step(const CpuFlockingParams& params)
+{
+    BuildGrid(params.zoneRadius);
+
+    ForEachRange([&](uint32_t first, uint32_t end) {
+        UpdateFish(params, first, end);
+    });
+}
+
+void CpuFlocking::WritePositions(void* pDst, uint32_t rowStride) const
+{
+    for (uint32_t y = 0; y < mResY; ++y) {
+        float* pRow = reinterpret_cast<float*>(static_cast<char*>(pDst) + y * rowStride);
+        for (uint32_t x = 0; x < mResX; ++x) {
+            const uint32_t i = y * mResX + x;
+            pRow[4 * x + 0]  = mPosX[i];
+            pRow[4 * x + 1]  = mPosY[i];
+            pRow[4 * x + 2]  = mPosZ[i];
+            pRow[4 * x + 3]  = mLeadership[i];
+        }
+    }
+}
+
+void CpuFlocking::WriteVelocities(void* pDst, uint32_t rowStride) const
+{
+    for (uint32_t y = 0; y < mResY; ++y) {
+        float* pRow = reinterpret_cast<float*>(static_cast<char*>(pDst) + y * rowStride);
+        for (uint32_t x = 0; x < mResX; ++x) {
+            const uint32_t i = y * mResX + x;
+            pRow[4 * x + 0]  = mVelX[i];
+            pRow[4 * x + 1]  = mVelY[i];
+            pRow[4 * x + 2]  = mVelZ[i];
+            pRow[4 * x + 3]  = mCrowd[i];
+        }
+    }
+}
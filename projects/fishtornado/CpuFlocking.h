@@ -0,0 +1,115 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CPU_FLOCKING_H
+#define CPU_FLOCKING_H
+
+#include "ppx/bitmap.h"
+#include "ppx/math_config.h"
+using namespace ppx;
+
+#include <vector>
+
+namespace ppx {
+class JobSystem;
+} // namespace ppx
+
+struct CpuFlockingParams
+{
+    float  minThresh  = 0;
+    float  maxThresh  = 0;
+    float  minSpeed   = 0;
+    float  maxSpeed   = 0;
+    float  zoneRadius = 0;
+    float  time       = 0;
+    float  timeDelta  = 0;
+    float3 predPos    = float3(0);
+    float3 camPos     = float3(0);
+};
+
+// CPU implementation of the flocking compute passes, FlockingVelocity.hlsl
+// followed by FlockingPosition.hlsl.
+//
+// Fish are kept in structure of arrays form, in texel order. Every step bins
+// them into the same spatially hashed grid as the GPU grid passes (see
+// Flocking.hlsli) and sorts a copy of their positions by cell, so the
+// neighbors of a cell are contiguous: candidates are filtered four at a time
+// with SSE2 or NEON, and the forces of the ones within the zone are
+// accumulated in the order of the shader. Fish are split across a job system.
+class CpuFlocking
+{
+public:
+    CpuFlocking() {}
+    ~CpuFlocking() {}
+
+    // position and velocity are RGBA_FLOAT bitmaps of the initial state, the
+    // position's alpha holds leadership and the velocity's the crowd value.
+    void Initialize(const Bitmap& position, const Bitmap& velocity, ppx::JobSystem* pJobSystem);
+
+    // Advance the flock by one step, like the velocity and position passes.
+    void Step(const CpuFlockingParams& params);
+
+    // Write the state as RGBA float texels with rows rowStride bytes apart,
+    // in the layout of the position and velocity textures.
+    void WritePositions(void* pDst, uint32_t rowStride) const;
+    void WriteVelocities(void* pDst, uint32_t rowStride) const;
+
+private:
+    void BuildGrid(float zoneRadius);
+    void UpdateFish(const CpuFlockingParams& params, uint32_t first, uint32_t end);
+
+    // Calls fn(first, end) for ranges of fish across the job system
+    template <typename Fn>
+    void ForEachRange(const Fn& fn);
+
+    uint32_t        mResX      = 0;
+    uint32_t        mResY      = 0;
+    uint32_t        mFishCount = 0;
+    uint32_t        mCellCount = 0;
+    ppx::JobSystem* mJobSystem = nullptr;
+
+    // Fish state, in texel order
+    std::vector<float> mPosX;
+    std::vector<float> mPosY;
+    std::vector<float> mPosZ;
+    std::vector<float> mLeadership;
+    std::vector<float> mVelX;
+    std::vector<float> mVelY;
+    std::vector<float> mVelZ;
+    std::vector<float> mCrowd;
+
+    // Grid cell and hash of every fish, in texel order
+    std::vector<int32_t>  mCellX;
+    std::vector<int32_t>  mCellY;
+    std::vector<int32_t>  mCellZ;
+    std::vector<uint32_t> mCellHash;
+
+    // Fish sorted by cell hash, the fish of hash h are in
+    // [mCellStarts[h], mCellStarts[h + 1]).
+    std::vector<uint32_t> mCellStarts;
+    std::vector<uint32_t> mCellCursors;
+    std::vector<float>    mSortedPosX;
+    std::vector<float>    mSortedPosY;
+    std::vector<float>    mSortedPosZ;
+    std::vector<float>    mSortedVelDirX; // Normalized velocity
+    std::vector<float>    mSortedVelDirY;
+    std::vector<float>    mSortedVelDirZ;
+    std::vector<int32_t>  mSortedCellX;
+    std::vector<int32_t>  mSortedCellY;
+    std::vector<int32_t>  mSortedCellZ;
+    std::vector<int32_t>  mSortedColumn;
+    std::vector<int32_t>  mSortedRow;
+};
+
+#endif // CPU_FLOCKING_H
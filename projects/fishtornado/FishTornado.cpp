@@ -14,6 +14,7 @@
 
 #include "FishTornado.h"
 #include "ppx/graphics_util.h"
+#include "ppx/timer.h"
 
 #include <filesystem>
 
@@ -25,6 +26,26 @@
 static const float3 kFogColor   = float3(15.0f, 86.0f, 107.0f) / 255.0f;
 static const float3 kFloorColor = float3(145.0f, 189.0f, 155.0f) / 255.0f;
 
+// Draws recorded into secondary command buffers, one secondary command
+// buffer per job. The fish dominate recording, so each pass splits them into
+// one instance range per recording thread. Shadow jobs come first and are
+// executed in the shadow draw pass, the others in the swapchain render pass:
+//
+//   shadow  : shark, fish ranges
+//   forward : shark and debug draws, fish ranges, ocean
+//
+static const uint32_t kMaxRecordingThreadCount = 32;
+
+static uint32_t GetShadowRecordingJobCount(uint32_t fishJobCount)
+{
+    return fishJobCount + 1;
+}
+
+static uint32_t GetForwardRecordingJobCount(uint32_t fishJobCount)
+{
+    return fishJobCount + 2;
+}
+
 FishTornadoApp* FishTornadoApp::GetThisApp()
 {
     FishTornadoApp* pApp = static_cast<FishTornadoApp*>(Application::Get());
@@ -252,6 +273,13 @@ void FishTornadoApp::SetupPerFrame()
         PPX_CHECKED_CALL(GetComputeQueue()->CreateCommandBuffer(&frame.asyncFlockingCmd));
         PPX_CHECKED_CALL(GetGraphicsQueue()->CreateCommandBuffer(&frame.shadowCmd));
 
+        const uint32_t fishJobCount = mSettings.recordingThreadCount;
+        frame.secondaryCmds.resize(GetShadowRecordingJobCount(fishJobCount) + GetForwardRecordingJobCount(fishJobCount));
+        for (auto& secondaryCmd : frame.secondaryCmds) {
+            PPX_CHECKED_CALL(GetGraphicsQueue()->CreateSecondaryCommandBuffer(&secondaryCmd));
+            frame.secondaryCmdList.push_back(secondaryCmd);
+        }
+
         grfx::SemaphoreCreateInfo semaCreateInfo  = {};
         grfx::FenceCreateInfo     fenceCreateInfo = {};
 
@@ -327,6 +355,16 @@ void FishTornadoApp::SetupPerFrame()
         }
 #endif
     }
+
+    // Async compute, measures the overlap of the flocking passes with the
+    // shadow and forward passes
+    {
+        AsyncComputeSchedulerCreateInfo createInfo = {};
+        createInfo.pGraphicsQueue                  = GetGraphicsQueue();
+        createInfo.pComputeQueue                   = GetComputeQueue();
+        createInfo.frameCount                      = numFramesInFlight;
+        PPX_CHECKED_CALL(mAsyncCompute.Initialize(GetDevice(), createInfo));
+    }
 }
 
 void FishTornadoApp::SetupCaustics()
@@ -405,6 +443,8 @@ void FishTornadoApp::Setup()
     mSettings.renderFish               = !(clOptions.HasExtraOption("ft-disable-fish") && clOptions.GetExtraOptionValueOrDefault<bool>("ft-disable-fish", true));
     mSettings.renderOcean              = !(clOptions.HasExtraOption("ft-disable-ocean") && clOptions.GetExtraOptionValueOrDefault<bool>("ft-disable-ocean", true));
     mSettings.renderShark              = !(clOptions.HasExtraOption("ft-disable-shark") && clOptions.GetExtraOptionValueOrDefault<bool>("ft-disable-shark", true));
+    mSettings.useFlockingGrid          = (clOptions.HasExtraOption("ft-use-flocking-grid") && clOptions.GetExtraOptionValueOrDefault<bool>("ft-use-flocking-grid", true));
+    mSettings.useCpuFlocking           = (clOptions.HasExtraOption("ft-use-cpu-flocking") && clOptions.GetExtraOptionValueOrDefault<bool>("ft-use-cpu-flocking", true));
 
     mSettings.fishResX = clOptions.GetExtraOptionValueOrDefault<uint32_t>("ft-fish-res-x", kDefaultFishResX);
     PPX_ASSERT_MSG(mSettings.fishResX < 65536, "Fish X resolution out-of-range.");
@@ -415,6 +455,18 @@ void FishTornadoApp::Setup()
     mSettings.fishThreadsY = clOptions.GetExtraOptionValueOrDefault<uint32_t>("ft-fish-threads-y", kDefaultFishThreadsY);
     PPX_ASSERT_MSG(mSettings.fishThreadsY < 65536, "Fish Y threads out of range.");
 
+    // Recording threads include the main thread
+    if (clOptions.HasExtraOption("ft-recording-threads")) {
+        mSettings.useSecondaryCommandBuffers = true;
+        mSettings.recordingThreadCount       = clOptions.GetExtraOptionValueOrDefault<uint32_t>("ft-recording-threads", 1);
+    }
+    else {
+        mSettings.recordingThreadCount = JobSystem::GetDefaultWorkerCount() + 1;
+    }
+    mSettings.recordingThreadCount = std::max<uint32_t>(std::min<uint32_t>(mSettings.recordingThreadCount, kMaxRecordingThreadCount), 1);
+    mRecordingJobs.Initialize(mSettings.recordingThreadCount - 1);
+    PPX_LOG_INFO("Secondary command buffers are recorded on " << mSettings.recordingThreadCount << " thread(s), fish in " << mSettings.recordingThreadCount << " instance range(s) per pass");
+
     SetupDescriptorPool();
     SetupSetLayouts();
     SetupPipelineInterfaces();
@@ -445,6 +497,13 @@ void FishTornadoApp::Shutdown()
     mOcean.Shutdown();
     mShark.Shutdown();
 
+    if (mRecordedFrameCount > 0) {
+        PPX_LOG_INFO("Average secondary command buffer recording time on " << mSettings.recordingThreadCount << " thread(s): " << (mTotalRecordingTimeMs / static_cast<double>(mRecordedFrameCount)) << " ms");
+    }
+
+    mRecordingJobs.Shutdown();
+    mAsyncCompute.Shutdown();
+
     for (size_t i = 0; i < mPerFrame.size(); ++i) {
         PerFrame& frame = mPerFrame[i];
         frame.sceneConstants.Destroy();
@@ -496,6 +555,8 @@ void FishTornadoApp::RenderSceneUsingSingleCommandBuffer(
     grfx::SwapchainPtr& swapchain,
     uint32_t            imageIndex)
 {
+    frame.pipelineStatsRecorded = true;
+
     // Build command buffer
     PPX_CHECKED_CALL(frame.cmd->Begin());
     {
@@ -540,7 +601,7 @@ void FishTornadoApp::RenderSceneUsingSingleCommandBuffer(
         if (mSettings.renderFish) {
             // Compute flocking
             mFlocking.BeginCompute(frameIndex, frame.cmd, false);
-            mFlocking.Compute(frameIndex, frame.cmd);
+            mFlocking.Compute(frameIndex, frame.cmd, mSettings.useFlockingGrid);
             mFlocking.EndCompute(frameIndex, frame.cmd, false);
         }
 
@@ -647,6 +708,84 @@ void FishTornadoApp::RenderSceneUsingSingleCommandBuffer(
     PPX_CHECKED_CALL(GetGraphicsQueue()->Submit(&submitInfo));
 }
 
+void FishTornadoApp::RecordSecondaryCommandBuffers(
+    uint32_t                         frameIndex,
+    PerFrame&                        frame,
+    const grfx::RenderPassBeginInfo& shadowBeginInfo,
+    const grfx::RenderPassBeginInfo& forwardBeginInfo)
+{
+    Timer timer;
+    timer.Start();
+
+    const uint32_t fishJobCount   = mSettings.recordingThreadCount;
+    const uint32_t shadowJobCount = GetShadowRecordingJobCount(fishJobCount);
+    const uint64_t fishCount      = mFlocking.GetInstanceCount();
+
+    mRecordingJobs.Run(CountU32(frame.secondaryCmds), [&](uint32_t jobIndex, uint32_t) {
+        bool isShadowJob = (jobIndex < shadowJobCount);
+        // 0 is the shark, [1, fishJobCount] the fish ranges and the ocean follows
+        uint32_t passJobIndex = isShadowJob ? jobIndex : (jobIndex - shadowJobCount);
+
+        grfx::CommandBufferInheritanceInfo inheritanceInfo = {};
+        inheritanceInfo.pRenderPass                        = isShadowJob ? shadowBeginInfo.pRenderPass : forwardBeginInfo.pRenderPass;
+        inheritanceInfo.pPrimaryCommandBuffer              = isShadowJob ? frame.shadowCmd : frame.cmd;
+
+        grfx::CommandBuffer* pCmd = frame.secondaryCmds[jobIndex];
+        PPX_CHECKED_CALL(pCmd->Begin(&inheritanceInfo));
+        {
+            if (isShadowJob) {
+                pCmd->SetScissors(frame.shadowDrawPass->GetScissor());
+                pCmd->SetViewports(frame.shadowDrawPass->GetViewport());
+            }
+            else {
+                pCmd->SetScissors(forwardBeginInfo.pRenderPass->GetScissor());
+                pCmd->SetViewports(forwardBeginInfo.pRenderPass->GetViewport());
+            }
+
+            if (passJobIndex == 0) {
+                if (isShadowJob) {
+                    if (mSettings.renderShark) {
+                        mShark.DrawShadow(frameIndex, pCmd);
+                    }
+                }
+                else {
+                    if (mSettings.renderShark) {
+                        mShark.DrawForward(frameIndex, pCmd);
+                    }
+                    if (mSettings.renderDebug && mSettings.renderShark) {
+                        mShark.DrawDebug(frameIndex, pCmd);
+                    }
+                    if (mSettings.renderDebug && mSettings.renderFish) {
+                        mFlocking.DrawDebug(frameIndex, pCmd);
+                    }
+                }
+            }
+            else if (passJobIndex <= fishJobCount) {
+                if (mSettings.renderFish) {
+                    uint32_t range         = passJobIndex - 1;
+                    uint32_t firstInstance = static_cast<uint32_t>(fishCount * range / fishJobCount);
+                    uint32_t endInstance   = static_cast<uint32_t>(fishCount * (range + 1) / fishJobCount);
+                    if (isShadowJob) {
+                        mFlocking.DrawShadow(frameIndex, pCmd, firstInstance, endInstance - firstInstance);
+                    }
+                    else {
+                        mFlocking.DrawForward(frameIndex, pCmd, firstInstance, endInstance - firstInstance);
+                    }
+                }
+            }
+            else if (mSettings.renderOcean) {
+                mOcean.DrawForward(frameIndex, pCmd);
+            }
+        }
+        PPX_CHECKED_CALL(pCmd->End());
+    });
+
+    mRecordingTimeMs = timer.MillisSinceStart();
+    mTotalRecordingTimeMs += mRecordingTimeMs;
+    mRecordedFrameCount += 1;
+    mRecordingTimeUpdated = true;
+}
+
 void FishTornadoApp::RenderSceneUsingMultipleCommandBuffers(
     uint32_t            frameIndex,
     PerFrame&           frame,
@@ -728,18 +867,22 @@ void FishTornadoApp::RenderSceneUsingMultipleCommandBuffers(
 
     // ---------------------------------------------------------------------------------------------
 
+    const bool asyncCompute = mAsyncCompute.IsEnabled();
+
     if (mSettings.renderFish) {
         grfx::CommandBuffer* pFlockingCmd = frame.grfxFlockingCmd;
-        if (mSettings.useAsyncCompute) {
+        if (asyncCompute) {
             pFlockingCmd = frame.asyncFlockingCmd;
         }
 
         // Compute flocking
         PPX_CHECKED_CALL(pFlockingCmd->Begin());
         {
-            mFlocking.BeginCompute(frameIndex, pFlockingCmd, mSettings.useAsyncCompute);
-            mFlocking.Compute(frameIndex, pFlockingCmd);
-            mFlocking.EndCompute(frameIndex, pFlockingCmd, mSettings.useAsyncCompute);
+            mAsyncCompute.BeginWork(pFlockingCmd, ASYNC_COMPUTE_WORK_COMPUTE);
+            mFlocking.BeginCompute(frameIndex, pFlockingCmd, asyncCompute);
+            mFlocking.Compute(frameIndex, pFlockingCmd, mSettings.useFlockingGrid);
+            mFlocking.EndCompute(frameIndex, pFlockingCmd, asyncCompute);
+            mAsyncCompute.EndWork(pFlockingCmd, ASYNC_COMPUTE_WORK_COMPUTE);
         }
         PPX_CHECKED_CALL(pFlockingCmd->End());
 
@@ -753,29 +896,54 @@ void FishTornadoApp::RenderSceneUsingMultipleCommandBuffers(
             submitInfo.signalSemaphoreCount = 1;
             submitInfo.ppSignalSemaphores   = &frame.flockingCompleteSemaphore;
 
-            if (mSettings.useAsyncCompute) {
-                PPX_CHECKED_CALL(GetComputeQueue()->Submit(&submitInfo));
-            }
-            else {
-                PPX_CHECKED_CALL(GetGraphicsQueue()->Submit(&submitInfo));
-            }
+            PPX_CHECKED_CALL(mAsyncCompute.Submit(ASYNC_COMPUTE_WORK_COMPUTE, &submitInfo));
         }
     }
 
     // ---------------------------------------------------------------------------------------------
 
-    // Shadow mapping
+    grfx::RenderPassPtr renderPass = swapchain->GetRenderPass(imageIndex);
+    PPX_ASSERT_MSG(!renderPass.IsNull(), "render pass object is null");
+
+    grfx::RenderPassBeginInfo shadowBeginInfo = {};
+    frame.shadowDrawPass->PrepareRenderPassBeginInfo(grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_ALL, &shadowBeginInfo);
+    shadowBeginInfo.secondaryCommandBuffers = mSettings.useSecondaryCommandBuffers;
+
+    grfx::RenderPassBeginInfo forwardBeginInfo = {};
+    forwardBeginInfo.pRenderPass               = renderPass;
+    forwardBeginInfo.renderArea                = renderPass->GetRenderArea();
+    forwardBeginInfo.RTVClearCount             = 1;
+    forwardBeginInfo.RTVClearValues[0]         = {{kFogColor.r, kFogColor.g, kFogColor.b, 1.0f}};
+    forwardBeginInfo.secondaryCommandBuffers   = mSettings.useSecondaryCommandBuffers;
+
+    // Both primaries are begun up front: on D3D12 secondary command buffers
+    // write their descriptors into the heaps of the primary executing them.
     PPX_CHECKED_CALL(frame.shadowCmd->Begin());
+    PPX_CHECKED_CALL(frame.cmd->Begin());
+
+    // Pipeline statistics are not collected when the forward pass is recorded
+    // into secondary command buffers, queries cannot stay active across them
+    // without the inherited queries feature.
+    frame.pipelineStatsRecorded = !mSettings.useSecondaryCommandBuffers;
+
+    if (mSettings.useSecondaryCommandBuffers) {
+        RecordSecondaryCommandBuffers(frameIndex, frame, shadowBeginInfo, forwardBeginInfo);
+    }
+
+    // Shadow mapping
     {
+        mAsyncCompute.BeginWork(frame.shadowCmd, ASYNC_COMPUTE_WORK_GRAPHICS);
         if (mSettings.renderFish) {
-            mFlocking.BeginGraphics(frameIndex, frame.shadowCmd, mSettings.useAsyncCompute);
+            mFlocking.BeginGraphics(frameIndex, frame.shadowCmd, asyncCompute);
         }
         frame.shadowCmd->TransitionImageLayout(frame.shadowDrawPass, grfx::RESOURCE_STATE_UNDEFINED, grfx::RESOURCE_STATE_UNDEFINED, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
-        frame.shadowCmd->BeginRenderPass(frame.shadowDrawPass);
-        {
-            frame.shadowCmd->SetScissors(frame.shadowDrawPass->GetScissor());
-            frame.shadowCmd->SetViewports(frame.shadowDrawPass->GetViewport());
-
+        frame.shadowCmd->SetScissors(frame.shadowDrawPass->GetScissor());
+        frame.shadowCmd->SetViewports(frame.shadowDrawPass->GetViewport());
+        frame.shadowCmd->BeginRenderPass(&shadowBeginInfo);
+        if (mSettings.useSecondaryCommandBuffers) {
+            frame.shadowCmd->ExecuteCommands(GetShadowRecordingJobCount(mSettings.recordingThreadCount), frame.secondaryCmdList.data());
+        }
+        else {
             if (mSettings.renderShark) {
                 mShark.DrawShadow(frameIndex, frame.shadowCmd);
             }
@@ -785,6 +953,7 @@ void FishTornadoApp::RenderSceneUsingMultipleCommandBuffers(
         }
         frame.shadowCmd->EndRenderPass();
         frame.shadowCmd->TransitionImageLayout(frame.shadowDrawPass, grfx::RESOURCE_STATE_UNDEFINED, grfx::RESOURCE_STATE_UNDEFINED, grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+        mAsyncCompute.EndWork(frame.shadowCmd, ASYNC_COMPUTE_WORK_GRAPHICS);
     }
     PPX_CHECKED_CALL(frame.shadowCmd->End());
 
@@ -807,23 +976,24 @@ void FishTornadoApp::RenderSceneUsingMultipleCommandBuffers(
     // ---------------------------------------------------------------------------------------------
 
     // Render
-    PPX_CHECKED_CALL(frame.cmd->Begin());
     {
-        grfx::RenderPassPtr renderPass = swapchain->GetRenderPass(imageIndex);
-        PPX_ASSERT_MSG(!renderPass.IsNull(), "render pass object is null");
-
-        grfx::RenderPassBeginInfo beginInfo = {};
-        beginInfo.pRenderPass               = renderPass;
-        beginInfo.renderArea                = renderPass->GetRenderArea();
-        beginInfo.RTVClearCount             = 1;
-        beginInfo.RTVClearValues[0]         = {{kFogColor.r, kFogColor.g, kFogColor.b, 1.0f}};
-
+        mAsyncCompute.BeginWork(frame.cmd, ASYNC_COMPUTE_WORK_GRAPHICS);
         frame.cmd->TransitionImageLayout(renderPass->GetRenderTargetImage(0), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_PRESENT, grfx::RESOURCE_STATE_RENDER_TARGET);
-        frame.cmd->BeginRenderPass(&beginInfo);
-        {
+        frame.cmd->SetScissors(renderPass->GetScissor());
+        frame.cmd->SetViewports(renderPass->GetViewport());
+        frame.cmd->BeginRenderPass(&forwardBeginInfo);
+        if (mSettings.useSecondaryCommandBuffers) {
+            const uint32_t shadowJobCount = GetShadowRecordingJobCount(mSettings.recordingThreadCount);
+            frame.cmd->ExecuteCommands(GetForwardRecordingJobCount(mSettings.recordingThreadCount), frame.secondaryCmdList.data() + shadowJobCount);
+            frame.cmd->EndRenderPass();
+
+            // ImGui records inline, so it gets its own render pass that
+            // loads what the secondary command buffers rendered.
+            frame.cmd->BeginRenderPass(swapchain->GetRenderPass(imageIndex, grfx::ATTACHMENT_LOAD_OP_LOAD));
             frame.cmd->SetScissors(renderPass->GetScissor());
             frame.cmd->SetViewports(renderPass->GetViewport());
-
+        }
+        else {
             if (mSettings.renderShark) {
                 mShark.DrawForward(frameIndex, frame.cmd);
             }
@@ -844,7 +1014,14 @@ void FishTornadoApp::RenderSceneUsingMultipleCommandBuffers(
             if (mSettings.renderOcean) {
                 mOcean.DrawForward(frameIndex, frame.cmd);
             }
-
+            if (mSettings.renderDebug && mSettings.renderShark) {
+                mShark.DrawDebug(frameIndex, frame.cmd);
+            }
+            if (mSettings.renderDebug && mSettings.renderFish) {
+                mFlocking.DrawDebug(frameIndex, frame.cmd);
+            }
+        }
+        {
             // Draw ImGui
             DrawDebugInfo();
 #if defined(PPX_ENABLE_PROFILE_GRFX_API_FUNCTIONS)
@@ -856,8 +1033,13 @@ void FishTornadoApp::RenderSceneUsingMultipleCommandBuffers(
         frame.cmd->TransitionImageLayout(renderPass->GetRenderTargetImage(0), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_PRESENT);
 
         if (mSettings.renderFish) {
-            mFlocking.EndGraphics(frameIndex, frame.cmd, mSettings.useAsyncCompute);
+            mFlocking.EndGraphics(frameIndex, frame.cmd, asyncCompute);
         }
+
+        // The shadow pass waited for flocking, so all other timestamped
+        // work of the frame has completed
+        mAsyncCompute.EndWork(frame.cmd, ASYNC_COMPUTE_WORK_GRAPHICS);
+        mAsyncCompute.ResolveTimestamps(frame.cmd);
     }
     PPX_CHECKED_CALL(frame.cmd->End());
 
@@ -887,7 +1069,7 @@ void FishTornadoApp::RenderSceneUsingMultipleCommandBuffers(
         // Resolve queries
         frame.gpuEndTimestampCmd->ResolveQueryData(frame.startTimestampQuery, 0, 1);
         frame.gpuEndTimestampCmd->ResolveQueryData(frame.endTimestampQuery, 0, 1);
-        if (GetDevice()->PipelineStatsAvailable()) {
+        if (GetDevice()->PipelineStatsAvailable() && frame.pipelineStatsRecorded) {
             frame.gpuEndTimestampCmd->ResolveQueryData(frame.pipelineStatsQuery, 0, 1);
         }
     }
@@ -958,12 +1140,20 @@ void FishTornadoApp::Render()
         PPX_CHECKED_CALL(prevFrame.startTimestampQuery->GetData(&data[0], 1 * sizeof(uint64_t)));
         PPX_CHECKED_CALL(prevFrame.endTimestampQuery->GetData(&data[1], 1 * sizeof(uint64_t)));
         mTotalGpuFrameTime = (data[1] - data[0]);
-        if (GetDevice()->PipelineStatsAvailable()) {
+        if (GetDevice()->PipelineStatsAvailable() && prevFrame.pipelineStatsRecorded) {
             PPX_CHECKED_CALL(prevFrame.pipelineStatsQuery->GetData(&mPipelineStatistics, sizeof(grfx::PipelineStatistics)));
         }
 #endif
     }
 
+    // Flocking GPU time of the frame that last used this frame's resources
+    mFlockingTimeUpdated = mFlocking.ReadComputeTime(frameIndex);
+
+    // Graphics and compute overlap of the same frame, the single command
+    // buffer path records no spans and leaves the stats as they were
+    mAsyncCompute.SetEnabled(mSettings.useAsyncCompute && !mSettings.forceSingleCommandBuffer);
+    mAsyncCompute.BeginFrame(frameIndex);
+
     if (mSettings.forceSingleCommandBuffer) {
         RenderSceneUsingSingleCommandBuffer(frameIndex, frame, prevFrameIndex, prevFrame, swapchain, imageIndex);
     }
@@ -971,11 +1161,69 @@ void FishTornadoApp::Render()
         RenderSceneUsingMultipleCommandBuffers(frameIndex, frame, prevFrameIndex, prevFrame, swapchain, imageIndex);
     }
 
-    mLastFrameWasAsyncCompute = mSettings.useAsyncCompute;
+    mLastFrameWasAsyncCompute = mAsyncCompute.IsEnabled();
 
     PPX_CHECKED_CALL(swapchain->Present(imageIndex, 1, &frame.frameCompleteSemaphore));
 }
 
+void FishTornadoApp::SetupMetrics()
+{
+    Application::SetupMetrics();
+    if (!HasActiveMetricsRun()) {
+        return;
+    }
+
+    // Recorded for the algorithm in use, see --ft-use-flocking-grid and --ft-use-cpu-flocking
+    ppx::metrics::MetricMetadata metadata = {ppx::metrics::MetricType::GAUGE, "Flocking GPU Time (brute force)", "ms", ppx::metrics::MetricInterpretation::LOWER_IS_BETTER, {0.f, 60000.f}};
+    mFlockingBruteForceTimeMetric         = AddMetric(metadata);
+    PPX_ASSERT_MSG(mFlockingBruteForceTimeMetric != ppx::metrics::kInvalidMetricID, "Failed to add Flocking GPU Time (brute force) metric");
+
+    metadata                = {ppx::metrics::MetricType::GAUGE, "Flocking GPU Time (grid)", "ms", ppx::metrics::MetricInterpretation::LOWER_IS_BETTER, {0.f, 60000.f}};
+    mFlockingGridTimeMetric = AddMetric(metadata);
+    PPX_ASSERT_MSG(mFlockingGridTimeMetric != ppx::metrics::kInvalidMetricID, "Failed to add Flocking GPU Time (grid) metric");
+
+    metadata               = {ppx::metrics::MetricType::GAUGE, "Flocking CPU Time", "ms", ppx::metrics::MetricInterpretation::LOWER_IS_BETTER, {0.f, 60000.f}};
+    mFlockingCpuTimeMetric = AddMetric(metadata);
+    PPX_ASSERT_MSG(mFlockingCpuTimeMetric != ppx::metrics::kInvalidMetricID, "Failed to add Flocking CPU Time metric");
+
+    // Compare runs with different --ft-recording-threads to see how recording scales
+    metadata             = {ppx::metrics::MetricType::GAUGE, "Secondary Command Buffer Recording Time", "ms", ppx::metrics::MetricInterpretation::LOWER_IS_BETTER, {0.f, 60000.f}};
+    mRecordingTimeMetric = AddMetric(metadata);
+    PPX_ASSERT_MSG(mRecordingTimeMetric != ppx::metrics::kInvalidMetricID, "Failed to add Secondary Command Buffer Recording Time metric");
+
+    mAsyncCompute.AddMetrics(this);
+}
+
+void FishTornadoApp::UpdateMetrics()
+{
+    if (!HasActiveMetricsRun()) {
+        return;
+    }
+
+    ppx::metrics::MetricData data = {ppx::metrics::MetricType::GAUGE};
+    data.gauge.seconds            = GetElapsedSeconds();
+
+    mAsyncCompute.RecordMetrics(this, data.gauge.seconds);
+
+    if (mRecordingTimeUpdated) {
+        data.gauge.value = mRecordingTimeMs;
+        RecordMetricData(mRecordingTimeMetric, data);
+        mRecordingTimeUpdated = false;
+    }
+
+    // The GPU only uploads the CPU flock, its time is not comparable
+    if (mFlocking.IsCpuBackend()) {
+        data.gauge.value = mFlocking.GetCpuStepTimeMs();
+        RecordMetricData(mFlockingCpuTimeMetric, data);
+        return;
+    }
+
+    if (mFlockingTimeUpdated) {
+        data.gauge.value = mFlocking.GetComputeTimeMs();
+        RecordMetricData(mFlocking.WasGridUsed() ? mFlockingGridTimeMetric : mFlockingBruteForceTimeMetric, data);
+    }
+}
+
 void FishTornadoApp::DrawGui()
 {
     ImGui::Separator();
@@ -993,6 +1241,23 @@ void FishTornadoApp::DrawGui()
         ImGui::Text("%f ms ", static_cast<float>(mTotalGpuFrameTime / static_cast<double>(frequency)) * 1000.0f);
         ImGui::NextColumn();
 
+        ImGui::Text("Flocking GPU Time");
+        ImGui::NextColumn();
+        if (mFlocking.IsCpuBackend()) {
+            ImGui::Text("%f ms (CPU upload)", mFlocking.GetComputeTimeMs());
+        }
+        else {
+            ImGui::Text("%f ms (%s)", mFlocking.GetComputeTimeMs(), mFlocking.WasGridUsed() ? "grid" : "brute force");
+        }
+        ImGui::NextColumn();
+
+        if (mFlocking.IsCpuBackend()) {
+            ImGui::Text("Flocking CPU Time");
+            ImGui::NextColumn();
+            ImGui::Text("%f ms", mFlocking.GetCpuStepTimeMs());
+            ImGui::NextColumn();
+        }
+
         ImGui::Separator();
 
         ImGui::Text("Fish IAVertices");
@@ -1033,8 +1298,16 @@ void FishTornadoApp::DrawGui()
     ImGui::Checkbox("Render Shark", &mSettings.renderShark);
     ImGui::Checkbox("Render Fish", &mSettings.renderFish);
     ImGui::Checkbox("Render Ocean", &mSettings.renderOcean);
+    ImGui::Checkbox("Render Debug", &mSettings.renderDebug);
 
     ImGui::Checkbox("Use PCF Shadows", &mSettings.usePCF);
+    if (mSettings.useCpuFlocking) {
+        ImGui::BeginDisabled();
+    }
+    ImGui::Checkbox("Use Flocking Grid", &mSettings.useFlockingGrid);
+    if (mSettings.useCpuFlocking) {
+        ImGui::EndDisabled();
+    }
 
     if (mSettings.useAsyncCompute) {
         ImGui::BeginDisabled();
@@ -1048,7 +1321,41 @@ void FishTornadoApp::DrawGui()
         ImGui::BeginDisabled();
     }
     ImGui::Checkbox("Use Async Compute", &mSettings.useAsyncCompute);
+    ImGui::Checkbox("Use Secondary CommandBuffers", &mSettings.useSecondaryCommandBuffers);
     if (mSettings.forceSingleCommandBuffer) {
         ImGui::EndDisabled();
     }
+
+    ImGui::Columns(2);
+    {
+        ImGui::Text("Recording Threads");
+        ImGui::NextColumn();
+        ImGui::Text("%u", mSettings.recordingThreadCount);
+        ImGui::NextColumn();
+
+        ImGui::Text("Recording Time");
+        ImGui::NextColumn();
+        ImGui::Text("%.3f ms", mSettings.useSecondaryCommandBuffers ? mRecordingTimeMs : 0.0);
+        ImGui::NextColumn();
+
+        ImGui::Text("Average Recording Time");
+        ImGui::NextColumn();
+        ImGui::Text("%.3f ms", (mRecordedFrameCount > 0) ? (mTotalRecordingTimeMs / static_cast<double>(mRecordedFrameCount)) : 0.0);
+        ImGui::NextColumn();
+
+        if (mAsyncCompute.HasStats()) {
+            const AsyncComputeStats& stats = mAsyncCompute.GetStats();
+
+            ImGui::Text("Async Compute Overlap");
+            ImGui::NextColumn();
+            ImGui::Text("%.3f ms (%.0f%%)", stats.overlapMs, 100.0 * stats.overlapRatio);
+            ImGui::NextColumn();
+
+            ImGui::Text("Graphics + Compute GPU Time");
+            ImGui::NextColumn();
+            ImGui::Text("%.3f ms", stats.frameMs);
+            ImGui::NextColumn();
+        }
+    }
+    ImGui::Columns(1);
 }
@@ -23,7 +23,9 @@
 #include "Shark.h"
 
 #include "ppx/ppx.h"
+#include "ppx/async_compute.h"
 #include "ppx/camera.h"
+#include "ppx/job_system.h"
 
 #include <filesystem>
 
@@ -35,16 +37,21 @@ const grfx::Api kApi = grfx::API_VK_1_1;
 
 struct FishTornadoSettings
 {
-    bool     usePCF                   = true;
-    bool     forceSingleCommandBuffer = false;
-    bool     useAsyncCompute          = false;
-    bool     renderFish               = true;
-    bool     renderOcean              = true;
-    bool     renderShark              = true;
-    uint32_t fishResX                 = kDefaultFishResX;
-    uint32_t fishResY                 = kDefaultFishResY;
-    uint32_t fishThreadsX             = kDefaultFishThreadsX;
-    uint32_t fishThreadsY             = kDefaultFishThreadsY;
+    bool     usePCF                     = true;
+    bool     forceSingleCommandBuffer   = false;
+    bool     useAsyncCompute            = false;
+    bool     useSecondaryCommandBuffers = false;
+    bool     renderFish                 = true;
+    bool     renderOcean                = true;
+    bool     renderShark                = true;
+    bool     renderDebug                = false;
+    bool     useFlockingGrid            = false;
+    bool     useCpuFlocking             = false;
+    uint32_t fishResX                   = kDefaultFishResX;
+    uint32_t fishResY                   = kDefaultFishResY;
+    uint32_t fishThreadsX               = kDefaultFishThreadsX;
+    uint32_t fishThreadsY               = kDefaultFishThreadsY;
+    uint32_t recordingThreadCount       = 1;
 };
 
 class FishTornadoApp
@@ -69,6 +76,7 @@ public:
     grfx::SamplerPtr             GetRepeatSampler() const { return mRepeatSampler; }
     grfx::PipelineInterfacePtr   GetForwardPipelineInterface() const { return mForwardPipelineInterface; }
     grfx::GraphicsPipelinePtr    GetDebugDrawPipeline() const { return mDebugDrawPipeline; }
+    const AsyncComputeScheduler& GetAsyncCompute() const { return mAsyncCompute; }
 
     grfx::GraphicsPipelinePtr CreateForwardPipeline(
         const std::filesystem::path& baseDir,
@@ -86,6 +94,8 @@ public:
     virtual void Shutdown() override;
     virtual void Scroll(float dx, float dy) override;
     virtual void Render() override;
+    virtual void SetupMetrics() override;
+    virtual void UpdateMetrics() override;
 
     bool WasLastFrameAsync() { return mLastFrameWasAsyncCompute; }
 
@@ -115,6 +125,11 @@ private:
         grfx::QueryPtr         startTimestampQuery;
         grfx::QueryPtr         endTimestampQuery;
         grfx::QueryPtr         pipelineStatsQuery;
+        bool                   pipelineStatsRecorded = true;
+
+        // One secondary command buffer per recording job, see RecordSecondaryCommandBuffers()
+        std::vector<grfx::CommandBufferPtr>     secondaryCmds;
+        std::vector<const grfx::CommandBuffer*> secondaryCmdList; // For ExecuteCommands()
     };
 
     grfx::DescriptorPoolPtr      mDescriptorPool;
@@ -133,6 +148,7 @@ private:
     PerspCamera                  mShadowCamera;
     float                        mTime = 0;
     float                        mDt   = 0;
+    AsyncComputeScheduler        mAsyncCompute;
     Flocking                     mFlocking;
     Ocean                        mOcean;
     Shark                        mShark;
@@ -140,6 +156,16 @@ private:
     grfx::PipelineStatistics     mPipelineStatistics       = {};
     bool                         mLastFrameWasAsyncCompute = false;
     FishTornadoSettings          mSettings;
+    ppx::JobSystem               mRecordingJobs;
+    double                       mRecordingTimeMs              = 0;
+    double                       mTotalRecordingTimeMs         = 0;
+    uint64_t                     mRecordedFrameCount           = 0;
+    bool                         mRecordingTimeUpdated         = false;
+    bool                         mFlockingTimeUpdated          = false;
+    ppx::metrics::MetricID       mFlockingBruteForceTimeMetric = ppx::metrics::kInvalidMetricID;
+    ppx::metrics::MetricID       mFlockingGridTimeMetric       = ppx::metrics::kInvalidMetricID;
+    ppx::metrics::MetricID       mFlockingCpuTimeMetric        = ppx::metrics::kInvalidMetricID;
+    ppx::metrics::MetricID       mRecordingTimeMetric          = ppx::metrics::kInvalidMetricID;
 
 private:
     void SetupDescriptorPool();
@@ -161,6 +187,11 @@ private:
         PerFrame&           prevFrame,
         grfx::SwapchainPtr& swapchain,
         uint32_t            imageIndex);
+    void RecordSecondaryCommandBuffers(
+        uint32_t                         frameIndex,
+        PerFrame&                        frame,
+        const grfx::RenderPassBeginInfo& shadowBeginInfo,
+        const grfx::RenderPassBeginInfo& forwardBeginInfo);
     void RenderSceneUsingMultipleCommandBuffers(
         uint32_t            frameIndex,
         PerFrame&           frame,
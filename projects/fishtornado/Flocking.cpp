@@ -18,6 +18,16 @@
 #include "FishTornado.h"
 #include "ppx/graphics_util.h"
 #include "ppx/random.h"
+#include "ppx/timer.h"
+
+// Flocking grid, see Flocking.hlsli. The cell count is a power of two so the
+// spatial hash can be masked, and is limited to kGridScanBlockSize scan blocks
+// so the block totals can be scanned by a single group.
+static const uint32_t kGridScanBlockSize    = 1024; // FLOCKING_GRID_SCAN_BLOCK_SIZE in Config.hlsli
+static const uint32_t kGridMinCellCount     = kGridScanBlockSize;
+static const uint32_t kGridMaxCellCount     = kGridScanBlockSize * kGridScanBlockSize;
+static const uint32_t kGridFishCellStride   = 2 * sizeof(uint32_t); // uint2
+static const uint32_t kGridSortedFishStride = 32;                   // SortedFish in Flocking.hlsli
 
 static uint32_t PreviousFrameIndex(uint32_t frameIndex, uint32_t numFrameInFlights)
 {
@@ -25,6 +35,41 @@ static uint32_t PreviousFrameIndex(uint32_t frameIndex, uint32_t numFrameInFligh
     return previousFrameIndex;
 }
 
+// About one cell per fish, most cells are empty since the flock is sparse.
+static uint32_t GetGridCellCount(uint32_t fishCount)
+{
+    uint32_t cellCount = kGridMinCellCount;
+    while ((cellCount < fishCount) && (cellCount < kGridMaxCellCount)) {
+        cellCount <<= 1;
+    }
+    return cellCount;
+}
+
+static void CreateGridBuffer(grfx::Device* pDevice, uint32_t elementCount, uint32_t elementStride, grfx::Buffer** ppBuffer)
+{
+    grfx::BufferCreateInfo createInfo             = {};
+    createInfo.size                               = std::max<uint64_t>(elementCount * elementStride, PPX_MINIMUM_STRUCTURED_BUFFER_SIZE);
+    createInfo.structuredElementStride            = elementStride;
+    createInfo.usageFlags.bits.transferDst        = true;
+    createInfo.usageFlags.bits.roStructuredBuffer = true;
+    createInfo.usageFlags.bits.rwStructuredBuffer = true;
+    createInfo.memoryUsage                        = grfx::MEMORY_USAGE_GPU_ONLY;
+    createInfo.initialState                       = grfx::RESOURCE_STATE_GENERAL;
+    PPX_CHECKED_CALL(pDevice->CreateBuffer(&createInfo, ppBuffer));
+}
+
+static void UpdateStructuredBuffer(grfx::DescriptorSet* pSet, uint32_t binding, grfx::DescriptorType type, grfx::Buffer* pBuffer)
+{
+    grfx::WriteDescriptor write  = {};
+    write.binding                = binding;
+    write.type                   = type;
+    write.bufferOffset           = 0;
+    write.bufferRange            = PPX_WHOLE_SIZE;
+    write.structuredElementCount = static_cast<uint32_t>(pBuffer->GetSize() / pBuffer->GetStructuredElementStride());
+    write.pBuffer                = pBuffer;
+    PPX_CHECKED_CALL(pSet->UpdateDescriptors(1, &write));
+}
+
 // -------------------------------------------------------------------------------------------------
 // Flocking
 // -------------------------------------------------------------------------------------------------
@@ -107,6 +152,48 @@ void Flocking::SetupSetLayouts()
     createInfo.bindings.push_back(grfx::DescriptorBinding{RENDER_OUTPUT_VELOCITY_TEXTURE_REGISTER, grfx::DESCRIPTOR_TYPE_STORAGE_IMAGE});   // u3
     PPX_CHECKED_CALL(device->CreateDescriptorSetLayout(&createInfo, &mFlockingVelocitySetLayout));
 
+    // See FlockingGridCount.hlsl
+    //
+    createInfo = {};
+    createInfo.bindings.push_back(grfx::DescriptorBinding{RENDER_FLOCKING_DATA_REGISTER, grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER});            // b11
+    createInfo.bindings.push_back(grfx::DescriptorBinding{RENDER_PREVIOUS_POSITION_TEXTURE_REGISTER, grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE}); // t12
+    createInfo.bindings.push_back(grfx::DescriptorBinding{FLOCKING_GRID_FISH_CELLS_REGISTER, grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER});  // u18
+    createInfo.bindings.push_back(grfx::DescriptorBinding{FLOCKING_GRID_CELL_COUNTS_REGISTER, grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER}); // u19
+    PPX_CHECKED_CALL(device->CreateDescriptorSetLayout(&createInfo, &mGridCountSetLayout));
+
+    // See FlockingGridScan.hlsl
+    //
+    createInfo = {};
+    createInfo.bindings.push_back(grfx::DescriptorBinding{FLOCKING_GRID_SCAN_INPUT_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER});  // t20
+    createInfo.bindings.push_back(grfx::DescriptorBinding{FLOCKING_GRID_SCAN_OUTPUT_REGISTER, grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER}); // u21
+    createInfo.bindings.push_back(grfx::DescriptorBinding{FLOCKING_GRID_SCAN_SUMS_REGISTER, grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER});   // u22
+    PPX_CHECKED_CALL(device->CreateDescriptorSetLayout(&createInfo, &mGridScanSetLayout));
+
+    // See FlockingGridScatter.hlsl
+    //
+    createInfo = {};
+    createInfo.bindings.push_back(grfx::DescriptorBinding{RENDER_FLOCKING_DATA_REGISTER, grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER});              // b11
+    createInfo.bindings.push_back(grfx::DescriptorBinding{RENDER_PREVIOUS_POSITION_TEXTURE_REGISTER, grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE});   // t12
+    createInfo.bindings.push_back(grfx::DescriptorBinding{RENDER_PREVIOUS_VELOCITY_TEXTURE_REGISTER, grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE});   // t14
+    createInfo.bindings.push_back(grfx::DescriptorBinding{FLOCKING_GRID_FISH_CELLS_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER});    // t18
+    createInfo.bindings.push_back(grfx::DescriptorBinding{FLOCKING_GRID_CELL_STARTS_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER});   // t23
+    createInfo.bindings.push_back(grfx::DescriptorBinding{FLOCKING_GRID_BLOCK_OFFSETS_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER}); // t24
+    createInfo.bindings.push_back(grfx::DescriptorBinding{FLOCKING_GRID_SORTED_FISH_REGISTER, grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER});   // u25
+    PPX_CHECKED_CALL(device->CreateDescriptorSetLayout(&createInfo, &mGridScatterSetLayout));
+
+    // See FlockingVelocityGrid.hlsl
+    //
+    createInfo = {};
+    createInfo.bindings.push_back(grfx::DescriptorBinding{RENDER_FLOCKING_DATA_REGISTER, grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER});              // b11
+    createInfo.bindings.push_back(grfx::DescriptorBinding{RENDER_PREVIOUS_POSITION_TEXTURE_REGISTER, grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE});   // t12
+    createInfo.bindings.push_back(grfx::DescriptorBinding{RENDER_PREVIOUS_VELOCITY_TEXTURE_REGISTER, grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE});   // t14
+    createInfo.bindings.push_back(grfx::DescriptorBinding{RENDER_OUTPUT_VELOCITY_TEXTURE_REGISTER, grfx::DESCRIPTOR_TYPE_STORAGE_IMAGE});     // u17
+    createInfo.bindings.push_back(grfx::DescriptorBinding{FLOCKING_GRID_CELL_COUNTS_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER});   // t19
+    createInfo.bindings.push_back(grfx::DescriptorBinding{FLOCKING_GRID_CELL_STARTS_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER});   // t23
+    createInfo.bindings.push_back(grfx::DescriptorBinding{FLOCKING_GRID_BLOCK_OFFSETS_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER}); // t24
+    createInfo.bindings.push_back(grfx::DescriptorBinding{FLOCKING_GRID_SORTED_FISH_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER});   // t25
+    PPX_CHECKED_CALL(device->CreateDescriptorSetLayout(&createInfo, &mVelocityGridSetLayout));
+
     // See FlockingRender.hlsl
     createInfo = {};
     createInfo.bindings.push_back(grfx::DescriptorBinding{RENDER_FLOCKING_DATA_REGISTER, grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER});            // b0
@@ -144,6 +231,42 @@ void Flocking::SetupSets()
         PPX_CHECKED_CALL(frame.velocitySet->UpdateSampledImage(RENDER_PREVIOUS_VELOCITY_TEXTURE_REGISTER, 0, prevFrame.velocityTexture));
         PPX_CHECKED_CALL(frame.velocitySet->UpdateStorageImage(RENDER_OUTPUT_VELOCITY_TEXTURE_REGISTER, 0, frame.velocityTexture));
 
+        PPX_CHECKED_CALL(device->AllocateDescriptorSet(pool, mGridCountSetLayout, &frame.gridCountSet));
+        PPX_CHECKED_CALL(frame.gridCountSet->UpdateUniformBuffer(RENDER_FLOCKING_DATA_REGISTER, 0, frame.flockingConstants.GetGpuBuffer()));
+        PPX_CHECKED_CALL(frame.gridCountSet->UpdateSampledImage(RENDER_PREVIOUS_POSITION_TEXTURE_REGISTER, 0, prevFrame.positionTexture));
+        UpdateStructuredBuffer(frame.gridCountSet, FLOCKING_GRID_FISH_CELLS_REGISTER, grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER, frame.gridFishCells);
+        UpdateStructuredBuffer(frame.gridCountSet, FLOCKING_GRID_CELL_COUNTS_REGISTER, grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER, frame.gridCellCounts);
+
+        // Cell counts to cell starts within blocks, block totals to block offsets
+        PPX_CHECKED_CALL(device->AllocateDescriptorSet(pool, mGridScanSetLayout, &frame.gridScanCellsSet));
+        UpdateStructuredBuffer(frame.gridScanCellsSet, FLOCKING_GRID_SCAN_INPUT_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER, frame.gridCellCounts);
+        UpdateStructuredBuffer(frame.gridScanCellsSet, FLOCKING_GRID_SCAN_OUTPUT_REGISTER, grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER, frame.gridCellStarts);
+        UpdateStructuredBuffer(frame.gridScanCellsSet, FLOCKING_GRID_SCAN_SUMS_REGISTER, grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER, frame.gridBlockSums);
+
+        PPX_CHECKED_CALL(device->AllocateDescriptorSet(pool, mGridScanSetLayout, &frame.gridScanBlocksSet));
+        UpdateStructuredBuffer(frame.gridScanBlocksSet, FLOCKING_GRID_SCAN_INPUT_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER, frame.gridBlockSums);
+        UpdateStructuredBuffer(frame.gridScanBlocksSet, FLOCKING_GRID_SCAN_OUTPUT_REGISTER, grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER, frame.gridBlockOffsets);
+        UpdateStructuredBuffer(frame.gridScanBlocksSet, FLOCKING_GRID_SCAN_SUMS_REGISTER, grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER, frame.gridTotalSum);
+
+        PPX_CHECKED_CALL(device->AllocateDescriptorSet(pool, mGridScatterSetLayout, &frame.gridScatterSet));
+        PPX_CHECKED_CALL(frame.gridScatterSet->UpdateUniformBuffer(RENDER_FLOCKING_DATA_REGISTER, 0, frame.flockingConstants.GetGpuBuffer()));
+        PPX_CHECKED_CALL(frame.gridScatterSet->UpdateSampledImage(RENDER_PREVIOUS_POSITION_TEXTURE_REGISTER, 0, prevFrame.positionTexture));
+        PPX_CHECKED_CALL(frame.gridScatterSet->UpdateSampledImage(RENDER_PREVIOUS_VELOCITY_TEXTURE_REGISTER, 0, prevFrame.velocityTexture));
+        UpdateStructuredBuffer(frame.gridScatterSet, FLOCKING_GRID_FISH_CELLS_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER, frame.gridFishCells);
+        UpdateStructuredBuffer(frame.gridScatterSet, FLOCKING_GRID_CELL_STARTS_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER, frame.gridCellStarts);
+        UpdateStructuredBuffer(frame.gridScatterSet, FLOCKING_GRID_BLOCK_OFFSETS_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER, frame.gridBlockOffsets);
+        UpdateStructuredBuffer(frame.gridScatterSet, FLOCKING_GRID_SORTED_FISH_REGISTER, grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER, frame.gridSortedFish);
+
+        PPX_CHECKED_CALL(device->AllocateDescriptorSet(pool, mVelocityGridSetLayout, &frame.velocityGridSet));
+        PPX_CHECKED_CALL(frame.velocityGridSet->UpdateUniformBuffer(RENDER_FLOCKING_DATA_REGISTER, 0, frame.flockingConstants.GetGpuBuffer()));
+        PPX_CHECKED_CALL(frame.velocityGridSet->UpdateSampledImage(RENDER_PREVIOUS_POSITION_TEXTURE_REGISTER, 0, prevFrame.positionTexture));
+        PPX_CHECKED_CALL(frame.velocityGridSet->UpdateSampledImage(RENDER_PREVIOUS_VELOCITY_TEXTURE_REGISTER, 0, prevFrame.velocityTexture));
+        PPX_CHECKED_CALL(frame.velocityGridSet->UpdateStorageImage(RENDER_OUTPUT_VELOCITY_TEXTURE_REGISTER, 0, frame.velocityTexture));
+        UpdateStructuredBuffer(frame.velocityGridSet, FLOCKING_GRID_CELL_COUNTS_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER, frame.gridCellCounts);
+        UpdateStructuredBuffer(frame.velocityGridSet, FLOCKING_GRID_CELL_STARTS_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER, frame.gridCellStarts);
+        UpdateStructuredBuffer(frame.velocityGridSet, FLOCKING_GRID_BLOCK_OFFSETS_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER, frame.gridBlockOffsets);
+        UpdateStructuredBuffer(frame.velocityGridSet, FLOCKING_GRID_SORTED_FISH_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER, frame.gridSortedFish);
+
         PPX_CHECKED_CALL(device->AllocateDescriptorSet(pool, mRenderSetLayout, &frame.renderSet));
         PPX_CHECKED_CALL(frame.renderSet->UpdateUniformBuffer(RENDER_FLOCKING_DATA_REGISTER, 0, frame.flockingConstants.GetGpuBuffer()));
         PPX_CHECKED_CALL(frame.renderSet->UpdateSampledImage(RENDER_PREVIOUS_POSITION_TEXTURE_REGISTER, 0, prevFrame.positionTexture));
@@ -183,6 +306,9 @@ void Flocking::SetupPipelineInterfaces()
     createInfo.sets[2].pLayout                   = pApp->GetMaterialSetLayout();
     createInfo.sets[3].set                       = 3;
     createInfo.sets[3].pLayout                   = mRenderSetLayout;
+    createInfo.pushConstants.count               = 1;
+    createInfo.pushConstants.binding             = RENDER_FLOCKING_DRAW_DATA_REGISTER;
+    createInfo.pushConstants.set                 = 3;
     PPX_CHECKED_CALL(device->CreatePipelineInterface(&createInfo, &mForwardPipelineInterface));
 
     // [set0] : resources for position and velocity calculations
@@ -200,6 +326,23 @@ void Flocking::SetupPipelineInterfaces()
     createInfo.sets[0].set     = 0;
     createInfo.sets[0].pLayout = mFlockingVelocitySetLayout;
     PPX_CHECKED_CALL(device->CreatePipelineInterface(&createInfo, &mFlockingVelocityPipelineInterface));
+
+    // [set0] : resources for the grid passes
+    //
+    createInfo                 = {};
+    createInfo.setCount        = 1;
+    createInfo.sets[0].set     = 0;
+    createInfo.sets[0].pLayout = mGridCountSetLayout;
+    PPX_CHECKED_CALL(device->CreatePipelineInterface(&createInfo, &mGridCountPipelineInterface));
+
+    createInfo.sets[0].pLayout = mGridScanSetLayout;
+    PPX_CHECKED_CALL(device->CreatePipelineInterface(&createInfo, &mGridScanPipelineInterface));
+
+    createInfo.sets[0].pLayout = mGridScatterSetLayout;
+    PPX_CHECKED_CALL(device->CreatePipelineInterface(&createInfo, &mGridScatterPipelineInterface));
+
+    createInfo.sets[0].pLayout = mVelocityGridSetLayout;
+    PPX_CHECKED_CALL(device->CreatePipelineInterface(&createInfo, &mVelocityGridPipelineInterface));
 }
 
 void Flocking::SetupPipelines()
@@ -233,6 +376,35 @@ void Flocking::SetupPipelines()
         device->DestroyShaderModule(CS);
     }
 
+    // Flocking grid and grid velocity
+    {
+        struct GridPipeline
+        {
+            const char*              shaderName;
+            grfx::PipelineInterface* pPipelineInterface;
+            grfx::ComputePipeline**  ppPipeline;
+        };
+
+        const GridPipeline gridPipelines[] = {
+            {"FlockingGridCount.cs", mGridCountPipelineInterface, &mGridCountPipeline},
+            {"FlockingGridScan.cs", mGridScanPipelineInterface, &mGridScanPipeline},
+            {"FlockingGridScatter.cs", mGridScatterPipelineInterface, &mGridScatterPipeline},
+            {"FlockingVelocityGrid.cs", mVelocityGridPipelineInterface, &mVelocityGridPipeline},
+        };
+
+        for (const GridPipeline& gridPipeline : gridPipelines) {
+            grfx::ShaderModulePtr CS;
+
+            PPX_CHECKED_CALL(pApp->CreateShader("fishtornado/shaders", gridPipeline.shaderName, &CS));
+            grfx::ComputePipelineCreateInfo createInfo = {};
+            createInfo.CS                              = {CS, "csmain"};
+            createInfo.pPipelineInterface              = gridPipeline.pPipelineInterface;
+            PPX_CHECKED_CALL(device->CreateComputePipeline(&createInfo, gridPipeline.ppPipeline));
+
+            device->DestroyShaderModule(CS);
+        }
+    }
+
     // Foward
     mForwardPipeline = pApp->CreateForwardPipeline("fishtornado/shaders", "FlockingRender.vs", "FlockingRender.ps", mForwardPipelineInterface);
 
@@ -280,6 +452,23 @@ void Flocking::Setup(uint32_t numFramesInFlight, const FishTornadoSettings& sett
 
         PPX_CHECKED_CALL(device->AllocateDescriptorSet(pool, mFlockingPositionSetLayout, &frame.positionSet));
         PPX_CHECKED_CALL(device->AllocateDescriptorSet(pool, mFlockingVelocitySetLayout, &frame.velocitySet));
+
+        grfx::QueryCreateInfo queryCreateInfo = {};
+        queryCreateInfo.type                  = grfx::QUERY_TYPE_TIMESTAMP;
+        queryCreateInfo.count                 = 1;
+        PPX_CHECKED_CALL(device->CreateQuery(&queryCreateInfo, &frame.startTimestampQuery));
+        PPX_CHECKED_CALL(device->CreateQuery(&queryCreateInfo, &frame.endTimestampQuery));
+    }
+
+    // Grid buffers are always created so the algorithm can be switched at runtime
+    SetupGridBuffers();
+
+    // The CPU and GPU flocks diverge, so the backend is chosen at startup
+    mUseCpuFlocking = settings.useCpuFlocking;
+    if (mUseCpuFlocking) {
+        mJobSystem.Initialize(JobSystem::GetDefaultWorkerCount());
+        mCpuFlocking.Initialize(positionData, velocityData, &mJobSystem);
+        SetupCpuStagingBuffers();
     }
 
     // Create model
@@ -300,6 +489,62 @@ void Flocking::Setup(uint32_t numFramesInFlight, const FishTornadoSettings& sett
     SetupSets();
 }
 
+void Flocking::SetupGridBuffers()
+{
+    grfx::DevicePtr device = FishTornadoApp::GetThisApp()->GetDevice();
+
+    const uint32_t fishCount = mResX * mResY;
+    mGridCellCount           = GetGridCellCount(fishCount);
+    mGridBlockCount          = mGridCellCount / kGridScanBlockSize;
+
+    for (size_t i = 0; i < mPerFrame.size(); ++i) {
+        PerFrame& frame = mPerFrame[i];
+        CreateGridBuffer(device, fishCount, kGridFishCellStride, &frame.gridFishCells);
+        CreateGridBuffer(device, mGridCellCount, sizeof(uint32_t), &frame.gridCellCounts);
+        CreateGridBuffer(device, mGridCellCount, sizeof(uint32_t), &frame.gridCellStarts);
+        CreateGridBuffer(device, mGridBlockCount, sizeof(uint32_t), &frame.gridBlockSums);
+        CreateGridBuffer(device, mGridBlockCount, sizeof(uint32_t), &frame.gridBlockOffsets);
+        CreateGridBuffer(device, 1, sizeof(uint32_t), &frame.gridTotalSum);
+        CreateGridBuffer(device, fishCount, kGridSortedFishStride, &frame.gridSortedFish);
+    }
+
+    // Source of the cell count clears
+    grfx::BufferCreateInfo createInfo      = {};
+    createInfo.size                        = mGridCellCount * sizeof(uint32_t);
+    createInfo.usageFlags.bits.transferSrc = true;
+    createInfo.memoryUsage                 = grfx::MEMORY_USAGE_CPU_TO_GPU;
+    createInfo.initialState                = grfx::RESOURCE_STATE_COPY_SRC;
+    PPX_CHECKED_CALL(device->CreateBuffer(&createInfo, &mGridZeroBuffer));
+
+    void* pMappedAddress = nullptr;
+    PPX_CHECKED_CALL(mGridZeroBuffer->MapMemory(0, &pMappedAddress));
+    memset(pMappedAddress, 0, static_cast<size_t>(mGridZeroBuffer->GetSize()));
+    mGridZeroBuffer->UnmapMemory();
+}
+
+void Flocking::SetupCpuStagingBuffers()
+{
+    grfx::DevicePtr device = FishTornadoApp::GetThisApp()->GetDevice();
+
+    // Velocity rows followed by position rows, in the texture layout. D3D12
+    // requires aligned rows and footprints.
+    const bool dx12           = grfx::IsDx12(device->GetApi());
+    mCpuStagingRowStride      = RoundUp<uint32_t>(mResX * sizeof(float4), dx12 ? PPX_D3D12_TEXTURE_DATA_PITCH_ALIGNMENT : 1);
+    mCpuStagingPositionOffset = RoundUp<uint64_t>(mCpuStagingRowStride * mResY, dx12 ? PPX_D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT : 1);
+
+    for (size_t i = 0; i < mPerFrame.size(); ++i) {
+        PerFrame& frame = mPerFrame[i];
+
+        grfx::BufferCreateInfo createInfo      = {};
+        createInfo.size                        = mCpuStagingPositionOffset + mCpuStagingRowStride * mResY;
+        createInfo.usageFlags.bits.transferSrc = true;
+        createInfo.memoryUsage                 = grfx::MEMORY_USAGE_CPU_TO_GPU;
+        createInfo.initialState                = grfx::RESOURCE_STATE_COPY_SRC;
+        PPX_CHECKED_CALL(device->CreateBuffer(&createInfo, &frame.cpuStagingBuffer));
+        PPX_CHECKED_CALL(frame.cpuStagingBuffer->MapMemory(0, &frame.pCpuStagingAddress));
+    }
+}
+
 void Flocking::Shutdown()
 {
     grfx::DevicePtr device = FishTornadoApp::GetThisApp()->GetDevice();
@@ -310,8 +555,24 @@ void Flocking::Shutdown()
         frame.flockingConstants.Destroy();
         device->DestroyTexture(frame.positionTexture);
         device->DestroyTexture(frame.velocityTexture);
+        device->DestroyBuffer(frame.gridFishCells);
+        device->DestroyBuffer(frame.gridCellCounts);
+        device->DestroyBuffer(frame.gridCellStarts);
+        device->DestroyBuffer(frame.gridBlockSums);
+        device->DestroyBuffer(frame.gridBlockOffsets);
+        device->DestroyBuffer(frame.gridTotalSum);
+        device->DestroyBuffer(frame.gridSortedFish);
+        device->DestroyQuery(frame.startTimestampQuery);
+        device->DestroyQuery(frame.endTimestampQuery);
+        if (frame.cpuStagingBuffer) {
+            frame.cpuStagingBuffer->UnmapMemory();
+            device->DestroyBuffer(frame.cpuStagingBuffer);
+        }
     }
 
+    mJobSystem.Shutdown();
+
+    device->DestroyBuffer(mGridZeroBuffer);
     mMaterialConstants.Destroy();
 }
 
@@ -342,6 +603,25 @@ void Flocking::Update(uint32_t frameIndex)
         pFlockingData->timeDelta          = dt;
         pFlockingData->predPos            = pApp->GetShark()->GetPosition();
         pFlockingData->camPos             = pApp->GetCamera()->GetEyePosition();
+        pFlockingData->gridCellCount      = mGridCellCount;
+    }
+
+    if (mUseCpuFlocking) {
+        CpuFlockingParams params = {};
+        params.minThresh         = mMinThresh;
+        params.maxThresh         = mMaxThresh;
+        params.minSpeed          = mMinSpeed;
+        params.maxSpeed          = mMaxSpeed;
+        params.zoneRadius        = mZoneRadius;
+        params.time              = t;
+        params.timeDelta         = dt;
+        params.predPos           = pApp->GetShark()->GetPosition();
+        params.camPos            = pApp->GetCamera()->GetEyePosition();
+
+        Timer timer;
+        timer.Start();
+        mCpuFlocking.Step(params);
+        mCpuStepTimeMs = timer.MillisSinceStart();
     }
 }
 
@@ -384,16 +664,134 @@ void Flocking::BeginCompute(uint32_t frameIndex, grfx::CommandBuffer* pCmd, bool
 {
     PerFrame& frame = mPerFrame[frameIndex];
 
+    frame.computedWithAsyncCompute = asyncCompute;
+
     // Acquire from graphics queue to compute queue.
     if (asyncCompute && frame.renderedWithAsyncCompute) {
-        FishTornadoApp* pApp = FishTornadoApp::GetThisApp();
+        const AsyncComputeScheduler& scheduler = FishTornadoApp::GetThisApp()->GetAsyncCompute();
 
-        pCmd->TransitionImageLayout(frame.velocityTexture, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_SHADER_RESOURCE, pApp->GetGraphicsQueue(), pApp->GetComputeQueue());
-        pCmd->TransitionImageLayout(frame.positionTexture, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_SHADER_RESOURCE, pApp->GetGraphicsQueue(), pApp->GetComputeQueue());
+        scheduler.AcquireFromGraphics(pCmd, frame.velocityTexture->GetImage(), grfx::RESOURCE_STATE_SHADER_RESOURCE);
+        scheduler.AcquireFromGraphics(pCmd, frame.positionTexture->GetImage(), grfx::RESOURCE_STATE_SHADER_RESOURCE);
     }
 }
 
-void Flocking::Compute(uint32_t frameIndex, grfx::CommandBuffer* pCmd)
+void Flocking::ComputeGrid(PerFrame& frame, grfx::CommandBuffer* pCmd)
+{
+    uint32_t groupCountX = mResX / mThreadsX;
+    uint32_t groupCountY = mResY / mThreadsY;
+    uint32_t groupCountZ = 1;
+
+    // Grid buffers are left in the shader resource state once written, so
+    // only their first use starts from the creation state. There are no
+    // dependencies between writes to the same buffer within a frame.
+    grfx::ResourceState idleState = frame.gridBuffersUsed ? grfx::RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE : grfx::RESOURCE_STATE_GENERAL;
+    frame.gridBuffersUsed         = true;
+
+    // Clear cell counts
+    {
+        pCmd->BufferResourceBarrier(frame.gridCellCounts, idleState, grfx::RESOURCE_STATE_COPY_DST);
+
+        grfx::BufferToBufferCopyInfo copyInfo = {};
+        copyInfo.size                         = mGridCellCount * sizeof(uint32_t);
+
+        pCmd->CopyBufferToBuffer(&copyInfo, mGridZeroBuffer, frame.gridCellCounts);
+
+        pCmd->BufferResourceBarrier(frame.gridCellCounts, grfx::RESOURCE_STATE_COPY_DST, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    }
+
+    // Count fish per cell
+    {
+        pCmd->BufferResourceBarrier(frame.gridFishCells, idleState, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+
+        pCmd->BindComputeDescriptorSets(mGridCountPipelineInterface, 1, &frame.gridCountSet);
+        pCmd->BindComputePipeline(mGridCountPipeline);
+        pCmd->Dispatch(groupCountX, groupCountY, groupCountZ);
+
+        pCmd->BufferResourceBarrier(frame.gridFishCells, grfx::RESOURCE_STATE_UNORDERED_ACCESS, grfx::RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        pCmd->BufferResourceBarrier(frame.gridCellCounts, grfx::RESOURCE_STATE_UNORDERED_ACCESS, grfx::RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    }
+
+    // Prefix sum of the cell counts
+    {
+        pCmd->BindComputePipeline(mGridScanPipeline);
+
+        // Within blocks
+        pCmd->BufferResourceBarrier(frame.gridCellStarts, idleState, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+        pCmd->BufferResourceBarrier(frame.gridBlockSums, idleState, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+
+        pCmd->BindComputeDescriptorSets(mGridScanPipelineInterface, 1, &frame.gridScanCellsSet);
+        pCmd->Dispatch(mGridBlockCount, 1, 1);
+
+        pCmd->BufferResourceBarrier(frame.gridCellStarts, grfx::RESOURCE_STATE_UNORDERED_ACCESS, grfx::RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        pCmd->BufferResourceBarrier(frame.gridBlockSums, grfx::RESOURCE_STATE_UNORDERED_ACCESS, grfx::RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+        // Block offsets, all blocks fit in one group
+        pCmd->BufferResourceBarrier(frame.gridBlockOffsets, idleState, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+        pCmd->BufferResourceBarrier(frame.gridTotalSum, idleState, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+
+        pCmd->BindComputeDescriptorSets(mGridScanPipelineInterface, 1, &frame.gridScanBlocksSet);
+        pCmd->Dispatch(1, 1, 1);
+
+        pCmd->BufferResourceBarrier(frame.gridBlockOffsets, grfx::RESOURCE_STATE_UNORDERED_ACCESS, grfx::RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        pCmd->BufferResourceBarrier(frame.gridTotalSum, grfx::RESOURCE_STATE_UNORDERED_ACCESS, grfx::RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    }
+
+    // Sort fish by cell
+    {
+        pCmd->BufferResourceBarrier(frame.gridSortedFish, idleState, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+
+        pCmd->BindComputeDescriptorSets(mGridScatterPipelineInterface, 1, &frame.gridScatterSet);
+        pCmd->BindComputePipeline(mGridScatterPipeline);
+        pCmd->Dispatch(groupCountX, groupCountY, groupCountZ);
+
+        pCmd->BufferResourceBarrier(frame.gridSortedFish, grfx::RESOURCE_STATE_UNORDERED_ACCESS, grfx::RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    }
+}
+
+void Flocking::UploadCpuFlocking(PerFrame& frame, grfx::CommandBuffer* pCmd)
+{
+    // The frame's previous commands have completed, so its staging buffer can
+    // be overwritten.
+    char* pStaging = static_cast<char*>(frame.pCpuStagingAddress);
+    mCpuFlocking.WriteVelocities(pStaging, mCpuStagingRowStride);
+    mCpuFlocking.WritePositions(pStaging + mCpuStagingPositionOffset, mCpuStagingRowStride);
+
+    grfx::BufferToImageCopyInfo copyInfo = {};
+    copyInfo.srcBuffer.imageWidth        = mResX;
+    copyInfo.srcBuffer.imageHeight       = mResY;
+    copyInfo.srcBuffer.imageRowStride    = mCpuStagingRowStride;
+    copyInfo.srcBuffer.footprintOffset   = 0;
+    copyInfo.srcBuffer.footprintWidth    = mResX;
+    copyInfo.srcBuffer.footprintHeight   = mResY;
+    copyInfo.srcBuffer.footprintDepth    = 1;
+    copyInfo.dstImage.mipLevel           = 0;
+    copyInfo.dstImage.arrayLayer         = 0;
+    copyInfo.dstImage.arrayLayerCount    = 1;
+    copyInfo.dstImage.x                  = 0;
+    copyInfo.dstImage.y                  = 0;
+    copyInfo.dstImage.z                  = 0;
+    copyInfo.dstImage.width              = mResX;
+    copyInfo.dstImage.height             = mResY;
+    copyInfo.dstImage.depth              = 1;
+
+    // Velocity
+    {
+        pCmd->TransitionImageLayout(frame.velocityTexture, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_COPY_DST);
+        pCmd->CopyBufferToImage(&copyInfo, frame.cpuStagingBuffer, frame.velocityTexture->GetImage());
+        pCmd->TransitionImageLayout(frame.velocityTexture, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_COPY_DST, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    }
+
+    // Position
+    {
+        copyInfo.srcBuffer.footprintOffset = mCpuStagingPositionOffset;
+
+        pCmd->TransitionImageLayout(frame.positionTexture, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_COPY_DST);
+        pCmd->CopyBufferToImage(&copyInfo, frame.cpuStagingBuffer, frame.positionTexture->GetImage());
+        pCmd->TransitionImageLayout(frame.positionTexture, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_COPY_DST, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    }
+}
+
+void Flocking::Compute(uint32_t frameIndex, grfx::CommandBuffer* pCmd, bool useGrid)
 {
     uint32_t groupCountX = mResX / mThreadsX;
     uint32_t groupCountY = mResY / mThreadsY;
@@ -401,12 +799,38 @@ void Flocking::Compute(uint32_t frameIndex, grfx::CommandBuffer* pCmd)
 
     PerFrame& frame = mPerFrame[frameIndex];
 
+    frame.startTimestampQuery->Reset(0, 1);
+    frame.endTimestampQuery->Reset(0, 1);
+    pCmd->WriteTimestamp(frame.startTimestampQuery, grfx::PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0);
+
+    if (mUseCpuFlocking) {
+        UploadCpuFlocking(frame, pCmd);
+
+        pCmd->WriteTimestamp(frame.endTimestampQuery, grfx::PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+        pCmd->ResolveQueryData(frame.startTimestampQuery, 0, 1);
+        pCmd->ResolveQueryData(frame.endTimestampQuery, 0, 1);
+
+        frame.timestampsWritten = true;
+        frame.computedWithGrid  = false;
+        return;
+    }
+
+    if (useGrid) {
+        ComputeGrid(frame, pCmd);
+    }
+
     // Velocity
     {
         pCmd->TransitionImageLayout(frame.velocityTexture, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_GENERAL);
 
-        pCmd->BindComputeDescriptorSets(mFlockingVelocityPipelineInterface, 1, &frame.velocitySet);
-        pCmd->BindComputePipeline(mFlockingVelocityPipeline);
+        if (useGrid) {
+            pCmd->BindComputeDescriptorSets(mVelocityGridPipelineInterface, 1, &frame.velocityGridSet);
+            pCmd->BindComputePipeline(mVelocityGridPipeline);
+        }
+        else {
+            pCmd->BindComputeDescriptorSets(mFlockingVelocityPipelineInterface, 1, &frame.velocitySet);
+            pCmd->BindComputePipeline(mFlockingVelocityPipeline);
+        }
         pCmd->Dispatch(groupCountX, groupCountY, groupCountZ);
 
         pCmd->TransitionImageLayout(frame.velocityTexture, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_GENERAL, grfx::RESOURCE_STATE_SHADER_RESOURCE);
@@ -422,16 +846,23 @@ void Flocking::Compute(uint32_t frameIndex, grfx::CommandBuffer* pCmd)
 
         pCmd->TransitionImageLayout(frame.positionTexture, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_GENERAL, grfx::RESOURCE_STATE_SHADER_RESOURCE);
     }
+
+    pCmd->WriteTimestamp(frame.endTimestampQuery, grfx::PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+    pCmd->ResolveQueryData(frame.startTimestampQuery, 0, 1);
+    pCmd->ResolveQueryData(frame.endTimestampQuery, 0, 1);
+
+    frame.timestampsWritten = true;
+    frame.computedWithGrid  = useGrid;
 }
 
 void Flocking::EndCompute(uint32_t frameIndex, grfx::CommandBuffer* pCmd, bool asyncCompute)
 {
     // Release from compute queue to graphics queue.
     if (asyncCompute) {
-        FishTornadoApp* pApp  = FishTornadoApp::GetThisApp();
-        PerFrame&       frame = mPerFrame[frameIndex];
-        pCmd->TransitionImageLayout(frame.velocityTexture, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_SHADER_RESOURCE, pApp->GetComputeQueue(), pApp->GetGraphicsQueue());
-        pCmd->TransitionImageLayout(frame.positionTexture, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_SHADER_RESOURCE, pApp->GetComputeQueue(), pApp->GetGraphicsQueue());
+        const AsyncComputeScheduler& scheduler = FishTornadoApp::GetThisApp()->GetAsyncCompute();
+        PerFrame&                    frame     = mPerFrame[frameIndex];
+        scheduler.ReleaseToGraphics(pCmd, frame.velocityTexture->GetImage(), grfx::RESOURCE_STATE_SHADER_RESOURCE);
+        scheduler.ReleaseToGraphics(pCmd, frame.positionTexture->GetImage(), grfx::RESOURCE_STATE_SHADER_RESOURCE);
     }
 }
 
@@ -439,10 +870,10 @@ void Flocking::BeginGraphics(uint32_t frameIndex, grfx::CommandBuffer* pCmd, boo
 {
     // Acquire from compute queue to graphics queue.
     if (asyncCompute) {
-        FishTornadoApp* pApp  = FishTornadoApp::GetThisApp();
-        PerFrame&       frame = mPerFrame[frameIndex];
-        pCmd->TransitionImageLayout(frame.velocityTexture, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_SHADER_RESOURCE, pApp->GetComputeQueue(), pApp->GetGraphicsQueue());
-        pCmd->TransitionImageLayout(frame.positionTexture, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_SHADER_RESOURCE, pApp->GetComputeQueue(), pApp->GetGraphicsQueue());
+        const AsyncComputeScheduler& scheduler = FishTornadoApp::GetThisApp()->GetAsyncCompute();
+        PerFrame&                    frame     = mPerFrame[frameIndex];
+        scheduler.AcquireFromCompute(pCmd, frame.velocityTexture->GetImage(), grfx::RESOURCE_STATE_SHADER_RESOURCE);
+        scheduler.AcquireFromCompute(pCmd, frame.positionTexture->GetImage(), grfx::RESOURCE_STATE_SHADER_RESOURCE);
     }
 }
 
@@ -452,6 +883,15 @@ void Flocking::DrawDebug(uint32_t frameIndex, grfx::CommandBuffer* pCmd)
 
 void Flocking::DrawShadow(uint32_t frameIndex, grfx::CommandBuffer* pCmd)
 {
+    DrawShadow(frameIndex, pCmd, 0, GetInstanceCount());
+}
+
+void Flocking::DrawShadow(uint32_t frameIndex, grfx::CommandBuffer* pCmd, uint32_t firstInstance, uint32_t instanceCount)
+{
+    if (instanceCount == 0) {
+        return;
+    }
+
     FishTornadoApp* pApp = FishTornadoApp::GetThisApp();
 
     PerFrame& frame = mPerFrame[frameIndex];
@@ -466,13 +906,26 @@ void Flocking::DrawShadow(uint32_t frameIndex, grfx::CommandBuffer* pCmd)
 
     pCmd->BindGraphicsPipeline(mShadowPipeline);
 
+    // SV_InstanceID does not include the first instance of the draw on
+    // D3D12, the shader adds it from a push constant instead.
+    pCmd->PushGraphicsConstants(mForwardPipelineInterface, 1, &firstInstance);
+
     pCmd->BindIndexBuffer(mMesh);
     pCmd->BindVertexBuffers(mMesh);
-    pCmd->DrawIndexed(mMesh->GetIndexCount(), mResX * mResY);
+    pCmd->DrawIndexed(mMesh->GetIndexCount(), instanceCount);
 }
 
 void Flocking::DrawForward(uint32_t frameIndex, grfx::CommandBuffer* pCmd)
 {
+    DrawForward(frameIndex, pCmd, 0, GetInstanceCount());
+}
+
+void Flocking::DrawForward(uint32_t frameIndex, grfx::CommandBuffer* pCmd, uint32_t firstInstance, uint32_t instanceCount)
+{
+    if (instanceCount == 0) {
+        return;
+    }
+
     PerFrame& frame = mPerFrame[frameIndex];
 
     grfx::DescriptorSet* sets[4] = {nullptr};
@@ -485,9 +938,11 @@ void Flocking::DrawForward(uint32_t frameIndex, grfx::CommandBuffer* pCmd)
 
     pCmd->BindGraphicsPipeline(mForwardPipeline);
 
+    pCmd->PushGraphicsConstants(mForwardPipelineInterface, 1, &firstInstance);
+
     pCmd->BindIndexBuffer(mMesh);
     pCmd->BindVertexBuffers(mMesh);
-    pCmd->DrawIndexed(mMesh->GetIndexCount(), mResX * mResY);
+    pCmd->DrawIndexed(mMesh->GetIndexCount(), instanceCount);
 }
 
 void Flocking::EndGraphics(uint32_t frameIndex, grfx::CommandBuffer* pCmd, bool asyncCompute)
@@ -496,13 +951,39 @@ void Flocking::EndGraphics(uint32_t frameIndex, grfx::CommandBuffer* pCmd, bool
 
     // Release from graphics queue to compute queue.
     if (asyncCompute) {
-        FishTornadoApp* pApp = FishTornadoApp::GetThisApp();
+        const AsyncComputeScheduler& scheduler = FishTornadoApp::GetThisApp()->GetAsyncCompute();
 
-        pCmd->TransitionImageLayout(frame.velocityTexture, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_SHADER_RESOURCE, pApp->GetGraphicsQueue(), pApp->GetComputeQueue());
-        pCmd->TransitionImageLayout(frame.positionTexture, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_SHADER_RESOURCE, pApp->GetGraphicsQueue(), pApp->GetComputeQueue());
+        scheduler.ReleaseToCompute(pCmd, frame.velocityTexture->GetImage(), grfx::RESOURCE_STATE_SHADER_RESOURCE);
+        scheduler.ReleaseToCompute(pCmd, frame.positionTexture->GetImage(), grfx::RESOURCE_STATE_SHADER_RESOURCE);
         frame.renderedWithAsyncCompute = true;
     }
     else {
         frame.renderedWithAsyncCompute = false;
     }
 }
+
+bool Flocking::ReadComputeTime(uint32_t frameIndex)
+{
+    PerFrame& frame = mPerFrame[frameIndex];
+    if (!frame.timestampsWritten) {
+        return false;
+    }
+    frame.timestampsWritten = false;
+
+    uint64_t data[2] = {0, 0};
+    PPX_CHECKED_CALL(frame.startTimestampQuery->GetData(&data[0], 1 * sizeof(uint64_t)));
+    PPX_CHECKED_CALL(frame.endTimestampQuery->GetData(&data[1], 1 * sizeof(uint64_t)));
+
+    // Timestamps are in ticks of the queue that ran the passes
+    FishTornadoApp* pApp      = FishTornadoApp::GetThisApp();
+    grfx::QueuePtr  queue     = frame.computedWithAsyncCompute ? pApp->GetComputeQueue() : pApp->GetGraphicsQueue();
+    uint64_t        frequency = 0;
+    PPX_CHECKED_CALL(queue->GetTimestampFrequency(&frequency));
+    if (frequency == 0) {
+        return false;
+    }
+
+    mComputeTimeMs   = static_cast<double>(data[1] - data[0]) * 1000.0 / static_cast<double>(frequency);
+    mComputeUsedGrid = frame.computedWithGrid;
+    return true;
+}
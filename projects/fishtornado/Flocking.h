@@ -16,9 +16,11 @@
 #define FLOCKING_H
 
 #include "ppx/grfx/grfx_mesh.h"
+#include "ppx/job_system.h"
 using namespace ppx;
 
 #include "Buffer.h"
+#include "CpuFlocking.h"
 
 constexpr uint32_t kDefaultFishResX     = 128;
 constexpr uint32_t kDefaultFishResY     = 128;
@@ -40,20 +42,44 @@ public:
     void CopyConstantsToGpu(uint32_t frameIndex, grfx::CommandBuffer* pCmd);
 
     void BeginCompute(uint32_t frameIndex, grfx::CommandBuffer* pCmd, bool asyncCompute);
-    void Compute(uint32_t frameIndex, grfx::CommandBuffer* pCmd);
+    void Compute(uint32_t frameIndex, grfx::CommandBuffer* pCmd, bool useGrid);
     void EndCompute(uint32_t frameIndex, grfx::CommandBuffer* pCmd, bool asyncCompute);
 
     void BeginGraphics(uint32_t frameIndex, grfx::CommandBuffer* pCmd, bool asyncCompute);
     void DrawDebug(uint32_t frameIndex, grfx::CommandBuffer* pCmd);
+    // Draws all fish, or the instanceCount fish starting at firstInstance so
+    // that the flock can be recorded into several command buffers.
     void DrawShadow(uint32_t frameIndex, grfx::CommandBuffer* pCmd);
+    void DrawShadow(uint32_t frameIndex, grfx::CommandBuffer* pCmd, uint32_t firstInstance, uint32_t instanceCount);
     void DrawForward(uint32_t frameIndex, grfx::CommandBuffer* pCmd);
+    void DrawForward(uint32_t frameIndex, grfx::CommandBuffer* pCmd, uint32_t firstInstance, uint32_t instanceCount);
     void EndGraphics(uint32_t frameIndex, grfx::CommandBuffer* pCmd, bool asyncCompute);
 
+    uint32_t GetInstanceCount() const { return mResX * mResY; }
+
+    // Reads the GPU time of the passes recorded by Compute() for frameIndex,
+    // the frame's command buffers must have completed. Returns false if the
+    // frame did not compute flocking.
+    bool   ReadComputeTime(uint32_t frameIndex);
+    double GetComputeTimeMs() const { return mComputeTimeMs; }
+    bool   WasGridUsed() const { return mComputeUsedGrid; }
+
+    // With --ft-use-cpu-flocking the flock is stepped on the CPU in Update()
+    // and Compute() only uploads the result to the frame's textures.
+    bool   IsCpuBackend() const { return mUseCpuFlocking; }
+    double GetCpuStepTimeMs() const { return mCpuStepTimeMs; }
+
 private:
+    struct PerFrame;
+
     void SetupSetLayouts();
     void SetupSets();
     void SetupPipelineInterfaces();
     void SetupPipelines();
+    void SetupGridBuffers();
+    void ComputeGrid(PerFrame& frame, grfx::CommandBuffer* pCmd);
+    void SetupCpuStagingBuffers();
+    void UploadCpuFlocking(PerFrame& frame, grfx::CommandBuffer* pCmd);
 
 private:
     struct PerFrame
@@ -67,6 +93,31 @@ private:
         grfx::DescriptorSetPtr velocitySet;
         grfx::DescriptorSetPtr renderSet;
 
+        // Flocking grid, built from the previous frame's fish, see ComputeGrid()
+        grfx::BufferPtr        gridFishCells;
+        grfx::BufferPtr        gridCellCounts;
+        grfx::BufferPtr        gridCellStarts;
+        grfx::BufferPtr        gridBlockSums;
+        grfx::BufferPtr        gridBlockOffsets;
+        grfx::BufferPtr        gridTotalSum;
+        grfx::BufferPtr        gridSortedFish;
+        grfx::DescriptorSetPtr gridCountSet;
+        grfx::DescriptorSetPtr gridScanCellsSet;
+        grfx::DescriptorSetPtr gridScanBlocksSet;
+        grfx::DescriptorSetPtr gridScatterSet;
+        grfx::DescriptorSetPtr velocityGridSet;
+        bool                   gridBuffersUsed = false;
+
+        // CPU flocking results, mapped for the lifetime of the buffer
+        grfx::BufferPtr cpuStagingBuffer;
+        void*           pCpuStagingAddress = nullptr;
+
+        grfx::QueryPtr startTimestampQuery;
+        grfx::QueryPtr endTimestampQuery;
+        bool           timestampsWritten        = false;
+        bool           computedWithGrid         = false;
+        bool           computedWithAsyncCompute = false;
+
         bool renderedWithAsyncCompute = false;
     };
 
@@ -79,6 +130,17 @@ private:
     float    mMinSpeed;
     float    mMaxSpeed;
     float    mZoneRadius;
+    uint32_t mGridCellCount   = 0;
+    uint32_t mGridBlockCount  = 0;
+    double   mComputeTimeMs   = 0;
+    bool     mComputeUsedGrid = false;
+
+    bool        mUseCpuFlocking           = false;
+    double      mCpuStepTimeMs            = 0;
+    uint32_t    mCpuStagingRowStride      = 0;
+    uint64_t    mCpuStagingPositionOffset = 0;
+    JobSystem   mJobSystem;
+    CpuFlocking mCpuFlocking;
 
     grfx::DescriptorSetLayoutPtr mFlockingPositionSetLayout;
     grfx::DescriptorSetLayoutPtr mFlockingVelocitySetLayout;
@@ -86,6 +148,19 @@ private:
     grfx::PipelineInterfacePtr   mFlockingVelocityPipelineInterface;
     grfx::ComputePipelinePtr     mFlockingPositionPipeline;
     grfx::ComputePipelinePtr     mFlockingVelocityPipeline;
+    grfx::DescriptorSetLayoutPtr mGridCountSetLayout;
+    grfx::DescriptorSetLayoutPtr mGridScanSetLayout;
+    grfx::DescriptorSetLayoutPtr mGridScatterSetLayout;
+    grfx::DescriptorSetLayoutPtr mVelocityGridSetLayout;
+    grfx::PipelineInterfacePtr   mGridCountPipelineInterface;
+    grfx::PipelineInterfacePtr   mGridScanPipelineInterface;
+    grfx::PipelineInterfacePtr   mGridScatterPipelineInterface;
+    grfx::PipelineInterfacePtr   mVelocityGridPipelineInterface;
+    grfx::ComputePipelinePtr     mGridCountPipeline;
+    grfx::ComputePipelinePtr     mGridScanPipeline;
+    grfx::ComputePipelinePtr     mGridScatterPipeline;
+    grfx::ComputePipelinePtr     mVelocityGridPipeline;
+    grfx::BufferPtr              mGridZeroBuffer;
     grfx::DescriptorSetLayoutPtr mRenderSetLayout;
     grfx::PipelineInterfacePtr   mForwardPipelineInterface;
     grfx::GraphicsPipelinePtr    mForwardPipeline;
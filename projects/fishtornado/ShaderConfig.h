@@ -89,6 +89,7 @@ struct FlockingData
     hlsl_float<4>   timeDelta;
     hlsl_float3<12> predPos;
     hlsl_float3<12> camPos;
+    hlsl_uint<4>    gridCellCount;
 };
 PPX_HLSL_PACK_END();
 
@@ -37,5 +37,7 @@
 // u#
 #define RENDER_OUTPUT_POSITION_TEXTURE_REGISTER 16
 #define RENDER_OUTPUT_VELOCITY_TEXTURE_REGISTER 17
+// push constants
+#define RENDER_FLOCKING_DRAW_DATA_REGISTER 26
 
 #endif //CONFIG_H
@@ -183,6 +183,9 @@ void Flocking::SetupPipelineInterfaces()
     createInfo.sets[2].pLayout                   = pApp->GetMaterialSetLayout();
     createInfo.sets[3].set                       = 3;
     createInfo.sets[3].pLayout                   = mRenderSetLayout;
+    createInfo.pushConstants.count               = 1;
+    createInfo.pushConstants.binding             = RENDER_FLOCKING_DRAW_DATA_REGISTER;
+    createInfo.pushConstants.set                 = 3;
     PPX_CHECKED_CALL(device->CreatePipelineInterface(&createInfo, &mForwardPipelineInterface));
 
     // [set0] : resources for position and velocity calculations
@@ -473,6 +476,11 @@ void Flocking::DrawShadow(uint32_t frameIndex, grfx::CommandBuffer* pCmd)
 
     pCmd->BindGraphicsPipeline(mShadowPipeline);
 
+    // FlockingRender.hlsl and FlockingShadow.hlsl offset SV_InstanceID by a
+    // push constant, all fish are drawn at once here.
+    const uint32_t firstInstance = 0;
+    pCmd->PushGraphicsConstants(mForwardPipelineInterface, 1, &firstInstance);
+
     pCmd->BindIndexBuffer(mMesh);
     pCmd->BindVertexBuffers(mMesh);
     pCmd->DrawIndexed(mMesh->GetIndexCount(), mResX * mResY);
@@ -492,6 +500,11 @@ void Flocking::DrawForward(uint32_t frameIndex, grfx::CommandBuffer* pCmd)
 
     pCmd->BindGraphicsPipeline(mForwardPipeline);
 
+    // FlockingRender.hlsl and FlockingShadow.hlsl offset SV_InstanceID by a
+    // push constant, all fish are drawn at once here.
+    const uint32_t firstInstance = 0;
+    pCmd->PushGraphicsConstants(mForwardPipelineInterface, 1, &firstInstance);
+
     pCmd->BindIndexBuffer(mMesh);
     pCmd->BindVertexBuffers(mMesh);
     pCmd->DrawIndexed(mMesh->GetIndexCount(), mResX * mResY);
@@ -0,0 +1,800 @@
+// Copyright 2017 Pavel Dobryakov
+// Copyright 2023 Google LLC
+//
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#include "cpu_solver.h"
+
+#include "ppx/job_system.h"
+#include "ppx/pixel_conversion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define FLUID_SIMULATION_SSE2
+#include <emmintrin.h>
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(__aarch64__)
+#define FLUID_SIMULATION_NEON
+#include <arm_neon.h>
+#endif
+
+namespace FluidSim {
+
+namespace {
+
+// Rows handed to each job.  Even the coarsest multigrid levels are a few jobs,
+// the finest grids are split across every worker.
+constexpr uint32_t kRowsPerJob = 16;
+
+// -------------------------------------------------------------------------------------------------
+// Four float lanes.  Kernels are written once as templates over float and
+// Float4: the scalar instantiation handles the edges, where neighbors are clamped,
+// and the vector one handles the interior.
+// -------------------------------------------------------------------------------------------------
+#if defined(FLUID_SIMULATION_SSE2)
+struct Float4
+{
+    __m128 v;
+
+    Float4() = default;
+    Float4(__m128 value)
+        : v(value) {}
+    explicit Float4(float value)
+        : v(_mm_set1_ps(value)) {}
+
+    static Float4 Load(const float* p) { return _mm_loadu_ps(p); }
+    void          Store(float* p) const { _mm_storeu_ps(p, v); }
+};
+
+inline Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+inline Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+inline Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+inline Float4 operator/(Float4 a, Float4 b) { return _mm_div_ps(a.v, b.v); }
+inline Float4 Abs(Float4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+inline Float4 Min(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+inline Float4 Max(Float4 a, Float4 b) { return _mm_max_ps(a.v, b.v); }
+inline Float4 Sqrt(Float4 a) { return _mm_sqrt_ps(a.v); }
+#elif defined(FLUID_SIMULATION_NEON)
+struct Float4
+{
+    float32x4_t v;
+
+    Float4() = default;
+    Float4(float32x4_t value)
+        : v(value) {}
+    explicit Float4(float value)
+        : v(vdupq_n_f32(value)) {}
+
+    static Float4 Load(const float* p) { return vld1q_f32(p); }
+    void          Store(float* p) const { vst1q_f32(p, v); }
+};
+
+inline Float4 operator+(Float4 a, Float4 b) { return vaddq_f32(a.v, b.v); }
+inline Float4 operator-(Float4 a, Float4 b) { return vsubq_f32(a.v, b.v); }
+inline Float4 operator*(Float4 a, Float4 b) { return vmulq_f32(a.v, b.v); }
+inline Float4 operator/(Float4 a, Float4 b) { return vdivq_f32(a.v, b.v); }
+inline Float4 Abs(Float4 a) { return vabsq_f32(a.v); }
+inline Float4 Min(Float4 a, Float4 b) { return vminq_f32(a.v, b.v); }
+inline Float4 Max(Float4 a, Float4 b) { return vmaxq_f32(a.v, b.v); }
+inline Float4 Sqrt(Float4 a) { return vsqrtq_f32(a.v); }
+#else
+struct Float4
+{
+    float v[4];
+
+    Float4() = default;
+    explicit Float4(float value)
+        : v{value, value, value, value} {}
+
+    static Float4 Load(const float* p)
+    {
+        Float4 r;
+        memcpy(r.v, p, sizeof(r.v));
+        return r;
+    }
+    void Store(float* p) const { memcpy(p, v, sizeof(v)); }
+};
+
+template <typename Op>
+inline Float4 PerLane(Float4 a, Float4 b, Op op)
+{
+    Float4 r;
+    for (int i = 0; i < 4; ++i) {
+        r.v[i] = op(a.v[i], b.v[i]);
+    }
+    return r;
+}
+
+inline Float4 operator+(Float4 a, Float4 b) { return PerLane(a, b, [](float x, float y) { return x + y; }); }
+inline Float4 operator-(Float4 a, Float4 b) { return PerLane(a, b, [](float x, float y) { return x - y; }); }
+inline Float4 operator*(Float4 a, Float4 b) { return PerLane(a, b, [](float x, float y) { return x * y; }); }
+inline Float4 operator/(Float4 a, Float4 b) { return PerLane(a, b, [](float x, float y) { return x / y; }); }
+inline Float4 Abs(Float4 a) { return PerLane(a, a, [](float x, float) { return std::fabs(x); }); }
+inline Float4 Min(Float4 a, Float4 b) { return PerLane(a, b, [](float x, float y) { return std::min(x, y); }); }
+inline Float4 Max(Float4 a, Float4 b) { return PerLane(a, b, [](float x, float y) { return std::max(x, y); }); }
+inline Float4 Sqrt(Float4 a) { return PerLane(a, a, [](float x, float) { return std::sqrt(x); }); }
+#endif
+
+inline float Abs(float a) { return std::fabs(a); }
+inline float Min(float a, float b) { return std::min(a, b); }
+inline float Max(float a, float b) { return std::max(a, b); }
+inline float Sqrt(float a) { return std::sqrt(a); }
+
+// -------------------------------------------------------------------------------------------------
+// Stencil kernels, see the shader of the same name.
+// -------------------------------------------------------------------------------------------------
+template <typename V>
+V CurlKernel(V L, V R, V T, V B)
+{
+    return V(0.5f) * (R - L - T + B);
+}
+
+template <typename V>
+void VorticityKernel(V L, V R, V T, V B, V C, float curl, float dt, V& vx, V& vy)
+{
+    V fx     = V(0.5f) * (Abs(T) - Abs(B));
+    V fy     = V(0.5f) * (Abs(R) - Abs(L));
+    V length = Sqrt(fx * fx + fy * fy) + V(0.0001f);
+    V scale  = V(curl) * C;
+    fx       = fx / length * scale;
+    fy       = V(0.0f) - fy / length * scale;
+    vx       = Min(Max(vx + fx * V(dt), V(-1000.0f)), V(1000.0f));
+    vy       = Min(Max(vy + fy * V(dt), V(-1000.0f)), V(1000.0f));
+}
+
+template <typename V>
+V DivergenceKernel(V L, V R, V T, V B)
+{
+    return V(0.5f) * (R - L + T - B);
+}
+
+template <typename V>
+V JacobiKernel(V L, V R, V T, V B, V rhs)
+{
+    return (L + R + B + T - rhs) * V(0.25f);
+}
+
+template <typename V>
+V ResidualKernel(V L, V R, V T, V B, V C, V rhs)
+{
+    return rhs - (L + R + B + T - V(4.0f) * C);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Grid access.
+// -------------------------------------------------------------------------------------------------
+float* Row(ppx::Bitmap& grid, uint32_t y)
+{
+    return reinterpret_cast<float*>(grid.GetPixelAddress(0, y));
+}
+
+const float* Row(const ppx::Bitmap& grid, uint32_t y)
+{
+    return reinterpret_cast<const float*>(grid.GetPixelAddress(0, y));
+}
+
+// Neighbor indices clamped to the edge, like the clamp sampler.
+inline uint32_t Prev(uint32_t i)
+{
+    return (i > 0) ? i - 1 : 0;
+}
+
+inline uint32_t Next(uint32_t i, uint32_t size)
+{
+    return (i + 1 < size) ? i + 1 : size - 1;
+}
+
+// Calls scalarFn(x) for the edge columns and vectorFn(x) for groups of four
+// columns whose left and right neighbors are all inside the row.
+template <typename ScalarFn, typename VectorFn>
+void ForEachColumn(uint32_t width, const ScalarFn& scalarFn, const VectorFn& vectorFn)
+{
+    uint32_t x = 0;
+    scalarFn(x++);
+    for (; x + 4 < width; x += 4) {
+        vectorFn(x);
+    }
+    for (; x < width; ++x) {
+        scalarFn(x);
+    }
+}
+
+ppx::Bitmap CreateGrid(ppx::uint2 size, ppx::Bitmap::Format format)
+{
+    ppx::Result ppxres = ppx::SUCCESS;
+    ppx::Bitmap grid   = ppx::Bitmap::Create(size.x, size.y, format, &ppxres);
+    PPX_ASSERT_MSG(ppxres == ppx::SUCCESS, "Failed to create CPU solver grid");
+    memset(grid.GetData(), 0, grid.GetFootprintSize());
+    return grid;
+}
+
+// Bilinear filtering with clamp to edge addressing, texel centers at half
+// integers like GPU samplers.
+struct BilinearTap
+{
+    uint32_t x0, x1, y0, y1;
+    float    fx, fy;
+};
+
+BilinearTap GetBilinearTap(float u, float v, uint32_t width, uint32_t height)
+{
+    const float s  = u * static_cast<float>(width) - 0.5f;
+    const float t  = v * static_cast<float>(height) - 0.5f;
+    const float fs = std::floor(s);
+    const float ft = std::floor(t);
+    const int   x  = static_cast<int>(fs);
+    const int   y  = static_cast<int>(ft);
+
+    auto clampX = [width](int i) { return static_cast<uint32_t>(std::min(std::max(i, 0), static_cast<int>(width) - 1)); };
+    auto clampY = [height](int i) { return static_cast<uint32_t>(std::min(std::max(i, 0), static_cast<int>(height) - 1)); };
+
+    BilinearTap tap;
+    tap.x0 = clampX(x);
+    tap.x1 = clampX(x + 1);
+    tap.y0 = clampY(y);
+    tap.y1 = clampY(y + 1);
+    tap.fx = s - fs;
+    tap.fy = t - ft;
+    return tap;
+}
+
+float Sample(const ppx::Bitmap& grid, const BilinearTap& tap)
+{
+    const float* pRow0 = Row(grid, tap.y0);
+    const float* pRow1 = Row(grid, tap.y1);
+    const float  top   = pRow0[tap.x0] + (pRow0[tap.x1] - pRow0[tap.x0]) * tap.fx;
+    const float  bot   = pRow1[tap.x0] + (pRow1[tap.x1] - pRow1[tap.x0]) * tap.fx;
+    return top + (bot - top) * tap.fy;
+}
+
+// One RGBA_FLOAT texel fills a vector.
+Float4 SampleRGBA(const ppx::Bitmap& grid, const BilinearTap& tap)
+{
+    const float* pRow0 = Row(grid, tap.y0);
+    const float* pRow1 = Row(grid, tap.y1);
+    const Float4 a     = Float4::Load(pRow0 + 4 * tap.x0);
+    const Float4 b     = Float4::Load(pRow0 + 4 * tap.x1);
+    const Float4 c     = Float4::Load(pRow1 + 4 * tap.x0);
+    const Float4 d     = Float4::Load(pRow1 + 4 * tap.x1);
+    const Float4 fx(tap.fx);
+    const Float4 top = a + (b - a) * fx;
+    const Float4 bot = c + (d - c) * fx;
+    return top + (bot - top) * Float4(tap.fy);
+}
+
+inline float TexelCenter(uint32_t i, uint32_t size)
+{
+    return (static_cast<float>(i) + 0.5f) / static_cast<float>(size);
+}
+
+bool HasSize(const ppx::Bitmap& bitmap, const ppx::Bitmap& grid, ppx::Bitmap::Format format)
+{
+    return (bitmap.GetFormat() == format) && (bitmap.GetWidth() == grid.GetWidth()) && (bitmap.GetHeight() == grid.GetHeight());
+}
+
+} // namespace
+
+std::vector<ppx::uint2> GetMultigridLevelSizes(uint32_t width, uint32_t height)
+{
+    std::vector<ppx::uint2> sizes = {ppx::uint2(width, height)};
+    while (sizes.size() < kMultigridMaxLevels) {
+        ppx::uint2 size = (sizes.back() + 1u) / 2u;
+        if (size.x < kMultigridMinSize || size.y < kMultigridMinSize)
+            break;
+        sizes.push_back(size);
+    }
+    return sizes;
+}
+
+void CpuFluidSolver::Initialize(ppx::uint2 simSize, ppx::uint2 dyeSize, ppx::JobSystem* jobSystem)
+{
+    PPX_ASSERT_MSG(jobSystem != nullptr, "CPU solver needs a job system");
+    mJobSystem = jobSystem;
+
+    for (uint32_t i = 0; i < 2; ++i) {
+        mVelocityX[i] = CreateGrid(simSize, ppx::Bitmap::FORMAT_R_FLOAT);
+        mVelocityY[i] = CreateGrid(simSize, ppx::Bitmap::FORMAT_R_FLOAT);
+        mPressure[i]  = CreateGrid(simSize, ppx::Bitmap::FORMAT_R_FLOAT);
+        mDye[i]       = CreateGrid(dyeSize, ppx::Bitmap::FORMAT_RGBA_FLOAT);
+    }
+    mDivergence = CreateGrid(simSize, ppx::Bitmap::FORMAT_R_FLOAT);
+    mCurl       = CreateGrid(simSize, ppx::Bitmap::FORMAT_R_FLOAT);
+
+    std::vector<ppx::uint2> sizes = GetMultigridLevelSizes(simSize.x, simSize.y);
+    mMultigridLevels.clear();
+    mMultigridLevels.resize(sizes.size());
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        MultigridLevel& level = mMultigridLevels[i];
+        if (i > 0) {
+            level.error[0] = CreateGrid(sizes[i], ppx::Bitmap::FORMAT_R_FLOAT);
+            level.error[1] = CreateGrid(sizes[i], ppx::Bitmap::FORMAT_R_FLOAT);
+            level.rhs      = CreateGrid(sizes[i], ppx::Bitmap::FORMAT_R_FLOAT);
+        }
+        if (i + 1 < sizes.size()) {
+            level.residual = CreateGrid(sizes[i], ppx::Bitmap::FORMAT_R_FLOAT);
+        }
+    }
+}
+
+ppx::Result CpuFluidSolver::SetState(const ppx::Bitmap& velocity, const ppx::Bitmap& dye, const ppx::Bitmap& pressure)
+{
+    if (!HasSize(velocity, mVelocityX[0], ppx::Bitmap::FORMAT_RG_FLOAT) ||
+        !HasSize(dye, mDye[0], ppx::Bitmap::FORMAT_RGBA_FLOAT) ||
+        !HasSize(pressure, mPressure[0], ppx::Bitmap::FORMAT_R_FLOAT)) {
+        return ppx::ERROR_BITMAP_FOOTPRINT_MISMATCH;
+    }
+
+    const uint32_t width = mVelocityX[0].GetWidth();
+    for (uint32_t y = 0; y < mVelocityX[0].GetHeight(); ++y) {
+        const float* pSrc = Row(velocity, y);
+        float*       pX   = Row(mVelocityX[0], y);
+        float*       pY   = Row(mVelocityY[0], y);
+        for (uint32_t x = 0; x < width; ++x) {
+            pX[x] = pSrc[2 * x + 0];
+            pY[x] = pSrc[2 * x + 1];
+        }
+        memcpy(Row(mPressure[0], y), Row(pressure, y), width * sizeof(float));
+    }
+    for (uint32_t y = 0; y < mDye[0].GetHeight(); ++y) {
+        memcpy(Row(mDye[0], y), Row(dye, y), 4 * mDye[0].GetWidth() * sizeof(float));
+    }
+    return ppx::SUCCESS;
+}
+
+void CpuFluidSolver::GetState(ppx::Bitmap* velocity, ppx::Bitmap* dye, ppx::Bitmap* pressure) const
+{
+    const uint32_t width  = mVelocityX[0].GetWidth();
+    const uint32_t height = mVelocityX[0].GetHeight();
+    *velocity             = CreateGrid(ppx::uint2(width, height), ppx::Bitmap::FORMAT_RG_FLOAT);
+    *pressure             = mPressure[0];
+    *dye                  = mDye[0];
+    for (uint32_t y = 0; y < height; ++y) {
+        const float* pX   = Row(mVelocityX[0], y);
+        const float* pY   = Row(mVelocityY[0], y);
+        float*       pDst = Row(*velocity, y);
+        for (uint32_t x = 0; x < width; ++x) {
+            pDst[2 * x + 0] = pX[x];
+            pDst[2 * x + 1] = pY[x];
+        }
+    }
+}
+
+template <typename RowFn>
+void CpuFluidSolver::ForEachRow(uint32_t height, const RowFn& fn)
+{
+    const uint32_t jobCount = (height + kRowsPerJob - 1) / kRowsPerJob;
+    mJobSystem->Run(jobCount, [&](uint32_t jobIndex, uint32_t) {
+        const uint32_t end = std::min(height, (jobIndex + 1) * kRowsPerJob);
+        for (uint32_t y = jobIndex * kRowsPerJob; y < end; ++y) {
+            fn(y);
+        }
+    });
+}
+
+void CpuFluidSolver::Quantize(float* pValues, uint32_t count) const
+{
+    if (!mEmulateHalfStorage) {
+        return;
+    }
+
+    uint16_t halves[256];
+    for (uint32_t i = 0; i < count; i += 256) {
+        const uint32_t n = std::min<uint32_t>(256, count - i);
+        ppx::ConvertFloatToHalf(pValues + i, halves, n);
+        ppx::ConvertHalfToFloat(halves, pValues + i, n);
+    }
+}
+
+void CpuFluidSolver::Splat(const CpuSplat& splat)
+{
+    auto falloff = [&splat](uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+        const float px = (TexelCenter(x, width) - splat.point.x) * splat.aspectRatio;
+        const float py = TexelCenter(y, height) - splat.point.y;
+        return std::exp(-(px * px + py * py) / splat.radius);
+    };
+
+    // Splats write a new texture on the GPU, updating in place reads the same
+    // values since every texel only reads itself.
+    const uint32_t width  = mVelocityX[0].GetWidth();
+    const uint32_t height = mVelocityX[0].GetHeight();
+    ForEachRow(height, [&](uint32_t y) {
+        float* pX = Row(mVelocityX[0], y);
+        float* pY = Row(mVelocityY[0], y);
+        for (uint32_t x = 0; x < width; ++x) {
+            const float e = falloff(x, y, width, height);
+            pX[x] += e * splat.delta.x;
+            pY[x] += e * splat.delta.y;
+        }
+        Quantize(pX, width);
+        Quantize(pY, width);
+    });
+
+    const uint32_t dyeWidth  = mDye[0].GetWidth();
+    const uint32_t dyeHeight = mDye[0].GetHeight();
+    ForEachRow(dyeHeight, [&](uint32_t y) {
+        float* pDye = Row(mDye[0], y);
+        for (uint32_t x = 0; x < dyeWidth; ++x) {
+            const float e = falloff(x, y, dyeWidth, dyeHeight);
+            pDye[4 * x + 0] += e * splat.color.r;
+            pDye[4 * x + 1] += e * splat.color.g;
+            pDye[4 * x + 2] += e * splat.color.b;
+            pDye[4 * x + 3] = 1.0f;
+        }
+        Quantize(pDye, 4 * dyeWidth);
+    });
+}
+
+void CpuFluidSolver::Curl()
+{
+    const uint32_t width  = mCurl.GetWidth();
+    const uint32_t height = mCurl.GetHeight();
+    ForEachRow(height, [&](uint32_t y) {
+        const float* pVX  = Row(mVelocityX[0], Next(y, height));
+        const float* pVXB = Row(mVelocityX[0], Prev(y));
+        const float* pVY  = Row(mVelocityY[0], y);
+        float*       pOut = Row(mCurl, y);
+        ForEachColumn(
+            width,
+            [&](uint32_t x) { pOut[x] = CurlKernel(pVY[Prev(x)], pVY[Next(x, width)], pVX[x], pVXB[x]); },
+            [&](uint32_t x) {
+                CurlKernel(Float4::Load(pVY + x - 1), Float4::Load(pVY + x + 1), Float4::Load(pVX + x), Float4::Load(pVXB + x)).Store(pOut + x);
+            });
+        Quantize(pOut, width);
+    });
+}
+
+void CpuFluidSolver::Vorticity(float curl, float dt)
+{
+    const uint32_t width  = mCurl.GetWidth();
+    const uint32_t height = mCurl.GetHeight();
+    ForEachRow(height, [&](uint32_t y) {
+        const float* pC    = Row(mCurl, y);
+        const float* pT    = Row(mCurl, Next(y, height));
+        const float* pB    = Row(mCurl, Prev(y));
+        const float* pVX   = Row(mVelocityX[0], y);
+        const float* pVY   = Row(mVelocityY[0], y);
+        float*       pOutX = Row(mVelocityX[1], y);
+        float*       pOutY = Row(mVelocityY[1], y);
+        ForEachColumn(
+            width,
+            [&](uint32_t x) {
+                float vx = pVX[x];
+                float vy = pVY[x];
+                VorticityKernel(pC[Prev(x)], pC[Next(x, width)], pT[x], pB[x], pC[x], curl, dt, vx, vy);
+                pOutX[x] = vx;
+                pOutY[x] = vy;
+            },
+            [&](uint32_t x) {
+                Float4 vx = Float4::Load(pVX + x);
+                Float4 vy = Float4::Load(pVY + x);
+                VorticityKernel(Float4::Load(pC + x - 1), Float4::Load(pC + x + 1), Float4::Load(pT + x), Float4::Load(pB + x), Float4::Load(pC + x), curl, dt, vx, vy);
+                vx.Store(pOutX + x);
+                vy.Store(pOutY + x);
+            });
+        Quantize(pOutX, width);
+        Quantize(pOutY, width);
+    });
+    std::swap(mVelocityX[0], mVelocityX[1]);
+    std::swap(mVelocityY[0], mVelocityY[1]);
+}
+
+void CpuFluidSolver::Divergence()
+{
+    const uint32_t width  = mDivergence.GetWidth();
+    const uint32_t height = mDivergence.GetHeight();
+    ForEachRow(height, [&](uint32_t y) {
+        const float* pVX  = Row(mVelocityX[0], y);
+        const float* pVY  = Row(mVelocityY[0], y);
+        const float* pVYT = Row(mVelocityY[0], Next(y, height));
+        const float* pVYB = Row(mVelocityY[0], Prev(y));
+        float*       pOut = Row(mDivergence, y);
+
+        // Neighbors outside the grid reflect the velocity, so that no fluid flows
+        // through the walls.
+        const bool topWall    = (y + 1 == height);
+        const bool bottomWall = (y == 0);
+        ForEachColumn(
+            width,
+            [&](uint32_t x) {
+                const float L = (x == 0) ? -pVX[x] : pVX[x - 1];
+                const float R = (x + 1 == width) ? -pVX[x] : pVX[x + 1];
+                const float T = topWall ? -pVY[x] : pVYT[x];
+                const float B = bottomWall ? -pVY[x] : pVYB[x];
+                pOut[x]       = DivergenceKernel(L, R, T, B);
+            },
+            [&](uint32_t x) {
+                const Float4 T = topWall ? Float4(0.0f) - Float4::Load(pVY + x) : Float4::Load(pVYT + x);
+                const Float4 B = bottomWall ? Float4(0.0f) - Float4::Load(pVY + x) : Float4::Load(pVYB + x);
+                DivergenceKernel(Float4::Load(pVX + x - 1), Float4::Load(pVX + x + 1), T, B).Store(pOut + x);
+            });
+        Quantize(pOut, width);
+    });
+}
+
+void CpuFluidSolver::ClearPressure(float value)
+{
+    const uint32_t width  = mPressure[0].GetWidth();
+    const uint32_t height = mPressure[0].GetHeight();
+    ForEachRow(height, [&](uint32_t y) {
+        const float* pIn  = Row(mPressure[0], y);
+        float*       pOut = Row(mPressure[1], y);
+        uint32_t     x    = 0;
+        for (; x + 4 <= width; x += 4) {
+            (Float4(value) * Float4::Load(pIn + x)).Store(pOut + x);
+        }
+        for (; x < width; ++x) {
+            pOut[x] = value * pIn[x];
+        }
+        Quantize(pOut, width);
+    });
+    std::swap(mPressure[0], mPressure[1]);
+}
+
+void CpuFluidSolver::Jacobi(const ppx::Bitmap& pressure, const ppx::Bitmap& rhs, ppx::Bitmap* pOutput)
+{
+    const uint32_t width  = pressure.GetWidth();
+    const uint32_t height = pressure.GetHeight();
+    ForEachRow(height, [&](uint32_t y) {
+        const float* pC   = Row(pressure, y);
+        const float* pT   = Row(pressure, Next(y, height));
+        const float* pB   = Row(pressure, Prev(y));
+        const float* pRhs = Row(rhs, y);
+        float*       pOut = Row(*pOutput, y);
+        ForEachColumn(
+            width,
+            [&](uint32_t x) { pOut[x] = JacobiKernel(pC[Prev(x)], pC[Next(x, width)], pT[x], pB[x], pRhs[x]); },
+            [&](uint32_t x) {
+                JacobiKernel(Float4::Load(pC + x - 1), Float4::Load(pC + x + 1), Float4::Load(pT + x), Float4::Load(pB + x), Float4::Load(pRhs + x)).Store(pOut + x);
+            });
+        Quantize(pOut, width);
+    });
+}
+
+void CpuFluidSolver::GaussSeidel(const ppx::Bitmap& pressure, const ppx::Bitmap& rhs, ppx::Bitmap* pOutput, uint32_t parity)
+{
+    // Relax the whole grid, then put back the cells of the other parity.
+    Jacobi(pressure, rhs, pOutput);
+
+    const uint32_t width  = pressure.GetWidth();
+    const uint32_t height = pressure.GetHeight();
+    ForEachRow(height, [&](uint32_t y) {
+        const float* pIn  = Row(pressure, y);
+        float*       pOut = Row(*pOutput, y);
+        for (uint32_t x = (parity + y + 1) & 1; x < width; x += 2) {
+            pOut[x] = pIn[x];
+        }
+    });
+}
+
+void CpuFluidSolver::Residual(const ppx::Bitmap& pressure, const ppx::Bitmap& rhs, ppx::Bitmap* pOutput)
+{
+    const uint32_t width  = pressure.GetWidth();
+    const uint32_t height = pressure.GetHeight();
+    ForEachRow(height, [&](uint32_t y) {
+        const float* pC   = Row(pressure, y);
+        const float* pT   = Row(pressure, Next(y, height));
+        const float* pB   = Row(pressure, Prev(y));
+        const float* pRhs = Row(rhs, y);
+        float*       pOut = Row(*pOutput, y);
+        ForEachColumn(
+            width,
+            [&](uint32_t x) { pOut[x] = ResidualKernel(pC[Prev(x)], pC[Next(x, width)], pT[x], pB[x], pC[x], pRhs[x]); },
+            [&](uint32_t x) {
+                ResidualKernel(Float4::Load(pC + x - 1), Float4::Load(pC + x + 1), Float4::Load(pT + x), Float4::Load(pB + x), Float4::Load(pC + x), Float4::Load(pRhs + x)).Store(pOut + x);
+            });
+        Quantize(pOut, width);
+    });
+}
+
+void CpuFluidSolver::Restrict(const ppx::Bitmap& residual, ppx::Bitmap* pOutput)
+{
+    // Sums the fine cells weighted by the area the coarse cell overlaps, like
+    // restriction.hlsl.
+    const uint32_t fineWidth  = residual.GetWidth();
+    const uint32_t fineHeight = residual.GetHeight();
+    const uint32_t width      = pOutput->GetWidth();
+    const uint32_t height     = pOutput->GetHeight();
+    const float    ratioX     = static_cast<float>(fineWidth) / static_cast<float>(width);
+    const float    ratioY     = static_cast<float>(fineHeight) / static_cast<float>(height);
+    ForEachRow(height, [&](uint32_t y) {
+        const float    loY  = static_cast<float>(y) * ratioY;
+        const float    hiY  = static_cast<float>(y + 1) * ratioY;
+        const uint32_t endY = std::min(static_cast<uint32_t>(std::ceil(hiY)), fineHeight);
+        float*         pOut = Row(*pOutput, y);
+        for (uint32_t x = 0; x < width; ++x) {
+            const float    loX  = static_cast<float>(x) * ratioX;
+            const float    hiX  = static_cast<float>(x + 1) * ratioX;
+            const uint32_t endX = std::min(static_cast<uint32_t>(std::ceil(hiX)), fineWidth);
+
+            float sum = 0.0f;
+            for (uint32_t j = static_cast<uint32_t>(loY); j < endY; ++j) {
+                const float  wy   = std::min(static_cast<float>(j + 1), hiY) - std::max(static_cast<float>(j), loY);
+                const float* pRow = Row(residual, j);
+                for (uint32_t i = static_cast<uint32_t>(loX); i < endX; ++i) {
+                    const float wx = std::min(static_cast<float>(i + 1), hiX) - std::max(static_cast<float>(i), loX);
+                    sum += wx * wy * pRow[i];
+                }
+            }
+            pOut[x] = sum;
+        }
+        Quantize(pOut, width);
+    });
+}
+
+void CpuFluidSolver::Prolongate(const ppx::Bitmap& pressure, const ppx::Bitmap& error, ppx::Bitmap* pOutput)
+{
+    const uint32_t width  = pressure.GetWidth();
+    const uint32_t height = pressure.GetHeight();
+    ForEachRow(height, [&](uint32_t y) {
+        const float* pIn  = Row(pressure, y);
+        float*       pOut = Row(*pOutput, y);
+        for (uint32_t x = 0; x < width; ++x) {
+            const BilinearTap tap = GetBilinearTap(TexelCenter(x, width), TexelCenter(y, height), error.GetWidth(), error.GetHeight());
+            pOut[x]               = pIn[x] + Sample(error, tap);
+        }
+        Quantize(pOut, width);
+    });
+}
+
+void CpuFluidSolver::GradientSubtract()
+{
+    const uint32_t width  = mPressure[0].GetWidth();
+    const uint32_t height = mPressure[0].GetHeight();
+    ForEachRow(height, [&](uint32_t y) {
+        const float* pC    = Row(mPressure[0], y);
+        const float* pT    = Row(mPressure[0], Next(y, height));
+        const float* pB    = Row(mPressure[0], Prev(y));
+        const float* pVX   = Row(mVelocityX[0], y);
+        const float* pVY   = Row(mVelocityY[0], y);
+        float*       pOutX = Row(mVelocityX[1], y);
+        float*       pOutY = Row(mVelocityY[1], y);
+        ForEachColumn(
+            width,
+            [&](uint32_t x) {
+                pOutX[x] = pVX[x] - (pC[Next(x, width)] - pC[Prev(x)]);
+                pOutY[x] = pVY[x] - (pT[x] - pB[x]);
+            },
+            [&](uint32_t x) {
+                (Float4::Load(pVX + x) - (Float4::Load(pC + x + 1) - Float4::Load(pC + x - 1))).Store(pOutX + x);
+                (Float4::Load(pVY + x) - (Float4::Load(pT + x) - Float4::Load(pB + x))).Store(pOutY + x);
+            });
+        Quantize(pOutX, width);
+        Quantize(pOutY, width);
+    });
+    std::swap(mVelocityX[0], mVelocityX[1]);
+    std::swap(mVelocityY[0], mVelocityY[1]);
+}
+
+void CpuFluidSolver::AdvectVelocity(float dt, float dissipation)
+{
+    const uint32_t width  = mVelocityX[0].GetWidth();
+    const uint32_t height = mVelocityX[0].GetHeight();
+    const float    decay  = 1.0f + dissipation * dt;
+    ForEachRow(height, [&](uint32_t y) {
+        const float* pVX   = Row(mVelocityX[0], y);
+        const float* pVY   = Row(mVelocityY[0], y);
+        float*       pOutX = Row(mVelocityX[1], y);
+        float*       pOutY = Row(mVelocityY[1], y);
+        for (uint32_t x = 0; x < width; ++x) {
+            const float       u   = TexelCenter(x, width) - dt * pVX[x] / static_cast<float>(width);
+            const float       v   = TexelCenter(y, height) - dt * pVY[x] / static_cast<float>(height);
+            const BilinearTap tap = GetBilinearTap(u, v, width, height);
+            pOutX[x]              = Sample(mVelocityX[0], tap) / decay;
+            pOutY[x]              = Sample(mVelocityY[0], tap) / decay;
+        }
+        Quantize(pOutX, width);
+        Quantize(pOutY, width);
+    });
+    std::swap(mVelocityX[0], mVelocityX[1]);
+    std::swap(mVelocityY[0], mVelocityY[1]);
+}
+
+void CpuFluidSolver::AdvectDye(float dt, float dissipation)
+{
+    const uint32_t simWidth  = mVelocityX[0].GetWidth();
+    const uint32_t simHeight = mVelocityX[0].GetHeight();
+    const uint32_t width     = mDye[0].GetWidth();
+    const uint32_t height    = mDye[0].GetHeight();
+    const Float4   decay(1.0f + dissipation * dt);
+    ForEachRow(height, [&](uint32_t y) {
+        float* pOut = Row(mDye[1], y);
+        for (uint32_t x = 0; x < width; ++x) {
+            const float       u           = TexelCenter(x, width);
+            const float       v           = TexelCenter(y, height);
+            const BilinearTap velocityTap = GetBilinearTap(u, v, simWidth, simHeight);
+            const float       vx          = Sample(mVelocityX[0], velocityTap);
+            const float       vy          = Sample(mVelocityY[0], velocityTap);
+            const BilinearTap dyeTap      = GetBilinearTap(u - dt * vx / static_cast<float>(simWidth), v - dt * vy / static_cast<float>(simHeight), width, height);
+            (SampleRGBA(mDye[0], dyeTap) / decay).Store(pOut + 4 * x);
+        }
+        Quantize(pOut, 4 * width);
+    });
+    std::swap(mDye[0], mDye[1]);
+}
+
+void CpuFluidSolver::SmoothPressure(ppx::Bitmap* pressure, const ppx::Bitmap& rhs, uint32_t sweeps)
+{
+    for (uint32_t i = 0; i < sweeps; ++i) {
+        for (uint32_t parity = 0; parity < 2; ++parity) {
+            GaussSeidel(pressure[0], rhs, &pressure[1], parity);
+            std::swap(pressure[0], pressure[1]);
+        }
+    }
+}
+
+void CpuFluidSolver::VCycle(uint32_t level, ppx::Bitmap* pressure, const ppx::Bitmap& rhs)
+{
+    if (level + 1 == mMultigridLevels.size()) {
+        SmoothPressure(pressure, rhs, kMultigridCoarsestSweeps);
+        return;
+    }
+
+    SmoothPressure(pressure, rhs, kMultigridSmoothingSweeps);
+
+    ppx::Bitmap&    residual = mMultigridLevels[level].residual;
+    MultigridLevel& coarse   = mMultigridLevels[level + 1];
+    Residual(pressure[0], rhs, &residual);
+    Restrict(residual, &coarse.rhs);
+    memset(coarse.error[0].GetData(), 0, coarse.error[0].GetFootprintSize());
+    VCycle(level + 1, coarse.error, coarse.rhs);
+
+    Prolongate(pressure[0], coarse.error[0], &pressure[1]);
+    std::swap(pressure[0], pressure[1]);
+
+    SmoothPressure(pressure, rhs, kMultigridSmoothingSweeps);
+}
+
+void CpuFluidSolver::Step(const CpuStepParams& params)
+{
+    Curl();
+    Vorticity(params.curl, params.dt);
+    Divergence();
+    ClearPressure(params.pressure);
+
+    if (params.multigrid) {
+        for (uint32_t i = 0; i < params.multigridCycles; ++i) {
+            VCycle(0, mPressure, mDivergence);
+        }
+    }
+    else {
+        for (uint32_t i = 0; i < params.pressureIterations; ++i) {
+            Jacobi(mPressure[0], mDivergence, &mPressure[1]);
+            std::swap(mPressure[0], mPressure[1]);
+        }
+    }
+
+    GradientSubtract();
+    AdvectVelocity(params.dt, params.velocityDissipation);
+    AdvectDye(params.dt, params.densityDissipation);
+}
+
+FieldError CompareFields(const ppx::Bitmap& reference, const ppx::Bitmap& test)
+{
+    PPX_ASSERT_MSG(HasSize(test, reference, reference.GetFormat()), "Compared fields differ in size or format");
+
+    const uint32_t valueCount = reference.GetWidth() * reference.GetChannelCount();
+    double         sumError   = 0.0;
+    double         sumValue   = 0.0;
+    float          maxError   = 0.0f;
+    for (uint32_t y = 0; y < reference.GetHeight(); ++y) {
+        const float* pRef  = Row(reference, y);
+        const float* pTest = Row(test, y);
+        for (uint32_t i = 0; i < valueCount; ++i) {
+            const float error = std::fabs(pTest[i] - pRef[i]);
+            maxError          = std::max(maxError, error);
+            sumError += static_cast<double>(error) * error;
+            sumValue += static_cast<double>(pRef[i]) * pRef[i];
+        }
+    }
+
+    FieldError result;
+    result.maxAbsolute = maxError;
+    result.relativeRms = (sumValue > 0.0) ? static_cast<float>(std::sqrt(sumError / sumValue)) : static_cast<float>(std::sqrt(sumError));
+    return result;
+}
+
+} // namespace FluidSim
@@ -0,0 +1,154 @@
+// Copyright 2017 Pavel Dobryakov
+// Copyright 2023 Google LLC
+//
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+#ifndef FLUID_SIMULATION_CPU_SOLVER_H
+#define FLUID_SIMULATION_CPU_SOLVER_H
+
+#include "ppx/bitmap.h"
+#include "ppx/config.h"
+#include "ppx/math_config.h"
+
+#include <vector>
+
+namespace ppx {
+class JobSystem;
+} // namespace ppx
+
+namespace FluidSim {
+
+// Multigrid pressure solver, shared by the GPU and CPU solvers.  Levels are
+// halved until either side would drop below kMultigridMinSize texels.  Each level
+// is smoothed with red-black Gauss-Seidel sweeps before and after the coarse
+// correction, the coarsest level is only smoothed.
+constexpr uint32_t kMultigridMaxLevels       = 10;
+constexpr uint32_t kMultigridMinSize         = 4;
+constexpr uint32_t kMultigridSmoothingSweeps = 2;
+constexpr uint32_t kMultigridCoarsestSweeps  = 8;
+
+/// @brief Sizes of the levels of the multigrid pyramid, starting with the simulation grid.
+std::vector<ppx::uint2> GetMultigridLevelSizes(uint32_t width, uint32_t height);
+
+/// @brief Inputs of one splat, @see FluidSimulation::Splat.
+struct CpuSplat
+{
+    ppx::float2 point;
+    ppx::float2 delta;
+    ppx::float3 color;
+    float       aspectRatio;
+    float       radius;
+};
+
+/// @brief Inputs of one simulation step, @see FluidSimulation::Step.
+struct CpuStepParams
+{
+    float    dt                  = 0.0f;
+    float    curl                = 0.0f;
+    float    pressure            = 0.0f;
+    float    velocityDissipation = 0.0f;
+    float    densityDissipation  = 0.0f;
+    bool     multigrid           = false;
+    uint32_t pressureIterations  = 0;
+    uint32_t multigridCycles     = 0;
+};
+
+/// @brief Difference between a field computed by the GPU and the CPU reference.
+struct FieldError
+{
+    // Largest absolute difference of any channel.
+    float maxAbsolute = 0.0f;
+    // Root mean square of the differences over the root mean square of the reference.
+    float relativeRms = 0.0f;
+};
+
+/// @brief CPU implementation of the splat and simulation step shaders.
+///
+/// Every pass follows its shader in assets/fluid_simulation/shaders: neighbors
+/// are clamped to the edge like the clamp sampler, and off-texel reads (advection,
+/// prolongation) use the same bilinear filtering.  Velocity and the scalar fields
+/// are stored in planar R_FLOAT bitmaps so that stencils can be evaluated four
+/// texels at a time with SSE2 or NEON, dye stays RGBA_FLOAT so that a texel fills
+/// one vector.  Rows are split across a job system.
+///
+/// With half storage emulation on (the default), every pass rounds its output to
+/// half precision like the 16-bit float textures of the GPU simulation, which keeps
+/// the two within filtering precision of each other after a step.
+class CpuFluidSolver
+{
+public:
+    /// @brief Allocate the grids.
+    /// @param simSize   Size of the velocity and pressure grids.
+    /// @param dyeSize   Size of the dye grid.
+    /// @param jobSystem Job system to split rows across, must outlive the solver.
+    void Initialize(ppx::uint2 simSize, ppx::uint2 dyeSize, ppx::JobSystem* jobSystem);
+
+    void SetEmulateHalfStorage(bool value) { mEmulateHalfStorage = value; }
+
+    /// @brief Replace the simulation state.
+    /// @param velocity RG_FLOAT bitmap of the simulation size.
+    /// @param dye      RGBA_FLOAT bitmap of the dye size.
+    /// @param pressure R_FLOAT bitmap of the simulation size.
+    ppx::Result SetState(const ppx::Bitmap& velocity, const ppx::Bitmap& dye, const ppx::Bitmap& pressure);
+
+    /// @brief Copy the simulation state out, in the formats of SetState.
+    void GetState(ppx::Bitmap* velocity, ppx::Bitmap* dye, ppx::Bitmap* pressure) const;
+
+    /// @brief Add a splat to the velocity and dye, like the splat shader.
+    void Splat(const CpuSplat& splat);
+
+    /// @brief Advance the simulation by one step, like FluidSimulation::Step.
+    void Step(const CpuStepParams& params);
+
+private:
+    struct MultigridLevel
+    {
+        ppx::Bitmap error[2];
+        ppx::Bitmap rhs;
+        ppx::Bitmap residual;
+    };
+
+    template <typename RowFn>
+    void ForEachRow(uint32_t height, const RowFn& fn);
+
+    void Quantize(float* pValues, uint32_t count) const;
+
+    void Curl();
+    void Vorticity(float curl, float dt);
+    void Divergence();
+    void ClearPressure(float value);
+    void Jacobi(const ppx::Bitmap& pressure, const ppx::Bitmap& rhs, ppx::Bitmap* pOutput);
+    void GaussSeidel(const ppx::Bitmap& pressure, const ppx::Bitmap& rhs, ppx::Bitmap* pOutput, uint32_t parity);
+    void Residual(const ppx::Bitmap& pressure, const ppx::Bitmap& rhs, ppx::Bitmap* pOutput);
+    void Restrict(const ppx::Bitmap& residual, ppx::Bitmap* pOutput);
+    void Prolongate(const ppx::Bitmap& pressure, const ppx::Bitmap& error, ppx::Bitmap* pOutput);
+    void GradientSubtract();
+    void AdvectVelocity(float dt, float dissipation);
+    void AdvectDye(float dt, float dissipation);
+
+    void SmoothPressure(ppx::Bitmap* pressure, const ppx::Bitmap& rhs, uint32_t sweeps);
+    void VCycle(uint32_t level, ppx::Bitmap* pressure, const ppx::Bitmap& rhs);
+
+    ppx::JobSystem* mJobSystem          = nullptr;
+    bool            mEmulateHalfStorage = true;
+
+    // Velocity components, with ping-pong grids like the velocity textures.
+    ppx::Bitmap mVelocityX[2];
+    ppx::Bitmap mVelocityY[2];
+    ppx::Bitmap mPressure[2];
+    ppx::Bitmap mDivergence;
+    ppx::Bitmap mCurl;
+    ppx::Bitmap mDye[2];
+
+    // Multigrid pyramid, level 0 only uses its residual.
+    std::vector<MultigridLevel> mMultigridLevels;
+};
+
+/// @brief Compare two float bitmaps of the same size and format.
+FieldError CompareFields(const ppx::Bitmap& reference, const ppx::Bitmap& test);
+
+} // namespace FluidSim
+
+#endif // FLUID_SIMULATION_CPU_SOLVER_H
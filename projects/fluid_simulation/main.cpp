@@ -30,11 +30,12 @@
 ///     a single instance of `class FluidSimulation` is created and an initial splash of color computed by calling
 ///     `FluidSimulation::GenerateInitialSplat`.  The main rendering loop (@see ProjApp::Render) proceeds as follows:
 ///
-///     1.  All the scheduled compute shaders are executed by calling `FluidSimulation::DispatchComputeShaders`.
-///     2.  All the generated textures are drawn by calling `FluidSimulation::Render`.
-///     3.  The resources used by compute shaders are released by calling `FluidSimulation::FreeComputeShaderResources`.
-///         This prevents running out of pool resources and needlessly executing compute operations over and over.
-///     4.  The next iteration of the simulation is executed (@note This is still not implemented).
+///     1.  The next iteration of the simulation is scheduled by calling `FluidSimulation::Update`.
+///     2.  All the scheduled compute shaders are executed by calling `FluidSimulation::DispatchComputeShaders`.
+///     3.  All the generated textures are drawn by calling `FluidSimulation::DispatchGraphicsShaders`.
+///     4.  The schedules are cleared by calling `FluidSimulation::ClearDispatchQueues`.  Descriptor sets, uniform
+///         buffers and vertex buffers are kept and reused by the next frame, so steady-state frames allocate no
+///         GPU resources.
 ///
 
 #include "sim.h"
@@ -47,6 +48,7 @@
 #include "ppx/log.h"
 #include "ppx/math_config.h"
 #include "ppx/ppx.h"
+#include "ppx/timer.h"
 
 namespace FluidSim {
 
@@ -79,6 +81,17 @@ void ProjApp::InitKnobs()
     mConfig.pVelocityDissipation->SetDisplayName("Velocity Dissipations");
     mConfig.pVelocityDissipation->SetFlagDescription("This simulates the loss of energy within the fluid system. Higher values result in faster velocity reduction.");
 
+    // Pressure solver
+    std::vector<std::string> pressureSolvers = {"jacobi", "multigrid"};
+    mConfig.pPressureSolver                  = GetKnobManager().CreateKnob<ppx::KnobDropdown<std::string>>("pressure-solver", 0, pressureSolvers);
+    mConfig.pPressureSolver->SetDisplayName("Pressure Solver");
+    mConfig.pPressureSolver->SetFlagDescription("Method used to solve the pressure field. Jacobi runs pressure-iterations passes at full resolution. Multigrid runs V-cycles of red-black Gauss-Seidel smoothing over a pyramid of coarser grids, which removes low frequency errors in far fewer passes.");
+
+    mConfig.pMultigridCycles = GetKnobManager().CreateKnob<ppx::KnobSlider<int>>("multigrid-cycles", 1, 1, 4);
+    mConfig.pMultigridCycles->SetDisplayName("Multigrid Cycles");
+    mConfig.pMultigridCycles->SetFlagDescription("This is the number of V-cycles performed by the multigrid pressure solver.");
+    mConfig.pMultigridCycles->SetIndent(indent);
+
     // Bloom
     mConfig.pEnableBloom = GetKnobManager().CreateKnob<ppx::KnobCheckbox>("enable-bloom", true);
     mConfig.pEnableBloom->SetDisplayName("Enable Bloom");
@@ -163,6 +176,16 @@ void ProjApp::InitKnobs()
     mConfig.pSimResolution = GetKnobManager().CreateKnob<ppx::KnobSlider<int>>("sim-resolution", 128, 1, 1000);
     mConfig.pSimResolution->SetDisplayName("Simulation Resolution");
     mConfig.pSimResolution->SetFlagDescription("This determines the grid size of the compute textures used during simulation. Higher values produce finer grids which produce a more accurate representation.");
+
+    // Validation
+    mConfig.pCpuValidation = GetKnobManager().CreateKnob<ppx::KnobCheckbox>("cpu-validation", false);
+    mConfig.pCpuValidation->SetDisplayName("CPU Validation");
+    mConfig.pCpuValidation->SetFlagDescription("Replays every simulation step on a CPU reference solver, starting from the state read back from the GPU, and compares the results. Steps whose error exceeds the tolerance are logged. This reads back the whole simulation state every frame and is much slower. Only read at startup.");
+
+    mConfig.pCpuValidationTolerance = GetKnobManager().CreateKnob<ppx::KnobSlider<float>>("cpu-validation-tolerance", 0.05f, 0.0f, 1.0f);
+    mConfig.pCpuValidationTolerance->SetDisplayName("Tolerance");
+    mConfig.pCpuValidationTolerance->SetFlagDescription("Largest relative RMS difference between the GPU and the CPU reference accepted for the velocity, dye and pressure of a step.");
+    mConfig.pCpuValidationTolerance->SetIndent(indent);
 }
 
 void ProjApp::Config(ppx::ApplicationSettings& settings)
@@ -191,6 +214,55 @@ void ProjApp::Setup()
     mSim->GenerateInitialSplat();
 }
 
+void ProjApp::SetupMetrics()
+{
+    Application::SetupMetrics();
+    if (!HasActiveMetricsRun()) {
+        return;
+    }
+
+    ppx::metrics::MetricMetadata metadata = {ppx::metrics::MetricType::GAUGE, "Simulation CPU Time", "ms", ppx::metrics::MetricInterpretation::LOWER_IS_BETTER, {0.f, 60000.f}};
+    mSimulationCpuTimeMetric              = AddMetric(metadata);
+    PPX_ASSERT_MSG(mSimulationCpuTimeMetric != ppx::metrics::kInvalidMetricID, "Failed to add Simulation CPU Time metric");
+
+    metadata                = {ppx::metrics::MetricType::GAUGE, "Pressure Residual", "", ppx::metrics::MetricInterpretation::LOWER_IS_BETTER, {0.f, 1000000.f}};
+    mPressureResidualMetric = AddMetric(metadata);
+    PPX_ASSERT_MSG(mPressureResidualMetric != ppx::metrics::kInvalidMetricID, "Failed to add Pressure Residual metric");
+
+    if (mConfig.pCpuValidation->GetValue()) {
+        metadata                  = {ppx::metrics::MetricType::GAUGE, "CPU Validation Error", "", ppx::metrics::MetricInterpretation::LOWER_IS_BETTER, {0.f, 1000000.f}};
+        mCpuValidationErrorMetric = AddMetric(metadata);
+        PPX_ASSERT_MSG(mCpuValidationErrorMetric != ppx::metrics::kInvalidMetricID, "Failed to add CPU Validation Error metric");
+
+        metadata                 = {ppx::metrics::MetricType::GAUGE, "CPU Reference Steps Per Second", "steps/s", ppx::metrics::MetricInterpretation::HIGHER_IS_BETTER, {0.f, 1000000.f}};
+        mCpuStepsPerSecondMetric = AddMetric(metadata);
+        PPX_ASSERT_MSG(mCpuStepsPerSecondMetric != ppx::metrics::kInvalidMetricID, "Failed to add CPU Reference Steps Per Second metric");
+    }
+}
+
+void ProjApp::UpdateMetrics()
+{
+    if (!HasActiveMetricsRun()) {
+        return;
+    }
+
+    ppx::metrics::MetricData data = {ppx::metrics::MetricType::GAUGE};
+    data.gauge.seconds            = GetElapsedSeconds();
+    data.gauge.value              = mSimulationCpuTimeMs;
+    RecordMetricData(mSimulationCpuTimeMetric, data);
+
+    data.gauge.value = mSim->GetPressureResidual();
+    RecordMetricData(mPressureResidualMetric, data);
+
+    if (mCpuValidationErrorMetric != ppx::metrics::kInvalidMetricID) {
+        data.gauge.value = mSim->GetCpuValidationError();
+        RecordMetricData(mCpuValidationErrorMetric, data);
+
+        data.gauge.value = mSim->GetCpuStepsPerSecond();
+        RecordMetricData(mCpuStepsPerSecondMetric, data);
+    }
+}
+
 void ProjApp::Render()
 {
     PerFrame& frame = mSim->GetFrame(0);
@@ -206,8 +278,13 @@ void ProjApp::Render()
     // Wait for and reset the render-complete fence.
     PPX_CHECKED_CALL(frame.renderCompleteFence->WaitAndReset());
 
+    // Time the CPU side of the simulation: scheduling its shaders and recording them.
+    ppx::Timer simulationTimer;
+    simulationTimer.Start();
+
     // Update the simulation state.  This schedules new compute shaders to draw the next frame.
     mSim->Update();
+    double simulationCpuTimeMs = simulationTimer.MillisSinceStart();
 
     // Draw Knobs window
     if (GetSettings()->enableImGui) {
@@ -219,7 +296,9 @@ void ProjApp::Render()
     PPX_CHECKED_CALL(frame.cmd->Begin());
     {
         // Dispatch all the scheduled compute shaders.
+        double dispatchStartMs = simulationTimer.MillisSinceStart();
         mSim->DispatchComputeShaders(frame);
+        simulationCpuTimeMs += simulationTimer.MillisSinceStart() - dispatchStartMs;
 
         ppx::grfx::RenderPassPtr renderPass = GetSwapchain()->GetRenderPass(imageIndex);
         PPX_ASSERT_MSG(!renderPass.IsNull(), "render pass object is null");
@@ -229,7 +308,9 @@ void ProjApp::Render()
         frame.cmd->TransitionImageLayout(renderPass->GetRenderTargetImage(0), PPX_ALL_SUBRESOURCES, ppx::grfx::RESOURCE_STATE_PRESENT, ppx::grfx::RESOURCE_STATE_RENDER_TARGET);
         frame.cmd->BeginRenderPass(renderPass);
         {
+            dispatchStartMs = simulationTimer.MillisSinceStart();
             mSim->DispatchGraphicsShaders(frame);
+            simulationCpuTimeMs += simulationTimer.MillisSinceStart() - dispatchStartMs;
 
             // Draw ImGui.
             DrawDebugInfo();
@@ -254,12 +335,17 @@ void ProjApp::Render()
     // Present and signal.
     PPX_CHECKED_CALL(swapchain->Present(imageIndex, 1, &frame.renderCompleteSemaphore));
 
-    mSim->FreeComputeShaderResources();
-    mSim->FreeGraphicsShaderResources();
+    mSim->ClearDispatchQueues();
+    mSimulationCpuTimeMs = simulationCpuTimeMs;
 }
 
 void ProjApp::UpdateKnobVisibility()
 {
+    if (mConfig.pPressureSolver->DigestUpdate()) {
+        bool multigrid = mConfig.pPressureSolver->GetValue() == "multigrid";
+        mConfig.pPressureIterations->SetVisible(!multigrid);
+        mConfig.pMultigridCycles->SetVisible(multigrid);
+    }
     if (mConfig.pEnableBloom->DigestUpdate()) {
         bool bloomEnabled = mConfig.pEnableBloom->GetValue();
         mConfig.pBloomIntensity->SetVisible(bloomEnabled);
@@ -278,6 +364,9 @@ void ProjApp::UpdateKnobVisibility()
         mConfig.pSunraysResolution->SetVisible(sunraysEnabled);
         mConfig.pSunraysWeight->SetVisible(sunraysEnabled);
     }
+    if (mConfig.pCpuValidation->DigestUpdate()) {
+        mConfig.pCpuValidationTolerance->SetVisible(mConfig.pCpuValidation->GetValue());
+    }
 }
 
 } // namespace FluidSim
@@ -11,6 +11,11 @@
 #include "ppx/config.h"
 #include "ppx/graphics_util.h"
 #include "ppx/math_config.h"
+#include "ppx/pixel_conversion.h"
+#include "ppx/util.h"
+
+#include <algorithm>
+#include <cstring>
 
 std::ostream& operator<<(std::ostream& os, const FluidSim::ScalarInput& i)
 {
@@ -30,6 +35,7 @@ std::ostream& operator<<(std::ostream& os, const FluidSim::ScalarInput& i)
     os << "weight:             [" << offsetof(FluidSim::ScalarInput, weight) << "]: " << i.weight << "\n";
     os << "curl:               [" << offsetof(FluidSim::ScalarInput, curl) << "]: " << i.curl << "\n";
     os << "normalizationScale: [" << offsetof(FluidSim::ScalarInput, normalizationScale) << "]: " << i.normalizationScale << "\n";
+    os << "parity:             [" << offsetof(FluidSim::ScalarInput, parity) << "]: " << i.parity << "\n";
     return os;
 }
 
@@ -94,6 +100,68 @@ ppx::float2 Texture::GetNormalizedSize() const
     return ppx::float2(GetWidth() * 2.0f / GetApp()->GetWindowWidth(), GetHeight() * 2.0f / GetApp()->GetWindowHeight());
 }
 
+void TextureReadback::Record(const PerFrame& frame, Texture* texture)
+{
+    ppx::grfx::ImagePtr image = texture->GetImagePtr();
+    if (!mBuffer) {
+        // Rows are aligned for D3D12, Vulkan copies tightly packed rows.
+        const ppx::grfx::FormatDesc* pDesc    = ppx::grfx::GetFormatDescription(image->GetFormat());
+        const uint64_t               rowPitch = ppx::RoundUp<uint64_t>(static_cast<uint64_t>(pDesc->bytesPerTexel) * image->GetWidth(), PPX_D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+
+        ppx::grfx::BufferCreateInfo bci = {};
+        bci.size                        = rowPitch * image->GetHeight();
+        bci.initialState                = ppx::grfx::RESOURCE_STATE_COPY_DST;
+        bci.usageFlags.bits.transferDst = true;
+        bci.memoryUsage                 = ppx::grfx::MEMORY_USAGE_GPU_TO_CPU;
+        PPX_CHECKED_CALL(mSim->GetApp()->GetDevice()->CreateBuffer(&bci, &mBuffer));
+
+        mFormat = image->GetFormat();
+        mWidth  = image->GetWidth();
+        mHeight = image->GetHeight();
+    }
+    PPX_ASSERT_MSG(image->GetFormat() == mFormat && image->GetWidth() == mWidth && image->GetHeight() == mHeight, "Readback of " << texture->GetName() << " does not match its buffer");
+
+    frame.cmd->TransitionImageLayout(image, PPX_ALL_SUBRESOURCES, ppx::grfx::RESOURCE_STATE_SHADER_RESOURCE, ppx::grfx::RESOURCE_STATE_COPY_SRC);
+
+    ppx::grfx::ImageToBufferCopyInfo copyInfo = {};
+    copyInfo.extent                           = {mWidth, mHeight, 0};
+    ppx::grfx::ImageToBufferOutputPitch pitch = frame.cmd->CopyImageToBuffer(&copyInfo, image, mBuffer);
+    mRowPitch                                 = pitch.rowPitch;
+
+    frame.cmd->TransitionImageLayout(image, PPX_ALL_SUBRESOURCES, ppx::grfx::RESOURCE_STATE_COPY_SRC, ppx::grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    mPending = true;
+}
+
+void TextureReadback::Read(ppx::Bitmap* pBitmap)
+{
+    PPX_ASSERT_MSG(mPending, "No readback was recorded");
+
+    const ppx::grfx::FormatDesc* pDesc    = ppx::grfx::GetFormatDescription(mFormat);
+    const uint32_t               channels = pDesc->bytesPerTexel / pDesc->bytesPerComponent;
+    const bool                   isHalf   = (pDesc->bytesPerComponent == 2);
+    PPX_ASSERT_MSG(pDesc->dataType == ppx::grfx::FORMAT_DATA_TYPE_FLOAT && channels != 3, "Unsupported readback format");
+
+    const ppx::Bitmap::Format format = (channels == 1) ? ppx::Bitmap::FORMAT_R_FLOAT : ((channels == 2) ? ppx::Bitmap::FORMAT_RG_FLOAT : ppx::Bitmap::FORMAT_RGBA_FLOAT);
+    if (pBitmap->GetWidth() != mWidth || pBitmap->GetHeight() != mHeight || pBitmap->GetFormat() != format) {
+        PPX_CHECKED_CALL(ppx::Bitmap::Create(mWidth, mHeight, format, pBitmap));
+    }
+
+    void* pData = nullptr;
+    PPX_CHECKED_CALL(mBuffer->MapMemory(0, &pData));
+    for (uint32_t y = 0; y < mHeight; ++y) {
+        const char* pRow = static_cast<const char*>(pData) + static_cast<size_t>(y) * mRowPitch;
+        float*      pDst = reinterpret_cast<float*>(pBitmap->GetPixelAddress(0, y));
+        if (isHalf) {
+            ppx::ConvertHalfToFloat(reinterpret_cast<const uint16_t*>(pRow), pDst, static_cast<size_t>(mWidth) * channels);
+        }
+        else {
+            memcpy(pDst, pRow, static_cast<size_t>(mWidth) * channels * sizeof(float));
+        }
+    }
+    mBuffer->UnmapMemory();
+    mPending = false;
+}
+
 ProjApp* Shader::GetApp() const
 {
     return mSim->GetApp();
@@ -123,80 +191,95 @@ ComputeShader::ComputeShader(FluidSimulation* sim, const std::string& shaderFile
     PPX_CHECKED_CALL(GetApp()->GetDevice()->CreateComputePipeline(&pci, &mPipeline));
 }
 
-ComputeDispatchRecord::ComputeDispatchRecord(ComputeShader* cs, Texture* output, const ScalarInput& si)
-    : mShader(cs), mOutput(output)
+uint32_t UniformRing::Push(const ScalarInput& si)
 {
-    // Allocate a new descriptor set.
-    PPX_CHECKED_CALL(mShader->GetApp()->GetDevice()->AllocateDescriptorSet(mShader->GetSim()->GetDescriptorPool(), mShader->GetComputeResources()->mDescriptorSetLayout, &mDescriptorSet));
+    if (mSlotCount == static_cast<uint32_t>(mDescriptorSets.size())) {
+        Grow(std::max<uint32_t>(64, 2 * mSlotCount));
+    }
+
+    uint32_t slot = mSlotCount++;
+    memcpy(mMappedAddress + slot * PPX_MINIMUM_UNIFORM_BUFFER_SIZE, &si, sizeof(si));
+    return slot;
+}
+
+void UniformRing::Grow(uint32_t capacity)
+{
+    ppx::grfx::Device* device = mSim->GetApp()->GetDevice();
+
+    PPX_LOG_DEBUG("Growing uniform ring to " << capacity << " slots");
 
-    // Allocate a new uniform buffer and initialize it with input data.
     ppx::grfx::BufferCreateInfo bci   = {};
-    bci.size                          = PPX_MINIMUM_UNIFORM_BUFFER_SIZE;
+    bci.size                          = capacity * PPX_MINIMUM_UNIFORM_BUFFER_SIZE;
     bci.usageFlags.bits.uniformBuffer = true;
     bci.memoryUsage                   = ppx::grfx::MEMORY_USAGE_CPU_TO_GPU;
-    PPX_CHECKED_CALL(mShader->GetApp()->GetDevice()->CreateBuffer(&bci, &mUniformBuffer));
+    ppx::grfx::BufferPtr buffer;
+    PPX_CHECKED_CALL(device->CreateBuffer(&bci, &buffer));
 
     void* pData = nullptr;
-    PPX_CHECKED_CALL(mUniformBuffer->MapMemory(0, &pData));
-    memcpy(pData, &si, sizeof(si));
-    mUniformBuffer->UnmapMemory();
-
-    const size_t               numBindings = 3;
-    ppx::grfx::WriteDescriptor write[numBindings];
-
-    write[0].binding      = 0;
-    write[0].type         = ppx::grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    write[0].bufferOffset = 0;
-    write[0].bufferRange  = PPX_WHOLE_SIZE;
-    write[0].pBuffer      = mUniformBuffer;
-
-    write[1].binding  = 1;
-    write[1].type     = ppx::grfx::DESCRIPTOR_TYPE_SAMPLER;
-    write[1].pSampler = mShader->GetComputeResources()->mClampSampler;
-
-    write[2].binding  = 12;
-    write[2].type     = ppx::grfx::DESCRIPTOR_TYPE_SAMPLER;
-    write[2].pSampler = mShader->GetComputeResources()->mRepeatSampler;
-
-    PPX_CHECKED_CALL(mDescriptorSet->UpdateDescriptors(numBindings, write));
+    PPX_CHECKED_CALL(buffer->MapMemory(0, &pData));
+
+    // Keep the inputs already written this frame. Growing only happens while
+    // recording, after the previous frame has completed, so the old buffer is
+    // no longer in use by the GPU.
+    if (mBuffer) {
+        memcpy(pData, mMappedAddress, mSlotCount * PPX_MINIMUM_UNIFORM_BUFFER_SIZE);
+        mBuffer->UnmapMemory();
+        device->DestroyBuffer(mBuffer);
+    }
+    mBuffer        = buffer;
+    mMappedAddress = static_cast<char*>(pData);
+
+    // Point the existing sets at the new buffer and add sets for the new slots.
+    uint32_t oldCapacity = static_cast<uint32_t>(mDescriptorSets.size());
+    mDescriptorSets.resize(capacity);
+    for (uint32_t slot = 0; slot < capacity; ++slot) {
+        if (slot >= oldCapacity) {
+            PPX_CHECKED_CALL(device->AllocateDescriptorSet(mSim->GetDescriptorPool(), mSim->GetComputeResources()->mUniformSetLayout, &mDescriptorSets[slot]));
+        }
+
+        ppx::grfx::WriteDescriptor write = {};
+        write.binding                    = 0;
+        write.type                       = ppx::grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        write.bufferOffset               = slot * PPX_MINIMUM_UNIFORM_BUFFER_SIZE;
+        write.bufferRange                = PPX_MINIMUM_UNIFORM_BUFFER_SIZE;
+        write.pBuffer                    = mBuffer;
+        PPX_CHECKED_CALL(mDescriptorSets[slot]->UpdateDescriptors(1, &write));
+    }
 }
 
-void ComputeDispatchRecord::FreeResources()
+ComputeDispatchRecord::ComputeDispatchRecord(ComputeShader* cs, Texture* output, const ScalarInput& si)
+    : mShader(cs), mOutput(output)
 {
-    PPX_LOG_DEBUG("Freeing up uniform buffer and descriptor set for " << mShader->GetName());
-    mShader->GetApp()->GetDevice()->DestroyBuffer(mUniformBuffer);
-    mShader->GetApp()->GetDevice()->FreeDescriptorSet(mDescriptorSet);
+    mUniformSlot = mShader->GetSim()->GetUniformRing()->Push(si);
 }
 
 void ComputeDispatchRecord::BindInputTexture(Texture* texture, uint32_t bindingSlot)
 {
-    ppx::grfx::WriteDescriptor write;
-    write.binding    = bindingSlot;
-    write.type       = ppx::grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-    write.pImageView = texture->GetSampledView();
-    PPX_CHECKED_CALL(mDescriptorSet->UpdateDescriptors(1, &write));
+    PPX_ASSERT_MSG(bindingSlot >= kFirstInputTextureBinding && bindingSlot < kOutputTextureBinding, "Invalid input texture binding " << bindingSlot);
+    mBindings.inputs[bindingSlot - kFirstInputTextureBinding] = texture;
 }
 
 void ComputeDispatchRecord::BindOutputTexture(uint32_t bindingSlot)
 {
-    ppx::grfx::WriteDescriptor write;
-    write.binding    = bindingSlot;
-    write.type       = ppx::grfx::DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    write.pImageView = mOutput->GetStorageView();
-    PPX_CHECKED_CALL(mDescriptorSet->UpdateDescriptors(1, &write));
+    PPX_ASSERT_MSG(bindingSlot == kOutputTextureBinding, "Invalid output texture binding " << bindingSlot);
+    mBindings.output = mOutput;
 }
 
-void ComputeShader::Dispatch(const PerFrame& frame, const std::unique_ptr<ComputeDispatchRecord>& dr)
+void ComputeShader::Dispatch(const PerFrame& frame, const ComputeDispatchRecord& dr)
 {
-    ppx::uint3 dispatchSize = ppx::uint3(dr->mOutput->GetWidth(), dr->mOutput->GetHeight(), 1);
+    ppx::uint3 dispatchSize = ppx::uint3(dr.mOutput->GetWidth(), dr.mOutput->GetHeight(), 1);
 
     PPX_LOG_DEBUG("Running compute shader '" << mShaderFile << ".cs' (" << dispatchSize << ")\n");
 
-    frame.cmd->TransitionImageLayout(dr->mOutput->GetImagePtr(), PPX_ALL_SUBRESOURCES, ppx::grfx::RESOURCE_STATE_SHADER_RESOURCE, ppx::grfx::RESOURCE_STATE_UNORDERED_ACCESS);
-    frame.cmd->BindComputeDescriptorSets(dr->mShader->GetComputeResources()->mPipelineInterface, 1, &dr->mDescriptorSet);
+    const ppx::grfx::DescriptorSet* sets[2] = {
+        GetSim()->GetComputeDescriptorSet(dr.mBindings),
+        GetSim()->GetUniformRing()->GetDescriptorSet(dr.mUniformSlot)};
+
+    frame.cmd->TransitionImageLayout(dr.mOutput->GetImagePtr(), PPX_ALL_SUBRESOURCES, ppx::grfx::RESOURCE_STATE_SHADER_RESOURCE, ppx::grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    frame.cmd->BindComputeDescriptorSets(GetComputeResources()->mPipelineInterface, 2, sets);
     frame.cmd->BindComputePipeline(mPipeline);
     frame.cmd->Dispatch(dispatchSize.x, dispatchSize.y, dispatchSize.z);
-    frame.cmd->TransitionImageLayout(dr->mOutput->GetImagePtr(), PPX_ALL_SUBRESOURCES, ppx::grfx::RESOURCE_STATE_UNORDERED_ACCESS, ppx::grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    frame.cmd->TransitionImageLayout(dr.mOutput->GetImagePtr(), PPX_ALL_SUBRESOURCES, ppx::grfx::RESOURCE_STATE_UNORDERED_ACCESS, ppx::grfx::RESOURCE_STATE_SHADER_RESOURCE);
 }
 
 GraphicsDispatchRecord::GraphicsDispatchRecord(GraphicsShader* gs, Texture* image, ppx::float2 coord)
@@ -256,12 +339,6 @@ GraphicsDispatchRecord::GraphicsDispatchRecord(GraphicsShader* gs, Texture* imag
     PPX_LOG_DEBUG("Created graphic descriptor set for " << image);
 }
 
-void GraphicsDispatchRecord::FreeResources()
-{
-    PPX_LOG_DEBUG("Freeing up descriptor set for " << mShader->GetName());
-    mShader->GetApp()->GetDevice()->FreeDescriptorSet(mDescriptorSet);
-}
-
 GraphicsShader::GraphicsShader(FluidSimulation* sim)
     : Shader(sim, "StaticTexture")
 {
@@ -296,7 +373,16 @@ GraphicsShader::GraphicsShader(FluidSimulation* sim)
     PPX_CHECKED_CALL(GetApp()->GetDevice()->CreateGraphicsPipeline(&gpci, &mPipeline));
 }
 
-void GraphicsShader::Dispatch(const PerFrame& frame, const std::unique_ptr<GraphicsDispatchRecord>& dr)
+GraphicsDispatchRecord* GraphicsShader::GetDR(Texture* image, ppx::float2 coord)
+{
+    std::unique_ptr<GraphicsDispatchRecord>& dr = mRecords[RecordKey(image, coord.x, coord.y)];
+    if (!dr) {
+        dr = std::make_unique<GraphicsDispatchRecord>(this, image, coord);
+    }
+    return dr.get();
+}
+
+void GraphicsShader::Dispatch(const PerFrame& frame, GraphicsDispatchRecord* dr)
 {
     frame.cmd->BindGraphicsDescriptorSets(GetGraphicsResources()->mPipelineInterface, 1, &dr->mDescriptorSet);
     frame.cmd->BindGraphicsPipeline(mPipeline);
@@ -14,21 +14,25 @@
 #include "ppx/grfx/grfx_image.h"
 #include "ppx/math_config.h"
 
+#include <array>
 #include <iostream>
 #include <map>
+#include <tuple>
 
 namespace FluidSim {
 
 class ProjApp;
 class FluidSimulation;
 
-// Pipeline interface, descriptor layout and sampler used by compute shaders.
+// Pipeline interface, descriptor layouts and samplers used by compute shaders.
+// Set 0 holds samplers and textures, set 1 holds the shader inputs.
 struct ComputeResources
 {
     ppx::grfx::PipelineInterfacePtr   mPipelineInterface;
     ppx::grfx::SamplerPtr             mClampSampler;
     ppx::grfx::SamplerPtr             mRepeatSampler;
     ppx::grfx::DescriptorSetLayoutPtr mDescriptorSetLayout;
+    ppx::grfx::DescriptorSetLayoutPtr mUniformSetLayout;
 };
 
 // Pipeline interface, descriptor layout, sampler and other resources used for graphics shaders.
@@ -98,6 +102,39 @@ private:
     std::string                    mName;
 };
 
+/// @brief Copy of a texture read back to the CPU.
+///
+/// The copy is recorded into a frame's command buffer and can only be read once
+/// that frame has completed, which the simulation guarantees by the next Update.
+class TextureReadback
+{
+public:
+    TextureReadback(FluidSimulation* sim)
+        : mSim(sim) {}
+
+    /// @brief Record the copy of a texture.  The buffer is created by the first copy,
+    ///        so every copy must use a texture of the same size and format.
+    void Record(const PerFrame& frame, Texture* texture);
+
+    /// @brief Whether a copy was recorded and not read yet.
+    bool IsPending() const { return mPending; }
+
+    /// @brief Read the recorded copy as 32-bit floats.
+    /// @param pBitmap Receives an R_FLOAT, RG_FLOAT or RGBA_FLOAT bitmap with the
+    ///                channels of the texture.  16-bit and 32-bit float textures
+    ///                are supported.
+    void Read(ppx::Bitmap* pBitmap);
+
+private:
+    FluidSimulation*     mSim;
+    ppx::grfx::BufferPtr mBuffer;
+    ppx::grfx::Format    mFormat   = ppx::grfx::FORMAT_UNDEFINED;
+    uint32_t             mWidth    = 0;
+    uint32_t             mHeight   = 0;
+    uint32_t             mRowPitch = 0;
+    bool                 mPending  = false;
+};
+
 /// @brief Scalar inputs for the filter programs.
 ///
 /// This needs to be 16-bit aligned to be copied into a uniform buffer.
@@ -124,7 +161,8 @@ struct alignas(16) ScalarInput
           radius(),
           weight(),
           curl(),
-          normalizationScale(1.0f / output->GetWidth(), 1.0f / output->GetHeight()) {}
+          normalizationScale(1.0f / output->GetWidth(), 1.0f / output->GetHeight()),
+          parity() {}
 
     ppx::float2 texelSize;
     ppx::float2 coordinate;
@@ -148,6 +186,60 @@ struct alignas(16) ScalarInput
     float curl;
 
     ppx::float2 normalizationScale;
+    uint32_t    parity;
+};
+
+static_assert(sizeof(ScalarInput) <= PPX_MINIMUM_UNIFORM_BUFFER_SIZE, "ScalarInput does not fit in a uniform buffer slot");
+
+/// @brief Ring of uniform buffer slots holding the shader inputs of a frame.
+///
+/// All slots live in a single persistently mapped buffer. grfx has no dynamic
+/// uniform buffer offsets, so each slot gets its own descriptor set pointing at
+/// its offset. These sets are written once, when the ring grows, which makes
+/// binding a slot as cheap as binding a dynamic offset.
+///
+/// Slots are only written while recording a frame, after the previous frame has
+/// completed on the GPU, so they can be reused every frame.
+class UniformRing
+{
+public:
+    UniformRing(FluidSimulation* sim)
+        : mSim(sim) {}
+
+    /// @brief Copy the given inputs into the next free slot, growing the ring if needed.
+    /// @return The slot the inputs were written to.
+    uint32_t Push(const ScalarInput& si);
+
+    /// @brief Make all the slots available again.
+    void Reset() { mSlotCount = 0; }
+
+    ppx::grfx::DescriptorSetPtr GetDescriptorSet(uint32_t slot) const { return mDescriptorSets[slot]; }
+
+private:
+    void Grow(uint32_t capacity);
+
+    FluidSimulation*                         mSim;
+    ppx::grfx::BufferPtr                     mBuffer;
+    char*                                    mMappedAddress = nullptr;
+    std::vector<ppx::grfx::DescriptorSetPtr> mDescriptorSets;
+    uint32_t                                 mSlotCount = 0;
+};
+
+// Binding slots of the textures used by compute shaders. This must match
+// assets/fluid_simulation/shaders/config.hlsli.
+constexpr uint32_t kFirstInputTextureBinding = 2;
+constexpr uint32_t kOutputTextureBinding     = 11;
+
+/// @brief Textures bound to a compute shader, used to look up its cached descriptor set.
+struct ComputeBindings
+{
+    std::array<Texture*, kOutputTextureBinding - kFirstInputTextureBinding> inputs = {};
+    Texture*                                                                output = nullptr;
+
+    bool operator<(const ComputeBindings& other) const
+    {
+        return std::tie(inputs, output) < std::tie(other.inputs, other.output);
+    }
 };
 
 class Shader
@@ -169,27 +261,27 @@ protected:
 
 // A dispatch record holds data needed to execute a compute shader.  The simulator will
 // sequence dispatch records so that they can all be executed inside a single frame.
-// Each record holds a pointer to the shader to execute, a uniform buffer with shader
-// inputs and a descriptor set.
+// Each record holds a pointer to the shader to execute, the uniform ring slot with the
+// shader inputs and the textures to bind.  Records own no GPU resources: the descriptor
+// set for the textures is looked up in a cache shared by all shaders when dispatching.
 class ComputeShader;
 struct ComputeDispatchRecord
 {
     ComputeDispatchRecord(ComputeShader* cs, Texture* output, const ScalarInput& si);
-    void FreeResources();
 
-    /// @brief Add a texture to sample from to the given descriptor set.
+    /// @brief Add a texture to sample from.
     /// @param texture      Texture to bind.
     /// @param inputBinding Binding slot to bind the texture in.
     void BindInputTexture(Texture* texture, uint32_t bindingSlot);
 
-    /// @brief Add the output texture to the given descriptor set.
+    /// @brief Add the output texture.
     /// @param bindingSlot  Binding slot to bind the texture in.
     void BindOutputTexture(uint32_t bindingSlot);
 
-    ComputeShader*              mShader;
-    ppx::grfx::BufferPtr        mUniformBuffer;
-    ppx::grfx::DescriptorSetPtr mDescriptorSet;
-    Texture*                    mOutput;
+    ComputeShader*  mShader;
+    Texture*        mOutput;
+    uint32_t        mUniformSlot;
+    ComputeBindings mBindings;
 };
 
 class ComputeShader : public Shader
@@ -200,7 +292,7 @@ public:
     /// @brief Run this shader using the given dispatch record, output texture and inputs.
     /// @param frame Frame to use.
     /// @param dr    Dispatch record to use.
-    void Dispatch(const PerFrame& frame, const std::unique_ptr<ComputeDispatchRecord>& dr);
+    void Dispatch(const PerFrame& frame, const ComputeDispatchRecord& dr);
 
 private:
     ppx::grfx::ComputePipelinePtr mPipeline;
@@ -212,7 +304,7 @@ public:
     AdvectionShader(FluidSimulation* sim)
         : ComputeShader(sim, "advection") {}
 
-    std::unique_ptr<ComputeDispatchRecord> GetDR(Texture* uVelocity, Texture* uSource, Texture* output, float delta, float dissipation, ppx::float2 texelSize, ppx::float2 dyeTexelSize)
+    ComputeDispatchRecord GetDR(Texture* uVelocity, Texture* uSource, Texture* output, float delta, float dissipation, ppx::float2 texelSize, ppx::float2 dyeTexelSize)
     {
         ScalarInput si(output);
         si.texelSize    = texelSize;
@@ -220,10 +312,10 @@ public:
         si.dissipation  = dissipation;
         si.dt           = delta;
 
-        auto dr = std::make_unique<ComputeDispatchRecord>(this, output, si);
-        dr->BindInputTexture(uVelocity, 3);
-        dr->BindInputTexture(uSource, 5);
-        dr->BindOutputTexture(11);
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindInputTexture(uVelocity, 3);
+        dr.BindInputTexture(uSource, 5);
+        dr.BindOutputTexture(11);
         return dr;
     }
 };
@@ -239,14 +331,14 @@ public:
     /// @param output       Texture to write to.
     /// @param texelSize    Texel size.
     /// @return The dispatch record to schedule.
-    std::unique_ptr<ComputeDispatchRecord> GetDR(Texture* uTexture, Texture* output, ppx::float2 texelSize)
+    ComputeDispatchRecord GetDR(Texture* uTexture, Texture* output, ppx::float2 texelSize)
     {
         ScalarInput si(output);
         si.texelSize = texelSize;
 
-        auto dr = std::make_unique<ComputeDispatchRecord>(this, output, si);
-        dr->BindInputTexture(uTexture, 2);
-        dr->BindOutputTexture(11);
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindInputTexture(uTexture, 2);
+        dr.BindOutputTexture(11);
         return dr;
     }
 };
@@ -261,14 +353,14 @@ public:
     /// @param uTexture     Texture to sample from.
     /// @param output       Texture to write to.
     /// @return The dispatch record to schedule.
-    std::unique_ptr<ComputeDispatchRecord> GetDR(Texture* uTexture, Texture* output, ppx::float2 texelSize)
+    ComputeDispatchRecord GetDR(Texture* uTexture, Texture* output, ppx::float2 texelSize)
     {
         ScalarInput si(output);
         si.texelSize = texelSize;
 
-        auto dr = std::make_unique<ComputeDispatchRecord>(this, output, si);
-        dr->BindInputTexture(uTexture, 2);
-        dr->BindOutputTexture(11);
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindInputTexture(uTexture, 2);
+        dr.BindOutputTexture(11);
         return dr;
     }
 };
@@ -284,15 +376,15 @@ public:
     /// @param output       Texture to write to.
     /// @param intensity    Intensity parameter.
     /// @return The dispatch record to schedule.
-    std::unique_ptr<ComputeDispatchRecord> GetDR(Texture* uTexture, Texture* output, ppx::float2 texelSize, float intensity)
+    ComputeDispatchRecord GetDR(Texture* uTexture, Texture* output, ppx::float2 texelSize, float intensity)
     {
         ScalarInput si(output);
         si.texelSize = texelSize;
         si.intensity = intensity;
 
-        auto dr = std::make_unique<ComputeDispatchRecord>(this, output, si);
-        dr->BindInputTexture(uTexture, 2);
-        dr->BindOutputTexture(11);
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindInputTexture(uTexture, 2);
+        dr.BindOutputTexture(11);
         return dr;
     }
 };
@@ -309,15 +401,15 @@ public:
     /// @param curve        Curve parameter.
     /// @param threshold    Threshold parameter.
     /// @return The dispatch record to schedule.
-    std::unique_ptr<ComputeDispatchRecord> GetDR(Texture* uTexture, Texture* output, ppx::float3 curve, float threshold)
+    ComputeDispatchRecord GetDR(Texture* uTexture, Texture* output, ppx::float3 curve, float threshold)
     {
         ScalarInput si(output);
         si.curve     = curve;
         si.threshold = threshold;
 
-        auto dr = std::make_unique<ComputeDispatchRecord>(this, output, si);
-        dr->BindInputTexture(uTexture, 2);
-        dr->BindOutputTexture(11);
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindInputTexture(uTexture, 2);
+        dr.BindOutputTexture(11);
         return dr;
     }
 };
@@ -332,14 +424,14 @@ public:
     /// @param uTexture     Texture to sample from.
     /// @param output       Texture to write to.
     /// @return The dispatch record to schedule.
-    std::unique_ptr<ComputeDispatchRecord> GetDR(Texture* uTexture, Texture* output, ppx::float2 texelSize)
+    ComputeDispatchRecord GetDR(Texture* uTexture, Texture* output, ppx::float2 texelSize)
     {
         ScalarInput si(output);
         si.texelSize = texelSize;
 
-        auto dr = std::make_unique<ComputeDispatchRecord>(this, output, si);
-        dr->BindInputTexture(uTexture, 2);
-        dr->BindOutputTexture(11);
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindInputTexture(uTexture, 2);
+        dr.BindOutputTexture(11);
         return dr;
     }
 };
@@ -354,13 +446,13 @@ public:
     /// @param output       Texture to write to.
     /// @param aspectRatio  Aspect ratio parameter.
     /// @return The dispatch record to schedule.
-    std::unique_ptr<ComputeDispatchRecord> GetDR(Texture* output, float aspectRatio)
+    ComputeDispatchRecord GetDR(Texture* output, float aspectRatio)
     {
         ScalarInput si(output);
         si.aspectRatio = aspectRatio;
 
-        auto dr = std::make_unique<ComputeDispatchRecord>(this, output, si);
-        dr->BindOutputTexture(11);
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindOutputTexture(11);
         return dr;
     }
 };
@@ -371,14 +463,14 @@ public:
     ClearShader(FluidSimulation* sim)
         : ComputeShader(sim, "clear") {}
 
-    std::unique_ptr<ComputeDispatchRecord> GetDR(Texture* uTexture, Texture* output, float clearValue)
+    ComputeDispatchRecord GetDR(Texture* uTexture, Texture* output, float clearValue)
     {
         ScalarInput si(output);
         si.clearValue = clearValue;
 
-        auto dr = std::make_unique<ComputeDispatchRecord>(this, output, si);
-        dr->BindInputTexture(uTexture, 2);
-        dr->BindOutputTexture(11);
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindInputTexture(uTexture, 2);
+        dr.BindOutputTexture(11);
         return dr;
     }
 };
@@ -393,13 +485,13 @@ public:
     /// @param output   Texture to write to.
     /// @param color    Color to write to the whole texture.
     /// @return The dispatch record to schedule.
-    std::unique_ptr<ComputeDispatchRecord> GetDR(Texture* output, ppx::float4 color)
+    ComputeDispatchRecord GetDR(Texture* output, ppx::float4 color)
     {
         ScalarInput si(output);
         si.color = color;
 
-        auto dr = std::make_unique<ComputeDispatchRecord>(this, output, si);
-        dr->BindOutputTexture(11);
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindOutputTexture(11);
         return dr;
     }
 };
@@ -410,14 +502,14 @@ public:
     CurlShader(FluidSimulation* sim)
         : ComputeShader(sim, "curl") {}
 
-    std::unique_ptr<ComputeDispatchRecord> GetDR(Texture* velocity, Texture* output, ppx::float2 texelSize)
+    ComputeDispatchRecord GetDR(Texture* velocity, Texture* output, ppx::float2 texelSize)
     {
         ScalarInput si(output);
         si.texelSize = texelSize;
 
-        auto dr = std::make_unique<ComputeDispatchRecord>(this, output, si);
-        dr->BindInputTexture(velocity, 3);
-        dr->BindOutputTexture(11);
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindInputTexture(velocity, 3);
+        dr.BindOutputTexture(11);
         return dr;
     }
 };
@@ -432,18 +524,18 @@ public:
     /// @param output   Texture to write to.
     /// @param color    Color to write to the whole texture.
     /// @return The dispatch record to schedule.
-    std::unique_ptr<ComputeDispatchRecord> GetDR(Texture* uTexture, Texture* uBloom, Texture* uSunrays, Texture* uDithering, Texture* output, ppx::float2 texelSize, ppx::float2 ditherScale)
+    ComputeDispatchRecord GetDR(Texture* uTexture, Texture* uBloom, Texture* uSunrays, Texture* uDithering, Texture* output, ppx::float2 texelSize, ppx::float2 ditherScale)
     {
         ScalarInput si(output);
         si.texelSize   = texelSize;
         si.ditherScale = ditherScale;
 
-        auto dr = std::make_unique<ComputeDispatchRecord>(this, output, si);
-        dr->BindInputTexture(uTexture, 2);
-        dr->BindInputTexture(uBloom, 6);
-        dr->BindInputTexture(uSunrays, 7);
-        dr->BindInputTexture(uDithering, 8);
-        dr->BindOutputTexture(11);
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindInputTexture(uTexture, 2);
+        dr.BindInputTexture(uBloom, 6);
+        dr.BindInputTexture(uSunrays, 7);
+        dr.BindInputTexture(uDithering, 8);
+        dr.BindOutputTexture(11);
         return dr;
     }
 };
@@ -454,14 +546,41 @@ public:
     DivergenceShader(FluidSimulation* sim)
         : ComputeShader(sim, "divergence") {}
 
-    std::unique_ptr<ComputeDispatchRecord> GetDR(Texture* uVelocity, Texture* output, ppx::float2 texelSize)
+    ComputeDispatchRecord GetDR(Texture* uVelocity, Texture* output, ppx::float2 texelSize)
+    {
+        ScalarInput si(output);
+        si.texelSize = texelSize;
+
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindInputTexture(uVelocity, 3);
+        dr.BindOutputTexture(11);
+        return dr;
+    }
+};
+
+class GaussSeidelShader : public ComputeShader
+{
+public:
+    GaussSeidelShader(FluidSimulation* sim)
+        : ComputeShader(sim, "gauss_seidel") {}
+
+    /// @brief Create a dispatch record to execute this shader instance.
+    /// @param uPressure    Pressure (or error, on coarse levels) to relax.
+    /// @param uDivergence  Right-hand side of the equation.
+    /// @param output       Texture to write to.
+    /// @param texelSize    Texel size.
+    /// @param parity       Relax cells where (x + y) % 2 == parity, copy the others.
+    /// @return The dispatch record to schedule.
+    ComputeDispatchRecord GetDR(Texture* uPressure, Texture* uDivergence, Texture* output, ppx::float2 texelSize, uint32_t parity)
     {
         ScalarInput si(output);
         si.texelSize = texelSize;
+        si.parity    = parity;
 
-        auto dr = std::make_unique<ComputeDispatchRecord>(this, output, si);
-        dr->BindInputTexture(uVelocity, 3);
-        dr->BindOutputTexture(11);
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindInputTexture(uPressure, 9);
+        dr.BindInputTexture(uDivergence, 10);
+        dr.BindOutputTexture(11);
         return dr;
     }
 };
@@ -472,15 +591,15 @@ public:
     GradientSubtractShader(FluidSimulation* sim)
         : ComputeShader(sim, "gradient_subtract") {}
 
-    std::unique_ptr<ComputeDispatchRecord> GetDR(Texture* uPressure, Texture* uVelocity, Texture* output, ppx::float2 texelSize)
+    ComputeDispatchRecord GetDR(Texture* uPressure, Texture* uVelocity, Texture* output, ppx::float2 texelSize)
     {
         ScalarInput si(output);
         si.texelSize = texelSize;
 
-        auto dr = std::make_unique<ComputeDispatchRecord>(this, output, si);
-        dr->BindInputTexture(uPressure, 9);
-        dr->BindInputTexture(uVelocity, 3);
-        dr->BindOutputTexture(11);
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindInputTexture(uPressure, 9);
+        dr.BindInputTexture(uVelocity, 3);
+        dr.BindOutputTexture(11);
         return dr;
     }
 };
@@ -491,15 +610,84 @@ public:
     PressureShader(FluidSimulation* sim)
         : ComputeShader(sim, "pressure") {}
 
-    std::unique_ptr<ComputeDispatchRecord> GetDR(Texture* uPressure, Texture* uDivergence, Texture* output, ppx::float2 texelSize)
+    ComputeDispatchRecord GetDR(Texture* uPressure, Texture* uDivergence, Texture* output, ppx::float2 texelSize)
+    {
+        ScalarInput si(output);
+        si.texelSize = texelSize;
+
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindInputTexture(uPressure, 9);
+        dr.BindInputTexture(uDivergence, 10);
+        dr.BindOutputTexture(11);
+        return dr;
+    }
+};
+
+class ProlongationShader : public ComputeShader
+{
+public:
+    ProlongationShader(FluidSimulation* sim)
+        : ComputeShader(sim, "prolongation") {}
+
+    /// @brief Create a dispatch record to execute this shader instance.
+    /// @param uPressure    Pressure (or error) of the fine level.
+    /// @param uError       Error computed on the next coarser level.
+    /// @param output       Texture to write the corrected pressure to.
+    /// @return The dispatch record to schedule.
+    ComputeDispatchRecord GetDR(Texture* uPressure, Texture* uError, Texture* output)
+    {
+        ScalarInput si(output);
+
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindInputTexture(uError, 2);
+        dr.BindInputTexture(uPressure, 9);
+        dr.BindOutputTexture(11);
+        return dr;
+    }
+};
+
+class ResidualShader : public ComputeShader
+{
+public:
+    ResidualShader(FluidSimulation* sim)
+        : ComputeShader(sim, "residual") {}
+
+    /// @brief Create a dispatch record to execute this shader instance.
+    /// @param uPressure    Current solution.
+    /// @param uDivergence  Right-hand side of the equation.
+    /// @param output       Texture to write the residual to.
+    /// @param texelSize    Texel size.
+    /// @return The dispatch record to schedule.
+    ComputeDispatchRecord GetDR(Texture* uPressure, Texture* uDivergence, Texture* output, ppx::float2 texelSize)
     {
         ScalarInput si(output);
         si.texelSize = texelSize;
 
-        auto dr = std::make_unique<ComputeDispatchRecord>(this, output, si);
-        dr->BindInputTexture(uPressure, 9);
-        dr->BindInputTexture(uDivergence, 10);
-        dr->BindOutputTexture(11);
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindInputTexture(uPressure, 9);
+        dr.BindInputTexture(uDivergence, 10);
+        dr.BindOutputTexture(11);
+        return dr;
+    }
+};
+
+class RestrictionShader : public ComputeShader
+{
+public:
+    RestrictionShader(FluidSimulation* sim)
+        : ComputeShader(sim, "restriction") {}
+
+    /// @brief Create a dispatch record to execute this shader instance.
+    /// @param uResidual    Residual of the fine level.
+    /// @param output       Right-hand side of the next coarser level.
+    /// @return The dispatch record to schedule.
+    ComputeDispatchRecord GetDR(Texture* uResidual, Texture* output)
+    {
+        ScalarInput si(output);
+
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindInputTexture(uResidual, 2);
+        dr.BindOutputTexture(11);
         return dr;
     }
 };
@@ -519,7 +707,7 @@ public:
     /// @param radius       Radius shader parameter.
     /// @param color        Color shader parameter.
     /// @return The dispatch record to schedule.
-    std::unique_ptr<ComputeDispatchRecord> GetDR(Texture* uTexture, Texture* output, ppx::float2 coordinate, float aspectRatio, float radius, ppx::float4 color)
+    ComputeDispatchRecord GetDR(Texture* uTexture, Texture* output, ppx::float2 coordinate, float aspectRatio, float radius, ppx::float4 color)
     {
         ScalarInput si(output);
         si.coordinate  = coordinate;
@@ -527,9 +715,9 @@ public:
         si.radius      = radius;
         si.color       = color;
 
-        auto dr = std::make_unique<ComputeDispatchRecord>(this, output, si);
-        dr->BindInputTexture(uTexture, 2);
-        dr->BindOutputTexture(11);
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindInputTexture(uTexture, 2);
+        dr.BindOutputTexture(11);
         return dr;
     }
 };
@@ -544,13 +732,13 @@ public:
     /// @param uTexture     Texture to sample from.
     /// @param output       Texture to write to.
     /// @return The dispatch record to schedule.
-    std::unique_ptr<ComputeDispatchRecord> GetDR(Texture* uTexture, Texture* output)
+    ComputeDispatchRecord GetDR(Texture* uTexture, Texture* output)
     {
         ScalarInput si(output);
 
-        auto dr = std::make_unique<ComputeDispatchRecord>(this, output, si);
-        dr->BindInputTexture(uTexture, 2);
-        dr->BindOutputTexture(11);
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindInputTexture(uTexture, 2);
+        dr.BindOutputTexture(11);
         return dr;
     }
 };
@@ -566,14 +754,14 @@ public:
     /// @param output       Texture to write to.
     /// @param weight       Weight parameter.
     /// @return The dispatch record to schedule.
-    std::unique_ptr<ComputeDispatchRecord> GetDR(Texture* uTexture, Texture* output, float weight)
+    ComputeDispatchRecord GetDR(Texture* uTexture, Texture* output, float weight)
     {
         ScalarInput si(output);
         si.weight = weight;
 
-        auto dr = std::make_unique<ComputeDispatchRecord>(this, output, si);
-        dr->BindInputTexture(uTexture, 2);
-        dr->BindOutputTexture(11);
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindInputTexture(uTexture, 2);
+        dr.BindOutputTexture(11);
         return dr;
     }
 };
@@ -584,16 +772,16 @@ public:
     VorticityShader(FluidSimulation* sim)
         : ComputeShader(sim, "vorticity") {}
 
-    std::unique_ptr<ComputeDispatchRecord> GetDR(Texture* uVelocity, Texture* uCurl, Texture* output, ppx::float2 texelSize, float curl, float delta)
+    ComputeDispatchRecord GetDR(Texture* uVelocity, Texture* uCurl, Texture* output, ppx::float2 texelSize, float curl, float delta)
     {
         ScalarInput si(output);
         si.curl = curl;
         si.dt   = delta;
 
-        auto dr = std::make_unique<ComputeDispatchRecord>(this, output, si);
-        dr->BindInputTexture(uVelocity, 3);
-        dr->BindInputTexture(uCurl, 4);
-        dr->BindOutputTexture(11);
+        ComputeDispatchRecord dr(this, output, si);
+        dr.BindInputTexture(uVelocity, 3);
+        dr.BindInputTexture(uCurl, 4);
+        dr.BindOutputTexture(11);
         return dr;
     }
 };
@@ -601,12 +789,11 @@ public:
 // A dispatch record holds data needed to execute a graphic shader.  The simulator will
 // sequence dispatch records so that they can all be executed inside a single frame.
 // Each record holds a pointer to the shader to execute, a descriptor set and the texture
-// to present.
+// to present.  Records are owned by their shader and reused across frames.
 class GraphicsShader;
 struct GraphicsDispatchRecord
 {
     GraphicsDispatchRecord(GraphicsShader* gs, Texture* image, ppx::float2 coord);
-    void FreeResources();
 
     GraphicsShader*             mShader;
     ppx::grfx::DescriptorSetPtr mDescriptorSet;
@@ -622,19 +809,20 @@ public:
     /// @brief Draw the given texture.
     /// @param frame        Frame to use.
     /// @param dr           GraphicsDispatchRecord instance to use for setting up the pipeline.
-    void Dispatch(const PerFrame& frame, const std::unique_ptr<GraphicsDispatchRecord>& dr);
+    void Dispatch(const PerFrame& frame, GraphicsDispatchRecord* dr);
 
-    /// @brief Create a dispatch record to execute this shader instance.
+    /// @brief Get the dispatch record to execute this shader instance, creating it
+    ///        the first time a texture is drawn at the given coordinate.
     /// @param image    Texture to draw.
     /// @param coord    Normalized coordinate where to draw the texture.
     /// @return The dispatch record to schedule.
-    std::unique_ptr<GraphicsDispatchRecord> GetDR(Texture* image, ppx::float2 coord)
-    {
-        return std::make_unique<GraphicsDispatchRecord>(this, image, coord);
-    }
+    GraphicsDispatchRecord* GetDR(Texture* image, ppx::float2 coord);
 
 private:
-    ppx::grfx::GraphicsPipelinePtr mPipeline;
+    using RecordKey = std::tuple<Texture*, float, float>;
+
+    ppx::grfx::GraphicsPipelinePtr                               mPipeline;
+    std::map<RecordKey, std::unique_ptr<GraphicsDispatchRecord>> mRecords;
 };
 
 } // namespace FluidSim
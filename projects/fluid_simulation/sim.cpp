@@ -12,6 +12,7 @@
 #include "ppx/application.h"
 #include "ppx/config.h"
 #include "ppx/grfx/grfx_format.h"
+#include "ppx/timer.h"
 
 #include <algorithm>
 #include <cmath>
@@ -68,10 +69,10 @@ FluidSimulation::FluidSimulation(ProjApp* app)
 
 void FluidSimulation::InitComputeShaders()
 {
-    // Descriptor set layout.  This must match assets/fluid_simulation/shaders/config.hlsli and it
-    // is shared across all ComputeShader instances.
+    // Descriptor set layouts.  These must match assets/fluid_simulation/shaders/config.hlsli and
+    // are shared across all ComputeShader instances.  Shader inputs live in their own set so that
+    // the texture sets can be cached and the inputs sub-allocated from the uniform ring.
     ppx::grfx::DescriptorSetLayoutCreateInfo lci = {};
-    lci.bindings.push_back(ppx::grfx::DescriptorBinding(0, ppx::grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER));
     lci.bindings.push_back(ppx::grfx::DescriptorBinding(1, ppx::grfx::DESCRIPTOR_TYPE_SAMPLER));
     lci.bindings.push_back(ppx::grfx::DescriptorBinding(2, ppx::grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE));
     lci.bindings.push_back(ppx::grfx::DescriptorBinding(3, ppx::grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE));
@@ -86,13 +87,22 @@ void FluidSimulation::InitComputeShaders()
     lci.bindings.push_back(ppx::grfx::DescriptorBinding(12, ppx::grfx::DESCRIPTOR_TYPE_SAMPLER));
     PPX_CHECKED_CALL(GetApp()->GetDevice()->CreateDescriptorSetLayout(&lci, &mCompute.mDescriptorSetLayout));
 
+    lci = {};
+    lci.bindings.push_back(ppx::grfx::DescriptorBinding(0, ppx::grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER));
+    PPX_CHECKED_CALL(GetApp()->GetDevice()->CreateDescriptorSetLayout(&lci, &mCompute.mUniformSetLayout));
+
     // Compute pipeline interface.
     ppx::grfx::PipelineInterfaceCreateInfo pici = {};
-    pici.setCount                               = 1;
+    pici.setCount                               = 2;
     pici.sets[0].set                            = 0;
     pici.sets[0].pLayout                        = mCompute.mDescriptorSetLayout;
+    pici.sets[1].set                            = 1;
+    pici.sets[1].pLayout                        = mCompute.mUniformSetLayout;
     PPX_CHECKED_CALL(GetApp()->GetDevice()->CreatePipelineInterface(&pici, &mCompute.mPipelineInterface));
 
+    // Shader inputs of every compute dispatch.
+    mUniformRing = std::make_unique<UniformRing>(this);
+
     // Compute sampler.
     ppx::grfx::SamplerCreateInfo sci = {};
     sci.magFilter                    = ppx::grfx::FILTER_LINEAR;
@@ -129,46 +139,161 @@ void FluidSimulation::InitComputeShaders()
     mCurl              = std::make_unique<CurlShader>(this);
     mDisplay           = std::make_unique<DisplayShader>(this);
     mDivergence        = std::make_unique<DivergenceShader>(this);
+    mGaussSeidel       = std::make_unique<GaussSeidelShader>(this);
     mGradientSubtract  = std::make_unique<GradientSubtractShader>(this);
     mPressure          = std::make_unique<PressureShader>(this);
+    mProlongation      = std::make_unique<ProlongationShader>(this);
+    mResidual          = std::make_unique<ResidualShader>(this);
+    mRestriction       = std::make_unique<RestrictionShader>(this);
     mSplat             = std::make_unique<SplatShader>(this);
     mSunraysMask       = std::make_unique<SunraysMaskShader>(this);
     mSunrays           = std::make_unique<SunraysShader>(this);
     mVorticity         = std::make_unique<VorticityShader>(this);
 }
 
+ppx::grfx::DescriptorSetPtr FluidSimulation::GetComputeDescriptorSet(const ComputeBindings& bindings)
+{
+    ppx::grfx::DescriptorSetPtr& set = mComputeDescriptorSets[bindings];
+    if (set) {
+        return set;
+    }
+
+    PPX_LOG_DEBUG("Creating compute descriptor set #" << mComputeDescriptorSets.size());
+    PPX_CHECKED_CALL(GetApp()->GetDevice()->AllocateDescriptorSet(mDescriptorPool, mCompute.mDescriptorSetLayout, &set));
+
+    std::vector<ppx::grfx::WriteDescriptor> writes;
+
+    ppx::grfx::WriteDescriptor write = {};
+    write.binding                    = 1;
+    write.type                       = ppx::grfx::DESCRIPTOR_TYPE_SAMPLER;
+    write.pSampler                   = mCompute.mClampSampler;
+    writes.push_back(write);
+
+    write          = {};
+    write.binding  = 12;
+    write.type     = ppx::grfx::DESCRIPTOR_TYPE_SAMPLER;
+    write.pSampler = mCompute.mRepeatSampler;
+    writes.push_back(write);
+
+    for (uint32_t i = 0; i < static_cast<uint32_t>(bindings.inputs.size()); ++i) {
+        if (bindings.inputs[i] == nullptr) {
+            continue;
+        }
+        write            = {};
+        write.binding    = kFirstInputTextureBinding + i;
+        write.type       = ppx::grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        write.pImageView = bindings.inputs[i]->GetSampledView();
+        writes.push_back(write);
+    }
+
+    if (bindings.output != nullptr) {
+        write            = {};
+        write.binding    = kOutputTextureBinding;
+        write.type       = ppx::grfx::DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        write.pImageView = bindings.output->GetStorageView();
+        writes.push_back(write);
+    }
+
+    PPX_CHECKED_CALL(set->UpdateDescriptors(static_cast<uint32_t>(writes.size()), writes.data()));
+    return set;
+}
+
 void FluidSimulation::DispatchComputeShaders(const PerFrame& frame)
 {
-    for (auto& dr : mComputeDispatchQueue) {
-        dr->mShader->Dispatch(frame, dr);
+    for (const auto& dr : mComputeDispatchQueue) {
+        dr.mShader->Dispatch(frame, dr);
+    }
+
+    if (mResidualScheduled) {
+        mResidualReadback->Record(frame, mResidualTexture.get());
+        mResidualScheduled = false;
+    }
+
+    // The state after the step, read back for the CPU reference solver.
+    if (mValidationScheduled) {
+        mVelocityReadback->Record(frame, mVelocityTexture[0].get());
+        mDyeReadback->Record(frame, mDyeTexture[0].get());
+        mPressureReadback->Record(frame, mPressureTexture[0].get());
+        mValidationScheduled = false;
     }
 }
 
-void FluidSimulation::FreeComputeShaderResources()
+void FluidSimulation::ReadPressureResidual()
 {
-    // Wait for any command buffers in-flight before freeing up resources.
-    GetApp()->GetDevice()->WaitIdle();
-    for (auto& shader : mComputeDispatchQueue) {
-        shader->FreeResources();
+    // Only called once the frame that recorded the copy has completed.
+    ppx::Bitmap residual;
+    mResidualReadback->Read(&residual);
+
+    double sum = 0.0;
+    for (uint32_t y = 0; y < residual.GetHeight(); ++y) {
+        const float* pRow = reinterpret_cast<const float*>(residual.GetPixelAddress(0, y));
+        for (uint32_t x = 0; x < residual.GetWidth(); ++x) {
+            sum += static_cast<double>(pRow[x]) * pRow[x];
+        }
     }
-    mComputeDispatchQueue.clear();
+    mPressureResidual = static_cast<float>(std::sqrt(sum / (static_cast<double>(residual.GetWidth()) * residual.GetHeight())));
+}
+
+void FluidSimulation::ValidateStep()
+{
+    // Only called once the frame that recorded the copies has completed.
+    ppx::Bitmap velocity;
+    ppx::Bitmap dye;
+    ppx::Bitmap pressure;
+    mVelocityReadback->Read(&velocity);
+    mDyeReadback->Read(&dye);
+    mPressureReadback->Read(&pressure);
+
+    // The first readback only provides the state the next step starts from.
+    if (mHasGpuState) {
+        PPX_CHECKED_CALL(mCpuSolver->SetState(mGpuVelocity, mGpuDye, mGpuPressure));
+
+        ppx::Timer timer;
+        timer.Start();
+        for (const CpuSplat& splat : mValidationSplats) {
+            mCpuSolver->Splat(splat);
+        }
+        mCpuSolver->Step(mValidationStep);
+        double elapsedMs   = timer.MillisSinceStart();
+        mCpuStepsPerSecond = (elapsedMs > 0.0) ? static_cast<float>(1000.0 / elapsedMs) : 0.0f;
+
+        ppx::Bitmap cpuVelocity;
+        ppx::Bitmap cpuDye;
+        ppx::Bitmap cpuPressure;
+        mCpuSolver->GetState(&cpuVelocity, &cpuDye, &cpuPressure);
+
+        FieldError velocityError = CompareFields(cpuVelocity, velocity);
+        FieldError dyeError      = CompareFields(cpuDye, dye);
+        FieldError pressureError = CompareFields(cpuPressure, pressure);
+        mCpuValidationError      = std::max({velocityError.relativeRms, dyeError.relativeRms, pressureError.relativeRms});
+
+        if (mCpuValidationError > GetConfig().pCpuValidationTolerance->GetValue()) {
+            ++mCpuValidationFailures;
+            PPX_LOG_ERROR("CPU validation failed (" << mCpuValidationFailures << " steps so far): relative RMS error of velocity " << velocityError.relativeRms << ", dye " << dyeError.relativeRms << ", pressure " << pressureError.relativeRms << "; largest absolute error of velocity " << velocityError.maxAbsolute << ", dye " << dyeError.maxAbsolute << ", pressure " << pressureError.maxAbsolute);
+        }
+    }
+
+    mGpuVelocity = std::move(velocity);
+    mGpuDye      = std::move(dye);
+    mGpuPressure = std::move(pressure);
+    mHasGpuState = true;
+    mValidationSplats.clear();
 }
 
 void FluidSimulation::DispatchGraphicsShaders(const PerFrame& frame)
 {
-    for (auto& dr : mGraphicsDispatchQueue) {
+    for (auto* dr : mGraphicsDispatchQueue) {
         dr->mShader->Dispatch(frame, dr);
     }
 }
 
-void FluidSimulation::FreeGraphicsShaderResources()
+void FluidSimulation::ClearDispatchQueues()
 {
-    // Wait for any command buffers in-flight before freeing up resources.
-    GetApp()->GetDevice()->WaitIdle();
-    for (auto& shader : mGraphicsDispatchQueue) {
-        shader->FreeResources();
-    }
+    // Both queues keep their capacity, so scheduling the same chain of shaders next
+    // frame does not allocate.
+    mComputeDispatchQueue.clear();
     mGraphicsDispatchQueue.clear();
+    mUniformRing->Reset();
 }
 
 void FluidSimulation::InitGraphicsShaders()
@@ -229,7 +354,21 @@ void FluidSimulation::InitTextures()
     mVelocityTexture[0]  = std::make_unique<Texture>(this, "velocity[0]", simRes.x, simRes.y, kRG);
     mVelocityTexture[1]  = std::make_unique<Texture>(this, "velocity[1]", simRes.x, simRes.y, kRG);
 
+    // Read back as 32-bit floats, so it is never sampled with filtering.
+    mResidualTexture  = std::make_unique<Texture>(this, "residual", simRes.x, simRes.y, ppx::grfx::FORMAT_R32_FLOAT);
+    mResidualReadback = std::make_unique<TextureReadback>(this);
+
+    if (GetConfig().pCpuValidation->GetValue()) {
+        mJobSystem.Initialize(ppx::JobSystem::GetDefaultWorkerCount());
+        mCpuSolver = std::make_unique<CpuFluidSolver>();
+        mCpuSolver->Initialize(ppx::uint2(simRes.x, simRes.y), ppx::uint2(dyeRes.x, dyeRes.y), &mJobSystem);
+        mVelocityReadback = std::make_unique<TextureReadback>(this);
+        mDyeReadback      = std::make_unique<TextureReadback>(this);
+        mPressureReadback = std::make_unique<TextureReadback>(this);
+    }
+
     InitBloomTextures();
+    InitMultigridTextures();
     InitSunraysTextures();
 }
 
@@ -247,6 +386,27 @@ void FluidSimulation::InitBloomTextures()
     }
 }
 
+void FluidSimulation::InitMultigridTextures()
+{
+    // Compute the size of every level first: the coarsest level has no residual.
+    std::vector<ppx::uint2> sizes = GetMultigridLevelSizes(mPressureTexture[0]->GetWidth(), mPressureTexture[0]->GetHeight());
+
+    PPX_ASSERT_MSG(mMultigridLevels.empty(), "Multigrid textures already initialized");
+    mMultigridLevels.resize(sizes.size());
+    for (size_t i = 0; i < sizes.size(); i++) {
+        std::string     suffix = "[" + std::to_string(i) + "]";
+        MultigridLevel& level  = mMultigridLevels[i];
+        if (i > 0) {
+            level.error[0] = std::make_unique<Texture>(this, "multigrid error[0]" + suffix, sizes[i].x, sizes[i].y, kR);
+            level.error[1] = std::make_unique<Texture>(this, "multigrid error[1]" + suffix, sizes[i].x, sizes[i].y, kR);
+            level.rhs      = std::make_unique<Texture>(this, "multigrid rhs" + suffix, sizes[i].x, sizes[i].y, kR);
+        }
+        if (i + 1 < sizes.size()) {
+            level.residual = std::make_unique<Texture>(this, "multigrid residual" + suffix, sizes[i].x, sizes[i].y, kR);
+        }
+    }
+}
+
 void FluidSimulation::InitSunraysTextures()
 {
     ppx::int2 res       = GetResolution(GetConfig().pSunraysResolution->GetValue());
@@ -314,6 +474,9 @@ void FluidSimulation::Splat(ppx::float2 point, ppx::float2 delta, ppx::float3 co
     float       aspect     = GetApp()->GetWindowAspect();
     float       radius     = CorrectRadius(GetConfig().pSplatRadius->GetValue() / 100.0f);
     ppx::float4 deltaColor = ppx::float4(delta.x, delta.y, 0.0f, 1.0f);
+    if (mCpuSolver) {
+        mValidationSplats.push_back({point, delta, color, aspect, radius});
+    }
     ScheduleDR(mSplat->GetDR(mVelocityTexture[0].get(), mVelocityTexture[1].get(), point, aspect, radius, deltaColor));
     std::swap(mVelocityTexture[0], mVelocityTexture[1]);
 
@@ -459,6 +622,14 @@ void FluidSimulation::DrawTextures()
 
 void FluidSimulation::Update()
 {
+    // The previous frame has completed, so its residual can be read back.
+    if (mResidualReadback->IsPending()) {
+        ReadPressureResidual();
+    }
+    if (mCpuSolver && mVelocityReadback->IsPending()) {
+        ValidateStep();
+    }
+
     // If the marble has been selected, move it around and drop it at random.
     if (GetConfig().pEnableMarble->GetValue()) {
         MoveMarble();
@@ -507,6 +678,56 @@ void FluidSimulation::MoveMarble()
     }
 }
 
+void FluidSimulation::SolvePressureJacobi()
+{
+    ppx::float2 texelSize = mPressureTexture[0]->GetTexelSize();
+    for (uint32_t i = 0; i < GetConfig().pPressureIterations->GetValue(); ++i) {
+        ScheduleDR(mPressure->GetDR(mPressureTexture[0].get(), mDivergenceTexture.get(), mPressureTexture[1].get(), texelSize));
+        std::swap(mPressureTexture[0], mPressureTexture[1]);
+    }
+}
+
+void FluidSimulation::SolvePressureMultigrid()
+{
+    for (uint32_t i = 0; i < GetConfig().pMultigridCycles->GetValue(); ++i) {
+        VCycle(0, mPressureTexture, mDivergenceTexture.get());
+    }
+}
+
+void FluidSimulation::SmoothPressure(std::unique_ptr<Texture>* pressure, Texture* rhs, uint32_t sweeps)
+{
+    ppx::float2 texelSize = pressure[0]->GetTexelSize();
+    for (uint32_t i = 0; i < sweeps; ++i) {
+        for (uint32_t parity = 0; parity < 2; ++parity) {
+            ScheduleDR(mGaussSeidel->GetDR(pressure[0].get(), rhs, pressure[1].get(), texelSize, parity));
+            std::swap(pressure[0], pressure[1]);
+        }
+    }
+}
+
+void FluidSimulation::VCycle(uint32_t level, std::unique_ptr<Texture>* pressure, Texture* rhs)
+{
+    if (level + 1 == mMultigridLevels.size()) {
+        SmoothPressure(pressure, rhs, kMultigridCoarsestSweeps);
+        return;
+    }
+
+    SmoothPressure(pressure, rhs, kMultigridSmoothingSweeps);
+
+    // Solve for the error of this level on the next coarser one, starting from zero.
+    Texture*        residual = mMultigridLevels[level].residual.get();
+    MultigridLevel& coarse   = mMultigridLevels[level + 1];
+    ScheduleDR(mResidual->GetDR(pressure[0].get(), rhs, residual, residual->GetTexelSize()));
+    ScheduleDR(mRestriction->GetDR(residual, coarse.rhs.get()));
+    ScheduleDR(mColor->GetDR(coarse.error[0].get(), ppx::float4(0.0f, 0.0f, 0.0f, 0.0f)));
+    VCycle(level + 1, coarse.error, coarse.rhs.get());
+
+    ScheduleDR(mProlongation->GetDR(pressure[0].get(), coarse.error[0].get(), pressure[1].get()));
+    std::swap(pressure[0], pressure[1]);
+
+    SmoothPressure(pressure, rhs, kMultigridSmoothingSweeps);
+}
+
 void FluidSimulation::Step(float delta)
 {
     ppx::float2 texelSize = mVelocityTexture[0]->GetTexelSize();
@@ -521,9 +742,17 @@ void FluidSimulation::Step(float delta)
     ScheduleDR(mClear->GetDR(mPressureTexture[0].get(), mPressureTexture[1].get(), GetConfig().pPressure->GetValue()));
     std::swap(mPressureTexture[0], mPressureTexture[1]);
 
-    for (uint32_t i = 0; i < GetConfig().pPressureIterations->GetValue(); ++i) {
-        ScheduleDR(mPressure->GetDR(mPressureTexture[0].get(), mDivergenceTexture.get(), mPressureTexture[1].get(), texelSize));
-        std::swap(mPressureTexture[0], mPressureTexture[1]);
+    if (GetConfig().pPressureSolver->GetValue() == "multigrid") {
+        SolvePressureMultigrid();
+    }
+    else {
+        SolvePressureJacobi();
+    }
+
+    // The residual is only needed for metrics and costs a readback.
+    if (GetApp()->HasActiveMetricsRun()) {
+        ScheduleDR(mResidual->GetDR(mPressureTexture[0].get(), mDivergenceTexture.get(), mResidualTexture.get(), texelSize));
+        mResidualScheduled = true;
     }
 
     ScheduleDR(mGradientSubtract->GetDR(mPressureTexture[0].get(), mVelocityTexture[0].get(), mVelocityTexture[1].get(), texelSize));
@@ -534,6 +763,18 @@ void FluidSimulation::Step(float delta)
 
     ScheduleDR(mAdvection->GetDR(mVelocityTexture[0].get(), mDyeTexture[0].get(), mDyeTexture[1].get(), delta, GetConfig().pDensityDissipation->GetValue(), texelSize, mDyeTexture[0]->GetTexelSize()));
     std::swap(mDyeTexture[0], mDyeTexture[1]);
+
+    if (mCpuSolver) {
+        mValidationStep.dt                  = delta;
+        mValidationStep.curl                = GetConfig().pCurl->GetValue();
+        mValidationStep.pressure            = GetConfig().pPressure->GetValue();
+        mValidationStep.velocityDissipation = GetConfig().pVelocityDissipation->GetValue();
+        mValidationStep.densityDissipation  = GetConfig().pDensityDissipation->GetValue();
+        mValidationStep.multigrid           = GetConfig().pPressureSolver->GetValue() == "multigrid";
+        mValidationStep.pressureIterations  = GetConfig().pPressureIterations->GetValue();
+        mValidationStep.multigridCycles     = GetConfig().pMultigridCycles->GetValue();
+        mValidationScheduled                = true;
+    }
 }
 
 } // namespace FluidSim
@@ -8,10 +8,14 @@
 #ifndef FLUID_SIMULATION_SIM_H
 #define FLUID_SIMULATION_SIM_H
 
+#include "cpu_solver.h"
 #include "shaders.h"
 
 #include "ppx/application.h"
+#include "ppx/bitmap.h"
+#include "ppx/job_system.h"
 #include "ppx/knob.h"
+#include "ppx/metrics.h"
 #include "ppx/math_config.h"
 #include "ppx/random.h"
 
@@ -28,6 +32,9 @@ struct SimulationConfig
     std::shared_ptr<ppx::KnobSlider<float>> pPressure;
     std::shared_ptr<ppx::KnobSlider<int>>   pPressureIterations;
     std::shared_ptr<ppx::KnobSlider<float>> pVelocityDissipation;
+    // Pressure solver
+    std::shared_ptr<ppx::KnobDropdown<std::string>> pPressureSolver;
+    std::shared_ptr<ppx::KnobSlider<int>>           pMultigridCycles;
     // Bloom
     std::shared_ptr<ppx::KnobCheckbox>      pEnableBloom;
     std::shared_ptr<ppx::KnobSlider<float>> pBloomIntensity;
@@ -50,10 +57,26 @@ struct SimulationConfig
     std::shared_ptr<ppx::KnobSlider<float>> pSunraysWeight;
     // Misc
     std::shared_ptr<ppx::KnobSlider<int>> pSimResolution;
+    // Validation
+    std::shared_ptr<ppx::KnobCheckbox>      pCpuValidation;
+    std::shared_ptr<ppx::KnobSlider<float>> pCpuValidationTolerance;
 
     ppx::float4 backColor = {0.0f, 0.0f, 0.0f, 1.0f};
 };
 
+/// @brief Textures of one level of the multigrid pressure solver.
+///
+/// Level 0 solves for the simulation pressure and divergence textures, so it
+/// only owns a residual. Coarser levels solve for the error of the level above
+/// and own the ping-pong textures of that error and its right-hand side. The
+/// coarsest level has no residual.
+struct MultigridLevel
+{
+    std::unique_ptr<Texture> error[2];
+    std::unique_ptr<Texture> rhs;
+    std::unique_ptr<Texture> residual;
+};
+
 /// @brief Represents a virtual object bouncing around the field.
 struct Bouncer
 {
@@ -74,25 +97,42 @@ public:
     ComputeResources*            GetComputeResources() { return &mCompute; }
     GraphicsResources*           GetGraphicsResources() { return &mGraphics; }
     PerFrame&                    GetFrame(size_t ix) { return mPerFrame[ix]; }
+    UniformRing*                 GetUniformRing() { return mUniformRing.get(); }
+
+    /// @brief Get the descriptor set binding the given textures to a compute shader.
+    ///
+    /// Sets are created the first time a combination of textures is used and then
+    /// reused. The simulation ping-pongs between a fixed set of textures, so after a
+    /// few frames no new sets are allocated.
+    ppx::grfx::DescriptorSetPtr GetComputeDescriptorSet(const ComputeBindings& bindings);
 
     /// @brief Generate the initial splash of color.
     void GenerateInitialSplat();
 
-    /// @brief Execute all the scheduled compute shaders in sequence.
+    /// @brief Execute all the scheduled compute shaders in sequence.  This also records
+    /// the readback of the pressure residual when it was scheduled.
     void DispatchComputeShaders(const PerFrame& frame);
 
-    /// @brief Free descriptor sets and uniform buffers used by compute shaders. This
-    /// also clears the execution schedule.
-    ///
-    /// TODO(https://github.com/google/bigwheels/issues/26): Implement resource pool.
-    void FreeComputeShaderResources();
+    /// @brief Root mean square of the residual of the pressure equation after the last
+    /// solve that was read back.  The residual is only computed while a metrics run is
+    /// active and is read back one frame late.
+    float GetPressureResidual() const { return mPressureResidual; }
+
+    /// @brief Largest relative RMS difference between the GPU and the CPU reference
+    /// over the velocity, dye and pressure of the last validated step.  Steps are
+    /// only validated with the cpu-validation knob and are validated one frame late.
+    float GetCpuValidationError() const { return mCpuValidationError; }
+
+    /// @brief Steps per second of the CPU reference solver over the last validated step.
+    float GetCpuStepsPerSecond() const { return mCpuStepsPerSecond; }
 
     /// @brief Execute all the scheduled graphics shaders in sequence.
     void DispatchGraphicsShaders(const PerFrame& frame);
 
-    /// @brief Free descriptor sets used by graphics shaders. This also clears
-    /// the execution schedule.
-    void FreeGraphicsShaderResources();
+    /// @brief Clear the execution schedules and release the uniform ring slots.
+    /// Descriptor sets and buffers are kept for the next frame, which must not
+    /// start recording before the GPU is done with this one.
+    void ClearDispatchQueues();
 
     /// @brief Register the given texture to be filled with an initial color.
     /// @param texture Texture to initialize.
@@ -118,6 +158,12 @@ private:
     // Graphics resources (pipeline interface, descriptor layout, sampler, etc).
     GraphicsResources mGraphics;
 
+    // Shader inputs of the scheduled compute shaders.
+    std::unique_ptr<UniformRing> mUniformRing;
+
+    // Descriptor sets of compute shaders, keyed by the textures they bind.
+    std::map<ComputeBindings, ppx::grfx::DescriptorSetPtr> mComputeDescriptorSets;
+
     // Textures used for filtering.
     std::unique_ptr<Texture>              mBloomTexture;
     std::vector<std::unique_ptr<Texture>> mBloomTextures;
@@ -129,10 +175,39 @@ private:
     std::unique_ptr<Texture>              mDrawColorTexture;
     std::unique_ptr<Texture>              mDyeTexture[2];
     std::unique_ptr<Texture>              mPressureTexture[2];
+    std::unique_ptr<Texture>              mResidualTexture;
     std::unique_ptr<Texture>              mSunraysTempTexture;
     std::unique_ptr<Texture>              mSunraysTexture;
     std::unique_ptr<Texture>              mVelocityTexture[2];
 
+    // Multigrid pyramid, level 0 is the simulation grid.
+    std::vector<MultigridLevel> mMultigridLevels;
+
+    // Readback of mResidualTexture.
+    std::unique_ptr<TextureReadback> mResidualReadback;
+    bool                             mResidualScheduled = false;
+    float                            mPressureResidual  = 0.0f;
+
+    // CPU reference solver, only created with the cpu-validation knob.  Every frame
+    // reads back the GPU state after its step.  The next frame replays the splats
+    // and step of that frame on the CPU from the previous state and compares the
+    // results, so each step is validated on its own and errors do not accumulate.
+    ppx::JobSystem                   mJobSystem;
+    std::unique_ptr<CpuFluidSolver>  mCpuSolver;
+    std::unique_ptr<TextureReadback> mVelocityReadback;
+    std::unique_ptr<TextureReadback> mDyeReadback;
+    std::unique_ptr<TextureReadback> mPressureReadback;
+    std::vector<CpuSplat>            mValidationSplats;
+    CpuStepParams                    mValidationStep;
+    ppx::Bitmap                      mGpuVelocity;
+    ppx::Bitmap                      mGpuDye;
+    ppx::Bitmap                      mGpuPressure;
+    bool                             mValidationScheduled   = false;
+    bool                             mHasGpuState           = false;
+    float                            mCpuValidationError    = 0.0f;
+    float                            mCpuStepsPerSecond     = 0.0f;
+    uint32_t                         mCpuValidationFailures = 0;
+
     // Compute shader filters.
     std::unique_ptr<AdvectionShader>         mAdvection;
     std::unique_ptr<BloomBlurShader>         mBloomBlur;
@@ -146,8 +221,12 @@ private:
     std::unique_ptr<CurlShader>              mCurl;
     std::unique_ptr<DisplayShader>           mDisplay;
     std::unique_ptr<DivergenceShader>        mDivergence;
+    std::unique_ptr<GaussSeidelShader>       mGaussSeidel;
     std::unique_ptr<GradientSubtractShader>  mGradientSubtract;
     std::unique_ptr<PressureShader>          mPressure;
+    std::unique_ptr<ProlongationShader>      mProlongation;
+    std::unique_ptr<ResidualShader>          mResidual;
+    std::unique_ptr<RestrictionShader>       mRestriction;
     std::unique_ptr<SplatShader>             mSplat;
     std::unique_ptr<SunraysMaskShader>       mSunraysMask;
     std::unique_ptr<SunraysShader>           mSunrays;
@@ -156,11 +235,11 @@ private:
     // Graphics shader for emitting textures to the swapchain.
     std::unique_ptr<GraphicsShader> mDraw;
 
-    // Queue of compute shaders to execute.
-    std::vector<std::unique_ptr<ComputeDispatchRecord>> mComputeDispatchQueue;
+    // Queue of compute shaders to execute. Cleared every frame, keeping its capacity.
+    std::vector<ComputeDispatchRecord> mComputeDispatchQueue;
 
     // Textures that should be rendered after a round of simulation.
-    std::vector<std::unique_ptr<GraphicsDispatchRecord>> mGraphicsDispatchQueue;
+    std::vector<GraphicsDispatchRecord*> mGraphicsDispatchQueue;
 
     // Textures that should be initialized before simulation starts.
     std::vector<Texture*> mTexturesToInitialize;
@@ -181,7 +260,20 @@ private:
     void        DrawTextures();
     ppx::float3 GenerateColor();
     void        MoveMarble();
+    void        ReadPressureResidual();
+    void        SmoothPressure(std::unique_ptr<Texture>* pressure, Texture* rhs, uint32_t sweeps);
+    void        SolvePressureJacobi();
+    void        SolvePressureMultigrid();
     void        Step(float deltaTime);
+    void        ValidateStep();
+
+    /// @brief Schedule one multigrid V-cycle.
+    ///
+    /// @param level    Level of the pyramid to solve on.
+    /// @param pressure Ping-pong textures holding the solution of the level, the
+    ///                 result ends up in pressure[0].
+    /// @param rhs      Right-hand side of the equation on this level.
+    void VCycle(uint32_t level, std::unique_ptr<Texture>* pressure, Texture* rhs);
 
     /// @brief             Return a vector describing a rectangle with dimensions that can fit "resolution" pixels.
     ///
@@ -195,6 +287,7 @@ private:
     void         InitBloomTextures();
     void         InitComputeShaders();
     void         InitGraphicsShaders();
+    void         InitMultigridTextures();
     void         InitSunraysTextures();
     void         InitTextures();
     void         MultipleSplats(uint32_t amount);
@@ -206,16 +299,16 @@ private:
     /// @brief Schedule a compute shader for execution.
     ///
     /// @param dr   The dispatch record describing the shader to be executed and
-    ///             the data used to execute it (descriptor set and uniform buffer).
+    ///             the data used to execute it (uniform ring slot and textures).
     ///             @see ComputeDispatchRecord.
-    void ScheduleDR(std::unique_ptr<ComputeDispatchRecord> dr) { mComputeDispatchQueue.push_back(std::move(dr)); }
+    void ScheduleDR(const ComputeDispatchRecord& dr) { mComputeDispatchQueue.push_back(dr); }
 
     /// @brief Schedule a graphics shader for execution.
     ///
     /// @param dr   The dispatch record describing the shader to be executed and
     ///             the descriptor set and texture used to execute it.
     ///             @see GraphicsDispatchRecord.
-    void ScheduleDR(std::unique_ptr<GraphicsDispatchRecord> dr) { mGraphicsDispatchQueue.push_back(std::move(dr)); }
+    void ScheduleDR(GraphicsDispatchRecord* dr) { mGraphicsDispatchQueue.push_back(dr); }
 };
 
 class ProjApp : public ppx::Application
@@ -225,6 +318,8 @@ public:
     virtual void            Config(ppx::ApplicationSettings& settings) override;
     virtual void            Setup() override;
     virtual void            Render() override;
+    virtual void            SetupMetrics() override;
+    virtual void            UpdateMetrics() override;
     const SimulationConfig& GetSimulationConfig() const { return mConfig; }
 
     // Knob visibility logic
@@ -236,6 +331,17 @@ private:
 
     // Fluid simulation driver.
     std::unique_ptr<FluidSimulation> mSim;
+
+    // CPU time spent updating the simulation and recording its commands.
+    ppx::metrics::MetricID mSimulationCpuTimeMetric = ppx::metrics::kInvalidMetricID;
+    double                 mSimulationCpuTimeMs     = 0.0;
+
+    // Root mean square of the pressure equation residual, @see FluidSimulation::GetPressureResidual.
+    ppx::metrics::MetricID mPressureResidualMetric = ppx::metrics::kInvalidMetricID;
+
+    // Comparison with the CPU reference solver, @see FluidSimulation::GetCpuValidationError.
+    ppx::metrics::MetricID mCpuValidationErrorMetric = ppx::metrics::kInvalidMetricID;
+    ppx::metrics::MetricID mCpuStepsPerSecondMetric  = ppx::metrics::kInvalidMetricID;
 };
 
 } // namespace FluidSim
@@ -257,12 +257,13 @@ void OITDemoApp::SetupBufferLinkedLists()
         PPX_CHECKED_CALL(GetDevice()->CreateBuffer(&bufferCreateInfo, &mBuffer.lists.fragmentBuffer));
     }
 
-    // Atomic counter
+    // Atomic counter, laid out as the BUFFER_STATS_* counters
     {
         grfx::BufferCreateInfo bufferCreateInfo             = {};
-        bufferCreateInfo.size                               = std::max(sizeof(uint), static_cast<size_t>(PPX_MINIMUM_UNIFORM_BUFFER_SIZE));
+        bufferCreateInfo.size                               = std::max(BUFFER_STATS_COUNT * sizeof(uint), static_cast<size_t>(PPX_MINIMUM_UNIFORM_BUFFER_SIZE));
         bufferCreateInfo.structuredElementStride            = sizeof(uint);
         bufferCreateInfo.usageFlags.bits.rwStructuredBuffer = true;
+        bufferCreateInfo.usageFlags.bits.transferSrc        = true;
         bufferCreateInfo.memoryUsage                        = grfx::MEMORY_USAGE_GPU_ONLY;
         bufferCreateInfo.initialState                       = grfx::RESOURCE_STATE_GENERAL;
         PPX_CHECKED_CALL(GetDevice()->CreateBuffer(&bufferCreateInfo, &mBuffer.lists.atomicCounter));
@@ -338,7 +339,7 @@ void OITDemoApp::SetupBufferLinkedLists()
         writes[4].type                   = grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER;
         writes[4].bufferOffset           = 0;
         writes[4].bufferRange            = PPX_WHOLE_SIZE;
-        writes[4].structuredElementCount = 1;
+        writes[4].structuredElementCount = BUFFER_STATS_COUNT;
         writes[4].pBuffer                = mBuffer.lists.atomicCounter;
 
         PPX_CHECKED_CALL(mBuffer.lists.gatherDescriptorSet->UpdateDescriptors(static_cast<uint32_t>(writes.size()), writes.data()));
@@ -415,7 +416,7 @@ void OITDemoApp::SetupBufferLinkedLists()
         writes[3].type                   = grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER;
         writes[3].bufferOffset           = 0;
         writes[3].bufferRange            = PPX_WHOLE_SIZE;
-        writes[3].structuredElementCount = 1;
+        writes[3].structuredElementCount = BUFFER_STATS_COUNT;
         writes[3].pBuffer                = mBuffer.lists.atomicCounter;
 
         PPX_CHECKED_CALL(mBuffer.lists.combineDescriptorSet->UpdateDescriptors(static_cast<uint32_t>(writes.size()), writes.data()));
@@ -455,40 +456,378 @@ void OITDemoApp::SetupBufferLinkedLists()
     }
 }
 
+void OITDemoApp::SetupBufferKBuffer()
+{
+    mBuffer.kbuffer.texturesNeedClear = true;
+
+    // Depth and color textures, BUFFER_K_BUFFER_SIZE_PER_PIXEL layers per pixel
+    {
+        grfx::TextureCreateInfo createInfo         = {};
+        createInfo.imageType                       = grfx::IMAGE_TYPE_2D;
+        createInfo.width                           = mTransparencyTexture->GetWidth();
+        createInfo.height                          = mTransparencyTexture->GetHeight() * BUFFER_K_BUFFER_SIZE_PER_PIXEL;
+        createInfo.depth                           = 1;
+        createInfo.imageFormat                     = grfx::FORMAT_R32_UINT;
+        createInfo.sampleCount                     = grfx::SAMPLE_COUNT_1;
+        createInfo.mipLevelCount                   = 1;
+        createInfo.arrayLayerCount                 = 1;
+        createInfo.usageFlags.bits.colorAttachment = true;
+        createInfo.usageFlags.bits.storage         = true;
+        createInfo.memoryUsage                     = grfx::MEMORY_USAGE_GPU_ONLY;
+        createInfo.initialState                    = grfx::RESOURCE_STATE_SHADER_RESOURCE;
+
+        PPX_CHECKED_CALL(GetDevice()->CreateTexture(&createInfo, &mBuffer.kbuffer.depthTexture));
+        PPX_CHECKED_CALL(GetDevice()->CreateTexture(&createInfo, &mBuffer.kbuffer.colorTexture));
+    }
+
+    // Tail texture
+    {
+        grfx::TextureCreateInfo createInfo         = {};
+        createInfo.imageType                       = grfx::IMAGE_TYPE_2D;
+        createInfo.width                           = mTransparencyTexture->GetWidth();
+        createInfo.height                          = mTransparencyTexture->GetHeight();
+        createInfo.depth                           = 1;
+        createInfo.imageFormat                     = grfx::FORMAT_R16G16B16A16_FLOAT;
+        createInfo.sampleCount                     = grfx::SAMPLE_COUNT_1;
+        createInfo.mipLevelCount                   = 1;
+        createInfo.arrayLayerCount                 = 1;
+        createInfo.usageFlags.bits.colorAttachment = true;
+        createInfo.usageFlags.bits.sampled         = true;
+        createInfo.memoryUsage                     = grfx::MEMORY_USAGE_GPU_ONLY;
+        createInfo.initialState                    = grfx::RESOURCE_STATE_SHADER_RESOURCE;
+        createInfo.RTVClearValue                   = {0, 0, 0, 0};
+
+        PPX_CHECKED_CALL(GetDevice()->CreateTexture(&createInfo, &mBuffer.kbuffer.tailTexture));
+    }
+
+    // Stats buffer
+    {
+        grfx::BufferCreateInfo bufferCreateInfo             = {};
+        bufferCreateInfo.size                               = std::max(BUFFER_STATS_COUNT * sizeof(uint), static_cast<size_t>(PPX_MINIMUM_UNIFORM_BUFFER_SIZE));
+        bufferCreateInfo.structuredElementStride            = sizeof(uint);
+        bufferCreateInfo.usageFlags.bits.rwStructuredBuffer = true;
+        bufferCreateInfo.usageFlags.bits.transferSrc        = true;
+        bufferCreateInfo.memoryUsage                        = grfx::MEMORY_USAGE_GPU_ONLY;
+        bufferCreateInfo.initialState                       = grfx::RESOURCE_STATE_GENERAL;
+        PPX_CHECKED_CALL(GetDevice()->CreateBuffer(&bufferCreateInfo, &mBuffer.kbuffer.statsBuffer));
+    }
+
+    // Clear pass
+    {
+        constexpr uint            clearValueUint  = BUFFER_K_BUFFER_EMPTY_DEPTH;
+        const float               clearValueFloat = *reinterpret_cast<const float*>(&clearValueUint);
+        grfx::DrawPassCreateInfo2 createInfo      = {};
+        createInfo.width                          = mBuffer.kbuffer.depthTexture->GetWidth();
+        createInfo.height                         = mBuffer.kbuffer.depthTexture->GetHeight();
+        createInfo.renderTargetCount              = 2;
+        createInfo.pRenderTargetImages[0]         = mBuffer.kbuffer.depthTexture->GetImage();
+        createInfo.pRenderTargetImages[1]         = mBuffer.kbuffer.colorTexture->GetImage();
+        createInfo.pDepthStencilImage             = nullptr;
+        createInfo.renderTargetClearValues[0]     = {clearValueFloat, 0, 0, 0};
+        createInfo.renderTargetClearValues[1]     = {0, 0, 0, 0};
+        PPX_CHECKED_CALL(GetDevice()->CreateDrawPass(&createInfo, &mBuffer.kbuffer.clearPass));
+    }
+
+    // Depth pass
+    {
+        grfx::DrawPassCreateInfo2 createInfo = {};
+        createInfo.width                     = mBuffer.kbuffer.tailTexture->GetWidth();
+        createInfo.height                    = mBuffer.kbuffer.tailTexture->GetHeight();
+        createInfo.renderTargetCount         = 0;
+        createInfo.pDepthStencilImage        = nullptr;
+        PPX_CHECKED_CALL(GetDevice()->CreateDrawPass(&createInfo, &mBuffer.kbuffer.depthPass));
+    }
+
+    // Gather pass
+    {
+        grfx::DrawPassCreateInfo2 createInfo  = {};
+        createInfo.width                      = mBuffer.kbuffer.tailTexture->GetWidth();
+        createInfo.height                     = mBuffer.kbuffer.tailTexture->GetHeight();
+        createInfo.renderTargetCount          = 1;
+        createInfo.pRenderTargetImages[0]     = mBuffer.kbuffer.tailTexture->GetImage();
+        createInfo.pDepthStencilImage         = nullptr;
+        createInfo.renderTargetClearValues[0] = {0, 0, 0, 0};
+        PPX_CHECKED_CALL(GetDevice()->CreateDrawPass(&createInfo, &mBuffer.kbuffer.gatherPass));
+    }
+
+    ////////////////////////////////////////
+    // Depth
+    ////////////////////////////////////////
+
+    // Descriptor
+    {
+        grfx::DescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding{SHADER_GLOBALS_REGISTER, grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, grfx::SHADER_STAGE_ALL_GRAPHICS});
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding{CUSTOM_TEXTURE_0_REGISTER, grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1, grfx::SHADER_STAGE_ALL_GRAPHICS});
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding{CUSTOM_UAV_0_REGISTER, grfx::DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, grfx::SHADER_STAGE_ALL_GRAPHICS});
+        PPX_CHECKED_CALL(GetDevice()->CreateDescriptorSetLayout(&layoutCreateInfo, &mBuffer.kbuffer.depthDescriptorSetLayout));
+
+        PPX_CHECKED_CALL(GetDevice()->AllocateDescriptorSet(mDescriptorPool, mBuffer.kbuffer.depthDescriptorSetLayout, &mBuffer.kbuffer.depthDescriptorSet));
+
+        std::array<grfx::WriteDescriptor, 3> writes = {};
+
+        writes[0].binding      = SHADER_GLOBALS_REGISTER;
+        writes[0].type         = grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        writes[0].bufferOffset = 0;
+        writes[0].bufferRange  = PPX_WHOLE_SIZE;
+        writes[0].pBuffer      = mShaderGlobalsBuffer;
+
+        writes[1].binding    = CUSTOM_TEXTURE_0_REGISTER;
+        writes[1].arrayIndex = 0;
+        writes[1].type       = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        writes[1].pImageView = mOpaquePass->GetDepthStencilTexture()->GetSampledImageView();
+
+        writes[2].binding    = CUSTOM_UAV_0_REGISTER;
+        writes[2].arrayIndex = 0;
+        writes[2].type       = grfx::DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        writes[2].pImageView = mBuffer.kbuffer.depthTexture->GetStorageImageView();
+
+        PPX_CHECKED_CALL(mBuffer.kbuffer.depthDescriptorSet->UpdateDescriptors(static_cast<uint32_t>(writes.size()), writes.data()));
+    }
+
+    // Pipeline
+    {
+        grfx::PipelineInterfaceCreateInfo piCreateInfo = {};
+        piCreateInfo.setCount                          = 1;
+        piCreateInfo.sets[0].set                       = 0;
+        piCreateInfo.sets[0].pLayout                   = mBuffer.kbuffer.depthDescriptorSetLayout;
+        PPX_CHECKED_CALL(GetDevice()->CreatePipelineInterface(&piCreateInfo, &mBuffer.kbuffer.depthPipelineInterface));
+
+        grfx::ShaderModulePtr VS, PS;
+        PPX_CHECKED_CALL(CreateShader("oit_demo/shaders", "BufferKBufferDepth.vs", &VS));
+        PPX_CHECKED_CALL(CreateShader("oit_demo/shaders", "BufferKBufferDepth.ps", &PS));
+
+        grfx::GraphicsPipelineCreateInfo2 gpCreateInfo = {};
+        gpCreateInfo.VS                                = {VS, "vsmain"};
+        gpCreateInfo.PS                                = {PS, "psmain"};
+        gpCreateInfo.vertexInputState.bindingCount     = 1;
+        gpCreateInfo.vertexInputState.bindings[0]      = GetTransparentMesh()->GetDerivedVertexBindings()[0];
+        gpCreateInfo.topology                          = grfx::PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        gpCreateInfo.polygonMode                       = grfx::POLYGON_MODE_FILL;
+        gpCreateInfo.cullMode                          = grfx::CULL_MODE_NONE;
+        gpCreateInfo.frontFace                         = grfx::FRONT_FACE_CCW;
+        gpCreateInfo.depthReadEnable                   = false;
+        gpCreateInfo.depthWriteEnable                  = false;
+        gpCreateInfo.blendModes[0]                     = grfx::BLEND_MODE_NONE;
+        gpCreateInfo.outputState.renderTargetCount     = 0;
+        gpCreateInfo.pPipelineInterface                = mBuffer.kbuffer.depthPipelineInterface;
+        PPX_CHECKED_CALL(GetDevice()->CreateGraphicsPipeline(&gpCreateInfo, &mBuffer.kbuffer.depthPipeline));
+
+        GetDevice()->DestroyShaderModule(VS);
+        GetDevice()->DestroyShaderModule(PS);
+    }
+
+    ////////////////////////////////////////
+    // Gather
+    ////////////////////////////////////////
+
+    // Descriptor
+    {
+        grfx::DescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding{SHADER_GLOBALS_REGISTER, grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, grfx::SHADER_STAGE_ALL_GRAPHICS});
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding{CUSTOM_TEXTURE_0_REGISTER, grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1, grfx::SHADER_STAGE_ALL_GRAPHICS});
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding{CUSTOM_UAV_0_REGISTER, grfx::DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, grfx::SHADER_STAGE_ALL_GRAPHICS});
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding{CUSTOM_UAV_1_REGISTER, grfx::DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, grfx::SHADER_STAGE_ALL_GRAPHICS});
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding{CUSTOM_UAV_2_REGISTER, grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER, 1, grfx::SHADER_STAGE_ALL_GRAPHICS});
+        PPX_CHECKED_CALL(GetDevice()->CreateDescriptorSetLayout(&layoutCreateInfo, &mBuffer.kbuffer.gatherDescriptorSetLayout));
+
+        PPX_CHECKED_CALL(GetDevice()->AllocateDescriptorSet(mDescriptorPool, mBuffer.kbuffer.gatherDescriptorSetLayout, &mBuffer.kbuffer.gatherDescriptorSet));
+
+        std::array<grfx::WriteDescriptor, 5> writes = {};
+
+        writes[0].binding      = SHADER_GLOBALS_REGISTER;
+        writes[0].type         = grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        writes[0].bufferOffset = 0;
+        writes[0].bufferRange  = PPX_WHOLE_SIZE;
+        writes[0].pBuffer      = mShaderGlobalsBuffer;
+
+        writes[1].binding    = CUSTOM_TEXTURE_0_REGISTER;
+        writes[1].arrayIndex = 0;
+        writes[1].type       = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        writes[1].pImageView = mOpaquePass->GetDepthStencilTexture()->GetSampledImageView();
+
+        writes[2].binding    = CUSTOM_UAV_0_REGISTER;
+        writes[2].arrayIndex = 0;
+        writes[2].type       = grfx::DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        writes[2].pImageView = mBuffer.kbuffer.depthTexture->GetStorageImageView();
+
+        writes[3].binding    = CUSTOM_UAV_1_REGISTER;
+        writes[3].arrayIndex = 0;
+        writes[3].type       = grfx::DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        writes[3].pImageView = mBuffer.kbuffer.colorTexture->GetStorageImageView();
+
+        writes[4].binding                = CUSTOM_UAV_2_REGISTER;
+        writes[4].type                   = grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER;
+        writes[4].bufferOffset           = 0;
+        writes[4].bufferRange            = PPX_WHOLE_SIZE;
+        writes[4].structuredElementCount = BUFFER_STATS_COUNT;
+        writes[4].pBuffer                = mBuffer.kbuffer.statsBuffer;
+
+        PPX_CHECKED_CALL(mBuffer.kbuffer.gatherDescriptorSet->UpdateDescriptors(static_cast<uint32_t>(writes.size()), writes.data()));
+    }
+
+    // Pipeline
+    {
+        grfx::PipelineInterfaceCreateInfo piCreateInfo = {};
+        piCreateInfo.setCount                          = 1;
+        piCreateInfo.sets[0].set                       = 0;
+        piCreateInfo.sets[0].pLayout                   = mBuffer.kbuffer.gatherDescriptorSetLayout;
+        PPX_CHECKED_CALL(GetDevice()->CreatePipelineInterface(&piCreateInfo, &mBuffer.kbuffer.gatherPipelineInterface));
+
+        grfx::ShaderModulePtr VS, PS;
+        PPX_CHECKED_CALL(CreateShader("oit_demo/shaders", "BufferKBufferGather.vs", &VS));
+        PPX_CHECKED_CALL(CreateShader("oit_demo/shaders", "BufferKBufferGather.ps", &PS));
+
+        // The tail is summed, see BufferKBufferCombine.hlsl
+        grfx::GraphicsPipelineCreateInfo gpCreateInfo                        = {};
+        gpCreateInfo.VS                                                      = {VS, "vsmain"};
+        gpCreateInfo.PS                                                      = {PS, "psmain"};
+        gpCreateInfo.vertexInputState.bindingCount                           = 1;
+        gpCreateInfo.vertexInputState.bindings[0]                            = GetTransparentMesh()->GetDerivedVertexBindings()[0];
+        gpCreateInfo.inputAssemblyState.topology                             = grfx::PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        gpCreateInfo.rasterState.polygonMode                                 = grfx::POLYGON_MODE_FILL;
+        gpCreateInfo.rasterState.cullMode                                    = grfx::CULL_MODE_NONE;
+        gpCreateInfo.rasterState.frontFace                                   = grfx::FRONT_FACE_CCW;
+        gpCreateInfo.rasterState.rasterizationSamples                        = grfx::SAMPLE_COUNT_1;
+        gpCreateInfo.depthStencilState.depthTestEnable                       = false;
+        gpCreateInfo.depthStencilState.depthWriteEnable                      = false;
+        gpCreateInfo.colorBlendState.blendAttachmentCount                    = 1;
+        gpCreateInfo.colorBlendState.blendAttachments[0].blendEnable         = true;
+        gpCreateInfo.colorBlendState.blendAttachments[0].srcColorBlendFactor = grfx::BLEND_FACTOR_ONE;
+        gpCreateInfo.colorBlendState.blendAttachments[0].dstColorBlendFactor = grfx::BLEND_FACTOR_ONE;
+        gpCreateInfo.colorBlendState.blendAttachments[0].colorBlendOp        = grfx::BLEND_OP_ADD;
+        gpCreateInfo.colorBlendState.blendAttachments[0].srcAlphaBlendFactor = grfx::BLEND_FACTOR_ONE;
+        gpCreateInfo.colorBlendState.blendAttachments[0].dstAlphaBlendFactor = grfx::BLEND_FACTOR_ONE;
+        gpCreateInfo.colorBlendState.blendAttachments[0].alphaBlendOp        = grfx::BLEND_OP_ADD;
+        gpCreateInfo.colorBlendState.blendAttachments[0].colorWriteMask      = grfx::ColorComponentFlags::RGBA();
+        gpCreateInfo.outputState.renderTargetCount                           = 1;
+        gpCreateInfo.outputState.renderTargetFormats[0]                      = mBuffer.kbuffer.tailTexture->GetImageFormat();
+        gpCreateInfo.pPipelineInterface                                      = mBuffer.kbuffer.gatherPipelineInterface;
+        PPX_CHECKED_CALL(GetDevice()->CreateGraphicsPipeline(&gpCreateInfo, &mBuffer.kbuffer.gatherPipeline));
+
+        GetDevice()->DestroyShaderModule(VS);
+        GetDevice()->DestroyShaderModule(PS);
+    }
+
+    ////////////////////////////////////////
+    // Combine
+    ////////////////////////////////////////
+
+    // Descriptor
+    {
+        grfx::DescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding{SHADER_GLOBALS_REGISTER, grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, grfx::SHADER_STAGE_ALL_GRAPHICS});
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding{CUSTOM_TEXTURE_0_REGISTER, grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1, grfx::SHADER_STAGE_ALL_GRAPHICS});
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding{CUSTOM_UAV_0_REGISTER, grfx::DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, grfx::SHADER_STAGE_ALL_GRAPHICS});
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding{CUSTOM_UAV_1_REGISTER, grfx::DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, grfx::SHADER_STAGE_ALL_GRAPHICS});
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding{CUSTOM_UAV_2_REGISTER, grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER, 1, grfx::SHADER_STAGE_ALL_GRAPHICS});
+        PPX_CHECKED_CALL(GetDevice()->CreateDescriptorSetLayout(&layoutCreateInfo, &mBuffer.kbuffer.combineDescriptorSetLayout));
+
+        PPX_CHECKED_CALL(GetDevice()->AllocateDescriptorSet(mDescriptorPool, mBuffer.kbuffer.combineDescriptorSetLayout, &mBuffer.kbuffer.combineDescriptorSet));
+
+        std::array<grfx::WriteDescriptor, 5> writes = {};
+
+        writes[0].binding      = SHADER_GLOBALS_REGISTER;
+        writes[0].type         = grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        writes[0].bufferOffset = 0;
+        writes[0].bufferRange  = PPX_WHOLE_SIZE;
+        writes[0].pBuffer      = mShaderGlobalsBuffer;
+
+        writes[1].binding    = CUSTOM_TEXTURE_0_REGISTER;
+        writes[1].arrayIndex = 0;
+        writes[1].type       = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        writes[1].pImageView = mBuffer.kbuffer.tailTexture->GetSampledImageView();
+
+        writes[2].binding    = CUSTOM_UAV_0_REGISTER;
+        writes[2].arrayIndex = 0;
+        writes[2].type       = grfx::DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        writes[2].pImageView = mBuffer.kbuffer.depthTexture->GetStorageImageView();
+
+        writes[3].binding    = CUSTOM_UAV_1_REGISTER;
+        writes[3].arrayIndex = 0;
+        writes[3].type       = grfx::DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        writes[3].pImageView = mBuffer.kbuffer.colorTexture->GetStorageImageView();
+
+        writes[4].binding                = CUSTOM_UAV_2_REGISTER;
+        writes[4].type                   = grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER;
+        writes[4].bufferOffset           = 0;
+        writes[4].bufferRange            = PPX_WHOLE_SIZE;
+        writes[4].structuredElementCount = BUFFER_STATS_COUNT;
+        writes[4].pBuffer                = mBuffer.kbuffer.statsBuffer;
+
+        PPX_CHECKED_CALL(mBuffer.kbuffer.combineDescriptorSet->UpdateDescriptors(static_cast<uint32_t>(writes.size()), writes.data()));
+    }
+
+    // Pipeline
+    {
+        grfx::PipelineInterfaceCreateInfo piCreateInfo = {};
+        piCreateInfo.setCount                          = 1;
+        piCreateInfo.sets[0].set                       = 0;
+        piCreateInfo.sets[0].pLayout                   = mBuffer.kbuffer.combineDescriptorSetLayout;
+        PPX_CHECKED_CALL(GetDevice()->CreatePipelineInterface(&piCreateInfo, &mBuffer.kbuffer.combinePipelineInterface));
+
+        grfx::ShaderModulePtr VS, PS;
+        PPX_CHECKED_CALL(CreateShader("oit_demo/shaders", "BufferKBufferCombine.vs", &VS));
+        PPX_CHECKED_CALL(CreateShader("oit_demo/shaders", "BufferKBufferCombine.ps", &PS));
+
+        grfx::GraphicsPipelineCreateInfo2 gpCreateInfo  = {};
+        gpCreateInfo.VS                                 = {VS, "vsmain"};
+        gpCreateInfo.PS                                 = {PS, "psmain"};
+        gpCreateInfo.vertexInputState.bindingCount      = 0;
+        gpCreateInfo.topology                           = grfx::PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        gpCreateInfo.polygonMode                        = grfx::POLYGON_MODE_FILL;
+        gpCreateInfo.cullMode                           = grfx::CULL_MODE_BACK;
+        gpCreateInfo.frontFace                          = grfx::FRONT_FACE_CCW;
+        gpCreateInfo.depthReadEnable                    = false;
+        gpCreateInfo.depthWriteEnable                   = false;
+        gpCreateInfo.blendModes[0]                      = grfx::BLEND_MODE_NONE;
+        gpCreateInfo.outputState.renderTargetCount      = 1;
+        gpCreateInfo.outputState.renderTargetFormats[0] = mTransparencyPass->GetRenderTargetTexture(0)->GetImageFormat();
+        gpCreateInfo.outputState.depthStencilFormat     = mTransparencyPass->GetDepthStencilTexture()->GetImageFormat();
+        gpCreateInfo.pPipelineInterface                 = mBuffer.kbuffer.combinePipelineInterface;
+        PPX_CHECKED_CALL(GetDevice()->CreateGraphicsPipeline(&gpCreateInfo, &mBuffer.kbuffer.combinePipeline));
+
+        GetDevice()->DestroyShaderModule(VS);
+        GetDevice()->DestroyShaderModule(PS);
+    }
+}
+
 void OITDemoApp::SetupBuffer()
 {
     SetupBufferBuckets();
     SetupBufferLinkedLists();
+    SetupBufferKBuffer();
+
+    // Stats readback
+    {
+        grfx::BufferCreateInfo bufferCreateInfo      = {};
+        bufferCreateInfo.size                        = BUFFER_STATS_COUNT * sizeof(uint);
+        bufferCreateInfo.usageFlags.bits.transferDst = true;
+        bufferCreateInfo.memoryUsage                 = grfx::MEMORY_USAGE_GPU_TO_CPU;
+        bufferCreateInfo.initialState                = grfx::RESOURCE_STATE_COPY_DST;
+        PPX_CHECKED_CALL(GetDevice()->CreateBuffer(&bufferCreateInfo, &mBuffer.statsReadbackBuffer));
+    }
 }
 
 void OITDemoApp::RecordBufferBuckets()
 {
     if (mBuffer.buckets.countTextureNeedClear) {
-        mCommandBuffer->TransitionImageLayout(
-            mBuffer.buckets.clearPass,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_RENDER_TARGET,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE);
+        mCommandBuffer->RequireResourceState(mBuffer.buckets.clearPass, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_SHADER_RESOURCE);
         mCommandBuffer->BeginRenderPass(mBuffer.buckets.clearPass, grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_ALL);
 
         mCommandBuffer->SetScissors(mBuffer.buckets.clearPass->GetScissor());
         mCommandBuffer->SetViewports(mBuffer.buckets.clearPass->GetViewport());
 
         mCommandBuffer->EndRenderPass();
-        mCommandBuffer->TransitionImageLayout(
-            mBuffer.buckets.clearPass,
-            grfx::RESOURCE_STATE_RENDER_TARGET,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE);
+        mCommandBuffer->RequireResourceState(mBuffer.buckets.clearPass, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_SHADER_RESOURCE);
 
         mBuffer.buckets.countTextureNeedClear = false;
     }
 
     {
-        mCommandBuffer->TransitionImageLayout(mBuffer.buckets.countTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_GENERAL);
-        mCommandBuffer->TransitionImageLayout(mBuffer.buckets.fragmentTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_GENERAL);
+        mCommandBuffer->RequireResourceState(mBuffer.buckets.countTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_GENERAL);
+        mCommandBuffer->RequireResourceState(mBuffer.buckets.fragmentTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_GENERAL);
+        mCommandBuffer->RequireResourceState(mOpaquePass->GetDepthStencilTexture(), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE);
         mCommandBuffer->BeginRenderPass(mBuffer.buckets.gatherPass, 0);
 
         mCommandBuffer->SetScissors(mBuffer.buckets.gatherPass->GetScissor());
@@ -501,19 +840,12 @@ void OITDemoApp::RecordBufferBuckets()
         mCommandBuffer->DrawIndexed(GetTransparentMesh()->GetIndexCount());
 
         mCommandBuffer->EndRenderPass();
-        mCommandBuffer->TransitionImageLayout(mBuffer.buckets.countTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_GENERAL, grfx::RESOURCE_STATE_SHADER_RESOURCE);
-        mCommandBuffer->TransitionImageLayout(mBuffer.buckets.fragmentTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_GENERAL, grfx::RESOURCE_STATE_SHADER_RESOURCE);
     }
 
     {
-        mCommandBuffer->TransitionImageLayout(mBuffer.buckets.countTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_GENERAL);
-        mCommandBuffer->TransitionImageLayout(mBuffer.buckets.fragmentTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_GENERAL);
-        mCommandBuffer->TransitionImageLayout(
-            mTransparencyPass,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_RENDER_TARGET,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
+        mCommandBuffer->RequireResourceState(mBuffer.buckets.countTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_GENERAL);
+        mCommandBuffer->RequireResourceState(mBuffer.buckets.fragmentTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_GENERAL);
+        mCommandBuffer->RequireResourceState(mTransparencyPass, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
         mCommandBuffer->BeginRenderPass(mTransparencyPass, grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_RENDER_TARGETS);
 
         mCommandBuffer->SetScissors(mTransparencyPass->GetScissor());
@@ -524,44 +856,27 @@ void OITDemoApp::RecordBufferBuckets()
         mCommandBuffer->Draw(3);
 
         mCommandBuffer->EndRenderPass();
-        mCommandBuffer->TransitionImageLayout(
-            mTransparencyPass,
-            grfx::RESOURCE_STATE_RENDER_TARGET,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE);
-        mCommandBuffer->TransitionImageLayout(mBuffer.buckets.countTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_GENERAL, grfx::RESOURCE_STATE_SHADER_RESOURCE);
-        mCommandBuffer->TransitionImageLayout(mBuffer.buckets.fragmentTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_GENERAL, grfx::RESOURCE_STATE_SHADER_RESOURCE);
     }
 }
 
 void OITDemoApp::RecordBufferLinkedLists()
 {
     if (mBuffer.lists.linkedListHeadTextureNeedClear) {
-        mCommandBuffer->TransitionImageLayout(
-            mBuffer.lists.clearPass,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_RENDER_TARGET,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE);
+        mCommandBuffer->RequireResourceState(mBuffer.lists.clearPass, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_SHADER_RESOURCE);
         mCommandBuffer->BeginRenderPass(mBuffer.lists.clearPass, grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_ALL);
 
         mCommandBuffer->SetScissors(mBuffer.lists.clearPass->GetScissor());
         mCommandBuffer->SetViewports(mBuffer.lists.clearPass->GetViewport());
 
         mCommandBuffer->EndRenderPass();
-        mCommandBuffer->TransitionImageLayout(
-            mBuffer.lists.clearPass,
-            grfx::RESOURCE_STATE_RENDER_TARGET,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE);
+        mCommandBuffer->RequireResourceState(mBuffer.lists.clearPass, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_SHADER_RESOURCE);
 
         mBuffer.lists.linkedListHeadTextureNeedClear = false;
     }
 
     {
-        mCommandBuffer->TransitionImageLayout(mBuffer.lists.linkedListHeadTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_GENERAL);
+        mCommandBuffer->RequireResourceState(mBuffer.lists.linkedListHeadTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_GENERAL);
+        mCommandBuffer->RequireResourceState(mOpaquePass->GetDepthStencilTexture(), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE);
         mCommandBuffer->BeginRenderPass(mBuffer.lists.gatherPass, 0);
 
         mCommandBuffer->SetScissors(mBuffer.lists.gatherPass->GetScissor());
@@ -574,17 +889,13 @@ void OITDemoApp::RecordBufferLinkedLists()
         mCommandBuffer->DrawIndexed(GetTransparentMesh()->GetIndexCount());
 
         mCommandBuffer->EndRenderPass();
-        mCommandBuffer->TransitionImageLayout(mBuffer.lists.linkedListHeadTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_GENERAL, grfx::RESOURCE_STATE_SHADER_RESOURCE);
     }
 
+    RecordBufferStatsCopy(mBuffer.lists.atomicCounter);
+
     {
-        mCommandBuffer->TransitionImageLayout(mBuffer.lists.linkedListHeadTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_GENERAL);
-        mCommandBuffer->TransitionImageLayout(
-            mTransparencyPass,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_RENDER_TARGET,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
+        mCommandBuffer->RequireResourceState(mBuffer.lists.linkedListHeadTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_GENERAL);
+        mCommandBuffer->RequireResourceState(mTransparencyPass, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
         mCommandBuffer->BeginRenderPass(mTransparencyPass, grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_RENDER_TARGETS);
 
         mCommandBuffer->SetScissors(mTransparencyPass->GetScissor());
@@ -595,22 +906,102 @@ void OITDemoApp::RecordBufferLinkedLists()
         mCommandBuffer->Draw(3);
 
         mCommandBuffer->EndRenderPass();
-        mCommandBuffer->TransitionImageLayout(
-            mTransparencyPass,
-            grfx::RESOURCE_STATE_RENDER_TARGET,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE);
-        mCommandBuffer->TransitionImageLayout(mBuffer.lists.linkedListHeadTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_GENERAL, grfx::RESOURCE_STATE_SHADER_RESOURCE);
     }
 }
 
+void OITDemoApp::RecordBufferKBuffer()
+{
+    if (mBuffer.kbuffer.texturesNeedClear) {
+        mCommandBuffer->RequireResourceState(mBuffer.kbuffer.clearPass, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+        mCommandBuffer->BeginRenderPass(mBuffer.kbuffer.clearPass, grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_ALL);
+
+        mCommandBuffer->SetScissors(mBuffer.kbuffer.clearPass->GetScissor());
+        mCommandBuffer->SetViewports(mBuffer.kbuffer.clearPass->GetViewport());
+
+        mCommandBuffer->EndRenderPass();
+        mCommandBuffer->RequireResourceState(mBuffer.kbuffer.clearPass, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+
+        mBuffer.kbuffer.texturesNeedClear = false;
+    }
+
+    // The first geometry pass keeps the nearest depths of each pixel...
+    {
+        mCommandBuffer->RequireResourceState(mBuffer.kbuffer.depthTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_GENERAL);
+        mCommandBuffer->RequireResourceState(mOpaquePass->GetDepthStencilTexture(), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+        mCommandBuffer->BeginRenderPass(mBuffer.kbuffer.depthPass, 0);
+
+        mCommandBuffer->SetScissors(mBuffer.kbuffer.depthPass->GetScissor());
+        mCommandBuffer->SetViewports(mBuffer.kbuffer.depthPass->GetViewport());
+
+        mCommandBuffer->BindGraphicsDescriptorSets(mBuffer.kbuffer.depthPipelineInterface, 1, &mBuffer.kbuffer.depthDescriptorSet);
+        mCommandBuffer->BindGraphicsPipeline(mBuffer.kbuffer.depthPipeline);
+        mCommandBuffer->BindIndexBuffer(GetTransparentMesh());
+        mCommandBuffer->BindVertexBuffers(GetTransparentMesh());
+        mCommandBuffer->DrawIndexed(GetTransparentMesh()->GetIndexCount());
+
+        mCommandBuffer->EndRenderPass();
+    }
+
+    // ...and the second one stores their colors and sums the others in the tail
+    {
+        mCommandBuffer->RequireResourceState(mBuffer.kbuffer.depthTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_GENERAL);
+        mCommandBuffer->RequireResourceState(mBuffer.kbuffer.colorTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_GENERAL);
+        mCommandBuffer->RequireResourceState(mBuffer.kbuffer.gatherPass, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+        mCommandBuffer->BeginRenderPass(mBuffer.kbuffer.gatherPass, grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_RENDER_TARGETS);
+
+        mCommandBuffer->SetScissors(mBuffer.kbuffer.gatherPass->GetScissor());
+        mCommandBuffer->SetViewports(mBuffer.kbuffer.gatherPass->GetViewport());
+
+        mCommandBuffer->BindGraphicsDescriptorSets(mBuffer.kbuffer.gatherPipelineInterface, 1, &mBuffer.kbuffer.gatherDescriptorSet);
+        mCommandBuffer->BindGraphicsPipeline(mBuffer.kbuffer.gatherPipeline);
+        mCommandBuffer->BindIndexBuffer(GetTransparentMesh());
+        mCommandBuffer->BindVertexBuffers(GetTransparentMesh());
+        mCommandBuffer->DrawIndexed(GetTransparentMesh()->GetIndexCount());
+
+        mCommandBuffer->EndRenderPass();
+        mCommandBuffer->RequireResourceState(mBuffer.kbuffer.gatherPass, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    }
+
+    RecordBufferStatsCopy(mBuffer.kbuffer.statsBuffer);
+
+    {
+        mCommandBuffer->RequireResourceState(mBuffer.kbuffer.depthTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_GENERAL);
+        mCommandBuffer->RequireResourceState(mBuffer.kbuffer.colorTexture, 0, 1, 0, 1, grfx::RESOURCE_STATE_GENERAL);
+        mCommandBuffer->RequireResourceState(mTransparencyPass, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
+        mCommandBuffer->BeginRenderPass(mTransparencyPass, grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_RENDER_TARGETS);
+
+        mCommandBuffer->SetScissors(mTransparencyPass->GetScissor());
+        mCommandBuffer->SetViewports(mTransparencyPass->GetViewport());
+
+        mCommandBuffer->BindGraphicsDescriptorSets(mBuffer.kbuffer.combinePipelineInterface, 1, &mBuffer.kbuffer.combineDescriptorSet);
+        mCommandBuffer->BindGraphicsPipeline(mBuffer.kbuffer.combinePipeline);
+        mCommandBuffer->Draw(3);
+
+        mCommandBuffer->EndRenderPass();
+    }
+}
+
+void OITDemoApp::RecordBufferStatsCopy(grfx::Buffer* pStatsBuffer)
+{
+    // The barrier into COPY_SRC also orders the gather atomics before the copy
+    mCommandBuffer->BufferResourceBarrier(pStatsBuffer, grfx::RESOURCE_STATE_GENERAL, grfx::RESOURCE_STATE_COPY_SRC);
+
+    grfx::BufferToBufferCopyInfo copyInfo = {};
+    copyInfo.size                         = mBuffer.statsReadbackBuffer->GetSize();
+    mCommandBuffer->CopyBufferToBuffer(&copyInfo, pStatsBuffer, mBuffer.statsReadbackBuffer);
+
+    mCommandBuffer->BufferResourceBarrier(pStatsBuffer, grfx::RESOURCE_STATE_COPY_SRC, grfx::RESOURCE_STATE_GENERAL);
+
+    mBuffer.statsCopied = true;
+}
+
 void OITDemoApp::RecordBuffer()
 {
     void (OITDemoApp::*recordFuncs[])() =
         {
             &OITDemoApp::RecordBufferBuckets,
             &OITDemoApp::RecordBufferLinkedLists,
+            &OITDemoApp::RecordBufferKBuffer,
         };
     static_assert(sizeof(recordFuncs) / sizeof(recordFuncs[0]) == BUFFER_ALGORITHMS_COUNT, "Algorithm record func count mismatch");
 
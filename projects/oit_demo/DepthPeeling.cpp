@@ -160,6 +160,159 @@ void OITDemoApp::SetupDepthPeeling()
         GetDevice()->DestroyShaderModule(PS);
     }
 
+    ////////////////////////////////////////
+    // Dual
+    ////////////////////////////////////////
+
+    // Min-max depth texture, blended with MAX
+    {
+        grfx::TextureCreateInfo createInfo         = {};
+        createInfo.imageType                       = grfx::IMAGE_TYPE_2D;
+        createInfo.width                           = mDepthPeeling.layerTextures[0]->GetWidth();
+        createInfo.height                          = mDepthPeeling.layerTextures[0]->GetHeight();
+        createInfo.depth                           = 1;
+        createInfo.imageFormat                     = grfx::FORMAT_R32G32_FLOAT;
+        createInfo.sampleCount                     = grfx::SAMPLE_COUNT_1;
+        createInfo.mipLevelCount                   = 1;
+        createInfo.arrayLayerCount                 = 1;
+        createInfo.usageFlags.bits.colorAttachment = true;
+        createInfo.usageFlags.bits.sampled         = true;
+        createInfo.memoryUsage                     = grfx::MEMORY_USAGE_GPU_ONLY;
+        createInfo.initialState                    = grfx::RESOURCE_STATE_SHADER_RESOURCE;
+
+        for (uint32_t i = 0; i < DEPTH_PEELING_DEPTH_TEXTURES_COUNT; ++i) {
+            PPX_CHECKED_CALL(GetDevice()->CreateTexture(&createInfo, &mDepthPeeling.dualDepthTextures[i]));
+        }
+    }
+
+    // Pass
+    {
+        grfx::DrawPassCreateInfo2 createInfo  = {};
+        createInfo.width                      = mDepthPeeling.layerTextures[0]->GetWidth();
+        createInfo.height                     = mDepthPeeling.layerTextures[0]->GetHeight();
+        createInfo.renderTargetCount          = 1;
+        createInfo.pRenderTargetImages[0]     = mDepthPeeling.dualDepthTextures[0]->GetImage();
+        createInfo.pDepthStencilImage         = nullptr;
+        createInfo.renderTargetClearValues[0] = {DEPTH_PEELING_DUAL_EMPTY_DEPTH, DEPTH_PEELING_DUAL_EMPTY_DEPTH, 0, 0};
+        PPX_CHECKED_CALL(GetDevice()->CreateDrawPass(&createInfo, &mDepthPeeling.dualInitPass));
+
+        // Pass i reads the depth texture i % 2 and writes the other one
+        createInfo.renderTargetCount          = 3;
+        createInfo.renderTargetClearValues[1] = {0, 0, 0, 0};
+        createInfo.renderTargetClearValues[2] = {0, 0, 0, 0};
+        for (uint32_t i = 0; i < DEPTH_PEELING_DUAL_PASSES_COUNT; ++i) {
+            createInfo.pRenderTargetImages[0] = mDepthPeeling.dualDepthTextures[(i + 1) % DEPTH_PEELING_DEPTH_TEXTURES_COUNT]->GetImage();
+            createInfo.pRenderTargetImages[1] = mDepthPeeling.layerTextures[i]->GetImage();
+            createInfo.pRenderTargetImages[2] = mDepthPeeling.layerTextures[DEPTH_PEELING_LAYERS_COUNT - 1 - i]->GetImage();
+            PPX_CHECKED_CALL(GetDevice()->CreateDrawPass(&createInfo, &mDepthPeeling.dualPeelPasses[i]));
+        }
+    }
+
+    // Descriptor
+    {
+        grfx::DescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding{SHADER_GLOBALS_REGISTER, grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, grfx::SHADER_STAGE_ALL_GRAPHICS});
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding{CUSTOM_SAMPLER_0_REGISTER, grfx::DESCRIPTOR_TYPE_SAMPLER, 1, grfx::SHADER_STAGE_ALL_GRAPHICS});
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding{CUSTOM_TEXTURE_0_REGISTER, grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1, grfx::SHADER_STAGE_ALL_GRAPHICS});
+        layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding{CUSTOM_TEXTURE_1_REGISTER, grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1, grfx::SHADER_STAGE_ALL_GRAPHICS});
+        PPX_CHECKED_CALL(GetDevice()->CreateDescriptorSetLayout(&layoutCreateInfo, &mDepthPeeling.dualDescriptorSetLayout));
+
+        for (uint32_t i = 0; i < DEPTH_PEELING_DEPTH_TEXTURES_COUNT; ++i) {
+            PPX_CHECKED_CALL(GetDevice()->AllocateDescriptorSet(mDescriptorPool, mDepthPeeling.dualDescriptorSetLayout, &mDepthPeeling.dualDescriptorSets[i]));
+
+            std::array<grfx::WriteDescriptor, 4> writes = {};
+
+            writes[0].binding      = SHADER_GLOBALS_REGISTER;
+            writes[0].type         = grfx::DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            writes[0].bufferOffset = 0;
+            writes[0].bufferRange  = PPX_WHOLE_SIZE;
+            writes[0].pBuffer      = mShaderGlobalsBuffer;
+
+            writes[1].binding  = CUSTOM_SAMPLER_0_REGISTER;
+            writes[1].type     = grfx::DESCRIPTOR_TYPE_SAMPLER;
+            writes[1].pSampler = mNearestSampler;
+
+            writes[2].binding    = CUSTOM_TEXTURE_0_REGISTER;
+            writes[2].arrayIndex = 0;
+            writes[2].type       = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            writes[2].pImageView = mOpaquePass->GetDepthStencilTexture()->GetSampledImageView();
+
+            writes[3].binding    = CUSTOM_TEXTURE_1_REGISTER;
+            writes[3].arrayIndex = 0;
+            writes[3].type       = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            writes[3].pImageView = mDepthPeeling.dualDepthTextures[i]->GetSampledImageView();
+
+            PPX_CHECKED_CALL(mDepthPeeling.dualDescriptorSets[i]->UpdateDescriptors(static_cast<uint32_t>(writes.size()), writes.data()));
+        }
+    }
+
+    // Pipeline
+    {
+        grfx::PipelineInterfaceCreateInfo piCreateInfo = {};
+        piCreateInfo.setCount                          = 1;
+        piCreateInfo.sets[0].set                       = 0;
+        piCreateInfo.sets[0].pLayout                   = mDepthPeeling.dualDescriptorSetLayout;
+        PPX_CHECKED_CALL(GetDevice()->CreatePipelineInterface(&piCreateInfo, &mDepthPeeling.dualPipelineInterface));
+
+        // Every target is blended with MAX, so the blend state is the same
+        // for all of them and does not need independent blending
+        grfx::GraphicsPipelineCreateInfo gpCreateInfo   = {};
+        gpCreateInfo.vertexInputState.bindingCount      = 1;
+        gpCreateInfo.vertexInputState.bindings[0]       = GetTransparentMesh()->GetDerivedVertexBindings()[0];
+        gpCreateInfo.inputAssemblyState.topology        = grfx::PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        gpCreateInfo.rasterState.polygonMode            = grfx::POLYGON_MODE_FILL;
+        gpCreateInfo.rasterState.cullMode               = grfx::CULL_MODE_NONE;
+        gpCreateInfo.rasterState.frontFace              = grfx::FRONT_FACE_CCW;
+        gpCreateInfo.rasterState.rasterizationSamples   = grfx::SAMPLE_COUNT_1;
+        gpCreateInfo.depthStencilState.depthTestEnable  = false;
+        gpCreateInfo.depthStencilState.depthWriteEnable = false;
+        gpCreateInfo.outputState.renderTargetFormats[0] = mDepthPeeling.dualDepthTextures[0]->GetImageFormat();
+        gpCreateInfo.outputState.renderTargetFormats[1] = mDepthPeeling.layerTextures[0]->GetImageFormat();
+        gpCreateInfo.outputState.renderTargetFormats[2] = mDepthPeeling.layerTextures[0]->GetImageFormat();
+        gpCreateInfo.pPipelineInterface                 = mDepthPeeling.dualPipelineInterface;
+        for (uint32_t i = 0; i < 3; ++i) {
+            grfx::BlendAttachmentState& blendAttachment = gpCreateInfo.colorBlendState.blendAttachments[i];
+            blendAttachment.blendEnable                 = true;
+            blendAttachment.srcColorBlendFactor         = grfx::BLEND_FACTOR_ONE;
+            blendAttachment.dstColorBlendFactor         = grfx::BLEND_FACTOR_ONE;
+            blendAttachment.colorBlendOp                = grfx::BLEND_OP_MAX;
+            blendAttachment.srcAlphaBlendFactor         = grfx::BLEND_FACTOR_ONE;
+            blendAttachment.dstAlphaBlendFactor         = grfx::BLEND_FACTOR_ONE;
+            blendAttachment.alphaBlendOp                = grfx::BLEND_OP_MAX;
+            blendAttachment.colorWriteMask              = grfx::ColorComponentFlags::RGBA();
+        }
+
+        grfx::ShaderModulePtr VS, PS;
+
+        PPX_CHECKED_CALL(CreateShader("oit_demo/shaders", "DepthPeelingDual_Init.vs", &VS));
+        PPX_CHECKED_CALL(CreateShader("oit_demo/shaders", "DepthPeelingDual_Init.ps", &PS));
+        gpCreateInfo.VS                                   = {VS, "vsmain"};
+        gpCreateInfo.PS                                   = {PS, "psmain"};
+        gpCreateInfo.colorBlendState.blendAttachmentCount = 1;
+        gpCreateInfo.outputState.renderTargetCount        = 1;
+        PPX_CHECKED_CALL(GetDevice()->CreateGraphicsPipeline(&gpCreateInfo, &mDepthPeeling.dualInitPipeline));
+        GetDevice()->DestroyShaderModule(VS);
+        GetDevice()->DestroyShaderModule(PS);
+
+        PPX_CHECKED_CALL(CreateShader("oit_demo/shaders", "DepthPeelingDual_Peel.vs", &VS));
+        PPX_CHECKED_CALL(CreateShader("oit_demo/shaders", "DepthPeelingDual_Peel.ps", &PS));
+        gpCreateInfo.VS                                   = {VS, "vsmain"};
+        gpCreateInfo.PS                                   = {PS, "psmain"};
+        gpCreateInfo.colorBlendState.blendAttachmentCount = 3;
+        gpCreateInfo.outputState.renderTargetCount        = 3;
+        PPX_CHECKED_CALL(GetDevice()->CreateGraphicsPipeline(&gpCreateInfo, &mDepthPeeling.dualPeelPipeline));
+        GetDevice()->DestroyShaderModule(VS);
+        GetDevice()->DestroyShaderModule(PS);
+    }
+
+    // Occlusion queries
+    {
+        grfx::QueryCreateInfo queryCreateInfo = {};
+        queryCreateInfo.type                  = grfx::QUERY_TYPE_OCCLUSION;
+        queryCreateInfo.count                 = DEPTH_PEELING_LAYERS_COUNT;
+        PPX_CHECKED_CALL(GetDevice()->CreateQuery(&queryCreateInfo, &mDepthPeeling.occlusionQuery));
+    }
+
     ////////////////////////////////////////
     // Combine
     ////////////////////////////////////////
@@ -230,45 +383,107 @@ void OITDemoApp::SetupDepthPeeling()
     }
 }
 
-void OITDemoApp::RecordDepthPeeling()
+void OITDemoApp::RecordDepthPeelingFrontToBack()
 {
-    // Layer passes: extract all layers
-    for (uint32_t i = 0; i < DEPTH_PEELING_LAYERS_COUNT; ++i) {
+    // Layer passes: extract the layers
+    for (uint32_t i = 0; i < mDepthPeeling.peelPassCount; ++i) {
         grfx::DrawPassPtr layerPass = mDepthPeeling.layerPasses[i];
-        mCommandBuffer->TransitionImageLayout(
-            layerPass,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_RENDER_TARGET,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
+        mCommandBuffer->RequireResourceState(layerPass, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
         mCommandBuffer->BeginRenderPass(layerPass, grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_ALL);
 
         mCommandBuffer->SetScissors(layerPass->GetScissor());
         mCommandBuffer->SetViewports(layerPass->GetViewport());
 
+        if (mDepthPeeling.earlyExit) {
+            mCommandBuffer->BeginQuery(mDepthPeeling.occlusionQuery, i);
+        }
         mCommandBuffer->BindGraphicsDescriptorSets(mDepthPeeling.layerPipelineInterface, 1, &mDepthPeeling.layerDescriptorSets[i % DEPTH_PEELING_DEPTH_TEXTURES_COUNT]);
         mCommandBuffer->BindGraphicsPipeline(i == 0 ? mDepthPeeling.layerPipeline_FirstLayer : mDepthPeeling.layerPipeline_OtherLayers);
         mCommandBuffer->BindIndexBuffer(GetTransparentMesh());
         mCommandBuffer->BindVertexBuffers(GetTransparentMesh());
         mCommandBuffer->DrawIndexed(GetTransparentMesh()->GetIndexCount());
+        if (mDepthPeeling.earlyExit) {
+            mCommandBuffer->EndQuery(mDepthPeeling.occlusionQuery, i);
+        }
 
         mCommandBuffer->EndRenderPass();
-        mCommandBuffer->TransitionImageLayout(
-            layerPass,
-            grfx::RESOURCE_STATE_RENDER_TARGET,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE);
+        mCommandBuffer->RequireResourceState(layerPass, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    }
+}
+
+void OITDemoApp::RecordDepthPeelingDual()
+{
+    // Init pass: the depth range of all the fragments
+    {
+        grfx::DrawPassPtr initPass = mDepthPeeling.dualInitPass;
+        mCommandBuffer->RequireResourceState(initPass, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
+        mCommandBuffer->BeginRenderPass(initPass, grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_RENDER_TARGETS);
+
+        mCommandBuffer->SetScissors(initPass->GetScissor());
+        mCommandBuffer->SetViewports(initPass->GetViewport());
+
+        mCommandBuffer->BindGraphicsDescriptorSets(mDepthPeeling.dualPipelineInterface, 1, &mDepthPeeling.dualDescriptorSets[1]);
+        mCommandBuffer->BindGraphicsPipeline(mDepthPeeling.dualInitPipeline);
+        mCommandBuffer->BindIndexBuffer(GetTransparentMesh());
+        mCommandBuffer->BindVertexBuffers(GetTransparentMesh());
+        mCommandBuffer->DrawIndexed(GetTransparentMesh()->GetIndexCount());
+
+        mCommandBuffer->EndRenderPass();
+        mCommandBuffer->RequireResourceState(initPass, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    }
+
+    // Peel passes: extract a front and a back layer each
+    for (uint32_t i = 0; i < mDepthPeeling.peelPassCount; ++i) {
+        grfx::DrawPassPtr peelPass = mDepthPeeling.dualPeelPasses[i];
+        mCommandBuffer->RequireResourceState(peelPass, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
+        mCommandBuffer->BeginRenderPass(peelPass, grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_RENDER_TARGETS);
+
+        mCommandBuffer->SetScissors(peelPass->GetScissor());
+        mCommandBuffer->SetViewports(peelPass->GetViewport());
+
+        if (mDepthPeeling.earlyExit) {
+            mCommandBuffer->BeginQuery(mDepthPeeling.occlusionQuery, i);
+        }
+        mCommandBuffer->BindGraphicsDescriptorSets(mDepthPeeling.dualPipelineInterface, 1, &mDepthPeeling.dualDescriptorSets[i % DEPTH_PEELING_DEPTH_TEXTURES_COUNT]);
+        mCommandBuffer->BindGraphicsPipeline(mDepthPeeling.dualPeelPipeline);
+        mCommandBuffer->BindIndexBuffer(GetTransparentMesh());
+        mCommandBuffer->BindVertexBuffers(GetTransparentMesh());
+        mCommandBuffer->DrawIndexed(GetTransparentMesh()->GetIndexCount());
+        if (mDepthPeeling.earlyExit) {
+            mCommandBuffer->EndQuery(mDepthPeeling.occlusionQuery, i);
+        }
+
+        mCommandBuffer->EndRenderPass();
+        mCommandBuffer->RequireResourceState(peelPass, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    }
+}
+
+void OITDemoApp::RecordDepthPeeling()
+{
+    // Layers sample the opaque depth
+    mCommandBuffer->RequireResourceState(mOpaquePass->GetDepthStencilTexture(), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+
+    // The previous frame has completed, its results were read
+    if (mDepthPeeling.earlyExit) {
+        mDepthPeeling.occlusionQuery->Reset(0, DEPTH_PEELING_LAYERS_COUNT);
+    }
+
+    if (mDepthPeeling.type == DEPTH_PEELING_TYPE_DUAL) {
+        RecordDepthPeelingDual();
+    }
+    else {
+        RecordDepthPeelingFrontToBack();
+    }
+
+    if (mDepthPeeling.earlyExit) {
+        mCommandBuffer->ResolveQueryData(mDepthPeeling.occlusionQuery, 0, mDepthPeeling.peelPassCount);
+        mDepthPeeling.queriedPassCount = mDepthPeeling.peelPassCount;
+        mDepthPeeling.queriedType      = mDepthPeeling.type;
     }
 
     // Transparency pass: combine the results for each pixels
     {
-        mCommandBuffer->TransitionImageLayout(
-            mTransparencyPass,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_RENDER_TARGET,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
+        mCommandBuffer->RequireResourceState(mTransparencyPass, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
         mCommandBuffer->BeginRenderPass(mTransparencyPass, grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_RENDER_TARGETS);
 
         mCommandBuffer->SetScissors(mTransparencyPass->GetScissor());
@@ -279,11 +494,43 @@ void OITDemoApp::RecordDepthPeeling()
         mCommandBuffer->Draw(3);
 
         mCommandBuffer->EndRenderPass();
-        mCommandBuffer->TransitionImageLayout(
-            mTransparencyPass,
-            grfx::RESOURCE_STATE_RENDER_TARGET,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE);
     }
 }
+
+uint32_t OITDemoApp::GetDepthPeelingPassCount() const
+{
+    const DepthPeelingType type          = mDepthPeeling.type;
+    const uint32_t         maxPassCount  = (type == DEPTH_PEELING_TYPE_DUAL) ? DEPTH_PEELING_DUAL_PASSES_COUNT : DEPTH_PEELING_LAYERS_COUNT;
+    const bool             resultsUsable = mDepthPeeling.occupiedValid && (mDepthPeeling.occupiedType == type);
+    if (!mDepthPeeling.earlyExit || !resultsUsable) {
+        return maxPassCount;
+    }
+
+    // The occupied passes, plus one that is expected to stay empty so that
+    // new layers are noticed. If it was not empty, their number is unknown.
+    if (mDepthPeeling.occupiedPassCount < mDepthPeeling.queriedPassCount) {
+        return std::min(maxPassCount, mDepthPeeling.occupiedPassCount + 1);
+    }
+    return maxPassCount;
+}
+
+void OITDemoApp::ReadDepthPeelingQueries()
+{
+    if (mDepthPeeling.queriedPassCount == 0) {
+        return;
+    }
+
+    uint64_t samples[DEPTH_PEELING_LAYERS_COUNT] = {};
+    PPX_CHECKED_CALL(mDepthPeeling.occlusionQuery->GetData(samples, mDepthPeeling.queriedPassCount * sizeof(uint64_t)));
+
+    // A pass that wrote no sample leaves nothing to the following ones
+    uint32_t occupiedPassCount = 0;
+    while ((occupiedPassCount < mDepthPeeling.queriedPassCount) && (samples[occupiedPassCount] > 0)) {
+        ++occupiedPassCount;
+    }
+
+    mDepthPeeling.occupiedValid     = true;
+    mDepthPeeling.occupiedPassCount = occupiedPassCount;
+    mDepthPeeling.occupiedType      = mDepthPeeling.queriedType;
+    mDepthPeeling.queriedPassCount  = 0;
+}
@@ -17,7 +17,6 @@
 // TODO Several meshes on top of each other (including opaque ones)
 // TODO Choice of cubemaps as background
 // TODO Add WeightedAverage with depth
-// TODO Add Dual depth peeling
 // TODO Add split windows support to compare algorithms
 
 #include "OITDemoApplication.h"
@@ -72,6 +71,23 @@ void OITDemoApp::SetupCommon()
     // Command buffer
     {
         PPX_CHECKED_CALL(GetGraphicsQueue()->CreateCommandBuffer(&mCommandBuffer));
+
+        // The frame graph places barriers through the state tracker
+        mCommandBuffer->SetResourceStateTrackingEnabled(true);
+    }
+
+    // Frame graph
+    {
+        PPX_CHECKED_CALL(mFrameGraph.Initialize(GetDevice()));
+    }
+
+    // Transparency timestamps
+    {
+        grfx::QueryCreateInfo queryCreateInfo = {};
+        queryCreateInfo.type                  = grfx::QUERY_TYPE_TIMESTAMP;
+        queryCreateInfo.count                 = 1;
+        PPX_CHECKED_CALL(GetDevice()->CreateQuery(&queryCreateInfo, &mTransparencyStartQuery));
+        PPX_CHECKED_CALL(GetDevice()->CreateQuery(&queryCreateInfo, &mTransparencyEndQuery));
     }
 
     // Descriptor pool
@@ -79,6 +95,7 @@ void OITDemoApp::SetupCommon()
         grfx::DescriptorPoolCreateInfo createInfo = {};
         createInfo.sampler                        = 16;
         createInfo.sampledImage                   = 16;
+        createInfo.storageImage                   = 16;
         createInfo.uniformBuffer                  = 16;
         createInfo.structuredBuffer               = 16;
         createInfo.storageTexelBuffer             = 16;
@@ -345,13 +362,16 @@ void OITDemoApp::ParseCommandLineOptions()
 
     mGuiParameters.weightedAverage.type = static_cast<WeightAverageType>(std::clamp(cliOptions.GetExtraOptionValueOrDefault("wa_type", 0), 0, WEIGHTED_AVERAGE_TYPES_COUNT - 1));
 
+    mGuiParameters.depthPeeling.type        = static_cast<DepthPeelingType>(std::clamp(cliOptions.GetExtraOptionValueOrDefault("dp_type", 0), 0, DEPTH_PEELING_TYPES_COUNT - 1));
     mGuiParameters.depthPeeling.startLayer  = std::clamp(cliOptions.GetExtraOptionValueOrDefault("dp_start_layer", 0), 0, DEPTH_PEELING_LAYERS_COUNT - 1);
     mGuiParameters.depthPeeling.layersCount = std::clamp(cliOptions.GetExtraOptionValueOrDefault("dp_layers_count", DEPTH_PEELING_LAYERS_COUNT), 1, DEPTH_PEELING_LAYERS_COUNT);
+    mGuiParameters.depthPeeling.earlyExit   = cliOptions.GetExtraOptionValueOrDefault("dp_early_exit", false);
 
     mGuiParameters.buffer.type                        = static_cast<BufferAlgorithmType>(std::clamp(cliOptions.GetExtraOptionValueOrDefault("bu_type", 0), 0, BUFFER_ALGORITHMS_COUNT - 1));
     mGuiParameters.buffer.bucketsFragmentsMaxCount    = std::clamp(cliOptions.GetExtraOptionValueOrDefault("bu_buckets_fragments_max_count", BUFFER_BUCKETS_SIZE_PER_PIXEL), 1, BUFFER_BUCKETS_SIZE_PER_PIXEL);
     mGuiParameters.buffer.listsFragmentBufferScale    = std::clamp(cliOptions.GetExtraOptionValueOrDefault("bu_lists_fragment_buffer_scale", BUFFER_LISTS_FRAGMENT_BUFFER_MAX_SCALE), 1, BUFFER_LISTS_FRAGMENT_BUFFER_MAX_SCALE);
     mGuiParameters.buffer.listsSortedFragmentMaxCount = std::clamp(cliOptions.GetExtraOptionValueOrDefault("bu_lists_sorted_fragment_max_count", BUFFER_LISTS_SORTED_FRAGMENT_MAX_COUNT), 1, BUFFER_LISTS_SORTED_FRAGMENT_MAX_COUNT);
+    mGuiParameters.buffer.kBufferLayersCount          = std::clamp(cliOptions.GetExtraOptionValueOrDefault("bu_kbuffer_layers_count", BUFFER_K_BUFFER_SIZE_PER_PIXEL), 1, BUFFER_K_BUFFER_SIZE_PER_PIXEL);
 }
 
 void OITDemoApp::Setup()
@@ -414,9 +434,16 @@ void OITDemoApp::Update()
         shaderGlobals.depthPeelingFrontLayerIndex = std::max(0, mGuiParameters.depthPeeling.startLayer);
         shaderGlobals.depthPeelingBackLayerIndex  = std::min(DEPTH_PEELING_LAYERS_COUNT - 1, mGuiParameters.depthPeeling.startLayer + mGuiParameters.depthPeeling.layersCount - 1);
 
+        mDepthPeeling.type                         = mGuiParameters.depthPeeling.type;
+        mDepthPeeling.earlyExit                    = mGuiParameters.depthPeeling.earlyExit;
+        mDepthPeeling.peelPassCount                = GetDepthPeelingPassCount();
+        shaderGlobals.depthPeelingFrontLayersCount = static_cast<int>(mDepthPeeling.peelPassCount);
+        shaderGlobals.depthPeelingBackLayersCount  = (mDepthPeeling.type == DEPTH_PEELING_TYPE_DUAL) ? static_cast<int>(mDepthPeeling.peelPassCount) : 0;
+
         shaderGlobals.bufferBucketsFragmentsMaxCount    = std::min(BUFFER_BUCKETS_SIZE_PER_PIXEL, mGuiParameters.buffer.bucketsFragmentsMaxCount);
         shaderGlobals.bufferListsFragmentBufferScale    = std::min(BUFFER_LISTS_FRAGMENT_BUFFER_MAX_SCALE, mGuiParameters.buffer.listsFragmentBufferScale);
         shaderGlobals.bufferListsSortedFragmentMaxCount = std::min(BUFFER_LISTS_SORTED_FRAGMENT_MAX_COUNT, mGuiParameters.buffer.listsSortedFragmentMaxCount);
+        shaderGlobals.bufferKBufferLayersCount          = std::min(BUFFER_K_BUFFER_SIZE_PER_PIXEL, mGuiParameters.buffer.kBufferLayersCount);
 
         mShaderGlobalsBuffer->CopyFromSource(sizeof(shaderGlobals), &shaderGlobals);
     }
@@ -486,8 +513,17 @@ void OITDemoApp::UpdateGUI()
             }
             case ALGORITHM_DEPTH_PEELING: {
                 ImGui::Text("%s", mSupportedAlgorithmNames[mGuiParameters.algorithmDataIndex]);
+                const char* typeChoices[] =
+                    {
+                        "Front to back",
+                        "Dual",
+                    };
+                static_assert(IM_ARRAYSIZE(typeChoices) == DEPTH_PEELING_TYPES_COUNT, "Depth peeling types count mismatch");
+                ImGui::Combo("DP type", reinterpret_cast<int32_t*>(&mGuiParameters.depthPeeling.type), typeChoices, IM_ARRAYSIZE(typeChoices));
                 ImGui::SliderInt("DP first layer", &mGuiParameters.depthPeeling.startLayer, 0, DEPTH_PEELING_LAYERS_COUNT - 1);
                 ImGui::SliderInt("DP layers count", &mGuiParameters.depthPeeling.layersCount, 1, DEPTH_PEELING_LAYERS_COUNT);
+                ImGui::Checkbox("DP early exit", &mGuiParameters.depthPeeling.earlyExit);
+                ImGui::Text("DP peel passes: %u", mDepthPeeling.peelPassCount);
                 break;
             }
             case ALGORITHM_BUFFER: {
@@ -496,6 +532,7 @@ void OITDemoApp::UpdateGUI()
                     {
                         "Buckets",
                         "Linked list",
+                        "K-buffer",
                     };
                 static_assert(IM_ARRAYSIZE(typeChoices) == BUFFER_ALGORITHMS_COUNT, "Buffer algorithm types count mismatch");
                 ImGui::Combo("BU type", reinterpret_cast<int32_t*>(&mGuiParameters.buffer.type), typeChoices, IM_ARRAYSIZE(typeChoices));
@@ -509,6 +546,10 @@ void OITDemoApp::UpdateGUI()
                         ImGui::SliderInt("BU linked list max size", &mGuiParameters.buffer.listsSortedFragmentMaxCount, 1, BUFFER_LISTS_SORTED_FRAGMENT_MAX_COUNT);
                         break;
                     }
+                    case BUFFER_ALGORITHM_K_BUFFER: {
+                        ImGui::SliderInt("BU k-buffer layers count", &mGuiParameters.buffer.kBufferLayersCount, 1, BUFFER_K_BUFFER_SIZE_PER_PIXEL);
+                        break;
+                    }
                     default: {
                         break;
                     }
@@ -519,41 +560,53 @@ void OITDemoApp::UpdateGUI()
                 break;
             }
         }
+
+        ImGui::Separator();
+        ImGui::Text("Statistics");
+        ImGui::Text("Transparency GPU time: %.3f ms", mStatistics.transparencyGpuTimeMs);
+        ImGui::Text("Geometry passes: %u", mStatistics.geometryPassCount);
+        ImGui::Text("Algorithm memory: %.2f MB", static_cast<float>(mStatistics.algorithmMemorySize) / (1024.0f * 1024.0f));
+        if (mStatistics.bufferStatsValid) {
+            ImGui::Text("Fragments: %u (%u overflowed)", mStatistics.bufferFragmentCount, mStatistics.bufferOverflowCount);
+        }
+
+        ImGui::Separator();
+        ImGui::Text("Frame graph");
+        const ppx::FrameGraphStats& stats = mFrameGraph.GetStats();
+        ImGui::Text("Passes: %u (%u culled)", stats.passCount, stats.culledPassCount);
+        ImGui::Text("Transient textures: %u (%u physical)", stats.transientResourceCount, stats.physicalTextureCount);
+        ImGui::Text("Transient memory: %.2f MB", static_cast<float>(stats.transientMemorySize) / (1024.0f * 1024.0f));
+        ImGui::Text("Barriers / Batches: %u / %u", mCommandBuffer->GetBarrierCount(), mCommandBuffer->GetBarrierBatchCount());
     }
     ImGui::End();
 }
 
-void OITDemoApp::RecordOpaque()
+void OITDemoApp::BuildFrameGraph(grfx::RenderPassPtr renderPass)
 {
-    mCommandBuffer->TransitionImageLayout(
-        mOpaquePass,
-        grfx::RESOURCE_STATE_SHADER_RESOURCE,
-        grfx::RESOURCE_STATE_RENDER_TARGET,
-        grfx::RESOURCE_STATE_SHADER_RESOURCE,
-        grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
-    mCommandBuffer->BeginRenderPass(mOpaquePass, grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_ALL);
+    PPX_ASSERT_MSG(!renderPass.IsNull(), "render pass object is null");
 
-    mCommandBuffer->SetScissors(mOpaquePass->GetScissor());
-    mCommandBuffer->SetViewports(mOpaquePass->GetViewport());
+    mFrameGraph.Reset();
 
-    if (mGuiParameters.background.display) {
-        mCommandBuffer->BindGraphicsDescriptorSets(mOpaquePipelineInterface, 1, &mOpaqueDescriptorSet);
-        mCommandBuffer->BindGraphicsPipeline(mOpaquePipeline);
-        mCommandBuffer->BindIndexBuffer(mBackgroundMesh);
-        mCommandBuffer->BindVertexBuffers(mBackgroundMesh);
-        mCommandBuffer->DrawIndexed(mBackgroundMesh->GetIndexCount());
-    }
+    const ppx::FrameGraphResource opaqueColor  = mFrameGraph.ImportTexture("OpaqueColor", mOpaquePass->GetRenderTargetTexture(0));
+    const ppx::FrameGraphResource opaqueDepth  = mFrameGraph.ImportTexture("OpaqueDepth", mOpaquePass->GetDepthStencilTexture());
+    const ppx::FrameGraphResource transparency = mFrameGraph.ImportTexture("Transparency", mTransparencyTexture);
+    const ppx::FrameGraphResource swapchain    = mFrameGraph.ImportImage("Swapchain", renderPass->GetRenderTargetImage(0), grfx::RESOURCE_STATE_PRESENT);
 
-    mCommandBuffer->EndRenderPass();
-    mCommandBuffer->TransitionImageLayout(
-        mOpaquePass,
-        grfx::RESOURCE_STATE_RENDER_TARGET,
-        grfx::RESOURCE_STATE_SHADER_RESOURCE,
-        grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE,
-        grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    mFrameGraph.AddPass("Opaque", ppx::FRAME_GRAPH_PASS_TYPE_GRAPHICS, [this](ppx::FrameGraphPassContext&) { RecordOpaque(); })
+        .SetRenderTarget(0, opaqueColor, ppx::FRAME_GRAPH_LOAD_OP_CLEAR, {0, 0, 0, 0})
+        .SetDepthStencil(opaqueDepth, ppx::FRAME_GRAPH_LOAD_OP_CLEAR, {1.0f, 0xFF});
+
+    AddTransparencyPasses(opaqueDepth, transparency);
+
+    mFrameGraph.AddPass("Composite", ppx::FRAME_GRAPH_PASS_TYPE_GRAPHICS, [this, renderPass](ppx::FrameGraphPassContext&) { RecordComposite(renderPass); })
+        .Read(opaqueColor)
+        .Read(transparency)
+        .Write(swapchain, grfx::RESOURCE_STATE_RENDER_TARGET);
+
+    PPX_CHECKED_CALL(mFrameGraph.Compile());
 }
 
-void OITDemoApp::RecordTransparency()
+void OITDemoApp::AddTransparencyPasses(ppx::FrameGraphResource opaqueDepth, ppx::FrameGraphResource transparency)
 {
     void (OITDemoApp::*recordFuncs[])() =
         {
@@ -567,16 +620,48 @@ void OITDemoApp::RecordTransparency()
 
     const Algorithm algorithm = GetSelectedAlgorithm();
     PPX_ASSERT_MSG(algorithm >= 0 && algorithm < ALGORITHMS_COUNT, "unknown algorithm");
-    (this->*recordFuncs[algorithm])();
+
+    if (algorithm == ALGORITHM_WEIGHTED_AVERAGE) {
+        AddWeightedAverageGatherPass(opaqueDepth);
+    }
+
+    // Algorithms sample or attach the opaque depth in different states and
+    // take care of it themselves.
+    auto                       recordFunc = recordFuncs[algorithm];
+    ppx::FrameGraphPassBuilder pass       = mFrameGraph.AddPass("Transparency", ppx::FRAME_GRAPH_PASS_TYPE_GRAPHICS, [this, recordFunc](ppx::FrameGraphPassContext&) {
+        mTransparencyStartQuery->Reset(0, 1);
+        mTransparencyEndQuery->Reset(0, 1);
+        mCommandBuffer->WriteTimestamp(mTransparencyStartQuery, grfx::PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0);
+
+        (this->*recordFunc)();
+
+        mCommandBuffer->WriteTimestamp(mTransparencyEndQuery, grfx::PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+        mCommandBuffer->ResolveQueryData(mTransparencyStartQuery, 0, 1);
+        mCommandBuffer->ResolveQueryData(mTransparencyEndQuery, 0, 1);
+        mTransparencyTimestampsWritten = true;
+    });
+    pass.Write(transparency, grfx::RESOURCE_STATE_RENDER_TARGET);
+    pass.Read(opaqueDepth, grfx::RESOURCE_STATE_UNDEFINED);
+
+    if (algorithm == ALGORITHM_WEIGHTED_AVERAGE) {
+        pass.Read(mWeightedAverage.colorResource);
+        pass.Read(mWeightedAverage.extraResource);
+    }
 }
 
-void OITDemoApp::RecordComposite(grfx::RenderPassPtr renderPass)
+void OITDemoApp::RecordOpaque()
 {
-    PPX_ASSERT_MSG(!renderPass.IsNull(), "render pass object is null");
-
-    mCommandBuffer->TransitionImageLayout(
-        renderPass->GetRenderTargetImage(0), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_PRESENT, grfx::RESOURCE_STATE_RENDER_TARGET);
+    if (mGuiParameters.background.display) {
+        mCommandBuffer->BindGraphicsDescriptorSets(mOpaquePipelineInterface, 1, &mOpaqueDescriptorSet);
+        mCommandBuffer->BindGraphicsPipeline(mOpaquePipeline);
+        mCommandBuffer->BindIndexBuffer(mBackgroundMesh);
+        mCommandBuffer->BindVertexBuffers(mBackgroundMesh);
+        mCommandBuffer->DrawIndexed(mBackgroundMesh->GetIndexCount());
+    }
+}
 
+void OITDemoApp::RecordComposite(grfx::RenderPassPtr renderPass)
+{
     grfx::RenderPassBeginInfo beginInfo = {};
     beginInfo.pRenderPass               = renderPass;
     beginInfo.renderArea                = renderPass->GetRenderArea();
@@ -595,8 +680,6 @@ void OITDemoApp::RecordComposite(grfx::RenderPassPtr renderPass)
     DrawImGui(mCommandBuffer);
 
     mCommandBuffer->EndRenderPass();
-    mCommandBuffer->TransitionImageLayout(
-        renderPass->GetRenderTargetImage(0), PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_PRESENT);
 }
 
 void OITDemoApp::Render()
@@ -606,14 +689,19 @@ void OITDemoApp::Render()
     PPX_CHECKED_CALL(mImageAcquiredFence->WaitAndReset());
     PPX_CHECKED_CALL(mRenderCompleteFence->WaitAndReset());
 
+    // The previous frame has completed
+    ReadDepthPeelingQueries();
+    ReadStatistics();
+
     // Update state
     Update();
 
+    // Build frame graph
+    BuildFrameGraph(GetSwapchain()->GetRenderPass(imageIndex));
+
     // Record command buffer
     PPX_CHECKED_CALL(mCommandBuffer->Begin());
-    RecordOpaque();
-    RecordTransparency();
-    RecordComposite(GetSwapchain()->GetRenderPass(imageIndex));
+    mFrameGraph.Execute(mCommandBuffer);
     PPX_CHECKED_CALL(mCommandBuffer->End());
 
     // Submit and present
@@ -628,3 +716,157 @@ void OITDemoApp::Render()
     PPX_CHECKED_CALL(GetGraphicsQueue()->Submit(&submitInfo));
     PPX_CHECKED_CALL(GetSwapchain()->Present(imageIndex, 1, &mRenderCompleteSemaphore));
 }
+
+uint32_t OITDemoApp::GetGeometryPassCount() const
+{
+    switch (GetSelectedAlgorithm()) {
+        case ALGORITHM_UNSORTED_OVER: {
+            return (mGuiParameters.unsortedOver.faceMode == FACE_MODE_ALL_BACK_THEN_FRONT) ? 2 : 1;
+        }
+        case ALGORITHM_DEPTH_PEELING: {
+            // The GUI only selects the combined layers, not the peeled ones
+            return (mDepthPeeling.type == DEPTH_PEELING_TYPE_DUAL) ? (1 + mDepthPeeling.peelPassCount) : mDepthPeeling.peelPassCount;
+        }
+        case ALGORITHM_BUFFER: {
+            return (mGuiParameters.buffer.type == BUFFER_ALGORITHM_K_BUFFER) ? 2 : 1;
+        }
+        default: {
+            return 1;
+        }
+    }
+}
+
+uint64_t OITDemoApp::GetAlgorithmMemorySize() const
+{
+    const auto textureSize = [](const grfx::TexturePtr& texture) -> uint64_t {
+        return static_cast<uint64_t>(texture->GetWidth()) * texture->GetHeight() * grfx::GetFormatDescription(texture->GetImageFormat())->bytesPerTexel;
+    };
+
+    // Transient textures, like the weighted average ones, are reported by the
+    // frame graph instead.
+    uint64_t size = 0;
+    switch (GetSelectedAlgorithm()) {
+        case ALGORITHM_DEPTH_PEELING: {
+            for (const grfx::TexturePtr& texture : mDepthPeeling.layerTextures) {
+                size += textureSize(texture);
+            }
+            const bool dualDepthPeeling = (mDepthPeeling.type == DEPTH_PEELING_TYPE_DUAL);
+            for (const grfx::TexturePtr& texture : (dualDepthPeeling ? mDepthPeeling.dualDepthTextures : mDepthPeeling.depthTextures)) {
+                size += textureSize(texture);
+            }
+            break;
+        }
+        case ALGORITHM_BUFFER: {
+            switch (mGuiParameters.buffer.type) {
+                case BUFFER_ALGORITHM_BUCKETS: {
+                    size += textureSize(mBuffer.buckets.countTexture);
+                    size += textureSize(mBuffer.buckets.fragmentTexture);
+                    break;
+                }
+                case BUFFER_ALGORITHM_LINKED_LISTS: {
+                    size += textureSize(mBuffer.lists.linkedListHeadTexture);
+                    size += mBuffer.lists.fragmentBuffer->GetSize();
+                    size += mBuffer.lists.atomicCounter->GetSize();
+                    break;
+                }
+                case BUFFER_ALGORITHM_K_BUFFER: {
+                    size += textureSize(mBuffer.kbuffer.depthTexture);
+                    size += textureSize(mBuffer.kbuffer.colorTexture);
+                    size += textureSize(mBuffer.kbuffer.tailTexture);
+                    size += mBuffer.kbuffer.statsBuffer->GetSize();
+                    break;
+                }
+                default: {
+                    break;
+                }
+            }
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+    return size;
+}
+
+void OITDemoApp::ReadStatistics()
+{
+    mStatistics.geometryPassCount   = GetGeometryPassCount();
+    mStatistics.algorithmMemorySize = GetAlgorithmMemorySize();
+
+    if (mTransparencyTimestampsWritten) {
+        mTransparencyTimestampsWritten = false;
+
+        uint64_t data[2] = {0, 0};
+        PPX_CHECKED_CALL(mTransparencyStartQuery->GetData(&data[0], 1 * sizeof(uint64_t)));
+        PPX_CHECKED_CALL(mTransparencyEndQuery->GetData(&data[1], 1 * sizeof(uint64_t)));
+
+        uint64_t frequency = 0;
+        PPX_CHECKED_CALL(GetGraphicsQueue()->GetTimestampFrequency(&frequency));
+        if (frequency > 0) {
+            mStatistics.transparencyGpuTimeMs = static_cast<double>(data[1] - data[0]) * 1000.0 / static_cast<double>(frequency);
+        }
+    }
+
+    // Only the buffer algorithms copy their counters, the numbers stay
+    // invalid while any other one is selected.
+    mStatistics.bufferStatsValid = mBuffer.statsCopied;
+    if (mBuffer.statsCopied) {
+        mBuffer.statsCopied = false;
+
+        void* pMappedAddress = nullptr;
+        PPX_CHECKED_CALL(mBuffer.statsReadbackBuffer->MapMemory(0, &pMappedAddress));
+        const uint32_t* pCounters       = static_cast<const uint32_t*>(pMappedAddress);
+        mStatistics.bufferFragmentCount = pCounters[BUFFER_STATS_FRAGMENT_COUNT_INDEX];
+        mStatistics.bufferOverflowCount = pCounters[BUFFER_STATS_OVERFLOW_COUNT_INDEX];
+        mBuffer.statsReadbackBuffer->UnmapMemory();
+    }
+}
+
+void OITDemoApp::SetupMetrics()
+{
+    Application::SetupMetrics();
+    if (!HasActiveMetricsRun()) {
+        return;
+    }
+
+    ppx::metrics::MetricMetadata metadata = {ppx::metrics::MetricType::GAUGE, "Transparency GPU Time", "ms", ppx::metrics::MetricInterpretation::LOWER_IS_BETTER, {0.f, 60000.f}};
+    mTransparencyGpuTimeMetric            = AddMetric(metadata);
+    PPX_ASSERT_MSG(mTransparencyGpuTimeMetric != ppx::metrics::kInvalidMetricID, "Failed to add Transparency GPU Time metric");
+
+    metadata                 = {ppx::metrics::MetricType::GAUGE, "Transparency Geometry Passes", "passes", ppx::metrics::MetricInterpretation::LOWER_IS_BETTER, {0.f, 64.f}};
+    mGeometryPassCountMetric = AddMetric(metadata);
+    PPX_ASSERT_MSG(mGeometryPassCountMetric != ppx::metrics::kInvalidMetricID, "Failed to add Transparency Geometry Passes metric");
+
+    metadata                   = {ppx::metrics::MetricType::GAUGE, "Buffer Fragments", "fragments", ppx::metrics::MetricInterpretation::NONE, {0.f, std::numeric_limits<double>::max()}};
+    mBufferFragmentCountMetric = AddMetric(metadata);
+    PPX_ASSERT_MSG(mBufferFragmentCountMetric != ppx::metrics::kInvalidMetricID, "Failed to add Buffer Fragments metric");
+
+    metadata                   = {ppx::metrics::MetricType::GAUGE, "Buffer Overflow Fragments", "fragments", ppx::metrics::MetricInterpretation::LOWER_IS_BETTER, {0.f, std::numeric_limits<double>::max()}};
+    mBufferOverflowCountMetric = AddMetric(metadata);
+    PPX_ASSERT_MSG(mBufferOverflowCountMetric != ppx::metrics::kInvalidMetricID, "Failed to add Buffer Overflow Fragments metric");
+}
+
+void OITDemoApp::UpdateMetrics()
+{
+    if (!HasActiveMetricsRun()) {
+        return;
+    }
+
+    ppx::metrics::MetricData data = {ppx::metrics::MetricType::GAUGE};
+    data.gauge.seconds            = GetElapsedSeconds();
+
+    data.gauge.value = mStatistics.transparencyGpuTimeMs;
+    RecordMetricData(mTransparencyGpuTimeMetric, data);
+
+    data.gauge.value = static_cast<double>(mStatistics.geometryPassCount);
+    RecordMetricData(mGeometryPassCountMetric, data);
+
+    if (mStatistics.bufferStatsValid) {
+        data.gauge.value = static_cast<double>(mStatistics.bufferFragmentCount);
+        RecordMetricData(mBufferFragmentCountMetric, data);
+
+        data.gauge.value = static_cast<double>(mStatistics.bufferOverflowCount);
+        RecordMetricData(mBufferOverflowCountMetric, data);
+    }
+}
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "ppx/ppx.h"
+#include "ppx/frame_graph.h"
 
 using namespace ppx;
 
@@ -26,6 +27,10 @@ public:
     virtual void Setup() override;
     virtual void Render() override;
 
+protected:
+    virtual void SetupMetrics() override;
+    virtual void UpdateMetrics() override;
+
 private:
     enum Algorithm : int32_t
     {
@@ -62,10 +67,18 @@ private:
         WEIGHTED_AVERAGE_TYPES_COUNT,
     };
 
+    enum DepthPeelingType : int32_t
+    {
+        DEPTH_PEELING_TYPE_FRONT_TO_BACK,
+        DEPTH_PEELING_TYPE_DUAL,
+        DEPTH_PEELING_TYPES_COUNT,
+    };
+
     enum BufferAlgorithmType : int32_t
     {
         BUFFER_ALGORITHM_BUCKETS,
         BUFFER_ALGORITHM_LINKED_LISTS,
+        BUFFER_ALGORITHM_K_BUFFER,
         BUFFER_ALGORITHMS_COUNT,
     };
 
@@ -99,8 +112,10 @@ private:
 
         struct
         {
-            int32_t startLayer;
-            int32_t layersCount;
+            DepthPeelingType type;
+            int32_t          startLayer;
+            int32_t          layersCount;
+            bool             earlyExit;
         } depthPeeling;
 
         struct
@@ -109,9 +124,24 @@ private:
             int32_t             bucketsFragmentsMaxCount;
             int32_t             listsFragmentBufferScale;
             int32_t             listsSortedFragmentMaxCount;
+            int32_t             kBufferLayersCount;
         } buffer;
     };
 
+    // Per-frame numbers to compare the algorithms, read back once the frame
+    // that produced them has completed.
+    struct Statistics
+    {
+        double   transparencyGpuTimeMs;
+        uint32_t geometryPassCount;
+        uint64_t algorithmMemorySize;
+
+        // Buffer algorithms with a fragment pool, see BUFFER_STATS_*
+        bool     bufferStatsValid;
+        uint32_t bufferFragmentCount;
+        uint32_t bufferOverflowCount;
+    };
+
     std::vector<const char*> mSupportedAlgorithmNames;
     std::vector<Algorithm>   mSupportedAlgorithmIds;
 
@@ -124,6 +154,7 @@ private:
     void SetupBuffer();
     void SetupBufferBuckets();
     void SetupBufferLinkedLists();
+    void SetupBufferKBuffer();
 
     void FillSupportedAlgorithmData();
     void ParseCommandLineOptions();
@@ -134,20 +165,36 @@ private:
     void Update();
     void UpdateGUI();
 
+    void BuildFrameGraph(grfx::RenderPassPtr renderPass);
+    void AddTransparencyPasses(ppx::FrameGraphResource opaqueDepth, ppx::FrameGraphResource transparency);
+    void AddWeightedAverageGatherPass(ppx::FrameGraphResource opaqueDepth);
+
     void RecordOpaque();
-    void RecordTransparency();
     void RecordComposite(grfx::RenderPassPtr renderPass);
 
     void RecordUnsortedOver();
     void RecordWeightedSum();
+    void RecordWeightedAverageGather();
     void RecordWeightedAverage();
     void RecordDepthPeeling();
+    void RecordDepthPeelingFrontToBack();
+    void RecordDepthPeelingDual();
     void RecordBuffer();
     void RecordBufferBuckets();
     void RecordBufferLinkedLists();
+    void RecordBufferKBuffer();
+    void RecordBufferStatsCopy(grfx::Buffer* pStatsBuffer);
+
+    uint32_t GetDepthPeelingPassCount() const;
+    void     ReadDepthPeelingQueries();
+
+    uint32_t GetGeometryPassCount() const;
+    uint64_t GetAlgorithmMemorySize() const;
+    void     ReadStatistics();
 
 private:
     GuiParameters mGuiParameters = {};
+    Statistics    mStatistics    = {};
 
     float mPreviousElapsedSeconds;
     float mMeshAnimationSeconds;
@@ -160,6 +207,8 @@ private:
     grfx::CommandBufferPtr  mCommandBuffer;
     grfx::DescriptorPoolPtr mDescriptorPool;
 
+    ppx::FrameGraph mFrameGraph;
+
     grfx::SamplerPtr mNearestSampler;
 
     grfx::MeshPtr mBackgroundMesh;
@@ -167,6 +216,15 @@ private:
 
     grfx::BufferPtr mShaderGlobalsBuffer;
 
+    grfx::QueryPtr mTransparencyStartQuery;
+    grfx::QueryPtr mTransparencyEndQuery;
+    bool           mTransparencyTimestampsWritten = false;
+
+    ppx::metrics::MetricID mTransparencyGpuTimeMetric = ppx::metrics::kInvalidMetricID;
+    ppx::metrics::MetricID mGeometryPassCountMetric   = ppx::metrics::kInvalidMetricID;
+    ppx::metrics::MetricID mBufferFragmentCountMetric = ppx::metrics::kInvalidMetricID;
+    ppx::metrics::MetricID mBufferOverflowCountMetric = ppx::metrics::kInvalidMetricID;
+
     grfx::DrawPassPtr            mOpaquePass;
     grfx::DescriptorSetLayoutPtr mOpaqueDescriptorSetLayout;
     grfx::DescriptorSetPtr       mOpaqueDescriptorSet;
@@ -203,8 +261,11 @@ private:
 
     struct
     {
-        grfx::TexturePtr colorTexture;
-        grfx::TexturePtr extraTexture;
+        // Transient, owned by the frame graph
+        ppx::FrameGraphResource colorResource;
+        ppx::FrameGraphResource extraResource;
+        grfx::Texture*          combineColorTexture = nullptr;
+        grfx::Texture*          combineExtraTexture = nullptr;
 
         grfx::DescriptorSetLayoutPtr gatherDescriptorSetLayout;
         grfx::DescriptorSetPtr       gatherDescriptorSet;
@@ -216,7 +277,6 @@ private:
 
         struct
         {
-            grfx::DrawPassPtr         gatherPass;
             grfx::GraphicsPipelinePtr gatherPipeline;
 
             grfx::GraphicsPipelinePtr combinePipeline;
@@ -224,7 +284,6 @@ private:
 
         struct
         {
-            grfx::DrawPassPtr         gatherPass;
             grfx::GraphicsPipelinePtr gatherPipeline;
 
             grfx::GraphicsPipelinePtr combinePipeline;
@@ -243,10 +302,36 @@ private:
         grfx::GraphicsPipelinePtr    layerPipeline_OtherLayers;
         grfx::GraphicsPipelinePtr    layerPipeline_FirstLayer;
 
+        // Dual peeling, pass i extracts front layer i and back layer
+        // DEPTH_PEELING_LAYERS_COUNT - 1 - i
+        grfx::TexturePtr  dualDepthTextures[DEPTH_PEELING_DEPTH_TEXTURES_COUNT];
+        grfx::DrawPassPtr dualInitPass;
+        grfx::DrawPassPtr dualPeelPasses[DEPTH_PEELING_DUAL_PASSES_COUNT];
+
+        grfx::DescriptorSetLayoutPtr dualDescriptorSetLayout;
+        grfx::DescriptorSetPtr       dualDescriptorSets[DEPTH_PEELING_DEPTH_TEXTURES_COUNT];
+        grfx::PipelineInterfacePtr   dualPipelineInterface;
+        grfx::GraphicsPipelinePtr    dualInitPipeline;
+        grfx::GraphicsPipelinePtr    dualPeelPipeline;
+
         grfx::DescriptorSetLayoutPtr combineDescriptorSetLayout;
         grfx::DescriptorSetPtr       combineDescriptorSet;
         grfx::PipelineInterfacePtr   combinePipelineInterface;
         grfx::GraphicsPipelinePtr    combinePipeline;
+
+        // Settings of the recorded frame, taken with the shader globals
+        DepthPeelingType type          = DEPTH_PEELING_TYPE_FRONT_TO_BACK;
+        bool             earlyExit     = false;
+        uint32_t         peelPassCount = DEPTH_PEELING_LAYERS_COUNT;
+
+        // Early exit: one occlusion query per peel pass. The passes of a frame
+        // are chosen from the samples written by the previous one.
+        grfx::QueryPtr   occlusionQuery;
+        uint32_t         queriedPassCount  = 0;
+        DepthPeelingType queriedType       = DEPTH_PEELING_TYPE_FRONT_TO_BACK;
+        bool             occupiedValid     = false;
+        uint32_t         occupiedPassCount = 0;
+        DepthPeelingType occupiedType      = DEPTH_PEELING_TYPE_FRONT_TO_BACK;
     } mDepthPeeling;
 
     struct
@@ -291,5 +376,38 @@ private:
 
             bool linkedListHeadTextureNeedClear;
         } lists;
+
+        struct
+        {
+            grfx::TexturePtr  depthTexture;
+            grfx::TexturePtr  colorTexture;
+            grfx::TexturePtr  tailTexture;
+            grfx::BufferPtr   statsBuffer;
+            grfx::DrawPassPtr clearPass;
+            grfx::DrawPassPtr depthPass;
+            grfx::DrawPassPtr gatherPass;
+
+            grfx::DescriptorSetLayoutPtr depthDescriptorSetLayout;
+            grfx::DescriptorSetPtr       depthDescriptorSet;
+            grfx::PipelineInterfacePtr   depthPipelineInterface;
+            grfx::GraphicsPipelinePtr    depthPipeline;
+
+            grfx::DescriptorSetLayoutPtr gatherDescriptorSetLayout;
+            grfx::DescriptorSetPtr       gatherDescriptorSet;
+            grfx::PipelineInterfacePtr   gatherPipelineInterface;
+            grfx::GraphicsPipelinePtr    gatherPipeline;
+
+            grfx::DescriptorSetLayoutPtr combineDescriptorSetLayout;
+            grfx::DescriptorSetPtr       combineDescriptorSet;
+            grfx::PipelineInterfacePtr   combinePipelineInterface;
+            grfx::GraphicsPipelinePtr    combinePipeline;
+
+            bool texturesNeedClear;
+        } kbuffer;
+
+        // BUFFER_STATS_COUNT counters copied out of the lists' atomic counter
+        // or the k-buffer stats buffer after their gather pass
+        grfx::BufferPtr statsReadbackBuffer;
+        bool            statsCopied;
     } mBuffer;
 };
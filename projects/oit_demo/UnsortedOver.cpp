@@ -86,12 +86,7 @@ void OITDemoApp::SetupUnsortedOver()
 
 void OITDemoApp::RecordUnsortedOver()
 {
-    mCommandBuffer->TransitionImageLayout(
-        mTransparencyPass,
-        grfx::RESOURCE_STATE_SHADER_RESOURCE,
-        grfx::RESOURCE_STATE_RENDER_TARGET,
-        grfx::RESOURCE_STATE_SHADER_RESOURCE,
-        grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
+    mCommandBuffer->RequireResourceState(mTransparencyPass, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
     mCommandBuffer->BeginRenderPass(mTransparencyPass, grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_RENDER_TARGETS);
 
     mCommandBuffer->SetScissors(mTransparencyPass->GetScissor());
@@ -130,10 +125,4 @@ void OITDemoApp::RecordUnsortedOver()
     }
 
     mCommandBuffer->EndRenderPass();
-    mCommandBuffer->TransitionImageLayout(
-        mTransparencyPass,
-        grfx::RESOURCE_STATE_RENDER_TARGET,
-        grfx::RESOURCE_STATE_SHADER_RESOURCE,
-        grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE,
-        grfx::RESOURCE_STATE_SHADER_RESOURCE);
 }
@@ -14,60 +14,18 @@
 
 #include "OITDemoApplication.h"
 
+static constexpr grfx::Format WEIGHTED_AVERAGE_COLOR_FORMAT = grfx::FORMAT_R16G16B16A16_FLOAT;
+static constexpr grfx::Format WEIGHTED_AVERAGE_EXTRA_FORMAT = grfx::FORMAT_R16_FLOAT;
+
 void OITDemoApp::SetupWeightedAverage()
 {
-    ////////////////////////////////////////
-    // Common
-    ////////////////////////////////////////
-
-    // Texture
-    {
-        grfx::TextureCreateInfo createInfo         = {};
-        createInfo.imageType                       = grfx::IMAGE_TYPE_2D;
-        createInfo.width                           = mTransparencyTexture->GetWidth();
-        createInfo.height                          = mTransparencyTexture->GetHeight();
-        createInfo.depth                           = 1;
-        createInfo.sampleCount                     = grfx::SAMPLE_COUNT_1;
-        createInfo.mipLevelCount                   = 1;
-        createInfo.arrayLayerCount                 = 1;
-        createInfo.usageFlags.bits.colorAttachment = true;
-        createInfo.usageFlags.bits.sampled         = true;
-        createInfo.memoryUsage                     = grfx::MEMORY_USAGE_GPU_ONLY;
-        createInfo.initialState                    = grfx::RESOURCE_STATE_SHADER_RESOURCE;
-
-        createInfo.imageFormat = grfx::FORMAT_R16G16B16A16_FLOAT;
-        PPX_CHECKED_CALL(GetDevice()->CreateTexture(&createInfo, &mWeightedAverage.colorTexture));
-
-        createInfo.imageFormat = grfx::FORMAT_R16_FLOAT;
-        PPX_CHECKED_CALL(GetDevice()->CreateTexture(&createInfo, &mWeightedAverage.extraTexture));
-    }
+    // Color and extra textures are transient frame graph textures, see
+    // AddWeightedAverageGatherPass.
 
     ////////////////////////////////////////
     // Gather
     ////////////////////////////////////////
 
-    // Pass
-    {
-        grfx::DrawPassCreateInfo2 createInfo  = {};
-        createInfo.width                      = mWeightedAverage.colorTexture->GetWidth();
-        createInfo.height                     = mWeightedAverage.colorTexture->GetHeight();
-        createInfo.renderTargetCount          = 2;
-        createInfo.pRenderTargetImages[0]     = mWeightedAverage.colorTexture->GetImage();
-        createInfo.pRenderTargetImages[1]     = mWeightedAverage.extraTexture->GetImage();
-        createInfo.pDepthStencilImage         = mOpaquePass->GetDepthStencilTexture()->GetImage();
-        createInfo.depthStencilState          = grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE;
-        createInfo.renderTargetClearValues[0] = {0, 0, 0, 0};
-        createInfo.depthStencilClearValue     = {1.0f, 0xFF};
-
-        // Count type
-        createInfo.renderTargetClearValues[1] = {0, 0, 0, 0};
-        PPX_CHECKED_CALL(GetDevice()->CreateDrawPass(&createInfo, &mWeightedAverage.count.gatherPass));
-
-        // Coverage type
-        createInfo.renderTargetClearValues[1] = {1, 1, 1, 1};
-        PPX_CHECKED_CALL(GetDevice()->CreateDrawPass(&createInfo, &mWeightedAverage.coverage.gatherPass));
-    }
-
     // Descriptor
     {
         grfx::DescriptorSetLayoutCreateInfo layoutCreateInfo = {};
@@ -124,8 +82,8 @@ void OITDemoApp::SetupWeightedAverage()
         gpCreateInfo.colorBlendState.blendAttachments[1].colorWriteMask      = grfx::ColorComponentFlags::RGBA();
 
         gpCreateInfo.outputState.renderTargetCount      = 2;
-        gpCreateInfo.outputState.renderTargetFormats[0] = mWeightedAverage.colorTexture->GetImageFormat();
-        gpCreateInfo.outputState.renderTargetFormats[1] = mWeightedAverage.extraTexture->GetImageFormat();
+        gpCreateInfo.outputState.renderTargetFormats[0] = WEIGHTED_AVERAGE_COLOR_FORMAT;
+        gpCreateInfo.outputState.renderTargetFormats[1] = WEIGHTED_AVERAGE_EXTRA_FORMAT;
         gpCreateInfo.outputState.depthStencilFormat     = mOpaquePass->GetDepthStencilTexture()->GetImageFormat();
         gpCreateInfo.pPipelineInterface                 = mWeightedAverage.gatherPipelineInterface;
 
@@ -166,23 +124,13 @@ void OITDemoApp::SetupWeightedAverage()
 
         PPX_CHECKED_CALL(GetDevice()->AllocateDescriptorSet(mDescriptorPool, mWeightedAverage.combineDescriptorSetLayout, &mWeightedAverage.combineDescriptorSet));
 
-        std::array<grfx::WriteDescriptor, 3> writes = {};
-
-        writes[0].binding  = CUSTOM_SAMPLER_0_REGISTER;
-        writes[0].type     = grfx::DESCRIPTOR_TYPE_SAMPLER;
-        writes[0].pSampler = mNearestSampler;
-
-        writes[1].binding    = CUSTOM_TEXTURE_0_REGISTER;
-        writes[1].arrayIndex = 0;
-        writes[1].type       = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-        writes[1].pImageView = mWeightedAverage.colorTexture->GetSampledImageView();
-
-        writes[2].binding    = CUSTOM_TEXTURE_1_REGISTER;
-        writes[2].arrayIndex = 0;
-        writes[2].type       = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-        writes[2].pImageView = mWeightedAverage.extraTexture->GetSampledImageView();
-
-        PPX_CHECKED_CALL(mWeightedAverage.combineDescriptorSet->UpdateDescriptors(static_cast<uint32_t>(writes.size()), writes.data()));
+        // Textures are written by RecordWeightedAverage once the frame graph
+        // has picked them
+        grfx::WriteDescriptor write = {};
+        write.binding               = CUSTOM_SAMPLER_0_REGISTER;
+        write.type                  = grfx::DESCRIPTOR_TYPE_SAMPLER;
+        write.pSampler              = mNearestSampler;
+        PPX_CHECKED_CALL(mWeightedAverage.combineDescriptorSet->UpdateDescriptors(1, &write));
     }
 
     // Pipeline
@@ -228,21 +176,63 @@ void OITDemoApp::SetupWeightedAverage()
     }
 }
 
-void OITDemoApp::RecordWeightedAverage()
+void OITDemoApp::AddWeightedAverageGatherPass(ppx::FrameGraphResource opaqueDepth)
+{
+    ppx::FrameGraphTextureDesc desc = {};
+    desc.width                      = mTransparencyTexture->GetWidth();
+    desc.height                     = mTransparencyTexture->GetHeight();
+
+    desc.format                    = WEIGHTED_AVERAGE_COLOR_FORMAT;
+    mWeightedAverage.colorResource = mFrameGraph.CreateTexture("WeightedAverageColor", desc);
+
+    desc.format                    = WEIGHTED_AVERAGE_EXTRA_FORMAT;
+    mWeightedAverage.extraResource = mFrameGraph.CreateTexture("WeightedAverageExtra", desc);
+
+    // Coverage type accumulates the extra factor multiplicatively
+    const bool                         coverage   = (mGuiParameters.weightedAverage.type == WEIGHTED_AVERAGE_TYPE_EXACT_COVERAGE);
+    const grfx::RenderTargetClearValue extraClear = coverage ? grfx::RenderTargetClearValue{1, 1, 1, 1} : grfx::RenderTargetClearValue{0, 0, 0, 0};
+
+    // Gather pass: compute the formula factors for each pixels
+    mFrameGraph.AddPass("WeightedAverageGather", ppx::FRAME_GRAPH_PASS_TYPE_GRAPHICS, [this](ppx::FrameGraphPassContext&) { RecordWeightedAverageGather(); })
+        .SetRenderTarget(0, mWeightedAverage.colorResource, ppx::FRAME_GRAPH_LOAD_OP_CLEAR, {0, 0, 0, 0})
+        .SetRenderTarget(1, mWeightedAverage.extraResource, ppx::FRAME_GRAPH_LOAD_OP_CLEAR, extraClear)
+        .SetDepthStencil(opaqueDepth, ppx::FRAME_GRAPH_LOAD_OP_LOAD);
+}
+
+void OITDemoApp::RecordWeightedAverageGather()
 {
-    grfx::DrawPassPtr         gatherPass;
     grfx::GraphicsPipelinePtr gatherPipeline;
+    switch (mGuiParameters.weightedAverage.type) {
+        case WEIGHTED_AVERAGE_TYPE_FRAGMENT_COUNT: {
+            gatherPipeline = mWeightedAverage.count.gatherPipeline;
+            break;
+        }
+        case WEIGHTED_AVERAGE_TYPE_EXACT_COVERAGE: {
+            gatherPipeline = mWeightedAverage.coverage.gatherPipeline;
+            break;
+        }
+        default: {
+            PPX_ASSERT_MSG(false, "unknown weighted average type");
+            break;
+        }
+    }
+
+    mCommandBuffer->BindGraphicsDescriptorSets(mWeightedAverage.gatherPipelineInterface, 1, &mWeightedAverage.gatherDescriptorSet);
+    mCommandBuffer->BindGraphicsPipeline(gatherPipeline);
+    mCommandBuffer->BindIndexBuffer(GetTransparentMesh());
+    mCommandBuffer->BindVertexBuffers(GetTransparentMesh());
+    mCommandBuffer->DrawIndexed(GetTransparentMesh()->GetIndexCount());
+}
+
+void OITDemoApp::RecordWeightedAverage()
+{
     grfx::GraphicsPipelinePtr combinePipeline;
     switch (mGuiParameters.weightedAverage.type) {
         case WEIGHTED_AVERAGE_TYPE_FRAGMENT_COUNT: {
-            gatherPass      = mWeightedAverage.count.gatherPass;
-            gatherPipeline  = mWeightedAverage.count.gatherPipeline;
             combinePipeline = mWeightedAverage.count.combinePipeline;
             break;
         }
         case WEIGHTED_AVERAGE_TYPE_EXACT_COVERAGE: {
-            gatherPass      = mWeightedAverage.coverage.gatherPass;
-            gatherPipeline  = mWeightedAverage.coverage.gatherPipeline;
             combinePipeline = mWeightedAverage.coverage.combinePipeline;
             break;
         }
@@ -252,57 +242,39 @@ void OITDemoApp::RecordWeightedAverage()
         }
     }
 
-    // Gather pass: compute the formula factors for each pixels
-    {
-        mCommandBuffer->TransitionImageLayout(
-            gatherPass,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_RENDER_TARGET,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
-        mCommandBuffer->BeginRenderPass(gatherPass, grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_RENDER_TARGETS);
-
-        mCommandBuffer->SetScissors(gatherPass->GetScissor());
-        mCommandBuffer->SetViewports(gatherPass->GetViewport());
-
-        mCommandBuffer->BindGraphicsDescriptorSets(mWeightedAverage.gatherPipelineInterface, 1, &mWeightedAverage.gatherDescriptorSet);
-        mCommandBuffer->BindGraphicsPipeline(gatherPipeline);
-        mCommandBuffer->BindIndexBuffer(GetTransparentMesh());
-        mCommandBuffer->BindVertexBuffers(GetTransparentMesh());
-        mCommandBuffer->DrawIndexed(GetTransparentMesh()->GetIndexCount());
-
-        mCommandBuffer->EndRenderPass();
-        mCommandBuffer->TransitionImageLayout(
-            gatherPass,
-            grfx::RESOURCE_STATE_RENDER_TARGET,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    // The frame graph may hand out different textures after a recompile,
+    // the previous frame has completed so the set can be rewritten
+    grfx::Texture* colorTexture = mFrameGraph.GetTexture(mWeightedAverage.colorResource);
+    grfx::Texture* extraTexture = mFrameGraph.GetTexture(mWeightedAverage.extraResource);
+    if ((colorTexture != mWeightedAverage.combineColorTexture) || (extraTexture != mWeightedAverage.combineExtraTexture)) {
+        std::array<grfx::WriteDescriptor, 2> writes = {};
+
+        writes[0].binding    = CUSTOM_TEXTURE_0_REGISTER;
+        writes[0].arrayIndex = 0;
+        writes[0].type       = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        writes[0].pImageView = colorTexture->GetSampledImageView();
+
+        writes[1].binding    = CUSTOM_TEXTURE_1_REGISTER;
+        writes[1].arrayIndex = 0;
+        writes[1].type       = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        writes[1].pImageView = extraTexture->GetSampledImageView();
+
+        PPX_CHECKED_CALL(mWeightedAverage.combineDescriptorSet->UpdateDescriptors(static_cast<uint32_t>(writes.size()), writes.data()));
+
+        mWeightedAverage.combineColorTexture = colorTexture;
+        mWeightedAverage.combineExtraTexture = extraTexture;
     }
 
     // Transparency pass: combine the results for each pixels
-    {
-        mCommandBuffer->TransitionImageLayout(
-            mTransparencyPass,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_RENDER_TARGET,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
-        mCommandBuffer->BeginRenderPass(mTransparencyPass, grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_RENDER_TARGETS);
-
-        mCommandBuffer->SetScissors(mTransparencyPass->GetScissor());
-        mCommandBuffer->SetViewports(mTransparencyPass->GetViewport());
-
-        mCommandBuffer->BindGraphicsDescriptorSets(mWeightedAverage.combinePipelineInterface, 1, &mWeightedAverage.combineDescriptorSet);
-        mCommandBuffer->BindGraphicsPipeline(combinePipeline);
-        mCommandBuffer->Draw(3);
-
-        mCommandBuffer->EndRenderPass();
-        mCommandBuffer->TransitionImageLayout(
-            mTransparencyPass,
-            grfx::RESOURCE_STATE_RENDER_TARGET,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE,
-            grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE,
-            grfx::RESOURCE_STATE_SHADER_RESOURCE);
-    }
+    mCommandBuffer->RequireResourceState(mTransparencyPass, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
+    mCommandBuffer->BeginRenderPass(mTransparencyPass, grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_RENDER_TARGETS);
+
+    mCommandBuffer->SetScissors(mTransparencyPass->GetScissor());
+    mCommandBuffer->SetViewports(mTransparencyPass->GetViewport());
+
+    mCommandBuffer->BindGraphicsDescriptorSets(mWeightedAverage.combinePipelineInterface, 1, &mWeightedAverage.combineDescriptorSet);
+    mCommandBuffer->BindGraphicsPipeline(combinePipeline);
+    mCommandBuffer->Draw(3);
+
+    mCommandBuffer->EndRenderPass();
 }
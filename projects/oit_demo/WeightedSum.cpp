@@ -79,12 +79,7 @@ void OITDemoApp::SetupWeightedSum()
 
 void OITDemoApp::RecordWeightedSum()
 {
-    mCommandBuffer->TransitionImageLayout(
-        mTransparencyPass,
-        grfx::RESOURCE_STATE_SHADER_RESOURCE,
-        grfx::RESOURCE_STATE_RENDER_TARGET,
-        grfx::RESOURCE_STATE_SHADER_RESOURCE,
-        grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
+    mCommandBuffer->RequireResourceState(mTransparencyPass, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE);
     mCommandBuffer->BeginRenderPass(mTransparencyPass, grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_RENDER_TARGETS);
 
     mCommandBuffer->SetScissors(mTransparencyPass->GetScissor());
@@ -97,10 +92,4 @@ void OITDemoApp::RecordWeightedSum()
     mCommandBuffer->DrawIndexed(GetTransparentMesh()->GetIndexCount());
 
     mCommandBuffer->EndRenderPass();
-    mCommandBuffer->TransitionImageLayout(
-        mTransparencyPass,
-        grfx::RESOURCE_STATE_RENDER_TARGET,
-        grfx::RESOURCE_STATE_SHADER_RESOURCE,
-        grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE,
-        grfx::RESOURCE_STATE_SHADER_RESOURCE);
 }
@@ -14,7 +14,6 @@
 
 #include "ppx/application.h"
 #include "ppx/fs.h"
-#include "ppx/ppm_export.h"
 #include "ppx/profiler.h"
 
 #include <chrono>
@@ -601,6 +600,20 @@ void Application::ShutdownGrfx()
     if (mInstance) {
         DestroySwapchains();
 
+        if (mMipGenerator) {
+            if (mDevice) {
+                mDevice->SetDefaultMipGenerator(nullptr);
+            }
+            mMipGenerator->Shutdown();
+            mMipGenerator.reset();
+        }
+
+        // Writes the captures that are still pending
+        if (mFrameCapture) {
+            mFrameCapture->Shutdown();
+            mFrameCapture.reset();
+        }
+
         if (mDevice) {
             mInstance->DestroyDevice(mDevice);
             mDevice.Reset();
@@ -682,6 +695,13 @@ void Application::DispatchConfig()
 void Application::DispatchSetup()
 {
     SetupMetrics();
+
+    // Textures created without an explicit generator build their mips with
+    // the application's generator
+    if (mDevice) {
+        mDevice->SetDefaultMipGenerator(GetMipGenerator());
+    }
+
     Setup();
 }
 
@@ -813,6 +833,38 @@ void Application::InitStandardKnobs()
         "Add a path before the default assets folder in the search list.");
     mStandardOpts.pAssetsPaths->SetFlagParameters("<path>");
 
+    mStandardOpts.pCaptureFormat =
+        mKnobManager.CreateKnob<KnobFlag<std::string>>("capture-format", "ppm");
+    mStandardOpts.pCaptureFormat->SetFlagDescription(
+        "File format of captured frames and screenshots: ppm, png (8-bit RGBA "
+        "or BGRA swapchains only) or raw (tightly packed texels, no header). "
+        "Default: ppm.");
+    mStandardOpts.pCaptureFormat->SetFlagParameters("<ppm|png|raw>");
+    mStandardOpts.pCaptureFormat->SetValidator([](std::string value) {
+        FrameCaptureEncoding encoding;
+        return Success(ParseFrameCaptureEncoding(value, &encoding));
+    });
+
+    mStandardOpts.pCaptureFrames =
+        mKnobManager.CreateKnob<KnobFlag<std::string>>("capture-frames", "");
+    mStandardOpts.pCaptureFrames->SetFlagDescription(
+        "Capture <count> frames starting at frame number <start>, a count of 0 "
+        "captures every frame from <start> on. Frames are read back and written "
+        "asynchronously as \"capture_frame<N>\" in the directory set with "
+        "`--capture-path`. See also `--capture-format`.");
+    mStandardOpts.pCaptureFrames->SetFlagParameters("<start>:<count>");
+    mStandardOpts.pCaptureFrames->SetValidator([](std::string value) {
+        uint64_t start, count;
+        return value.empty() || Success(ParseFrameRange(value, &start, &count));
+    });
+
+    mStandardOpts.pCapturePath =
+        mKnobManager.CreateKnob<KnobFlag<std::string>>("capture-path", "");
+    mStandardOpts.pCapturePath->SetFlagDescription(
+        "Directory for the frames captured with `--capture-frames`. Default: "
+        "the current working directory.");
+    mStandardOpts.pCapturePath->SetFlagParameters("<path>");
+
     mStandardOpts.pConfigJsonPaths = mKnobManager.CreateKnob<KnobFlag<std::vector<std::string>>>(mCommandLineParser.GetJsonConfigFlagName(), defaultEmptyList);
     mStandardOpts.pConfigJsonPaths->SetFlagDescription(
         "Additional commandline flags specified in a JSON file. Values specified in JSON files are "
@@ -896,13 +948,13 @@ void Application::InitStandardKnobs()
     mStandardOpts.pScreenshotFrameNumber =
         mKnobManager.CreateKnob<KnobFlag<int>>("screenshot-frame-number", -1, -1, INT_MAX);
     mStandardOpts.pScreenshotFrameNumber->SetFlagDescription(
-        "Take a screenshot of frame number N and save it in PPM format. See also "
-        "`--screenshot-path`.");
+        "Take a screenshot of frame number N and save it in the format set with "
+        "`--capture-format` (PPM by default). See also `--screenshot-path`.");
 
     mStandardOpts.pScreenshotPath =
         mKnobManager.CreateKnob<KnobFlag<std::string>>("screenshot-path", "");
     mStandardOpts.pScreenshotPath->SetFlagDescription(
-        "Save the screenshot to this path. Default: \"screenshot_frame<N>.ppm\" "
+        "Save the screenshot to this path. Default: \"screenshot_frame<N>.<format>\" "
         "in the current working directory.");
     mStandardOpts.pScreenshotPath->SetFlagParameters("<path>");
 
@@ -937,71 +989,55 @@ void Application::InitStandardKnobs()
 
 void Application::TakeScreenshot()
 {
-    auto swapchainImg = GetSwapchain()->GetColorImage(GetSwapchain()->GetCurrentImageIndex());
-    auto queue        = mDevice->GetGraphicsQueue();
-
-    const grfx::FormatDesc* formatDesc = grfx::GetFormatDescription(swapchainImg->GetFormat());
-    const uint32_t          width      = swapchainImg->GetWidth();
-    const uint32_t          height     = swapchainImg->GetHeight();
-
-    // Create a buffer that will hold the swapchain image's texels.
-    // Increase its size by a factor of 2 to ensure that a larger-than-needed
-    // row pitch will not overflow the buffer.
-    uint64_t bufferSize = 2ull * formatDesc->bytesPerTexel * width * height;
-
-    grfx::BufferPtr        screenshotBuf = nullptr;
-    grfx::BufferCreateInfo bufferCi      = {};
-    bufferCi.size                        = bufferSize;
-    bufferCi.initialState                = grfx::RESOURCE_STATE_COPY_DST;
-    bufferCi.usageFlags.bits.transferDst = 1;
-    bufferCi.memoryUsage                 = grfx::MEMORY_USAGE_GPU_TO_CPU;
-    PPX_CHECKED_CALL(mDevice->CreateBuffer(&bufferCi, &screenshotBuf));
-
-    // We wait for idle so that we can avoid tracking swapchain fences.
-    // It's not ideal, but we won't be taking screenshots in
-    // performance-critical scenarios.
-    PPX_CHECKED_CALL(queue->WaitIdle());
-
-    // Copy the swapchain image into the buffer.
-    grfx::CommandBufferPtr cmdBuf;
-    PPX_CHECKED_CALL(queue->CreateCommandBuffer(&cmdBuf, 0, 0));
-
-    grfx::ImageToBufferOutputPitch outPitch;
-    cmdBuf->Begin();
-    {
-        cmdBuf->TransitionImageLayout(swapchainImg, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_PRESENT, grfx::RESOURCE_STATE_COPY_SRC);
-
-        grfx::ImageToBufferCopyInfo bufCopyInfo = {};
-        bufCopyInfo.extent                      = {width, height, 0};
-        outPitch                                = cmdBuf->CopyImageToBuffer(&bufCopyInfo, swapchainImg, screenshotBuf);
-
-        cmdBuf->TransitionImageLayout(swapchainImg, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_COPY_SRC, grfx::RESOURCE_STATE_PRESENT);
+    std::string filepath = mStandardOpts.pScreenshotPath->GetValue();
+    if (filepath == "") {
+        filepath = "screenshot_frame" + std::to_string(mFrameCount) + GetFrameCaptureExtension(mCaptureEncoding);
     }
-    cmdBuf->End();
+    CaptureSwapchainImage(filepath);
+}
 
-    grfx::SubmitInfo submitInfo   = {};
-    submitInfo.commandBufferCount = 1;
-    submitInfo.ppCommandBuffers   = &cmdBuf;
-    queue->Submit(&submitInfo);
+void Application::CaptureSwapchainImage(const std::filesystem::path& path)
+{
+    if (!mFrameCapture) {
+        FrameCaptureCreateInfo createInfo = {};
+        createInfo.encoding               = mCaptureEncoding;
+        // One capture per frame in flight, plus one being written
+        createInfo.ringSize = mSettings.grfx.numFramesInFlight + 1;
 
-    // Wait for the copy to be finished.
-    queue->WaitIdle();
+        auto   frameCapture = std::make_unique<FrameCapture>();
+        Result ppxres       = frameCapture->Initialize(mDevice, createInfo);
+        if (Failed(ppxres)) {
+            PPX_LOG_ERROR("frame capture unavailable: " << ToString(ppxres));
+            return;
+        }
+        mFrameCapture = std::move(frameCapture);
+    }
 
-    // Export to PPM.
-    unsigned char* texels = nullptr;
-    screenshotBuf->MapMemory(0, (void**)&texels);
+    // The copy is queued behind the frame that was just submitted, the
+    // texels are read and written once it has completed.
+    auto   swapchainImg = GetSwapchain()->GetColorImage(GetSwapchain()->GetCurrentImageIndex());
+    Result ppxres       = mFrameCapture->Capture(mDevice->GetGraphicsQueue(), swapchainImg, grfx::RESOURCE_STATE_PRESENT, path);
+    if (Failed(ppxres)) {
+        PPX_LOG_ERROR("failed to capture frame " << mFrameCount << ": " << ToString(ppxres));
+    }
+}
 
-    std::string filepath = mStandardOpts.pScreenshotPath->GetValue();
-    if (filepath == "") {
-        filepath = "screenshot_frame" + std::to_string(mFrameCount) + ".ppm";
+void Application::UpdateFrameCapture()
+{
+    // Take screenshot if this is the requested frame.
+    if (mFrameCount == static_cast<uint64_t>(mStandardOpts.pScreenshotFrameNumber->GetValue())) {
+        TakeScreenshot();
     }
-    PPX_CHECKED_CALL(ExportToPPM(filepath, swapchainImg->GetFormat(), texels, width, height, outPitch.rowPitch));
 
-    screenshotBuf->UnmapMemory();
+    if (mCaptureFrames && (mFrameCount >= mCaptureFrameStart) && ((mCaptureFrameCount == 0) || (mFrameCount - mCaptureFrameStart < mCaptureFrameCount))) {
+        std::filesystem::path path = mStandardOpts.pCapturePath->GetValue();
+        path /= "capture_frame" + std::to_string(mFrameCount) + GetFrameCaptureExtension(mCaptureEncoding);
+        CaptureSwapchainImage(path);
+    }
 
-    // Clean up temporary resources.
-    mDevice->DestroyBuffer(screenshotBuf);
-    queue->DestroyCommandBuffer(cmdBuf);
+    if (mFrameCapture) {
+        mFrameCapture->Poll();
+    }
 }
 
 void Application::MoveCallback(int32_t x, int32_t y)
@@ -1227,6 +1263,11 @@ int Application::Run(int argc, char** argv)
         mRunTimeSeconds = std::numeric_limits<float>::max();
     }
 
+    // Both were validated when the knobs were set
+    ParseFrameCaptureEncoding(mStandardOpts.pCaptureFormat->GetValue(), &mCaptureEncoding);
+    mCaptureFrames = !mStandardOpts.pCaptureFrames->GetValue().empty() &&
+                     Success(ParseFrameRange(mStandardOpts.pCaptureFrames->GetValue(), &mCaptureFrameStart, &mCaptureFrameCount));
+
     // Disable ImGui in headless or deterministic mode.
     // ImGUI is not non-deterministic, but the visible informations (stats, timers) are.
     if ((mSettings.headless || mStandardOpts.pDeterministic->GetValue()) && mSettings.enableImGui) {
@@ -1434,10 +1475,8 @@ int Application::Run(int argc, char** argv)
 #endif
         }
 
-        // Take screenshot if this is the requested frame.
-        if (mFrameCount == static_cast<uint64_t>(mStandardOpts.pScreenshotFrameNumber->GetValue())) {
-            TakeScreenshot();
-        }
+        // Screenshots and frame captures, written asynchronously.
+        UpdateFrameCapture();
 
         // Frame end general metrics data, used for recorded metrics, display, screenshots, and pacing.
         double nowMs       = mTimer.MillisSinceStart();
@@ -1630,6 +1669,31 @@ Result Application::CreateShader(const std::filesystem::path& baseDir, const std
     return ppx::SUCCESS;
 }
 
+MipGenerator* Application::GetMipGenerator()
+{
+    if (mMipGenerator || mMipGeneratorFailed || !mDevice) {
+        return mMipGenerator.get();
+    }
+
+    // Unlike LoadShader(), a missing shader is not fatal here
+    std::optional<std::vector<char>> bytecode;
+    auto                             suffix = GetShaderPathSuffix(mSettings, "GenerateMips.cs");
+    if (suffix.has_value()) {
+        bytecode = fs::load_file(GetAssetPath(std::filesystem::path("basic/shaders") / suffix.value()));
+    }
+
+    auto   mipGenerator = std::make_unique<MipGenerator>();
+    Result ppxres       = bytecode.has_value() ? mipGenerator->Initialize(mDevice, bytecode.value()) : ppx::ERROR_PATH_DOES_NOT_EXIST;
+    if (Failed(ppxres)) {
+        PPX_LOG_WARN("GPU mip generation unavailable (" << ToString(ppxres) << "), mips will be built on the CPU");
+        mMipGeneratorFailed = true;
+        return nullptr;
+    }
+
+    mMipGenerator = std::move(mipGenerator);
+    return mMipGenerator.get();
+}
+
 grfx::SwapchainPtr Application::GetSwapchain(uint32_t index) const
 {
     PPX_ASSERT_MSG(index < mSwapchains.size(), "Invalid Swapchain Index!");
@@ -0,0 +1,389 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ppx/async_compute.h"
+#include "ppx/application.h"
+#include "ppx/grfx/grfx_device.h"
+
+#include <algorithm>
+
+namespace ppx {
+
+namespace {
+
+// Sorts spans and merges the ones that overlap
+std::vector<AsyncComputeSpan> MergeSpans(std::vector<AsyncComputeSpan> spans)
+{
+    std::sort(spans.begin(), spans.end(), [](const AsyncComputeSpan& a, const AsyncComputeSpan& b) {
+        return a.beginMs < b.beginMs;
+    });
+
+    std::vector<AsyncComputeSpan> merged;
+    for (const AsyncComputeSpan& span : spans) {
+        if (span.endMs <= span.beginMs) {
+            continue;
+        }
+        if (!merged.empty() && (span.beginMs <= merged.back().endMs)) {
+            merged.back().endMs = std::max(merged.back().endMs, span.endMs);
+        }
+        else {
+            merged.push_back(span);
+        }
+    }
+    return merged;
+}
+
+double SpanTotal(const std::vector<AsyncComputeSpan>& spans)
+{
+    double total = 0;
+    for (const AsyncComputeSpan& span : spans) {
+        total += span.endMs - span.beginMs;
+    }
+    return total;
+}
+
+} // namespace
+
+Result AsyncComputeScheduler::Initialize(grfx::Device* pDevice, const AsyncComputeSchedulerCreateInfo& createInfo)
+{
+    PPX_ASSERT_NULL_ARG(pDevice);
+    PPX_ASSERT_NULL_ARG(createInfo.pGraphicsQueue);
+    if ((createInfo.frameCount == 0) || (createInfo.maxSpanCount == 0)) {
+        return ppx::ERROR_INVALID_CREATE_ARGUMENT;
+    }
+
+    mDevice               = pDevice;
+    mGraphicsQueue        = createInfo.pGraphicsQueue;
+    mComputeQueue         = createInfo.pComputeQueue;
+    mMaxSpanCount         = createInfo.maxSpanCount;
+    mQueueFamilyTransfers = createInfo.queueFamilyTransfers;
+    mEnabled              = false;
+    mHasStats             = false;
+    mStats                = {};
+
+    mPerFrame.resize(createInfo.frameCount);
+    for (PerFrame& frame : mPerFrame) {
+        for (uint32_t work = 0; work < ASYNC_COMPUTE_WORK_COUNT; ++work) {
+            grfx::QueryCreateInfo queryCreateInfo = {};
+            queryCreateInfo.type                  = grfx::QUERY_TYPE_TIMESTAMP;
+            queryCreateInfo.count                 = 2 * mMaxSpanCount;
+            Result ppxres                         = mDevice->CreateQuery(&queryCreateInfo, &frame.timestamps[work].query);
+            if (Failed(ppxres)) {
+                Shutdown();
+                return ppxres;
+            }
+        }
+
+        frame.semaphores.resize(createInfo.semaphoreCount);
+        for (grfx::SemaphorePtr& semaphore : frame.semaphores) {
+            grfx::SemaphoreCreateInfo semaCreateInfo = {};
+            Result                    ppxres         = mDevice->CreateSemaphore(&semaCreateInfo, &semaphore);
+            if (Failed(ppxres)) {
+                Shutdown();
+                return ppxres;
+            }
+        }
+    }
+
+    return ppx::SUCCESS;
+}
+
+void AsyncComputeScheduler::Shutdown()
+{
+    if (IsNull(mDevice)) {
+        return;
+    }
+
+    for (PerFrame& frame : mPerFrame) {
+        for (Timestamps& timestamps : frame.timestamps) {
+            if (timestamps.query) {
+                mDevice->DestroyQuery(timestamps.query);
+            }
+        }
+        for (grfx::SemaphorePtr& semaphore : frame.semaphores) {
+            if (semaphore) {
+                mDevice->DestroySemaphore(semaphore);
+            }
+        }
+    }
+    mPerFrame.clear();
+
+    mGraphicsQueue = nullptr;
+    mComputeQueue  = nullptr;
+    mDevice        = nullptr;
+}
+
+grfx::Queue* AsyncComputeScheduler::GetQueue(AsyncComputeWork work) const
+{
+    return (work == ASYNC_COMPUTE_WORK_COMPUTE) ? GetComputeQueue() : GetGraphicsQueue();
+}
+
+void AsyncComputeScheduler::BeginFrame(uint32_t frameIndex)
+{
+    PPX_ASSERT_MSG(frameIndex < CountU32(mPerFrame), "invalid frame index");
+
+    mFrameIndex     = frameIndex;
+    PerFrame& frame = mPerFrame[mFrameIndex];
+
+    if (frame.resolved) {
+        ReadTimestamps(frame);
+    }
+
+    mEnabled           = mRequestEnabled && IsAvailable();
+    frame.asyncCompute = mEnabled;
+    frame.resolved     = false;
+    for (Timestamps& timestamps : frame.timestamps) {
+        timestamps.query->Reset(0, 2 * mMaxSpanCount);
+        timestamps.spanCount = 0;
+        timestamps.spanOpen  = false;
+    }
+}
+
+grfx::Semaphore* AsyncComputeScheduler::GetSemaphore(uint32_t index) const
+{
+    const PerFrame& frame = mPerFrame[mFrameIndex];
+    PPX_ASSERT_MSG(index < CountU32(frame.semaphores), "invalid semaphore index");
+    return frame.semaphores[index];
+}
+
+Result AsyncComputeScheduler::Submit(AsyncComputeWork work, const grfx::SubmitInfo* pSubmitInfo)
+{
+    return GetQueue(work)->Submit(pSubmitInfo);
+}
+
+void AsyncComputeScheduler::BeginWork(grfx::CommandBuffer* pCommandBuffer, AsyncComputeWork work)
+{
+    Timestamps& timestamps = mPerFrame[mFrameIndex].timestamps[work];
+    PPX_ASSERT_MSG(!timestamps.spanOpen, "async compute work span already open");
+    if (timestamps.spanCount >= mMaxSpanCount) {
+        return;
+    }
+
+    pCommandBuffer->WriteTimestamp(timestamps.query, grfx::PIPELINE_STAGE_TOP_OF_PIPE_BIT, 2 * timestamps.spanCount);
+    timestamps.spanOpen = true;
+}
+
+void AsyncComputeScheduler::EndWork(grfx::CommandBuffer* pCommandBuffer, AsyncComputeWork work)
+{
+    Timestamps& timestamps = mPerFrame[mFrameIndex].timestamps[work];
+    if (!timestamps.spanOpen) {
+        return;
+    }
+
+    pCommandBuffer->WriteTimestamp(timestamps.query, grfx::PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 2 * timestamps.spanCount + 1);
+    timestamps.spanOpen = false;
+    ++timestamps.spanCount;
+}
+
+void AsyncComputeScheduler::ResolveTimestamps(grfx::CommandBuffer* pCommandBuffer)
+{
+    PerFrame& frame = mPerFrame[mFrameIndex];
+    for (Timestamps& timestamps : frame.timestamps) {
+        PPX_ASSERT_MSG(!timestamps.spanOpen, "async compute work span still open");
+        if (timestamps.spanCount > 0) {
+            pCommandBuffer->ResolveQueryData(timestamps.query, 0, 2 * timestamps.spanCount);
+        }
+    }
+    frame.resolved = true;
+}
+
+void AsyncComputeScheduler::TransferOwnership(
+    grfx::CommandBuffer* pCommandBuffer,
+    const grfx::Image*   pImage,
+    grfx::ResourceState  state,
+    const grfx::Queue*   pSrcQueue,
+    const grfx::Queue*   pDstQueue) const
+{
+    if (!mEnabled || !mQueueFamilyTransfers) {
+        return;
+    }
+    pCommandBuffer->TransitionImageLayout(pImage, PPX_ALL_SUBRESOURCES, state, state, pSrcQueue, pDstQueue);
+}
+
+void AsyncComputeScheduler::TransferOwnership(
+    grfx::CommandBuffer* pCommandBuffer,
+    const grfx::Buffer*  pBuffer,
+    grfx::ResourceState  state,
+    const grfx::Queue*   pSrcQueue,
+    const grfx::Queue*   pDstQueue) const
+{
+    if (!mEnabled || !mQueueFamilyTransfers) {
+        return;
+    }
+    pCommandBuffer->BufferResourceBarrier(pBuffer, state, state, pSrcQueue, pDstQueue);
+}
+
+void AsyncComputeScheduler::ReleaseToCompute(grfx::CommandBuffer* pCommandBuffer, const grfx::Image* pImage, grfx::ResourceState state) const
+{
+    TransferOwnership(pCommandBuffer, pImage, state, mGraphicsQueue, mComputeQueue);
+}
+
+void AsyncComputeScheduler::ReleaseToCompute(grfx::CommandBuffer* pCommandBuffer, const grfx::Buffer* pBuffer, grfx::ResourceState state) const
+{
+    TransferOwnership(pCommandBuffer, pBuffer, state, mGraphicsQueue, mComputeQueue);
+}
+
+void AsyncComputeScheduler::AcquireFromGraphics(grfx::CommandBuffer* pCommandBuffer, const grfx::Image* pImage, grfx::ResourceState state) const
+{
+    TransferOwnership(pCommandBuffer, pImage, state, mGraphicsQueue, mComputeQueue);
+}
+
+void AsyncComputeScheduler::AcquireFromGraphics(grfx::CommandBuffer* pCommandBuffer, const grfx::Buffer* pBuffer, grfx::ResourceState state) const
+{
+    TransferOwnership(pCommandBuffer, pBuffer, state, mGraphicsQueue, mComputeQueue);
+}
+
+void AsyncComputeScheduler::ReleaseToGraphics(grfx::CommandBuffer* pCommandBuffer, const grfx::Image* pImage, grfx::ResourceState state) const
+{
+    TransferOwnership(pCommandBuffer, pImage, state, mComputeQueue, mGraphicsQueue);
+}
+
+void AsyncComputeScheduler::ReleaseToGraphics(grfx::CommandBuffer* pCommandBuffer, const grfx::Buffer* pBuffer, grfx::ResourceState state) const
+{
+    TransferOwnership(pCommandBuffer, pBuffer, state, mComputeQueue, mGraphicsQueue);
+}
+
+void AsyncComputeScheduler::AcquireFromCompute(grfx::CommandBuffer* pCommandBuffer, const grfx::Image* pImage, grfx::ResourceState state) const
+{
+    TransferOwnership(pCommandBuffer, pImage, state, mComputeQueue, mGraphicsQueue);
+}
+
+void AsyncComputeScheduler::AcquireFromCompute(grfx::CommandBuffer* pCommandBuffer, const grfx::Buffer* pBuffer, grfx::ResourceState state) const
+{
+    TransferOwnership(pCommandBuffer, pBuffer, state, mComputeQueue, mGraphicsQueue);
+}
+
+void AsyncComputeScheduler::ReadTimestamps(PerFrame& frame)
+{
+    // Compute work ran on the graphics queue when async compute was off
+    const grfx::Queue* queues[ASYNC_COMPUTE_WORK_COUNT] = {mGraphicsQueue, frame.asyncCompute ? mComputeQueue : mGraphicsQueue};
+
+    std::vector<AsyncComputeSpan> spans[ASYNC_COMPUTE_WORK_COUNT];
+    for (uint32_t work = 0; work < ASYNC_COMPUTE_WORK_COUNT; ++work) {
+        Timestamps& timestamps = frame.timestamps[work];
+        if (timestamps.spanCount == 0) {
+            continue;
+        }
+
+        uint64_t frequency = 0;
+        if (Failed(queues[work]->GetTimestampFrequency(&frequency)) || (frequency == 0)) {
+            return;
+        }
+
+        std::vector<uint64_t> data(2 * timestamps.spanCount, 0);
+        if (Failed(timestamps.query->GetData(data.data(), data.size() * sizeof(uint64_t)))) {
+            return;
+        }
+
+        const double msPerTick = 1000.0 / static_cast<double>(frequency);
+        for (uint32_t i = 0; i < timestamps.spanCount; ++i) {
+            AsyncComputeSpan span = {};
+            span.beginMs          = static_cast<double>(data[2 * i]) * msPerTick;
+            span.endMs            = static_cast<double>(data[2 * i + 1]) * msPerTick;
+            spans[work].push_back(span);
+        }
+    }
+
+    mStats              = ComputeStats(spans[ASYNC_COMPUTE_WORK_GRAPHICS], spans[ASYNC_COMPUTE_WORK_COMPUTE]);
+    mStats.asyncCompute = frame.asyncCompute;
+    mHasStats           = true;
+}
+
+AsyncComputeStats AsyncComputeScheduler::ComputeStats(const std::vector<AsyncComputeSpan>& graphicsSpans, const std::vector<AsyncComputeSpan>& computeSpans)
+{
+    std::vector<AsyncComputeSpan> graphics = MergeSpans(graphicsSpans);
+    std::vector<AsyncComputeSpan> compute  = MergeSpans(computeSpans);
+
+    AsyncComputeStats stats = {};
+    stats.graphicsBusyMs    = SpanTotal(graphics);
+    stats.computeBusyMs     = SpanTotal(compute);
+
+    // Intersection of the two sorted lists of disjoint spans
+    size_t g = 0;
+    size_t c = 0;
+    while ((g < graphics.size()) && (c < compute.size())) {
+        double begin = std::max(graphics[g].beginMs, compute[c].beginMs);
+        double end   = std::min(graphics[g].endMs, compute[c].endMs);
+        if (end > begin) {
+            stats.overlapMs += end - begin;
+        }
+        if (graphics[g].endMs < compute[c].endMs) {
+            ++g;
+        }
+        else {
+            ++c;
+        }
+    }
+
+    std::vector<AsyncComputeSpan> all = graphics;
+    all.insert(all.end(), compute.begin(), compute.end());
+    all = MergeSpans(all);
+    if (!all.empty()) {
+        stats.frameMs = all.back().endMs - all.front().beginMs;
+    }
+
+    if (stats.computeBusyMs > 0) {
+        stats.overlapRatio = stats.overlapMs / stats.computeBusyMs;
+    }
+    return stats;
+}
+
+void AsyncComputeScheduler::AddMetrics(Application* pApp)
+{
+    PPX_ASSERT_NULL_ARG(pApp);
+    if (!pApp->HasActiveMetricsRun()) {
+        return;
+    }
+
+    metrics::MetricMetadata metadata = {metrics::MetricType::GAUGE, "Async Compute Overlap Ratio", "", metrics::MetricInterpretation::HIGHER_IS_BETTER, {0.f, 1.f}};
+    mOverlapRatioMetric              = pApp->AddMetric(metadata);
+    PPX_ASSERT_MSG(mOverlapRatioMetric != metrics::kInvalidMetricID, "Failed to add Async Compute Overlap Ratio metric");
+
+    metadata            = {metrics::MetricType::GAUGE, "Graphics Work GPU Time", "ms", metrics::MetricInterpretation::NONE, {0.f, 60000.f}};
+    mGraphicsBusyMetric = pApp->AddMetric(metadata);
+    PPX_ASSERT_MSG(mGraphicsBusyMetric != metrics::kInvalidMetricID, "Failed to add Graphics Work GPU Time metric");
+
+    metadata           = {metrics::MetricType::GAUGE, "Compute Work GPU Time", "ms", metrics::MetricInterpretation::NONE, {0.f, 60000.f}};
+    mComputeBusyMetric = pApp->AddMetric(metadata);
+    PPX_ASSERT_MSG(mComputeBusyMetric != metrics::kInvalidMetricID, "Failed to add Compute Work GPU Time metric");
+
+    metadata         = {metrics::MetricType::GAUGE, "Graphics And Compute GPU Time", "ms", metrics::MetricInterpretation::LOWER_IS_BETTER, {0.f, 60000.f}};
+    mFrameTimeMetric = pApp->AddMetric(metadata);
+    PPX_ASSERT_MSG(mFrameTimeMetric != metrics::kInvalidMetricID, "Failed to add Graphics And Compute GPU Time metric");
+}
+
+void AsyncComputeScheduler::RecordMetrics(Application* pApp, double seconds) const
+{
+    PPX_ASSERT_NULL_ARG(pApp);
+    if (!pApp->HasActiveMetricsRun() || !mHasStats) {
+        return;
+    }
+
+    metrics::MetricData data = {metrics::MetricType::GAUGE};
+    data.gauge.seconds       = seconds;
+
+    data.gauge.value = mStats.overlapRatio;
+    pApp->RecordMetricData(mOverlapRatioMetric, data);
+
+    data.gauge.value = mStats.graphicsBusyMs;
+    pApp->RecordMetricData(mGraphicsBusyMetric, data);
+
+    data.gauge.value = mStats.computeBusyMs;
+    pApp->RecordMetricData(mComputeBusyMetric, data);
+
+    data.gauge.value = mStats.frameMs;
+    pApp->RecordMetricData(mFrameTimeMetric, data);
+}
+
+} // namespace ppx
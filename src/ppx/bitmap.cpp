@@ -41,6 +41,11 @@ Bitmap::Bitmap(const Bitmap& obj)
     }
 }
 
+Bitmap::Bitmap(Bitmap&& obj) noexcept
+{
+    InternalMove(obj);
+}
+
 Bitmap::~Bitmap()
 {
     FreeStbiDataIfNeeded();
@@ -58,6 +63,14 @@ Bitmap& Bitmap::operator=(const Bitmap& rhs)
     return *this;
 }
 
+Bitmap& Bitmap::operator=(Bitmap&& rhs) noexcept
+{
+    if (&rhs != this) {
+        InternalMove(rhs);
+    }
+    return *this;
+}
+
 void Bitmap::FreeStbiDataIfNeeded()
 {
     if (mDataIsFromStbi && !IsNull(mData)) {
@@ -150,6 +163,27 @@ Result Bitmap::InternalCopy(const Bitmap& obj)
     return ppx::SUCCESS;
 }
 
+void Bitmap::InternalMove(Bitmap& obj)
+{
+    // In case of moves into a preexisting object.
+    FreeStbiDataIfNeeded();
+
+    mWidth        = obj.mWidth;
+    mHeight       = obj.mHeight;
+    mFormat       = obj.mFormat;
+    mChannelCount = obj.mChannelCount;
+    mPixelStride  = obj.mPixelStride;
+    mRowStride    = obj.mRowStride;
+
+    // Moving the vector keeps its buffer, so mData stays valid for internal
+    // storage as well as for external and stbi storage.
+    mData               = obj.mData;
+    mDataIsFromStbi     = obj.mDataIsFromStbi;
+    mInternalStorage    = std::move(obj.mInternalStorage);
+    obj.mDataIsFromStbi = false;
+    obj.InternalCtor();
+}
+
 Result Bitmap::Create(uint32_t width, uint32_t height, Bitmap::Format format, Bitmap* pBitmap)
 {
     PPX_ASSERT_NULL_ARG(pBitmap);
@@ -231,6 +265,16 @@ uint64_t Bitmap::GetFootprintSize(uint32_t rowStrideAlignment) const
     return size;
 }
 
+BitmapView Bitmap::GetView() const
+{
+    return BitmapView(mData, mWidth, mHeight, mFormat, mRowStride);
+}
+
+BitmapView Bitmap::GetView(uint32_t x, uint32_t y, uint32_t width, uint32_t height) const
+{
+    return GetView().GetSubView(x, y, width, height);
+}
+
 Result Bitmap::Resize(uint32_t width, uint32_t height)
 {
     // If internal storage is empty then this bitmap is using
@@ -256,6 +300,52 @@ Result Bitmap::ScaleTo(Bitmap* pTargetBitmap) const
     return ScaleTo(pTargetBitmap, STBIR_FILTER_DEFAULT);
 }
 
+static Bitmap::Format FloatFormat(uint32_t channelCount)
+{
+    // clang-format off
+    switch (channelCount) {
+        default: break;
+        case 1 : return Bitmap::FORMAT_R_FLOAT; break;
+        case 2 : return Bitmap::FORMAT_RG_FLOAT; break;
+        case 3 : return Bitmap::FORMAT_RGB_FLOAT; break;
+        case 4 : return Bitmap::FORMAT_RGBA_FLOAT; break;
+    }
+    // clang-format on
+    return Bitmap::FORMAT_UNDEFINED;
+}
+
+static Bitmap::Format Float16Format(uint32_t channelCount)
+{
+    // clang-format off
+    switch (channelCount) {
+        default: break;
+        case 1 : return Bitmap::FORMAT_R_FLOAT16; break;
+        case 2 : return Bitmap::FORMAT_RG_FLOAT16; break;
+        case 3 : return Bitmap::FORMAT_RGB_FLOAT16; break;
+        case 4 : return Bitmap::FORMAT_RGBA_FLOAT16; break;
+    }
+    // clang-format on
+    return Bitmap::FORMAT_UNDEFINED;
+}
+
+// Converts between matching half and single precision float bitmaps of the
+// same size. Row strides may differ.
+static void ConvertFloat16Rows(const Bitmap& src, Bitmap* pDst)
+{
+    const uint32_t valueCount = src.GetWidth() * src.GetChannelCount();
+    const bool     toFloat    = (Bitmap::ChannelDataType(src.GetFormat()) == Bitmap::DATA_TYPE_FLOAT16);
+    for (uint32_t y = 0; y < src.GetHeight(); ++y) {
+        const char* pSrcRow = src.GetData() + y * src.GetRowStride();
+        char*       pDstRow = pDst->GetData() + y * pDst->GetRowStride();
+        if (toFloat) {
+            ConvertHalfToFloat(reinterpret_cast<const uint16_t*>(pSrcRow), reinterpret_cast<float*>(pDstRow), valueCount);
+        }
+        else {
+            ConvertFloatToHalf(reinterpret_cast<const float*>(pSrcRow), reinterpret_cast<uint16_t*>(pDstRow), valueCount);
+        }
+    }
+}
+
 Result Bitmap::ScaleTo(Bitmap* pTargetBitmap, stbir_filter filterType) const
 {
     if (IsNull(pTargetBitmap)) {
@@ -267,6 +357,28 @@ Result Bitmap::ScaleTo(Bitmap* pTargetBitmap, stbir_filter filterType) const
         return ppx::ERROR_IMAGE_INVALID_FORMAT;
     }
 
+    // stb_image_resize has no half float support: scale in single precision and convert back.
+    if (ChannelDataType(mFormat) == Bitmap::DATA_TYPE_FLOAT16) {
+        Result ppxres      = ppx::SUCCESS;
+        Bitmap floatSource = Bitmap::Create(mWidth, mHeight, FloatFormat(mChannelCount), &ppxres);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+        Bitmap floatTarget = Bitmap::Create(pTargetBitmap->GetWidth(), pTargetBitmap->GetHeight(), FloatFormat(mChannelCount), &ppxres);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+
+        ConvertFloat16Rows(*this, &floatSource);
+        ppxres = floatSource.ScaleTo(&floatTarget, filterType);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+        ConvertFloat16Rows(floatTarget, pTargetBitmap);
+
+        return ppx::SUCCESS;
+    }
+
     // clang-format off
     stbir_datatype datatype = InvalidValue<stbir_datatype>();
     switch (ChannelDataType(GetFormat())) {
@@ -413,6 +525,11 @@ uint32_t Bitmap::ChannelSize(Bitmap::Format value)
         case Bitmap::FORMAT_RG_FLOAT    : return 4; break;
         case Bitmap::FORMAT_RGB_FLOAT   : return 4; break;
         case Bitmap::FORMAT_RGBA_FLOAT  : return 4; break;
+
+        case Bitmap::FORMAT_R_FLOAT16    : return 2; break;
+        case Bitmap::FORMAT_RG_FLOAT16   : return 2; break;
+        case Bitmap::FORMAT_RGB_FLOAT16  : return 2; break;
+        case Bitmap::FORMAT_RGBA_FLOAT16 : return 2; break;
     }
     // clang-format on
     return 0;
@@ -442,6 +559,11 @@ uint32_t Bitmap::ChannelCount(Bitmap::Format value)
         case Bitmap::FORMAT_RG_FLOAT    : return 2; break;
         case Bitmap::FORMAT_RGB_FLOAT   : return 3; break;
         case Bitmap::FORMAT_RGBA_FLOAT  : return 4; break;
+
+        case Bitmap::FORMAT_R_FLOAT16    : return 1; break;
+        case Bitmap::FORMAT_RG_FLOAT16   : return 2; break;
+        case Bitmap::FORMAT_RGB_FLOAT16  : return 3; break;
+        case Bitmap::FORMAT_RGBA_FLOAT16 : return 4; break;
     }
     // clang-format on
     return 0;
@@ -479,6 +601,13 @@ Bitmap::DataType Bitmap::ChannelDataType(Bitmap::Format value)
         case Bitmap::FORMAT_RGBA_FLOAT: {
             return Bitmap::DATA_TYPE_FLOAT;
         } break;
+
+        case Bitmap::FORMAT_R_FLOAT16:
+        case Bitmap::FORMAT_RG_FLOAT16:
+        case Bitmap::FORMAT_RGB_FLOAT16:
+        case Bitmap::FORMAT_RGBA_FLOAT16: {
+            return Bitmap::DATA_TYPE_FLOAT16;
+        } break;
     }
     // clang-format on
     return Bitmap::DATA_TYPE_UNDEFINED;
@@ -550,7 +679,51 @@ bool Bitmap::IsBitmapFile(const std::filesystem::path& path)
     return (StbiInfo(path, &x, &y, &comp) == ppx::SUCCESS);
 }
 
-Result Bitmap::GetFileProperties(const std::filesystem::path& path, uint32_t* pWidth, uint32_t* pHeight, Bitmap::Format* pFormat)
+Bitmap::Format Bitmap::LoadFormat(int fileChannels, bool is16Bit, bool isRadiance, const BitmapLoadOptions& options)
+{
+    uint32_t channelCount = (options.mChannelCount > 0) ? options.mChannelCount : static_cast<uint32_t>(fileChannels);
+    channelCount          = std::clamp<uint32_t>(channelCount, 1, 4);
+    if ((channelCount == 3) && !options.mAllowRGB) {
+        channelCount = 4;
+    }
+
+    if (isRadiance) {
+        return options.mHalfFloat ? Float16Format(channelCount) : FloatFormat(channelCount);
+    }
+
+    // clang-format off
+    const bool use16Bit = is16Bit && options.mPreserve16Bit;
+    switch (channelCount) {
+        default: break;
+        case 1 : return use16Bit ? Bitmap::FORMAT_R_UINT16 : Bitmap::FORMAT_R_UINT8; break;
+        case 2 : return use16Bit ? Bitmap::FORMAT_RG_UINT16 : Bitmap::FORMAT_RG_UINT8; break;
+        case 3 : return use16Bit ? Bitmap::FORMAT_RGB_UINT16 : Bitmap::FORMAT_RGB_UINT8; break;
+        case 4 : return use16Bit ? Bitmap::FORMAT_RGBA_UINT16 : Bitmap::FORMAT_RGBA_UINT8; break;
+    }
+    // clang-format on
+    return Bitmap::FORMAT_UNDEFINED;
+}
+
+static Result IsSixteenBitFile(const std::filesystem::path& path, bool& is16Bit)
+{
+    ppx::fs::File file;
+    if (!file.Open(path)) {
+        return ppx::ERROR_IMAGE_FILE_LOAD_FAILED;
+    }
+
+    if (file.IsMapped()) {
+        is16Bit = (stbi_is_16_bit_from_memory(reinterpret_cast<const stbi_uc*>(file.GetMappedData()), static_cast<int>(file.GetLength())) != 0);
+    }
+    else {
+        std::vector<uint8_t> buffer(file.GetLength());
+        file.Read(buffer.data(), buffer.size());
+        is16Bit = (stbi_is_16_bit_from_memory(buffer.data(), static_cast<int>(buffer.size())) != 0);
+    }
+
+    return ppx::SUCCESS;
+}
+
+Result Bitmap::GetFileProperties(const std::filesystem::path& path, uint32_t* pWidth, uint32_t* pHeight, Bitmap::Format* pFormat, const BitmapLoadOptions& options)
 {
     if (!ppx::fs::path_exists(path)) {
         return ppx::ERROR_PATH_DOES_NOT_EXIST;
@@ -575,9 +748,15 @@ Result Bitmap::GetFileProperties(const std::filesystem::path& path, uint32_t* pW
         *pHeight = static_cast<uint32_t>(y);
     }
 
-    // Force to 4 channels to make things easier for the graphics APIs.
     if (!IsNull(pFormat)) {
-        *pFormat = isRadiance ? Bitmap::FORMAT_RGBA_FLOAT : Bitmap::FORMAT_RGBA_UINT8;
+        bool is16Bit = false;
+        if (!isRadiance && options.mPreserve16Bit) {
+            ppxres = IsSixteenBitFile(path, is16Bit);
+            if (Failed(ppxres)) {
+                return ppxres;
+            }
+        }
+        *pFormat = LoadFormat(comp, is16Bit, isRadiance, options);
     }
 
     return ppx::SUCCESS;
@@ -597,35 +776,54 @@ char* Bitmap::StbiLoad(const std::filesystem::path& path, Bitmap::Format format,
     }
 
     const stbi_uc* readPtr = file.IsMapped() ? reinterpret_cast<const stbi_uc*>(file.GetMappedData()) : buffer.data();
-    if (format == Bitmap::FORMAT_RGBA_FLOAT) {
-        return reinterpret_cast<char*>(stbi_loadf_from_memory(readPtr, file.GetLength(), pWidth, pHeight, pChannels, desiredChannels));
+    switch (Bitmap::ChannelDataType(format)) {
+        default: break;
+        case Bitmap::DATA_TYPE_FLOAT:
+        case Bitmap::DATA_TYPE_FLOAT16: {
+            return reinterpret_cast<char*>(stbi_loadf_from_memory(readPtr, file.GetLength(), pWidth, pHeight, pChannels, desiredChannels));
+        } break;
+        case Bitmap::DATA_TYPE_UINT16: {
+            return reinterpret_cast<char*>(stbi_load_16_from_memory(readPtr, file.GetLength(), pWidth, pHeight, pChannels, desiredChannels));
+        } break;
     }
     return reinterpret_cast<char*>(stbi_load_from_memory(readPtr, file.GetLength(), pWidth, pHeight, pChannels, desiredChannels));
 }
 
-Result Bitmap::LoadFile(const std::filesystem::path& path, Bitmap* pBitmap)
+Result Bitmap::LoadFile(const std::filesystem::path& path, Bitmap* pBitmap, const BitmapLoadOptions& options)
 {
-    if (!ppx::fs::path_exists(path)) {
-        return ppx::ERROR_PATH_DOES_NOT_EXIST;
-    }
+    PPX_ASSERT_NULL_ARG(pBitmap);
 
-    bool   isRadiance = false;
-    Result ppxres     = IsRadianceFile(path, isRadiance);
+    Bitmap::Format format = Bitmap::FORMAT_UNDEFINED;
+    Result         ppxres = GetFileProperties(path, nullptr, nullptr, &format, options);
     if (Failed(ppxres)) {
         return ppxres;
     }
 
-    int            width            = 0;
-    int            height           = 0;
-    int            channels         = 0;
-    int            requiredChannels = 4; // Force to 4 channels to make things easier for the graphics APIs.
-    Bitmap::Format format           = (isRadiance) ? Bitmap::FORMAT_RGBA_FLOAT : Bitmap::FORMAT_RGBA_UINT8;
-    char*          dataPtr          = StbiLoad(path, format, &width, &height, &channels, requiredChannels);
+    int   width            = 0;
+    int   height           = 0;
+    int   channels         = 0;
+    int   requiredChannels = static_cast<int>(Bitmap::ChannelCount(format));
+    char* dataPtr          = StbiLoad(path, format, &width, &height, &channels, requiredChannels);
 
     if (IsNull(dataPtr)) {
         PPX_LOG_ERROR("Failed to open file '" + path.string() + "'");
         return ppx::ERROR_IMAGE_FILE_LOAD_FAILED;
     }
+
+    // stbi only produces single precision floats, narrow into internal storage
+    if (Bitmap::ChannelDataType(format) == Bitmap::DATA_TYPE_FLOAT16) {
+        Bitmap source;
+        ppxres = Bitmap::Create(width, height, FloatFormat(requiredChannels), dataPtr, &source);
+        if (Success(ppxres)) {
+            ppxres = Bitmap::Create(width, height, format, pBitmap);
+        }
+        if (Success(ppxres)) {
+            ConvertFloat16Rows(source, pBitmap);
+        }
+        stbi_image_free(dataPtr);
+        return ppxres;
+    }
+
     ppxres = Bitmap::Create(width, height, format, dataPtr, pBitmap);
     if (!pBitmap->IsOk()) {
         // Something has gone really wrong if this happens
@@ -652,4 +850,71 @@ Result Bitmap::SaveFilePNG(const std::filesystem::path& path, const Bitmap* pBit
 #endif
 }
 
+// -------------------------------------------------------------------------------------------------
+// BitmapView
+// -------------------------------------------------------------------------------------------------
+BitmapView::BitmapView(char* pData, uint32_t width, uint32_t height, Bitmap::Format format, uint32_t rowStride)
+    : mData(pData),
+      mWidth(width),
+      mHeight(height),
+      mFormat(format),
+      mPixelStride(Bitmap::FormatSize(format)),
+      mRowStride((rowStride > 0) ? rowStride : width * Bitmap::FormatSize(format))
+{
+}
+
+bool BitmapView::IsOk() const
+{
+    bool isSizeValid    = (mWidth > 0) && (mHeight > 0);
+    bool isFormatValid  = (mFormat != Bitmap::FORMAT_UNDEFINED);
+    bool isStorageValid = (mData != nullptr);
+    return isSizeValid && isFormatValid && isStorageValid;
+}
+
+char* BitmapView::GetPixelAddress(uint32_t x, uint32_t y) const
+{
+    if (IsNull(mData) || (x >= mWidth) || (y >= mHeight)) {
+        return nullptr;
+    }
+    return mData + (static_cast<size_t>(y) * mRowStride) + (static_cast<size_t>(x) * mPixelStride);
+}
+
+BitmapView BitmapView::GetSubView(uint32_t x, uint32_t y, uint32_t width, uint32_t height) const
+{
+    bool isInside = (width > 0) && (height > 0) && (x + width <= mWidth) && (y + height <= mHeight);
+    if (!isInside) {
+        return BitmapView();
+    }
+    return BitmapView(GetPixelAddress(x, y), width, height, mFormat, mRowStride);
+}
+
+Result BitmapView::CopyTo(const BitmapView& dst) const
+{
+    if (!IsOk() || !dst.IsOk()) {
+        return ppx::ERROR_UNEXPECTED_NULL_ARGUMENT;
+    }
+    if (dst.mFormat != mFormat) {
+        return ppx::ERROR_IMAGE_INVALID_FORMAT;
+    }
+    if ((dst.mWidth != mWidth) || (dst.mHeight != mHeight)) {
+        return ppx::ERROR_BITMAP_FOOTPRINT_MISMATCH;
+    }
+
+    // One copy for the whole rectangle if neither side has padding
+    const size_t rowSize = static_cast<size_t>(mWidth) * mPixelStride;
+    if (IsTightlyPacked() && dst.IsTightlyPacked()) {
+        std::memcpy(dst.mData, mData, rowSize * mHeight);
+        return ppx::SUCCESS;
+    }
+
+    const char* pSrc = mData;
+    char*       pDst = dst.mData;
+    for (uint32_t y = 0; y < mHeight; ++y) {
+        std::memcpy(pDst, pSrc, rowSize);
+        pSrc += mRowStride;
+        pDst += dst.mRowStride;
+    }
+    return ppx::SUCCESS;
+}
+
 } // namespace ppx
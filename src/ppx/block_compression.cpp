@@ -0,0 +1,982 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ppx/block_compression.h"
+#include "ppx/job_system.h"
+#include "ppx/timer.h"
+#include "xxhash.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define PPX_BLOCK_COMPRESSION_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace ppx {
+
+// Bump whenever the encoder output changes so cached results get re-encoded.
+static const uint32_t kEncoderVersion     = 1;
+static const uint32_t kCacheFileMagic     = 0x43425850; // 'PXBC'
+static const uint32_t kBlockRowsPerJob    = 8;
+static const float    kBC7Weights4[16]    = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+static const float    kRGBWeights[4]      = {1.0f, 1.0f, 1.0f, 0.0f};
+static const float    kRGBAWeights[4]     = {1.0f, 1.0f, 1.0f, 1.0f};
+static const char*    kCacheFileExtension = ".bcc";
+
+struct CacheFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+};
+
+// 4x4 texels in [0, 255], one array per channel so that four texels can be
+// processed per SIMD instruction.
+struct TexelBlock
+{
+    alignas(16) float c[4][16];
+};
+
+// -------------------------------------------------------------------------------------------------
+// CompressedMipmap
+// -------------------------------------------------------------------------------------------------
+uint32_t CompressedMipmap::GetWidth(uint32_t level) const
+{
+    return (level < GetLevelCount()) ? mLevels[level].width : 0;
+}
+
+uint32_t CompressedMipmap::GetHeight(uint32_t level) const
+{
+    return (level < GetLevelCount()) ? mLevels[level].height : 0;
+}
+
+uint32_t CompressedMipmap::GetBlockCountX(uint32_t level) const
+{
+    return (GetWidth(level) + 3) / 4;
+}
+
+uint32_t CompressedMipmap::GetBlockCountY(uint32_t level) const
+{
+    return (GetHeight(level) + 3) / 4;
+}
+
+uint32_t CompressedMipmap::GetRowStride(uint32_t level) const
+{
+    if (mFormat == grfx::FORMAT_UNDEFINED) {
+        return 0;
+    }
+    return GetBlockCountX(level) * grfx::GetFormatDescription(mFormat)->bytesPerTexel;
+}
+
+uint64_t CompressedMipmap::GetDataSize(uint32_t level) const
+{
+    return (level < GetLevelCount()) ? mLevels[level].size : 0;
+}
+
+const char* CompressedMipmap::GetData(uint32_t level) const
+{
+    return (level < GetLevelCount()) ? (mData.data() + mLevels[level].offset) : nullptr;
+}
+
+char* CompressedMipmap::GetData(uint32_t level)
+{
+    return (level < GetLevelCount()) ? (mData.data() + mLevels[level].offset) : nullptr;
+}
+
+Result CompressedMipmap::Initialize(uint32_t width, uint32_t height, grfx::Format format, uint32_t levelCount)
+{
+    if ((width == 0) || (height == 0) || (levelCount == 0)) {
+        return ppx::ERROR_INVALID_CREATE_ARGUMENT;
+    }
+    if (!IsBlockCompressionSupported(format)) {
+        return ppx::ERROR_IMAGE_INVALID_FORMAT;
+    }
+
+    mFormat = format;
+    mLevels.resize(levelCount);
+
+    const uint64_t blockSize = grfx::GetFormatDescription(format)->bytesPerTexel;
+    uint64_t       offset    = 0;
+    for (uint32_t i = 0; i < levelCount; ++i) {
+        Level& level = mLevels[i];
+        level.width  = std::max<uint32_t>(width >> i, 1);
+        level.height = std::max<uint32_t>(height >> i, 1);
+        level.offset = offset;
+        level.size   = static_cast<uint64_t>((level.width + 3) / 4) * static_cast<uint64_t>((level.height + 3) / 4) * blockSize;
+        offset += level.size;
+    }
+    mData.assign(static_cast<size_t>(offset), 0);
+
+    return ppx::SUCCESS;
+}
+
+Result CompressedMipmap::LoadFile(const std::filesystem::path& path, CompressedMipmap* pMipmap)
+{
+    PPX_ASSERT_NULL_ARG(pMipmap);
+
+    std::ifstream is(path, std::ios::binary);
+    if (!is.is_open()) {
+        return ppx::ERROR_IMAGE_FILE_LOAD_FAILED;
+    }
+
+    CacheFileHeader header = {};
+    is.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!is.good() || (header.magic != kCacheFileMagic) || (header.version != kEncoderVersion)) {
+        return ppx::ERROR_IMAGE_FILE_LOAD_FAILED;
+    }
+
+    // Validate the header against the file before allocating anything so a
+    // corrupt cache file is reported as a load failure rather than an
+    // oversized allocation.
+    const grfx::Format format = static_cast<grfx::Format>(header.format);
+    if (!IsBlockCompressionSupported(format) || (header.width == 0) || (header.height == 0)) {
+        return ppx::ERROR_IMAGE_FILE_LOAD_FAILED;
+    }
+    const uint32_t maxLevelCount = Mipmap::CalculateLevelCount(header.width, header.height);
+    if ((header.levelCount == 0) || (header.levelCount > maxLevelCount)) {
+        return ppx::ERROR_IMAGE_FILE_LOAD_FAILED;
+    }
+
+    const uint64_t blockSize = grfx::GetFormatDescription(format)->bytesPerTexel;
+    uint64_t       dataSize  = 0;
+    for (uint32_t i = 0; i < header.levelCount; ++i) {
+        const uint64_t width  = std::max<uint32_t>(header.width >> i, 1);
+        const uint64_t height = std::max<uint32_t>(header.height >> i, 1);
+        dataSize += ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+    }
+
+    const std::streampos dataStart = is.tellg();
+    is.seekg(0, std::ios::end);
+    const std::streampos fileEnd = is.tellg();
+    is.seekg(dataStart);
+    if (!is.good() || (static_cast<uint64_t>(fileEnd - dataStart) != dataSize)) {
+        return ppx::ERROR_IMAGE_FILE_LOAD_FAILED;
+    }
+
+    CompressedMipmap mipmap;
+    Result           ppxres = mipmap.Initialize(header.width, header.height, format, header.levelCount);
+    if (Failed(ppxres)) {
+        return ppx::ERROR_IMAGE_FILE_LOAD_FAILED;
+    }
+
+    is.read(mipmap.mData.data(), static_cast<std::streamsize>(mipmap.mData.size()));
+    if (is.gcount() != static_cast<std::streamsize>(mipmap.mData.size())) {
+        return ppx::ERROR_IMAGE_FILE_LOAD_FAILED;
+    }
+
+    *pMipmap = std::move(mipmap);
+
+    return ppx::SUCCESS;
+}
+
+Result CompressedMipmap::SaveFile(const std::filesystem::path& path, const CompressedMipmap* pMipmap)
+{
+    PPX_ASSERT_NULL_ARG(pMipmap);
+    if (!pMipmap->IsOk()) {
+        return ppx::ERROR_IMAGE_FILE_SAVE_FAILED;
+    }
+
+    // Write to a temporary file first so a reader never sees a partial file
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream os(tempPath, std::ios::binary | std::ios::trunc);
+        if (!os.is_open()) {
+            return ppx::ERROR_IMAGE_FILE_SAVE_FAILED;
+        }
+
+        CacheFileHeader header = {};
+        header.magic           = kCacheFileMagic;
+        header.version         = kEncoderVersion;
+        header.format          = static_cast<uint32_t>(pMipmap->mFormat);
+        header.width           = pMipmap->GetWidth(0);
+        header.height          = pMipmap->GetHeight(0);
+        header.levelCount      = pMipmap->GetLevelCount();
+
+        os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        os.write(pMipmap->mData.data(), static_cast<std::streamsize>(pMipmap->mData.size()));
+        if (!os.good()) {
+            return ppx::ERROR_IMAGE_FILE_SAVE_FAILED;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return ppx::ERROR_IMAGE_FILE_SAVE_FAILED;
+    }
+
+    return ppx::SUCCESS;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Block encoders
+// -------------------------------------------------------------------------------------------------
+static void LoadTexelBlock(const uint8_t* pTexels, TexelBlock* pBlock)
+{
+    for (uint32_t i = 0; i < 16; ++i) {
+        for (uint32_t c = 0; c < 4; ++c) {
+            pBlock->c[c][i] = static_cast<float>(pTexels[4 * i + c]);
+        }
+    }
+}
+
+// Writes the index of the closest palette entry for every texel to
+// pIndices and returns the summed squared error.
+static float FitIndices(
+    const TexelBlock& block,
+    const float (*pPalette)[4],
+    uint32_t     paletteSize,
+    const float* pWeights,
+    uint8_t*     pIndices)
+{
+#if defined(PPX_BLOCK_COMPRESSION_SSE2)
+    const __m128 weights[4] = {
+        _mm_set1_ps(pWeights[0]),
+        _mm_set1_ps(pWeights[1]),
+        _mm_set1_ps(pWeights[2]),
+        _mm_set1_ps(pWeights[3])};
+
+    __m128 totalError = _mm_setzero_ps();
+    for (uint32_t i = 0; i < 16; i += 4) {
+        const __m128 texel[4] = {
+            _mm_load_ps(block.c[0] + i),
+            _mm_load_ps(block.c[1] + i),
+            _mm_load_ps(block.c[2] + i),
+            _mm_load_ps(block.c[3] + i)};
+
+        __m128 bestError = _mm_set1_ps(FLT_MAX);
+        __m128 bestIndex = _mm_setzero_ps();
+        for (uint32_t k = 0; k < paletteSize; ++k) {
+            __m128 error = _mm_setzero_ps();
+            for (uint32_t c = 0; c < 4; ++c) {
+                __m128 d = _mm_sub_ps(texel[c], _mm_set1_ps(pPalette[k][c]));
+                error    = _mm_add_ps(error, _mm_mul_ps(_mm_mul_ps(d, d), weights[c]));
+            }
+            __m128 better = _mm_cmplt_ps(error, bestError);
+            bestError     = _mm_min_ps(error, bestError);
+            bestIndex     = _mm_or_ps(_mm_and_ps(better, _mm_set1_ps(static_cast<float>(k))), _mm_andnot_ps(better, bestIndex));
+        }
+        totalError = _mm_add_ps(totalError, bestError);
+
+        alignas(16) int32_t indices[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(indices), _mm_cvttps_epi32(bestIndex));
+        for (uint32_t j = 0; j < 4; ++j) {
+            pIndices[i + j] = static_cast<uint8_t>(indices[j]);
+        }
+    }
+
+    alignas(16) float errors[4];
+    _mm_store_ps(errors, totalError);
+    return errors[0] + errors[1] + errors[2] + errors[3];
+#else
+    float totalError = 0;
+    for (uint32_t i = 0; i < 16; ++i) {
+        float   bestError = FLT_MAX;
+        uint8_t bestIndex = 0;
+        for (uint32_t k = 0; k < paletteSize; ++k) {
+            float error = 0;
+            for (uint32_t c = 0; c < 4; ++c) {
+                float d = block.c[c][i] - pPalette[k][c];
+                error += d * d * pWeights[c];
+            }
+            if (error < bestError) {
+                bestError = error;
+                bestIndex = static_cast<uint8_t>(k);
+            }
+        }
+        totalError += bestError;
+        pIndices[i] = bestIndex;
+    }
+    return totalError;
+#endif
+}
+
+// Fits a line through the texels selected by pMask (all if null) along
+// their principal axis and returns its extent as two endpoints.
+static void ComputeEndpoints(
+    const TexelBlock& block,
+    uint32_t          channelCount,
+    const bool*       pMask,
+    float*            pEndpoint0,
+    float*            pEndpoint1)
+{
+    float    mean[4] = {0, 0, 0, 0};
+    float    lo[4]   = {255, 255, 255, 255};
+    float    hi[4]   = {0, 0, 0, 0};
+    uint32_t count   = 0;
+    for (uint32_t i = 0; i < 16; ++i) {
+        if ((pMask != nullptr) && !pMask[i]) {
+            continue;
+        }
+        for (uint32_t c = 0; c < 4; ++c) {
+            mean[c] += block.c[c][i];
+            lo[c] = std::min(lo[c], block.c[c][i]);
+            hi[c] = std::max(hi[c], block.c[c][i]);
+        }
+        ++count;
+    }
+    for (uint32_t c = 0; c < 4; ++c) {
+        mean[c]       = (count > 0) ? (mean[c] / static_cast<float>(count)) : 0.0f;
+        pEndpoint0[c] = mean[c];
+        pEndpoint1[c] = mean[c];
+    }
+    if (count == 0) {
+        return;
+    }
+
+    float covariance[4][4] = {};
+    for (uint32_t i = 0; i < 16; ++i) {
+        if ((pMask != nullptr) && !pMask[i]) {
+            continue;
+        }
+        for (uint32_t r = 0; r < channelCount; ++r) {
+            for (uint32_t c = 0; c < channelCount; ++c) {
+                covariance[r][c] += (block.c[r][i] - mean[r]) * (block.c[c][i] - mean[c]);
+            }
+        }
+    }
+
+    // Power iteration, seeded with the bounding box diagonal
+    float axis[4] = {0, 0, 0, 0};
+    for (uint32_t c = 0; c < channelCount; ++c) {
+        axis[c] = hi[c] - lo[c];
+    }
+    for (uint32_t iteration = 0; iteration < 8; ++iteration) {
+        float next[4]  = {0, 0, 0, 0};
+        float maxValue = 0;
+        for (uint32_t r = 0; r < channelCount; ++r) {
+            for (uint32_t c = 0; c < channelCount; ++c) {
+                next[r] += covariance[r][c] * axis[c];
+            }
+            maxValue = std::max(maxValue, std::fabs(next[r]));
+        }
+        if (maxValue <= 0) {
+            break;
+        }
+        for (uint32_t c = 0; c < channelCount; ++c) {
+            axis[c] = next[c] / maxValue;
+        }
+    }
+
+    float length = 0;
+    for (uint32_t c = 0; c < channelCount; ++c) {
+        length += axis[c] * axis[c];
+    }
+    if (length <= 0) {
+        return;
+    }
+    length = std::sqrt(length);
+    for (uint32_t c = 0; c < channelCount; ++c) {
+        axis[c] /= length;
+    }
+
+    float tMin = FLT_MAX;
+    float tMax = -FLT_MAX;
+    for (uint32_t i = 0; i < 16; ++i) {
+        if ((pMask != nullptr) && !pMask[i]) {
+            continue;
+        }
+        float t = 0;
+        for (uint32_t c = 0; c < channelCount; ++c) {
+            t += (block.c[c][i] - mean[c]) * axis[c];
+        }
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+    }
+
+    for (uint32_t c = 0; c < channelCount; ++c) {
+        pEndpoint0[c] = std::clamp(mean[c] + axis[c] * tMin, 0.0f, 255.0f);
+        pEndpoint1[c] = std::clamp(mean[c] + axis[c] * tMax, 0.0f, 255.0f);
+    }
+}
+
+static uint16_t QuantizeRGB565(const float* pColor)
+{
+    uint32_t r = static_cast<uint32_t>(std::clamp(pColor[0], 0.0f, 255.0f) * (31.0f / 255.0f) + 0.5f);
+    uint32_t g = static_cast<uint32_t>(std::clamp(pColor[1], 0.0f, 255.0f) * (63.0f / 255.0f) + 0.5f);
+    uint32_t b = static_cast<uint32_t>(std::clamp(pColor[2], 0.0f, 255.0f) * (31.0f / 255.0f) + 0.5f);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void ExpandRGB565(uint16_t value, float* pColor)
+{
+    uint32_t r = (value >> 11) & 0x1F;
+    uint32_t g = (value >> 5) & 0x3F;
+    uint32_t b = value & 0x1F;
+    pColor[0]  = static_cast<float>((r << 3) | (r >> 2));
+    pColor[1]  = static_cast<float>((g << 2) | (g >> 4));
+    pColor[2]  = static_cast<float>((b << 3) | (b >> 2));
+    pColor[3]  = 255.0f;
+}
+
+static void BuildBC1Palette(uint16_t color0, uint16_t color1, bool threeColorMode, float (*pPalette)[4])
+{
+    ExpandRGB565(color0, pPalette[0]);
+    ExpandRGB565(color1, pPalette[1]);
+    for (uint32_t c = 0; c < 4; ++c) {
+        if (threeColorMode) {
+            pPalette[2][c] = (pPalette[0][c] + pPalette[1][c]) / 2.0f;
+            pPalette[3][c] = 0;
+        }
+        else {
+            pPalette[2][c] = (2.0f * pPalette[0][c] + pPalette[1][c]) / 3.0f;
+            pPalette[3][c] = (pPalette[0][c] + 2.0f * pPalette[1][c]) / 3.0f;
+        }
+    }
+}
+
+// Least squares endpoints for the interpolation weights implied by pIndices
+// in four color mode. Returns false if the system is degenerate.
+static bool RefineBC1Endpoints(const TexelBlock& block, const uint8_t* pIndices, float* pEndpoint0, float* pEndpoint1)
+{
+    static const float kWeight0[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+
+    float aa    = 0;
+    float bb    = 0;
+    float ab    = 0;
+    float ax[3] = {0, 0, 0};
+    float bx[3] = {0, 0, 0};
+    for (uint32_t i = 0; i < 16; ++i) {
+        float a = kWeight0[pIndices[i]];
+        float b = 1.0f - a;
+        aa += a * a;
+        bb += b * b;
+        ab += a * b;
+        for (uint32_t c = 0; c < 3; ++c) {
+            ax[c] += a * block.c[c][i];
+            bx[c] += b * block.c[c][i];
+        }
+    }
+
+    float det = aa * bb - ab * ab;
+    if (std::fabs(det) < 1e-6f) {
+        return false;
+    }
+    for (uint32_t c = 0; c < 3; ++c) {
+        pEndpoint0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / det, 0.0f, 255.0f);
+        pEndpoint1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / det, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+static void WriteBC1Block(uint16_t color0, uint16_t color1, const uint8_t* pIndices, char* pBlock)
+{
+    uint32_t bits = 0;
+    for (uint32_t i = 0; i < 16; ++i) {
+        bits |= static_cast<uint32_t>(pIndices[i] & 0x3) << (2 * i);
+    }
+
+    uint8_t* pDst = reinterpret_cast<uint8_t*>(pBlock);
+    pDst[0]       = static_cast<uint8_t>(color0 & 0xFF);
+    pDst[1]       = static_cast<uint8_t>(color0 >> 8);
+    pDst[2]       = static_cast<uint8_t>(color1 & 0xFF);
+    pDst[3]       = static_cast<uint8_t>(color1 >> 8);
+    for (uint32_t i = 0; i < 4; ++i) {
+        pDst[4 + i] = static_cast<uint8_t>((bits >> (8 * i)) & 0xFF);
+    }
+}
+
+// Texels with alpha below 128 are encoded as transparent when
+// allowTransparency is set; otherwise alpha is ignored. The color block of
+// BC3 must not use transparency since it is always decoded in four color mode.
+static void EncodeBC1(const TexelBlock& block, bool allowTransparency, char* pBlock)
+{
+    bool     opaque[16];
+    uint32_t opaqueCount = 0;
+    for (uint32_t i = 0; i < 16; ++i) {
+        opaque[i] = !allowTransparency || (block.c[3][i] >= 128.0f);
+        opaqueCount += opaque[i] ? 1 : 0;
+    }
+
+    uint8_t indices[16] = {};
+    if (opaqueCount == 0) {
+        std::fill(indices, indices + 16, static_cast<uint8_t>(3));
+        WriteBC1Block(0, 0, indices, pBlock);
+        return;
+    }
+
+    float endpoint0[4];
+    float endpoint1[4];
+    ComputeEndpoints(block, 3, opaque, endpoint0, endpoint1);
+
+    uint16_t color0 = QuantizeRGB565(endpoint1);
+    uint16_t color1 = QuantizeRGB565(endpoint0);
+    float    palette[4][4];
+
+    if (opaqueCount < 16) {
+        // Three color mode, index 3 is transparent black
+        if (color0 > color1) {
+            std::swap(color0, color1);
+        }
+        BuildBC1Palette(color0, color1, true, palette);
+        FitIndices(block, palette, 3, kRGBWeights, indices);
+        for (uint32_t i = 0; i < 16; ++i) {
+            if (!opaque[i]) {
+                indices[i] = 3;
+            }
+        }
+        WriteBC1Block(color0, color1, indices, pBlock);
+        return;
+    }
+
+    if (color0 < color1) {
+        std::swap(color0, color1);
+    }
+    if (color0 == color1) {
+        // Equal endpoints decode in three color mode, index 0 is always safe
+        WriteBC1Block(color0, color1, indices, pBlock);
+        return;
+    }
+
+    BuildBC1Palette(color0, color1, false, palette);
+    float error = FitIndices(block, palette, 4, kRGBWeights, indices);
+
+    if (RefineBC1Endpoints(block, indices, endpoint0, endpoint1)) {
+        uint16_t refined0 = QuantizeRGB565(endpoint0);
+        uint16_t refined1 = QuantizeRGB565(endpoint1);
+        if (refined0 < refined1) {
+            std::swap(refined0, refined1);
+        }
+        if (refined0 != refined1) {
+            uint8_t refinedIndices[16];
+            BuildBC1Palette(refined0, refined1, false, palette);
+            float refinedError = FitIndices(block, palette, 4, kRGBWeights, refinedIndices);
+            if (refinedError < error) {
+                color0 = refined0;
+                color1 = refined1;
+                std::memcpy(indices, refinedIndices, sizeof(indices));
+            }
+        }
+    }
+
+    WriteBC1Block(color0, color1, indices, pBlock);
+}
+
+// Single channel block in eight value mode.
+static void EncodeBC4(const float* pValues, char* pBlock)
+{
+    float lo = 255.0f;
+    float hi = 0.0f;
+    for (uint32_t i = 0; i < 16; ++i) {
+        lo = std::min(lo, pValues[i]);
+        hi = std::max(hi, pValues[i]);
+    }
+
+    uint8_t value0 = static_cast<uint8_t>(std::clamp(hi, 0.0f, 255.0f) + 0.5f);
+    uint8_t value1 = static_cast<uint8_t>(std::clamp(lo, 0.0f, 255.0f) + 0.5f);
+
+    uint64_t bits = 0;
+    if (value0 != value1) {
+        // The eight values are evenly spaced from value0 (step 0) to value1
+        // (step 7); codes 0 and 1 are the endpoints, codes 2-7 steps 1-6.
+        const float range = static_cast<float>(value0 - value1);
+        for (uint32_t i = 0; i < 16; ++i) {
+            float    t    = (static_cast<float>(value0) - pValues[i]) * 7.0f / range;
+            uint32_t step = static_cast<uint32_t>(std::clamp(t + 0.5f, 0.0f, 7.0f));
+            uint64_t code = (step == 0) ? 0 : ((step == 7) ? 1 : (step + 1));
+            bits |= code << (3 * i);
+        }
+    }
+
+    uint8_t* pDst = reinterpret_cast<uint8_t*>(pBlock);
+    pDst[0]       = value0;
+    pDst[1]       = value1;
+    for (uint32_t i = 0; i < 6; ++i) {
+        pDst[2 + i] = static_cast<uint8_t>((bits >> (8 * i)) & 0xFF);
+    }
+}
+
+class BitWriter
+{
+public:
+    BitWriter(uint8_t* pData)
+        : mData(pData) {}
+
+    void Write(uint32_t value, uint32_t bitCount)
+    {
+        for (uint32_t i = 0; i < bitCount; ++i, ++mOffset) {
+            if ((value >> i) & 1) {
+                mData[mOffset >> 3] |= static_cast<uint8_t>(1 << (mOffset & 7));
+            }
+        }
+    }
+
+private:
+    uint8_t* mData   = nullptr;
+    uint32_t mOffset = 0;
+};
+
+// Picks the p-bit that best represents pEndpoint with 7 bits per channel.
+static void QuantizeBC7Endpoint(const float* pEndpoint, bool opaque, uint32_t* pQuantized, uint32_t* pPBit)
+{
+    float bestError = FLT_MAX;
+    for (uint32_t p = (opaque ? 1 : 0); p < 2; ++p) {
+        uint32_t quantized[4];
+        float    error = 0;
+        for (uint32_t c = 0; c < 4; ++c) {
+            float q      = std::clamp((pEndpoint[c] - static_cast<float>(p)) / 2.0f + 0.5f, 0.0f, 127.0f);
+            quantized[c] = static_cast<uint32_t>(q);
+            float d      = static_cast<float>((quantized[c] << 1) | p) - pEndpoint[c];
+            error += d * d;
+        }
+        if (error < bestError) {
+            bestError = error;
+            *pPBit    = p;
+            std::memcpy(pQuantized, quantized, sizeof(quantized));
+        }
+    }
+    if (opaque) {
+        pQuantized[3] = 127;
+    }
+}
+
+// Mode 6 only: one subset, 7.7.7.7 endpoints with a p-bit each and 4 bit
+// indices. It handles color and alpha together, which suits most content.
+static void EncodeBC7(const TexelBlock& block, char* pBlock)
+{
+    bool opaque = true;
+    for (uint32_t i = 0; i < 16; ++i) {
+        opaque = opaque && (block.c[3][i] >= 255.0f);
+    }
+
+    float endpoint0[4];
+    float endpoint1[4];
+    ComputeEndpoints(block, 4, nullptr, endpoint0, endpoint1);
+
+    uint32_t quantized[2][4];
+    uint32_t pBits[2] = {0, 0};
+    QuantizeBC7Endpoint(endpoint0, opaque, quantized[0], &pBits[0]);
+    QuantizeBC7Endpoint(endpoint1, opaque, quantized[1], &pBits[1]);
+
+    float palette[16][4];
+    for (uint32_t k = 0; k < 16; ++k) {
+        for (uint32_t c = 0; c < 4; ++c) {
+            uint32_t value0 = (quantized[0][c] << 1) | pBits[0];
+            uint32_t value1 = (quantized[1][c] << 1) | pBits[1];
+            uint32_t w      = static_cast<uint32_t>(kBC7Weights4[k]);
+            palette[k][c]   = static_cast<float>(((64 - w) * value0 + w * value1 + 32) >> 6);
+        }
+    }
+
+    uint8_t indices[16];
+    FitIndices(block, palette, 16, kRGBAWeights, indices);
+
+    // The anchor index is stored without its high bit
+    if (indices[0] & 0x8) {
+        std::swap(quantized[0], quantized[1]);
+        std::swap(pBits[0], pBits[1]);
+        for (uint32_t i = 0; i < 16; ++i) {
+            indices[i] = static_cast<uint8_t>(15 - indices[i]);
+        }
+    }
+
+    std::memset(pBlock, 0, 16);
+    BitWriter writer(reinterpret_cast<uint8_t*>(pBlock));
+    writer.Write(1 << 6, 7);
+    for (uint32_t c = 0; c < 4; ++c) {
+        writer.Write(quantized[0][c], 7);
+        writer.Write(quantized[1][c], 7);
+    }
+    writer.Write(pBits[0], 1);
+    writer.Write(pBits[1], 1);
+    writer.Write(indices[0], 3);
+    for (uint32_t i = 1; i < 16; ++i) {
+        writer.Write(indices[i], 4);
+    }
+}
+
+bool IsBlockCompressionSupported(grfx::Format format)
+{
+    switch (format) {
+        default: break;
+        case grfx::FORMAT_BC1_RGBA_SRGB:
+        case grfx::FORMAT_BC1_RGBA_UNORM:
+        case grfx::FORMAT_BC1_RGB_SRGB:
+        case grfx::FORMAT_BC1_RGB_UNORM:
+        case grfx::FORMAT_BC3_SRGB:
+        case grfx::FORMAT_BC3_UNORM:
+        case grfx::FORMAT_BC4_UNORM:
+        case grfx::FORMAT_BC5_UNORM:
+        case grfx::FORMAT_BC7_UNORM:
+        case grfx::FORMAT_BC7_SRGB:
+            return true;
+    }
+    return false;
+}
+
+Result CompressBlock(grfx::Format format, const uint8_t* pTexels, char* pBlock)
+{
+    PPX_ASSERT_NULL_ARG(pTexels);
+    PPX_ASSERT_NULL_ARG(pBlock);
+
+    TexelBlock block;
+    LoadTexelBlock(pTexels, &block);
+
+    switch (format) {
+        default: return ppx::ERROR_IMAGE_INVALID_FORMAT;
+
+        case grfx::FORMAT_BC1_RGB_SRGB:
+        case grfx::FORMAT_BC1_RGB_UNORM: {
+            EncodeBC1(block, false, pBlock);
+        } break;
+
+        case grfx::FORMAT_BC1_RGBA_SRGB:
+        case grfx::FORMAT_BC1_RGBA_UNORM: {
+            EncodeBC1(block, true, pBlock);
+        } break;
+
+        case grfx::FORMAT_BC3_SRGB:
+        case grfx::FORMAT_BC3_UNORM: {
+            EncodeBC4(block.c[3], pBlock);
+            EncodeBC1(block, false, pBlock + 8);
+        } break;
+
+        case grfx::FORMAT_BC4_UNORM: {
+            EncodeBC4(block.c[0], pBlock);
+        } break;
+
+        case grfx::FORMAT_BC5_UNORM: {
+            EncodeBC4(block.c[0], pBlock);
+            EncodeBC4(block.c[1], pBlock + 8);
+        } break;
+
+        case grfx::FORMAT_BC7_SRGB:
+        case grfx::FORMAT_BC7_UNORM: {
+            EncodeBC7(block, pBlock);
+        } break;
+    }
+
+    return ppx::SUCCESS;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Mipmap compression
+// -------------------------------------------------------------------------------------------------
+static uint8_t ReadChannelUnorm8(const char* pPixel, Bitmap::DataType dataType, uint32_t channel)
+{
+    switch (dataType) {
+        default: break;
+        case Bitmap::DATA_TYPE_UINT8: {
+            return reinterpret_cast<const uint8_t*>(pPixel)[channel];
+        } break;
+        case Bitmap::DATA_TYPE_UINT16: {
+            return static_cast<uint8_t>(reinterpret_cast<const uint16_t*>(pPixel)[channel] >> 8);
+        } break;
+        case Bitmap::DATA_TYPE_UINT32: {
+            return static_cast<uint8_t>(reinterpret_cast<const uint32_t*>(pPixel)[channel] >> 24);
+        } break;
+        case Bitmap::DATA_TYPE_FLOAT: {
+            float value = reinterpret_cast<const float*>(pPixel)[channel];
+            return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+        } break;
+        case Bitmap::DATA_TYPE_FLOAT16: {
+            float value = HalfToFloat(reinterpret_cast<const uint16_t*>(pPixel)[channel]);
+            return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+        } break;
+    }
+    return 0;
+}
+
+// Reads the 4x4 block at (blockX, blockY) as RGBA8, replicating the last
+// row and column for blocks that extend past the edge of the bitmap.
+static void GatherBlock(const Bitmap& bitmap, uint32_t blockX, uint32_t blockY, uint8_t* pTexels)
+{
+    const uint32_t         channelCount = std::min<uint32_t>(bitmap.GetChannelCount(), 4);
+    const Bitmap::DataType dataType     = Bitmap::ChannelDataType(bitmap.GetFormat());
+
+    for (uint32_t y = 0; y < 4; ++y) {
+        uint32_t srcY = std::min(blockY * 4 + y, bitmap.GetHeight() - 1);
+        for (uint32_t x = 0; x < 4; ++x) {
+            uint32_t    srcX   = std::min(blockX * 4 + x, bitmap.GetWidth() - 1);
+            const char* pPixel = bitmap.GetPixelAddress(srcX, srcY);
+            uint8_t*    pDst   = pTexels + 4 * (4 * y + x);
+
+            pDst[0] = 0;
+            pDst[1] = 0;
+            pDst[2] = 0;
+            pDst[3] = 255;
+            if (dataType == Bitmap::DATA_TYPE_UINT8) {
+                std::memcpy(pDst, pPixel, channelCount);
+                continue;
+            }
+            for (uint32_t c = 0; c < channelCount; ++c) {
+                pDst[c] = ReadChannelUnorm8(pPixel, dataType, c);
+            }
+        }
+    }
+}
+
+Result CompressMipmap(
+    const Mipmap&     mipmap,
+    grfx::Format      format,
+    CompressedMipmap* pCompressed,
+    JobSystem*        pJobSystem)
+{
+    PPX_ASSERT_NULL_ARG(pCompressed);
+
+    if (!mipmap.IsOk()) {
+        return ppx::ERROR_BITMAP_BAD_COPY_SOURCE;
+    }
+    if (!IsBlockCompressionSupported(format)) {
+        PPX_LOG_ERROR("unsupported block compression format: " << static_cast<uint32_t>(format));
+        return ppx::ERROR_IMAGE_INVALID_FORMAT;
+    }
+    if (Bitmap::ChannelDataType(mipmap.GetFormat()) == Bitmap::DATA_TYPE_UNDEFINED) {
+        return ppx::ERROR_IMAGE_INVALID_FORMAT;
+    }
+
+    CompressedMipmap compressed;
+    Result           ppxres = compressed.Initialize(mipmap.GetWidth(0), mipmap.GetHeight(0), format, mipmap.GetLevelCount());
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    // Jobs cover a few rows of blocks each so small levels do not end up
+    // as one long job at the end of the batch.
+    struct BlockRows
+    {
+        uint32_t level;
+        uint32_t firstRow;
+        uint32_t rowCount;
+    };
+
+    std::vector<BlockRows> jobs;
+    for (uint32_t level = 0; level < compressed.GetLevelCount(); ++level) {
+        const uint32_t rowCount = compressed.GetBlockCountY(level);
+        for (uint32_t row = 0; row < rowCount; row += kBlockRowsPerJob) {
+            jobs.push_back({level, row, std::min(kBlockRowsPerJob, rowCount - row)});
+        }
+    }
+
+    JobSystem localJobSystem;
+    if (IsNull(pJobSystem)) {
+        localJobSystem.Initialize(JobSystem::GetDefaultWorkerCount());
+        pJobSystem = &localJobSystem;
+    }
+
+    const uint32_t blockSize = grfx::GetFormatDescription(format)->bytesPerTexel;
+    pJobSystem->Run(CountU32(jobs), [&](uint32_t jobIndex, uint32_t) {
+        const BlockRows& rows        = jobs[jobIndex];
+        const Bitmap*    pMip        = mipmap.GetMip(rows.level);
+        const uint32_t   blockCountX = compressed.GetBlockCountX(rows.level);
+        const uint32_t   rowStride   = compressed.GetRowStride(rows.level);
+        char*            pLevelData  = compressed.GetData(rows.level);
+
+        uint8_t texels[64];
+        for (uint32_t blockY = rows.firstRow; blockY < rows.firstRow + rows.rowCount; ++blockY) {
+            char* pRow = pLevelData + static_cast<size_t>(blockY) * rowStride;
+            for (uint32_t blockX = 0; blockX < blockCountX; ++blockX) {
+                GatherBlock(*pMip, blockX, blockY, texels);
+                CompressBlock(format, texels, pRow + blockX * blockSize);
+            }
+        }
+    });
+
+    *pCompressed = std::move(compressed);
+
+    return ppx::SUCCESS;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Cache
+// -------------------------------------------------------------------------------------------------
+static uint64_t CalculateCacheKey(const Mipmap& mipmap, grfx::Format format)
+{
+    const uint32_t params[4] = {
+        kEncoderVersion,
+        static_cast<uint32_t>(format),
+        static_cast<uint32_t>(mipmap.GetFormat()),
+        mipmap.GetLevelCount()};
+
+    XXH64_state_t* pState = XXH64_createState();
+    XXH64_reset(pState, 0);
+    XXH64_update(pState, params, sizeof(params));
+    for (uint32_t level = 0; level < mipmap.GetLevelCount(); ++level) {
+        const Bitmap*  pMip        = mipmap.GetMip(level);
+        const uint32_t size[2]     = {pMip->GetWidth(), pMip->GetHeight()};
+        const size_t   rowDataSize = static_cast<size_t>(pMip->GetWidth()) * pMip->GetPixelStride();
+
+        XXH64_update(pState, size, sizeof(size));
+        for (uint32_t y = 0; y < pMip->GetHeight(); ++y) {
+            XXH64_update(pState, pMip->GetPixelAddress(0, y), rowDataSize);
+        }
+    }
+    uint64_t hash = XXH64_digest(pState);
+    XXH64_freeState(pState);
+
+    return hash;
+}
+
+Result CompressMipmapCached(
+    const Mipmap&                mipmap,
+    grfx::Format                 format,
+    const std::filesystem::path& cacheDirectory,
+    CompressedMipmap*            pCompressed,
+    JobSystem*                   pJobSystem)
+{
+    PPX_ASSERT_NULL_ARG(pCompressed);
+
+    if (cacheDirectory.empty() || !mipmap.IsOk()) {
+        return CompressMipmap(mipmap, format, pCompressed, pJobSystem);
+    }
+
+    std::stringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << CalculateCacheKey(mipmap, format) << kCacheFileExtension;
+    const std::filesystem::path cachePath = cacheDirectory / ss.str();
+
+    CompressedMipmap cached;
+    Result           ppxres = CompressedMipmap::LoadFile(cachePath, &cached);
+    const bool cacheHit = Success(ppxres) &&
+                          (cached.GetFormat() == format) &&
+                          (cached.GetLevelCount() == mipmap.GetLevelCount()) &&
+                          (cached.GetWidth(0) == mipmap.GetWidth(0)) &&
+                          (cached.GetHeight(0) == mipmap.GetHeight(0));
+    if (cacheHit) {
+        *pCompressed = std::move(cached);
+        return ppx::SUCCESS;
+    }
+
+    Timer timer;
+    timer.Start();
+
+    ppxres = CompressMipmap(mipmap, format, pCompressed, pJobSystem);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    PPX_LOG_INFO("Block compressed " << mipmap.GetWidth(0) << "x" << mipmap.GetHeight(0) << " mipmap to format " << static_cast<uint32_t>(format) << " in " << timer.MillisSinceStart() << " ms");
+
+    std::error_code ec;
+    std::filesystem::create_directories(cacheDirectory, ec);
+    ppxres = CompressedMipmap::SaveFile(cachePath, pCompressed);
+    if (Failed(ppxres)) {
+        PPX_LOG_WARN("could not write block compression cache file: " << cachePath);
+    }
+
+    return ppx::SUCCESS;
+}
+
+} // namespace ppx
@@ -86,4 +86,61 @@ void OBB::GetPoints(float3 obbVertices[8]) const
     obbVertices[7] = mCenter + w + v + w;
 }
 
+// -------------------------------------------------------------------------------------------------
+// Frustum
+// -------------------------------------------------------------------------------------------------
+void Frustum::Set(const float4x4& viewProjectionMatrix)
+{
+    // Gribb/Hartmann plane extraction using the rows of the matrix. GLM
+    // matrices are column major so the rows have to be gathered.
+    const float4x4 M  = glm::transpose(viewProjectionMatrix);
+    const float4&  r0 = M[0];
+    const float4&  r1 = M[1];
+    const float4&  r2 = M[2];
+    const float4&  r3 = M[3];
+
+    mPlanes[PLANE_LEFT]   = r3 + r0;
+    mPlanes[PLANE_RIGHT]  = r3 - r0;
+    mPlanes[PLANE_BOTTOM] = r3 + r1;
+    mPlanes[PLANE_TOP]    = r3 - r1;
+    mPlanes[PLANE_NEAR]   = r2;
+    mPlanes[PLANE_FAR]    = r3 - r2;
+
+    for (uint32_t i = 0; i < PLANE_COUNT; ++i) {
+        float length = glm::length(float3(mPlanes[i]));
+        if (length > 0.0f) {
+            mPlanes[i] /= length;
+        }
+    }
+}
+
+bool Frustum::Contains(const float3& pos) const
+{
+    for (uint32_t i = 0; i < PLANE_COUNT; ++i) {
+        const float4& plane = mPlanes[i];
+        if ((glm::dot(float3(plane), pos) + plane.w) < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::Intersects(const AABB& aabb) const
+{
+    const float3& minPos = aabb.GetMin();
+    const float3& maxPos = aabb.GetMax();
+    for (uint32_t i = 0; i < PLANE_COUNT; ++i) {
+        const float4& plane = mPlanes[i];
+        // Corner of the box furthest along the plane normal
+        float3 P = float3(
+            (plane.x >= 0.0f) ? maxPos.x : minPos.x,
+            (plane.y >= 0.0f) ? maxPos.y : minPos.y,
+            (plane.z >= 0.0f) ? maxPos.z : minPos.z);
+        if ((glm::dot(float3(plane), P) + plane.w) < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
 } // namespace ppx
@@ -0,0 +1,1024 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ppx/cube_map.h"
+#include "ppx/graphics_util.h"
+#include "ppx/job_system.h"
+#include "ppx/pixel_conversion.h"
+#include "ppx/timer.h"
+#include "ppx/util.h"
+#include "xxhash.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define PPX_CUBE_MAP_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace ppx {
+
+// Bump whenever the filtering changes so cached results get recomputed.
+static const uint32_t kFilterVersion      = 1;
+static const uint32_t kCacheFileMagic     = 0x4D435850; // 'PXCM'
+static const uint32_t kRowsPerJob         = 16;
+static const uint32_t kIrradianceMaxSize  = 64;
+static const char*    kCacheFileExtension = ".pxcm";
+static const float    kPi                 = 3.14159265358979f;
+
+struct CacheFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t faceSize;
+    uint32_t levelCount;
+};
+
+// -------------------------------------------------------------------------------------------------
+// RGBA float helpers, one SIMD register per texel
+// -------------------------------------------------------------------------------------------------
+#if defined(PPX_CUBE_MAP_SSE2)
+struct Texel
+{
+    __m128 v;
+};
+
+static inline Texel TexelZero()
+{
+    return {_mm_setzero_ps()};
+}
+
+static inline Texel TexelLoad(const float* p)
+{
+    return {_mm_loadu_ps(p)};
+}
+
+static inline void TexelStore(float* p, Texel t)
+{
+    _mm_storeu_ps(p, t.v);
+}
+
+// acc + t * w
+static inline Texel TexelMadd(Texel acc, Texel t, float w)
+{
+    return {_mm_add_ps(acc.v, _mm_mul_ps(t.v, _mm_set1_ps(w)))};
+}
+
+static inline Texel TexelScale(Texel t, float s)
+{
+    return {_mm_mul_ps(t.v, _mm_set1_ps(s))};
+}
+#else
+struct Texel
+{
+    float v[4];
+};
+
+static inline Texel TexelZero()
+{
+    return {{0, 0, 0, 0}};
+}
+
+static inline Texel TexelLoad(const float* p)
+{
+    return {{p[0], p[1], p[2], p[3]}};
+}
+
+static inline void TexelStore(float* p, Texel t)
+{
+    std::memcpy(p, t.v, sizeof(t.v));
+}
+
+static inline Texel TexelMadd(Texel acc, Texel t, float w)
+{
+    for (uint32_t i = 0; i < 4; ++i) {
+        acc.v[i] += t.v[i] * w;
+    }
+    return acc;
+}
+
+static inline Texel TexelScale(Texel t, float s)
+{
+    return TexelMadd(TexelZero(), t, s);
+}
+#endif
+
+static inline void Normalize(float* d)
+{
+    float invLength = 1.0f / std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    d[0] *= invLength;
+    d[1] *= invLength;
+    d[2] *= invLength;
+}
+
+// Direction through (s, t) in [-1, 1] of a face, t pointing down. Matches
+// the D3D and Vulkan cube map conventions.
+static void FaceToDirection(uint32_t face, float s, float t, float* d)
+{
+    // clang-format off
+    switch (face) {
+        default:
+        case CUBE_MAP_FACE_POS_X: d[0] =  1; d[1] = -t; d[2] = -s; break;
+        case CUBE_MAP_FACE_NEG_X: d[0] = -1; d[1] = -t; d[2] =  s; break;
+        case CUBE_MAP_FACE_POS_Y: d[0] =  s; d[1] =  1; d[2] =  t; break;
+        case CUBE_MAP_FACE_NEG_Y: d[0] =  s; d[1] = -1; d[2] = -t; break;
+        case CUBE_MAP_FACE_POS_Z: d[0] =  s; d[1] = -t; d[2] =  1; break;
+        case CUBE_MAP_FACE_NEG_Z: d[0] = -s; d[1] = -t; d[2] = -1; break;
+    }
+    // clang-format on
+    Normalize(d);
+}
+
+// Inverse of FaceToDirection, returns u and v in [0, 1].
+static uint32_t DirectionToFace(const float* d, float* pU, float* pV)
+{
+    float    ax = std::fabs(d[0]);
+    float    ay = std::fabs(d[1]);
+    float    az = std::fabs(d[2]);
+    uint32_t face;
+    float    sc, tc, ma;
+    if ((ax >= ay) && (ax >= az)) {
+        face = (d[0] > 0) ? CUBE_MAP_FACE_POS_X : CUBE_MAP_FACE_NEG_X;
+        sc   = (d[0] > 0) ? -d[2] : d[2];
+        tc   = -d[1];
+        ma   = ax;
+    }
+    else if (ay >= az) {
+        face = (d[1] > 0) ? CUBE_MAP_FACE_POS_Y : CUBE_MAP_FACE_NEG_Y;
+        sc   = d[0];
+        tc   = (d[1] > 0) ? d[2] : -d[2];
+        ma   = ay;
+    }
+    else {
+        face = (d[2] > 0) ? CUBE_MAP_FACE_POS_Z : CUBE_MAP_FACE_NEG_Z;
+        sc   = (d[2] > 0) ? d[0] : -d[0];
+        tc   = -d[1];
+        ma   = az;
+    }
+    *pU = 0.5f * (sc / ma + 1.0f);
+    *pV = 0.5f * (tc / ma + 1.0f);
+    return face;
+}
+
+// Bilinear sample of an RGBA float image with clamped edges, (x, y) in
+// texels with texel centers at +0.5. Horizontal wrapping is optional.
+static Texel SampleBilinear(const float* pTexels, uint32_t width, uint32_t height, float x, float y, bool wrapX)
+{
+    x -= 0.5f;
+    y -= 0.5f;
+    float fx = std::floor(x);
+    float fy = std::floor(y);
+    float wx = x - fx;
+    float wy = y - fy;
+
+    int32_t x0 = static_cast<int32_t>(fx);
+    int32_t y0 = static_cast<int32_t>(fy);
+    int32_t x1 = x0 + 1;
+    int32_t y1 = y0 + 1;
+    int32_t w  = static_cast<int32_t>(width);
+    int32_t h  = static_cast<int32_t>(height);
+    if (wrapX) {
+        x0 = ((x0 % w) + w) % w;
+        x1 = ((x1 % w) + w) % w;
+    }
+    else {
+        x0 = std::clamp(x0, 0, w - 1);
+        x1 = std::clamp(x1, 0, w - 1);
+    }
+    y0 = std::clamp(y0, 0, h - 1);
+    y1 = std::clamp(y1, 0, h - 1);
+
+    const float* pRow0 = pTexels + static_cast<size_t>(y0) * width * 4;
+    const float* pRow1 = pTexels + static_cast<size_t>(y1) * width * 4;
+
+    Texel result = TexelScale(TexelLoad(pRow0 + x0 * 4), (1 - wx) * (1 - wy));
+    result       = TexelMadd(result, TexelLoad(pRow0 + x1 * 4), wx * (1 - wy));
+    result       = TexelMadd(result, TexelLoad(pRow1 + x0 * 4), (1 - wx) * wy);
+    result       = TexelMadd(result, TexelLoad(pRow1 + x1 * 4), wx * wy);
+    return result;
+}
+
+static Texel SampleCubeLevel(const CubeMap& cubeMap, const float* d, uint32_t level)
+{
+    float    u, v;
+    uint32_t face = DirectionToFace(d, &u, &v);
+    uint32_t size = cubeMap.GetFaceSize(level);
+    return SampleBilinear(cubeMap.GetTexels(face, level), size, size, u * size, v * size, false);
+}
+
+static Texel SampleCube(const CubeMap& cubeMap, const float* d, float lod)
+{
+    lod         = std::clamp(lod, 0.0f, static_cast<float>(cubeMap.GetLevelCount() - 1));
+    uint32_t l0 = static_cast<uint32_t>(lod);
+    uint32_t l1 = std::min(l0 + 1, cubeMap.GetLevelCount() - 1);
+    float    w  = lod - static_cast<float>(l0);
+    Texel    t0 = SampleCubeLevel(cubeMap, d, l0);
+    if ((w <= 0.0f) || (l0 == l1)) {
+        return t0;
+    }
+    return TexelMadd(TexelScale(t0, 1 - w), SampleCubeLevel(cubeMap, d, l1), w);
+}
+
+// Jobs of kRowsPerJob rows of one face of one level
+struct FaceRows
+{
+    uint32_t level;
+    uint32_t face;
+    uint32_t firstRow;
+    uint32_t rowCount;
+};
+
+static void AppendFaceRowJobs(uint32_t level, uint32_t faceSize, std::vector<FaceRows>& jobs)
+{
+    for (uint32_t face = 0; face < CUBE_MAP_FACE_COUNT; ++face) {
+        for (uint32_t row = 0; row < faceSize; row += kRowsPerJob) {
+            jobs.push_back({level, face, row, std::min(kRowsPerJob, faceSize - row)});
+        }
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// CubeMap
+// -------------------------------------------------------------------------------------------------
+uint32_t CubeMap::GetFaceSize(uint32_t level) const
+{
+    return (level < GetLevelCount()) ? std::max<uint32_t>(mFaceSize >> level, 1) : 0;
+}
+
+uint64_t CubeMap::GetFaceDataSize(uint32_t level) const
+{
+    uint64_t size = GetFaceSize(level);
+    return size * size * 4 * sizeof(float);
+}
+
+const float* CubeMap::GetTexels(uint32_t face, uint32_t level) const
+{
+    if ((level >= GetLevelCount()) || (face >= CUBE_MAP_FACE_COUNT)) {
+        return nullptr;
+    }
+    uint64_t size = GetFaceSize(level);
+    return mData.data() + mLevelOffsets[level] + face * size * size * 4;
+}
+
+float* CubeMap::GetTexels(uint32_t face, uint32_t level)
+{
+    return const_cast<float*>(static_cast<const CubeMap*>(this)->GetTexels(face, level));
+}
+
+Bitmap CubeMap::GetFaceBitmap(uint32_t face, uint32_t level)
+{
+    float*   pTexels = GetTexels(face, level);
+    uint32_t size    = GetFaceSize(level);
+    if (IsNull(pTexels)) {
+        return Bitmap();
+    }
+    return Bitmap::Create(size, size, Bitmap::FORMAT_RGBA_FLOAT, reinterpret_cast<char*>(pTexels));
+}
+
+Result CubeMap::Initialize(uint32_t faceSize, uint32_t levelCount)
+{
+    if ((faceSize == 0) || (levelCount == 0)) {
+        return ppx::ERROR_INVALID_CREATE_ARGUMENT;
+    }
+
+    uint32_t maxLevelCount = 1;
+    while ((faceSize >> maxLevelCount) > 0) {
+        ++maxLevelCount;
+    }
+
+    mFaceSize = faceSize;
+    mLevelOffsets.resize(std::min(levelCount, maxLevelCount));
+
+    uint64_t offset = 0;
+    for (uint32_t level = 0; level < GetLevelCount(); ++level) {
+        uint64_t size        = GetFaceSize(level);
+        mLevelOffsets[level] = offset;
+        offset += CUBE_MAP_FACE_COUNT * size * size * 4;
+    }
+    mData.assign(static_cast<size_t>(offset), 0.0f);
+
+    return ppx::SUCCESS;
+}
+
+Result CubeMap::LoadFile(const std::filesystem::path& path, CubeMap* pCubeMap)
+{
+    PPX_ASSERT_NULL_ARG(pCubeMap);
+
+    std::ifstream is(path, std::ios::binary);
+    if (!is.is_open()) {
+        return ppx::ERROR_IMAGE_FILE_LOAD_FAILED;
+    }
+
+    CacheFileHeader header = {};
+    is.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!is.good() || (header.magic != kCacheFileMagic) || (header.version != kFilterVersion)) {
+        return ppx::ERROR_IMAGE_FILE_LOAD_FAILED;
+    }
+
+    CubeMap cubeMap;
+    Result  ppxres = cubeMap.Initialize(header.faceSize, header.levelCount);
+    if (Failed(ppxres) || (cubeMap.GetLevelCount() != header.levelCount)) {
+        return ppx::ERROR_IMAGE_FILE_LOAD_FAILED;
+    }
+
+    const std::streamsize dataSize = static_cast<std::streamsize>(cubeMap.mData.size() * sizeof(float));
+    is.read(reinterpret_cast<char*>(cubeMap.mData.data()), dataSize);
+    if (is.gcount() != dataSize) {
+        return ppx::ERROR_IMAGE_FILE_LOAD_FAILED;
+    }
+
+    *pCubeMap = std::move(cubeMap);
+
+    return ppx::SUCCESS;
+}
+
+Result CubeMap::SaveFile(const std::filesystem::path& path, const CubeMap* pCubeMap)
+{
+    PPX_ASSERT_NULL_ARG(pCubeMap);
+    if (!pCubeMap->IsOk()) {
+        return ppx::ERROR_IMAGE_FILE_SAVE_FAILED;
+    }
+
+    // Write to a temporary file first so a reader never sees a partial file
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream os(tempPath, std::ios::binary | std::ios::trunc);
+        if (!os.is_open()) {
+            return ppx::ERROR_IMAGE_FILE_SAVE_FAILED;
+        }
+
+        CacheFileHeader header = {};
+        header.magic           = kCacheFileMagic;
+        header.version         = kFilterVersion;
+        header.faceSize        = pCubeMap->mFaceSize;
+        header.levelCount      = pCubeMap->GetLevelCount();
+
+        os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        os.write(reinterpret_cast<const char*>(pCubeMap->mData.data()), static_cast<std::streamsize>(pCubeMap->mData.size() * sizeof(float)));
+        if (!os.good()) {
+            return ppx::ERROR_IMAGE_FILE_SAVE_FAILED;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return ppx::ERROR_IMAGE_FILE_SAVE_FAILED;
+    }
+
+    return ppx::SUCCESS;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Face operations
+// -------------------------------------------------------------------------------------------------
+
+// Copies count texels that are srcStep bytes apart. Sized variants let the
+// compiler use a single load and store per texel.
+template <size_t TexelSize>
+static void CopyTexelsStrided(char* pDst, const char* pSrc, ptrdiff_t srcStep, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i) {
+        std::memcpy(pDst, pSrc, TexelSize);
+        pDst += TexelSize;
+        pSrc += srcStep;
+    }
+}
+
+static void CopyTexelsStrided(char* pDst, const char* pSrc, ptrdiff_t srcStep, uint32_t count, uint32_t texelSize)
+{
+    switch (texelSize) {
+        case 4: CopyTexelsStrided<4>(pDst, pSrc, srcStep, count); return;
+        case 8: CopyTexelsStrided<8>(pDst, pSrc, srcStep, count); return;
+        case 16: CopyTexelsStrided<16>(pDst, pSrc, srcStep, count); return;
+        default: break;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        std::memcpy(pDst, pSrc, texelSize);
+        pDst += texelSize;
+        pSrc += srcStep;
+    }
+}
+
+Result ApplyCubeFaceOp(const Bitmap& src, uint32_t op, Bitmap* pDst)
+{
+    PPX_ASSERT_NULL_ARG(pDst);
+
+    const bool     swapAxes  = (op == grfx_util::CUBE_FACE_OP_ROTATE_90) || (op == grfx_util::CUBE_FACE_OP_ROTATE_270);
+    const uint32_t dstWidth  = swapAxes ? src.GetHeight() : src.GetWidth();
+    const uint32_t dstHeight = swapAxes ? src.GetWidth() : src.GetHeight();
+    if (!src.IsOk() || !pDst->IsOk() || (pDst->GetFormat() != src.GetFormat()) || (pDst->GetWidth() != dstWidth) || (pDst->GetHeight() != dstHeight)) {
+        return ppx::ERROR_INVALID_CREATE_ARGUMENT;
+    }
+    if (op > grfx_util::CUBE_FACE_OP_INVERT_VERTICAL) {
+        return ppx::ERROR_OUT_OF_RANGE;
+    }
+
+    const uint32_t  w         = src.GetWidth();
+    const uint32_t  h         = src.GetHeight();
+    const uint32_t  texelSize = src.GetPixelStride();
+    const ptrdiff_t rowStride = static_cast<ptrdiff_t>(src.GetRowStride());
+    for (uint32_t y = 0; y < dstHeight; ++y) {
+        // Source texel of dst(0, y) and the step to the source of dst(x + 1, y)
+        uint32_t  srcX = 0;
+        uint32_t  srcY = 0;
+        ptrdiff_t step = texelSize;
+        switch (op) {
+            default:
+            case grfx_util::CUBE_FACE_OP_NONE:
+                srcX = 0, srcY = y, step = texelSize;
+                break;
+            case grfx_util::CUBE_FACE_OP_ROTATE_90:
+                srcX = y, srcY = h - 1, step = -rowStride;
+                break;
+            case grfx_util::CUBE_FACE_OP_ROTATE_180:
+                srcX = w - 1, srcY = h - 1 - y, step = -static_cast<ptrdiff_t>(texelSize);
+                break;
+            case grfx_util::CUBE_FACE_OP_ROTATE_270:
+                srcX = w - 1 - y, srcY = 0, step = rowStride;
+                break;
+            case grfx_util::CUBE_FACE_OP_INVERT_HORIZONTAL:
+                srcX = w - 1, srcY = y, step = -static_cast<ptrdiff_t>(texelSize);
+                break;
+            case grfx_util::CUBE_FACE_OP_INVERT_VERTICAL:
+                srcX = 0, srcY = h - 1 - y, step = texelSize;
+                break;
+        }
+
+        char* pDstRow = pDst->GetPixelAddress(0, y);
+        if (step == static_cast<ptrdiff_t>(texelSize)) {
+            std::memcpy(pDstRow, src.GetPixelAddress(srcX, srcY), static_cast<size_t>(dstWidth) * texelSize);
+        }
+        else {
+            CopyTexelsStrided(pDstRow, src.GetPixelAddress(srcX, srcY), step, dstWidth, texelSize);
+        }
+    }
+
+    return ppx::SUCCESS;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Conversion and filtering
+// -------------------------------------------------------------------------------------------------
+
+// Expands any bitmap format to tightly packed RGBA float. Integer formats
+// are normalized to [0, 1], missing channels read as 0 and alpha as 1.
+static void ExpandToRGBAFloat(const Bitmap& bitmap, std::vector<float>& texels, JobSystem* pJobSystem)
+{
+    const uint32_t         width        = bitmap.GetWidth();
+    const uint32_t         height       = bitmap.GetHeight();
+    const uint32_t         channelCount = bitmap.GetChannelCount();
+    const Bitmap::DataType dataType     = Bitmap::ChannelDataType(bitmap.GetFormat());
+    const uint32_t         jobCount     = (height + kRowsPerJob - 1) / kRowsPerJob;
+    texels.resize(static_cast<size_t>(width) * height * 4);
+
+    pJobSystem->Run(jobCount, [&](uint32_t jobIndex, uint32_t) {
+        const uint32_t firstRow = jobIndex * kRowsPerJob;
+        const uint32_t lastRow  = std::min(firstRow + kRowsPerJob, height);
+        for (uint32_t y = firstRow; y < lastRow; ++y) {
+            float* pDst = texels.data() + static_cast<size_t>(y) * width * 4;
+            if (channelCount == 4) {
+                const char* pRow = bitmap.GetPixelAddress(0, y);
+                switch (dataType) {
+                    default: break;
+                    case Bitmap::DATA_TYPE_UINT8: ConvertUnorm8ToFloat(reinterpret_cast<const uint8_t*>(pRow), pDst, static_cast<size_t>(width) * 4); continue;
+                    case Bitmap::DATA_TYPE_UINT16: ConvertUnorm16ToFloat(reinterpret_cast<const uint16_t*>(pRow), pDst, static_cast<size_t>(width) * 4); continue;
+                    case Bitmap::DATA_TYPE_FLOAT: std::memcpy(pDst, pRow, static_cast<size_t>(width) * 4 * sizeof(float)); continue;
+                    case Bitmap::DATA_TYPE_FLOAT16: ConvertHalfToFloat(reinterpret_cast<const uint16_t*>(pRow), pDst, static_cast<size_t>(width) * 4); continue;
+                }
+            }
+            for (uint32_t x = 0; x < width; ++x, pDst += 4) {
+                const char* pPixel = bitmap.GetPixelAddress(x, y);
+                pDst[0]            = 0.0f;
+                pDst[1]            = 0.0f;
+                pDst[2]            = 0.0f;
+                pDst[3]            = 1.0f;
+                for (uint32_t c = 0; c < channelCount; ++c) {
+                    switch (dataType) {
+                        default: break;
+                        case Bitmap::DATA_TYPE_UINT8: pDst[c] = reinterpret_cast<const uint8_t*>(pPixel)[c] / 255.0f; break;
+                        case Bitmap::DATA_TYPE_UINT16: pDst[c] = reinterpret_cast<const uint16_t*>(pPixel)[c] / 65535.0f; break;
+                        case Bitmap::DATA_TYPE_UINT32: pDst[c] = static_cast<float>(reinterpret_cast<const uint32_t*>(pPixel)[c] / 4294967295.0); break;
+                        case Bitmap::DATA_TYPE_FLOAT: pDst[c] = reinterpret_cast<const float*>(pPixel)[c]; break;
+                        case Bitmap::DATA_TYPE_FLOAT16: pDst[c] = HalfToFloat(reinterpret_cast<const uint16_t*>(pPixel)[c]); break;
+                    }
+                }
+            }
+        }
+    });
+}
+
+void GenerateCubeMapMips(CubeMap* pCubeMap, JobSystem* pJobSystem)
+{
+    PPX_ASSERT_NULL_ARG(pCubeMap);
+
+    if (pCubeMap->GetLevelCount() < 2) {
+        return;
+    }
+
+    // One pool for every level
+    JobSystem localJobSystem;
+    if (IsNull(pJobSystem)) {
+        localJobSystem.Initialize(JobSystem::GetDefaultWorkerCount());
+        pJobSystem = &localJobSystem;
+    }
+
+    for (uint32_t level = 1; level < pCubeMap->GetLevelCount(); ++level) {
+        const uint32_t srcSize = pCubeMap->GetFaceSize(level - 1);
+        const uint32_t dstSize = pCubeMap->GetFaceSize(level);
+
+        std::vector<FaceRows> jobs;
+        AppendFaceRowJobs(level, dstSize, jobs);
+        pJobSystem->Run(CountU32(jobs), [&](uint32_t jobIndex, uint32_t) {
+            const FaceRows& rows = jobs[jobIndex];
+            const float*    pSrc = pCubeMap->GetTexels(rows.face, level - 1);
+            float*          pDst = pCubeMap->GetTexels(rows.face, level);
+            for (uint32_t y = rows.firstRow; y < rows.firstRow + rows.rowCount; ++y) {
+                const float* pSrcRow0 = pSrc + static_cast<size_t>(std::min(2 * y, srcSize - 1)) * srcSize * 4;
+                const float* pSrcRow1 = pSrc + static_cast<size_t>(std::min(2 * y + 1, srcSize - 1)) * srcSize * 4;
+                for (uint32_t x = 0; x < dstSize; ++x) {
+                    const uint32_t x0 = std::min(2 * x, srcSize - 1) * 4;
+                    const uint32_t x1 = std::min(2 * x + 1, srcSize - 1) * 4;
+
+                    Texel sum = TexelScale(TexelLoad(pSrcRow0 + x0), 0.25f);
+                    sum       = TexelMadd(sum, TexelLoad(pSrcRow0 + x1), 0.25f);
+                    sum       = TexelMadd(sum, TexelLoad(pSrcRow1 + x0), 0.25f);
+                    sum       = TexelMadd(sum, TexelLoad(pSrcRow1 + x1), 0.25f);
+                    TexelStore(pDst + (static_cast<size_t>(y) * dstSize + x) * 4, sum);
+                }
+            }
+        });
+    }
+}
+
+Result ConvertLatLongToCubeMap(
+    const Bitmap& latLong,
+    uint32_t      faceSize,
+    uint32_t      levelCount,
+    CubeMap*      pCubeMap,
+    JobSystem*    pJobSystem)
+{
+    PPX_ASSERT_NULL_ARG(pCubeMap);
+
+    if (!latLong.IsOk() || (Bitmap::ChannelDataType(latLong.GetFormat()) == Bitmap::DATA_TYPE_UNDEFINED)) {
+        return ppx::ERROR_IMAGE_INVALID_FORMAT;
+    }
+
+    CubeMap cubeMap;
+    Result  ppxres = cubeMap.Initialize(faceSize, levelCount);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    // The expansion, the resampling and the mips share one pool
+    JobSystem localJobSystem;
+    if (IsNull(pJobSystem)) {
+        localJobSystem.Initialize(JobSystem::GetDefaultWorkerCount());
+        pJobSystem = &localJobSystem;
+    }
+
+    std::vector<float> source;
+    ExpandToRGBAFloat(latLong, source, pJobSystem);
+
+    const uint32_t width  = latLong.GetWidth();
+    const uint32_t height = latLong.GetHeight();
+
+    std::vector<FaceRows> jobs;
+    AppendFaceRowJobs(0, faceSize, jobs);
+    pJobSystem->Run(CountU32(jobs), [&](uint32_t jobIndex, uint32_t) {
+        const FaceRows& rows      = jobs[jobIndex];
+        float*          pTexels   = cubeMap.GetTexels(rows.face, 0);
+        const float     texelSize = 2.0f / static_cast<float>(faceSize);
+        for (uint32_t y = rows.firstRow; y < rows.firstRow + rows.rowCount; ++y) {
+            const float t = (y + 0.5f) * texelSize - 1.0f;
+            for (uint32_t x = 0; x < faceSize; ++x) {
+                const float s = (x + 0.5f) * texelSize - 1.0f;
+                float       d[3];
+                FaceToDirection(rows.face, s, t, d);
+
+                // Longitude 0 (the image center) faces -Z, latitude 0 is +Y
+                const float u = 0.5f + std::atan2(d[0], -d[2]) / (2.0f * kPi);
+                const float v = std::acos(std::clamp(d[1], -1.0f, 1.0f)) / kPi;
+
+                Texel texel = SampleBilinear(source.data(), width, height, u * width, v * height, true);
+                TexelStore(pTexels + (static_cast<size_t>(y) * faceSize + x) * 4, texel);
+            }
+        }
+    });
+
+    GenerateCubeMapMips(&cubeMap, pJobSystem);
+
+    *pCubeMap = std::move(cubeMap);
+
+    return ppx::SUCCESS;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Irradiance
+// -------------------------------------------------------------------------------------------------
+static const uint32_t kSHCoefficientCount = 9;
+
+static void EvaluateSHBasis(const float* d, float* pBasis)
+{
+    const float x = d[0];
+    const float y = d[1];
+    const float z = d[2];
+    pBasis[0]     = 0.282095f;
+    pBasis[1]     = 0.488603f * y;
+    pBasis[2]     = 0.488603f * z;
+    pBasis[3]     = 0.488603f * x;
+    pBasis[4]     = 1.092548f * x * y;
+    pBasis[5]     = 1.092548f * y * z;
+    pBasis[6]     = 0.315392f * (3.0f * z * z - 1.0f);
+    pBasis[7]     = 1.092548f * x * z;
+    pBasis[8]     = 0.546274f * (x * x - y * y);
+}
+
+static float AreaElement(float x, float y)
+{
+    return std::atan2(x * y, std::sqrt(x * x + y * y + 1.0f));
+}
+
+// Solid angle covered by texel (s, t) of a face with the given texel size
+static float TexelSolidAngle(float s, float t, float halfTexel)
+{
+    const float x0 = s - halfTexel;
+    const float y0 = t - halfTexel;
+    const float x1 = s + halfTexel;
+    const float y1 = t + halfTexel;
+    return AreaElement(x0, y0) - AreaElement(x0, y1) - AreaElement(x1, y0) + AreaElement(x1, y1);
+}
+
+Result ComputeIrradianceCubeMap(
+    const CubeMap& environment,
+    uint32_t       faceSize,
+    CubeMap*       pIrradiance,
+    JobSystem*     pJobSystem)
+{
+    PPX_ASSERT_NULL_ARG(pIrradiance);
+    if (!environment.IsOk()) {
+        return ppx::ERROR_INVALID_CREATE_ARGUMENT;
+    }
+
+    CubeMap irradiance;
+    Result  ppxres = irradiance.Initialize(faceSize, 1);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    JobSystem localJobSystem;
+    if (IsNull(pJobSystem)) {
+        localJobSystem.Initialize(JobSystem::GetDefaultWorkerCount());
+        pJobSystem = &localJobSystem;
+    }
+
+    // 9 coefficients only capture low frequencies, a small level is enough
+    uint32_t sourceLevel = 0;
+    while ((sourceLevel + 1 < environment.GetLevelCount()) && (environment.GetFaceSize(sourceLevel) > kIrradianceMaxSize)) {
+        ++sourceLevel;
+    }
+    const uint32_t sourceSize = environment.GetFaceSize(sourceLevel);
+
+    // Project onto the SH basis with one set of accumulators per thread
+    using Coefficients = std::array<Texel, kSHCoefficientCount>;
+    std::vector<Coefficients> threadCoefficients(pJobSystem->GetThreadCount());
+    for (auto& coefficients : threadCoefficients) {
+        coefficients.fill(TexelZero());
+    }
+
+    std::vector<FaceRows> jobs;
+    AppendFaceRowJobs(sourceLevel, sourceSize, jobs);
+    pJobSystem->Run(CountU32(jobs), [&](uint32_t jobIndex, uint32_t threadIndex) {
+        const FaceRows& rows         = jobs[jobIndex];
+        const float*    pTexels      = environment.GetTexels(rows.face, sourceLevel);
+        const float     texelSize    = 2.0f / static_cast<float>(sourceSize);
+        Coefficients    coefficients = threadCoefficients[threadIndex];
+        for (uint32_t y = rows.firstRow; y < rows.firstRow + rows.rowCount; ++y) {
+            const float t = (y + 0.5f) * texelSize - 1.0f;
+            for (uint32_t x = 0; x < sourceSize; ++x) {
+                const float s = (x + 0.5f) * texelSize - 1.0f;
+                float       d[3];
+                float       basis[kSHCoefficientCount];
+                FaceToDirection(rows.face, s, t, d);
+                EvaluateSHBasis(d, basis);
+
+                const float solidAngle = TexelSolidAngle(s, t, 0.5f * texelSize);
+                const Texel texel      = TexelLoad(pTexels + (static_cast<size_t>(y) * sourceSize + x) * 4);
+                for (uint32_t i = 0; i < kSHCoefficientCount; ++i) {
+                    coefficients[i] = TexelMadd(coefficients[i], texel, basis[i] * solidAngle);
+                }
+            }
+        }
+        threadCoefficients[threadIndex] = coefficients;
+    });
+
+    // Cosine lobe convolution (Ramamoorthi and Hanrahan), divided by pi so
+    // a constant environment produces the same constant.
+    const float  bandScale[3] = {1.0f, 2.0f / 3.0f, 1.0f / 4.0f};
+    Coefficients coefficients;
+    for (uint32_t i = 0; i < kSHCoefficientCount; ++i) {
+        Texel sum = TexelZero();
+        for (const auto& threadSum : threadCoefficients) {
+            sum = TexelMadd(sum, threadSum[i], 1.0f);
+        }
+        const uint32_t band = (i == 0) ? 0 : ((i < 4) ? 1 : 2);
+        coefficients[i]     = TexelScale(sum, bandScale[band]);
+    }
+
+    jobs.clear();
+    AppendFaceRowJobs(0, faceSize, jobs);
+    pJobSystem->Run(CountU32(jobs), [&](uint32_t jobIndex, uint32_t) {
+        const FaceRows& rows      = jobs[jobIndex];
+        float*          pTexels   = irradiance.GetTexels(rows.face, 0);
+        const float     texelSize = 2.0f / static_cast<float>(faceSize);
+        for (uint32_t y = rows.firstRow; y < rows.firstRow + rows.rowCount; ++y) {
+            const float t = (y + 0.5f) * texelSize - 1.0f;
+            for (uint32_t x = 0; x < faceSize; ++x) {
+                const float s = (x + 0.5f) * texelSize - 1.0f;
+                float       d[3];
+                float       basis[kSHCoefficientCount];
+                FaceToDirection(rows.face, s, t, d);
+                EvaluateSHBasis(d, basis);
+
+                Texel texel = TexelZero();
+                for (uint32_t i = 0; i < kSHCoefficientCount; ++i) {
+                    texel = TexelMadd(texel, coefficients[i], basis[i]);
+                }
+                float* pTexel = pTexels + (static_cast<size_t>(y) * faceSize + x) * 4;
+                TexelStore(pTexel, texel);
+                // Ringing can push dark regions below zero
+                pTexel[0] = std::max(pTexel[0], 0.0f);
+                pTexel[1] = std::max(pTexel[1], 0.0f);
+                pTexel[2] = std::max(pTexel[2], 0.0f);
+                pTexel[3] = 1.0f;
+            }
+        }
+    });
+
+    *pIrradiance = std::move(irradiance);
+
+    return ppx::SUCCESS;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Prefiltered specular
+// -------------------------------------------------------------------------------------------------
+static float RadicalInverse(uint32_t bits)
+{
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return static_cast<float>(bits) * 2.3283064365386963e-10f;
+}
+
+// Light direction in the tangent space of N = V, with its weight and the
+// environment level it is read from. With N = V these do not depend on the
+// output texel, so they are computed once per level.
+struct PrefilterSample
+{
+    float l[3];
+    float weight;
+    float lod;
+};
+
+static std::vector<PrefilterSample> CalculatePrefilterSamples(float roughness, uint32_t sampleCount, uint32_t environmentSize)
+{
+    const float a               = roughness * roughness;
+    const float a2              = a * a;
+    const float texelSolidAngle = 4.0f * kPi / (6.0f * environmentSize * environmentSize);
+
+    std::vector<PrefilterSample> samples;
+    for (uint32_t i = 0; i < sampleCount; ++i) {
+        const float xi0      = static_cast<float>(i) / static_cast<float>(sampleCount);
+        const float xi1      = RadicalInverse(i);
+        const float phi      = 2.0f * kPi * xi0;
+        const float cosTheta = std::sqrt((1.0f - xi1) / (1.0f + (a2 - 1.0f) * xi1));
+        const float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+
+        // L = reflect(-V, H) with V = N = +Z
+        const float h[3]  = {sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta};
+        const float nDotL = 2.0f * cosTheta * cosTheta - 1.0f;
+        if (nDotL <= 0.0f) {
+            continue;
+        }
+
+        // pdf of L is D * NdotH / (4 * VdotH) = D / 4 since NdotH = VdotH
+        const float denom            = cosTheta * cosTheta * (a2 - 1.0f) + 1.0f;
+        const float d                = a2 / (kPi * denom * denom);
+        const float pdf              = d / 4.0f + 0.0001f;
+        const float sampleSolidAngle = 1.0f / (static_cast<float>(sampleCount) * pdf);
+
+        PrefilterSample sample = {};
+        sample.l[0]            = 2.0f * cosTheta * h[0];
+        sample.l[1]            = 2.0f * cosTheta * h[1];
+        sample.l[2]            = nDotL;
+        sample.weight          = nDotL;
+        sample.lod             = (roughness > 0.0f) ? std::max(0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.0f, 0.0f) : 0.0f;
+        samples.push_back(sample);
+    }
+    return samples;
+}
+
+Result ComputePrefilteredCubeMap(
+    const CubeMap& environment,
+    uint32_t       faceSize,
+    uint32_t       levelCount,
+    uint32_t       sampleCount,
+    CubeMap*       pPrefiltered,
+    JobSystem*     pJobSystem)
+{
+    PPX_ASSERT_NULL_ARG(pPrefiltered);
+    if (!environment.IsOk() || (sampleCount == 0)) {
+        return ppx::ERROR_INVALID_CREATE_ARGUMENT;
+    }
+
+    CubeMap prefiltered;
+    Result  ppxres = prefiltered.Initialize(faceSize, levelCount);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    JobSystem localJobSystem;
+    if (IsNull(pJobSystem)) {
+        localJobSystem.Initialize(JobSystem::GetDefaultWorkerCount());
+        pJobSystem = &localJobSystem;
+    }
+
+    const uint32_t environmentSize = environment.GetFaceSize(0);
+    const float    baseLod         = std::max(std::log2(static_cast<float>(environmentSize) / static_cast<float>(faceSize)), 0.0f);
+
+    std::vector<std::vector<PrefilterSample>> levelSamples(prefiltered.GetLevelCount());
+    std::vector<FaceRows>                     jobs;
+    for (uint32_t level = 0; level < prefiltered.GetLevelCount(); ++level) {
+        if (level > 0) {
+            const float roughness = static_cast<float>(level) / static_cast<float>(prefiltered.GetLevelCount() - 1);
+            levelSamples[level]   = CalculatePrefilterSamples(roughness, sampleCount, environmentSize);
+        }
+        AppendFaceRowJobs(level, prefiltered.GetFaceSize(level), jobs);
+    }
+
+    pJobSystem->Run(CountU32(jobs), [&](uint32_t jobIndex, uint32_t) {
+        const FaceRows& rows      = jobs[jobIndex];
+        const uint32_t  size      = prefiltered.GetFaceSize(rows.level);
+        const auto&     samples   = levelSamples[rows.level];
+        float*          pTexels   = prefiltered.GetTexels(rows.face, rows.level);
+        const float     texelSize = 2.0f / static_cast<float>(size);
+        for (uint32_t y = rows.firstRow; y < rows.firstRow + rows.rowCount; ++y) {
+            const float t = (y + 0.5f) * texelSize - 1.0f;
+            for (uint32_t x = 0; x < size; ++x) {
+                const float s = (x + 0.5f) * texelSize - 1.0f;
+                float       n[3];
+                FaceToDirection(rows.face, s, t, n);
+
+                float* pTexel = pTexels + (static_cast<size_t>(y) * size + x) * 4;
+                if (samples.empty()) {
+                    TexelStore(pTexel, SampleCube(environment, n, baseLod));
+                    continue;
+                }
+
+                // Tangent frame around N
+                const float  up[3]       = {0.0f, 0.0f, 1.0f};
+                const float  right[3]    = {1.0f, 0.0f, 0.0f};
+                const float* pUp         = (std::fabs(n[2]) < 0.999f) ? up : right;
+                float        tangentX[3] = {pUp[1] * n[2] - pUp[2] * n[1], pUp[2] * n[0] - pUp[0] * n[2], pUp[0] * n[1] - pUp[1] * n[0]};
+                Normalize(tangentX);
+                const float tangentY[3] = {n[1] * tangentX[2] - n[2] * tangentX[1], n[2] * tangentX[0] - n[0] * tangentX[2], n[0] * tangentX[1] - n[1] * tangentX[0]};
+
+                Texel sum         = TexelZero();
+                float totalWeight = 0.0f;
+                for (const auto& sample : samples) {
+                    const float l[3] = {
+                        tangentX[0] * sample.l[0] + tangentY[0] * sample.l[1] + n[0] * sample.l[2],
+                        tangentX[1] * sample.l[0] + tangentY[1] * sample.l[1] + n[1] * sample.l[2],
+                        tangentX[2] * sample.l[0] + tangentY[2] * sample.l[1] + n[2] * sample.l[2]};
+                    sum = TexelMadd(sum, SampleCube(environment, l, sample.lod), sample.weight);
+                    totalWeight += sample.weight;
+                }
+                TexelStore(pTexel, TexelScale(sum, 1.0f / totalWeight));
+            }
+        }
+    });
+
+    *pPrefiltered = std::move(prefiltered);
+
+    return ppx::SUCCESS;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Cache
+// -------------------------------------------------------------------------------------------------
+static uint64_t CalculateCacheKey(const Bitmap& latLong, const IBLCubeMapOptions& options)
+{
+    const uint32_t params[8] = {
+        kFilterVersion,
+        static_cast<uint32_t>(latLong.GetFormat()),
+        latLong.GetWidth(),
+        latLong.GetHeight(),
+        options.environmentSize,
+        options.irradianceSize,
+        options.prefilteredLevelCount,
+        options.prefilteredSampleCount};
+
+    XXH64_state_t* pState = XXH64_createState();
+    XXH64_reset(pState, 0);
+    XXH64_update(pState, params, sizeof(params));
+    const size_t rowDataSize = static_cast<size_t>(latLong.GetWidth()) * latLong.GetPixelStride();
+    for (uint32_t y = 0; y < latLong.GetHeight(); ++y) {
+        XXH64_update(pState, latLong.GetPixelAddress(0, y), rowDataSize);
+    }
+    uint64_t hash = XXH64_digest(pState);
+    XXH64_freeState(pState);
+
+    return hash;
+}
+
+Result ComputeIBLCubeMapsCached(
+    const Bitmap&                latLong,
+    const IBLCubeMapOptions&     options,
+    const std::filesystem::path& cacheDirectory,
+    CubeMap*                     pIrradiance,
+    CubeMap*                     pPrefiltered,
+    JobSystem*                   pJobSystem)
+{
+    PPX_ASSERT_NULL_ARG(pIrradiance);
+    PPX_ASSERT_NULL_ARG(pPrefiltered);
+
+    if (!latLong.IsOk()) {
+        return ppx::ERROR_IMAGE_INVALID_FORMAT;
+    }
+
+    std::filesystem::path irradiancePath;
+    std::filesystem::path prefilteredPath;
+    if (!cacheDirectory.empty()) {
+        std::stringstream ss;
+        ss << std::hex << std::setw(16) << std::setfill('0') << CalculateCacheKey(latLong, options);
+        irradiancePath  = cacheDirectory / (ss.str() + "_irradiance" + kCacheFileExtension);
+        prefilteredPath = cacheDirectory / (ss.str() + "_prefiltered" + kCacheFileExtension);
+
+        CubeMap irradiance;
+        CubeMap prefiltered;
+        if (Success(CubeMap::LoadFile(irradiancePath, &irradiance)) && Success(CubeMap::LoadFile(prefilteredPath, &prefiltered))) {
+            *pIrradiance  = std::move(irradiance);
+            *pPrefiltered = std::move(prefiltered);
+            return ppx::SUCCESS;
+        }
+    }
+
+    JobSystem localJobSystem;
+    if (IsNull(pJobSystem)) {
+        localJobSystem.Initialize(JobSystem::GetDefaultWorkerCount());
+        pJobSystem = &localJobSystem;
+    }
+
+    Timer timer;
+    timer.Start();
+
+    CubeMap environment;
+    Result  ppxres = ConvertLatLongToCubeMap(latLong, options.environmentSize, UINT32_MAX, &environment, pJobSystem);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+    ppxres = ComputeIrradianceCubeMap(environment, options.irradianceSize, pIrradiance, pJobSystem);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+    ppxres = ComputePrefilteredCubeMap(environment, options.environmentSize, options.prefilteredLevelCount, options.prefilteredSampleCount, pPrefiltered, pJobSystem);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    PPX_LOG_INFO("Computed IBL cube maps from " << latLong.GetWidth() << "x" << latLong.GetHeight() << " image in " << timer.MillisSinceStart() << " ms");
+
+    if (!cacheDirectory.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(cacheDirectory, ec);
+        if (Failed(CubeMap::SaveFile(irradiancePath, pIrradiance)) || Failed(CubeMap::SaveFile(prefilteredPath, pPrefiltered))) {
+            PPX_LOG_WARN("could not write IBL cube map cache files to: " << cacheDirectory);
+        }
+    }
+
+    return ppx::SUCCESS;
+}
+
+} // namespace ppx
@@ -0,0 +1,608 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ppx/frame_capture.h"
+#include "ppx/grfx/grfx_device.h"
+#include "ppx/pixel_conversion.h"
+#include "ppx/ppm_export.h"
+#include "ppx/string_util.h"
+
+#include "stb_image_write.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace ppx {
+
+// -------------------------------------------------------------------------------------------------
+// Encoding
+// -------------------------------------------------------------------------------------------------
+Result ParseFrameCaptureEncoding(std::string_view valueStr, FrameCaptureEncoding* pEncoding)
+{
+    PPX_ASSERT_NULL_ARG(pEncoding);
+
+    if (valueStr == "ppm") {
+        *pEncoding = FRAME_CAPTURE_ENCODING_PPM;
+    }
+    else if (valueStr == "png") {
+        *pEncoding = FRAME_CAPTURE_ENCODING_PNG;
+    }
+    else if (valueStr == "raw") {
+        *pEncoding = FRAME_CAPTURE_ENCODING_RAW;
+    }
+    else {
+        return ppx::ERROR_OUT_OF_RANGE;
+    }
+    return ppx::SUCCESS;
+}
+
+const char* GetFrameCaptureExtension(FrameCaptureEncoding encoding)
+{
+    switch (encoding) {
+        default: break;
+        case FRAME_CAPTURE_ENCODING_PNG: return ".png";
+        case FRAME_CAPTURE_ENCODING_RAW: return ".raw";
+    }
+    return ".ppm";
+}
+
+Result ParseFrameRange(std::string_view valueStr, uint64_t* pStart, uint64_t* pCount)
+{
+    PPX_ASSERT_NULL_ARG(pStart);
+    PPX_ASSERT_NULL_ARG(pCount);
+
+    if (std::count(valueStr.cbegin(), valueStr.cend(), ':') != 1) {
+        return ppx::ERROR_FAILED;
+    }
+    std::pair<std::string_view, std::string_view> parts = string_util::SplitInTwo(valueStr, ':');
+    if (parts.first.empty() || parts.second.empty() || (parts.first[0] == '-') || (parts.second[0] == '-')) {
+        return ppx::ERROR_FAILED;
+    }
+
+    uint64_t start = 0;
+    uint64_t count = 0;
+    if (Failed(string_util::Parse(parts.first, start)) || Failed(string_util::Parse(parts.second, count))) {
+        return ppx::ERROR_FAILED;
+    }
+
+    *pStart = start;
+    *pCount = count;
+    return ppx::SUCCESS;
+}
+
+static void WriteToStream(void* pContext, void* pData, int size)
+{
+    static_cast<std::ostream*>(pContext)->write(static_cast<const char*>(pData), size);
+}
+
+static Result WritePNG(std::ostream& outputStream, grfx::Format format, const void* pTexels, uint32_t width, uint32_t height, uint32_t rowPitch)
+{
+#if defined(PPX_ANDROID)
+    return ppx::ERROR_IMAGE_FILE_SAVE_FAILED;
+#else
+    const grfx::FormatDesc* pDesc = grfx::GetFormatDescription(format);
+
+    // Swapchain formats only, alpha is dropped
+    const bool isRGBA8 = (pDesc->layout == grfx::FORMAT_LAYOUT_LINEAR) &&
+                         (pDesc->componentBits == grfx::FORMAT_COMPONENT_RED_GREEN_BLUE_ALPHA) &&
+                         (pDesc->bytesPerTexel == 4) &&
+                         ((pDesc->dataType == grfx::FORMAT_DATA_TYPE_UNORM) || (pDesc->dataType == grfx::FORMAT_DATA_TYPE_SRGB) || (pDesc->dataType == grfx::FORMAT_DATA_TYPE_UINT));
+    if (!isRGBA8) {
+        return ppx::ERROR_IMAGE_INVALID_FORMAT;
+    }
+    const bool isBGRA = (pDesc->componentOffset.red == 2);
+
+    std::vector<uint8_t> rgb(3 * static_cast<size_t>(width) * height);
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint8_t* pRow = static_cast<const uint8_t*>(pTexels) + static_cast<size_t>(y) * rowPitch;
+        PackRGBA8ToRGB8(pRow, rgb.data() + 3 * static_cast<size_t>(y) * width, width, isBGRA);
+    }
+
+    int res = stbi_write_png_to_func(WriteToStream, &outputStream, static_cast<int>(width), static_cast<int>(height), 3, rgb.data(), static_cast<int>(3 * width));
+    if ((res == 0) || !outputStream) {
+        return ppx::ERROR_IMAGE_FILE_SAVE_FAILED;
+    }
+    return ppx::SUCCESS;
+#endif
+}
+
+static Result WriteRaw(std::ostream& outputStream, grfx::Format format, const void* pTexels, uint32_t width, uint32_t height, uint32_t rowPitch)
+{
+    const grfx::FormatDesc* pDesc = grfx::GetFormatDescription(format);
+    if (pDesc->layout == grfx::FORMAT_LAYOUT_COMPRESSED) {
+        return ppx::ERROR_IMAGE_INVALID_FORMAT;
+    }
+
+    const size_t rowSize = static_cast<size_t>(pDesc->bytesPerTexel) * width;
+    if (rowSize == rowPitch) {
+        outputStream.write(static_cast<const char*>(pTexels), rowSize * height);
+    }
+    else {
+        for (uint32_t y = 0; y < height; ++y) {
+            outputStream.write(static_cast<const char*>(pTexels) + static_cast<size_t>(y) * rowPitch, rowSize);
+        }
+    }
+    return outputStream ? ppx::SUCCESS : ppx::ERROR_IMAGE_FILE_SAVE_FAILED;
+}
+
+Result WriteCapturedFrame(
+    std::ostream&        outputStream,
+    FrameCaptureEncoding encoding,
+    grfx::Format         format,
+    const void*          pTexels,
+    uint32_t             width,
+    uint32_t             height,
+    uint32_t             rowPitch)
+{
+    PPX_ASSERT_NULL_ARG(pTexels);
+
+    switch (encoding) {
+        default: break;
+        case FRAME_CAPTURE_ENCODING_PNG: return WritePNG(outputStream, format, pTexels, width, height, rowPitch);
+        case FRAME_CAPTURE_ENCODING_RAW: return WriteRaw(outputStream, format, pTexels, width, height, rowPitch);
+    }
+    return ExportToPPM(outputStream, format, pTexels, width, height, rowPitch);
+}
+
+Result WriteCapturedFrame(
+    const std::filesystem::path& path,
+    FrameCaptureEncoding         encoding,
+    grfx::Format                 format,
+    const void*                  pTexels,
+    uint32_t                     width,
+    uint32_t                     height,
+    uint32_t                     rowPitch)
+{
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return ppx::ERROR_IMAGE_FILE_SAVE_FAILED;
+    }
+    return WriteCapturedFrame(file, encoding, format, pTexels, width, height, rowPitch);
+}
+
+// -------------------------------------------------------------------------------------------------
+// FrameCapture
+// -------------------------------------------------------------------------------------------------
+FrameCapture::~FrameCapture()
+{
+    Shutdown();
+}
+
+Result FrameCapture::Initialize(grfx::Device* pDevice, const FrameCaptureCreateInfo& createInfo)
+{
+    PPX_ASSERT_NULL_ARG(pDevice);
+    if (!IsNull(mDevice)) {
+        return ppx::ERROR_SINGLE_INIT_ONLY;
+    }
+    if (createInfo.ringSize == 0) {
+        return ppx::ERROR_UNEXPECTED_COUNT_VALUE;
+    }
+
+    mDevice     = pDevice;
+    mCreateInfo = createInfo;
+    mSlots.resize(createInfo.ringSize);
+
+    for (Slot& slot : mSlots) {
+        grfx::FenceCreateInfo fenceCreateInfo = {};
+        Result                ppxres          = mDevice->CreateFence(&fenceCreateInfo, &slot.fence);
+        if (Failed(ppxres)) {
+            Shutdown();
+            return ppxres;
+        }
+    }
+
+    mStopEncoder   = false;
+    mEncoderThread = std::thread(&FrameCapture::EncoderThreadFunc, this);
+
+    return ppx::SUCCESS;
+}
+
+void FrameCapture::Shutdown()
+{
+    if (IsNull(mDevice)) {
+        return;
+    }
+
+    // Captures recorded but never submitted cannot complete
+    for (uint32_t slotIndex : mRecordedSlots) {
+        mSlots[slotIndex].state = SLOT_STATE_FREE;
+    }
+    mRecordedSlots.clear();
+
+    if (mEncoderThread.joinable()) {
+        Result ppxres = Flush();
+        if (Failed(ppxres)) {
+            PPX_LOG_WARN("frame capture failed: " << ToString(ppxres));
+        }
+        {
+            std::lock_guard<std::mutex> lock(mEncoderMutex);
+            mStopEncoder = true;
+        }
+        mEncoderCondition.notify_all();
+        mEncoderThread.join();
+    }
+
+    for (Slot& slot : mSlots) {
+        if (slot.commandBuffer) {
+            mCommandBufferQueue->DestroyCommandBuffer(slot.commandBuffer);
+        }
+        if (slot.buffer) {
+            mDevice->DestroyBuffer(slot.buffer);
+        }
+        if (slot.fence) {
+            mDevice->DestroyFence(slot.fence);
+        }
+    }
+    mSlots.clear();
+    mEncodeQueue.clear();
+
+    mCommandBufferQueue = nullptr;
+    mDevice             = nullptr;
+}
+
+Result FrameCapture::AcquireSlot(grfx::Image* pImage, uint32_t* pSlotIndex)
+{
+    Result ppxres = Poll();
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    // Wait for the oldest capture while the whole ring is in flight
+    auto findFree = [this]() {
+        std::lock_guard<std::mutex> lock(mEncoderMutex);
+        for (uint32_t i = 0; i < CountU32(mSlots); ++i) {
+            if (mSlots[i].state == SLOT_STATE_FREE) {
+                return static_cast<int32_t>(i);
+            }
+        }
+        return -1;
+    };
+    int32_t slotIndex = findFree();
+    while (slotIndex < 0) {
+        if (mRecordedSlots.size() == mSlots.size()) {
+            PPX_ASSERT_MSG(false, "every frame capture slot is recorded but not submitted");
+            return ppx::ERROR_LIMIT_EXCEEDED;
+        }
+
+        ppxres = CheckSubmitted(/* wait= */ true);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+        {
+            std::unique_lock<std::mutex> lock(mEncoderMutex);
+            mWrittenCondition.wait(lock, [this] {
+                return std::any_of(mSlots.begin(), mSlots.end(), [](const Slot& slot) { return slot.state == SLOT_STATE_WRITTEN; });
+            });
+        }
+        ppxres = RecycleWritten();
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+        slotIndex = findFree();
+    }
+
+    // Rows are aligned for D3D12, Vulkan copies tightly packed rows
+    Slot&                   slot     = mSlots[slotIndex];
+    const grfx::FormatDesc* pDesc    = grfx::GetFormatDescription(pImage->GetFormat());
+    const uint64_t          rowPitch = RoundUp<uint64_t>(static_cast<uint64_t>(pDesc->bytesPerTexel) * pImage->GetWidth(), PPX_D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+    const uint64_t          size     = rowPitch * pImage->GetHeight();
+    if (slot.bufferSize < size) {
+        if (slot.buffer) {
+            mDevice->DestroyBuffer(slot.buffer);
+            slot.buffer.Reset();
+        }
+
+        grfx::BufferCreateInfo bufferCreateInfo      = {};
+        bufferCreateInfo.size                        = size;
+        bufferCreateInfo.initialState                = grfx::RESOURCE_STATE_COPY_DST;
+        bufferCreateInfo.usageFlags.bits.transferDst = 1;
+        bufferCreateInfo.memoryUsage                 = grfx::MEMORY_USAGE_GPU_TO_CPU;
+        ppxres                                       = mDevice->CreateBuffer(&bufferCreateInfo, &slot.buffer);
+        if (Failed(ppxres)) {
+            slot.bufferSize = 0;
+            return ppxres;
+        }
+        slot.bufferSize = size;
+    }
+
+    *pSlotIndex = static_cast<uint32_t>(slotIndex);
+    return ppx::SUCCESS;
+}
+
+void FrameCapture::RecordSlotCopy(
+    grfx::CommandBuffer*         pCommandBuffer,
+    uint32_t                     slotIndex,
+    grfx::Image*                 pImage,
+    grfx::ResourceState          imageState,
+    const std::filesystem::path& path)
+{
+    Slot& slot = mSlots[slotIndex];
+
+    pCommandBuffer->TransitionImageLayout(pImage, PPX_ALL_SUBRESOURCES, imageState, grfx::RESOURCE_STATE_COPY_SRC);
+
+    grfx::ImageToBufferCopyInfo copyInfo = {};
+    copyInfo.extent                      = {pImage->GetWidth(), pImage->GetHeight(), 0};
+    grfx::ImageToBufferOutputPitch pitch = pCommandBuffer->CopyImageToBuffer(&copyInfo, pImage, slot.buffer);
+
+    pCommandBuffer->TransitionImageLayout(pImage, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_COPY_SRC, imageState);
+
+    slot.state       = SLOT_STATE_RECORDED;
+    slot.format      = pImage->GetFormat();
+    slot.width       = pImage->GetWidth();
+    slot.height      = pImage->GetHeight();
+    slot.rowPitch    = pitch.rowPitch;
+    slot.path        = path;
+    slot.writeResult = ppx::SUCCESS;
+}
+
+Result FrameCapture::RecordCopy(
+    grfx::CommandBuffer*         pCommandBuffer,
+    grfx::Image*                 pImage,
+    grfx::ResourceState          imageState,
+    const std::filesystem::path& path)
+{
+    PPX_ASSERT_NULL_ARG(pCommandBuffer);
+    PPX_ASSERT_NULL_ARG(pImage);
+    if (IsNull(mDevice)) {
+        return ppx::ERROR_FAILED;
+    }
+    if (pImage->GetType() != grfx::IMAGE_TYPE_2D) {
+        return ppx::ERROR_IMAGE_INVALID_FORMAT;
+    }
+
+    uint32_t slotIndex = 0;
+    Result   ppxres    = AcquireSlot(pImage, &slotIndex);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    RecordSlotCopy(pCommandBuffer, slotIndex, pImage, imageState, path);
+    mRecordedSlots.push_back(slotIndex);
+
+    return ppx::SUCCESS;
+}
+
+Result FrameCapture::SubmitRecordedCopies(grfx::Queue* pQueue)
+{
+    PPX_ASSERT_NULL_ARG(pQueue);
+
+    // Each slot gets a submit of its own without command buffers that only
+    // signals its fence, so every slot can be checked on its own.
+    for (uint32_t slotIndex : mRecordedSlots) {
+        Slot& slot = mSlots[slotIndex];
+
+        grfx::SubmitInfo submitInfo = {};
+        submitInfo.pFence           = slot.fence;
+        Result ppxres               = pQueue->Submit(&submitInfo);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+
+        slot.state    = SLOT_STATE_SUBMITTED;
+        slot.sequence = mNextSequence++;
+    }
+    mRecordedSlots.clear();
+
+    return ppx::SUCCESS;
+}
+
+Result FrameCapture::Capture(
+    grfx::Queue*                 pQueue,
+    grfx::Image*                 pImage,
+    grfx::ResourceState          imageState,
+    const std::filesystem::path& path)
+{
+    PPX_ASSERT_NULL_ARG(pQueue);
+    PPX_ASSERT_NULL_ARG(pImage);
+    PPX_ASSERT_MSG(mRecordedSlots.empty(), "SubmitRecordedCopies() must be called before Capture()");
+    PPX_ASSERT_MSG(IsNull(mCommandBufferQueue) || (mCommandBufferQueue == pQueue), "Capture() must always use the same queue");
+    if (IsNull(mDevice)) {
+        return ppx::ERROR_FAILED;
+    }
+    if (pImage->GetType() != grfx::IMAGE_TYPE_2D) {
+        return ppx::ERROR_IMAGE_INVALID_FORMAT;
+    }
+
+    uint32_t slotIndex = 0;
+    Result   ppxres    = AcquireSlot(pImage, &slotIndex);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    // The command buffer of a free slot is no longer in use
+    Slot& slot = mSlots[slotIndex];
+    if (!slot.commandBuffer) {
+        ppxres = pQueue->CreateCommandBuffer(&slot.commandBuffer, 0, 0);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+        mCommandBufferQueue = pQueue;
+    }
+
+    ppxres = slot.commandBuffer->Begin();
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+    RecordSlotCopy(slot.commandBuffer, slotIndex, pImage, imageState, path);
+    ppxres = slot.commandBuffer->End();
+    if (Failed(ppxres)) {
+        slot.state = SLOT_STATE_FREE;
+        return ppxres;
+    }
+
+    grfx::SubmitInfo submitInfo   = {};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.ppCommandBuffers   = &slot.commandBuffer;
+    submitInfo.pFence             = slot.fence;
+    ppxres                        = pQueue->Submit(&submitInfo);
+    if (Failed(ppxres)) {
+        slot.state = SLOT_STATE_FREE;
+        return ppxres;
+    }
+
+    slot.state    = SLOT_STATE_SUBMITTED;
+    slot.sequence = mNextSequence++;
+
+    return ppx::SUCCESS;
+}
+
+Result FrameCapture::CheckSubmitted(bool wait)
+{
+    // Hand completed copies to the encoder in submission order
+    std::vector<uint32_t> submitted;
+    {
+        std::lock_guard<std::mutex> lock(mEncoderMutex);
+        for (uint32_t i = 0; i < CountU32(mSlots); ++i) {
+            if (mSlots[i].state == SLOT_STATE_SUBMITTED) {
+                submitted.push_back(i);
+            }
+        }
+    }
+    std::sort(submitted.begin(), submitted.end(), [this](uint32_t a, uint32_t b) { return mSlots[a].sequence < mSlots[b].sequence; });
+
+    bool queued = false;
+    for (uint32_t slotIndex : submitted) {
+        Slot& slot = mSlots[slotIndex];
+
+        // Only the oldest capture is waited for
+        Result ppxres = slot.fence->Wait((wait && !queued) ? UINT64_MAX : 0);
+        if (ppxres == ppx::ERROR_WAIT_TIMED_OUT) {
+            break;
+        }
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+        slot.fence->Reset();
+
+        void* pMapped = nullptr;
+        ppxres        = slot.buffer->MapMemory(0, &pMapped);
+        if (Failed(ppxres)) {
+            slot.state = SLOT_STATE_FREE;
+            return ppxres;
+        }
+        slot.pTexels = pMapped;
+        {
+            std::lock_guard<std::mutex> lock(mEncoderMutex);
+            slot.state = SLOT_STATE_ENCODING;
+            mEncodeQueue.push_back(slotIndex);
+        }
+        queued = true;
+    }
+
+    if (queued) {
+        mEncoderCondition.notify_one();
+    }
+    return ppx::SUCCESS;
+}
+
+Result FrameCapture::RecycleWritten()
+{
+    Result result = ppx::SUCCESS;
+
+    std::lock_guard<std::mutex> lock(mEncoderMutex);
+    for (Slot& slot : mSlots) {
+        if (slot.state != SLOT_STATE_WRITTEN) {
+            continue;
+        }
+        slot.buffer->UnmapMemory();
+        slot.pTexels = nullptr;
+        slot.state   = SLOT_STATE_FREE;
+
+        if (Failed(slot.writeResult)) {
+            PPX_LOG_ERROR("failed to write frame capture " << slot.path << ": " << ToString(slot.writeResult));
+            if (result == ppx::SUCCESS) {
+                result = slot.writeResult;
+            }
+        }
+        else {
+            ++mWrittenCount;
+        }
+    }
+    return result;
+}
+
+Result FrameCapture::Poll()
+{
+    if (IsNull(mDevice)) {
+        return ppx::ERROR_FAILED;
+    }
+
+    Result ppxres = CheckSubmitted(/* wait= */ false);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+    return RecycleWritten();
+}
+
+Result FrameCapture::Flush()
+{
+    if (IsNull(mDevice)) {
+        return ppx::ERROR_FAILED;
+    }
+
+    auto isPending = [](const Slot& slot) {
+        return (slot.state == SLOT_STATE_SUBMITTED) || (slot.state == SLOT_STATE_ENCODING);
+    };
+
+    Result result = ppx::SUCCESS;
+    while (true) {
+        Result ppxres = CheckSubmitted(/* wait= */ true);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+        {
+            std::unique_lock<std::mutex> lock(mEncoderMutex);
+            mWrittenCondition.wait(lock, [this] { return mEncodeQueue.empty() && std::none_of(mSlots.begin(), mSlots.end(), [](const Slot& slot) { return slot.state == SLOT_STATE_ENCODING; }); });
+        }
+        ppxres = RecycleWritten();
+        if (Failed(ppxres) && (result == ppx::SUCCESS)) {
+            result = ppxres;
+        }
+
+        std::lock_guard<std::mutex> lock(mEncoderMutex);
+        if (std::none_of(mSlots.begin(), mSlots.end(), isPending)) {
+            break;
+        }
+    }
+    return result;
+}
+
+void FrameCapture::EncoderThreadFunc()
+{
+    while (true) {
+        uint32_t slotIndex = 0;
+        {
+            std::unique_lock<std::mutex> lock(mEncoderMutex);
+            mEncoderCondition.wait(lock, [this] { return mStopEncoder || !mEncodeQueue.empty(); });
+            if (mEncodeQueue.empty()) {
+                return;
+            }
+            slotIndex = mEncodeQueue.front();
+            mEncodeQueue.pop_front();
+        }
+
+        // The slot belongs to this thread until it is marked as written
+        Slot&  slot   = mSlots[slotIndex];
+        Result ppxres = WriteCapturedFrame(slot.path, mCreateInfo.encoding, slot.format, slot.pTexels, slot.width, slot.height, slot.rowPitch);
+
+        {
+            std::lock_guard<std::mutex> lock(mEncoderMutex);
+            slot.writeResult = ppxres;
+            slot.state       = SLOT_STATE_WRITTEN;
+        }
+        mWrittenCondition.notify_all();
+    }
+}
+
+} // namespace ppx
@@ -0,0 +1,823 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ppx/frame_graph.h"
+#include "ppx/grfx/grfx_device.h"
+#include "ppx/grfx/grfx_format.h"
+#include "ppx/grfx/grfx_image.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <queue>
+
+namespace ppx {
+
+static bool IsDepthStencilState(grfx::ResourceState state)
+{
+    switch (state) {
+        default: break;
+        case grfx::RESOURCE_STATE_DEPTH_STENCIL_READ:
+        case grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE:
+        case grfx::RESOURCE_STATE_DEPTH_WRITE_STENCIL_READ:
+        case grfx::RESOURCE_STATE_DEPTH_READ_STENCIL_WRITE:
+            return true;
+    }
+    return false;
+}
+
+static void AddImpliedUsage(grfx::ResourceState state, grfx::ImageUsageFlags& usageFlags)
+{
+    switch (state) {
+        default: break;
+        case grfx::RESOURCE_STATE_RENDER_TARGET: usageFlags.bits.colorAttachment = true; break;
+        case grfx::RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE:
+        case grfx::RESOURCE_STATE_PIXEL_SHADER_RESOURCE:
+        case grfx::RESOURCE_STATE_SHADER_RESOURCE: usageFlags.bits.sampled = true; break;
+        case grfx::RESOURCE_STATE_GENERAL:
+        case grfx::RESOURCE_STATE_UNORDERED_ACCESS: usageFlags.bits.storage = true; break;
+        case grfx::RESOURCE_STATE_COPY_SRC: usageFlags.bits.transferSrc = true; break;
+        case grfx::RESOURCE_STATE_COPY_DST: usageFlags.bits.transferDst = true; break;
+    }
+
+    if (IsDepthStencilState(state)) {
+        usageFlags.bits.depthStencilAttachment = true;
+    }
+}
+
+static bool IsSameDesc(const FrameGraphTextureDesc& a, const FrameGraphTextureDesc& b)
+{
+    return (a.width == b.width) &&
+           (a.height == b.height) &&
+           (a.format == b.format) &&
+           (a.mipLevelCount == b.mipLevelCount) &&
+           (a.arrayLayerCount == b.arrayLayerCount) &&
+           (a.usageFlags.flags == b.usageFlags.flags);
+}
+
+static uint64_t GetTextureSize(const FrameGraphTextureDesc& desc)
+{
+    const grfx::FormatDesc* pFormatDesc = grfx::GetFormatDescription(desc.format);
+
+    uint64_t size = 0;
+    for (uint32_t level = 0; level < desc.mipLevelCount; ++level) {
+        const uint64_t width  = std::max<uint32_t>(desc.width >> level, 1);
+        const uint64_t height = std::max<uint32_t>(desc.height >> level, 1);
+        size += width * height * pFormatDesc->bytesPerTexel;
+    }
+    return size * desc.arrayLayerCount;
+}
+
+static bool IsSameDrawPass(const grfx::DrawPassCreateInfo2& a, const grfx::DrawPassCreateInfo2& b)
+{
+    if ((a.width != b.width) || (a.height != b.height) || (a.renderTargetCount != b.renderTargetCount)) {
+        return false;
+    }
+    if ((a.pDepthStencilImage != b.pDepthStencilImage) || (a.depthStencilState != b.depthStencilState)) {
+        return false;
+    }
+    if (std::memcmp(&a.depthStencilClearValue, &b.depthStencilClearValue, sizeof(a.depthStencilClearValue)) != 0) {
+        return false;
+    }
+    for (uint32_t i = 0; i < a.renderTargetCount; ++i) {
+        if (a.pRenderTargetImages[i] != b.pRenderTargetImages[i]) {
+            return false;
+        }
+        if (std::memcmp(&a.renderTargetClearValues[i], &b.renderTargetClearValues[i], sizeof(a.renderTargetClearValues[i])) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+// FrameGraphPassBuilder
+// -------------------------------------------------------------------------------------------------
+FrameGraphPassBuilder& FrameGraphPassBuilder::Read(
+    FrameGraphResource  resource,
+    grfx::ResourceState state)
+{
+    mGraph->AddAccess(mPassIndex, resource, state, true, false);
+    return *this;
+}
+
+FrameGraphPassBuilder& FrameGraphPassBuilder::Write(
+    FrameGraphResource  resource,
+    grfx::ResourceState state)
+{
+    mGraph->AddAccess(mPassIndex, resource, state, false, true);
+    return *this;
+}
+
+FrameGraphPassBuilder& FrameGraphPassBuilder::SetRenderTarget(
+    uint32_t                     index,
+    FrameGraphResource           resource,
+    FrameGraphLoadOp             loadOp,
+    grfx::RenderTargetClearValue clearValue)
+{
+    PPX_ASSERT_MSG(index < PPX_MAX_RENDER_TARGETS, "render target index out of range");
+
+    FrameGraph::Pass& pass = mGraph->mPasses[mPassIndex];
+    PPX_ASSERT_MSG(index <= pass.renderTargetCount, "render targets must be set in order");
+
+    FrameGraph::Attachment& attachment = pass.renderTargets[index];
+    attachment.resource                = resource.index;
+    attachment.loadOp                  = loadOp;
+    attachment.rtvClear                = clearValue;
+    attachment.state                   = grfx::RESOURCE_STATE_RENDER_TARGET;
+    pass.renderTargetCount             = std::max(pass.renderTargetCount, index + 1);
+
+    mGraph->AddAccess(mPassIndex, resource, attachment.state, (loadOp == FRAME_GRAPH_LOAD_OP_LOAD), true);
+    return *this;
+}
+
+FrameGraphPassBuilder& FrameGraphPassBuilder::SetDepthStencil(
+    FrameGraphResource           resource,
+    FrameGraphLoadOp             loadOp,
+    grfx::DepthStencilClearValue clearValue,
+    grfx::ResourceState          state)
+{
+    PPX_ASSERT_MSG(IsDepthStencilState(state), "depth stencil attachment requires a depth stencil state");
+
+    FrameGraph::Pass&       pass       = mGraph->mPasses[mPassIndex];
+    FrameGraph::Attachment& attachment = pass.depthStencil;
+    attachment.resource                = resource.index;
+    attachment.loadOp                  = loadOp;
+    attachment.dsvClear                = clearValue;
+    attachment.state                   = state;
+
+    // A read-only depth stencil does not produce anything new
+    const bool write = (state != grfx::RESOURCE_STATE_DEPTH_STENCIL_READ) || (loadOp == FRAME_GRAPH_LOAD_OP_CLEAR);
+    mGraph->AddAccess(mPassIndex, resource, state, (loadOp == FRAME_GRAPH_LOAD_OP_LOAD), write);
+    return *this;
+}
+
+FrameGraphPassBuilder& FrameGraphPassBuilder::SetSideEffect()
+{
+    mGraph->mPasses[mPassIndex].sideEffect = true;
+    return *this;
+}
+
+// -------------------------------------------------------------------------------------------------
+// FrameGraphPassContext
+// -------------------------------------------------------------------------------------------------
+grfx::Texture* FrameGraphPassContext::GetTexture(FrameGraphResource resource) const
+{
+    return mGraph->GetTexture(resource);
+}
+
+grfx::Image* FrameGraphPassContext::GetImage(FrameGraphResource resource) const
+{
+    return mGraph->GetImage(resource);
+}
+
+// -------------------------------------------------------------------------------------------------
+// FrameGraph
+// -------------------------------------------------------------------------------------------------
+Result FrameGraph::Initialize(grfx::Device* pDevice)
+{
+    PPX_ASSERT_NULL_ARG(pDevice);
+    if (!IsNull(mDevice)) {
+        return ppx::ERROR_SINGLE_INIT_ONLY;
+    }
+
+    mDevice = pDevice;
+    return ppx::SUCCESS;
+}
+
+void FrameGraph::Shutdown()
+{
+    Reset();
+
+    if (IsNull(mDevice)) {
+        return;
+    }
+
+    for (auto& elem : mDrawPasses) {
+        mDevice->DestroyDrawPass(elem.drawPass);
+    }
+    mDrawPasses.clear();
+
+    for (auto& elem : mPhysicalTextures) {
+        if (elem.texture) {
+            mDevice->DestroyTexture(elem.texture);
+        }
+    }
+    mPhysicalTextures.clear();
+
+    mDevice = nullptr;
+}
+
+void FrameGraph::Reset()
+{
+    mPasses.clear();
+    mExecutionOrder.clear();
+    mResources.clear();
+    mCompiled = false;
+}
+
+FrameGraphResource FrameGraph::ImportTexture(
+    const std::string&  name,
+    grfx::Texture*      pTexture,
+    grfx::ResourceState finalState)
+{
+    PPX_ASSERT_NULL_ARG(pTexture);
+
+    FrameGraphResource handle = ImportImage(name, pTexture->GetImage(), finalState);
+    mResources[handle.index].pTexture = pTexture;
+    return handle;
+}
+
+FrameGraphResource FrameGraph::ImportImage(
+    const std::string&  name,
+    grfx::Image*        pImage,
+    grfx::ResourceState finalState)
+{
+    PPX_ASSERT_NULL_ARG(pImage);
+
+    Resource resource   = {};
+    resource.name       = name;
+    resource.imported   = true;
+    resource.pImage     = pImage;
+    resource.finalState = finalState;
+    mResources.push_back(resource);
+
+    FrameGraphResource handle = {};
+    handle.index              = CountU32(mResources) - 1;
+    mCompiled                 = false;
+    return handle;
+}
+
+FrameGraphResource FrameGraph::CreateTexture(const std::string& name, const FrameGraphTextureDesc& desc)
+{
+    PPX_ASSERT_MSG((desc.width > 0) && (desc.height > 0), "transient texture " << name << " has zero size");
+    PPX_ASSERT_MSG(desc.format != grfx::FORMAT_UNDEFINED, "transient texture " << name << " has no format");
+
+    Resource resource = {};
+    resource.name     = name;
+    resource.desc     = desc;
+    mResources.push_back(resource);
+
+    FrameGraphResource handle = {};
+    handle.index              = CountU32(mResources) - 1;
+    mCompiled                 = false;
+    return handle;
+}
+
+FrameGraphPassBuilder FrameGraph::AddPass(
+    const std::string&  name,
+    FrameGraphPassType  type,
+    FrameGraphExecuteFn executeFn)
+{
+    Pass pass      = {};
+    pass.name      = name;
+    pass.type      = type;
+    pass.executeFn = executeFn;
+    mPasses.push_back(pass);
+
+    mCompiled = false;
+    return FrameGraphPassBuilder(this, CountU32(mPasses) - 1);
+}
+
+void FrameGraph::AddAccess(uint32_t passIndex, FrameGraphResource resource, grfx::ResourceState state, bool read, bool write)
+{
+    PPX_ASSERT_MSG(resource.index < mResources.size(), "invalid frame graph resource");
+
+    Pass& pass = mPasses[passIndex];
+
+    // Declaring a resource twice merges the accesses, the last state wins
+    auto it = std::find_if(
+        pass.accesses.begin(),
+        pass.accesses.end(),
+        [resource](const Access& elem) { return elem.resource == resource.index; });
+
+    if (it != pass.accesses.end()) {
+        it->state = (state != grfx::RESOURCE_STATE_UNDEFINED) ? state : it->state;
+        it->read  = it->read || read;
+        it->write = it->write || write;
+        return;
+    }
+
+    Access access   = {};
+    access.resource = resource.index;
+    access.state    = state;
+    access.read     = read;
+    access.write    = write;
+    pass.accesses.push_back(access);
+
+    mCompiled = false;
+}
+
+Result FrameGraph::SortPasses()
+{
+    const uint32_t passCount = CountU32(mPasses);
+
+    std::vector<std::vector<uint32_t>> successors(passCount);
+    std::vector<uint32_t>              predecessorCounts(passCount, 0);
+
+    auto addEdge = [&successors, &predecessorCounts](uint32_t from, uint32_t to) {
+        if ((from == to) || (std::find(successors[from].begin(), successors[from].end(), to) != successors[from].end())) {
+            return;
+        }
+        successors[from].push_back(to);
+        predecessorCounts[to] += 1;
+    };
+
+    // Walk the accesses in declaration order to tell which write each read
+    // sees, see FrameGraphPassBuilder. Writes stay in declaration order and
+    // come after the reads of the content they overwrite.
+    struct Dependencies
+    {
+        uint32_t              lastWriter = UINT32_MAX;
+        std::vector<uint32_t> readers;
+        std::vector<uint32_t> earlyReaders;
+        std::vector<uint32_t> writers;
+    };
+
+    std::vector<Dependencies> dependencies(mResources.size());
+    for (uint32_t passIndex = 0; passIndex < passCount; ++passIndex) {
+        for (const Access& access : mPasses[passIndex].accesses) {
+            Dependencies& deps = dependencies[access.resource];
+            if (access.read) {
+                if (deps.lastWriter != UINT32_MAX) {
+                    addEdge(deps.lastWriter, passIndex);
+                    deps.readers.push_back(passIndex);
+                }
+                else if (mResources[access.resource].imported) {
+                    deps.readers.push_back(passIndex);
+                }
+                else {
+                    deps.earlyReaders.push_back(passIndex);
+                }
+            }
+            if (access.write) {
+                if (deps.lastWriter != UINT32_MAX) {
+                    addEdge(deps.lastWriter, passIndex);
+                }
+                for (uint32_t reader : deps.readers) {
+                    addEdge(reader, passIndex);
+                }
+                deps.readers.clear();
+                deps.lastWriter = passIndex;
+                deps.writers.push_back(passIndex);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < dependencies.size(); ++i) {
+        const Dependencies& deps = dependencies[i];
+        if (deps.earlyReaders.empty()) {
+            continue;
+        }
+        if (deps.writers.empty()) {
+            PPX_LOG_ERROR("frame graph pass " << mPasses[deps.earlyReaders[0]].name << " reads " << mResources[i].name << " but no pass writes it");
+            return ppx::ERROR_FAILED;
+        }
+        for (uint32_t reader : deps.earlyReaders) {
+            for (uint32_t writer : deps.writers) {
+                addEdge(writer, reader);
+            }
+        }
+    }
+
+    // Kahn's algorithm, always taking the earliest declared ready pass
+    std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> ready;
+    for (uint32_t passIndex = 0; passIndex < passCount; ++passIndex) {
+        if (predecessorCounts[passIndex] == 0) {
+            ready.push(passIndex);
+        }
+    }
+
+    mExecutionOrder.clear();
+    while (!ready.empty()) {
+        const uint32_t passIndex = ready.top();
+        ready.pop();
+        mExecutionOrder.push_back(passIndex);
+
+        for (uint32_t successor : successors[passIndex]) {
+            predecessorCounts[successor] -= 1;
+            if (predecessorCounts[successor] == 0) {
+                ready.push(successor);
+            }
+        }
+    }
+
+    if (mExecutionOrder.size() != mPasses.size()) {
+        auto it = std::find_if(predecessorCounts.begin(), predecessorCounts.end(), [](uint32_t count) { return count > 0; });
+        PPX_LOG_ERROR("frame graph pass " << mPasses[it - predecessorCounts.begin()].name << " is part of a dependency cycle");
+        mExecutionOrder.clear();
+        return ppx::ERROR_FAILED;
+    }
+
+    return ppx::SUCCESS;
+}
+
+void FrameGraph::CullPasses()
+{
+    // Walk backwards: a pass survives if it has side effects or writes
+    // something a surviving later pass reads. Imported resources are always
+    // needed since they are observed outside the graph.
+    std::vector<bool> needed(mResources.size(), false);
+    for (size_t i = 0; i < mResources.size(); ++i) {
+        needed[i] = mResources[i].imported;
+    }
+
+    for (auto it = mExecutionOrder.rbegin(); it != mExecutionOrder.rend(); ++it) {
+        Pass& pass  = mPasses[*it];
+        pass.culled = !pass.sideEffect;
+        for (const Access& access : pass.accesses) {
+            if (access.write && needed[access.resource]) {
+                pass.culled = false;
+                break;
+            }
+        }
+
+        if (pass.culled) {
+            continue;
+        }
+
+        for (const Access& access : pass.accesses) {
+            if (access.read) {
+                needed[access.resource] = true;
+            }
+        }
+    }
+}
+
+void FrameGraph::ComputeLifetimes()
+{
+    for (Resource& resource : mResources) {
+        resource.firstPass    = UINT32_MAX;
+        resource.lastPass     = 0;
+        resource.initialState = grfx::RESOURCE_STATE_UNDEFINED;
+        resource.physical     = UINT32_MAX;
+        if (!resource.imported) {
+            resource.pTexture = nullptr;
+            resource.pImage   = nullptr;
+        }
+    }
+
+    const uint32_t passCount = CountU32(mExecutionOrder);
+    for (uint32_t position = 0; position < passCount; ++position) {
+        const Pass& pass = mPasses[mExecutionOrder[position]];
+        if (pass.culled) {
+            continue;
+        }
+
+        for (const Access& access : pass.accesses) {
+            Resource& resource = mResources[access.resource];
+            resource.firstPass = std::min(resource.firstPass, position);
+            resource.lastPass  = std::max(resource.lastPass, position);
+
+            if (resource.imported) {
+                continue;
+            }
+
+            AddImpliedUsage(access.state, resource.desc.usageFlags);
+            if (resource.initialState == grfx::RESOURCE_STATE_UNDEFINED) {
+                resource.initialState = access.state;
+            }
+        }
+    }
+}
+
+void FrameGraph::AssignPhysicalTextures()
+{
+    for (PhysicalTexture& physical : mPhysicalTextures) {
+        physical.used      = false;
+        physical.freeAfter = 0;
+    }
+
+    // Greedy interval assignment: visiting resources by first use lets a
+    // texture be handed to the next resource as soon as the previous one
+    // holding it is dead.
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < CountU32(mResources); ++i) {
+        const Resource& resource = mResources[i];
+        if (!resource.imported && (resource.firstPass != UINT32_MAX)) {
+            order.push_back(i);
+        }
+    }
+    std::stable_sort(
+        order.begin(),
+        order.end(),
+        [this](uint32_t a, uint32_t b) { return mResources[a].firstPass < mResources[b].firstPass; });
+
+    for (uint32_t index : order) {
+        Resource& resource = mResources[index];
+
+        auto it = std::find_if(
+            mPhysicalTextures.begin(),
+            mPhysicalTextures.end(),
+            [&resource](const PhysicalTexture& elem) {
+                return IsSameDesc(elem.desc, resource.desc) && (!elem.used || (elem.freeAfter < resource.firstPass));
+            });
+
+        // Textures are created by CreatePhysicalTextures()
+        if (it == mPhysicalTextures.end()) {
+            PhysicalTexture physical = {};
+            physical.desc            = resource.desc;
+            physical.initialState    = resource.initialState;
+            if (physical.initialState == grfx::RESOURCE_STATE_UNDEFINED) {
+                physical.initialState = grfx::RESOURCE_STATE_GENERAL;
+            }
+
+            mPhysicalTextures.push_back(physical);
+            it = mPhysicalTextures.end() - 1;
+        }
+
+        it->used          = true;
+        it->freeAfter     = resource.lastPass;
+        resource.physical = static_cast<uint32_t>(it - mPhysicalTextures.begin());
+
+        mStats.unaliasedTransientMemorySize += GetTextureSize(resource.desc);
+    }
+
+    for (const PhysicalTexture& physical : mPhysicalTextures) {
+        if (physical.used) {
+            mStats.physicalTextureCount += 1;
+            mStats.transientMemorySize += GetTextureSize(physical.desc);
+        }
+    }
+    mStats.transientResourceCount = CountU32(order);
+}
+
+Result FrameGraph::CreatePhysicalTextures()
+{
+    for (PhysicalTexture& physical : mPhysicalTextures) {
+        if (!physical.used || physical.texture) {
+            continue;
+        }
+
+        grfx::TextureCreateInfo createInfo = {};
+        createInfo.imageType               = grfx::IMAGE_TYPE_2D;
+        createInfo.width                   = physical.desc.width;
+        createInfo.height                  = physical.desc.height;
+        createInfo.depth                   = 1;
+        createInfo.imageFormat             = physical.desc.format;
+        createInfo.sampleCount             = grfx::SAMPLE_COUNT_1;
+        createInfo.mipLevelCount           = physical.desc.mipLevelCount;
+        createInfo.arrayLayerCount         = physical.desc.arrayLayerCount;
+        createInfo.usageFlags              = physical.desc.usageFlags;
+        createInfo.memoryUsage             = grfx::MEMORY_USAGE_GPU_ONLY;
+        createInfo.initialState            = physical.initialState;
+
+        Result ppxres = mDevice->CreateTexture(&createInfo, &physical.texture);
+        if (Failed(ppxres)) {
+            PPX_ASSERT_MSG(false, "failed creating frame graph texture");
+            return ppxres;
+        }
+    }
+
+    for (Resource& resource : mResources) {
+        if (resource.physical == UINT32_MAX) {
+            continue;
+        }
+        const PhysicalTexture& physical = mPhysicalTextures[resource.physical];
+        resource.pTexture               = physical.texture;
+        resource.pImage                 = physical.texture->GetImage();
+    }
+
+    return ppx::SUCCESS;
+}
+
+Result FrameGraph::AssignDrawPasses()
+{
+    for (CachedDrawPass& cached : mDrawPasses) {
+        cached.used = false;
+    }
+
+    for (Pass& pass : mPasses) {
+        pass.pDrawPass = nullptr;
+
+        const bool hasDepthStencil = (pass.depthStencil.resource != UINT32_MAX);
+        if (pass.culled || ((pass.renderTargetCount == 0) && !hasDepthStencil)) {
+            continue;
+        }
+
+        grfx::DrawPassCreateInfo2 createInfo = {};
+        createInfo.renderTargetCount         = pass.renderTargetCount;
+        for (uint32_t i = 0; i < pass.renderTargetCount; ++i) {
+            const Attachment& attachment = pass.renderTargets[i];
+            PPX_ASSERT_MSG(attachment.resource != UINT32_MAX, "render target " << i << " of pass " << pass.name << " is not set");
+            PPX_ASSERT_MSG(attachment.loadOp == pass.renderTargets[0].loadOp, "render targets of pass " << pass.name << " must share a load op");
+
+            createInfo.pRenderTargetImages[i]     = mResources[attachment.resource].pImage;
+            createInfo.renderTargetClearValues[i] = attachment.rtvClear;
+        }
+        if (hasDepthStencil) {
+            createInfo.pDepthStencilImage     = mResources[pass.depthStencil.resource].pImage;
+            createInfo.depthStencilState      = pass.depthStencil.state;
+            createInfo.depthStencilClearValue = pass.depthStencil.dsvClear;
+        }
+
+        const grfx::Image* pSizeImage = (pass.renderTargetCount > 0) ? createInfo.pRenderTargetImages[0] : createInfo.pDepthStencilImage;
+        createInfo.width              = pSizeImage->GetWidth();
+        createInfo.height             = pSizeImage->GetHeight();
+
+        auto it = std::find_if(
+            mDrawPasses.begin(),
+            mDrawPasses.end(),
+            [&createInfo](const CachedDrawPass& elem) { return IsSameDrawPass(elem.createInfo, createInfo); });
+
+        if (it == mDrawPasses.end()) {
+            CachedDrawPass cached = {};
+            cached.createInfo     = createInfo;
+
+            Result ppxres = mDevice->CreateDrawPass(&createInfo, &cached.drawPass);
+            if (Failed(ppxres)) {
+                PPX_ASSERT_MSG(false, "failed creating draw pass for frame graph pass " << pass.name);
+                return ppxres;
+            }
+
+            mDrawPasses.push_back(cached);
+            it = mDrawPasses.end() - 1;
+        }
+
+        it->used       = true;
+        pass.pDrawPass = it->drawPass;
+    }
+
+    return ppx::SUCCESS;
+}
+
+Result FrameGraph::Schedule()
+{
+    mStats           = {};
+    mStats.passCount = CountU32(mPasses);
+    mCompiled        = false;
+
+    Result ppxres = SortPasses();
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    CullPasses();
+    for (const Pass& pass : mPasses) {
+        mStats.culledPassCount += pass.culled ? 1 : 0;
+    }
+
+    ComputeLifetimes();
+    AssignPhysicalTextures();
+
+    return ppx::SUCCESS;
+}
+
+Result FrameGraph::Compile()
+{
+    PPX_ASSERT_MSG(!IsNull(mDevice), "frame graph is not initialized");
+
+    Result ppxres = Schedule();
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    ppxres = CreatePhysicalTextures();
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    ppxres = AssignDrawPasses();
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    mCompiled = true;
+    return ppx::SUCCESS;
+}
+
+void FrameGraph::RequireAccessStates(grfx::CommandBuffer* pCommandBuffer, const Pass& pass) const
+{
+    for (const Access& access : pass.accesses) {
+        if (access.state == grfx::RESOURCE_STATE_UNDEFINED) {
+            continue;
+        }
+        pCommandBuffer->RequireResourceState(mResources[access.resource].pImage, PPX_ALL_SUBRESOURCES, access.state);
+    }
+}
+
+void FrameGraph::Execute(grfx::CommandBuffer* pCommandBuffer)
+{
+    PPX_ASSERT_NULL_ARG(pCommandBuffer);
+    PPX_ASSERT_MSG(mCompiled, "frame graph must be compiled before it is executed");
+    PPX_ASSERT_MSG(pCommandBuffer->IsResourceStateTrackingEnabled(), "frame graph requires resource state tracking on the command buffer");
+
+    for (uint32_t passIndex : mExecutionOrder) {
+        const Pass& pass = mPasses[passIndex];
+        if (pass.culled) {
+            continue;
+        }
+
+        // Barriers for every pass are only requested here; the tracker
+        // defers them until the next render pass, dispatch or copy.
+        RequireAccessStates(pCommandBuffer, pass);
+
+        FrameGraphPassContext context(this, pCommandBuffer, pass.pDrawPass);
+        if (IsNull(pass.pDrawPass)) {
+            if (pass.executeFn) {
+                pass.executeFn(context);
+            }
+            continue;
+        }
+
+        grfx::DrawPassClearFlags clearFlags = 0;
+        if ((pass.renderTargetCount > 0) && (pass.renderTargets[0].loadOp == FRAME_GRAPH_LOAD_OP_CLEAR)) {
+            clearFlags = clearFlags | grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_RENDER_TARGETS;
+        }
+        if ((pass.depthStencil.resource != UINT32_MAX) && (pass.depthStencil.loadOp == FRAME_GRAPH_LOAD_OP_CLEAR)) {
+            clearFlags = clearFlags | grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_DEPTH | grfx::DRAW_PASS_CLEAR_FLAG_CLEAR_STENCIL;
+        }
+
+        pCommandBuffer->BeginRenderPass(pass.pDrawPass, clearFlags);
+        pCommandBuffer->SetScissors(pass.pDrawPass->GetScissor());
+        pCommandBuffer->SetViewports(pass.pDrawPass->GetViewport());
+        if (pass.executeFn) {
+            pass.executeFn(context);
+        }
+        pCommandBuffer->EndRenderPass();
+    }
+
+    for (const Resource& resource : mResources) {
+        if (resource.imported && (resource.finalState != grfx::RESOURCE_STATE_UNDEFINED)) {
+            pCommandBuffer->RequireResourceState(resource.pImage, PPX_ALL_SUBRESOURCES, resource.finalState);
+        }
+    }
+}
+
+void FrameGraph::ReleaseUnusedResources()
+{
+    if (IsNull(mDevice)) {
+        return;
+    }
+
+    // Draw passes go first, they reference the textures
+    for (auto it = mDrawPasses.begin(); it != mDrawPasses.end();) {
+        if (!it->used) {
+            mDevice->DestroyDrawPass(it->drawPass);
+            it = mDrawPasses.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    for (auto it = mPhysicalTextures.begin(); it != mPhysicalTextures.end();) {
+        if (!it->used) {
+            if (it->texture) {
+                mDevice->DestroyTexture(it->texture);
+            }
+            it = mPhysicalTextures.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+bool FrameGraph::IsPassCulled(const std::string& name) const
+{
+    auto it = std::find_if(
+        mPasses.begin(),
+        mPasses.end(),
+        [&name](const Pass& elem) { return elem.name == name; });
+
+    PPX_ASSERT_MSG(it != mPasses.end(), "unknown frame graph pass " << name);
+    return it->culled;
+}
+
+uint32_t FrameGraph::GetPassExecutionIndex(const std::string& name) const
+{
+    for (uint32_t position = 0; position < CountU32(mExecutionOrder); ++position) {
+        if (mPasses[mExecutionOrder[position]].name == name) {
+            return position;
+        }
+    }
+
+    PPX_ASSERT_MSG(false, "unknown or unscheduled frame graph pass " << name);
+    return UINT32_MAX;
+}
+
+grfx::Texture* FrameGraph::GetTexture(FrameGraphResource resource) const
+{
+    PPX_ASSERT_MSG(resource.index < mResources.size(), "invalid frame graph resource");
+    return mResources[resource.index].pTexture;
+}
+
+grfx::Image* FrameGraph::GetImage(FrameGraphResource resource) const
+{
+    PPX_ASSERT_MSG(resource.index < mResources.size(), "invalid frame graph resource");
+    return mResources[resource.index].pImage;
+}
+
+} // namespace ppx
@@ -19,6 +19,23 @@
 #include <vector>
 #include <optional>
 
+// clang-format off
+#if defined(PPX_MSW)
+#   if ! defined(VC_EXTRALEAN)
+#       define VC_EXTRALEAN
+#   endif
+#   if ! defined(WIN32_LEAN_AND_MEAN)
+#   define WIN32_LEAN_AND_MEAN
+#   endif
+#   include <Windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+// clang-format on
+
 #if defined(PPX_ANDROID)
 #include <android_native_app_glue.h>
 android_app* gAndroidContext;
@@ -51,6 +68,13 @@ File::~File()
         case STREAM_HANDLE:
             mStream.close();
             break;
+        case MAPPED_HANDLE:
+#if defined(PPX_MSW)
+            UnmapViewOfFile(mBuffer);
+#else
+            munmap(const_cast<void*>(mBuffer), mFileSize);
+#endif
+            break;
         default:
             break;
     }
@@ -82,11 +106,68 @@ bool File::Open(const std::filesystem::path& path)
     return true;
 }
 
+bool File::OpenMapped(const std::filesystem::path& path)
+{
+#if defined(PPX_ANDROID)
+    // Assets are already mapped by the asset manager.
+    if (!path.is_absolute()) {
+        return Open(path);
+    }
+#endif
+
+    const void* pMapped = nullptr;
+    size_t      size    = 0;
+
+#if defined(PPX_MSW)
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER fileSize = {};
+        if (GetFileSizeEx(file, &fileSize) && (fileSize.QuadPart > 0)) {
+            HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping != nullptr) {
+                pMapped = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                size    = static_cast<size_t>(fileSize.QuadPart);
+                // The view keeps the mapping object alive.
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat info = {};
+        if ((fstat(fd, &info) == 0) && (info.st_size > 0)) {
+            void* pData = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (pData != MAP_FAILED) {
+                pMapped = pData;
+                size    = static_cast<size_t>(info.st_size);
+            }
+        }
+        // The mapping keeps its own reference to the file.
+        close(fd);
+    }
+#endif
+
+    if (pMapped == nullptr) {
+        return Open(path);
+    }
+
+    mHandleType = MAPPED_HANDLE;
+    mBuffer     = pMapped;
+    mFileSize   = size;
+    mFileOffset = 0;
+    return true;
+}
+
 bool File::IsValid() const
 {
     if (mHandleType == STREAM_HANDLE) {
         return mStream.good();
     }
+    if (mHandleType == MAPPED_HANDLE) {
+        return mBuffer != nullptr;
+    }
     return mHandleType == ASSET_HANDLE && mAsset != nullptr;
 }
 
@@ -16,7 +16,10 @@
 #include "ppx/generate_mip_shader_DX.h"
 #include "ppx/graphics_util.h"
 #include "ppx/bitmap.h"
+#include "ppx/cube_map.h"
 #include "ppx/fs.h"
+#include "ppx/job_system.h"
+#include "ppx/mip_generator.h"
 #include "ppx/mipmap.h"
 #include "ppx/timer.h"
 #include "ppx/grfx/grfx_buffer.h"
@@ -36,22 +39,26 @@ grfx::Format ToGrfxFormat(Bitmap::Format value)
     // clang-format off
     switch (value) {
         default: break;
-        case Bitmap::FORMAT_R_UINT8     : return grfx::FORMAT_R8_UNORM; break;
-        case Bitmap::FORMAT_RG_UINT8    : return grfx::FORMAT_R8G8_UNORM; break;
-        case Bitmap::FORMAT_RGB_UINT8   : return grfx::FORMAT_R8G8B8_UNORM; break;
-        case Bitmap::FORMAT_RGBA_UINT8  : return grfx::FORMAT_R8G8B8A8_UNORM; break;
-        case Bitmap::FORMAT_R_UINT16    : return grfx::FORMAT_R16_UNORM; break;
-        case Bitmap::FORMAT_RG_UINT16   : return grfx::FORMAT_R16G16_UNORM; break;
-        case Bitmap::FORMAT_RGB_UINT16  : return grfx::FORMAT_R16G16B16_UNORM; break;
-        case Bitmap::FORMAT_RGBA_UINT16 : return grfx::FORMAT_R16G16B16A16_UNORM; break;
-        //case Bitmap::FORMAT_R_UINT32    : return grfx::FORMAT_R32_UNORM; break;
-        //case Bitmap::FORMAT_RG_UINT32   : return grfx::FORMAT_R32G32_UNORM; break;
-        //case Bitmap::FORMAT_RGB_UINT32  : return grfx::FORMAT_R32G32B32_UNORM; break;
-        //case Bitmap::FORMAT_RGBA_UINT32 : return grfx::FORMAT_R32G32B32A32_UNORM; break;
-        case Bitmap::FORMAT_R_FLOAT     : return grfx::FORMAT_R32_FLOAT; break;
-        case Bitmap::FORMAT_RG_FLOAT    : return grfx::FORMAT_R32G32_FLOAT; break;
-        case Bitmap::FORMAT_RGB_FLOAT   : return grfx::FORMAT_R32G32B32_FLOAT; break;
-        case Bitmap::FORMAT_RGBA_FLOAT  : return grfx::FORMAT_R32G32B32A32_FLOAT; break;
+        case Bitmap::FORMAT_R_UINT8      : return grfx::FORMAT_R8_UNORM; break;
+        case Bitmap::FORMAT_RG_UINT8     : return grfx::FORMAT_R8G8_UNORM; break;
+        case Bitmap::FORMAT_RGB_UINT8    : return grfx::FORMAT_R8G8B8_UNORM; break;
+        case Bitmap::FORMAT_RGBA_UINT8   : return grfx::FORMAT_R8G8B8A8_UNORM; break;
+        case Bitmap::FORMAT_R_UINT16     : return grfx::FORMAT_R16_UNORM; break;
+        case Bitmap::FORMAT_RG_UINT16    : return grfx::FORMAT_R16G16_UNORM; break;
+        case Bitmap::FORMAT_RGB_UINT16   : return grfx::FORMAT_R16G16B16_UNORM; break;
+        case Bitmap::FORMAT_RGBA_UINT16  : return grfx::FORMAT_R16G16B16A16_UNORM; break;
+        //case Bitmap::FORMAT_R_UINT32     : return grfx::FORMAT_R32_UNORM; break;
+        //case Bitmap::FORMAT_RG_UINT32    : return grfx::FORMAT_R32G32_UNORM; break;
+        //case Bitmap::FORMAT_RGB_UINT32   : return grfx::FORMAT_R32G32B32_UNORM; break;
+        //case Bitmap::FORMAT_RGBA_UINT32  : return grfx::FORMAT_R32G32B32A32_UNORM; break;
+        case Bitmap::FORMAT_R_FLOAT      : return grfx::FORMAT_R32_FLOAT; break;
+        case Bitmap::FORMAT_RG_FLOAT     : return grfx::FORMAT_R32G32_FLOAT; break;
+        case Bitmap::FORMAT_RGB_FLOAT    : return grfx::FORMAT_R32G32B32_FLOAT; break;
+        case Bitmap::FORMAT_RGBA_FLOAT   : return grfx::FORMAT_R32G32B32A32_FLOAT; break;
+        case Bitmap::FORMAT_R_FLOAT16    : return grfx::FORMAT_R16_FLOAT; break;
+        case Bitmap::FORMAT_RG_FLOAT16   : return grfx::FORMAT_R16G16_FLOAT; break;
+        case Bitmap::FORMAT_RGB_FLOAT16  : return grfx::FORMAT_R16G16B16_FLOAT; break;
+        case Bitmap::FORMAT_RGBA_FLOAT16 : return grfx::FORMAT_R16G16B16A16_FLOAT; break;
     }
     // clang-format on
     return grfx::FORMAT_UNDEFINED;
@@ -238,8 +245,9 @@ Result CreateImageFromBitmap(
         SCOPED_DESTROYER.AddObject(targetImage);
     }
 
-    // Since this mipmap is temporary, it's safe to use the static pool.
-    Mipmap mipmap = Mipmap(*pBitmap, mipLevelCount, /* useStaticPool= */ true);
+    // Since this mipmap is temporary, it's safe to use the static pool. Level 0
+    // references the bitmap's pixels so only the smaller levels are allocated.
+    Mipmap mipmap = Mipmap(pBitmap->GetView(), mipLevelCount, /* useStaticPool= */ true);
     if (!mipmap.IsOk()) {
         return ppx::ERROR_FAILED;
     }
@@ -806,9 +814,9 @@ Result CreateImageFromFile(
 
     Result ppxres;
     if (Bitmap::IsBitmapFile(path)) {
-        // Load bitmap
+        // Load bitmap, the GPU mip generation path writes RGBA storage images so it keeps the default format
         Bitmap bitmap;
-        ppxres = Bitmap::LoadFile(path, &bitmap);
+        ppxres = Bitmap::LoadFile(path, &bitmap, useGpu ? BitmapLoadOptions() : options.mLoadOptions);
         if (Failed(ppxres)) {
             return ppxres;
         }
@@ -875,11 +883,77 @@ Result CopyBitmapToTexture(
 
 // -------------------------------------------------------------------------------------------------
 
-Result CreateTextureFromBitmap(
-    grfx::Queue*          pQueue,
-    const Bitmap*         pBitmap,
-    grfx::Texture**       ppTexture,
-    const TextureOptions& options)
+static bool CanCompressTexture(grfx::Format format, uint32_t width, uint32_t height)
+{
+    if (format == grfx::FORMAT_UNDEFINED) {
+        return false;
+    }
+    if (!IsBlockCompressionSupported(format)) {
+        PPX_LOG_WARN("block compression format " << static_cast<uint32_t>(format) << " is not supported by the encoder, texture will not be compressed");
+        return false;
+    }
+    // D3D12 requires the base level of block compressed textures to be block aligned
+    if (((width % 4) != 0) || ((height % 4) != 0)) {
+        PPX_LOG_WARN("texture size " << width << "x" << height << " is not a multiple of 4, texture will not be compressed");
+        return false;
+    }
+    return true;
+}
+
+static Result CreateCompressedTextureFromMipmap(
+    grfx::Queue*                 pQueue,
+    const Mipmap&                mipmap,
+    grfx::Format                 format,
+    const std::filesystem::path& cacheDirectory,
+    JobSystem*                   pJobSystem,
+    grfx::Texture**              ppTexture,
+    const TextureOptions&        options)
+{
+    CompressedMipmap compressed;
+    Result           ppxres = CompressMipmapCached(mipmap, format, cacheDirectory, &compressed, pJobSystem);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+    return CreateTextureFromCompressedMipmap(pQueue, &compressed, ppTexture, options);
+}
+
+// Returns pMipGenerator, or the default generator of pQueue's device if
+// pMipGenerator is null. Null if GPU mips are disabled.
+static MipGenerator* SelectMipGenerator(grfx::Queue* pQueue, bool gpuMips, MipGenerator* pMipGenerator)
+{
+    if (!gpuMips) {
+        return nullptr;
+    }
+    return IsNull(pMipGenerator) ? pQueue->GetDevice()->GetDefaultMipGenerator() : pMipGenerator;
+}
+
+// Returns the selected generator if it can build the mips of a texture
+// created on pQueue's device with the given format.
+static MipGenerator* GetTextureMipGenerator(grfx::Queue* pQueue, grfx::Format format, uint32_t mipLevelCount, bool gpuMips, MipGenerator* pMipGenerator)
+{
+    pMipGenerator = SelectMipGenerator(pQueue, gpuMips, pMipGenerator);
+    if (IsNull(pMipGenerator) || (mipLevelCount < 2)) {
+        return nullptr;
+    }
+    if (pMipGenerator->GetDevice() != pQueue->GetDevice()) {
+        PPX_LOG_WARN("mip generator belongs to another device, mips will be built on the CPU");
+        return nullptr;
+    }
+    if (!pMipGenerator->IsFormatSupported(format)) {
+        return nullptr;
+    }
+    return pMipGenerator;
+}
+
+// Creates the texture and uploads its mips. When pDeferredMips is not null,
+// mips that are built on the GPU are queued in it instead of generated, so
+// the caller can build the mips of many textures with a single submit.
+Result CreateTextureFromBitmapImpl(
+    grfx::Queue*                    pQueue,
+    const Bitmap*                   pBitmap,
+    grfx::Texture**                 ppTexture,
+    const TextureOptions&           options,
+    std::vector<MipGeneratorImage>* pDeferredMips)
 {
     PPX_ASSERT_NULL_ARG(pQueue);
     PPX_ASSERT_NULL_ARG(pBitmap);
@@ -894,6 +968,17 @@ Result CreateTextureFromBitmap(
     uint32_t maxMipLevelCount = Mipmap::CalculateLevelCount(pBitmap->GetWidth(), pBitmap->GetHeight());
     uint32_t mipLevelCount    = std::min<uint32_t>(options.mMipLevelCount, maxMipLevelCount);
 
+    if (CanCompressTexture(options.mCompressFormat, pBitmap->GetWidth(), pBitmap->GetHeight())) {
+        Mipmap mipmap = Mipmap(pBitmap->GetView(), mipLevelCount, /* useStaticPool= */ true);
+        if (!mipmap.IsOk()) {
+            return ppx::ERROR_FAILED;
+        }
+        return CreateCompressedTextureFromMipmap(pQueue, mipmap, options.mCompressFormat, options.mCompressionCacheDirectory, options.mCompressionJobSystem, ppTexture, options);
+    }
+
+    grfx::Format  format        = ToGrfxFormat(pBitmap->GetFormat());
+    MipGenerator* pMipGenerator = GetTextureMipGenerator(pQueue, format, mipLevelCount, options.mGpuMips, options.mGpuMipGenerator);
+
     // Create target texture
     grfx::TexturePtr targetTexture;
     {
@@ -903,7 +988,7 @@ Result CreateTextureFromBitmap(
         ci.width                       = pBitmap->GetWidth();
         ci.height                      = pBitmap->GetHeight();
         ci.depth                       = 1;
-        ci.imageFormat                 = ToGrfxFormat(pBitmap->GetFormat());
+        ci.imageFormat                 = format;
         ci.sampleCount                 = grfx::SAMPLE_COUNT_1;
         ci.mipLevelCount               = mipLevelCount;
         ci.arrayLayerCount             = 1;
@@ -921,6 +1006,9 @@ Result CreateTextureFromBitmap(
         ci.ownership                   = grfx::OWNERSHIP_REFERENCE;
 
         ci.usageFlags.flags |= options.mAdditionalUsage;
+        if (!IsNull(pMipGenerator)) {
+            ci.usageFlags.bits.storage = true;
+        }
 
         ppxres = pQueue->GetDevice()->CreateTexture(&ci, &targetTexture);
         if (Failed(ppxres)) {
@@ -929,8 +1017,43 @@ Result CreateTextureFromBitmap(
         SCOPED_DESTROYER.AddObject(targetTexture);
     }
 
-    // Since this mipmap is temporary, it's safe to use the static pool.
-    Mipmap mipmap = Mipmap(*pBitmap, mipLevelCount, /* useStaticPool= */ true);
+    if (!IsNull(pMipGenerator)) {
+        // Upload level 0 only, the compute shader builds the rest
+        ppxres = CopyBitmapToTexture(
+            pQueue,
+            pBitmap,
+            targetTexture,
+            0,
+            0,
+            options.mInitialState,
+            options.mInitialState);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+
+        MipGeneratorImage mips = {};
+        mips.pImage            = targetTexture->GetImage();
+        mips.stateBefore       = options.mInitialState;
+        mips.stateAfter        = options.mInitialState;
+
+        if (!IsNull(pDeferredMips)) {
+            pDeferredMips->push_back(mips);
+        }
+        else {
+            ppxres = pMipGenerator->GenerateMips(pQueue, {mips});
+            if (Failed(ppxres)) {
+                return ppxres;
+            }
+        }
+
+        targetTexture->SetOwnership(grfx::OWNERSHIP_REFERENCE);
+        *ppTexture = targetTexture;
+        return ppx::SUCCESS;
+    }
+
+    // Since this mipmap is temporary, it's safe to use the static pool. Level 0
+    // references the bitmap's pixels so only the smaller levels are allocated.
+    Mipmap mipmap = Mipmap(pBitmap->GetView(), mipLevelCount, /* useStaticPool= */ true);
     if (!mipmap.IsOk()) {
         return ppx::ERROR_FAILED;
     }
@@ -961,6 +1084,60 @@ Result CreateTextureFromBitmap(
     return ppx::SUCCESS;
 }
 
+Result CreateTextureFromBitmap(
+    grfx::Queue*          pQueue,
+    const Bitmap*         pBitmap,
+    grfx::Texture**       ppTexture,
+    const TextureOptions& options)
+{
+    return CreateTextureFromBitmapImpl(pQueue, pBitmap, ppTexture, options, nullptr);
+}
+
+Result CreateTexturesFromBitmaps(
+    grfx::Queue*                      pQueue,
+    const std::vector<const Bitmap*>& bitmaps,
+    std::vector<grfx::TexturePtr>*    pTextures,
+    const TextureOptions&             options)
+{
+    PPX_ASSERT_NULL_ARG(pQueue);
+    PPX_ASSERT_NULL_ARG(pTextures);
+
+    // Share one worker pool between the textures that get compressed
+    TextureOptions textureOptions = options;
+    JobSystem      jobSystem;
+    if ((options.mCompressFormat != grfx::FORMAT_UNDEFINED) && IsNull(options.mCompressionJobSystem) && (bitmaps.size() > 1)) {
+        jobSystem.Initialize(JobSystem::GetDefaultWorkerCount());
+        textureOptions.CompressionJobSystem(&jobSystem);
+    }
+
+    Result                         ppxres = ppx::SUCCESS;
+    std::vector<grfx::TexturePtr>  textures;
+    std::vector<MipGeneratorImage> deferredMips;
+    for (const Bitmap* pBitmap : bitmaps) {
+        grfx::TexturePtr texture;
+        ppxres = CreateTextureFromBitmapImpl(pQueue, pBitmap, &texture, textureOptions, &deferredMips);
+        if (Failed(ppxres)) {
+            break;
+        }
+        textures.push_back(texture);
+    }
+
+    // Textures are only queued here if the generator is usable
+    if (Success(ppxres) && !deferredMips.empty()) {
+        ppxres = SelectMipGenerator(pQueue, options.mGpuMips, options.mGpuMipGenerator)->GenerateMips(pQueue, deferredMips);
+    }
+
+    if (Failed(ppxres)) {
+        for (auto& texture : textures) {
+            pQueue->GetDevice()->DestroyTexture(texture);
+        }
+        return ppxres;
+    }
+
+    pTextures->insert(pTextures->end(), textures.begin(), textures.end());
+    return ppx::SUCCESS;
+}
+
 Result CreateTextureFromMipmap(
     grfx::Queue*          pQueue,
     const Mipmap*         pMipmap,
@@ -979,6 +1156,10 @@ Result CreateTextureFromMipmap(
     // Cap mip level count
     auto pMip0 = pMipmap->GetMip(0);
 
+    if (CanCompressTexture(options.mCompressFormat, pMip0->GetWidth(), pMip0->GetHeight())) {
+        return CreateCompressedTextureFromMipmap(pQueue, *pMipmap, options.mCompressFormat, options.mCompressionCacheDirectory, options.mCompressionJobSystem, ppTexture, options);
+    }
+
     // Create target texture
     grfx::TexturePtr targetTexture;
     {
@@ -1040,6 +1221,149 @@ Result CreateTextureFromMipmap(
     return ppx::SUCCESS;
 }
 
+Result CreateTextureFromCompressedMipmap(
+    grfx::Queue*            pQueue,
+    const CompressedMipmap* pMipmap,
+    grfx::Texture**         ppTexture,
+    const TextureOptions&   options)
+{
+    PPX_ASSERT_NULL_ARG(pQueue);
+    PPX_ASSERT_NULL_ARG(pMipmap);
+    PPX_ASSERT_NULL_ARG(ppTexture);
+
+    if (!pMipmap->IsOk()) {
+        return ppx::ERROR_INVALID_CREATE_ARGUMENT;
+    }
+
+    Result ppxres = ppx::ERROR_FAILED;
+
+    // Scoped destroy
+    grfx::ScopeDestroyer SCOPED_DESTROYER(pQueue->GetDevice());
+
+    // Row stride and texture offset alignment to handle DX's requirements
+    const uint32_t rowStrideAlignment = grfx::IsDx12(pQueue->GetDevice()->GetApi()) ? PPX_D3D12_TEXTURE_DATA_PITCH_ALIGNMENT : 1;
+    const uint32_t offsetAlignment    = grfx::IsDx12(pQueue->GetDevice()->GetApi()) ? PPX_D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT : 1;
+    const uint32_t levelCount         = pMipmap->GetLevelCount();
+
+    // Lay out every level in a single staging buffer
+    std::vector<grfx::BufferToImageCopyInfo> copyInfos(levelCount);
+    uint64_t                                 stagingSize = 0;
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        const uint32_t blockCountX = pMipmap->GetBlockCountX(level);
+        const uint32_t blockCountY = pMipmap->GetBlockCountY(level);
+        auto&          copyInfo    = copyInfos[level];
+
+        copyInfo.srcBuffer.imageWidth      = blockCountX * 4;
+        copyInfo.srcBuffer.imageHeight     = blockCountY * 4;
+        copyInfo.srcBuffer.imageRowStride  = RoundUp<uint32_t>(pMipmap->GetRowStride(level), rowStrideAlignment);
+        copyInfo.srcBuffer.footprintOffset = stagingSize;
+        copyInfo.srcBuffer.footprintWidth  = blockCountX * 4;
+        copyInfo.srcBuffer.footprintHeight = blockCountY * 4;
+        copyInfo.srcBuffer.footprintDepth  = 1;
+        copyInfo.dstImage.mipLevel         = level;
+        copyInfo.dstImage.arrayLayer       = 0;
+        copyInfo.dstImage.arrayLayerCount  = 1;
+        copyInfo.dstImage.x                = 0;
+        copyInfo.dstImage.y                = 0;
+        copyInfo.dstImage.z                = 0;
+        copyInfo.dstImage.width            = pMipmap->GetWidth(level);
+        copyInfo.dstImage.height           = pMipmap->GetHeight(level);
+        copyInfo.dstImage.depth            = 1;
+
+        stagingSize += static_cast<uint64_t>(copyInfo.srcBuffer.imageRowStride) * blockCountY;
+        stagingSize = RoundUp<uint64_t>(stagingSize, offsetAlignment);
+    }
+
+    // Create staging buffer
+    grfx::BufferPtr stagingBuffer;
+    {
+        grfx::BufferCreateInfo ci      = {};
+        ci.size                        = stagingSize;
+        ci.usageFlags.bits.transferSrc = true;
+        ci.memoryUsage                 = grfx::MEMORY_USAGE_CPU_TO_GPU;
+
+        ppxres = pQueue->GetDevice()->CreateBuffer(&ci, &stagingBuffer);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+        SCOPED_DESTROYER.AddObject(stagingBuffer);
+    }
+
+    // Map and copy to staging buffer
+    void* pBufferAddress = nullptr;
+    ppxres               = stagingBuffer->MapMemory(0, &pBufferAddress);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        const auto&    copyInfo     = copyInfos[level];
+        const uint32_t srcRowStride = pMipmap->GetRowStride(level);
+        const char*    pSrc         = pMipmap->GetData(level);
+        char*          pDst         = static_cast<char*>(pBufferAddress) + copyInfo.srcBuffer.footprintOffset;
+        for (uint32_t row = 0; row < pMipmap->GetBlockCountY(level); ++row) {
+            memcpy(pDst + row * copyInfo.srcBuffer.imageRowStride, pSrc + row * srcRowStride, srcRowStride);
+        }
+    }
+
+    stagingBuffer->UnmapMemory();
+
+    // Create target texture
+    grfx::TexturePtr targetTexture;
+    {
+        grfx::TextureCreateInfo ci     = {};
+        ci.pImage                      = nullptr;
+        ci.imageType                   = grfx::IMAGE_TYPE_2D;
+        ci.width                       = pMipmap->GetWidth(0);
+        ci.height                      = pMipmap->GetHeight(0);
+        ci.depth                       = 1;
+        ci.imageFormat                 = pMipmap->GetFormat();
+        ci.sampleCount                 = grfx::SAMPLE_COUNT_1;
+        ci.mipLevelCount               = levelCount;
+        ci.arrayLayerCount             = 1;
+        ci.usageFlags.bits.transferDst = true;
+        ci.usageFlags.bits.sampled     = true;
+        ci.memoryUsage                 = grfx::MEMORY_USAGE_GPU_ONLY;
+        ci.initialState                = options.mInitialState;
+        ci.RTVClearValue               = {{0, 0, 0, 0}};
+        ci.DSVClearValue               = {1.0f, 0xFF};
+        ci.sampledImageViewType        = grfx::IMAGE_VIEW_TYPE_UNDEFINED;
+        ci.sampledImageViewFormat      = grfx::FORMAT_UNDEFINED;
+        ci.renderTargetViewFormat      = grfx::FORMAT_UNDEFINED;
+        ci.depthStencilViewFormat      = grfx::FORMAT_UNDEFINED;
+        ci.storageImageViewFormat      = grfx::FORMAT_UNDEFINED;
+        ci.ownership                   = grfx::OWNERSHIP_REFERENCE;
+
+        ci.usageFlags.flags |= options.mAdditionalUsage;
+
+        ppxres = pQueue->GetDevice()->CreateTexture(&ci, &targetTexture);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+        SCOPED_DESTROYER.AddObject(targetTexture);
+    }
+
+    // Copy all levels with a single submission
+    ppxres = pQueue->CopyBufferToImage(
+        copyInfos,
+        stagingBuffer,
+        targetTexture->GetImage(),
+        PPX_ALL_SUBRESOURCES,
+        options.mInitialState,
+        options.mInitialState);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    // Change ownership to reference so object doesn't get destroyed
+    targetTexture->SetOwnership(grfx::OWNERSHIP_REFERENCE);
+
+    // Assign output
+    *ppTexture = targetTexture;
+
+    return ppx::SUCCESS;
+}
+
 // -------------------------------------------------------------------------------------------------
 
 Result CreateTextureFromFile(
@@ -1055,7 +1379,7 @@ Result CreateTextureFromFile(
 
     // Load bitmap
     Bitmap bitmap;
-    Result ppxres = Bitmap::LoadFile(path, &bitmap);
+    Result ppxres = Bitmap::LoadFile(path, &bitmap, options.mLoadOptions);
     if (Failed(ppxres)) {
         return ppxres;
     }
@@ -1064,80 +1388,51 @@ Result CreateTextureFromFile(
 
 // -------------------------------------------------------------------------------------------------
 
-struct SubImage
+// Cell of every subimage in the grid of a layout, see enum CubeImageLayout
+struct CubeImageLayoutGrid
 {
-    uint32_t width        = 0;
-    uint32_t height       = 0;
-    uint32_t bufferOffset = 0;
+    CubeImageLayout layout;
+    uint32_t        cellsX;
+    uint32_t        cellsY;
+    uint32_t        cellX[6];
+    uint32_t        cellY[6];
 };
 
-SubImage CalcSubimageCrossHorizontalLeft(
-    uint32_t     subImageIndex,
-    uint32_t     imageWidth,
-    uint32_t     imageHeight,
-    grfx::Format format)
-{
-    uint32_t cellPixelsX = imageWidth / 4;
-    uint32_t cellPixelsY = imageHeight / 3;
-    uint32_t cellX       = 0;
-    uint32_t cellY       = 0;
-    switch (subImageIndex) {
-        default: break;
-
-        case 0: {
-            cellX = 1;
-            cellY = 0;
-        } break;
-
-        case 1: {
-            cellX = 0;
-            cellY = 1;
-        } break;
-
-        case 2: {
-            cellX = 1;
-            cellY = 1;
-        } break;
-
-        case 3: {
-            cellX = 2;
-            cellY = 1;
-        } break;
-
-        case 4: {
-            cellX = 3;
-            cellY = 1;
-        } break;
-
-        case 5: {
-            cellX = 1;
-            cellY = 2;
+// clang-format off
+static const CubeImageLayoutGrid kCubeImageLayoutGrids[] = {
+    {CUBE_IMAGE_LAYOUT_CROSS_HORIZONTAL_LEFT,  4, 3, {1, 0, 1, 2, 3, 1}, {0, 1, 1, 1, 1, 2}},
+    {CUBE_IMAGE_LAYOUT_CROSS_HORIZONTAL_RIGHT, 4, 3, {2, 0, 1, 2, 3, 2}, {0, 1, 1, 1, 1, 2}},
+    {CUBE_IMAGE_LAYOUT_CROSS_VERTICAL_TOP,     3, 4, {1, 0, 1, 2, 1, 1}, {0, 1, 1, 1, 2, 3}},
+    {CUBE_IMAGE_LAYOUT_CROSS_VERTICAL_BOTTOM,  3, 4, {1, 1, 0, 1, 2, 1}, {0, 1, 2, 2, 2, 3}},
+    {CUBE_IMAGE_LAYOUT_LAT_LONG_HORIZONTAL,    3, 2, {0, 1, 2, 0, 1, 2}, {0, 0, 0, 1, 1, 1}},
+    {CUBE_IMAGE_LAYOUT_LAT_LONG_VERTICAL,      2, 3, {0, 1, 0, 1, 0, 1}, {0, 0, 1, 1, 2, 2}},
+    {CUBE_IMAGE_LAYOUT_STRIP_HORIZONTAL,       6, 1, {0, 1, 2, 3, 4, 5}, {0, 0, 0, 0, 0, 0}},
+    {CUBE_IMAGE_LAYOUT_STRIP_VERTICAL,         1, 6, {0, 0, 0, 0, 0, 0}, {0, 1, 2, 3, 4, 5}},
+};
+// clang-format on
 
-        } break;
+static const CubeImageLayoutGrid* FindCubeImageLayoutGrid(CubeImageLayout layout)
+{
+    for (const CubeImageLayoutGrid& grid : kCubeImageLayoutGrids) {
+        if (grid.layout == layout) {
+            return &grid;
+        }
     }
-
-    uint32_t pixelStride  = grfx::GetFormatDescription(format)->bytesPerTexel;
-    uint32_t pixelOffsetX = cellX * cellPixelsX * pixelStride;
-    uint32_t pixelOffsetY = cellY * cellPixelsY * imageWidth * pixelStride;
-
-    SubImage subImage     = {};
-    subImage.width        = cellPixelsX;
-    subImage.height       = cellPixelsY;
-    subImage.bufferOffset = pixelOffsetX + pixelOffsetY;
-
-    return subImage;
+    return nullptr;
 }
 
-Result CreateIBLTexturesFromFile(
-    grfx::Queue*                 pQueue,
-    const std::filesystem::path& path,
-    grfx::Texture**              ppIrradianceTexture,
-    grfx::Texture**              ppEnvironmentTexture)
+// Contents of an *.ibl file, paths are relative to the file
+struct IBLFileInfo
 {
-    PPX_ASSERT_NULL_ARG(pQueue);
-    PPX_ASSERT_NULL_ARG(ppIrradianceTexture);
-    PPX_ASSERT_NULL_ARG(ppEnvironmentTexture);
+    std::filesystem::path irradiancePath;
+    std::filesystem::path environmentPath;
+    uint32_t              baseWidth  = 0;
+    uint32_t              baseHeight = 0;
+    uint32_t              levelCount = 0;
+};
 
+static Result LoadIBLFileInfo(const std::filesystem::path& path, IBLFileInfo* pInfo)
+{
     auto fileBytes = ppx::fs::load_file(path);
     if (!fileBytes.has_value()) {
         return ppx::ERROR_IMAGE_FILE_LOAD_FAILED;
@@ -1167,22 +1462,44 @@ Result CreateIBLTexturesFromFile(
         return ppx::ERROR_IMAGE_FILE_LOAD_FAILED;
     }
 
+    pInfo->irradiancePath  = path.parent_path() / irrFile;
+    pInfo->environmentPath = path.parent_path() / envFile;
+    pInfo->baseWidth       = baseWidth;
+    pInfo->baseHeight      = baseHeight;
+    pInfo->levelCount      = levelCount;
+
+    return ppx::SUCCESS;
+}
+
+Result CreateIBLTexturesFromFile(
+    grfx::Queue*                 pQueue,
+    const std::filesystem::path& path,
+    grfx::Texture**              ppIrradianceTexture,
+    grfx::Texture**              ppEnvironmentTexture)
+{
+    PPX_ASSERT_NULL_ARG(pQueue);
+    PPX_ASSERT_NULL_ARG(ppIrradianceTexture);
+    PPX_ASSERT_NULL_ARG(ppEnvironmentTexture);
+
+    IBLFileInfo info   = {};
+    Result      ppxres = LoadIBLFileInfo(path, &info);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
     // Create irradiance texture - does not require mip maps
-    std::filesystem::path irrFilePath = path.parent_path() / irrFile;
-    Result                ppxres;
     {
-        ScopedTimer timer("Texture creation from file '" + irrFilePath.string() + "'");
-        ppxres = CreateTextureFromFile(pQueue, irrFilePath, ppIrradianceTexture);
+        ScopedTimer timer("Texture creation from file '" + info.irradiancePath.string() + "'");
+        ppxres = CreateTextureFromFile(pQueue, info.irradiancePath, ppIrradianceTexture);
     }
     if (Failed(ppxres)) {
         return ppxres;
     }
 
     // Load IBL environment map - this is stored as a bitmap on disk
-    std::filesystem::path envFilePath = path.parent_path() / envFile;
-    ScopedTimer           timer("Texture creation from mipmap file '" + envFilePath.string() + "'");
-    Mipmap                mipmap      = {};
-    ppxres                            = Mipmap::LoadFile(envFilePath, baseWidth, baseHeight, &mipmap, levelCount);
+    ScopedTimer timer("Texture creation from mipmap file '" + info.environmentPath.string() + "'");
+    Mipmap      mipmap = {};
+    ppxres             = Mipmap::LoadFile(info.environmentPath, info.baseWidth, info.baseHeight, &mipmap, info.levelCount);
     if (Failed(ppxres)) {
         return ppxres;
     }
@@ -1193,17 +1510,86 @@ Result CreateIBLTexturesFromFile(
 
 // -------------------------------------------------------------------------------------------------
 
+// Packs the faces of a grid layout into a staging buffer, one face after
+// the other, applying the face ops while copying. Faces are independent so
+// each one is a job.
+static Result CopyCubeFacesToStagingBuffer(
+    const Bitmap&              bitmap,
+    const CubeImageLayoutGrid& grid,
+    const uint32_t*            pFaces,
+    uint32_t                   faceSize,
+    uint32_t                   faceRowStride,
+    uint64_t                   faceDataStride,
+    char*                      pStagingData,
+    JobSystem*                 pJobSystem)
+{
+    std::vector<Result> results(6, ppx::SUCCESS);
+    pJobSystem->Run(6, [&](uint32_t arrayLayer, uint32_t) {
+        const uint32_t subImageIndex = PPX_DECODE_CUBE_FACE_SUBIMAGE(pFaces[arrayLayer]);
+        const uint32_t op1           = PPX_DECODE_CUBE_FACE_OP1(pFaces[arrayLayer]);
+        const uint32_t op2           = PPX_DECODE_CUBE_FACE_OP2(pFaces[arrayLayer]);
+        const uint64_t offsetX       = static_cast<uint64_t>(grid.cellX[subImageIndex]) * faceSize * bitmap.GetPixelStride();
+        const uint64_t offsetY       = static_cast<uint64_t>(grid.cellY[subImageIndex]) * faceSize * bitmap.GetRowStride();
+
+        Bitmap src = Bitmap::Create(faceSize, faceSize, bitmap.GetFormat(), bitmap.GetRowStride(), bitmap.GetData() + offsetX + offsetY);
+        Bitmap dst = Bitmap::Create(faceSize, faceSize, bitmap.GetFormat(), faceRowStride, pStagingData + arrayLayer * faceDataStride);
+
+        if (op2 == CUBE_FACE_OP_NONE) {
+            results[arrayLayer] = ApplyCubeFaceOp(src, op1, &dst);
+            return;
+        }
+
+        Bitmap tmp = Bitmap::Create(faceSize, faceSize, bitmap.GetFormat());
+        results[arrayLayer] = ApplyCubeFaceOp(src, op1, &tmp);
+        if (Success(results[arrayLayer])) {
+            results[arrayLayer] = ApplyCubeFaceOp(tmp, op2, &dst);
+        }
+    });
+
+    for (Result result : results) {
+        if (Failed(result)) {
+            return result;
+        }
+    }
+    return ppx::SUCCESS;
+}
+
 Result CreateCubeMapFromFile(
     grfx::Queue*                 pQueue,
     const std::filesystem::path& path,
     const CubeMapCreateInfo*     pCreateInfo,
     grfx::Image**                ppImage,
-    const grfx::ImageUsageFlags& additionalImageUsage)
+    const grfx::ImageUsageFlags& additionalImageUsage,
+    JobSystem*                   pJobSystem)
 {
     PPX_ASSERT_NULL_ARG(pQueue);
+    PPX_ASSERT_NULL_ARG(pCreateInfo);
     PPX_ASSERT_NULL_ARG(ppImage);
     ScopedTimer timer("Cubemap creation from file '" + path.string() + "'");
 
+    const CubeImageLayoutGrid* pGrid = FindCubeImageLayoutGrid(pCreateInfo->layout);
+    if (IsNull(pGrid) && (pCreateInfo->layout != CUBE_IMAGE_LAYOUT_EQUIRECTANGULAR)) {
+        PPX_LOG_ERROR("unsupported cube image layout: " << pCreateInfo->layout);
+        return ppx::ERROR_INVALID_CREATE_ARGUMENT;
+    }
+
+    const uint32_t faces[6] = {
+        pCreateInfo->posX,
+        pCreateInfo->negX,
+        pCreateInfo->posY,
+        pCreateInfo->negY,
+        pCreateInfo->posZ,
+        pCreateInfo->negZ,
+    };
+    if (!IsNull(pGrid)) {
+        for (uint32_t face : faces) {
+            if (PPX_DECODE_CUBE_FACE_SUBIMAGE(face) >= 6) {
+                PPX_LOG_ERROR("cube face subimage out of range: " << PPX_DECODE_CUBE_FACE_SUBIMAGE(face));
+                return ppx::ERROR_INVALID_CREATE_ARGUMENT;
+            }
+        }
+    }
+
     // Load bitmap
     Bitmap bitmap;
     Result ppxres = Bitmap::LoadFile(path, &bitmap);
@@ -1211,16 +1597,49 @@ Result CreateCubeMapFromFile(
         return ppxres;
     }
 
+    JobSystem localJobSystem;
+    if (IsNull(pJobSystem)) {
+        localJobSystem.Initialize(JobSystem::GetDefaultWorkerCount());
+        pJobSystem = &localJobSystem;
+    }
+
+    // Equirectangular images are resampled into a float cube map
+    if (pCreateInfo->layout == CUBE_IMAGE_LAYOUT_EQUIRECTANGULAR) {
+        CubeMap cubeMap;
+        ppxres = ConvertLatLongToCubeMap(bitmap, bitmap.GetHeight() / 2, 1, &cubeMap, pJobSystem);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+        return CreateCubeMapFromCubeMap(pQueue, &cubeMap, ppImage, additionalImageUsage);
+    }
+
+    // Cells must be square and cover the whole image
+    const uint32_t faceSize = bitmap.GetWidth() / pGrid->cellsX;
+    if ((faceSize == 0) || (faceSize * pGrid->cellsX != bitmap.GetWidth()) || (faceSize * pGrid->cellsY != bitmap.GetHeight())) {
+        PPX_LOG_ERROR("cube image of " << bitmap.GetWidth() << "x" << bitmap.GetHeight() << " does not divide into " << pGrid->cellsX << "x" << pGrid->cellsY << " square faces");
+        return ppx::ERROR_INVALID_CREATE_ARGUMENT;
+    }
+
+    const grfx::Format targetFormat = ToGrfxFormat(bitmap.GetFormat());
+    if (targetFormat == grfx::FORMAT_UNDEFINED) {
+        return ppx::ERROR_INVALID_CREATE_ARGUMENT;
+    }
+
+    // Faces are packed so rows and faces must satisfy the API's copy alignment
+    const bool     isDx12         = grfx::IsDx12(pQueue->GetDevice()->GetApi());
+    const uint32_t rowAlignment   = isDx12 ? PPX_D3D12_TEXTURE_DATA_PITCH_ALIGNMENT : 1;
+    const uint32_t faceAlignment  = isDx12 ? PPX_D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT : 4;
+    const uint32_t faceRowStride  = RoundUp<uint32_t>(faceSize * bitmap.GetPixelStride(), rowAlignment);
+    const uint64_t faceDataStride = RoundUp<uint64_t>(static_cast<uint64_t>(faceRowStride) * faceSize, faceAlignment);
+
     // Scoped destroy
     grfx::ScopeDestroyer SCOPED_DESTROYER(pQueue->GetDevice());
 
     // Create staging buffer
     grfx::BufferPtr stagingBuffer;
     {
-        uint64_t bitmapFootprintSize = bitmap.GetFootprintSize();
-
         grfx::BufferCreateInfo ci      = {};
-        ci.size                        = bitmapFootprintSize;
+        ci.size                        = 6 * faceDataStride;
         ci.usageFlags.bits.transferSrc = true;
         ci.memoryUsage                 = grfx::MEMORY_USAGE_CPU_TO_GPU;
 
@@ -1230,31 +1649,26 @@ Result CreateCubeMapFromFile(
         }
         SCOPED_DESTROYER.AddObject(stagingBuffer);
 
-        // Map and copy to staging buffer
+        // Map and extract faces into staging buffer
         void* pBufferAddress = nullptr;
         ppxres               = stagingBuffer->MapMemory(0, &pBufferAddress);
         if (Failed(ppxres)) {
             return ppxres;
         }
-        std::memcpy(pBufferAddress, bitmap.GetData(), bitmapFootprintSize);
+        ppxres = CopyCubeFacesToStagingBuffer(bitmap, *pGrid, faces, faceSize, faceRowStride, faceDataStride, static_cast<char*>(pBufferAddress), pJobSystem);
         stagingBuffer->UnmapMemory();
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
     }
 
-    // Target format
-    grfx::Format targetFormat = grfx::FORMAT_R8G8B8A8_UNORM;
-
-    PPX_ASSERT_MSG(bitmap.GetWidth() * 3 == bitmap.GetHeight() * 4, "cubemap texture dimension must be a multiple of 4x3");
-    // Calculate subImage to use for target image dimensions
-    SubImage tmpSubImage = CalcSubimageCrossHorizontalLeft(0, bitmap.GetWidth(), bitmap.GetHeight(), targetFormat);
-
-    PPX_ASSERT_MSG(tmpSubImage.width == tmpSubImage.height, "cubemap face width != height");
     // Create target image
     grfx::ImagePtr targetImage;
     {
         grfx::ImageCreateInfo ci       = {};
         ci.type                        = grfx::IMAGE_TYPE_CUBE;
-        ci.width                       = tmpSubImage.width;
-        ci.height                      = tmpSubImage.height;
+        ci.width                       = faceSize;
+        ci.height                      = faceSize;
         ci.depth                       = 1;
         ci.format                      = targetFormat;
         ci.sampleCount                 = grfx::SAMPLE_COUNT_1;
@@ -1276,28 +1690,16 @@ Result CreateCubeMapFromFile(
     // Copy to GPU image
     //
     {
-        uint32_t faces[6] = {
-            pCreateInfo->posX,
-            pCreateInfo->negX,
-            pCreateInfo->posY,
-            pCreateInfo->negY,
-            pCreateInfo->posZ,
-            pCreateInfo->negZ,
-        };
-
         std::vector<grfx::BufferToImageCopyInfo> copyInfos(6);
         for (uint32_t arrayLayer = 0; arrayLayer < 6; ++arrayLayer) {
-            uint32_t subImageIndex = faces[arrayLayer];
-            SubImage subImage      = CalcSubimageCrossHorizontalLeft(subImageIndex, bitmap.GetWidth(), bitmap.GetHeight(), targetFormat);
-
             // Copy info
             grfx::BufferToImageCopyInfo& copyInfo = copyInfos[arrayLayer];
-            copyInfo.srcBuffer.imageWidth         = bitmap.GetWidth();
-            copyInfo.srcBuffer.imageHeight        = bitmap.GetHeight();
-            copyInfo.srcBuffer.imageRowStride     = bitmap.GetRowStride();
-            copyInfo.srcBuffer.footprintOffset    = subImage.bufferOffset;
-            copyInfo.srcBuffer.footprintWidth     = subImage.width;
-            copyInfo.srcBuffer.footprintHeight    = subImage.height;
+            copyInfo.srcBuffer.imageWidth         = faceSize;
+            copyInfo.srcBuffer.imageHeight        = faceSize;
+            copyInfo.srcBuffer.imageRowStride     = faceRowStride;
+            copyInfo.srcBuffer.footprintOffset    = arrayLayer * faceDataStride;
+            copyInfo.srcBuffer.footprintWidth     = faceSize;
+            copyInfo.srcBuffer.footprintHeight    = faceSize;
             copyInfo.srcBuffer.footprintDepth     = 1;
             copyInfo.dstImage.mipLevel            = 0;
             copyInfo.dstImage.arrayLayer          = arrayLayer;
@@ -1305,8 +1707,8 @@ Result CreateCubeMapFromFile(
             copyInfo.dstImage.x                   = 0;
             copyInfo.dstImage.y                   = 0;
             copyInfo.dstImage.z                   = 0;
-            copyInfo.dstImage.width               = subImage.width;
-            copyInfo.dstImage.height              = subImage.height;
+            copyInfo.dstImage.width               = faceSize;
+            copyInfo.dstImage.height              = faceSize;
             copyInfo.dstImage.depth               = 1;
         }
 
@@ -1331,6 +1733,200 @@ Result CreateCubeMapFromFile(
     return ppx::SUCCESS;
 }
 
+Result CreateCubeMapFromCubeMap(
+    grfx::Queue*                 pQueue,
+    const CubeMap*               pCubeMap,
+    grfx::Image**                ppImage,
+    const grfx::ImageUsageFlags& additionalImageUsage)
+{
+    PPX_ASSERT_NULL_ARG(pQueue);
+    PPX_ASSERT_NULL_ARG(pCubeMap);
+    PPX_ASSERT_NULL_ARG(ppImage);
+
+    if (!pCubeMap->IsOk()) {
+        return ppx::ERROR_INVALID_CREATE_ARGUMENT;
+    }
+
+    const bool     isDx12        = grfx::IsDx12(pQueue->GetDevice()->GetApi());
+    const uint32_t rowAlignment  = isDx12 ? PPX_D3D12_TEXTURE_DATA_PITCH_ALIGNMENT : 1;
+    const uint32_t faceAlignment = isDx12 ? PPX_D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT : 4;
+    const uint32_t texelSize     = 4 * sizeof(float);
+    const uint32_t levelCount    = pCubeMap->GetLevelCount();
+
+    // Lay out every face of every level in one staging buffer
+    std::vector<grfx::BufferToImageCopyInfo> copyInfos;
+    uint64_t                                 stagingSize = 0;
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        const uint32_t faceSize  = pCubeMap->GetFaceSize(level);
+        const uint32_t rowStride = RoundUp<uint32_t>(faceSize * texelSize, rowAlignment);
+        for (uint32_t face = 0; face < CUBE_MAP_FACE_COUNT; ++face) {
+            grfx::BufferToImageCopyInfo copyInfo = {};
+            copyInfo.srcBuffer.imageWidth        = faceSize;
+            copyInfo.srcBuffer.imageHeight       = faceSize;
+            copyInfo.srcBuffer.imageRowStride    = rowStride;
+            copyInfo.srcBuffer.footprintOffset   = stagingSize;
+            copyInfo.srcBuffer.footprintWidth    = faceSize;
+            copyInfo.srcBuffer.footprintHeight   = faceSize;
+            copyInfo.srcBuffer.footprintDepth    = 1;
+            copyInfo.dstImage.mipLevel           = level;
+            copyInfo.dstImage.arrayLayer         = face;
+            copyInfo.dstImage.arrayLayerCount    = 1;
+            copyInfo.dstImage.x                  = 0;
+            copyInfo.dstImage.y                  = 0;
+            copyInfo.dstImage.z                  = 0;
+            copyInfo.dstImage.width              = faceSize;
+            copyInfo.dstImage.height             = faceSize;
+            copyInfo.dstImage.depth              = 1;
+            copyInfos.push_back(copyInfo);
+
+            stagingSize = RoundUp<uint64_t>(stagingSize + static_cast<uint64_t>(rowStride) * faceSize, faceAlignment);
+        }
+    }
+
+    // Scoped destroy
+    grfx::ScopeDestroyer SCOPED_DESTROYER(pQueue->GetDevice());
+
+    // Create staging buffer
+    grfx::BufferPtr stagingBuffer;
+    Result          ppxres = ppx::ERROR_FAILED;
+    {
+        grfx::BufferCreateInfo ci      = {};
+        ci.size                        = stagingSize;
+        ci.usageFlags.bits.transferSrc = true;
+        ci.memoryUsage                 = grfx::MEMORY_USAGE_CPU_TO_GPU;
+
+        ppxres = pQueue->GetDevice()->CreateBuffer(&ci, &stagingBuffer);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+        SCOPED_DESTROYER.AddObject(stagingBuffer);
+
+        void* pBufferAddress = nullptr;
+        ppxres               = stagingBuffer->MapMemory(0, &pBufferAddress);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+        for (const grfx::BufferToImageCopyInfo& copyInfo : copyInfos) {
+            const uint32_t faceSize = copyInfo.srcBuffer.imageWidth;
+            const char*    pSrc     = reinterpret_cast<const char*>(pCubeMap->GetTexels(copyInfo.dstImage.arrayLayer, copyInfo.dstImage.mipLevel));
+            char*          pDst     = static_cast<char*>(pBufferAddress) + copyInfo.srcBuffer.footprintOffset;
+            for (uint32_t y = 0; y < faceSize; ++y) {
+                std::memcpy(pDst, pSrc, faceSize * texelSize);
+                pSrc += faceSize * texelSize;
+                pDst += copyInfo.srcBuffer.imageRowStride;
+            }
+        }
+        stagingBuffer->UnmapMemory();
+    }
+
+    // Create target image
+    grfx::ImagePtr targetImage;
+    {
+        grfx::ImageCreateInfo ci       = {};
+        ci.type                        = grfx::IMAGE_TYPE_CUBE;
+        ci.width                       = pCubeMap->GetFaceSize();
+        ci.height                      = pCubeMap->GetFaceSize();
+        ci.depth                       = 1;
+        ci.format                      = grfx::FORMAT_R32G32B32A32_FLOAT;
+        ci.sampleCount                 = grfx::SAMPLE_COUNT_1;
+        ci.mipLevelCount               = levelCount;
+        ci.arrayLayerCount             = 6;
+        ci.usageFlags.bits.transferDst = true;
+        ci.usageFlags.bits.sampled     = true;
+        ci.memoryUsage                 = grfx::MEMORY_USAGE_GPU_ONLY;
+
+        ci.usageFlags.flags |= additionalImageUsage.flags;
+
+        ppxres = pQueue->GetDevice()->CreateImage(&ci, &targetImage);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+        SCOPED_DESTROYER.AddObject(targetImage);
+    }
+
+    // All levels and faces in one submission
+    ppxres = pQueue->CopyBufferToImage(
+        copyInfos,
+        stagingBuffer,
+        targetImage,
+        PPX_ALL_SUBRESOURCES,
+        grfx::RESOURCE_STATE_UNDEFINED,
+        grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    // Change ownership to reference so object doesn't get destroyed
+    targetImage->SetOwnership(grfx::OWNERSHIP_REFERENCE);
+
+    // Assign output
+    *ppImage = targetImage;
+
+    return ppx::SUCCESS;
+}
+
+Result CreateIBLCubeMapsFromFile(
+    grfx::Queue*                 pQueue,
+    const std::filesystem::path& path,
+    const IBLCubeMapOptions&     options,
+    const std::filesystem::path& cacheDirectory,
+    grfx::Image**                ppIrradianceImage,
+    grfx::Image**                ppEnvironmentImage,
+    JobSystem*                   pJobSystem)
+{
+    PPX_ASSERT_NULL_ARG(pQueue);
+    PPX_ASSERT_NULL_ARG(ppIrradianceImage);
+    PPX_ASSERT_NULL_ARG(ppEnvironmentImage);
+    ScopedTimer timer("IBL cube map creation from file '" + path.string() + "'");
+
+    // An *.ibl file points at a mip strip, only its base level is filtered
+    Bitmap        bitmap;
+    Mipmap        mipmap;
+    const Bitmap* pLatLong = &bitmap;
+    Result        ppxres   = ppx::ERROR_FAILED;
+    if (path.extension() == ".ibl") {
+        IBLFileInfo info = {};
+        ppxres           = LoadIBLFileInfo(path, &info);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+        ppxres = Mipmap::LoadFile(info.environmentPath, info.baseWidth, info.baseHeight, &mipmap, 1);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+        pLatLong = mipmap.GetMip(0);
+    }
+    else {
+        ppxres = Bitmap::LoadFile(path, &bitmap);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+    }
+
+    CubeMap irradiance;
+    CubeMap environment;
+    ppxres = ComputeIBLCubeMapsCached(*pLatLong, options, cacheDirectory, &irradiance, &environment, pJobSystem);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    grfx::ImagePtr irradianceImage;
+    ppxres = CreateCubeMapFromCubeMap(pQueue, &irradiance, &irradianceImage);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    ppxres = CreateCubeMapFromCubeMap(pQueue, &environment, ppEnvironmentImage);
+    if (Failed(ppxres)) {
+        pQueue->GetDevice()->DestroyImage(irradianceImage);
+        return ppxres;
+    }
+
+    *ppIrradianceImage = irradianceImage;
+
+    return ppx::SUCCESS;
+}
+
 // -------------------------------------------------------------------------------------------------
 
 Result CreateMeshFromGeometry(
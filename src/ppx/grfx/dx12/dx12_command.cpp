@@ -36,6 +36,11 @@ Result CommandBuffer::CreateApiObjects(const grfx::internal::CommandBufferCreate
     D3D12_COMMAND_LIST_TYPE  type     = ToApi(pCreateInfo->pPool)->GetDxCommandType();
     D3D12_COMMAND_LIST_FLAGS flags    = D3D12_COMMAND_LIST_FLAG_NONE;
 
+    // Secondary command buffers are bundles
+    if (pCreateInfo->level == grfx::COMMAND_BUFFER_LEVEL_SECONDARY) {
+        type = D3D12_COMMAND_LIST_TYPE_BUNDLE;
+    }
+
     // NOTE: CreateCommandList1 creates a command list in closed state. No need to
     //       call Close() it after creation unlike command lists created with
     //       CreateCommandList.
@@ -56,9 +61,10 @@ Result CommandBuffer::CreateApiObjects(const grfx::internal::CommandBufferCreate
     }
     PPX_LOG_OBJECT_CREATION(D3D12CommandAllocator, mCommandAllocator.Get());
 
-    // Heap sizes
-    mHeapSizeCBVSRVUAV = static_cast<UINT>(pCreateInfo->resourceDescriptorCount);
-    mHeapSizeSampler   = static_cast<UINT>(pCreateInfo->samplerDescriptorCount);
+    // Heap sizes - bundles use the heaps of the primary command buffer
+    bool isBundle      = (type == D3D12_COMMAND_LIST_TYPE_BUNDLE);
+    mHeapSizeCBVSRVUAV = isBundle ? 0 : static_cast<UINT>(pCreateInfo->resourceDescriptorCount);
+    mHeapSizeSampler   = isBundle ? 0 : static_cast<UINT>(pCreateInfo->samplerDescriptorCount);
 
     // Allocate CBVSRVUAV heap
     if (mHeapSizeCBVSRVUAV > 0) {
@@ -112,7 +118,7 @@ void CommandBuffer::DestroyApiObjects()
     }
 }
 
-Result CommandBuffer::Begin()
+Result CommandBuffer::BeginImpl(const grfx::CommandBufferInheritanceInfo* pInheritanceInfo)
 {
     HRESULT hr;
 
@@ -140,29 +146,42 @@ Result CommandBuffer::Begin()
     mCurrentGraphicsInterface = nullptr;
     mCurrentComputeInterface  = nullptr;
 
+    // Bundles must set the same descriptor heaps as the command list
+    // that executes them.
+    mHeapOwner = this;
+    if (IsSecondary()) {
+        if (IsNull(pInheritanceInfo->pPrimaryCommandBuffer)) {
+            PPX_ASSERT_MSG(false, "D3D12 bundles require CommandBufferInheritanceInfo::pPrimaryCommandBuffer");
+            return ppx::ERROR_UNEXPECTED_NULL_ARGUMENT;
+        }
+        mHeapOwner = ToApi(pInheritanceInfo->pPrimaryCommandBuffer);
+    }
+
     // Set descriptor heaps
     ID3D12DescriptorHeap* heaps[2]  = {nullptr};
     uint32_t              heapCount = 0;
-    if (mHeapCBVSRVUAV) {
-        heaps[heapCount] = mHeapCBVSRVUAV.Get();
+    if (mHeapOwner->mHeapCBVSRVUAV) {
+        heaps[heapCount] = mHeapOwner->mHeapCBVSRVUAV.Get();
         ++heapCount;
     }
-    if (mHeapSampler) {
-        heaps[heapCount] = mHeapSampler.Get();
+    if (mHeapOwner->mHeapSampler) {
+        heaps[heapCount] = mHeapOwner->mHeapSampler.Get();
         ++heapCount;
     }
     if (heapCount > 0) {
         mCommandList->SetDescriptorHeaps(heapCount, heaps);
     }
 
-    // Reset heap offsets
-    mHeapOffsetCBVSRVUAV = 0;
-    mHeapOffsetSampler   = 0;
+    // Reset heap offsets, bundles allocate from the primary's heaps
+    if (!IsSecondary()) {
+        mHeapOffsetCBVSRVUAV = 0;
+        mHeapOffsetSampler   = 0;
+    }
 
     return ppx::SUCCESS;
 }
 
-Result CommandBuffer::End()
+Result CommandBuffer::EndImpl()
 {
     HRESULT hr = mCommandList->Close();
     if (FAILED(hr)) {
@@ -243,6 +262,19 @@ void CommandBuffer::EndRenderPassImpl()
     // Nothing to do here for now
 }
 
+void CommandBuffer::ExecuteCommandsImpl(
+    uint32_t                          commandBufferCount,
+    const grfx::CommandBuffer* const* ppCommandBuffers)
+{
+    for (uint32_t i = 0; i < commandBufferCount; ++i) {
+        mCommandList->ExecuteBundle(ToApi(ppCommandBuffers[i])->GetDxCommandList());
+    }
+
+    // Bundles can change the root signature
+    mCurrentGraphicsInterface = nullptr;
+    mCurrentComputeInterface  = nullptr;
+}
+
 void CommandBuffer::PushDescriptorImpl(
     grfx::CommandType              pipelineBindPoint,
     const grfx::PipelineInterface* pInterface,
@@ -319,80 +351,104 @@ void CommandBuffer::PushDescriptorImpl(
     }
 }
 
-void CommandBuffer::TransitionImageLayout(
-    const grfx::Image*  pImage,
-    uint32_t            mipLevel,
-    uint32_t            mipLevelCount,
-    uint32_t            arrayLayer,
-    uint32_t            arrayLayerCount,
-    grfx::ResourceState beforeState,
-    grfx::ResourceState afterState,
-    const grfx::Queue*  pSrcQueue,
-    const grfx::Queue*  pDstQueue)
+void CommandBuffer::ResourceBarrierImpl(
+    uint32_t                   imageBarrierCount,
+    const grfx::ImageBarrier*  pImageBarriers,
+    uint32_t                   bufferBarrierCount,
+    const grfx::BufferBarrier* pBufferBarriers)
 {
-    PPX_ASSERT_NULL_ARG(pImage);
-
-    (void)pSrcQueue;
-    (void)pDstQueue;
-
-    if (beforeState == afterState) {
-        return;
-    }
-
-    bool allMipLevels    = (mipLevel == 0) && (mipLevelCount == PPX_REMAINING_MIP_LEVELS);
-    bool allArrayLayers  = (arrayLayer == 0) && (arrayLayerCount == PPX_REMAINING_ARRAY_LAYERS);
-    bool allSubresources = allMipLevels && allArrayLayers;
+    grfx::CommandType commandType = GetCommandType();
 
-    if (mipLevelCount == PPX_REMAINING_MIP_LEVELS) {
-        mipLevelCount = pImage->GetMipLevelCount();
-    }
+    // D3D12 ignores pSrcQueue and pDstQueue, there's no queue ownership transfer
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    for (uint32_t i = 0; i < imageBarrierCount; ++i) {
+        const grfx::ImageBarrier& barrierInfo = pImageBarriers[i];
+        if (grfx::IsUnorderedAccessBarrier(barrierInfo.beforeState, barrierInfo.afterState)) {
+            // No transition, wait for shader writes to the resource instead
+            D3D12_RESOURCE_BARRIER barrier = {};
+            barrier.Type                   = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+            barrier.Flags                  = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+            barrier.UAV.pResource          = ToApi(barrierInfo.pImage)->GetDxResource();
+
+            barriers.push_back(barrier);
+            continue;
+        }
+        if (barrierInfo.beforeState == barrierInfo.afterState) {
+            continue;
+        }
 
-    if (arrayLayerCount == PPX_REMAINING_ARRAY_LAYERS) {
-        arrayLayerCount = pImage->GetArrayLayerCount();
+        const grfx::Image* pImage          = barrierInfo.pImage;
+        bool               allMipLevels    = (barrierInfo.mipLevel == 0) && (barrierInfo.mipLevelCount == pImage->GetMipLevelCount());
+        bool               allArrayLayers  = (barrierInfo.arrayLayer == 0) && (barrierInfo.arrayLayerCount == pImage->GetArrayLayerCount());
+        bool               allSubresources = allMipLevels && allArrayLayers;
+
+        if (allSubresources) {
+            D3D12_RESOURCE_BARRIER barrier = {};
+            barrier.Type                   = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+            barrier.Flags                  = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+            barrier.Transition.pResource   = ToApi(pImage)->GetDxResource();
+            barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+            barrier.Transition.StateBefore = ToD3D12ResourceStates(barrierInfo.beforeState, commandType);
+            barrier.Transition.StateAfter  = ToD3D12ResourceStates(barrierInfo.afterState, commandType);
+
+            barriers.push_back(barrier);
+        }
+        else {
+            //
+            // For details about subresource indexing see this:
+            //   https://docs.microsoft.com/en-us/windows/win32/direct3d12/subresources
+            //
+
+            uint32_t mipSpan = pImage->GetMipLevelCount();
+
+            for (uint32_t j = 0; j < barrierInfo.arrayLayerCount; ++j) {
+                uint32_t baseSubresource = (barrierInfo.arrayLayer + j) * mipSpan;
+                for (uint32_t k = 0; k < barrierInfo.mipLevelCount; ++k) {
+                    uint32_t targetSubResource = baseSubresource + (barrierInfo.mipLevel + k);
+
+                    D3D12_RESOURCE_BARRIER barrier = {};
+                    barrier.Type                   = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+                    barrier.Flags                  = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+                    barrier.Transition.pResource   = ToApi(pImage)->GetDxResource();
+                    barrier.Transition.Subresource = static_cast<UINT>(targetSubResource);
+                    barrier.Transition.StateBefore = ToD3D12ResourceStates(barrierInfo.beforeState, commandType);
+                    barrier.Transition.StateAfter  = ToD3D12ResourceStates(barrierInfo.afterState, commandType);
+
+                    barriers.push_back(barrier);
+                }
+            }
+        }
     }
 
-    grfx::CommandType commandType = GetCommandType();
+    for (uint32_t i = 0; i < bufferBarrierCount; ++i) {
+        const grfx::BufferBarrier& barrierInfo = pBufferBarriers[i];
+        if (grfx::IsUnorderedAccessBarrier(barrierInfo.beforeState, barrierInfo.afterState)) {
+            // No transition, wait for shader writes to the resource instead
+            D3D12_RESOURCE_BARRIER barrier = {};
+            barrier.Type                   = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+            barrier.Flags                  = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+            barrier.UAV.pResource          = ToApi(barrierInfo.pBuffer)->GetDxResource();
+
+            barriers.push_back(barrier);
+            continue;
+        }
+        if (barrierInfo.beforeState == barrierInfo.afterState) {
+            continue;
+        }
 
-    std::vector<D3D12_RESOURCE_BARRIER> barriers;
-    if (allSubresources) {
         D3D12_RESOURCE_BARRIER barrier = {};
         barrier.Type                   = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
         barrier.Flags                  = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-        barrier.Transition.pResource   = ToApi(pImage)->GetDxResource();
+        barrier.Transition.pResource   = ToApi(barrierInfo.pBuffer)->GetDxResource();
         barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-        barrier.Transition.StateBefore = ToD3D12ResourceStates(beforeState, commandType);
-        barrier.Transition.StateAfter  = ToD3D12ResourceStates(afterState, commandType);
+        barrier.Transition.StateBefore = ToD3D12ResourceStates(barrierInfo.beforeState, commandType);
+        barrier.Transition.StateAfter  = ToD3D12ResourceStates(barrierInfo.afterState, commandType);
 
         barriers.push_back(barrier);
     }
-    else {
-        //
-        // For details about subresource indexing see this:
-        //   https://docs.microsoft.com/en-us/windows/win32/direct3d12/subresources
-        //
-
-        uint32_t mipSpan = pImage->GetMipLevelCount();
-
-        for (uint32_t i = 0; i < arrayLayerCount; ++i) {
-            uint32_t baseSubresource = (arrayLayer + i) * mipSpan;
-            for (uint32_t j = 0; j < mipLevelCount; ++j) {
-                uint32_t targetSubResource = baseSubresource + (mipLevel + j);
-
-                D3D12_RESOURCE_BARRIER barrier = {};
-                barrier.Type                   = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-                barrier.Flags                  = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-                barrier.Transition.pResource   = ToApi(pImage)->GetDxResource();
-                barrier.Transition.Subresource = static_cast<UINT>(targetSubResource);
-                barrier.Transition.StateBefore = ToD3D12ResourceStates(beforeState, commandType);
-                barrier.Transition.StateAfter  = ToD3D12ResourceStates(afterState, commandType);
-
-                barriers.push_back(barrier);
-            }
-        }
-    }
 
     if (barriers.empty()) {
-        PPX_ASSERT_MSG(false, "parameters resulted in no barriers - try not to do this!")
+        return;
     }
 
     mCommandList->ResourceBarrier(
@@ -400,38 +456,15 @@ void CommandBuffer::TransitionImageLayout(
         DataPtr(barriers));
 }
 
-void CommandBuffer::BufferResourceBarrier(
-    const grfx::Buffer* pBuffer,
-    grfx::ResourceState beforeState,
-    grfx::ResourceState afterState,
-    const grfx::Queue*  pSrcQueue,
-    const grfx::Queue*  pDstQueue)
-{
-    PPX_ASSERT_NULL_ARG(pBuffer);
-
-    (void)pSrcQueue;
-    (void)pDstQueue;
-
-    if (beforeState == afterState) {
-        return;
-    }
-
-    grfx::CommandType commandType = GetCommandType();
-
-    D3D12_RESOURCE_BARRIER barrier = {};
-    barrier.Type                   = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-    barrier.Flags                  = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-    barrier.Transition.pResource   = ToApi(pBuffer)->GetDxResource();
-    barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-    barrier.Transition.StateBefore = ToD3D12ResourceStates(beforeState, commandType);
-    barrier.Transition.StateAfter  = ToD3D12ResourceStates(afterState, commandType);
-    mCommandList->ResourceBarrier(1, &barrier);
-}
-
 void CommandBuffer::SetViewports(
     uint32_t              viewportCount,
     const grfx::Viewport* pViewports)
 {
+    // Bundles inherit viewports from the primary command buffer
+    if (IsSecondary()) {
+        return;
+    }
+
     D3D12_VIEWPORT viewports[PPX_MAX_VIEWPORTS] = {};
     for (uint32_t i = 0; i < viewportCount; ++i) {
         viewports[i].TopLeftX = pViewports[i].x;
@@ -449,6 +482,11 @@ void CommandBuffer::SetScissors(
     uint32_t          scissorCount,
     const grfx::Rect* pScissors)
 {
+    // Bundles inherit scissors from the primary command buffer
+    if (IsSecondary()) {
+        return;
+    }
+
     D3D12_RECT rects[PPX_MAX_SCISSORS] = {};
     for (uint32_t i = 0; i < scissorCount; ++i) {
         rects[i].left   = pScissors[i].x;
@@ -507,14 +545,31 @@ void CommandBuffer::BindDescriptorSets(
         const dx12::DescriptorSet* pApiSet  = ToApi(ppSets[setIndex]);
         auto&                      bindings = pApiSet->GetLayout()->GetBindings();
 
+        // Reserve space for the set in the heaps
+        UINT descriptorCountCBVSRVUAV = 0;
+        UINT descriptorCountSampler   = 0;
+        for (auto& binding : bindings) {
+            if (binding.type == grfx::DESCRIPTOR_TYPE_SAMPLER) {
+                descriptorCountSampler += static_cast<UINT>(binding.arrayCount);
+            }
+            else {
+                descriptorCountCBVSRVUAV += static_cast<UINT>(binding.arrayCount);
+            }
+        }
+        UINT heapOffsetCBVSRVUAV = mHeapOwner->mHeapOffsetCBVSRVUAV.fetch_add(descriptorCountCBVSRVUAV);
+        UINT heapOffsetSampler   = mHeapOwner->mHeapOffsetSampler.fetch_add(descriptorCountSampler);
+
+        ID3D12DescriptorHeap* pHeapCBVSRVUAV = mHeapOwner->mHeapCBVSRVUAV.Get();
+        ID3D12DescriptorHeap* pHeapSampler   = mHeapOwner->mHeapSampler.Get();
+
         // Copy the descriptors
         {
             UINT numDescriptors = pApiSet->GetNumDescriptorsCBVSRVUAV();
             if (numDescriptors > 0) {
-                D3D12_CPU_DESCRIPTOR_HANDLE dstRangeStart = mHeapCBVSRVUAV->GetCPUDescriptorHandleForHeapStart();
+                D3D12_CPU_DESCRIPTOR_HANDLE dstRangeStart = pHeapCBVSRVUAV->GetCPUDescriptorHandleForHeapStart();
                 D3D12_CPU_DESCRIPTOR_HANDLE srcRangeStart = pApiSet->GetHeapCBVSRVUAV()->GetCPUDescriptorHandleForHeapStart();
 
-                dstRangeStart.ptr += (mHeapOffsetCBVSRVUAV * incrementSizeCBVSRVUAV);
+                dstRangeStart.ptr += (heapOffsetCBVSRVUAV * incrementSizeCBVSRVUAV);
 
                 device->CopyDescriptorsSimple(
                     numDescriptors,
@@ -525,10 +580,10 @@ void CommandBuffer::BindDescriptorSets(
 
             numDescriptors = pApiSet->GetNumDescriptorsSampler();
             if (numDescriptors > 0) {
-                D3D12_CPU_DESCRIPTOR_HANDLE dstRangeStart = mHeapSampler->GetCPUDescriptorHandleForHeapStart();
+                D3D12_CPU_DESCRIPTOR_HANDLE dstRangeStart = pHeapSampler->GetCPUDescriptorHandleForHeapStart();
                 D3D12_CPU_DESCRIPTOR_HANDLE srcRangeStart = pApiSet->GetHeapSampler()->GetCPUDescriptorHandleForHeapStart();
 
-                dstRangeStart.ptr += (mHeapOffsetSampler * incrementSizeSampler);
+                dstRangeStart.ptr += (heapOffsetSampler * incrementSizeSampler);
 
                 device->CopyDescriptorsSimple(
                     numDescriptors,
@@ -547,19 +602,19 @@ void CommandBuffer::BindDescriptorSets(
             if (binding.type == grfx::DESCRIPTOR_TYPE_SAMPLER) {
                 RootDescriptorTable& rdt = mRootDescriptorTablesSampler[rdtCountSampler];
                 rdt.parameterIndex       = parameterIndex;
-                rdt.baseDescriptor       = mHeapSampler->GetGPUDescriptorHandleForHeapStart();
-                rdt.baseDescriptor.ptr += (mHeapOffsetSampler * incrementSizeSampler);
+                rdt.baseDescriptor       = pHeapSampler->GetGPUDescriptorHandleForHeapStart();
+                rdt.baseDescriptor.ptr += (heapOffsetSampler * incrementSizeSampler);
 
-                mHeapOffsetSampler += static_cast<UINT>(binding.arrayCount);
+                heapOffsetSampler += static_cast<UINT>(binding.arrayCount);
                 rdtCountSampler += 1;
             }
             else {
                 RootDescriptorTable& rdt = mRootDescriptorTablesCBVSRVUAV[rdtCountCBVSRVUAV];
                 rdt.parameterIndex       = parameterIndex;
-                rdt.baseDescriptor       = mHeapCBVSRVUAV->GetGPUDescriptorHandleForHeapStart();
-                rdt.baseDescriptor.ptr += (mHeapOffsetCBVSRVUAV * incrementSizeCBVSRVUAV);
+                rdt.baseDescriptor       = pHeapCBVSRVUAV->GetGPUDescriptorHandleForHeapStart();
+                rdt.baseDescriptor.ptr += (heapOffsetCBVSRVUAV * incrementSizeCBVSRVUAV);
 
-                mHeapOffsetCBVSRVUAV += static_cast<UINT>(binding.arrayCount);
+                heapOffsetCBVSRVUAV += static_cast<UINT>(binding.arrayCount);
                 rdtCountCBVSRVUAV += 1;
             }
         }
@@ -734,17 +789,108 @@ void CommandBuffer::Dispatch(
     uint32_t groupCountY,
     uint32_t groupCountZ)
 {
+    FlushBarriers();
+
     mCommandList->Dispatch(
         static_cast<UINT>(groupCountX),
         static_cast<UINT>(groupCountY),
         static_cast<UINT>(groupCountZ));
 }
 
+void CommandBuffer::DrawIndirect(
+    const grfx::Buffer* pArgBuffer,
+    uint64_t            offset,
+    uint32_t            drawCount,
+    uint32_t            stride)
+{
+    PPX_ASSERT_NULL_ARG(pArgBuffer);
+    PPX_ASSERT_MSG(stride >= sizeof(D3D12_DRAW_ARGUMENTS), "stride is smaller than D3D12_DRAW_ARGUMENTS");
+
+    ID3D12CommandSignature* pSignature = ToApi(GetDevice())->GetIndirectCommandSignature(D3D12_INDIRECT_ARGUMENT_TYPE_DRAW, static_cast<UINT>(stride));
+    PPX_ASSERT_MSG(!IsNull(pSignature), "failed getting draw command signature");
+
+    mCommandList->ExecuteIndirect(
+        pSignature,
+        static_cast<UINT>(drawCount),
+        ToApi(pArgBuffer)->GetDxResource(),
+        static_cast<UINT64>(offset),
+        nullptr,
+        0);
+}
+
+void CommandBuffer::DrawIndexedIndirect(
+    const grfx::Buffer* pArgBuffer,
+    uint64_t            offset,
+    uint32_t            drawCount,
+    uint32_t            stride)
+{
+    PPX_ASSERT_NULL_ARG(pArgBuffer);
+    PPX_ASSERT_MSG(stride >= sizeof(D3D12_DRAW_INDEXED_ARGUMENTS), "stride is smaller than D3D12_DRAW_INDEXED_ARGUMENTS");
+
+    ID3D12CommandSignature* pSignature = ToApi(GetDevice())->GetIndirectCommandSignature(D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED, static_cast<UINT>(stride));
+    PPX_ASSERT_MSG(!IsNull(pSignature), "failed getting draw indexed command signature");
+
+    mCommandList->ExecuteIndirect(
+        pSignature,
+        static_cast<UINT>(drawCount),
+        ToApi(pArgBuffer)->GetDxResource(),
+        static_cast<UINT64>(offset),
+        nullptr,
+        0);
+}
+
+void CommandBuffer::DrawIndexedIndirectCount(
+    const grfx::Buffer* pArgBuffer,
+    uint64_t            offset,
+    const grfx::Buffer* pCountBuffer,
+    uint64_t            countOffset,
+    uint32_t            maxDrawCount,
+    uint32_t            stride)
+{
+    PPX_ASSERT_NULL_ARG(pArgBuffer);
+    PPX_ASSERT_NULL_ARG(pCountBuffer);
+    PPX_ASSERT_MSG(stride >= sizeof(D3D12_DRAW_INDEXED_ARGUMENTS), "stride is smaller than D3D12_DRAW_INDEXED_ARGUMENTS");
+
+    ID3D12CommandSignature* pSignature = ToApi(GetDevice())->GetIndirectCommandSignature(D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED, static_cast<UINT>(stride));
+    PPX_ASSERT_MSG(!IsNull(pSignature), "failed getting draw indexed command signature");
+
+    // ExecuteIndirect uses min(maxDrawCount, *pCountBuffer) when a count buffer is supplied
+    mCommandList->ExecuteIndirect(
+        pSignature,
+        static_cast<UINT>(maxDrawCount),
+        ToApi(pArgBuffer)->GetDxResource(),
+        static_cast<UINT64>(offset),
+        ToApi(pCountBuffer)->GetDxResource(),
+        static_cast<UINT64>(countOffset));
+}
+
+void CommandBuffer::DispatchIndirect(
+    const grfx::Buffer* pArgBuffer,
+    uint64_t            offset)
+{
+    FlushBarriers();
+
+    PPX_ASSERT_NULL_ARG(pArgBuffer);
+
+    ID3D12CommandSignature* pSignature = ToApi(GetDevice())->GetIndirectCommandSignature(D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH, static_cast<UINT>(sizeof(D3D12_DISPATCH_ARGUMENTS)));
+    PPX_ASSERT_MSG(!IsNull(pSignature), "failed getting dispatch command signature");
+
+    mCommandList->ExecuteIndirect(
+        pSignature,
+        1,
+        ToApi(pArgBuffer)->GetDxResource(),
+        static_cast<UINT64>(offset),
+        nullptr,
+        0);
+}
+
 void CommandBuffer::CopyBufferToBuffer(
     const grfx::BufferToBufferCopyInfo* pCopyInfo,
     grfx::Buffer*                       pSrcBuffer,
     grfx::Buffer*                       pDstBuffer)
 {
+    FlushBarriers();
+
     mCommandList->CopyBufferRegion(
         ToApi(pDstBuffer)->GetDxResource(),
         static_cast<UINT64>(pCopyInfo->dstBuffer.offset),
@@ -768,6 +914,8 @@ void CommandBuffer::CopyBufferToImage(
     grfx::Buffer*                      pSrcBuffer,
     grfx::Image*                       pDstImage)
 {
+    FlushBarriers();
+
     D3D12DevicePtr      device        = ToApi(GetDevice())->GetDxDevice();
     D3D12_RESOURCE_DESC resouceDesc   = ToApi(pDstImage)->GetDxResource()->GetDesc();
     const uint32_t      mipLevelCount = pDstImage->GetMipLevelCount();
@@ -829,6 +977,8 @@ grfx::ImageToBufferOutputPitch CommandBuffer::CopyImageToBuffer(
     grfx::Image*                       pSrcImage,
     grfx::Buffer*                      pDstBuffer)
 {
+    FlushBarriers();
+
     D3D12DevicePtr      device      = ToApi(GetDevice())->GetDxDevice();
     D3D12_RESOURCE_DESC resouceDesc = ToApi(pSrcImage)->GetDxResource()->GetDesc();
 
@@ -907,6 +1057,8 @@ void CommandBuffer::CopyImageToImage(
     grfx::Image*                      pSrcImage,
     grfx::Image*                      pDstImage)
 {
+    FlushBarriers();
+
     bool isSourceDepthStencil = grfx::GetFormatDescription(pSrcImage->GetFormat())->aspect == grfx::FORMAT_ASPECT_DEPTH_STENCIL;
     bool isDestDepthStencil   = grfx::GetFormatDescription(pDstImage->GetFormat())->aspect == grfx::FORMAT_ASPECT_DEPTH_STENCIL;
     PPX_ASSERT_MSG(isSourceDepthStencil == isDestDepthStencil, "both images in an image copy must be depth-stencil if one is depth-stencil");
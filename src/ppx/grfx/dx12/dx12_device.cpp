@@ -259,6 +259,8 @@ Result Device::CreateApiObjects(const grfx::DeviceCreateInfo* pCreateInfo)
 
 void Device::DestroyApiObjects()
 {
+    mIndirectCommandSignatures.clear();
+
     mFnD3D12CreateRootSignatureDeserializer          = nullptr;
     mFnD3D12SerializeVersionedRootSignature          = nullptr;
     mFnD3D12CreateVersionedRootSignatureDeserializer = nullptr;
@@ -633,6 +635,66 @@ bool Device::FragmentStoresAndAtomicsSupported() const
     return true;
 }
 
+bool Device::MultiDrawIndirectSupported() const
+{
+    return true;
+}
+
+bool Device::DrawIndirectCountSupported() const
+{
+    return true;
+}
+
+bool Device::StorageImageWriteSupported(grfx::Format format) const
+{
+    D3D12_FEATURE_DATA_FORMAT_SUPPORT formatSupport = {};
+    formatSupport.Format                            = dx::ToDxgiFormat(format);
+
+    HRESULT hr = mDevice->CheckFeatureSupport(
+        D3D12_FEATURE_FORMAT_SUPPORT,
+        &formatSupport,
+        sizeof(formatSupport));
+    if (FAILED(hr)) {
+        return false;
+    }
+
+    return ((formatSupport.Support1 & D3D12_FORMAT_SUPPORT1_TYPED_UNORDERED_ACCESS_VIEW) != 0) &&
+           ((formatSupport.Support2 & D3D12_FORMAT_SUPPORT2_UAV_TYPED_STORE) != 0);
+}
+
+ID3D12CommandSignature* Device::GetIndirectCommandSignature(D3D12_INDIRECT_ARGUMENT_TYPE type, UINT stride)
+{
+    const uint64_t key = (static_cast<uint64_t>(type) << 32) | static_cast<uint64_t>(stride);
+
+    std::lock_guard<std::mutex> lock(mIndirectCommandSignatureMutex);
+
+    auto it = mIndirectCommandSignatures.find(key);
+    if (it != mIndirectCommandSignatures.end()) {
+        return it->second.Get();
+    }
+
+    D3D12_INDIRECT_ARGUMENT_DESC argumentDesc = {};
+    argumentDesc.Type                         = type;
+
+    D3D12_COMMAND_SIGNATURE_DESC desc = {};
+    desc.ByteStride                   = stride;
+    desc.NumArgumentDescs             = 1;
+    desc.pArgumentDescs               = &argumentDesc;
+    desc.NodeMask                     = 0;
+
+    // Root signature must be null since the signature only changes draw/dispatch arguments
+    D3D12CommandSignaturePtr signature;
+    HRESULT                  hr = mDevice->CreateCommandSignature(&desc, nullptr, IID_PPV_ARGS(&signature));
+    if (FAILED(hr)) {
+        PPX_ASSERT_MSG(false, "ID3D12Device::CreateCommandSignature failed");
+        return nullptr;
+    }
+    PPX_LOG_OBJECT_CREATION(D3D12CommandSignature, signature.Get());
+
+    mIndirectCommandSignatures[key] = signature;
+    return signature.Get();
+}
+
 } // namespace dx12
 } // namespace grfx
 } // namespace ppx
@@ -92,9 +92,12 @@ Result Queue::Submit(const grfx::SubmitInfo* pSubmitInfo)
         }
     }
 
-    mCommandQueue->ExecuteCommandLists(
-        static_cast<UINT>(pSubmitInfo->commandBufferCount),
-        mListBuffer.data());
+    // A submit without command buffers only waits and signals
+    if (pSubmitInfo->commandBufferCount > 0) {
+        mCommandQueue->ExecuteCommandLists(
+            static_cast<UINT>(pSubmitInfo->commandBufferCount),
+            mListBuffer.data());
+    }
 
     for (uint32_t i = 0; i < pSubmitInfo->signalSemaphoreCount; ++i) {
         ID3D12Fence* pDxFence = ToApi(pSubmitInfo->ppSignalSemaphores[i])->GetDxFence();
@@ -306,6 +306,7 @@ Result Swapchain::CreateColorImages(uint32_t width, uint32_t height, grfx::Forma
         imageCreateInfo.usageFlags.bits.sampled         = true;
         imageCreateInfo.usageFlags.bits.storage         = true;
         imageCreateInfo.usageFlags.bits.colorAttachment = true;
+        imageCreateInfo.initialState                    = grfx::RESOURCE_STATE_PRESENT;
         imageCreateInfo.pApiObject                      = colorImages[i];
 
         grfx::ImagePtr image;
@@ -68,7 +68,10 @@ Result Fence::Wait(uint64_t timeout)
         mFence->SetEventOnCompletion(mValue, mFenceEventHandle);
 
         DWORD dwMillis = (timeout == UINT64_MAX) ? INFINITE : static_cast<DWORD>(timeout / 1000000ULL);
-        WaitForSingleObjectEx(mFenceEventHandle, dwMillis, false);
+        DWORD waitResult = WaitForSingleObjectEx(mFenceEventHandle, dwMillis, false);
+        if (waitResult == WAIT_TIMEOUT) {
+            return ppx::ERROR_WAIT_TIMED_OUT;
+        }
     }
     return ppx::SUCCESS;
 }
@@ -295,6 +295,7 @@ D3D12_RESOURCE_STATES ToD3D12ResourceStates(grfx::ResourceState value, grfx::Com
         case grfx::RESOURCE_STATE_RESOLVE_DST               : return D3D12_RESOURCE_STATE_RESOLVE_DEST; break;
         case grfx::RESOURCE_STATE_PRESENT                   : return D3D12_RESOURCE_STATE_PRESENT; break;
         case grfx::RESOURCE_STATE_UNORDERED_ACCESS          : return D3D12_RESOURCE_STATE_UNORDERED_ACCESS; break;
+        case grfx::RESOURCE_STATE_INDIRECT_ARGUMENT         : return D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT; break;
     }
     // clang-format on
     return ppx::InvalidValue<D3D12_RESOURCE_STATES>();
@@ -30,11 +30,52 @@ CommandType CommandPool::GetCommandType() const
     return mCreateInfo.pQueue->GetCommandType();
 }
 
+Result CommandBuffer::Begin(const grfx::CommandBufferInheritanceInfo* pInheritanceInfo)
+{
+    if (IsSecondary()) {
+        if (IsNull(pInheritanceInfo) || IsNull(pInheritanceInfo->pRenderPass)) {
+            PPX_ASSERT_MSG(false, "secondary command buffers must be begun with the render pass they continue");
+            return ppx::ERROR_UNEXPECTED_NULL_ARGUMENT;
+        }
+    }
+
+    // Tracked resource states carry over, see class comment
+    mStateTracker.ClearPendingBarriers();
+    mBarrierCount      = 0;
+    mBarrierBatchCount = 0;
+
+    Result ppxres = BeginImpl(pInheritanceInfo);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    // Secondary command buffers are recorded entirely inside the render
+    // pass they continue, this keeps render pass checks working for them.
+    mCurrentRenderPass                = IsSecondary() ? pInheritanceInfo->pRenderPass : nullptr;
+    mCurrentRenderPassUsesSecondaries = false;
+
+    return ppx::SUCCESS;
+}
+
+Result CommandBuffer::End()
+{
+    FlushBarriers();
+
+    if (IsSecondary()) {
+        mCurrentRenderPass = nullptr;
+    }
+
+    return EndImpl();
+}
+
 void CommandBuffer::BeginRenderPass(const grfx::RenderPassBeginInfo* pBeginInfo)
 {
     if (!IsNull(mCurrentRenderPass)) {
         PPX_ASSERT_MSG(false, "cannot nest render passes");
     }
+    if (IsSecondary()) {
+        PPX_ASSERT_MSG(false, "secondary command buffers cannot begin render passes");
+    }
 
     uint32_t rtvCount   = pBeginInfo->pRenderPass->GetRenderTargetCount();
     uint32_t clearCount = pBeginInfo->RTVClearCount;
@@ -42,8 +83,11 @@ void CommandBuffer::BeginRenderPass(const grfx::RenderPassBeginInfo* pBeginInfo)
         PPX_ASSERT_MSG(false, "clear count cannot less than RTV count");
     }
 
+    FlushBarriers();
+
     BeginRenderPassImpl(pBeginInfo);
-    mCurrentRenderPass = pBeginInfo->pRenderPass;
+    mCurrentRenderPass                = pBeginInfo->pRenderPass;
+    mCurrentRenderPassUsesSecondaries = pBeginInfo->secondaryCommandBuffers;
 }
 
 void CommandBuffer::EndRenderPass()
@@ -51,9 +95,248 @@ void CommandBuffer::EndRenderPass()
     if (IsNull(mCurrentRenderPass)) {
         PPX_ASSERT_MSG(false, "no render pass to end");
     }
+    if (IsSecondary()) {
+        PPX_ASSERT_MSG(false, "secondary command buffers cannot end render passes");
+    }
 
     EndRenderPassImpl();
-    mCurrentRenderPass = nullptr;
+    mCurrentRenderPass                = nullptr;
+    mCurrentRenderPassUsesSecondaries = false;
+}
+
+void CommandBuffer::ExecuteCommands(
+    uint32_t                          commandBufferCount,
+    const grfx::CommandBuffer* const* ppCommandBuffers)
+{
+    PPX_ASSERT_MSG(!IsSecondary(), "secondary command buffers cannot execute other command buffers");
+    PPX_ASSERT_MSG(!IsNull(mCurrentRenderPass) && mCurrentRenderPassUsesSecondaries, "ExecuteCommands requires a render pass begun with secondaryCommandBuffers");
+
+    if (commandBufferCount == 0) {
+        return;
+    }
+    PPX_ASSERT_NULL_ARG(ppCommandBuffers);
+
+    for (uint32_t i = 0; i < commandBufferCount; ++i) {
+        PPX_ASSERT_MSG(!IsNull(ppCommandBuffers[i]) && ppCommandBuffers[i]->IsSecondary(), "ppCommandBuffers[" << i << "] is not a secondary command buffer");
+    }
+
+    ExecuteCommandsImpl(commandBufferCount, ppCommandBuffers);
+}
+
+void CommandBuffer::TransitionImageLayout(
+    const grfx::Image*  pImage,
+    uint32_t            mipLevel,
+    uint32_t            mipLevelCount,
+    uint32_t            arrayLayer,
+    uint32_t            arrayLayerCount,
+    grfx::ResourceState beforeState,
+    grfx::ResourceState afterState,
+    const grfx::Queue*  pSrcQueue,
+    const grfx::Queue*  pDstQueue)
+{
+    PPX_ASSERT_NULL_ARG(pImage);
+
+    if ((!IsNull(pSrcQueue) && IsNull(pDstQueue)) || (IsNull(pSrcQueue) && !IsNull(pDstQueue))) {
+        PPX_ASSERT_MSG(false, "queue family transfer requires both pSrcQueue and pDstQueue to be NOT NULL");
+    }
+
+    if (mipLevelCount == PPX_REMAINING_MIP_LEVELS) {
+        mipLevelCount = pImage->GetMipLevelCount() - mipLevel;
+    }
+
+    if (arrayLayerCount == PPX_REMAINING_ARRAY_LAYERS) {
+        arrayLayerCount = pImage->GetArrayLayerCount() - arrayLayer;
+    }
+
+    // Deferred barriers were requested first
+    FlushBarriers();
+
+    if (mResourceStateTrackingEnabled) {
+        SetResourceState(pImage, mipLevel, mipLevelCount, arrayLayer, arrayLayerCount, afterState);
+    }
+
+    if ((beforeState == afterState) && (pSrcQueue == pDstQueue) && !grfx::IsUnorderedAccessBarrier(beforeState, afterState)) {
+        return;
+    }
+
+    grfx::ImageBarrier barrier = {};
+    barrier.pImage             = pImage;
+    barrier.mipLevel           = mipLevel;
+    barrier.mipLevelCount      = mipLevelCount;
+    barrier.arrayLayer         = arrayLayer;
+    barrier.arrayLayerCount    = arrayLayerCount;
+    barrier.beforeState        = beforeState;
+    barrier.afterState         = afterState;
+    barrier.pSrcQueue          = pSrcQueue;
+    barrier.pDstQueue          = pDstQueue;
+
+    RecordBarriers(1, &barrier, 0, nullptr);
+}
+
+void CommandBuffer::BufferResourceBarrier(
+    const grfx::Buffer* pBuffer,
+    grfx::ResourceState beforeState,
+    grfx::ResourceState afterState,
+    const grfx::Queue*  pSrcQueue,
+    const grfx::Queue*  pDstQueue)
+{
+    PPX_ASSERT_NULL_ARG(pBuffer);
+
+    if ((!IsNull(pSrcQueue) && IsNull(pDstQueue)) || (IsNull(pSrcQueue) && !IsNull(pDstQueue))) {
+        PPX_ASSERT_MSG(false, "queue family transfer requires both pSrcQueue and pDstQueue to be NOT NULL");
+    }
+
+    // Deferred barriers were requested first
+    FlushBarriers();
+
+    if (mResourceStateTrackingEnabled) {
+        SetResourceState(pBuffer, afterState);
+    }
+
+    if ((beforeState == afterState) && (pSrcQueue == pDstQueue) && !grfx::IsUnorderedAccessBarrier(beforeState, afterState)) {
+        return;
+    }
+
+    grfx::BufferBarrier barrier = {};
+    barrier.pBuffer             = pBuffer;
+    barrier.beforeState         = beforeState;
+    barrier.afterState          = afterState;
+    barrier.pSrcQueue           = pSrcQueue;
+    barrier.pDstQueue           = pDstQueue;
+
+    RecordBarriers(0, nullptr, 1, &barrier);
+}
+
+void CommandBuffer::RecordBarriers(
+    uint32_t                   imageBarrierCount,
+    const grfx::ImageBarrier*  pImageBarriers,
+    uint32_t                   bufferBarrierCount,
+    const grfx::BufferBarrier* pBufferBarriers)
+{
+    if ((imageBarrierCount == 0) && (bufferBarrierCount == 0)) {
+        return;
+    }
+    PPX_ASSERT_MSG(!IsSecondary(), "secondary command buffers cannot record barriers");
+
+    ResourceBarrierImpl(imageBarrierCount, pImageBarriers, bufferBarrierCount, pBufferBarriers);
+
+    mBarrierCount += imageBarrierCount + bufferBarrierCount;
+    mBarrierBatchCount += 1;
+}
+
+void CommandBuffer::SetResourceStateTrackingEnabled(bool enabled)
+{
+    if (!enabled) {
+        FlushBarriers();
+        mStateTracker.Reset();
+    }
+    mResourceStateTrackingEnabled = enabled;
+}
+
+void CommandBuffer::SetResourceState(
+    const grfx::Image*  pImage,
+    uint32_t            mipLevel,
+    uint32_t            mipLevelCount,
+    uint32_t            arrayLayer,
+    uint32_t            arrayLayerCount,
+    grfx::ResourceState state)
+{
+    mStateTracker.SetState(pImage, mipLevel, mipLevelCount, arrayLayer, arrayLayerCount, state);
+}
+
+void CommandBuffer::SetResourceState(
+    const grfx::Buffer* pBuffer,
+    grfx::ResourceState state)
+{
+    mStateTracker.SetState(pBuffer, state);
+}
+
+grfx::ResourceState CommandBuffer::GetResourceState(
+    const grfx::Image* pImage,
+    uint32_t           mipLevel,
+    uint32_t           arrayLayer) const
+{
+    return mStateTracker.GetState(pImage, mipLevel, arrayLayer);
+}
+
+grfx::ResourceState CommandBuffer::GetResourceState(const grfx::Buffer* pBuffer) const
+{
+    return mStateTracker.GetState(pBuffer);
+}
+
+void CommandBuffer::RequireResourceState(
+    const grfx::Image*  pImage,
+    uint32_t            mipLevel,
+    uint32_t            mipLevelCount,
+    uint32_t            arrayLayer,
+    uint32_t            arrayLayerCount,
+    grfx::ResourceState state)
+{
+    PPX_ASSERT_NULL_ARG(pImage);
+    PPX_ASSERT_MSG(mResourceStateTrackingEnabled, "resource state tracking is not enabled");
+    PPX_ASSERT_MSG(IsNull(mCurrentRenderPass), "resource states cannot be changed inside a render pass");
+
+    mStateTracker.Require(pImage, mipLevel, mipLevelCount, arrayLayer, arrayLayerCount, state);
+}
+
+void CommandBuffer::RequireResourceState(
+    const grfx::Buffer* pBuffer,
+    grfx::ResourceState state)
+{
+    PPX_ASSERT_NULL_ARG(pBuffer);
+    PPX_ASSERT_MSG(mResourceStateTrackingEnabled, "resource state tracking is not enabled");
+    PPX_ASSERT_MSG(IsNull(mCurrentRenderPass), "resource states cannot be changed inside a render pass");
+
+    mStateTracker.Require(pBuffer, state);
+}
+
+void CommandBuffer::RequireResourceState(
+    const grfx::RenderPass* pRenderPass,
+    grfx::ResourceState     renderTargetState,
+    grfx::ResourceState     depthStencilTargetState)
+{
+    PPX_ASSERT_NULL_ARG(pRenderPass);
+
+    const uint32_t n = pRenderPass->GetRenderTargetCount();
+    for (uint32_t i = 0; i < n; ++i) {
+        RequireResourceState(pRenderPass->GetRenderTargetImage(i), PPX_ALL_SUBRESOURCES, renderTargetState);
+    }
+
+    if (pRenderPass->HasDepthStencil()) {
+        RequireResourceState(pRenderPass->GetDepthStencilImage(), PPX_ALL_SUBRESOURCES, depthStencilTargetState);
+    }
+}
+
+void CommandBuffer::RequireResourceState(
+    const grfx::DrawPass* pDrawPass,
+    grfx::ResourceState   renderTargetState,
+    grfx::ResourceState   depthStencilTargetState)
+{
+    PPX_ASSERT_NULL_ARG(pDrawPass);
+
+    const uint32_t n = pDrawPass->GetRenderTargetCount();
+    for (uint32_t i = 0; i < n; ++i) {
+        RequireResourceState(pDrawPass->GetRenderTargetTexture(i)->GetImage(), PPX_ALL_SUBRESOURCES, renderTargetState);
+    }
+
+    if (pDrawPass->HasDepthStencil()) {
+        RequireResourceState(pDrawPass->GetDepthStencilTexture()->GetImage(), PPX_ALL_SUBRESOURCES, depthStencilTargetState);
+    }
+}
+
+void CommandBuffer::FlushBarriers()
+{
+    if (!mStateTracker.HasPendingBarriers()) {
+        return;
+    }
+
+    mStateTracker.TakePendingBarriers(&mFlushImageBarriers, &mFlushBufferBarriers);
+
+    RecordBarriers(
+        CountU32(mFlushImageBarriers),
+        DataPtr(mFlushImageBarriers),
+        CountU32(mFlushBufferBarriers),
+        DataPtr(mFlushBufferBarriers));
 }
 
 void CommandBuffer::BeginRenderPass(const grfx::RenderPass* pRenderPass)
@@ -148,6 +431,23 @@ void CommandBuffer::TransitionImageLayout(
         pDstQueue);
 }
 
+void CommandBuffer::RequireResourceState(
+    const grfx::Texture* pTexture,
+    uint32_t             mipLevel,
+    uint32_t             mipLevelCount,
+    uint32_t             arrayLayer,
+    uint32_t             arrayLayerCount,
+    grfx::ResourceState  state)
+{
+    RequireResourceState(
+        pTexture->GetImage(),
+        mipLevel,
+        mipLevelCount,
+        arrayLayer,
+        arrayLayerCount,
+        state);
+}
+
 void CommandBuffer::TransitionImageLayout(
     grfx::DrawPass*     pDrawPass,
     grfx::ResourceState renderTargetBeforeState,
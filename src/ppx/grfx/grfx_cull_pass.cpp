@@ -0,0 +1,686 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ppx/grfx/grfx_cull_pass.h"
+#include "ppx/grfx/grfx_device.h"
+#include "ppx/mipmap.h"
+
+namespace ppx {
+namespace grfx {
+
+// Must match CULL_FLAG_* in basic/shaders/CullPass.hlsl
+enum CullFlagBits
+{
+    CULL_FLAG_COMPACT   = 0x1,
+    CULL_FLAG_OCCLUSION = 0x2,
+};
+
+// Must match CullParams in basic/shaders/CullPass.hlsl
+struct CullParams
+{
+    float4x4 viewProjection;
+    uint32_t instanceCount;
+    uint32_t flags;
+    uint32_t hiZMipCount;
+    uint32_t _pad0;
+    float2   hiZSize;
+};
+
+// Must match HiZParams in basic/shaders/CullPassHiZ.hlsl
+struct HiZParams
+{
+    uint2 srcSize;
+    uint2 dstSize;
+};
+
+// Must match InstanceBounds in basic/shaders/CullPass.hlsl
+struct InstanceBounds
+{
+    float3   min;
+    uint32_t _pad0;
+    float3   max;
+    uint32_t _pad1;
+};
+
+// Shader registers
+enum
+{
+    CULL_PARAMS_REGISTER         = 0,
+    CULL_BOUNDS_REGISTER         = 1,
+    CULL_DRAW_TEMPLATES_REGISTER = 2,
+    CULL_DRAW_ARGS_REGISTER      = 3,
+    CULL_DRAW_COUNT_REGISTER     = 4,
+    CULL_HIZ_REGISTER            = 5,
+    HIZ_PARAMS_REGISTER          = 0,
+    HIZ_SRC_REGISTER             = 1,
+    HIZ_DST_REGISTER             = 2,
+};
+
+static constexpr uint32_t kCullThreadGroupSize = 64;
+static constexpr uint32_t kHiZThreadGroupSize  = 8;
+
+Result CullPass::CreateApiObjects(const grfx::CullPassCreateInfo* pCreateInfo)
+{
+    PPX_ASSERT_NULL_ARG(pCreateInfo);
+    PPX_ASSERT_NULL_ARG(pCreateInfo->CS.pModule);
+
+    if (pCreateInfo->maxInstanceCount == 0) {
+        PPX_ASSERT_MSG(false, "maxInstanceCount must be greater than zero");
+        return ppx::ERROR_INVALID_CREATE_ARGUMENT;
+    }
+
+    const bool enableHiZ = !IsNull(pCreateInfo->HiZCS.pModule) && (pCreateInfo->depthWidth > 0) && (pCreateInfo->depthHeight > 0);
+
+    mCompactionEnabled = pCreateInfo->enableCompaction && GetDevice()->DrawIndirectCountSupported();
+
+    // Instance buffers
+    {
+        grfx::BufferCreateInfo createInfo             = {};
+        createInfo.size                               = pCreateInfo->maxInstanceCount * sizeof(InstanceBounds);
+        createInfo.structuredElementStride            = sizeof(InstanceBounds);
+        createInfo.usageFlags.bits.roStructuredBuffer = true;
+        createInfo.memoryUsage                        = grfx::MEMORY_USAGE_CPU_TO_GPU;
+        createInfo.initialState                       = grfx::RESOURCE_STATE_SHADER_RESOURCE;
+
+        Result ppxres = GetDevice()->CreateBuffer(&createInfo, &mBoundsBuffer);
+        if (Failed(ppxres)) {
+            PPX_ASSERT_MSG(false, "failed creating bounds buffer");
+            return ppxres;
+        }
+
+        createInfo.size                    = pCreateInfo->maxInstanceCount * sizeof(grfx::DrawIndexedIndirectCommand);
+        createInfo.structuredElementStride = sizeof(grfx::DrawIndexedIndirectCommand);
+
+        ppxres = GetDevice()->CreateBuffer(&createInfo, &mDrawTemplatesBuffer);
+        if (Failed(ppxres)) {
+            PPX_ASSERT_MSG(false, "failed creating draw templates buffer");
+            return ppxres;
+        }
+    }
+
+    // Draw argument buffers
+    {
+        grfx::BufferCreateInfo createInfo             = {};
+        createInfo.size                               = pCreateInfo->maxInstanceCount * sizeof(grfx::DrawIndexedIndirectCommand);
+        createInfo.structuredElementStride            = sizeof(grfx::DrawIndexedIndirectCommand);
+        createInfo.usageFlags.bits.rwStructuredBuffer = true;
+        createInfo.usageFlags.bits.indirectBuffer     = true;
+        createInfo.memoryUsage                        = grfx::MEMORY_USAGE_GPU_ONLY;
+        createInfo.initialState                       = grfx::RESOURCE_STATE_INDIRECT_ARGUMENT;
+
+        Result ppxres = GetDevice()->CreateBuffer(&createInfo, &mDrawArgsBuffer);
+        if (Failed(ppxres)) {
+            PPX_ASSERT_MSG(false, "failed creating draw arguments buffer");
+            return ppxres;
+        }
+
+        // Raw buffers have a minimum size requirement on some implementations
+        createInfo                                  = {};
+        createInfo.size                             = PPX_MINIMUM_STRUCTURED_BUFFER_SIZE;
+        createInfo.usageFlags.bits.rawStorageBuffer = true;
+        createInfo.usageFlags.bits.indirectBuffer   = true;
+        createInfo.usageFlags.bits.transferDst      = true;
+        createInfo.memoryUsage                      = grfx::MEMORY_USAGE_GPU_ONLY;
+        createInfo.initialState                     = grfx::RESOURCE_STATE_INDIRECT_ARGUMENT;
+
+        ppxres = GetDevice()->CreateBuffer(&createInfo, &mDrawCountBuffer);
+        if (Failed(ppxres)) {
+            PPX_ASSERT_MSG(false, "failed creating draw count buffer");
+            return ppxres;
+        }
+
+        createInfo                             = {};
+        createInfo.size                        = PPX_MINIMUM_STRUCTURED_BUFFER_SIZE;
+        createInfo.usageFlags.bits.transferSrc = true;
+        createInfo.memoryUsage                 = grfx::MEMORY_USAGE_CPU_TO_GPU;
+        createInfo.initialState                = grfx::RESOURCE_STATE_COPY_SRC;
+
+        ppxres = GetDevice()->CreateBuffer(&createInfo, &mZeroBuffer);
+        if (Failed(ppxres)) {
+            PPX_ASSERT_MSG(false, "failed creating zero buffer");
+            return ppxres;
+        }
+
+        void* pMappedAddress = nullptr;
+        ppxres               = mZeroBuffer->MapMemory(0, &pMappedAddress);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+        memset(pMappedAddress, 0, static_cast<size_t>(mZeroBuffer->GetSize()));
+        mZeroBuffer->UnmapMemory();
+    }
+
+    // Hi-Z pyramid, a 1x1 placeholder is created if occlusion is disabled
+    // so the cull descriptor set is always complete.
+    {
+        uint32_t width  = enableHiZ ? std::max<uint32_t>(pCreateInfo->depthWidth / 2, 1) : 1;
+        uint32_t height = enableHiZ ? std::max<uint32_t>(pCreateInfo->depthHeight / 2, 1) : 1;
+
+        mHiZMipLevelCount = Mipmap::CalculateLevelCount(width, height);
+
+        grfx::ImageCreateInfo createInfo   = {};
+        createInfo.type                    = grfx::IMAGE_TYPE_2D;
+        createInfo.width                   = width;
+        createInfo.height                  = height;
+        createInfo.depth                   = 1;
+        createInfo.format                  = grfx::FORMAT_R32_FLOAT;
+        createInfo.mipLevelCount           = mHiZMipLevelCount;
+        createInfo.usageFlags.bits.sampled = true;
+        createInfo.usageFlags.bits.storage = true;
+        createInfo.memoryUsage             = grfx::MEMORY_USAGE_GPU_ONLY;
+        createInfo.initialState            = grfx::RESOURCE_STATE_SHADER_RESOURCE;
+
+        Result ppxres = GetDevice()->CreateImage(&createInfo, &mHiZImage);
+        if (Failed(ppxres)) {
+            PPX_ASSERT_MSG(false, "failed creating Hi-Z image");
+            return ppxres;
+        }
+
+        grfx::SampledImageViewCreateInfo viewCreateInfo = grfx::SampledImageViewCreateInfo::GuessFromImage(mHiZImage);
+
+        ppxres = GetDevice()->CreateSampledImageView(&viewCreateInfo, &mHiZSampledView);
+        if (Failed(ppxres)) {
+            PPX_ASSERT_MSG(false, "failed creating Hi-Z sampled image view");
+            return ppxres;
+        }
+
+        if (enableHiZ) {
+            for (uint32_t level = 0; level < mHiZMipLevelCount; ++level) {
+                grfx::SampledImageViewCreateInfo sampledCreateInfo = grfx::SampledImageViewCreateInfo::GuessFromImage(mHiZImage);
+                sampledCreateInfo.mipLevel                         = level;
+                sampledCreateInfo.mipLevelCount                    = 1;
+
+                grfx::SampledImageViewPtr sampledView;
+                ppxres = GetDevice()->CreateSampledImageView(&sampledCreateInfo, &sampledView);
+                if (Failed(ppxres)) {
+                    PPX_ASSERT_MSG(false, "failed creating Hi-Z mip sampled image view");
+                    return ppxres;
+                }
+                mHiZMipSampledViews.push_back(sampledView);
+
+                grfx::StorageImageViewCreateInfo storageCreateInfo = grfx::StorageImageViewCreateInfo::GuessFromImage(mHiZImage);
+                storageCreateInfo.mipLevel                         = level;
+                storageCreateInfo.mipLevelCount                    = 1;
+
+                grfx::StorageImageViewPtr storageView;
+                ppxres = GetDevice()->CreateStorageImageView(&storageCreateInfo, &storageView);
+                if (Failed(ppxres)) {
+                    PPX_ASSERT_MSG(false, "failed creating Hi-Z mip storage image view");
+                    return ppxres;
+                }
+                mHiZMipStorageViews.push_back(storageView);
+            }
+        }
+    }
+
+    // Descriptor pool
+    {
+        uint32_t hiZSetCount = enableHiZ ? (mHiZMipLevelCount - 1 + pCreateInfo->maxDepthViewCount) : 0;
+
+        grfx::DescriptorPoolCreateInfo createInfo = {};
+        createInfo.sampledImage                   = 1 + hiZSetCount;
+        createInfo.storageImage                   = hiZSetCount;
+        createInfo.structuredBuffer               = 3;
+        createInfo.rawStorageBuffer               = 1;
+
+        Result ppxres = GetDevice()->CreateDescriptorPool(&createInfo, &mDescriptorPool);
+        if (Failed(ppxres)) {
+            PPX_ASSERT_MSG(false, "failed creating descriptor pool");
+            return ppxres;
+        }
+    }
+
+    // Cull descriptor set
+    {
+        grfx::DescriptorSetLayoutCreateInfo createInfo = {};
+        createInfo.bindings.push_back(grfx::DescriptorBinding(CULL_BOUNDS_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER));
+        createInfo.bindings.push_back(grfx::DescriptorBinding(CULL_DRAW_TEMPLATES_REGISTER, grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER));
+        createInfo.bindings.push_back(grfx::DescriptorBinding(CULL_DRAW_ARGS_REGISTER, grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER));
+        createInfo.bindings.push_back(grfx::DescriptorBinding(CULL_DRAW_COUNT_REGISTER, grfx::DESCRIPTOR_TYPE_RAW_STORAGE_BUFFER));
+        createInfo.bindings.push_back(grfx::DescriptorBinding(CULL_HIZ_REGISTER, grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE));
+
+        Result ppxres = GetDevice()->CreateDescriptorSetLayout(&createInfo, &mCullDescriptorSetLayout);
+        if (Failed(ppxres)) {
+            PPX_ASSERT_MSG(false, "failed creating cull descriptor set layout");
+            return ppxres;
+        }
+
+        ppxres = GetDevice()->AllocateDescriptorSet(mDescriptorPool, mCullDescriptorSetLayout, &mCullDescriptorSet);
+        if (Failed(ppxres)) {
+            PPX_ASSERT_MSG(false, "failed allocating cull descriptor set");
+            return ppxres;
+        }
+
+        grfx::WriteDescriptor writes[5]  = {};
+        writes[0].binding                = CULL_BOUNDS_REGISTER;
+        writes[0].type                   = grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER;
+        writes[0].bufferOffset           = 0;
+        writes[0].bufferRange            = PPX_WHOLE_SIZE;
+        writes[0].structuredElementCount = pCreateInfo->maxInstanceCount;
+        writes[0].pBuffer                = mBoundsBuffer;
+
+        writes[1].binding                = CULL_DRAW_TEMPLATES_REGISTER;
+        writes[1].type                   = grfx::DESCRIPTOR_TYPE_RO_STRUCTURED_BUFFER;
+        writes[1].bufferOffset           = 0;
+        writes[1].bufferRange            = PPX_WHOLE_SIZE;
+        writes[1].structuredElementCount = pCreateInfo->maxInstanceCount;
+        writes[1].pBuffer                = mDrawTemplatesBuffer;
+
+        writes[2].binding                = CULL_DRAW_ARGS_REGISTER;
+        writes[2].type                   = grfx::DESCRIPTOR_TYPE_RW_STRUCTURED_BUFFER;
+        writes[2].bufferOffset           = 0;
+        writes[2].bufferRange            = PPX_WHOLE_SIZE;
+        writes[2].structuredElementCount = pCreateInfo->maxInstanceCount;
+        writes[2].pBuffer                = mDrawArgsBuffer;
+
+        writes[3].binding      = CULL_DRAW_COUNT_REGISTER;
+        writes[3].type         = grfx::DESCRIPTOR_TYPE_RAW_STORAGE_BUFFER;
+        writes[3].bufferOffset = 0;
+        writes[3].bufferRange  = PPX_WHOLE_SIZE;
+        writes[3].pBuffer      = mDrawCountBuffer;
+
+        writes[4].binding    = CULL_HIZ_REGISTER;
+        writes[4].type       = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        writes[4].pImageView = mHiZSampledView;
+
+        ppxres = mCullDescriptorSet->UpdateDescriptors(5, writes);
+        if (Failed(ppxres)) {
+            PPX_ASSERT_MSG(false, "failed updating cull descriptor set");
+            return ppxres;
+        }
+    }
+
+    // Cull pipeline
+    {
+        grfx::PipelineInterfaceCreateInfo piCreateInfo = {};
+        piCreateInfo.setCount                          = 1;
+        piCreateInfo.sets[0].set                       = 0;
+        piCreateInfo.sets[0].pLayout                   = mCullDescriptorSetLayout;
+        piCreateInfo.pushConstants.count               = sizeof(CullParams) / sizeof(uint32_t);
+        piCreateInfo.pushConstants.binding             = CULL_PARAMS_REGISTER;
+        piCreateInfo.pushConstants.set                 = 0;
+
+        Result ppxres = GetDevice()->CreatePipelineInterface(&piCreateInfo, &mCullPipelineInterface);
+        if (Failed(ppxres)) {
+            PPX_ASSERT_MSG(false, "failed creating cull pipeline interface");
+            return ppxres;
+        }
+
+        grfx::ComputePipelineCreateInfo cpCreateInfo = {};
+        cpCreateInfo.CS                              = {pCreateInfo->CS.pModule, pCreateInfo->CS.entryPoint};
+        cpCreateInfo.pPipelineInterface              = mCullPipelineInterface;
+
+        ppxres = GetDevice()->CreateComputePipeline(&cpCreateInfo, &mCullPipeline);
+        if (Failed(ppxres)) {
+            PPX_ASSERT_MSG(false, "failed creating cull pipeline");
+            return ppxres;
+        }
+    }
+
+    if (!enableHiZ) {
+        return ppx::SUCCESS;
+    }
+
+    // Hi-Z descriptor sets, level 0 sets are allocated on first use in BuildHiZ
+    {
+        grfx::DescriptorSetLayoutCreateInfo createInfo = {};
+        createInfo.bindings.push_back(grfx::DescriptorBinding(HIZ_SRC_REGISTER, grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE));
+        createInfo.bindings.push_back(grfx::DescriptorBinding(HIZ_DST_REGISTER, grfx::DESCRIPTOR_TYPE_STORAGE_IMAGE));
+
+        Result ppxres = GetDevice()->CreateDescriptorSetLayout(&createInfo, &mHiZDescriptorSetLayout);
+        if (Failed(ppxres)) {
+            PPX_ASSERT_MSG(false, "failed creating Hi-Z descriptor set layout");
+            return ppxres;
+        }
+
+        for (uint32_t level = 1; level < mHiZMipLevelCount; ++level) {
+            grfx::DescriptorSetPtr set;
+            ppxres = GetDevice()->AllocateDescriptorSet(mDescriptorPool, mHiZDescriptorSetLayout, &set);
+            if (Failed(ppxres)) {
+                PPX_ASSERT_MSG(false, "failed allocating Hi-Z descriptor set");
+                return ppxres;
+            }
+
+            grfx::WriteDescriptor writes[2] = {};
+            writes[0].binding               = HIZ_SRC_REGISTER;
+            writes[0].type                  = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            writes[0].pImageView            = mHiZMipSampledViews[level - 1];
+            writes[1].binding               = HIZ_DST_REGISTER;
+            writes[1].type                  = grfx::DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            writes[1].pImageView            = mHiZMipStorageViews[level];
+
+            ppxres = set->UpdateDescriptors(2, writes);
+            if (Failed(ppxres)) {
+                PPX_ASSERT_MSG(false, "failed updating Hi-Z descriptor set");
+                return ppxres;
+            }
+            mHiZMipDescriptorSets.push_back(set);
+        }
+    }
+
+    // Hi-Z pipeline
+    {
+        grfx::PipelineInterfaceCreateInfo piCreateInfo = {};
+        piCreateInfo.setCount                          = 1;
+        piCreateInfo.sets[0].set                       = 0;
+        piCreateInfo.sets[0].pLayout                   = mHiZDescriptorSetLayout;
+        piCreateInfo.pushConstants.count               = sizeof(HiZParams) / sizeof(uint32_t);
+        piCreateInfo.pushConstants.binding             = HIZ_PARAMS_REGISTER;
+        piCreateInfo.pushConstants.set                 = 0;
+
+        Result ppxres = GetDevice()->CreatePipelineInterface(&piCreateInfo, &mHiZPipelineInterface);
+        if (Failed(ppxres)) {
+            PPX_ASSERT_MSG(false, "failed creating Hi-Z pipeline interface");
+            return ppxres;
+        }
+
+        grfx::ComputePipelineCreateInfo cpCreateInfo = {};
+        cpCreateInfo.CS                              = {pCreateInfo->HiZCS.pModule, pCreateInfo->HiZCS.entryPoint};
+        cpCreateInfo.pPipelineInterface              = mHiZPipelineInterface;
+
+        ppxres = GetDevice()->CreateComputePipeline(&cpCreateInfo, &mHiZPipeline);
+        if (Failed(ppxres)) {
+            PPX_ASSERT_MSG(false, "failed creating Hi-Z pipeline");
+            return ppxres;
+        }
+    }
+
+    return ppx::SUCCESS;
+}
+
+void CullPass::DestroyApiObjects()
+{
+    if (mHiZPipeline) {
+        GetDevice()->DestroyComputePipeline(mHiZPipeline);
+        mHiZPipeline.Reset();
+    }
+
+    if (mHiZPipelineInterface) {
+        GetDevice()->DestroyPipelineInterface(mHiZPipelineInterface);
+        mHiZPipelineInterface.Reset();
+    }
+
+    for (auto& elem : mHiZDepthDescriptorSets) {
+        GetDevice()->FreeDescriptorSet(elem.second);
+    }
+    mHiZDepthDescriptorSets.clear();
+
+    for (auto& set : mHiZMipDescriptorSets) {
+        GetDevice()->FreeDescriptorSet(set);
+    }
+    mHiZMipDescriptorSets.clear();
+
+    if (mHiZDescriptorSetLayout) {
+        GetDevice()->DestroyDescriptorSetLayout(mHiZDescriptorSetLayout);
+        mHiZDescriptorSetLayout.Reset();
+    }
+
+    if (mCullPipeline) {
+        GetDevice()->DestroyComputePipeline(mCullPipeline);
+        mCullPipeline.Reset();
+    }
+
+    if (mCullPipelineInterface) {
+        GetDevice()->DestroyPipelineInterface(mCullPipelineInterface);
+        mCullPipelineInterface.Reset();
+    }
+
+    if (mCullDescriptorSet) {
+        GetDevice()->FreeDescriptorSet(mCullDescriptorSet);
+        mCullDescriptorSet.Reset();
+    }
+
+    if (mCullDescriptorSetLayout) {
+        GetDevice()->DestroyDescriptorSetLayout(mCullDescriptorSetLayout);
+        mCullDescriptorSetLayout.Reset();
+    }
+
+    if (mDescriptorPool) {
+        GetDevice()->DestroyDescriptorPool(mDescriptorPool);
+        mDescriptorPool.Reset();
+    }
+
+    for (auto& view : mHiZMipStorageViews) {
+        GetDevice()->DestroyStorageImageView(view);
+    }
+    mHiZMipStorageViews.clear();
+
+    for (auto& view : mHiZMipSampledViews) {
+        GetDevice()->DestroySampledImageView(view);
+    }
+    mHiZMipSampledViews.clear();
+
+    if (mHiZSampledView) {
+        GetDevice()->DestroySampledImageView(mHiZSampledView);
+        mHiZSampledView.Reset();
+    }
+
+    if (mHiZImage) {
+        GetDevice()->DestroyImage(mHiZImage);
+        mHiZImage.Reset();
+    }
+
+    if (mZeroBuffer) {
+        GetDevice()->DestroyBuffer(mZeroBuffer);
+        mZeroBuffer.Reset();
+    }
+
+    if (mDrawCountBuffer) {
+        GetDevice()->DestroyBuffer(mDrawCountBuffer);
+        mDrawCountBuffer.Reset();
+    }
+
+    if (mDrawArgsBuffer) {
+        GetDevice()->DestroyBuffer(mDrawArgsBuffer);
+        mDrawArgsBuffer.Reset();
+    }
+
+    if (mDrawTemplatesBuffer) {
+        GetDevice()->DestroyBuffer(mDrawTemplatesBuffer);
+        mDrawTemplatesBuffer.Reset();
+    }
+
+    if (mBoundsBuffer) {
+        GetDevice()->DestroyBuffer(mBoundsBuffer);
+        mBoundsBuffer.Reset();
+    }
+}
+
+Result CullPass::SetInstances(
+    uint32_t                                instanceCount,
+    const ppx::AABB*                        pBounds,
+    const grfx::DrawIndexedIndirectCommand* pDraws)
+{
+    if (instanceCount > mCreateInfo.maxInstanceCount) {
+        PPX_ASSERT_MSG(false, "instanceCount exceeds maxInstanceCount");
+        return ppx::ERROR_OUT_OF_RANGE;
+    }
+    if ((instanceCount > 0) && (IsNull(pBounds) || IsNull(pDraws))) {
+        return ppx::ERROR_UNEXPECTED_NULL_ARGUMENT;
+    }
+
+    void*  pMappedAddress = nullptr;
+    Result ppxres         = mBoundsBuffer->MapMemory(0, &pMappedAddress);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+    InstanceBounds* pDstBounds = static_cast<InstanceBounds*>(pMappedAddress);
+    for (uint32_t i = 0; i < instanceCount; ++i) {
+        pDstBounds[i].min = pBounds[i].GetMin();
+        pDstBounds[i].max = pBounds[i].GetMax();
+    }
+    mBoundsBuffer->UnmapMemory();
+
+    ppxres = mDrawTemplatesBuffer->MapMemory(0, &pMappedAddress);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+    memcpy(pMappedAddress, pDraws, instanceCount * sizeof(grfx::DrawIndexedIndirectCommand));
+    mDrawTemplatesBuffer->UnmapMemory();
+
+    mInstanceCount = instanceCount;
+
+    return ppx::SUCCESS;
+}
+
+void CullPass::Cull(
+    grfx::CommandBuffer* pCommandBuffer,
+    const float4x4&      viewProjectionMatrix,
+    bool                 enableOcclusion)
+{
+    PPX_ASSERT_NULL_ARG(pCommandBuffer);
+
+    if (mInstanceCount == 0) {
+        return;
+    }
+
+    CullParams params     = {};
+    params.viewProjection = viewProjectionMatrix;
+    params.instanceCount  = mInstanceCount;
+    params.flags          = mCompactionEnabled ? CULL_FLAG_COMPACT : 0;
+    params.hiZMipCount    = mHiZMipLevelCount;
+    params.hiZSize        = float2(static_cast<float>(mHiZImage->GetWidth()), static_cast<float>(mHiZImage->GetHeight()));
+    if (enableOcclusion && IsOcclusionSupported() && mHiZValid) {
+        params.flags |= CULL_FLAG_OCCLUSION;
+    }
+
+    // Reset the draw count
+    if (mCompactionEnabled) {
+        pCommandBuffer->BufferResourceBarrier(mDrawCountBuffer, grfx::RESOURCE_STATE_INDIRECT_ARGUMENT, grfx::RESOURCE_STATE_COPY_DST);
+
+        grfx::BufferToBufferCopyInfo copyInfo = {};
+        copyInfo.size                         = sizeof(uint32_t);
+        pCommandBuffer->CopyBufferToBuffer(&copyInfo, mZeroBuffer, mDrawCountBuffer);
+
+        pCommandBuffer->BufferResourceBarrier(mDrawCountBuffer, grfx::RESOURCE_STATE_COPY_DST, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    }
+    pCommandBuffer->BufferResourceBarrier(mDrawArgsBuffer, grfx::RESOURCE_STATE_INDIRECT_ARGUMENT, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+
+    pCommandBuffer->BindComputeDescriptorSets(mCullPipelineInterface, 1, &mCullDescriptorSet);
+    pCommandBuffer->BindComputePipeline(mCullPipeline);
+    pCommandBuffer->PushComputeConstants(mCullPipelineInterface, sizeof(CullParams) / sizeof(uint32_t), &params);
+    pCommandBuffer->Dispatch((mInstanceCount + kCullThreadGroupSize - 1) / kCullThreadGroupSize, 1, 1);
+
+    pCommandBuffer->BufferResourceBarrier(mDrawArgsBuffer, grfx::RESOURCE_STATE_UNORDERED_ACCESS, grfx::RESOURCE_STATE_INDIRECT_ARGUMENT);
+    if (mCompactionEnabled) {
+        pCommandBuffer->BufferResourceBarrier(mDrawCountBuffer, grfx::RESOURCE_STATE_UNORDERED_ACCESS, grfx::RESOURCE_STATE_INDIRECT_ARGUMENT);
+    }
+}
+
+void CullPass::Draw(grfx::CommandBuffer* pCommandBuffer)
+{
+    PPX_ASSERT_NULL_ARG(pCommandBuffer);
+
+    if (mInstanceCount == 0) {
+        return;
+    }
+
+    if (mCompactionEnabled) {
+        pCommandBuffer->DrawIndexedIndirectCount(mDrawArgsBuffer, 0, mDrawCountBuffer, 0, mInstanceCount);
+    }
+    else {
+        pCommandBuffer->DrawIndexedIndirect(mDrawArgsBuffer, 0, mInstanceCount);
+    }
+}
+
+Result CullPass::GetHiZDepthDescriptorSet(const grfx::SampledImageView* pDepthView, grfx::DescriptorSet** ppSet)
+{
+    auto it = mHiZDepthDescriptorSets.find(pDepthView);
+    if (it != mHiZDepthDescriptorSets.end()) {
+        *ppSet = it->second;
+        return ppx::SUCCESS;
+    }
+
+    if (static_cast<uint32_t>(mHiZDepthDescriptorSets.size()) >= mCreateInfo.maxDepthViewCount) {
+        PPX_ASSERT_MSG(false, "too many distinct depth views passed to BuildHiZ, increase maxDepthViewCount");
+        return ppx::ERROR_LIMIT_EXCEEDED;
+    }
+
+    grfx::DescriptorSetPtr set;
+    Result                 ppxres = GetDevice()->AllocateDescriptorSet(mDescriptorPool, mHiZDescriptorSetLayout, &set);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    grfx::WriteDescriptor writes[2] = {};
+    writes[0].binding               = HIZ_SRC_REGISTER;
+    writes[0].type                  = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    writes[0].pImageView            = pDepthView;
+    writes[1].binding               = HIZ_DST_REGISTER;
+    writes[1].type                  = grfx::DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    writes[1].pImageView            = mHiZMipStorageViews[0];
+
+    ppxres = set->UpdateDescriptors(2, writes);
+    if (Failed(ppxres)) {
+        GetDevice()->FreeDescriptorSet(set);
+        return ppxres;
+    }
+
+    mHiZDepthDescriptorSets[pDepthView] = set;
+
+    *ppSet = set;
+    return ppx::SUCCESS;
+}
+
+void CullPass::BuildHiZ(
+    grfx::CommandBuffer*          pCommandBuffer,
+    const grfx::SampledImageView* pDepthView)
+{
+    PPX_ASSERT_NULL_ARG(pCommandBuffer);
+    PPX_ASSERT_NULL_ARG(pDepthView);
+
+    if (!IsOcclusionSupported()) {
+        return;
+    }
+
+    grfx::DescriptorSet* pDepthSet = nullptr;
+    if (Failed(GetHiZDepthDescriptorSet(pDepthView, &pDepthSet))) {
+        return;
+    }
+
+    pCommandBuffer->BindComputePipeline(mHiZPipeline);
+
+    uint32_t srcWidth  = mCreateInfo.depthWidth;
+    uint32_t srcHeight = mCreateInfo.depthHeight;
+    for (uint32_t level = 0; level < mHiZMipLevelCount; ++level) {
+        const uint32_t dstWidth  = std::max<uint32_t>(mHiZImage->GetWidth() >> level, 1);
+        const uint32_t dstHeight = std::max<uint32_t>(mHiZImage->GetHeight() >> level, 1);
+
+        pCommandBuffer->TransitionImageLayout(mHiZImage, level, 1, 0, 1, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+
+        const grfx::DescriptorSet* pSet = (level == 0) ? pDepthSet : mHiZMipDescriptorSets[level - 1].Get();
+        pCommandBuffer->BindComputeDescriptorSets(mHiZPipelineInterface, 1, &pSet);
+
+        HiZParams params = {};
+        params.srcSize   = uint2(srcWidth, srcHeight);
+        params.dstSize   = uint2(dstWidth, dstHeight);
+        pCommandBuffer->PushComputeConstants(mHiZPipelineInterface, sizeof(HiZParams) / sizeof(uint32_t), &params);
+
+        pCommandBuffer->Dispatch(
+            (dstWidth + kHiZThreadGroupSize - 1) / kHiZThreadGroupSize,
+            (dstHeight + kHiZThreadGroupSize - 1) / kHiZThreadGroupSize,
+            1);
+
+        // Next level reads this one
+        pCommandBuffer->TransitionImageLayout(mHiZImage, level, 1, 0, 1, grfx::RESOURCE_STATE_UNORDERED_ACCESS, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+
+        srcWidth  = dstWidth;
+        srcHeight = dstHeight;
+    }
+
+    mHiZValid = true;
+}
+
+} // namespace grfx
+} // namespace ppx
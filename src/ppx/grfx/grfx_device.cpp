@@ -38,6 +38,7 @@ void Device::Destroy()
     DestroyAllObjects(mTransferQueues);
 
     // Destroy helper objects first
+    DestroyAllObjects(mCullPasses);
     DestroyAllObjects(mDrawPasses);
     DestroyAllObjects(mFullscreenQuads);
     DestroyAllObjects(mTextDraws);
@@ -165,6 +166,16 @@ void Device::DestroyAllObjects(std::vector<ObjPtr<ObjectT>>& container)
     container.clear();
 }
 
+Result Device::AllocateObject(grfx::CullPass** ppObject)
+{
+    grfx::CullPass* pObject = new grfx::CullPass();
+    if (IsNull(pObject)) {
+        return ppx::ERROR_ALLOCATION_FAILED;
+    }
+    *ppObject = pObject;
+    return ppx::SUCCESS;
+}
+
 Result Device::AllocateObject(grfx::DrawPass** ppObject)
 {
     grfx::DrawPass* pObject = new grfx::DrawPass();
@@ -264,6 +275,19 @@ void Device::DestroyComputePipeline(const grfx::ComputePipeline* pComputePipelin
     DestroyObject(mComputePipelines, pComputePipeline);
 }
 
+Result Device::CreateCullPass(const grfx::CullPassCreateInfo* pCreateInfo, grfx::CullPass** ppCullPass)
+{
+    PPX_ASSERT_NULL_ARG(pCreateInfo);
+    PPX_ASSERT_NULL_ARG(ppCullPass);
+    return CreateObject(pCreateInfo, mCullPasses, ppCullPass);
+}
+
+void Device::DestroyCullPass(const grfx::CullPass* pCullPass)
+{
+    PPX_ASSERT_NULL_ARG(pCullPass);
+    DestroyObject(mCullPasses, pCullPass);
+}
+
 Result Device::CreateDepthStencilView(const grfx::DepthStencilViewCreateInfo* pCreateInfo, grfx::DepthStencilView** ppDepthStencilView)
 {
     PPX_ASSERT_NULL_ARG(pCreateInfo);
@@ -611,7 +635,8 @@ Result Device::AllocateCommandBuffer(
     const grfx::CommandPool* pPool,
     grfx::CommandBuffer**    ppCommandBuffer,
     uint32_t                 resourceDescriptorCount,
-    uint32_t                 samplerDescriptorCount)
+    uint32_t                 samplerDescriptorCount,
+    grfx::CommandBufferLevel level)
 {
     PPX_ASSERT_NULL_ARG(ppCommandBuffer);
 
@@ -619,6 +644,7 @@ Result Device::AllocateCommandBuffer(
     createInfo.pPool                                   = pPool;
     createInfo.resourceDescriptorCount                 = resourceDescriptorCount;
     createInfo.samplerDescriptorCount                  = samplerDescriptorCount;
+    createInfo.level                                   = level;
 
     return CreateObject(&createInfo, mCommandBuffers, ppCommandBuffer);
 }
@@ -23,6 +23,20 @@ Result Queue::CreateCommandBuffer(
     grfx::CommandBuffer** ppCommandBuffer,
     uint32_t              resourceDescriptorCount,
     uint32_t              samplerDescriptorCount)
+{
+    return CreateCommandBuffer(grfx::COMMAND_BUFFER_LEVEL_PRIMARY, resourceDescriptorCount, samplerDescriptorCount, ppCommandBuffer);
+}
+
+Result Queue::CreateSecondaryCommandBuffer(grfx::CommandBuffer** ppCommandBuffer)
+{
+    return CreateCommandBuffer(grfx::COMMAND_BUFFER_LEVEL_SECONDARY, 0, 0, ppCommandBuffer);
+}
+
+Result Queue::CreateCommandBuffer(
+    grfx::CommandBufferLevel level,
+    uint32_t                 resourceDescriptorCount,
+    uint32_t                 samplerDescriptorCount,
+    grfx::CommandBuffer**    ppCommandBuffer)
 {
     std::lock_guard<std::mutex> lock(mCommandSetMutex);
 
@@ -36,7 +50,7 @@ Result Queue::CreateCommandBuffer(
         return ppxres;
     }
 
-    ppxres = GetDevice()->AllocateCommandBuffer(set.commandPool, &set.commandBuffer, resourceDescriptorCount, samplerDescriptorCount);
+    ppxres = GetDevice()->AllocateCommandBuffer(set.commandPool, &set.commandBuffer, resourceDescriptorCount, samplerDescriptorCount, level);
     if (Failed(ppxres)) {
         GetDevice()->DestroyCommandPool(set.commandPool);
         return ppxres;
@@ -0,0 +1,303 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ppx/grfx/grfx_resource_state_tracker.h"
+#include "ppx/grfx/grfx_buffer.h"
+#include "ppx/grfx/grfx_image.h"
+
+#include <algorithm>
+#include <functional>
+#include <tuple>
+
+namespace ppx {
+namespace grfx {
+
+bool IsUnorderedAccessBarrier(grfx::ResourceState beforeState, grfx::ResourceState afterState)
+{
+    if (beforeState != afterState) {
+        return false;
+    }
+    return (beforeState == grfx::RESOURCE_STATE_UNORDERED_ACCESS) || (beforeState == grfx::RESOURCE_STATE_GENERAL);
+}
+
+void ResourceStateTracker::Reset()
+{
+    mImageStates.clear();
+    mBufferStates.clear();
+    ClearPendingBarriers();
+}
+
+void ResourceStateTracker::ClearPendingBarriers()
+{
+    mPendingImageBarriers.clear();
+    mPendingBufferBarriers.clear();
+}
+
+std::vector<grfx::ResourceState>* ResourceStateTracker::GetImageStates(const grfx::Image* pImage)
+{
+    auto it = mImageStates.find(pImage);
+    if (it == mImageStates.end()) {
+        const uint32_t subresourceCount = pImage->GetMipLevelCount() * pImage->GetArrayLayerCount();
+
+        it = mImageStates.emplace(pImage, std::vector<grfx::ResourceState>(subresourceCount, pImage->GetInitialState())).first;
+    }
+    return &it->second;
+}
+
+void ResourceStateTracker::SetState(
+    const grfx::Image*  pImage,
+    uint32_t            mipLevel,
+    uint32_t            mipLevelCount,
+    uint32_t            arrayLayer,
+    uint32_t            arrayLayerCount,
+    grfx::ResourceState state)
+{
+    PPX_ASSERT_NULL_ARG(pImage);
+
+    if (mipLevelCount == PPX_REMAINING_MIP_LEVELS) {
+        mipLevelCount = pImage->GetMipLevelCount() - mipLevel;
+    }
+
+    if (arrayLayerCount == PPX_REMAINING_ARRAY_LAYERS) {
+        arrayLayerCount = pImage->GetArrayLayerCount() - arrayLayer;
+    }
+
+    std::vector<grfx::ResourceState>& states  = *GetImageStates(pImage);
+    const uint32_t                    mipSpan = pImage->GetMipLevelCount();
+    for (uint32_t i = 0; i < arrayLayerCount; ++i) {
+        for (uint32_t j = 0; j < mipLevelCount; ++j) {
+            states[(arrayLayer + i) * mipSpan + (mipLevel + j)] = state;
+        }
+    }
+}
+
+void ResourceStateTracker::SetState(
+    const grfx::Buffer* pBuffer,
+    grfx::ResourceState state)
+{
+    PPX_ASSERT_NULL_ARG(pBuffer);
+
+    mBufferStates[pBuffer] = state;
+}
+
+grfx::ResourceState ResourceStateTracker::GetState(
+    const grfx::Image* pImage,
+    uint32_t           mipLevel,
+    uint32_t           arrayLayer) const
+{
+    PPX_ASSERT_NULL_ARG(pImage);
+
+    auto it = mImageStates.find(pImage);
+    if (it == mImageStates.end()) {
+        return pImage->GetInitialState();
+    }
+    return it->second[arrayLayer * pImage->GetMipLevelCount() + mipLevel];
+}
+
+grfx::ResourceState ResourceStateTracker::GetState(const grfx::Buffer* pBuffer) const
+{
+    PPX_ASSERT_NULL_ARG(pBuffer);
+
+    auto it = mBufferStates.find(pBuffer);
+    if (it == mBufferStates.end()) {
+        return pBuffer->GetInitialState();
+    }
+    return it->second;
+}
+
+void ResourceStateTracker::Require(
+    const grfx::Image*  pImage,
+    uint32_t            mipLevel,
+    uint32_t            mipLevelCount,
+    uint32_t            arrayLayer,
+    uint32_t            arrayLayerCount,
+    grfx::ResourceState state)
+{
+    PPX_ASSERT_NULL_ARG(pImage);
+
+    if (mipLevelCount == PPX_REMAINING_MIP_LEVELS) {
+        mipLevelCount = pImage->GetMipLevelCount() - mipLevel;
+    }
+
+    if (arrayLayerCount == PPX_REMAINING_ARRAY_LAYERS) {
+        arrayLayerCount = pImage->GetArrayLayerCount() - arrayLayer;
+    }
+
+    std::vector<grfx::ResourceState>& states  = *GetImageStates(pImage);
+    const uint32_t                    mipSpan = pImage->GetMipLevelCount();
+    for (uint32_t i = 0; i < arrayLayerCount; ++i) {
+        for (uint32_t j = 0; j < mipLevelCount; ++j) {
+            const uint32_t       subresourceArrayLayer = arrayLayer + i;
+            const uint32_t       subresourceMipLevel   = mipLevel + j;
+            grfx::ResourceState& currentState          = states[subresourceArrayLayer * mipSpan + subresourceMipLevel];
+            if ((currentState == state) && !IsUnorderedAccessBarrier(currentState, state)) {
+                continue;
+            }
+
+            // Fold into a deferred barrier of the same subresource. A deferred
+            // barrier into the required state already orders earlier writes.
+            auto it = std::find_if(
+                mPendingImageBarriers.begin(),
+                mPendingImageBarriers.end(),
+                [pImage, subresourceMipLevel, subresourceArrayLayer](const grfx::ImageBarrier& barrier) {
+                    return (barrier.pImage == pImage) && (barrier.mipLevel == subresourceMipLevel) && (barrier.arrayLayer == subresourceArrayLayer);
+                });
+
+            if (it != mPendingImageBarriers.end()) {
+                it->afterState = state;
+            }
+            else {
+                grfx::ImageBarrier barrier = {};
+                barrier.pImage             = pImage;
+                barrier.mipLevel           = subresourceMipLevel;
+                barrier.mipLevelCount      = 1;
+                barrier.arrayLayer         = subresourceArrayLayer;
+                barrier.arrayLayerCount    = 1;
+                barrier.beforeState        = currentState;
+                barrier.afterState         = state;
+                mPendingImageBarriers.push_back(barrier);
+            }
+
+            currentState = state;
+        }
+    }
+}
+
+void ResourceStateTracker::Require(
+    const grfx::Buffer* pBuffer,
+    grfx::ResourceState state)
+{
+    PPX_ASSERT_NULL_ARG(pBuffer);
+
+    auto stateIt = mBufferStates.find(pBuffer);
+    if (stateIt == mBufferStates.end()) {
+        stateIt = mBufferStates.emplace(pBuffer, pBuffer->GetInitialState()).first;
+    }
+
+    grfx::ResourceState& currentState = stateIt->second;
+    if ((currentState == state) && !IsUnorderedAccessBarrier(currentState, state)) {
+        return;
+    }
+
+    // Fold into a deferred barrier of the same buffer
+    auto it = std::find_if(
+        mPendingBufferBarriers.begin(),
+        mPendingBufferBarriers.end(),
+        [pBuffer](const grfx::BufferBarrier& barrier) { return barrier.pBuffer == pBuffer; });
+
+    if (it != mPendingBufferBarriers.end()) {
+        it->afterState = state;
+    }
+    else {
+        grfx::BufferBarrier barrier = {};
+        barrier.pBuffer             = pBuffer;
+        barrier.beforeState         = currentState;
+        barrier.afterState          = state;
+        mPendingBufferBarriers.push_back(barrier);
+    }
+
+    currentState = state;
+}
+
+void ResourceStateTracker::TakePendingBarriers(
+    std::vector<grfx::ImageBarrier>*  pImageBarriers,
+    std::vector<grfx::BufferBarrier>* pBufferBarriers)
+{
+    PPX_ASSERT_NULL_ARG(pImageBarriers);
+    PPX_ASSERT_NULL_ARG(pBufferBarriers);
+
+    std::vector<grfx::ImageBarrier>&  imageBarriers  = *pImageBarriers;
+    std::vector<grfx::BufferBarrier>& bufferBarriers = *pBufferBarriers;
+    imageBarriers.swap(mPendingImageBarriers);
+    bufferBarriers.swap(mPendingBufferBarriers);
+    ClearPendingBarriers();
+
+    // Drop transitions that were undone before being taken
+    imageBarriers.erase(
+        std::remove_if(
+            imageBarriers.begin(),
+            imageBarriers.end(),
+            [](const grfx::ImageBarrier& barrier) {
+                return (barrier.beforeState == barrier.afterState) && !IsUnorderedAccessBarrier(barrier.beforeState, barrier.afterState);
+            }),
+        imageBarriers.end());
+    bufferBarriers.erase(
+        std::remove_if(
+            bufferBarriers.begin(),
+            bufferBarriers.end(),
+            [](const grfx::BufferBarrier& barrier) {
+                return (barrier.beforeState == barrier.afterState) && !IsUnorderedAccessBarrier(barrier.beforeState, barrier.afterState);
+            }),
+        bufferBarriers.end());
+
+    // Deferred image barriers cover a single subresource. Sort them so that
+    // equal transitions of neighbouring mip levels are adjacent and merge
+    // those first. Images are ordered with std::less, comparing unrelated
+    // pointers with < is unspecified.
+    std::sort(
+        imageBarriers.begin(),
+        imageBarriers.end(),
+        [](const grfx::ImageBarrier& a, const grfx::ImageBarrier& b) {
+            if (a.pImage != b.pImage) {
+                return std::less<const grfx::Image*>()(a.pImage, b.pImage);
+            }
+            return std::tie(a.beforeState, a.afterState, a.arrayLayer, a.mipLevel) < std::tie(b.beforeState, b.afterState, b.arrayLayer, b.mipLevel);
+        });
+
+    auto isSameTransition = [](const grfx::ImageBarrier& a, const grfx::ImageBarrier& b) {
+        return (a.pImage == b.pImage) && (a.beforeState == b.beforeState) && (a.afterState == b.afterState);
+    };
+
+    size_t count = 0;
+    for (size_t i = 0; i < imageBarriers.size(); ++i) {
+        const grfx::ImageBarrier& barrier = imageBarriers[i];
+        if (count > 0) {
+            grfx::ImageBarrier& last = imageBarriers[count - 1];
+            if (isSameTransition(last, barrier) && (last.arrayLayer == barrier.arrayLayer) && (last.mipLevel + last.mipLevelCount == barrier.mipLevel)) {
+                last.mipLevelCount += barrier.mipLevelCount;
+                continue;
+            }
+        }
+        imageBarriers[count++] = barrier;
+    }
+    imageBarriers.resize(count);
+
+    // Layers with the same mip range are only adjacent when sorted by it
+    std::sort(
+        imageBarriers.begin(),
+        imageBarriers.end(),
+        [](const grfx::ImageBarrier& a, const grfx::ImageBarrier& b) {
+            if (a.pImage != b.pImage) {
+                return std::less<const grfx::Image*>()(a.pImage, b.pImage);
+            }
+            return std::tie(a.beforeState, a.afterState, a.mipLevel, a.mipLevelCount, a.arrayLayer) < std::tie(b.beforeState, b.afterState, b.mipLevel, b.mipLevelCount, b.arrayLayer);
+        });
+
+    count = 0;
+    for (size_t i = 0; i < imageBarriers.size(); ++i) {
+        const grfx::ImageBarrier& barrier = imageBarriers[i];
+        if (count > 0) {
+            grfx::ImageBarrier& last = imageBarriers[count - 1];
+            if (isSameTransition(last, barrier) && (last.mipLevel == barrier.mipLevel) && (last.mipLevelCount == barrier.mipLevelCount) && (last.arrayLayer + last.arrayLayerCount == barrier.arrayLayer)) {
+                last.arrayLayerCount += barrier.arrayLayerCount;
+                continue;
+            }
+        }
+        imageBarriers[count++] = barrier;
+    }
+    imageBarriers.resize(count);
+}
+
+} // namespace grfx
+} // namespace ppx
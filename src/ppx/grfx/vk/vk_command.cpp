@@ -35,7 +35,7 @@ Result CommandBuffer::CreateApiObjects(const grfx::internal::CommandBufferCreate
 {
     VkCommandBufferAllocateInfo vkai = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
     vkai.commandPool                 = ToApi(pCreateInfo->pPool)->GetVkCommandPool();
-    vkai.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    vkai.level                       = (pCreateInfo->level == grfx::COMMAND_BUFFER_LEVEL_SECONDARY) ? VK_COMMAND_BUFFER_LEVEL_SECONDARY : VK_COMMAND_BUFFER_LEVEL_PRIMARY;
     vkai.commandBufferCount          = 1;
 
     VkResult vkres = vk::AllocateCommandBuffers(
@@ -63,9 +63,21 @@ void CommandBuffer::DestroyApiObjects()
     }
 }
 
-Result CommandBuffer::Begin()
+Result CommandBuffer::BeginImpl(const grfx::CommandBufferInheritanceInfo* pInheritanceInfo)
 {
-    VkCommandBufferBeginInfo vkbi = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    VkCommandBufferBeginInfo       vkbi = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    VkCommandBufferInheritanceInfo vkii = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+
+    if (IsSecondary()) {
+        // Render passes that only differ in load ops are compatible, so the
+        // framebuffer is left to the primary's vkCmdBeginRenderPass.
+        vkii.renderPass  = ToApi(pInheritanceInfo->pRenderPass)->GetVkRenderPass();
+        vkii.subpass     = 0;
+        vkii.framebuffer = VK_NULL_HANDLE;
+
+        vkbi.flags            = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        vkbi.pInheritanceInfo = &vkii;
+    }
 
     VkResult vkres = vk::BeginCommandBuffer(mCommandBuffer, &vkbi);
     if (vkres != VK_SUCCESS) {
@@ -76,7 +88,7 @@ Result CommandBuffer::Begin()
     return ppx::SUCCESS;
 }
 
-Result CommandBuffer::End()
+Result CommandBuffer::EndImpl()
 {
     VkResult vkres = vk::EndCommandBuffer(mCommandBuffer);
     if (vkres != VK_SUCCESS) {
@@ -114,7 +126,9 @@ void CommandBuffer::BeginRenderPassImpl(const grfx::RenderPassBeginInfo* pBeginI
     vkbi.clearValueCount       = clearValueCount;
     vkbi.pClearValues          = clearValues;
 
-    vk::CmdBeginRenderPass(mCommandBuffer, &vkbi, VK_SUBPASS_CONTENTS_INLINE);
+    VkSubpassContents contents = pBeginInfo->secondaryCommandBuffers ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+
+    vk::CmdBeginRenderPass(mCommandBuffer, &vkbi, contents);
 }
 
 void CommandBuffer::EndRenderPassImpl()
@@ -122,6 +136,21 @@ void CommandBuffer::EndRenderPassImpl()
     vk::CmdEndRenderPass(mCommandBuffer);
 }
 
+void CommandBuffer::ExecuteCommandsImpl(
+    uint32_t                          commandBufferCount,
+    const grfx::CommandBuffer* const* ppCommandBuffers)
+{
+    std::vector<VkCommandBuffer> commandBuffers(commandBufferCount);
+    for (uint32_t i = 0; i < commandBufferCount; ++i) {
+        commandBuffers[i] = ToApi(ppCommandBuffers[i])->GetVkCommandBuffer();
+    }
+
+    vkCmdExecuteCommands(
+        mCommandBuffer,
+        commandBufferCount,
+        DataPtr(commandBuffers));
+}
+
 void CommandBuffer::PushDescriptorImpl(
     grfx::CommandType              pipelineBindPoint,
     const grfx::PipelineInterface* pInterface,
@@ -216,25 +245,14 @@ void CommandBuffer::PushDescriptorImpl(
         &write);                                  // pDescriptorWrites;
 }
 
-void CommandBuffer::TransitionImageLayout(
-    const grfx::Image*  pImage,
-    uint32_t            mipLevel,
-    uint32_t            mipLevelCount,
-    uint32_t            arrayLayer,
-    uint32_t            arrayLayerCount,
-    grfx::ResourceState beforeState,
-    grfx::ResourceState afterState,
-    const grfx::Queue*  pSrcQueue,
-    const grfx::Queue*  pDstQueue)
+static void ResolveQueueFamilyIndices(
+    const grfx::Queue* pSrcQueue,
+    const grfx::Queue* pDstQueue,
+    uint32_t&          srcQueueFamilyIndex,
+    uint32_t&          dstQueueFamilyIndex)
 {
-    PPX_ASSERT_NULL_ARG(pImage);
-
-    if ((!IsNull(pSrcQueue) && IsNull(pDstQueue)) || (IsNull(pSrcQueue) && !IsNull(pDstQueue))) {
-        PPX_ASSERT_MSG(false, "queue family transfer requires both pSrcQueue and pDstQueue to be NOT NULL");
-    }
-
-    uint32_t srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    uint32_t dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     if (!IsNull(pSrcQueue)) {
         srcQueueFamilyIndex = ToApi(pSrcQueue)->GetQueueFamilyIndex();
     }
@@ -247,160 +265,154 @@ void CommandBuffer::TransitionImageLayout(
         srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     }
+}
 
-    if (beforeState == afterState && srcQueueFamilyIndex == dstQueueFamilyIndex) {
-        return;
-    }
-
-    if (mipLevelCount == PPX_REMAINING_MIP_LEVELS) {
-        mipLevelCount = pImage->GetMipLevelCount();
-    }
-
-    if (arrayLayerCount == PPX_REMAINING_ARRAY_LAYERS) {
-        arrayLayerCount = pImage->GetArrayLayerCount();
-    }
-
-    const vk::Image* pApiImage = ToApi(pImage);
-
-    VkPipelineStageFlags srcStageMask    = InvalidValue<VkPipelineStageFlags>();
-    VkPipelineStageFlags dstStageMask    = InvalidValue<VkPipelineStageFlags>();
-    VkAccessFlags        srcAccessMask   = InvalidValue<VkAccessFlags>();
-    VkAccessFlags        dstAccessMask   = InvalidValue<VkAccessFlags>();
-    VkImageLayout        oldLayout       = InvalidValue<VkImageLayout>();
-    VkImageLayout        newLayout       = InvalidValue<VkImageLayout>();
-    VkDependencyFlags    dependencyFlags = 0;
-
+void CommandBuffer::ResourceBarrierImpl(
+    uint32_t                   imageBarrierCount,
+    const grfx::ImageBarrier*  pImageBarriers,
+    uint32_t                   bufferBarrierCount,
+    const grfx::BufferBarrier* pBufferBarriers)
+{
     vk::Device* pDevice = ToApi(GetDevice());
 
     grfx::CommandType commandType = GetCommandType();
 
-    Result ppxres = ToVkBarrierSrc(
-        beforeState,
-        commandType,
-        pDevice->GetDeviceFeatures(),
-        srcStageMask,
-        srcAccessMask,
-        oldLayout);
-    PPX_ASSERT_MSG(ppxres == ppx::SUCCESS, "couldn't get src barrier data");
-
-    ppxres = ToVkBarrierDst(
-        afterState,
-        commandType,
-        pDevice->GetDeviceFeatures(),
-        dstStageMask,
-        dstAccessMask,
-        newLayout);
-    PPX_ASSERT_MSG(ppxres == ppx::SUCCESS, "couldn't get dst barrier data");
-
-    VkImageMemoryBarrier barrier            = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
-    barrier.srcAccessMask                   = srcAccessMask;
-    barrier.dstAccessMask                   = dstAccessMask;
-    barrier.oldLayout                       = oldLayout;
-    barrier.newLayout                       = newLayout;
-    barrier.srcQueueFamilyIndex             = srcQueueFamilyIndex;
-    barrier.dstQueueFamilyIndex             = dstQueueFamilyIndex;
-    barrier.image                           = pApiImage->GetVkImage();
-    barrier.subresourceRange.aspectMask     = pApiImage->GetVkImageAspectFlags();
-    barrier.subresourceRange.baseMipLevel   = mipLevel;
-    barrier.subresourceRange.levelCount     = mipLevelCount;
-    barrier.subresourceRange.baseArrayLayer = arrayLayer;
-    barrier.subresourceRange.layerCount     = arrayLayerCount;
+    // All barriers go into a single vkCmdPipelineBarrier, the stage masks
+    // are the union of the stages of the individual barriers.
+    VkPipelineStageFlags srcStageMask    = 0;
+    VkPipelineStageFlags dstStageMask    = 0;
+    VkDependencyFlags    dependencyFlags = 0;
 
-    vk::CmdPipelineBarrier(
-        mCommandBuffer,  // commandBuffer
-        srcStageMask,    // srcStageMask
-        dstStageMask,    // dstStageMask
-        dependencyFlags, // dependencyFlags
-        0,               // memoryBarrierCount
-        nullptr,         // pMemoryBarriers
-        0,               // bufferMemoryBarrierCount
-        nullptr,         // pBufferMemoryBarriers
-        1,               // imageMemoryBarrierCount
-        &barrier);       // pImageMemoryBarriers);
-}
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    imageBarriers.reserve(imageBarrierCount);
+    for (uint32_t i = 0; i < imageBarrierCount; ++i) {
+        const grfx::ImageBarrier& barrierInfo = pImageBarriers[i];
 
-void CommandBuffer::BufferResourceBarrier(
-    const grfx::Buffer* pBuffer,
-    grfx::ResourceState beforeState,
-    grfx::ResourceState afterState,
-    const grfx::Queue*  pSrcQueue,
-    const grfx::Queue*  pDstQueue)
-{
-    PPX_ASSERT_NULL_ARG(pBuffer);
+        uint32_t srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        uint32_t dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        ResolveQueueFamilyIndices(barrierInfo.pSrcQueue, barrierInfo.pDstQueue, srcQueueFamilyIndex, dstQueueFamilyIndex);
 
-    if ((!IsNull(pSrcQueue) && IsNull(pDstQueue)) || (IsNull(pSrcQueue) && !IsNull(pDstQueue))) {
-        PPX_ASSERT_MSG(false, "queue family transfer requires both pSrcQueue and pDstQueue to be NOT NULL");
-    }
+        // UNORDERED_ACCESS and GENERAL barriers between the same states
+        // still order shader writes, see grfx::IsUnorderedAccessBarrier
+        if (barrierInfo.beforeState == barrierInfo.afterState && srcQueueFamilyIndex == dstQueueFamilyIndex && !grfx::IsUnorderedAccessBarrier(barrierInfo.beforeState, barrierInfo.afterState)) {
+            continue;
+        }
 
-    uint32_t srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    uint32_t dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    if (!IsNull(pSrcQueue)) {
-        srcQueueFamilyIndex = ToApi(pSrcQueue)->GetQueueFamilyIndex();
+        const vk::Image* pApiImage = ToApi(barrierInfo.pImage);
+
+        VkPipelineStageFlags barrierSrcStageMask = InvalidValue<VkPipelineStageFlags>();
+        VkPipelineStageFlags barrierDstStageMask = InvalidValue<VkPipelineStageFlags>();
+        VkAccessFlags        srcAccessMask       = InvalidValue<VkAccessFlags>();
+        VkAccessFlags        dstAccessMask       = InvalidValue<VkAccessFlags>();
+        VkImageLayout        oldLayout           = InvalidValue<VkImageLayout>();
+        VkImageLayout        newLayout           = InvalidValue<VkImageLayout>();
+
+        Result ppxres = ToVkBarrierSrc(
+            barrierInfo.beforeState,
+            commandType,
+            pDevice->GetDeviceFeatures(),
+            barrierSrcStageMask,
+            srcAccessMask,
+            oldLayout);
+        PPX_ASSERT_MSG(ppxres == ppx::SUCCESS, "couldn't get src barrier data");
+
+        ppxres = ToVkBarrierDst(
+            barrierInfo.afterState,
+            commandType,
+            pDevice->GetDeviceFeatures(),
+            barrierDstStageMask,
+            dstAccessMask,
+            newLayout);
+        PPX_ASSERT_MSG(ppxres == ppx::SUCCESS, "couldn't get dst barrier data");
+
+        VkImageMemoryBarrier barrier            = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+        barrier.srcAccessMask                   = srcAccessMask;
+        barrier.dstAccessMask                   = dstAccessMask;
+        barrier.oldLayout                       = oldLayout;
+        barrier.newLayout                       = newLayout;
+        barrier.srcQueueFamilyIndex             = srcQueueFamilyIndex;
+        barrier.dstQueueFamilyIndex             = dstQueueFamilyIndex;
+        barrier.image                           = pApiImage->GetVkImage();
+        barrier.subresourceRange.aspectMask     = pApiImage->GetVkImageAspectFlags();
+        barrier.subresourceRange.baseMipLevel   = barrierInfo.mipLevel;
+        barrier.subresourceRange.levelCount     = barrierInfo.mipLevelCount;
+        barrier.subresourceRange.baseArrayLayer = barrierInfo.arrayLayer;
+        barrier.subresourceRange.layerCount     = barrierInfo.arrayLayerCount;
+        imageBarriers.push_back(barrier);
+
+        srcStageMask |= barrierSrcStageMask;
+        dstStageMask |= barrierDstStageMask;
     }
 
-    if (!IsNull(pDstQueue)) {
-        dstQueueFamilyIndex = ToApi(pDstQueue)->GetQueueFamilyIndex();
-    }
+    std::vector<VkBufferMemoryBarrier> bufferBarriers;
+    bufferBarriers.reserve(bufferBarrierCount);
+    for (uint32_t i = 0; i < bufferBarrierCount; ++i) {
+        const grfx::BufferBarrier& barrierInfo = pBufferBarriers[i];
 
-    if (srcQueueFamilyIndex == dstQueueFamilyIndex) {
-        srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        uint32_t srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        uint32_t dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        ResolveQueueFamilyIndices(barrierInfo.pSrcQueue, barrierInfo.pDstQueue, srcQueueFamilyIndex, dstQueueFamilyIndex);
+
+        // UNORDERED_ACCESS and GENERAL barriers between the same states
+        // still order shader writes, see grfx::IsUnorderedAccessBarrier
+        if (barrierInfo.beforeState == barrierInfo.afterState && srcQueueFamilyIndex == dstQueueFamilyIndex && !grfx::IsUnorderedAccessBarrier(barrierInfo.beforeState, barrierInfo.afterState)) {
+            continue;
+        }
+
+        VkPipelineStageFlags barrierSrcStageMask = InvalidValue<VkPipelineStageFlags>();
+        VkPipelineStageFlags barrierDstStageMask = InvalidValue<VkPipelineStageFlags>();
+        VkAccessFlags        srcAccessMask       = InvalidValue<VkAccessFlags>();
+        VkAccessFlags        dstAccessMask       = InvalidValue<VkAccessFlags>();
+        VkImageLayout        oldLayout           = InvalidValue<VkImageLayout>();
+        VkImageLayout        newLayout           = InvalidValue<VkImageLayout>();
+
+        Result ppxres = ToVkBarrierSrc(
+            barrierInfo.beforeState,
+            commandType,
+            pDevice->GetDeviceFeatures(),
+            barrierSrcStageMask,
+            srcAccessMask,
+            oldLayout);
+        PPX_ASSERT_MSG(ppxres == ppx::SUCCESS, "couldn't get src barrier data");
+
+        ppxres = ToVkBarrierDst(
+            barrierInfo.afterState,
+            commandType,
+            pDevice->GetDeviceFeatures(),
+            barrierDstStageMask,
+            dstAccessMask,
+            newLayout);
+        PPX_ASSERT_MSG(ppxres == ppx::SUCCESS, "couldn't get dst barrier data");
+
+        VkBufferMemoryBarrier barrier = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+        barrier.srcAccessMask         = srcAccessMask;
+        barrier.dstAccessMask         = dstAccessMask;
+        barrier.srcQueueFamilyIndex   = srcQueueFamilyIndex;
+        barrier.dstQueueFamilyIndex   = dstQueueFamilyIndex;
+        barrier.buffer                = ToApi(barrierInfo.pBuffer)->GetVkBuffer();
+        barrier.offset                = static_cast<VkDeviceSize>(0);
+        barrier.size                  = static_cast<VkDeviceSize>(barrierInfo.pBuffer->GetSize());
+        bufferBarriers.push_back(barrier);
+
+        srcStageMask |= barrierSrcStageMask;
+        dstStageMask |= barrierDstStageMask;
     }
 
-    if (beforeState == afterState && srcQueueFamilyIndex == dstQueueFamilyIndex) {
+    if (imageBarriers.empty() && bufferBarriers.empty()) {
         return;
     }
 
-    VkPipelineStageFlags srcStageMask    = InvalidValue<VkPipelineStageFlags>();
-    VkPipelineStageFlags dstStageMask    = InvalidValue<VkPipelineStageFlags>();
-    VkAccessFlags        srcAccessMask   = InvalidValue<VkAccessFlags>();
-    VkAccessFlags        dstAccessMask   = InvalidValue<VkAccessFlags>();
-    VkImageLayout        oldLayout       = InvalidValue<VkImageLayout>();
-    VkImageLayout        newLayout       = InvalidValue<VkImageLayout>();
-    VkDependencyFlags    dependencyFlags = 0;
-
-    vk::Device* pDevice = ToApi(GetDevice());
-
-    grfx::CommandType commandType = GetCommandType();
-
-    Result ppxres = ToVkBarrierSrc(
-        beforeState,
-        commandType,
-        pDevice->GetDeviceFeatures(),
-        srcStageMask,
-        srcAccessMask,
-        oldLayout);
-    PPX_ASSERT_MSG(ppxres == ppx::SUCCESS, "couldn't get src barrier data");
-
-    ppxres = ToVkBarrierDst(
-        afterState,
-        commandType,
-        pDevice->GetDeviceFeatures(),
-        dstStageMask,
-        dstAccessMask,
-        newLayout);
-    PPX_ASSERT_MSG(ppxres == ppx::SUCCESS, "couldn't get dst barrier data");
-
-    VkBufferMemoryBarrier barrier = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
-    barrier.srcAccessMask         = srcAccessMask;
-    barrier.dstAccessMask         = dstAccessMask;
-    barrier.srcQueueFamilyIndex   = srcQueueFamilyIndex;
-    barrier.dstQueueFamilyIndex   = dstQueueFamilyIndex;
-    barrier.buffer                = ToApi(pBuffer)->GetVkBuffer();
-    barrier.offset                = static_cast<VkDeviceSize>(0);
-    barrier.size                  = static_cast<VkDeviceSize>(pBuffer->GetSize());
-
-    vkCmdPipelineBarrier(
-        mCommandBuffer,  // commandBuffer
-        srcStageMask,    // srcStageMask
-        dstStageMask,    // dstStageMask
-        dependencyFlags, // dependencyFlags
-        0,               // memoryBarrierCount
-        nullptr,         // pMemoryBarriers
-        1,               // bufferMemoryBarrierCount
-        &barrier,        // pBufferMemoryBarriers
-        0,               // imageMemoryBarrierCount
-        nullptr);        // pImageMemoryBarriers);
+    vk::CmdPipelineBarrier(
+        mCommandBuffer,           // commandBuffer
+        srcStageMask,             // srcStageMask
+        dstStageMask,             // dstStageMask
+        dependencyFlags,          // dependencyFlags
+        0,                        // memoryBarrierCount
+        nullptr,                  // pMemoryBarriers
+        CountU32(bufferBarriers), // bufferMemoryBarrierCount
+        DataPtr(bufferBarriers),  // pBufferMemoryBarriers
+        CountU32(imageBarriers),  // imageMemoryBarrierCount
+        DataPtr(imageBarriers));  // pImageMemoryBarriers);
 }
 
 void CommandBuffer::SetViewports(uint32_t viewportCount, const grfx::Viewport* pViewports)
@@ -657,14 +669,98 @@ void CommandBuffer::Dispatch(
     uint32_t groupCountY,
     uint32_t groupCountZ)
 {
+    FlushBarriers();
+
     vk::CmdDispatch(mCommandBuffer, groupCountX, groupCountY, groupCountZ);
 }
 
+void CommandBuffer::DrawIndirect(
+    const grfx::Buffer* pArgBuffer,
+    uint64_t            offset,
+    uint32_t            drawCount,
+    uint32_t            stride)
+{
+    PPX_ASSERT_NULL_ARG(pArgBuffer);
+
+    VkBuffer buffer = ToApi(pArgBuffer)->GetVkBuffer();
+
+    // Without multiDrawIndirect drawCount must be 0 or 1
+    if ((drawCount > 1) && !GetDevice()->MultiDrawIndirectSupported()) {
+        for (uint32_t i = 0; i < drawCount; ++i) {
+            VkDeviceSize drawOffset = static_cast<VkDeviceSize>(offset + static_cast<uint64_t>(i) * stride);
+            vkCmdDrawIndirect(mCommandBuffer, buffer, drawOffset, 1, stride);
+        }
+        return;
+    }
+
+    vkCmdDrawIndirect(mCommandBuffer, buffer, static_cast<VkDeviceSize>(offset), drawCount, stride);
+}
+
+void CommandBuffer::DrawIndexedIndirect(
+    const grfx::Buffer* pArgBuffer,
+    uint64_t            offset,
+    uint32_t            drawCount,
+    uint32_t            stride)
+{
+    PPX_ASSERT_NULL_ARG(pArgBuffer);
+
+    VkBuffer buffer = ToApi(pArgBuffer)->GetVkBuffer();
+
+    // Without multiDrawIndirect drawCount must be 0 or 1
+    if ((drawCount > 1) && !GetDevice()->MultiDrawIndirectSupported()) {
+        for (uint32_t i = 0; i < drawCount; ++i) {
+            VkDeviceSize drawOffset = static_cast<VkDeviceSize>(offset + static_cast<uint64_t>(i) * stride);
+            vkCmdDrawIndexedIndirect(mCommandBuffer, buffer, drawOffset, 1, stride);
+        }
+        return;
+    }
+
+    vkCmdDrawIndexedIndirect(mCommandBuffer, buffer, static_cast<VkDeviceSize>(offset), drawCount, stride);
+}
+
+void CommandBuffer::DrawIndexedIndirectCount(
+    const grfx::Buffer* pArgBuffer,
+    uint64_t            offset,
+    const grfx::Buffer* pCountBuffer,
+    uint64_t            countOffset,
+    uint32_t            maxDrawCount,
+    uint32_t            stride)
+{
+    PPX_ASSERT_NULL_ARG(pArgBuffer);
+    PPX_ASSERT_NULL_ARG(pCountBuffer);
+    PPX_ASSERT_MSG(GetDevice()->DrawIndirectCountSupported(), "device does not support draw indirect count");
+
+    vk::CmdDrawIndexedIndirectCountKHR(
+        mCommandBuffer,
+        ToApi(pArgBuffer)->GetVkBuffer(),
+        static_cast<VkDeviceSize>(offset),
+        ToApi(pCountBuffer)->GetVkBuffer(),
+        static_cast<VkDeviceSize>(countOffset),
+        maxDrawCount,
+        stride);
+}
+
+void CommandBuffer::DispatchIndirect(
+    const grfx::Buffer* pArgBuffer,
+    uint64_t            offset)
+{
+    FlushBarriers();
+
+    PPX_ASSERT_NULL_ARG(pArgBuffer);
+
+    vkCmdDispatchIndirect(
+        mCommandBuffer,
+        ToApi(pArgBuffer)->GetVkBuffer(),
+        static_cast<VkDeviceSize>(offset));
+}
+
 void CommandBuffer::CopyBufferToBuffer(
     const grfx::BufferToBufferCopyInfo* pCopyInfo,
     grfx::Buffer*                       pSrcBuffer,
     grfx::Buffer*                       pDstBuffer)
 {
+    FlushBarriers();
+
     VkBufferCopy region = {};
     region.srcOffset    = static_cast<VkDeviceSize>(pCopyInfo->srcBuffer.offset);
     region.dstOffset    = static_cast<VkDeviceSize>(pCopyInfo->dstBuffer.offset);
@@ -683,6 +779,8 @@ void CommandBuffer::CopyBufferToImage(
     grfx::Buffer*                                   pSrcBuffer,
     grfx::Image*                                    pDstImage)
 {
+    FlushBarriers();
+
     PPX_ASSERT_NULL_ARG(pSrcBuffer);
     PPX_ASSERT_NULL_ARG(pDstImage);
 
@@ -726,6 +824,8 @@ grfx::ImageToBufferOutputPitch CommandBuffer::CopyImageToBuffer(
     grfx::Image*                       pSrcImage,
     grfx::Buffer*                      pDstBuffer)
 {
+    FlushBarriers();
+
     std::vector<VkBufferImageCopy> regions;
 
     VkBufferImageCopy region               = {};
@@ -789,6 +889,8 @@ void CommandBuffer::CopyImageToImage(
     grfx::Image*                      pSrcImage,
     grfx::Image*                      pDstImage)
 {
+    FlushBarriers();
+
     bool isSourceDepthStencil = grfx::GetFormatDescription(pSrcImage->GetFormat())->aspect == grfx::FORMAT_ASPECT_DEPTH_STENCIL;
     bool isDestDepthStencil   = grfx::GetFormatDescription(pDstImage->GetFormat())->aspect == grfx::FORMAT_ASPECT_DEPTH_STENCIL;
     PPX_ASSERT_MSG(isSourceDepthStencil == isDestDepthStencil, "both images in an image copy must be depth-stencil if one is depth-stencil");
@@ -36,7 +36,8 @@ namespace ppx {
 namespace grfx {
 namespace vk {
 
-PFN_vkCmdPushDescriptorSetKHR CmdPushDescriptorSetKHR = nullptr;
+PFN_vkCmdPushDescriptorSetKHR        CmdPushDescriptorSetKHR        = nullptr;
+PFN_vkCmdDrawIndexedIndirectCountKHR CmdDrawIndexedIndirectCountKHR = nullptr;
 
 Result Device::ConfigureQueueInfo(const grfx::DeviceCreateInfo* pCreateInfo, std::vector<float>& queuePriorities, std::vector<VkDeviceQueueCreateInfo>& queueCreateInfos)
 {
@@ -182,6 +183,11 @@ Result Device::ConfigureExtensions(const grfx::DeviceCreateInfo* pCreateInfo)
         mExtensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
     }
 
+    // Indirect draw count - if present
+    if (ElementExists(std::string(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME), mFoundExtensions)) {
+        mExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    }
+
     // Add additional extensions and uniquify
     AppendElements(pCreateInfo->vulkanExtensions, mExtensions);
     Unique(mExtensions);
@@ -213,6 +219,8 @@ Result Device::ConfigureFeatures(const grfx::DeviceCreateInfo* pCreateInfo, VkPh
     features.shaderStorageImageWriteWithoutFormat = foundFeatures.shaderStorageImageWriteWithoutFormat;
     features.shaderStorageImageMultisample        = foundFeatures.shaderStorageImageMultisample;
     features.samplerAnisotropy                    = foundFeatures.samplerAnisotropy;
+    features.multiDrawIndirect                    = foundFeatures.multiDrawIndirect;
+    features.drawIndirectFirstInstance            = foundFeatures.drawIndirectFirstInstance;
 
     // Select between default or custom features.
     if (!IsNull(pCreateInfo->pVulkanDeviceFeatures)) {
@@ -424,6 +432,13 @@ Result Device::CreateApiObjects(const grfx::DeviceCreateInfo* pCreateInfo)
         CmdPushDescriptorSetKHR = (PFN_vkCmdPushDescriptorSetKHR)vkGetDeviceProcAddr(mDevice, "vkCmdPushDescriptorSetKHR");
     }
 
+    // Load indirect draw count function
+    if (ElementExists(std::string(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME), mExtensions)) {
+        CmdDrawIndexedIndirectCountKHR = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(mDevice, "vkCmdDrawIndexedIndirectCountKHR");
+        mHasDrawIndirectCount          = (CmdDrawIndexedIndirectCountKHR != nullptr);
+    }
+    PPX_LOG_INFO("Vulkan draw indirect count is present: " << mHasDrawIndirectCount);
+
     // VMA
     {
         VmaAllocatorCreateInfo vmaCreateInfo = {};
@@ -714,6 +729,27 @@ bool Device::FragmentStoresAndAtomicsSupported() const
     return mDeviceFeatures.fragmentStoresAndAtomics == VK_TRUE;
 }
 
+bool Device::MultiDrawIndirectSupported() const
+{
+    return mDeviceFeatures.multiDrawIndirect == VK_TRUE;
+}
+
+bool Device::DrawIndirectCountSupported() const
+{
+    return mHasDrawIndirectCount;
+}
+
+bool Device::StorageImageWriteSupported(grfx::Format format) const
+{
+    if (mDeviceFeatures.shaderStorageImageWriteWithoutFormat != VK_TRUE) {
+        return false;
+    }
+
+    VkFormatProperties properties = {};
+    vkGetPhysicalDeviceFormatProperties(ToApi(GetGpu())->GetVkGpu(), ToVkFormat(format), &properties);
+    return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) != 0;
+}
+
 void Device::ResetQueryPoolEXT(
     VkQueryPool queryPool,
     uint32_t    firstQuery,
@@ -61,6 +61,9 @@ Result Fence::Wait(uint64_t timeout)
         mFence,
         VK_TRUE,
         timeout);
+    if (vkres == VK_TIMEOUT) {
+        return ppx::ERROR_WAIT_TIMED_OUT;
+    }
     if (vkres != VK_SUCCESS) {
         return ppx::ERROR_API_FAILURE;
     }
@@ -0,0 +1,906 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ppx/image_compare.h"
+#include "ppx/job_system.h"
+#include "ppx/pixel_conversion.h"
+#include "ppx/util.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define PPX_IMAGE_COMPARE_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PPX_IMAGE_COMPARE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace ppx {
+
+static const uint32_t kRowsPerJob   = 32;
+static const uint8_t  kMaskExcluded = 255;
+static const uint32_t kSSIMCellSize = 4; // SSIM windows are 2x2 cells
+static const uint32_t kFLIPRadius   = 2; // 5 tap prefilter
+
+static void RunJobs(JobSystem* pJobSystem, uint32_t jobCount, const JobSystem::JobFn& fn)
+{
+    JobSystem localJobSystem;
+    if (IsNull(pJobSystem)) {
+        localJobSystem.Initialize(JobSystem::GetDefaultWorkerCount());
+        pJobSystem = &localJobSystem;
+    }
+    pJobSystem->Run(jobCount, fn);
+}
+
+static uint32_t RowJobCount(uint32_t height)
+{
+    return (height + kRowsPerJob - 1) / kRowsPerJob;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Input conversion
+// -------------------------------------------------------------------------------------------------
+
+// Reads channel \b c of a pixel as an 8-bit value
+static uint8_t ReadUnorm8(const char* pPixel, Bitmap::DataType dataType, uint32_t c)
+{
+    float value = 0.0f;
+    switch (dataType) {
+        default: return 0;
+        case Bitmap::DATA_TYPE_UINT8: return reinterpret_cast<const uint8_t*>(pPixel)[c];
+        case Bitmap::DATA_TYPE_UINT16: return static_cast<uint8_t>((reinterpret_cast<const uint16_t*>(pPixel)[c] + 128u) / 257u);
+        case Bitmap::DATA_TYPE_UINT32: return static_cast<uint8_t>(reinterpret_cast<const uint32_t*>(pPixel)[c] >> 24);
+        case Bitmap::DATA_TYPE_FLOAT: value = reinterpret_cast<const float*>(pPixel)[c]; break;
+        case Bitmap::DATA_TYPE_FLOAT16: ConvertHalfToFloat(reinterpret_cast<const uint16_t*>(pPixel) + c, &value, 1); break;
+    }
+    uint8_t result = 0;
+    ConvertFloatToUnorm8(&value, &result, 1);
+    return result;
+}
+
+// Returns \b src if it already is RGBA_UINT8, converts it into \b storage otherwise
+static const Bitmap* ToRGBA8(const Bitmap& src, Bitmap& storage, JobSystem* pJobSystem)
+{
+    if (src.GetFormat() == Bitmap::FORMAT_RGBA_UINT8) {
+        return &src;
+    }
+
+    const uint32_t         width        = src.GetWidth();
+    const uint32_t         height       = src.GetHeight();
+    const uint32_t         channelCount = src.GetChannelCount();
+    const Bitmap::DataType dataType     = Bitmap::ChannelDataType(src.GetFormat());
+    storage                             = Bitmap::Create(width, height, Bitmap::FORMAT_RGBA_UINT8);
+
+    RunJobs(pJobSystem, RowJobCount(height), [&](uint32_t jobIndex, uint32_t) {
+        const uint32_t lastRow = std::min((jobIndex + 1) * kRowsPerJob, height);
+        for (uint32_t y = jobIndex * kRowsPerJob; y < lastRow; ++y) {
+            uint8_t* pDst = reinterpret_cast<uint8_t*>(storage.GetPixelAddress(0, y));
+            if ((channelCount == 4) && (dataType == Bitmap::DATA_TYPE_FLOAT)) {
+                ConvertFloatToUnorm8(reinterpret_cast<const float*>(src.GetPixelAddress(0, y)), pDst, static_cast<size_t>(width) * 4);
+                continue;
+            }
+            if ((channelCount == 3) && (dataType == Bitmap::DATA_TYPE_UINT8)) {
+                ExpandRGB8ToRGBA8(reinterpret_cast<const uint8_t*>(src.GetPixelAddress(0, y)), pDst, width);
+                continue;
+            }
+            for (uint32_t x = 0; x < width; ++x, pDst += 4) {
+                const char* pPixel = src.GetPixelAddress(x, y);
+                pDst[0]            = 0;
+                pDst[1]            = 0;
+                pDst[2]            = 0;
+                pDst[3]            = 0xFF;
+                for (uint32_t c = 0; c < channelCount; ++c) {
+                    pDst[c] = ReadUnorm8(pPixel, dataType, c);
+                }
+            }
+        }
+    });
+    return &storage;
+}
+
+// First channel of the mask, one byte per pixel
+static void ReadMask(const Bitmap& mask, std::vector<uint8_t>& values)
+{
+    const uint32_t         width    = mask.GetWidth();
+    const uint32_t         height   = mask.GetHeight();
+    const Bitmap::DataType dataType = Bitmap::ChannelDataType(mask.GetFormat());
+    values.resize(static_cast<size_t>(width) * height);
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            values[static_cast<size_t>(y) * width + x] = ReadUnorm8(mask.GetPixelAddress(x, y), dataType, 0);
+        }
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Differences
+// -------------------------------------------------------------------------------------------------
+
+struct DiffStats
+{
+    uint64_t pixelCount          = 0;
+    uint64_t differentPixelCount = 0;
+    uint64_t sumAbs              = 0;
+    uint64_t sumSq               = 0;
+    uint8_t  maxDiff             = 0;
+};
+
+static void AddStats(const DiffStats& src, DiffStats& dst)
+{
+    dst.pixelCount += src.pixelCount;
+    dst.differentPixelCount += src.differentPixelCount;
+    dst.sumAbs += src.sumAbs;
+    dst.sumSq += src.sumSq;
+    dst.maxDiff = std::max(dst.maxDiff, src.maxDiff);
+}
+
+// Writes the largest channel difference of each pixel to \b pMaxDiff and
+// adds the row to \b pStats. Pixels differ if their largest channel
+// difference is above \b threshold.
+static void DiffRowRGBA8(
+    const uint8_t* pA,
+    const uint8_t* pB,
+    uint32_t       width,
+    bool           compareAlpha,
+    uint8_t        threshold,
+    uint8_t*       pMaxDiff,
+    DiffStats*     pStats)
+{
+    uint32_t x         = 0;
+    uint64_t sumAbs    = 0;
+    uint64_t sumSq     = 0;
+    uint64_t different = 0;
+    uint8_t  maxDiff   = 0;
+
+#if defined(PPX_IMAGE_COMPARE_SSE2)
+    const __m128i channelMask  = _mm_set1_epi32(compareAlpha ? -1 : 0x00FFFFFF);
+    const __m128i byteMask     = _mm_set1_epi32(0xFF);
+    const __m128i thresholdVec = _mm_set1_epi32(threshold);
+    const __m128i zero         = _mm_setzero_si128();
+    __m128i       absAcc       = zero;
+    __m128i       countAcc     = zero;
+    __m128i       maxAcc       = zero;
+    while (x + 4 <= width) {
+        // Squares are summed in 32-bit lanes, flushed before they can overflow
+        const uint32_t blockEnd = std::min(width & ~3u, x + 4096);
+        __m128i        sqAcc    = zero;
+        for (; x < blockEnd; x += 4) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pA + 4 * x));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pB + 4 * x));
+            __m128i d = _mm_and_si128(_mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a)), channelMask);
+
+            absAcc     = _mm_add_epi64(absAcc, _mm_sad_epu8(d, zero));
+            __m128i lo = _mm_unpacklo_epi8(d, zero);
+            __m128i hi = _mm_unpackhi_epi8(d, zero);
+            sqAcc      = _mm_add_epi32(sqAcc, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+
+            // Largest channel in the low byte of each pixel
+            __m128i m = _mm_max_epu8(d, _mm_srli_epi32(d, 8));
+            m         = _mm_max_epu8(m, _mm_srli_epi32(m, 16));
+            m         = _mm_and_si128(m, byteMask);
+            countAcc  = _mm_sub_epi32(countAcc, _mm_cmpgt_epi32(m, thresholdVec));
+            maxAcc    = _mm_max_epi16(maxAcc, m);
+
+            m         = _mm_packs_epi32(m, m);
+            m         = _mm_packus_epi16(m, m);
+            int32_t v = _mm_cvtsi128_si32(m);
+            std::memcpy(pMaxDiff + x, &v, 4);
+        }
+        alignas(16) uint32_t sqLanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(sqLanes), sqAcc);
+        sumSq += static_cast<uint64_t>(sqLanes[0]) + sqLanes[1] + sqLanes[2] + sqLanes[3];
+    }
+    alignas(16) uint64_t absLanes[2];
+    alignas(16) uint32_t countLanes[4];
+    alignas(16) uint32_t maxLanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(absLanes), absAcc);
+    _mm_store_si128(reinterpret_cast<__m128i*>(countLanes), countAcc);
+    _mm_store_si128(reinterpret_cast<__m128i*>(maxLanes), maxAcc);
+    sumAbs += absLanes[0] + absLanes[1];
+    different += static_cast<uint64_t>(countLanes[0]) + countLanes[1] + countLanes[2] + countLanes[3];
+    maxDiff = static_cast<uint8_t>(std::max(std::max(maxLanes[0], maxLanes[1]), std::max(maxLanes[2], maxLanes[3])));
+#elif defined(PPX_IMAGE_COMPARE_NEON)
+    const uint8x16_t channelMask  = vreinterpretq_u8_u32(vdupq_n_u32(compareAlpha ? 0xFFFFFFFFu : 0x00FFFFFFu));
+    const uint32x4_t byteMask     = vdupq_n_u32(0xFF);
+    const uint32x4_t thresholdVec = vdupq_n_u32(threshold);
+    uint32x4_t       countAcc     = vdupq_n_u32(0);
+    uint32x4_t       maxAcc       = vdupq_n_u32(0);
+    while (x + 4 <= width) {
+        const uint32_t blockEnd = std::min(width & ~3u, x + 4096);
+        uint32x4_t     absAcc   = vdupq_n_u32(0);
+        uint32x4_t     sqAcc    = vdupq_n_u32(0);
+        for (; x < blockEnd; x += 4) {
+            uint8x16_t d = vandq_u8(vabdq_u8(vld1q_u8(pA + 4 * x), vld1q_u8(pB + 4 * x)), channelMask);
+
+            absAcc = vpadalq_u16(absAcc, vpaddlq_u8(d));
+            sqAcc  = vpadalq_u16(sqAcc, vmull_u8(vget_low_u8(d), vget_low_u8(d)));
+            sqAcc  = vpadalq_u16(sqAcc, vmull_u8(vget_high_u8(d), vget_high_u8(d)));
+
+            uint8x16_t m   = vmaxq_u8(d, vreinterpretq_u8_u32(vshrq_n_u32(vreinterpretq_u32_u8(d), 8)));
+            m              = vmaxq_u8(m, vreinterpretq_u8_u32(vshrq_n_u32(vreinterpretq_u32_u8(m), 16)));
+            uint32x4_t m32 = vandq_u32(vreinterpretq_u32_u8(m), byteMask);
+            countAcc       = vsubq_u32(countAcc, vcgtq_u32(m32, thresholdVec));
+            maxAcc         = vmaxq_u32(maxAcc, m32);
+
+            uint16x4_t m16 = vmovn_u32(m32);
+            uint8x8_t  m8  = vmovn_u16(vcombine_u16(m16, m16));
+            uint32_t   v   = vget_lane_u32(vreinterpret_u32_u8(m8), 0);
+            std::memcpy(pMaxDiff + x, &v, 4);
+        }
+        sumAbs += static_cast<uint64_t>(vgetq_lane_u32(absAcc, 0)) + vgetq_lane_u32(absAcc, 1) + vgetq_lane_u32(absAcc, 2) + vgetq_lane_u32(absAcc, 3);
+        sumSq += static_cast<uint64_t>(vgetq_lane_u32(sqAcc, 0)) + vgetq_lane_u32(sqAcc, 1) + vgetq_lane_u32(sqAcc, 2) + vgetq_lane_u32(sqAcc, 3);
+    }
+    different += static_cast<uint64_t>(vgetq_lane_u32(countAcc, 0)) + vgetq_lane_u32(countAcc, 1) + vgetq_lane_u32(countAcc, 2) + vgetq_lane_u32(countAcc, 3);
+    maxDiff = static_cast<uint8_t>(std::max(std::max(vgetq_lane_u32(maxAcc, 0), vgetq_lane_u32(maxAcc, 1)), std::max(vgetq_lane_u32(maxAcc, 2), vgetq_lane_u32(maxAcc, 3))));
+#endif
+
+    const uint32_t channelCount = compareAlpha ? 4 : 3;
+    for (; x < width; ++x) {
+        uint8_t pixelMax = 0;
+        for (uint32_t c = 0; c < channelCount; ++c) {
+            const uint8_t d = static_cast<uint8_t>(std::abs(static_cast<int>(pA[4 * x + c]) - static_cast<int>(pB[4 * x + c])));
+            pixelMax        = std::max(pixelMax, d);
+            sumAbs += d;
+            sumSq += static_cast<uint32_t>(d) * d;
+        }
+        pMaxDiff[x] = pixelMax;
+        different += (pixelMax > threshold) ? 1 : 0;
+        maxDiff = std::max(maxDiff, pixelMax);
+    }
+
+    pStats->pixelCount += width;
+    pStats->differentPixelCount += different;
+    pStats->sumAbs += sumAbs;
+    pStats->sumSq += sumSq;
+    pStats->maxDiff = std::max(pStats->maxDiff, maxDiff);
+}
+
+// Removes an excluded pixel from the sums of DiffRowRGBA8()
+static void SubtractPixel(const uint8_t* pA, const uint8_t* pB, uint32_t channelCount, DiffStats& stats)
+{
+    for (uint32_t c = 0; c < channelCount; ++c) {
+        const uint32_t d = static_cast<uint32_t>(std::abs(static_cast<int>(pA[c]) - static_cast<int>(pB[c])));
+        stats.sumAbs -= d;
+        stats.sumSq -= d * d;
+    }
+    stats.pixelCount -= 1;
+}
+
+// -------------------------------------------------------------------------------------------------
+// SSIM
+// -------------------------------------------------------------------------------------------------
+
+// Integer sums of a 4x4 cell of luma
+struct SSIMCell
+{
+    uint32_t a        = 0;
+    uint32_t b        = 0;
+    uint32_t aa       = 0;
+    uint32_t bb       = 0;
+    uint32_t ab       = 0;
+    bool     excluded = false;
+};
+
+static uint32_t Luma8(const uint8_t* pPixel)
+{
+    return (77u * pPixel[0] + 150u * pPixel[1] + 29u * pPixel[2] + 128u) >> 8;
+}
+
+// Adds a 4x4 block of pixels to \b cell
+static void AccumulateCell(const uint8_t* pA, size_t rowStrideA, const uint8_t* pB, size_t rowStrideB, SSIMCell& cell)
+{
+#if defined(PPX_IMAGE_COMPARE_SSE2)
+    const __m128i weights = _mm_setr_epi16(77, 150, 29, 0, 77, 150, 29, 0);
+    const __m128i round   = _mm_set1_epi32(128);
+    const __m128i zero    = _mm_setzero_si128();
+    auto          luma    = [&](const uint8_t* pPixels) {
+        __m128i v    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPixels));
+        __m128  lo   = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(v, zero), weights));
+        __m128  hi   = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(v, zero), weights));
+        __m128i even = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i odd  = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+        return _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(even, odd), round), 8);
+    };
+
+    // Lumas fit in 16 bits, so madd yields their products in 32-bit lanes
+    __m128i a  = zero;
+    __m128i b  = zero;
+    __m128i aa = zero;
+    __m128i bb = zero;
+    __m128i ab = zero;
+    for (uint32_t row = 0; row < kSSIMCellSize; ++row, pA += rowStrideA, pB += rowStrideB) {
+        __m128i la = luma(pA);
+        __m128i lb = luma(pB);
+        a          = _mm_add_epi32(a, la);
+        b          = _mm_add_epi32(b, lb);
+        aa         = _mm_add_epi32(aa, _mm_madd_epi16(la, la));
+        bb         = _mm_add_epi32(bb, _mm_madd_epi16(lb, lb));
+        ab         = _mm_add_epi32(ab, _mm_madd_epi16(la, lb));
+    }
+
+    alignas(16) uint32_t lanes[5][4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes[0]), a);
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes[1]), b);
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes[2]), aa);
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes[3]), bb);
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes[4]), ab);
+    cell.a  = lanes[0][0] + lanes[0][1] + lanes[0][2] + lanes[0][3];
+    cell.b  = lanes[1][0] + lanes[1][1] + lanes[1][2] + lanes[1][3];
+    cell.aa = lanes[2][0] + lanes[2][1] + lanes[2][2] + lanes[2][3];
+    cell.bb = lanes[3][0] + lanes[3][1] + lanes[3][2] + lanes[3][3];
+    cell.ab = lanes[4][0] + lanes[4][1] + lanes[4][2] + lanes[4][3];
+#else
+    for (uint32_t row = 0; row < kSSIMCellSize; ++row, pA += rowStrideA, pB += rowStrideB) {
+        for (uint32_t i = 0; i < kSSIMCellSize; ++i) {
+            const uint32_t la = Luma8(pA + 4 * i);
+            const uint32_t lb = Luma8(pB + 4 * i);
+            cell.a += la;
+            cell.b += lb;
+            cell.aa += la * la;
+            cell.bb += lb * lb;
+            cell.ab += la * lb;
+        }
+    }
+#endif
+}
+
+static double SSIMFromSums(double n, double a, double b, double aa, double bb, double ab)
+{
+    const double c1    = (0.01 * 255.0) * (0.01 * 255.0);
+    const double c2    = (0.03 * 255.0) * (0.03 * 255.0);
+    const double meanA = a / n;
+    const double meanB = b / n;
+    const double varA  = std::max(aa / n - meanA * meanA, 0.0);
+    const double varB  = std::max(bb / n - meanB * meanB, 0.0);
+    const double covAB = ab / n - meanA * meanB;
+    const double numer = (2.0 * meanA * meanB + c1) * (2.0 * covAB + c2);
+    const double denom = (meanA * meanA + meanB * meanB + c1) * (varA + varB + c2);
+    return numer / denom;
+}
+
+// Returns the mean SSIM. \b pWindowMap receives 1 - SSIM per window if not null.
+static double ComputeSSIM(
+    const Bitmap&               reference,
+    const Bitmap&               test,
+    const std::vector<uint8_t>& mask,
+    std::vector<float>*         pWindowMap,
+    JobSystem*                  pJobSystem)
+{
+    const uint32_t width      = reference.GetWidth();
+    const uint32_t height     = reference.GetHeight();
+    const uint32_t cellsX     = width / kSSIMCellSize;
+    const uint32_t cellsY     = height / kSSIMCellSize;
+    auto           isExcluded = [&](uint32_t x, uint32_t y) { return !mask.empty() && (mask[static_cast<size_t>(y) * width + x] == kMaskExcluded); };
+    auto           pixelAt    = [](const Bitmap& bitmap, uint32_t x, uint32_t y) { return reinterpret_cast<const uint8_t*>(bitmap.GetPixelAddress(x, y)); };
+
+    // Too small for a window: one window covering the whole image
+    if ((cellsX < 2) || (cellsY < 2)) {
+        double n = 0, a = 0, b = 0, aa = 0, bb = 0, ab = 0;
+        for (uint32_t y = 0; y < height; ++y) {
+            for (uint32_t x = 0; x < width; ++x) {
+                if (isExcluded(x, y)) {
+                    continue;
+                }
+                const double la = Luma8(pixelAt(reference, x, y));
+                const double lb = Luma8(pixelAt(test, x, y));
+                n += 1;
+                a += la;
+                b += lb;
+                aa += la * la;
+                bb += lb * lb;
+                ab += la * lb;
+            }
+        }
+        const double ssim = (n > 0) ? SSIMFromSums(n, a, b, aa, bb, ab) : 1.0;
+        if (!IsNull(pWindowMap)) {
+            pWindowMap->assign(1, static_cast<float>(1.0 - ssim));
+        }
+        return ssim;
+    }
+
+    std::vector<SSIMCell> cells(static_cast<size_t>(cellsX) * cellsY);
+    RunJobs(pJobSystem, cellsY, [&](uint32_t cellY, uint32_t) {
+        const uint32_t y = cellY * kSSIMCellSize;
+        for (uint32_t cellX = 0; cellX < cellsX; ++cellX) {
+            SSIMCell&      cell = cells[static_cast<size_t>(cellY) * cellsX + cellX];
+            const uint32_t x    = cellX * kSSIMCellSize;
+            AccumulateCell(pixelAt(reference, x, y), reference.GetRowStride(), pixelAt(test, x, y), test.GetRowStride(), cell);
+            if (mask.empty()) {
+                continue;
+            }
+            for (uint32_t j = 0; j < kSSIMCellSize; ++j) {
+                for (uint32_t i = 0; i < kSSIMCellSize; ++i) {
+                    cell.excluded = cell.excluded || isExcluded(x + i, y + j);
+                }
+            }
+        }
+    });
+
+    // Windows of 2x2 cells, every cell
+    const uint32_t      windowsX = cellsX - 1;
+    const uint32_t      windowsY = cellsY - 1;
+    std::vector<double> rowSums(windowsY, 0.0);
+    std::vector<double> rowCounts(windowsY, 0.0);
+    if (!IsNull(pWindowMap)) {
+        pWindowMap->assign(static_cast<size_t>(windowsX) * windowsY, 0.0f);
+    }
+    RunJobs(pJobSystem, windowsY, [&](uint32_t windowY, uint32_t) {
+        for (uint32_t windowX = 0; windowX < windowsX; ++windowX) {
+            const SSIMCell* pCells[4] = {
+                &cells[static_cast<size_t>(windowY) * cellsX + windowX],
+                &cells[static_cast<size_t>(windowY) * cellsX + windowX + 1],
+                &cells[static_cast<size_t>(windowY + 1) * cellsX + windowX],
+                &cells[static_cast<size_t>(windowY + 1) * cellsX + windowX + 1]};
+
+            uint32_t a = 0, b = 0, aa = 0, bb = 0, ab = 0;
+            bool     excluded = false;
+            for (const SSIMCell* pCell : pCells) {
+                a += pCell->a;
+                b += pCell->b;
+                aa += pCell->aa;
+                bb += pCell->bb;
+                ab += pCell->ab;
+                excluded = excluded || pCell->excluded;
+            }
+            if (excluded) {
+                continue;
+            }
+
+            const double n    = 4.0 * kSSIMCellSize * kSSIMCellSize;
+            const double ssim = SSIMFromSums(n, a, b, aa, bb, ab);
+            rowSums[windowY] += ssim;
+            rowCounts[windowY] += 1.0;
+            if (!IsNull(pWindowMap)) {
+                (*pWindowMap)[static_cast<size_t>(windowY) * windowsX + windowX] = static_cast<float>(1.0 - ssim);
+            }
+        }
+    });
+
+    // Summed in row order so the result does not depend on the thread count
+    double sum   = 0;
+    double count = 0;
+    for (uint32_t i = 0; i < windowsY; ++i) {
+        sum += rowSums[i];
+        count += rowCounts[i];
+    }
+    return (count > 0) ? (sum / count) : 1.0;
+}
+
+// -------------------------------------------------------------------------------------------------
+// FLIP
+// -------------------------------------------------------------------------------------------------
+
+// D65 reference white
+static const float kWhiteX = 0.950428545f;
+static const float kWhiteZ = 1.088900371f;
+
+struct Lab
+{
+    float L, a, b;
+};
+
+static const std::array<float, 256>& GetLinearTable()
+{
+    static const std::array<float, 256> sTable = [] {
+        std::array<float, 256> table = {};
+        for (uint32_t i = 0; i < 256; ++i) {
+            table[i] = SRGBToLinear(static_cast<float>(i) / 255.0f);
+        }
+        return table;
+    }();
+    return sTable;
+}
+
+// Linear sRGB to YyCxCz, a linear opponent space
+static void LinearRGBToYyCxCz(float r, float g, float b, float* pDst)
+{
+    const float x = (0.4124564f * r + 0.3575761f * g + 0.1804375f * b) / kWhiteX;
+    const float y = (0.2126729f * r + 0.7151522f * g + 0.0721750f * b);
+    const float z = (0.0193339f * r + 0.1191920f * g + 0.9503041f * b) / kWhiteZ;
+    pDst[0]       = 116.0f * y - 16.0f;
+    pDst[1]       = 500.0f * (x - y);
+    pDst[2]       = 200.0f * (y - z);
+}
+
+static float LabF(float t)
+{
+    const float delta = 6.0f / 29.0f;
+    return (t > delta * delta * delta) ? std::cbrt(t) : (t / (3.0f * delta * delta) + 4.0f / 29.0f);
+}
+
+static Lab LinearRGBToHuntLab(float r, float g, float b)
+{
+    const float x  = LabF((0.4124564f * r + 0.3575761f * g + 0.1804375f * b) / kWhiteX);
+    const float y  = LabF(0.2126729f * r + 0.7151522f * g + 0.0721750f * b);
+    const float z  = LabF((0.0193339f * r + 0.1191920f * g + 0.9503041f * b) / kWhiteZ);
+    Lab         lab = {116.0f * y - 16.0f, 500.0f * (x - y), 200.0f * (y - z)};
+
+    // Hunt effect: chroma scales with lightness
+    lab.a *= 0.01f * lab.L;
+    lab.b *= 0.01f * lab.L;
+    return lab;
+}
+
+// Back to linear sRGB, clamped to the gamut, then to Hunt adjusted L*a*b*
+static Lab YyCxCzToHuntLab(const float* pSrc)
+{
+    const float y = (pSrc[0] + 16.0f) / 116.0f;
+    const float x = (pSrc[1] / 500.0f + y) * kWhiteX;
+    const float z = (y - pSrc[2] / 200.0f) * kWhiteZ;
+    const float r = std::clamp(3.2404542f * x - 1.5371385f * y - 0.4985314f * z, 0.0f, 1.0f);
+    const float g = std::clamp(-0.9692660f * x + 1.8760108f * y + 0.0415560f * z, 0.0f, 1.0f);
+    const float b = std::clamp(0.0556434f * x - 0.2040259f * y + 1.0572252f * z, 0.0f, 1.0f);
+    return LinearRGBToHuntLab(r, g, b);
+}
+
+static float HyAB(const Lab& p, const Lab& q)
+{
+    const float da = p.a - q.a;
+    const float db = p.b - q.b;
+    return std::abs(p.L - q.L) + std::sqrt(da * da + db * db);
+}
+
+// Exponent applied to the color distance, as in FLIP
+static const float kFLIPColorExponent = 0.7f;
+
+static float GetFLIPMaxColorError()
+{
+    static const float sMaxError = std::pow(HyAB(LinearRGBToHuntLab(0.0f, 1.0f, 0.0f), LinearRGBToHuntLab(0.0f, 0.0f, 1.0f)), kFLIPColorExponent);
+    return sMaxError;
+}
+
+// Compresses large color errors into the top 5% of the range
+static float RedistributeColorError(float error)
+{
+    const float maxError = GetFLIPMaxColorError();
+    const float pc       = 0.4f;
+    const float pt       = 0.95f;
+    if (error < pc * maxError) {
+        return (pt / (pc * maxError)) * error;
+    }
+    return std::min(pt + ((error - pc * maxError) / (maxError - pc * maxError)) * (1.0f - pt), 1.0f);
+}
+
+// Per job scratch rows for one band
+struct FLIPBand
+{
+    std::vector<float> filteredA; // Horizontally filtered YyCxCz, band plus filter radius above and below
+    std::vector<float> filteredB;
+    std::vector<float> lumaA; // Linear luminance, band plus one row above and below
+    std::vector<float> lumaB;
+};
+
+static void ComputeFLIPBand(
+    const Bitmap&               reference,
+    const Bitmap&               test,
+    const std::vector<uint8_t>& mask,
+    uint32_t                    firstRow,
+    uint32_t                    lastRow,
+    FLIPBand&                   band,
+    std::vector<float>*         pErrorMap,
+    double*                     pSum,
+    float*                      pMax)
+{
+    static const float kWeights[2 * kFLIPRadius + 1] = {1.0f / 16.0f, 4.0f / 16.0f, 6.0f / 16.0f, 4.0f / 16.0f, 1.0f / 16.0f};
+
+    const std::array<float, 256>& linear = GetLinearTable();
+    const int32_t                 width  = static_cast<int32_t>(reference.GetWidth());
+    const int32_t                 height = static_cast<int32_t>(reference.GetHeight());
+    const int32_t                 radius = static_cast<int32_t>(kFLIPRadius);
+    const int32_t                 first  = static_cast<int32_t>(firstRow);
+    const int32_t                 last   = static_cast<int32_t>(lastRow);
+    const size_t                  stride = static_cast<size_t>(width) * 3;
+
+    // Horizontal pass of the prefilter, edges are clamped
+    const int32_t      filteredRows = (last - first) + 2 * radius;
+    std::vector<float> yccRow(stride);
+    band.filteredA.resize(filteredRows * stride);
+    band.filteredB.resize(filteredRows * stride);
+    band.lumaA.resize(static_cast<size_t>(last - first + 2) * width);
+    band.lumaB.resize(static_cast<size_t>(last - first + 2) * width);
+    for (int32_t image = 0; image < 2; ++image) {
+        const Bitmap&       bitmap   = (image == 0) ? reference : test;
+        std::vector<float>& filtered = (image == 0) ? band.filteredA : band.filteredB;
+        std::vector<float>& luma     = (image == 0) ? band.lumaA : band.lumaB;
+        for (int32_t row = 0; row < filteredRows; ++row) {
+            const int32_t  y    = std::clamp(first - radius + row, 0, height - 1);
+            const uint8_t* pRow = reinterpret_cast<const uint8_t*>(bitmap.GetPixelAddress(0, static_cast<uint32_t>(y)));
+            for (int32_t x = 0; x < width; ++x) {
+                LinearRGBToYyCxCz(linear[pRow[4 * x + 0]], linear[pRow[4 * x + 1]], linear[pRow[4 * x + 2]], &yccRow[3 * x]);
+            }
+
+            // Luminance rows first - 1 to last for the feature term
+            const int32_t lumaRow = row - radius + 1;
+            if ((lumaRow >= 0) && (lumaRow < (last - first + 2))) {
+                for (int32_t x = 0; x < width; ++x) {
+                    luma[static_cast<size_t>(lumaRow) * width + x] = (yccRow[3 * x] + 16.0f) / 116.0f;
+                }
+            }
+
+            float* pDst = filtered.data() + row * stride;
+            for (int32_t x = 0; x < width; ++x) {
+                float sum[3] = {0, 0, 0};
+                for (int32_t k = -radius; k <= radius; ++k) {
+                    const float* pSrc = &yccRow[3 * std::clamp(x + k, 0, width - 1)];
+                    const float  w    = kWeights[k + radius];
+                    sum[0] += w * pSrc[0];
+                    sum[1] += w * pSrc[1];
+                    sum[2] += w * pSrc[2];
+                }
+                pDst[3 * x + 0] = sum[0];
+                pDst[3 * x + 1] = sum[1];
+                pDst[3 * x + 2] = sum[2];
+            }
+        }
+    }
+
+    for (int32_t y = first; y < last; ++y) {
+        const int32_t bandRow = y - first;
+        for (int32_t x = 0; x < width; ++x) {
+            const size_t pixelIndex = static_cast<size_t>(y) * width + x;
+            if (!mask.empty() && (mask[pixelIndex] == kMaskExcluded)) {
+                continue;
+            }
+
+            // Vertical pass of the prefilter
+            float a[3] = {0, 0, 0};
+            float b[3] = {0, 0, 0};
+            for (int32_t k = 0; k <= 2 * radius; ++k) {
+                const float* pA = band.filteredA.data() + (bandRow + k) * stride + 3 * x;
+                const float* pB = band.filteredB.data() + (bandRow + k) * stride + 3 * x;
+                for (int32_t c = 0; c < 3; ++c) {
+                    a[c] += kWeights[k] * pA[c];
+                    b[c] += kWeights[k] * pB[c];
+                }
+            }
+            const float colorError = RedistributeColorError(std::pow(HyAB(YyCxCzToHuntLab(a), YyCxCzToHuntLab(b)), kFLIPColorExponent));
+
+            // Sobel edge strength of the luminance, normalized to [0, sqrt(2)]
+            float edge[2];
+            for (int32_t image = 0; image < 2; ++image) {
+                const std::vector<float>& luma = (image == 0) ? band.lumaA : band.lumaB;
+                auto                      at   = [&](int32_t dx, int32_t dy) {
+                    return luma[static_cast<size_t>(bandRow + 1 + dy) * width + std::clamp(x + dx, 0, width - 1)];
+                };
+                const float gx = (at(1, -1) + 2.0f * at(1, 0) + at(1, 1) - at(-1, -1) - 2.0f * at(-1, 0) - at(-1, 1)) / 4.0f;
+                const float gy = (at(-1, 1) + 2.0f * at(0, 1) + at(1, 1) - at(-1, -1) - 2.0f * at(0, -1) - at(1, -1)) / 4.0f;
+                edge[image]    = std::sqrt(gx * gx + gy * gy);
+            }
+            const float featureError = std::sqrt(std::min(std::abs(edge[0] - edge[1]) / std::sqrt(2.0f), 1.0f));
+
+            const float error = std::pow(colorError, 1.0f - featureError);
+            *pSum += error;
+            *pMax = std::max(*pMax, error);
+            if (!IsNull(pErrorMap)) {
+                (*pErrorMap)[pixelIndex] = error;
+            }
+        }
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Heatmap
+// -------------------------------------------------------------------------------------------------
+
+// Black, red, yellow, white
+static void HeatColor(float t, uint8_t* pDst)
+{
+    t       = std::clamp(t, 0.0f, 1.0f);
+    pDst[0] = static_cast<uint8_t>(std::clamp(3.0f * t, 0.0f, 1.0f) * 255.0f + 0.5f);
+    pDst[1] = static_cast<uint8_t>(std::clamp(3.0f * t - 1.0f, 0.0f, 1.0f) * 255.0f + 0.5f);
+    pDst[2] = static_cast<uint8_t>(std::clamp(3.0f * t - 2.0f, 0.0f, 1.0f) * 255.0f + 0.5f);
+    pDst[3] = 0xFF;
+}
+
+// -------------------------------------------------------------------------------------------------
+// CompareImages
+// -------------------------------------------------------------------------------------------------
+Result CompareImages(
+    const Bitmap&              reference,
+    const Bitmap&              test,
+    const ImageCompareOptions& options,
+    ImageCompareResult*        pResult,
+    JobSystem*                 pJobSystem)
+{
+    PPX_ASSERT_NULL_ARG(pResult);
+
+    if (!reference.IsOk() || !test.IsOk()) {
+        return ppx::ERROR_IMAGE_INVALID_FORMAT;
+    }
+    if ((reference.GetWidth() != test.GetWidth()) || (reference.GetHeight() != test.GetHeight())) {
+        return ppx::ERROR_BITMAP_FOOTPRINT_MISMATCH;
+    }
+    if (!IsNull(options.pMask) && ((options.pMask->GetWidth() != reference.GetWidth()) || (options.pMask->GetHeight() != reference.GetHeight()))) {
+        return ppx::ERROR_BITMAP_FOOTPRINT_MISMATCH;
+    }
+    if (options.generateHeatmap &&
+        (((options.heatmapMetric == IMAGE_COMPARE_METRIC_SSIM) && !options.computeSSIM) ||
+         ((options.heatmapMetric == IMAGE_COMPARE_METRIC_FLIP) && !options.computeFLIP))) {
+        return ppx::ERROR_FAILED;
+    }
+
+    JobSystem localJobSystem;
+    if (IsNull(pJobSystem)) {
+        localJobSystem.Initialize(JobSystem::GetDefaultWorkerCount());
+        pJobSystem = &localJobSystem;
+    }
+
+    Bitmap         referenceStorage;
+    Bitmap         testStorage;
+    const Bitmap&  a      = *ToRGBA8(reference, referenceStorage, pJobSystem);
+    const Bitmap&  b      = *ToRGBA8(test, testStorage, pJobSystem);
+    const uint32_t width  = a.GetWidth();
+    const uint32_t height = a.GetHeight();
+
+    std::vector<uint8_t> mask;
+    if (!IsNull(options.pMask)) {
+        ReadMask(*options.pMask, mask);
+    }
+
+    *pResult = ImageCompareResult();
+
+    // Differences, MSE and PSNR
+    const bool             keepDiffs    = options.generateHeatmap && (options.heatmapMetric == IMAGE_COMPARE_METRIC_DIFFERENCE);
+    const uint32_t         channelCount = options.compareAlpha ? 4 : 3;
+    const uint32_t         jobCount     = RowJobCount(height);
+    std::vector<DiffStats> jobStats(jobCount);
+    const uint8_t          threshold    = static_cast<uint8_t>(std::min<uint32_t>(options.threshold, 255));
+    std::vector<uint8_t>   diffs(keepDiffs ? static_cast<size_t>(width) * height : 0);
+    RunJobs(pJobSystem, jobCount, [&](uint32_t jobIndex, uint32_t) {
+        DiffStats&           stats = jobStats[jobIndex];
+        std::vector<uint8_t> rowDiffs(keepDiffs ? 0 : width);
+        const uint32_t       lastRow = std::min((jobIndex + 1) * kRowsPerJob, height);
+        for (uint32_t y = jobIndex * kRowsPerJob; y < lastRow; ++y) {
+            const uint8_t* pA        = reinterpret_cast<const uint8_t*>(a.GetPixelAddress(0, y));
+            const uint8_t* pB        = reinterpret_cast<const uint8_t*>(b.GetPixelAddress(0, y));
+            uint8_t*       pMaxDiffs = keepDiffs ? (diffs.data() + static_cast<size_t>(y) * width) : rowDiffs.data();
+            const uint8_t* pMask     = mask.empty() ? nullptr : (mask.data() + static_cast<size_t>(y) * width);
+            if (IsNull(pMask)) {
+                DiffRowRGBA8(pA, pB, width, options.compareAlpha, threshold, pMaxDiffs, &stats);
+                continue;
+            }
+
+            // Masked rows recount with per pixel thresholds
+            DiffStats rowStats;
+            DiffRowRGBA8(pA, pB, width, options.compareAlpha, threshold, pMaxDiffs, &rowStats);
+            rowStats.differentPixelCount = 0;
+            rowStats.maxDiff             = 0;
+            for (uint32_t x = 0; x < width; ++x) {
+                if (pMask[x] == kMaskExcluded) {
+                    SubtractPixel(pA + 4 * x, pB + 4 * x, channelCount, rowStats);
+                    pMaxDiffs[x] = 0;
+                    continue;
+                }
+                rowStats.differentPixelCount += (pMaxDiffs[x] > std::max(threshold, pMask[x])) ? 1 : 0;
+                rowStats.maxDiff = std::max(rowStats.maxDiff, pMaxDiffs[x]);
+            }
+            AddStats(rowStats, stats);
+        }
+    });
+
+    DiffStats total;
+    for (const DiffStats& stats : jobStats) {
+        AddStats(stats, total);
+    }
+    pResult->pixelCount          = total.pixelCount;
+    pResult->differentPixelCount = total.differentPixelCount;
+    pResult->maxDifference       = total.maxDiff / 255.0f;
+    if (total.pixelCount > 0) {
+        const double sampleCount   = static_cast<double>(total.pixelCount) * channelCount;
+        pResult->meanAbsoluteError = static_cast<double>(total.sumAbs) / sampleCount / 255.0;
+        pResult->meanSquaredError  = static_cast<double>(total.sumSq) / sampleCount / (255.0 * 255.0);
+    }
+    pResult->psnr = (pResult->meanSquaredError > 0) ? (-10.0 * std::log10(pResult->meanSquaredError)) : std::numeric_limits<double>::infinity();
+
+    // SSIM
+    const bool         keepSSIM = options.generateHeatmap && (options.heatmapMetric == IMAGE_COMPARE_METRIC_SSIM);
+    std::vector<float> ssimWindows;
+    if (options.computeSSIM) {
+        pResult->ssim = ComputeSSIM(a, b, mask, keepSSIM ? &ssimWindows : nullptr, pJobSystem);
+    }
+
+    // FLIP
+    const bool         keepFLIP = options.generateHeatmap && (options.heatmapMetric == IMAGE_COMPARE_METRIC_FLIP);
+    std::vector<float> flipErrors(keepFLIP ? static_cast<size_t>(width) * height : 0, 0.0f);
+    if (options.computeFLIP) {
+        // Excluded pixels take the reference values so the prefilter does
+        // not spread their differences into their neighbors
+        const Bitmap* pFLIPTest = &b;
+        Bitmap        maskedTest;
+        if (!mask.empty()) {
+            maskedTest = b;
+            for (uint32_t y = 0; y < height; ++y) {
+                for (uint32_t x = 0; x < width; ++x) {
+                    if (mask[static_cast<size_t>(y) * width + x] == kMaskExcluded) {
+                        std::memcpy(maskedTest.GetPixelAddress(x, y), a.GetPixelAddress(x, y), 4);
+                    }
+                }
+            }
+            pFLIPTest = &maskedTest;
+        }
+
+        std::vector<double> jobSums(jobCount, 0.0);
+        std::vector<float>  jobMax(jobCount, 0.0f);
+        RunJobs(pJobSystem, jobCount, [&](uint32_t jobIndex, uint32_t) {
+            FLIPBand band;
+            ComputeFLIPBand(a, *pFLIPTest, mask, jobIndex * kRowsPerJob, std::min((jobIndex + 1) * kRowsPerJob, height), band, keepFLIP ? &flipErrors : nullptr, &jobSums[jobIndex], &jobMax[jobIndex]);
+        });
+
+        double sum = 0;
+        for (uint32_t i = 0; i < jobCount; ++i) {
+            sum += jobSums[i];
+            pResult->maxFLIP = std::max(pResult->maxFLIP, jobMax[i]);
+        }
+        pResult->meanFLIP = (total.pixelCount > 0) ? (sum / static_cast<double>(total.pixelCount)) : 0.0;
+    }
+
+    // Heatmap, normalized to the largest error
+    if (options.generateHeatmap) {
+        float maxError = 0;
+        switch (options.heatmapMetric) {
+            default: break;
+            case IMAGE_COMPARE_METRIC_DIFFERENCE: maxError = static_cast<float>(total.maxDiff); break;
+            case IMAGE_COMPARE_METRIC_SSIM: maxError = ssimWindows.empty() ? 0.0f : *std::max_element(ssimWindows.begin(), ssimWindows.end()); break;
+            case IMAGE_COMPARE_METRIC_FLIP: maxError = pResult->maxFLIP; break;
+        }
+        const float    scale    = (maxError > 0) ? (1.0f / maxError) : 0.0f;
+        const uint32_t windowsX = std::max(width / kSSIMCellSize, 2u) - 1;
+        const uint32_t windowsY = std::max(height / kSSIMCellSize, 2u) - 1;
+
+        pResult->heatmap = Bitmap::Create(width, height, Bitmap::FORMAT_RGBA_UINT8);
+        RunJobs(pJobSystem, jobCount, [&](uint32_t jobIndex, uint32_t) {
+            const uint32_t lastRow = std::min((jobIndex + 1) * kRowsPerJob, height);
+            for (uint32_t y = jobIndex * kRowsPerJob; y < lastRow; ++y) {
+                uint8_t* pDst = reinterpret_cast<uint8_t*>(pResult->heatmap.GetPixelAddress(0, y));
+                for (uint32_t x = 0; x < width; ++x, pDst += 4) {
+                    const size_t pixelIndex = static_cast<size_t>(y) * width + x;
+                    if (!mask.empty() && (mask[pixelIndex] == kMaskExcluded)) {
+                        pDst[0] = 0;
+                        pDst[1] = 0;
+                        pDst[2] = 64;
+                        pDst[3] = 0xFF;
+                        continue;
+                    }
+
+                    float error = 0;
+                    switch (options.heatmapMetric) {
+                        default: break;
+                        case IMAGE_COMPARE_METRIC_DIFFERENCE: error = diffs[pixelIndex]; break;
+                        case IMAGE_COMPARE_METRIC_FLIP: error = flipErrors[pixelIndex]; break;
+                        case IMAGE_COMPARE_METRIC_SSIM: {
+                            // Each pixel takes the window starting at its cell
+                            const uint32_t windowX = std::min(x / kSSIMCellSize, windowsX - 1);
+                            const uint32_t windowY = std::min(y / kSSIMCellSize, windowsY - 1);
+                            const size_t   index   = std::min(static_cast<size_t>(windowY) * windowsX + windowX, ssimWindows.size() - 1);
+                            error                  = ssimWindows[index];
+                        } break;
+                    }
+                    HeatColor(error * scale, pDst);
+                }
+            }
+        });
+    }
+
+    return ppx::SUCCESS;
+}
+
+} // namespace ppx
@@ -0,0 +1,132 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ppx/job_system.h"
+
+namespace ppx {
+
+JobSystem::~JobSystem()
+{
+    Shutdown();
+}
+
+void JobSystem::Initialize(uint32_t workerCount)
+{
+    Shutdown();
+
+    mWorkers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; ++i) {
+        // Thread index 0 is the thread calling Run()
+        mWorkers.emplace_back(&JobSystem::WorkerLoop, this, i + 1);
+    }
+}
+
+void JobSystem::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWakeCondition.notify_all();
+
+    for (auto& worker : mWorkers) {
+        worker.join();
+    }
+    mWorkers.clear();
+
+    mStopping = false;
+}
+
+void JobSystem::Run(uint32_t jobCount, const JobFn& fn)
+{
+    if (jobCount == 0) {
+        return;
+    }
+
+    if (mWorkers.empty()) {
+        for (uint32_t i = 0; i < jobCount; ++i) {
+            fn(i, 0);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFn            = &fn;
+        mJobCount      = jobCount;
+        mNextJob       = 0;
+        mFinishedCount = 0;
+        ++mBatchId;
+    }
+    mWakeCondition.notify_all();
+
+    RunJobs(0);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDoneCondition.wait(lock, [this]() { return mFinishedCount == mJobCount; });
+    mFn = nullptr;
+}
+
+uint32_t JobSystem::GetDefaultWorkerCount()
+{
+    uint32_t hardwareThreadCount = std::thread::hardware_concurrency();
+    return (hardwareThreadCount > 1) ? (hardwareThreadCount - 1) : 0;
+}
+
+void JobSystem::WorkerLoop(uint32_t threadIndex)
+{
+    uint64_t batchId = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWakeCondition.wait(lock, [this, batchId]() { return mStopping || (mBatchId != batchId); });
+            if (mStopping) {
+                return;
+            }
+            batchId = mBatchId;
+        }
+
+        RunJobs(threadIndex);
+    }
+}
+
+void JobSystem::RunJobs(uint32_t threadIndex)
+{
+    for (;;) {
+        uint32_t     jobIndex = 0;
+        const JobFn* pFn      = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mNextJob >= mJobCount) {
+                return;
+            }
+            jobIndex = mNextJob++;
+            pFn      = mFn;
+        }
+
+        (*pFn)(jobIndex, threadIndex);
+
+        bool done = false;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            ++mFinishedCount;
+            done = (mFinishedCount == mJobCount);
+        }
+        if (done) {
+            mDoneCondition.notify_one();
+        }
+    }
+}
+
+} // namespace ppx
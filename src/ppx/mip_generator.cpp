@@ -0,0 +1,369 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ppx/mip_generator.h"
+#include "ppx/grfx/grfx_device.h"
+
+#include <algorithm>
+
+namespace ppx {
+
+namespace {
+
+// Must match GenerateMipsParams in GenerateMips.hlsl
+struct GenerateMipsParams
+{
+    uint32_t srcSize[2];
+    uint32_t dstSize[2];
+    uint32_t srgb;
+};
+
+constexpr uint32_t kSrcBinding       = 0;
+constexpr uint32_t kDstBinding       = 1;
+constexpr uint32_t kParamsBinding    = 2;
+constexpr uint32_t kThreadGroupSize  = 8;
+constexpr uint32_t kParamsDWORDCount = sizeof(GenerateMipsParams) / sizeof(uint32_t);
+constexpr char     kEntryPoint[]     = "csmain";
+
+} // namespace
+
+Result MipGenerator::Initialize(grfx::Device* pDevice, const std::vector<char>& shaderBytecode)
+{
+    PPX_ASSERT_NULL_ARG(pDevice);
+    if (shaderBytecode.empty()) {
+        return ppx::ERROR_INVALID_CREATE_ARGUMENT;
+    }
+
+    mDevice = pDevice;
+
+    grfx::ShaderModuleCreateInfo shaderCreateInfo = {static_cast<uint32_t>(shaderBytecode.size()), shaderBytecode.data()};
+    Result                       ppxres           = mDevice->CreateShaderModule(&shaderCreateInfo, &mShader);
+    if (Failed(ppxres)) {
+        Shutdown();
+        return ppxres;
+    }
+
+    grfx::DescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+    layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding(kSrcBinding, grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE));
+    layoutCreateInfo.bindings.push_back(grfx::DescriptorBinding(kDstBinding, grfx::DESCRIPTOR_TYPE_STORAGE_IMAGE));
+    ppxres = mDevice->CreateDescriptorSetLayout(&layoutCreateInfo, &mDescriptorSetLayout);
+    if (Failed(ppxres)) {
+        Shutdown();
+        return ppxres;
+    }
+
+    grfx::PipelineInterfaceCreateInfo piCreateInfo = {};
+    piCreateInfo.setCount                          = 1;
+    piCreateInfo.sets[0].set                       = 0;
+    piCreateInfo.sets[0].pLayout                   = mDescriptorSetLayout;
+    piCreateInfo.pushConstants.count               = kParamsDWORDCount;
+    piCreateInfo.pushConstants.binding             = kParamsBinding;
+    piCreateInfo.pushConstants.set                 = 0;
+    ppxres                                         = mDevice->CreatePipelineInterface(&piCreateInfo, &mPipelineInterface);
+    if (Failed(ppxres)) {
+        Shutdown();
+        return ppxres;
+    }
+
+    grfx::ComputePipelineCreateInfo cpCreateInfo = {};
+    cpCreateInfo.CS                              = {mShader.Get(), kEntryPoint};
+    cpCreateInfo.pPipelineInterface              = mPipelineInterface;
+    ppxres                                       = mDevice->CreateComputePipeline(&cpCreateInfo, &mPipeline);
+    if (Failed(ppxres)) {
+        Shutdown();
+        return ppxres;
+    }
+
+    return ppx::SUCCESS;
+}
+
+void MipGenerator::Shutdown()
+{
+    if (IsNull(mDevice)) {
+        return;
+    }
+
+    ReleaseRecordedResources();
+
+    if (mPipeline) {
+        mDevice->DestroyComputePipeline(mPipeline);
+        mPipeline.Reset();
+    }
+    if (mPipelineInterface) {
+        mDevice->DestroyPipelineInterface(mPipelineInterface);
+        mPipelineInterface.Reset();
+    }
+    if (mDescriptorSetLayout) {
+        mDevice->DestroyDescriptorSetLayout(mDescriptorSetLayout);
+        mDescriptorSetLayout.Reset();
+    }
+    if (mShader) {
+        mDevice->DestroyShaderModule(mShader);
+        mShader.Reset();
+    }
+
+    mDevice = nullptr;
+}
+
+bool MipGenerator::IsFormatFilterable(grfx::Format format)
+{
+    // Storage views cannot use the *_SRGB formats, UNORM images holding sRGB
+    // data are handled with MipGeneratorImage::srgb instead. 3 channel
+    // formats have no storage image support on most devices.
+    switch (format) {
+        default: break;
+        case grfx::FORMAT_R8_UNORM:
+        case grfx::FORMAT_R8G8_UNORM:
+        case grfx::FORMAT_R8G8B8A8_UNORM:
+        case grfx::FORMAT_R16G16B16A16_UNORM:
+        case grfx::FORMAT_R16_FLOAT:
+        case grfx::FORMAT_R16G16_FLOAT:
+        case grfx::FORMAT_R16G16B16A16_FLOAT:
+        case grfx::FORMAT_R32_FLOAT:
+        case grfx::FORMAT_R32G32_FLOAT:
+        case grfx::FORMAT_R32G32B32A32_FLOAT:
+            return true;
+    }
+    return false;
+}
+
+bool MipGenerator::IsFormatSupported(grfx::Format format) const
+{
+    if (IsNull(mDevice) || !IsFormatFilterable(format)) {
+        return false;
+    }
+    return mDevice->StorageImageWriteSupported(format);
+}
+
+Result MipGenerator::RecordDispatch(
+    grfx::CommandBuffer*     pCommandBuffer,
+    Batch&                   batch,
+    const MipGeneratorImage& image,
+    uint32_t                 level)
+{
+    grfx::Image*   pImage     = image.pImage;
+    const uint32_t layerCount = pImage->GetArrayLayerCount();
+
+    Dispatch dispatch = {};
+
+    grfx::SampledImageViewCreateInfo srcViewCreateInfo = grfx::SampledImageViewCreateInfo::GuessFromImage(pImage);
+    srcViewCreateInfo.imageViewType                    = grfx::IMAGE_VIEW_TYPE_2D_ARRAY;
+    srcViewCreateInfo.mipLevel                         = level - 1;
+    srcViewCreateInfo.mipLevelCount                    = 1;
+    srcViewCreateInfo.arrayLayer                       = 0;
+    srcViewCreateInfo.arrayLayerCount                  = layerCount;
+
+    Result ppxres = mDevice->CreateSampledImageView(&srcViewCreateInfo, &dispatch.srcView);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    grfx::StorageImageViewCreateInfo dstViewCreateInfo = grfx::StorageImageViewCreateInfo::GuessFromImage(pImage);
+    dstViewCreateInfo.imageViewType                    = grfx::IMAGE_VIEW_TYPE_2D_ARRAY;
+    dstViewCreateInfo.mipLevel                         = level;
+    dstViewCreateInfo.mipLevelCount                    = 1;
+    dstViewCreateInfo.arrayLayer                       = 0;
+    dstViewCreateInfo.arrayLayerCount                  = layerCount;
+
+    ppxres = mDevice->CreateStorageImageView(&dstViewCreateInfo, &dispatch.dstView);
+    if (Failed(ppxres)) {
+        mDevice->DestroySampledImageView(dispatch.srcView);
+        return ppxres;
+    }
+
+    // Track the views before anything else can fail so they are released
+    batch.dispatches.push_back(dispatch);
+    Dispatch& tracked = batch.dispatches.back();
+
+    ppxres = mDevice->AllocateDescriptorSet(batch.descriptorPool, mDescriptorSetLayout, &tracked.descriptorSet);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    grfx::WriteDescriptor writes[2] = {};
+    writes[0].binding               = kSrcBinding;
+    writes[0].type                  = grfx::DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    writes[0].pImageView            = tracked.srcView;
+    writes[1].binding               = kDstBinding;
+    writes[1].type                  = grfx::DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    writes[1].pImageView            = tracked.dstView;
+
+    ppxres = tracked.descriptorSet->UpdateDescriptors(2, writes);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    GenerateMipsParams params = {};
+    params.srcSize[0]         = std::max<uint32_t>(pImage->GetWidth() >> (level - 1), 1);
+    params.srcSize[1]         = std::max<uint32_t>(pImage->GetHeight() >> (level - 1), 1);
+    params.dstSize[0]         = std::max<uint32_t>(pImage->GetWidth() >> level, 1);
+    params.dstSize[1]         = std::max<uint32_t>(pImage->GetHeight() >> level, 1);
+    params.srgb               = image.srgb ? 1 : 0;
+
+    const grfx::DescriptorSet* pSet = tracked.descriptorSet;
+    pCommandBuffer->BindComputeDescriptorSets(mPipelineInterface, 1, &pSet);
+    pCommandBuffer->PushComputeConstants(mPipelineInterface, kParamsDWORDCount, &params);
+    pCommandBuffer->Dispatch(
+        (params.dstSize[0] + kThreadGroupSize - 1) / kThreadGroupSize,
+        (params.dstSize[1] + kThreadGroupSize - 1) / kThreadGroupSize,
+        layerCount);
+
+    return ppx::SUCCESS;
+}
+
+Result MipGenerator::RecordGenerateMips(grfx::CommandBuffer* pCommandBuffer, const std::vector<MipGeneratorImage>& images)
+{
+    PPX_ASSERT_NULL_ARG(pCommandBuffer);
+    PPX_ASSERT_MSG(!IsNull(mDevice), "MipGenerator is not initialized");
+
+    uint32_t dispatchCount = 0;
+    uint32_t maxLevelCount = 0;
+    for (const auto& image : images) {
+        if (IsNull(image.pImage)) {
+            return ppx::ERROR_UNEXPECTED_NULL_ARGUMENT;
+        }
+        if (image.pImage->GetMipLevelCount() > 1) {
+            if (!IsFormatSupported(image.pImage->GetFormat())) {
+                PPX_LOG_ERROR("MipGenerator: unsupported image format " << static_cast<uint32_t>(image.pImage->GetFormat()));
+                return ppx::ERROR_IMAGE_INVALID_FORMAT;
+            }
+            if (image.pImage->GetType() != grfx::IMAGE_TYPE_2D && image.pImage->GetType() != grfx::IMAGE_TYPE_CUBE) {
+                return ppx::ERROR_GRFX_OPERATION_NOT_PERMITTED;
+            }
+        }
+        dispatchCount += image.pImage->GetMipLevelCount() - 1;
+        maxLevelCount = std::max(maxLevelCount, image.pImage->GetMipLevelCount());
+    }
+
+    // Level 0 is read as a shader resource, every other level is written as
+    // a storage image before it becomes the source of the next level.
+    for (const auto& image : images) {
+        grfx::Image*   pImage     = image.pImage;
+        const uint32_t levelCount = pImage->GetMipLevelCount();
+        const uint32_t layerCount = pImage->GetArrayLayerCount();
+        if (levelCount == 1) {
+            if (image.stateBefore != image.stateAfter) {
+                pCommandBuffer->TransitionImageLayout(pImage, 0, 1, 0, layerCount, image.stateBefore, image.stateAfter);
+            }
+            continue;
+        }
+        if (image.stateBefore != grfx::RESOURCE_STATE_SHADER_RESOURCE) {
+            pCommandBuffer->TransitionImageLayout(pImage, 0, 1, 0, layerCount, image.stateBefore, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+        }
+        if (image.stateBefore != grfx::RESOURCE_STATE_GENERAL) {
+            pCommandBuffer->TransitionImageLayout(pImage, 1, levelCount - 1, 0, layerCount, image.stateBefore, grfx::RESOURCE_STATE_GENERAL);
+        }
+    }
+
+    if (dispatchCount > 0) {
+        mBatches.emplace_back();
+        Batch& batch = mBatches.back();
+
+        grfx::DescriptorPoolCreateInfo poolCreateInfo = {};
+        poolCreateInfo.sampledImage                   = dispatchCount;
+        poolCreateInfo.storageImage                   = dispatchCount;
+
+        Result ppxres = mDevice->CreateDescriptorPool(&poolCreateInfo, &batch.descriptorPool);
+        if (Failed(ppxres)) {
+            mBatches.pop_back();
+            return ppxres;
+        }
+        batch.dispatches.reserve(dispatchCount);
+
+        pCommandBuffer->BindComputePipeline(mPipeline);
+
+        // Level by level across all images so the dispatches of one level
+        // do not wait on each other.
+        for (uint32_t level = 1; level < maxLevelCount; ++level) {
+            for (const auto& image : images) {
+                if (level >= image.pImage->GetMipLevelCount()) {
+                    continue;
+                }
+                ppxres = RecordDispatch(pCommandBuffer, batch, image, level);
+                if (Failed(ppxres)) {
+                    return ppxres;
+                }
+            }
+            for (const auto& image : images) {
+                if (level >= image.pImage->GetMipLevelCount()) {
+                    continue;
+                }
+                pCommandBuffer->TransitionImageLayout(image.pImage, level, 1, 0, image.pImage->GetArrayLayerCount(), grfx::RESOURCE_STATE_GENERAL, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+            }
+        }
+    }
+
+    for (const auto& image : images) {
+        grfx::Image* pImage = image.pImage;
+        if ((pImage->GetMipLevelCount() > 1) && (image.stateAfter != grfx::RESOURCE_STATE_SHADER_RESOURCE)) {
+            pCommandBuffer->TransitionImageLayout(pImage, 0, pImage->GetMipLevelCount(), 0, pImage->GetArrayLayerCount(), grfx::RESOURCE_STATE_SHADER_RESOURCE, image.stateAfter);
+        }
+    }
+
+    return ppx::SUCCESS;
+}
+
+void MipGenerator::ReleaseRecordedResources()
+{
+    for (auto& batch : mBatches) {
+        for (auto& dispatch : batch.dispatches) {
+            if (dispatch.descriptorSet) {
+                mDevice->FreeDescriptorSet(dispatch.descriptorSet);
+            }
+            mDevice->DestroyStorageImageView(dispatch.dstView);
+            mDevice->DestroySampledImageView(dispatch.srcView);
+        }
+        mDevice->DestroyDescriptorPool(batch.descriptorPool);
+    }
+    mBatches.clear();
+}
+
+Result MipGenerator::GenerateMips(grfx::Queue* pQueue, const std::vector<MipGeneratorImage>& images)
+{
+    PPX_ASSERT_NULL_ARG(pQueue);
+
+    grfx::CommandBufferPtr cmdBuffer;
+    Result                 ppxres = pQueue->CreateCommandBuffer(&cmdBuffer);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    ppxres = cmdBuffer->Begin();
+    if (Success(ppxres)) {
+        ppxres = RecordGenerateMips(cmdBuffer, images);
+        // Always close the command buffer, even when recording stopped early
+        Result endres = cmdBuffer->End();
+        if (Success(ppxres)) {
+            ppxres = endres;
+        }
+    }
+
+    if (Success(ppxres)) {
+        grfx::SubmitInfo submitInfo   = {};
+        submitInfo.commandBufferCount = 1;
+        submitInfo.ppCommandBuffers   = &cmdBuffer;
+
+        ppxres = pQueue->Submit(&submitInfo);
+        if (Success(ppxres)) {
+            ppxres = pQueue->WaitIdle();
+        }
+    }
+
+    ReleaseRecordedResources();
+    pQueue->DestroyCommandBuffer(cmdBuffer);
+
+    return ppxres;
+}
+
+} // namespace ppx
@@ -75,6 +75,63 @@ Mipmap::Mipmap(uint32_t width, uint32_t height, Bitmap::Format format, uint32_t
 
 Mipmap::Mipmap(uint32_t width, uint32_t height, Bitmap::Format format, uint32_t levelCount, bool useStaticPool)
     : mUseStaticPool(useStaticPool)
+{
+    InitializeLevels(width, height, format, levelCount, 0);
+}
+
+Mipmap::Mipmap(const Bitmap& bitmap, uint32_t levelCount)
+    : Mipmap(bitmap, levelCount, /* useStaticPool= */ false)
+{
+}
+
+Mipmap::Mipmap(const Bitmap& bitmap, uint32_t levelCount, bool useStaticPool)
+    : Mipmap(bitmap.GetWidth(), bitmap.GetHeight(), bitmap.GetFormat(), levelCount, useStaticPool)
+{
+    Bitmap* pMip0 = GetMip(0);
+    if (!IsNull(pMip0)) {
+        Result ppxres = bitmap.GetView().CopyTo(pMip0->GetView());
+        if (Failed(ppxres)) {
+            mData.clear();
+            mMips.clear();
+            return;
+        }
+        GenerateLevels();
+    }
+}
+
+Mipmap::Mipmap(Bitmap&& bitmap, uint32_t levelCount)
+    : Mipmap(std::move(bitmap), levelCount, /* useStaticPool= */ false)
+{
+}
+
+Mipmap::Mipmap(Bitmap&& bitmap, uint32_t levelCount, bool useStaticPool)
+    : mUseStaticPool(useStaticPool)
+{
+    if (!bitmap.IsOk()) {
+        return;
+    }
+
+    InitializeLevels(bitmap.GetWidth(), bitmap.GetHeight(), bitmap.GetFormat(), levelCount, 1);
+    if (mMips.empty()) {
+        return;
+    }
+
+    mMips[0]         = std::move(bitmap);
+    mLevel0IsAdopted = true;
+    GenerateLevels();
+}
+
+Mipmap::Mipmap(const BitmapView& level0, uint32_t levelCount)
+    : Mipmap(level0, levelCount, /* useStaticPool= */ false)
+{
+}
+
+Mipmap::Mipmap(const BitmapView& level0, uint32_t levelCount, bool useStaticPool)
+    : Mipmap(Bitmap::Create(level0.GetWidth(), level0.GetHeight(), level0.GetFormat(), level0.GetRowStride(), level0.GetData()), levelCount, useStaticPool)
+{
+}
+
+void Mipmap::InitializeLevels(uint32_t width, uint32_t height, Bitmap::Format format, uint32_t levelCount, uint32_t firstLevel)
 {
     levelCount = CalculatActualLevelCount(width, height, levelCount);
 
@@ -83,6 +140,12 @@ Mipmap::Mipmap(uint32_t width, uint32_t height, Bitmap::Format format, uint32_t
         return;
     }
 
+    // Level 0 brings its own storage
+    size_t level0Size = static_cast<size_t>(CalculateDataSize(width, height, format, 1));
+    if (firstLevel > 0) {
+        dataSize -= level0Size;
+    }
+
     // Choose between static pool use and internal data.
     // NOTE: This is designed for single-threaded use ONLY!
     // This will need locks if the consuming paths ever become multi-threaded.
@@ -96,55 +159,37 @@ Mipmap::Mipmap(uint32_t width, uint32_t height, Bitmap::Format format, uint32_t
     const size_t pixelWidth = static_cast<size_t>(Bitmap::FormatSize(format));
     size_t       offset     = 0;
     for (uint32_t i = 0; i < levelCount; ++i) {
-        char* pStorage = targetData.data() + offset;
+        if (i >= firstLevel) {
+            char* pStorage = targetData.data() + offset;
 
-        Bitmap& mip = mMips[i];
+            Result ppxres = Bitmap::Create(width, height, format, pStorage, &mMips[i]);
+            if (Failed(ppxres)) {
+                mMips.clear();
+                return;
+            }
 
-        Result ppxres = Bitmap::Create(width, height, format, pStorage, &mip);
-        if (Failed(ppxres)) {
-            mMips.clear();
-            return;
+            size_t rowStride = width * pixelWidth;
+            size_t size      = rowStride * height;
+            offset += size;
         }
 
-        size_t rowStride = width * pixelWidth;
-        size_t size      = rowStride * height;
-        offset += size;
-
         width  = width / 2;
         height = height / 2;
     }
 }
 
-Mipmap::Mipmap(const Bitmap& bitmap, uint32_t levelCount)
-    : Mipmap(bitmap, levelCount, /* useStaticPool= */ false)
+void Mipmap::GenerateLevels()
 {
-}
+    for (uint32_t level = 1; level < GetLevelCount(); ++level) {
+        uint32_t prevLevel = level - 1;
+        Bitmap*  pPrevMip  = GetMip(prevLevel);
+        Bitmap*  pMip      = GetMip(level);
 
-Mipmap::Mipmap(const Bitmap& bitmap, uint32_t levelCount, bool useStaticPool)
-    : Mipmap(bitmap.GetWidth(), bitmap.GetHeight(), bitmap.GetFormat(), levelCount, useStaticPool)
-{
-    Bitmap* pMip0 = GetMip(0);
-    if (!IsNull(pMip0)) {
-        uint64_t    srcSize  = bitmap.GetFootprintSize();
-        const char* pSrcData = bitmap.GetData();
-        uint64_t    dstSize  = pMip0->GetFootprintSize();
-        char*       pDstData = pMip0->GetData();
-        if ((srcSize > 0) && (srcSize == dstSize) && !IsNull(pSrcData) && !IsNull(pDstData)) {
-            memcpy(pDstData, pSrcData, srcSize);
-
-            // Generate mip
-            for (uint32_t level = 1; level < levelCount; ++level) {
-                uint32_t prevLevel = level - 1;
-                Bitmap*  pPrevMip  = GetMip(prevLevel);
-                Bitmap*  pMip      = GetMip(level);
-
-                Result ppxres = pPrevMip->ScaleTo(pMip, STBIR_FILTER_BOX);
-                if (Failed(ppxres)) {
-                    mData.clear();
-                    mMips.clear();
-                    return;
-                }
-            }
+        Result ppxres = pPrevMip->ScaleTo(pMip, STBIR_FILTER_BOX);
+        if (Failed(ppxres)) {
+            mData.clear();
+            mMips.clear();
+            return;
         }
     }
 }
@@ -170,6 +215,11 @@ bool Mipmap::IsOk() const
                                ? static_cast<uint64_t>(mStaticData.size())
                                : static_cast<uint64_t>(mData.size());
 
+    // An adopted level 0 is not part of the storage
+    if (mLevel0IsAdopted) {
+        dataSize -= CalculateDataSize(width, height, format, 1);
+    }
+
     if (storageSize < dataSize) {
         return false;
     }
@@ -0,0 +1,526 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ppx/pixel_conversion.h"
+#include "ppx/util.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define PPX_PIXEL_CONVERSION_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__SSSE3__)
+#define PPX_PIXEL_CONVERSION_SSSE3
+#include <tmmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define PPX_PIXEL_CONVERSION_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__F16C__)
+#define PPX_PIXEL_CONVERSION_F16C
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PPX_PIXEL_CONVERSION_NEON
+#include <arm_neon.h>
+#endif
+
+namespace ppx {
+
+static const float kUnorm8Scale  = 1.0f / 255.0f;
+static const float kUnorm16Scale = 1.0f / 65535.0f;
+
+// Linear values are quantized to this many steps for the sRGB encode table,
+// fine enough that the result is within 1 of LinearToSRGB() rounded to 8 bits.
+static const uint32_t kSRGBEncodeTableSize = 65536;
+
+// -------------------------------------------------------------------------------------------------
+// Scalar helpers
+// -------------------------------------------------------------------------------------------------
+static inline uint32_t SwizzleRB(uint32_t value)
+{
+    return (value & 0xFF00FF00u) | ((value >> 16) & 0xFFu) | ((value & 0xFFu) << 16);
+}
+
+static inline float Saturate(float value)
+{
+    // Written so that NaN becomes 0
+    value = (value > 0.0f) ? value : 0.0f;
+    return (value < 1.0f) ? value : 1.0f;
+}
+
+// -------------------------------------------------------------------------------------------------
+// SSE2 helpers
+// -------------------------------------------------------------------------------------------------
+#if defined(PPX_PIXEL_CONVERSION_SSE2)
+static inline __m128i Select(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// Packs the low 16 bits of each 32-bit lane without saturation
+static inline __m128i PackLow16(__m128i a, __m128i b)
+{
+    a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+    b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+    return _mm_packs_epi32(a, b);
+}
+
+// Round to nearest even, see FloatToHalf()
+static inline __m128i FloatToHalfSSE2(__m128 value)
+{
+    const __m128i signMask    = _mm_set1_epi32(static_cast<int>(0x80000000u));
+    const __m128i f32Infinity = _mm_set1_epi32(255 << 23);
+    const __m128i f16Max      = _mm_set1_epi32((127 + 16) << 23);
+    const __m128i normalMin   = _mm_set1_epi32(113 << 23);
+    const __m128i denormMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+    const __m128i rebias      = _mm_set1_epi32(static_cast<int>((static_cast<uint32_t>(15 - 127) << 23) + 0xFFF));
+
+    __m128i bits = _mm_castps_si128(value);
+    __m128i sign = _mm_and_si128(bits, signMask);
+    bits         = _mm_xor_si128(bits, sign);
+
+    // Out of range becomes infinity, NaN stays NaN
+    __m128i isOverflow = _mm_xor_si128(_mm_cmpgt_epi32(f16Max, bits), _mm_set1_epi32(-1));
+    __m128i isNaN      = _mm_cmpgt_epi32(bits, f32Infinity);
+    __m128i infNaN     = _mm_or_si128(_mm_set1_epi32(0x7C00), _mm_and_si128(isNaN, _mm_set1_epi32(0x200)));
+
+    // Denormals are rounded by the float addition
+    __m128i isDenormal = _mm_cmpgt_epi32(normalMin, bits);
+    __m128i denormal   = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(bits), _mm_castsi128_ps(denormMagic))), denormMagic);
+
+    // Normals round to nearest even, a carry into the exponent is intended
+    __m128i mantissaOdd = _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(1));
+    __m128i normal      = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(bits, rebias), mantissaOdd), 13);
+
+    __m128i half = Select(isDenormal, denormal, normal);
+    half         = Select(isOverflow, infNaN, half);
+    return _mm_or_si128(half, _mm_srli_epi32(sign, 16));
+}
+
+// Exact, see HalfToFloat(). \b value holds one half per 32-bit lane.
+static inline __m128 HalfToFloatSSE2(__m128i value)
+{
+    const __m128i exponentMask = _mm_set1_epi32(0x7C00 << 13);
+    const __m128i magic        = _mm_set1_epi32(113 << 23);
+
+    __m128i bits     = _mm_slli_epi32(_mm_and_si128(value, _mm_set1_epi32(0x7FFF)), 13);
+    __m128i exponent = _mm_and_si128(bits, exponentMask);
+    bits             = _mm_add_epi32(bits, _mm_set1_epi32((127 - 15) << 23));
+
+    // Inf or NaN needs the maximum exponent
+    __m128i isInfNaN = _mm_cmpeq_epi32(exponent, exponentMask);
+    bits             = _mm_add_epi32(bits, _mm_and_si128(isInfNaN, _mm_set1_epi32((128 - 16) << 23)));
+
+    // Zero and denormals are renormalized by a float subtraction
+    __m128i isDenormal = _mm_cmpeq_epi32(exponent, _mm_setzero_si128());
+    __m128  denormal   = _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(bits, _mm_set1_epi32(1 << 23))), _mm_castsi128_ps(magic));
+    bits               = Select(isDenormal, _mm_castps_si128(denormal), bits);
+
+    __m128i sign = _mm_slli_epi32(_mm_and_si128(value, _mm_set1_epi32(0x8000)), 16);
+    return _mm_castsi128_ps(_mm_or_si128(bits, sign));
+}
+
+static inline __m128i FloatToUnormSSE2(__m128 value, float scale)
+{
+    value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    value = _mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(scale)), _mm_set1_ps(0.5f));
+    return _mm_cvttps_epi32(value);
+}
+#endif // defined(PPX_PIXEL_CONVERSION_SSE2)
+
+// -------------------------------------------------------------------------------------------------
+// Channel order
+// -------------------------------------------------------------------------------------------------
+void SwizzleRB8(const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount)
+{
+    size_t i = 0;
+#if defined(PPX_PIXEL_CONVERSION_AVX2)
+    {
+        const __m256i greenAlpha = _mm256_set1_epi32(static_cast<int>(0xFF00FF00u));
+        const __m256i lowByte    = _mm256_set1_epi32(0xFF);
+        const __m256i thirdByte  = _mm256_set1_epi32(0xFF0000);
+        for (; i + 8 <= pixelCount; i += 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc + 4 * i));
+            __m256i r = _mm256_and_si256(_mm256_slli_epi32(v, 16), thirdByte);
+            __m256i b = _mm256_and_si256(_mm256_srli_epi32(v, 16), lowByte);
+            v         = _mm256_or_si256(_mm256_and_si256(v, greenAlpha), _mm256_or_si256(r, b));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDst + 4 * i), v);
+        }
+    }
+#endif
+#if defined(PPX_PIXEL_CONVERSION_SSE2)
+    {
+        const __m128i greenAlpha = _mm_set1_epi32(static_cast<int>(0xFF00FF00u));
+        const __m128i lowByte    = _mm_set1_epi32(0xFF);
+        const __m128i thirdByte  = _mm_set1_epi32(0xFF0000);
+        for (; i + 4 <= pixelCount; i += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 4 * i));
+            __m128i r = _mm_and_si128(_mm_slli_epi32(v, 16), thirdByte);
+            __m128i b = _mm_and_si128(_mm_srli_epi32(v, 16), lowByte);
+            v         = _mm_or_si128(_mm_and_si128(v, greenAlpha), _mm_or_si128(r, b));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + 4 * i), v);
+        }
+    }
+#elif defined(PPX_PIXEL_CONVERSION_NEON)
+    for (; i + 16 <= pixelCount; i += 16) {
+        uint8x16x4_t v = vld4q_u8(pSrc + 4 * i);
+        uint8x16_t   t = v.val[0];
+        v.val[0]       = v.val[2];
+        v.val[2]       = t;
+        vst4q_u8(pDst + 4 * i, v);
+    }
+#endif
+    for (; i < pixelCount; ++i) {
+        uint32_t value = 0;
+        std::memcpy(&value, pSrc + 4 * i, sizeof(value));
+        value = SwizzleRB(value);
+        std::memcpy(pDst + 4 * i, &value, sizeof(value));
+    }
+}
+
+void PackRGBA8ToRGB8(const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount, bool swapRB)
+{
+    size_t i = 0;
+#if defined(PPX_PIXEL_CONVERSION_SSSE3)
+    {
+        // Each store writes 16 bytes of which 12 are kept, so stop while the
+        // extra 4 bytes are still inside the destination.
+        const __m128i shuffle = swapRB
+                                    ? _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)
+                                    : _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+        for (; i + 6 <= pixelCount; i += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 4 * i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + 3 * i), _mm_shuffle_epi8(v, shuffle));
+        }
+    }
+#elif defined(PPX_PIXEL_CONVERSION_NEON)
+    for (; i + 16 <= pixelCount; i += 16) {
+        uint8x16x4_t src = vld4q_u8(pSrc + 4 * i);
+        uint8x16x3_t dst;
+        dst.val[0] = swapRB ? src.val[2] : src.val[0];
+        dst.val[1] = src.val[1];
+        dst.val[2] = swapRB ? src.val[0] : src.val[2];
+        vst3q_u8(pDst + 3 * i, dst);
+    }
+#endif
+    const uint32_t r = swapRB ? 2 : 0;
+    const uint32_t b = swapRB ? 0 : 2;
+    for (; i < pixelCount; ++i) {
+        const uint8_t* pPixel = pSrc + 4 * i;
+        uint8_t        red    = pPixel[r];
+        uint8_t        green  = pPixel[1];
+        uint8_t        blue   = pPixel[b];
+        pDst[3 * i + 0]       = red;
+        pDst[3 * i + 1]       = green;
+        pDst[3 * i + 2]       = blue;
+    }
+}
+
+void ExpandRGB8ToRGBA8(const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount, uint8_t alpha)
+{
+    size_t i = 0;
+#if defined(PPX_PIXEL_CONVERSION_SSSE3)
+    {
+        // Each load reads 16 bytes of which 12 are used
+        const __m128i shuffle    = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i alphaValue = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(alpha) << 24));
+        for (; i + 6 <= pixelCount; i += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + 3 * i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + 4 * i), _mm_or_si128(_mm_shuffle_epi8(v, shuffle), alphaValue));
+        }
+    }
+#elif defined(PPX_PIXEL_CONVERSION_NEON)
+    for (; i + 16 <= pixelCount; i += 16) {
+        uint8x16x3_t src = vld3q_u8(pSrc + 3 * i);
+        uint8x16x4_t dst;
+        dst.val[0] = src.val[0];
+        dst.val[1] = src.val[1];
+        dst.val[2] = src.val[2];
+        dst.val[3] = vdupq_n_u8(alpha);
+        vst4q_u8(pDst + 4 * i, dst);
+    }
+#endif
+    for (; i < pixelCount; ++i) {
+        pDst[4 * i + 0] = pSrc[3 * i + 0];
+        pDst[4 * i + 1] = pSrc[3 * i + 1];
+        pDst[4 * i + 2] = pSrc[3 * i + 2];
+        pDst[4 * i + 3] = alpha;
+    }
+}
+
+void BiasSigned8(const uint8_t* pSrc, uint8_t* pDst, size_t count)
+{
+    size_t i = 0;
+#if defined(PPX_PIXEL_CONVERSION_SSE2)
+    const __m128i signBit = _mm_set1_epi8(static_cast<char>(0x80));
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i), _mm_xor_si128(v, signBit));
+    }
+#elif defined(PPX_PIXEL_CONVERSION_NEON)
+    const uint8x16_t signBit = vdupq_n_u8(0x80);
+    for (; i + 16 <= count; i += 16) {
+        vst1q_u8(pDst + i, veorq_u8(vld1q_u8(pSrc + i), signBit));
+    }
+#endif
+    for (; i < count; ++i) {
+        pDst[i] = pSrc[i] ^ 0x80;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Half float
+// -------------------------------------------------------------------------------------------------
+void ConvertFloatToHalf(const float* pSrc, uint16_t* pDst, size_t count)
+{
+    size_t i = 0;
+#if defined(PPX_PIXEL_CONVERSION_F16C)
+    for (; i + 4 <= count; i += 4) {
+        __m128i half = _mm_cvtps_ph(_mm_loadu_ps(pSrc + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(pDst + i), half);
+    }
+#elif defined(PPX_PIXEL_CONVERSION_SSE2)
+    for (; i + 8 <= count; i += 8) {
+        __m128i a = FloatToHalfSSE2(_mm_loadu_ps(pSrc + i));
+        __m128i b = FloatToHalfSSE2(_mm_loadu_ps(pSrc + i + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i), PackLow16(a, b));
+    }
+#elif defined(PPX_PIXEL_CONVERSION_NEON) && defined(__aarch64__)
+    for (; i + 4 <= count; i += 4) {
+        vst1_u16(pDst + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(pSrc + i))));
+    }
+#endif
+    for (; i < count; ++i) {
+        pDst[i] = FloatToHalf(pSrc[i]);
+    }
+}
+
+void ConvertHalfToFloat(const uint16_t* pSrc, float* pDst, size_t count)
+{
+    size_t i = 0;
+#if defined(PPX_PIXEL_CONVERSION_F16C)
+    for (; i + 4 <= count; i += 4) {
+        __m128i half = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSrc + i));
+        _mm_storeu_ps(pDst + i, _mm_cvtph_ps(half));
+    }
+#elif defined(PPX_PIXEL_CONVERSION_SSE2)
+    for (; i + 8 <= count; i += 8) {
+        __m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i));
+        _mm_storeu_ps(pDst + i, HalfToFloatSSE2(_mm_unpacklo_epi16(half, _mm_setzero_si128())));
+        _mm_storeu_ps(pDst + i + 4, HalfToFloatSSE2(_mm_unpackhi_epi16(half, _mm_setzero_si128())));
+    }
+#elif defined(PPX_PIXEL_CONVERSION_NEON) && defined(__aarch64__)
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(pDst + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(pSrc + i))));
+    }
+#endif
+    for (; i < count; ++i) {
+        pDst[i] = HalfToFloat(pSrc[i]);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Unorm
+// -------------------------------------------------------------------------------------------------
+void ConvertUnorm8ToFloat(const uint8_t* pSrc, float* pDst, size_t count)
+{
+    size_t i = 0;
+#if defined(PPX_PIXEL_CONVERSION_SSE2)
+    const __m128  scale = _mm_set1_ps(kUnorm8Scale);
+    const __m128i zero  = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+        __m128i v  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i));
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        _mm_storeu_ps(pDst + i + 0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+        _mm_storeu_ps(pDst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+        _mm_storeu_ps(pDst + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+        _mm_storeu_ps(pDst + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+    }
+#elif defined(PPX_PIXEL_CONVERSION_NEON)
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t v = vmovl_u8(vld1_u8(pSrc + i));
+        vst1q_f32(pDst + i + 0, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(v))), kUnorm8Scale));
+        vst1q_f32(pDst + i + 4, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(v))), kUnorm8Scale));
+    }
+#endif
+    for (; i < count; ++i) {
+        pDst[i] = static_cast<float>(pSrc[i]) * kUnorm8Scale;
+    }
+}
+
+void ConvertFloatToUnorm8(const float* pSrc, uint8_t* pDst, size_t count)
+{
+    size_t i = 0;
+#if defined(PPX_PIXEL_CONVERSION_SSE2)
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = FloatToUnormSSE2(_mm_loadu_ps(pSrc + i + 0), 255.0f);
+        __m128i b = FloatToUnormSSE2(_mm_loadu_ps(pSrc + i + 4), 255.0f);
+        __m128i c = FloatToUnormSSE2(_mm_loadu_ps(pSrc + i + 8), 255.0f);
+        __m128i d = FloatToUnormSSE2(_mm_loadu_ps(pSrc + i + 12), 255.0f);
+        __m128i v = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i), v);
+    }
+#elif defined(PPX_PIXEL_CONVERSION_NEON) && defined(__aarch64__)
+    for (; i + 8 <= count; i += 8) {
+        float32x4_t a  = vminnmq_f32(vmaxnmq_f32(vld1q_f32(pSrc + i + 0), vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f));
+        float32x4_t b  = vminnmq_f32(vmaxnmq_f32(vld1q_f32(pSrc + i + 4), vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f));
+        uint32x4_t  ua = vcvtq_u32_f32(vaddq_f32(vmulq_n_f32(a, 255.0f), vdupq_n_f32(0.5f)));
+        uint32x4_t  ub = vcvtq_u32_f32(vaddq_f32(vmulq_n_f32(b, 255.0f), vdupq_n_f32(0.5f)));
+        vst1_u8(pDst + i, vmovn_u16(vcombine_u16(vmovn_u32(ua), vmovn_u32(ub))));
+    }
+#endif
+    for (; i < count; ++i) {
+        pDst[i] = static_cast<uint8_t>(Saturate(pSrc[i]) * 255.0f + 0.5f);
+    }
+}
+
+void ConvertUnorm16ToFloat(const uint16_t* pSrc, float* pDst, size_t count)
+{
+    size_t i = 0;
+#if defined(PPX_PIXEL_CONVERSION_SSE2)
+    const __m128  scale = _mm_set1_ps(kUnorm16Scale);
+    const __m128i zero  = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i));
+        _mm_storeu_ps(pDst + i + 0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)), scale));
+        _mm_storeu_ps(pDst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero)), scale));
+    }
+#elif defined(PPX_PIXEL_CONVERSION_NEON)
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(pDst + i, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vld1_u16(pSrc + i))), kUnorm16Scale));
+    }
+#endif
+    for (; i < count; ++i) {
+        pDst[i] = static_cast<float>(pSrc[i]) * kUnorm16Scale;
+    }
+}
+
+void ConvertFloatToUnorm16(const float* pSrc, uint16_t* pDst, size_t count)
+{
+    size_t i = 0;
+#if defined(PPX_PIXEL_CONVERSION_SSE2)
+    for (; i + 8 <= count; i += 8) {
+        __m128i a = FloatToUnormSSE2(_mm_loadu_ps(pSrc + i + 0), 65535.0f);
+        __m128i b = FloatToUnormSSE2(_mm_loadu_ps(pSrc + i + 4), 65535.0f);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i), PackLow16(a, b));
+    }
+#endif
+    for (; i < count; ++i) {
+        pDst[i] = static_cast<uint16_t>(Saturate(pSrc[i]) * 65535.0f + 0.5f);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// sRGB
+// -------------------------------------------------------------------------------------------------
+float SRGBToLinear(float value)
+{
+    return (value <= 0.04045f) ? (value / 12.92f) : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+float LinearToSRGB(float value)
+{
+    return (value <= 0.0031308f) ? (value * 12.92f) : (1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f);
+}
+
+static const float* GetSRGBDecodeTable()
+{
+    static const std::array<float, 256> sTable = [] {
+        std::array<float, 256> table = {};
+        for (uint32_t i = 0; i < 256; ++i) {
+            table[i] = SRGBToLinear(static_cast<float>(i) * kUnorm8Scale);
+        }
+        return table;
+    }();
+    return sTable.data();
+}
+
+static const uint8_t* GetSRGBEncodeTable()
+{
+    static const std::vector<uint8_t> sTable = [] {
+        std::vector<uint8_t> table(kSRGBEncodeTableSize);
+        for (uint32_t i = 0; i < kSRGBEncodeTableSize; ++i) {
+            float value = static_cast<float>(i) / static_cast<float>(kSRGBEncodeTableSize - 1);
+            table[i]    = static_cast<uint8_t>(Saturate(LinearToSRGB(value)) * 255.0f + 0.5f);
+        }
+        return table;
+    }();
+    return sTable.data();
+}
+
+void DecodeSRGB8(const uint8_t* pSrc, float* pDst, size_t pixelCount, uint32_t channelCount)
+{
+    const float* pTable     = GetSRGBDecodeTable();
+    const bool   hasAlpha   = (channelCount == 4);
+    const size_t valueCount = pixelCount * channelCount;
+    for (size_t i = 0; i < valueCount; ++i) {
+        pDst[i] = pTable[pSrc[i]];
+    }
+    if (hasAlpha) {
+        for (size_t i = 3; i < valueCount; i += 4) {
+            pDst[i] = static_cast<float>(pSrc[i]) * kUnorm8Scale;
+        }
+    }
+}
+
+void EncodeSRGB8(const float* pSrc, uint8_t* pDst, size_t pixelCount, uint32_t channelCount)
+{
+    const uint8_t* pTable     = GetSRGBEncodeTable();
+    const bool     hasAlpha   = (channelCount == 4);
+    const size_t   valueCount = pixelCount * channelCount;
+    const float    scale      = static_cast<float>(kSRGBEncodeTableSize - 1);
+    for (size_t i = 0; i < valueCount; ++i) {
+        uint32_t index = static_cast<uint32_t>(Saturate(pSrc[i]) * scale + 0.5f);
+        pDst[i]        = pTable[index];
+    }
+    if (hasAlpha) {
+        for (size_t i = 3; i < valueCount; i += 4) {
+            pDst[i] = static_cast<uint8_t>(Saturate(pSrc[i]) * 255.0f + 0.5f);
+        }
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Fill
+// -------------------------------------------------------------------------------------------------
+void FillPixels(void* pDst, const void* pPixel, uint32_t pixelSize, size_t pixelCount)
+{
+    if ((pixelCount == 0) || (pixelSize == 0)) {
+        return;
+    }
+
+    // Double the filled range with every copy
+    char* pBytes = static_cast<char*>(pDst);
+    std::memcpy(pBytes, pPixel, pixelSize);
+    size_t filled = 1;
+    while (filled < pixelCount) {
+        size_t n = std::min(filled, pixelCount - filled);
+        std::memcpy(pBytes + filled * pixelSize, pBytes, n * pixelSize);
+        filled += n;
+    }
+}
+
+} // namespace ppx
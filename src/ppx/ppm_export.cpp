@@ -13,24 +13,12 @@
 // limitations under the License.
 
 #include "ppx/ppm_export.h"
+#include "ppx/pixel_conversion.h"
 
-namespace ppx {
+#include <fstream>
+#include <vector>
 
-unsigned char ConvertToUint(const char* value, grfx::FormatDataType dataType)
-{
-    switch (dataType) {
-        case grfx::FORMAT_DATA_TYPE_SINT:
-        case grfx::FORMAT_DATA_TYPE_SNORM: {
-            return *value + 128;
-        }
-        case grfx::FORMAT_DATA_TYPE_UINT:
-        case grfx::FORMAT_DATA_TYPE_UNORM:
-        case grfx::FORMAT_DATA_TYPE_SRGB:
-        default: {
-            return *(unsigned char*)value;
-        }
-    }
-}
+namespace ppx {
 
 bool IsOptimalFormat(const grfx::FormatDesc* desc, uint32_t width, uint32_t rowStride)
 {
@@ -87,46 +75,51 @@ Result ExportToPPM(std::ostream& outputStream, grfx::Format inputFormat, const v
                  << height << "\n"
                  << 255 << "\n";
 
-    // This is a naive implementation, and favors flexibility over performance
-    // with the aim to support as many format variations as possible.
-    // We only optimize for the best possible scenario, and fall back to the
-    // generic implemention in other cases.
+    // Tightly packed RGB data is written as is.
     if (IsOptimalFormat(desc, width, rowStride)) {
         outputStream.write((const char*)texels, static_cast<std::streamsize>(rowStride) * height);
         return SUCCESS;
     }
 
-    char        zero = 0;
-    const char* data = (const char*)texels;
-    for (uint32_t y = 0; y < height; y++) {
-        const char* row = data;
-        for (uint32_t x = 0; x < width; x++) {
-            if (desc->componentBits & grfx::FORMAT_COMPONENT_RED) {
-                unsigned char red = ConvertToUint(row + desc->componentOffset.red, desc->dataType);
-                outputStream.write((const char*)&red, 1);
-            }
-            else {
-                outputStream.write(&zero, 1);
-            }
+    // Convert one row at a time into RGB and write it with a single call.
+    // Common layouts use the conversion kernels, anything else is gathered
+    // per texel.
+    const bool isSigned = (desc->dataType == grfx::FORMAT_DATA_TYPE_SINT) || (desc->dataType == grfx::FORMAT_DATA_TYPE_SNORM);
+    const bool hasRGB   = (desc->componentBits & rgbMask) == rgbMask;
+    const bool isRGBA   = hasRGB && (desc->bytesPerTexel == 4) && (desc->componentOffset.red == 0) && (desc->componentOffset.green == 1) && (desc->componentOffset.blue == 2);
+    const bool isBGRA   = hasRGB && (desc->bytesPerTexel == 4) && (desc->componentOffset.red == 2) && (desc->componentOffset.green == 1) && (desc->componentOffset.blue == 0);
 
-            if (desc->componentBits & grfx::FORMAT_COMPONENT_GREEN) {
-                unsigned char green = ConvertToUint(row + desc->componentOffset.green, desc->dataType);
-                outputStream.write((const char*)&green, 1);
-            }
-            else {
-                outputStream.write(&zero, 1);
+    std::vector<unsigned char> rgbRow(static_cast<size_t>(width) * 3);
+    const char*                data = (const char*)texels;
+    for (uint32_t y = 0; y < height; y++) {
+        const unsigned char* row = (const unsigned char*)data;
+        if (isRGBA || isBGRA) {
+            PackRGBA8ToRGB8(row, rgbRow.data(), width, isBGRA);
+        }
+        else {
+            for (uint32_t x = 0; x < width; x++) {
+                unsigned char* rgb = rgbRow.data() + 3 * x;
+                rgb[0]             = (desc->componentBits & grfx::FORMAT_COMPONENT_RED) ? row[desc->componentOffset.red] : 0;
+                rgb[1]             = (desc->componentBits & grfx::FORMAT_COMPONENT_GREEN) ? row[desc->componentOffset.green] : 0;
+                rgb[2]             = (desc->componentBits & grfx::FORMAT_COMPONENT_BLUE) ? row[desc->componentOffset.blue] : 0;
+                row += desc->bytesPerTexel;
             }
+        }
 
-            if (desc->componentBits & grfx::FORMAT_COMPONENT_BLUE) {
-                unsigned char blue = ConvertToUint(row + desc->componentOffset.blue, desc->dataType);
-                outputStream.write((const char*)&blue, 1);
-            }
-            else {
-                outputStream.write(&zero, 1);
+        if (isSigned && hasRGB) {
+            BiasSigned8(rgbRow.data(), rgbRow.data(), rgbRow.size());
+        }
+        else if (isSigned) {
+            // Missing channels stay 0
+            for (uint32_t x = 0; x < width; x++) {
+                unsigned char* rgb = rgbRow.data() + 3 * x;
+                rgb[0] ^= (desc->componentBits & grfx::FORMAT_COMPONENT_RED) ? 0x80 : 0;
+                rgb[1] ^= (desc->componentBits & grfx::FORMAT_COMPONENT_GREEN) ? 0x80 : 0;
+                rgb[2] ^= (desc->componentBits & grfx::FORMAT_COMPONENT_BLUE) ? 0x80 : 0;
             }
-
-            row += desc->bytesPerTexel;
         }
+
+        outputStream.write((const char*)rgbRow.data(), static_cast<std::streamsize>(rgbRow.size()));
         data += rowStride;
     }
 
@@ -0,0 +1,255 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ppx/streaming_texture.h"
+#include "ppx/util.h"
+#include "ppx/grfx/grfx_buffer.h"
+#include "ppx/grfx/grfx_device.h"
+#include "ppx/grfx/grfx_scope.h"
+
+#include <cstring>
+
+namespace ppx {
+
+Result StreamingTexture::Initialize(grfx::Queue* pQueue, const std::filesystem::path& path, uint64_t initialByteBudget)
+{
+    PPX_ASSERT_NULL_ARG(pQueue);
+    if (!IsNull(mQueue)) {
+        return ppx::ERROR_SINGLE_INIT_ONLY;
+    }
+
+    Result ppxres = mContainer.Open(path);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    const grfx::FormatDesc* pDesc = grfx::GetFormatDescription(mContainer.GetFormat());
+    if ((pDesc->blockWidth > 1) && (((mContainer.GetWidth() % pDesc->blockWidth) != 0) || ((mContainer.GetHeight() % pDesc->blockWidth) != 0))) {
+        PPX_LOG_ERROR("Compressed texture " << path << " must have dimensions that are a multiple of " << pDesc->blockWidth);
+        return ppx::ERROR_IMAGE_INVALID_FORMAT;
+    }
+
+    // Levels are written individually, the rest of the chain stays in the
+    // shader resource state so the image can be sampled between uploads.
+    {
+        grfx::ImageCreateInfo ci       = {};
+        ci.type                        = grfx::IMAGE_TYPE_2D;
+        ci.width                       = mContainer.GetWidth();
+        ci.height                      = mContainer.GetHeight();
+        ci.depth                       = 1;
+        ci.format                      = mContainer.GetFormat();
+        ci.sampleCount                 = grfx::SAMPLE_COUNT_1;
+        ci.mipLevelCount               = mContainer.GetLevelCount();
+        ci.arrayLayerCount             = 1;
+        ci.usageFlags.bits.transferDst = true;
+        ci.usageFlags.bits.sampled     = true;
+        ci.memoryUsage                 = grfx::MEMORY_USAGE_GPU_ONLY;
+        ci.initialState                = grfx::RESOURCE_STATE_SHADER_RESOURCE;
+
+        ppxres = pQueue->GetDevice()->CreateImage(&ci, &mImage);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+    }
+
+    mQueue         = pQueue;
+    mResidentLevel = mContainer.GetLevelCount();
+    mResidentBytes = 0;
+
+    ppxres = Update(initialByteBudget);
+    if (Failed(ppxres)) {
+        Shutdown();
+        return ppxres;
+    }
+
+    return ppx::SUCCESS;
+}
+
+void StreamingTexture::Shutdown()
+{
+    if (IsNull(mQueue)) {
+        return;
+    }
+
+    grfx::Device* pDevice = mQueue->GetDevice();
+    for (auto& view : mRetiredViews) {
+        pDevice->DestroySampledImageView(view);
+    }
+    mRetiredViews.clear();
+
+    if (mSampledImageView) {
+        pDevice->DestroySampledImageView(mSampledImageView);
+        mSampledImageView.Reset();
+    }
+    if (mImage) {
+        pDevice->DestroyImage(mImage);
+        mImage.Reset();
+    }
+
+    mQueue         = nullptr;
+    mResidentLevel = 0;
+    mResidentBytes = 0;
+}
+
+Result StreamingTexture::Update(uint64_t byteBudget, bool* pViewChanged)
+{
+    PPX_ASSERT_MSG(!IsNull(mQueue), "StreamingTexture is not initialized");
+
+    if (!IsNull(pViewChanged)) {
+        *pViewChanged = false;
+    }
+    if (IsFullyResident()) {
+        return ppx::SUCCESS;
+    }
+
+    // Take the next levels toward level 0 that fit in the budget, always at
+    // least one so that the texture makes progress with a budget of 0.
+    uint32_t firstLevel = mResidentLevel - 1;
+    uint64_t totalSize  = mContainer.GetLevel(firstLevel).size;
+    while (firstLevel > 0) {
+        const uint64_t levelSize = mContainer.GetLevel(firstLevel - 1).size;
+        if (totalSize + levelSize > byteBudget) {
+            break;
+        }
+        totalSize += levelSize;
+        --firstLevel;
+    }
+
+    Result ppxres = UploadLevels(firstLevel, mResidentLevel - firstLevel);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    mResidentLevel = firstLevel;
+    mResidentBytes += totalSize;
+
+    ppxres = UpdateSampledImageView();
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    if (!IsNull(pViewChanged)) {
+        *pViewChanged = true;
+    }
+
+    return ppx::SUCCESS;
+}
+
+Result StreamingTexture::UploadLevels(uint32_t firstLevel, uint32_t levelCount)
+{
+    grfx::Device* pDevice = mQueue->GetDevice();
+
+    // Scoped destroy
+    grfx::ScopeDestroyer SCOPED_DESTROYER(pDevice);
+
+    // Row stride and texture offset alignment to handle DX's requirements
+    const uint32_t          rowStrideAlignment = grfx::IsDx12(pDevice->GetApi()) ? PPX_D3D12_TEXTURE_DATA_PITCH_ALIGNMENT : 1;
+    const uint32_t          offsetAlignment    = grfx::IsDx12(pDevice->GetApi()) ? PPX_D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT : 1;
+    const grfx::FormatDesc* pDesc              = grfx::GetFormatDescription(mContainer.GetFormat());
+
+    std::vector<grfx::BufferToImageCopyInfo> copyInfos(levelCount);
+    uint64_t                                 stagingSize = 0;
+    for (uint32_t i = 0; i < levelCount; ++i) {
+        const TextureContainerLevel& level    = mContainer.GetLevel(firstLevel + i);
+        auto&                        copyInfo = copyInfos[i];
+
+        copyInfo.srcBuffer.imageWidth      = (level.rowStride / pDesc->bytesPerTexel) * pDesc->blockWidth;
+        copyInfo.srcBuffer.imageHeight     = level.rowCount * pDesc->blockWidth;
+        copyInfo.srcBuffer.imageRowStride  = RoundUp<uint32_t>(level.rowStride, rowStrideAlignment);
+        copyInfo.srcBuffer.footprintOffset = stagingSize;
+        copyInfo.srcBuffer.footprintWidth  = copyInfo.srcBuffer.imageWidth;
+        copyInfo.srcBuffer.footprintHeight = copyInfo.srcBuffer.imageHeight;
+        copyInfo.srcBuffer.footprintDepth  = 1;
+        copyInfo.dstImage.mipLevel         = firstLevel + i;
+        copyInfo.dstImage.arrayLayer       = 0;
+        copyInfo.dstImage.arrayLayerCount  = 1;
+        copyInfo.dstImage.x                = 0;
+        copyInfo.dstImage.y                = 0;
+        copyInfo.dstImage.z                = 0;
+        copyInfo.dstImage.width            = level.width;
+        copyInfo.dstImage.height           = level.height;
+        copyInfo.dstImage.depth            = 1;
+
+        stagingSize += static_cast<uint64_t>(copyInfo.srcBuffer.imageRowStride) * level.rowCount;
+        stagingSize = RoundUp<uint64_t>(stagingSize, offsetAlignment);
+    }
+
+    // Create staging buffer
+    grfx::BufferPtr stagingBuffer;
+    {
+        grfx::BufferCreateInfo ci      = {};
+        ci.size                        = stagingSize;
+        ci.usageFlags.bits.transferSrc = true;
+        ci.memoryUsage                 = grfx::MEMORY_USAGE_CPU_TO_GPU;
+
+        Result ppxres = pDevice->CreateBuffer(&ci, &stagingBuffer);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+        SCOPED_DESTROYER.AddObject(stagingBuffer);
+    }
+
+    // Copy straight from the file mapping, only these levels get paged in
+    void*  pBufferAddress = nullptr;
+    Result ppxres         = stagingBuffer->MapMemory(0, &pBufferAddress);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    for (uint32_t i = 0; i < levelCount; ++i) {
+        const TextureContainerLevel& level    = mContainer.GetLevel(firstLevel + i);
+        const auto&                  copyInfo = copyInfos[i];
+        const char*                  pSrc     = mContainer.GetLevelData(firstLevel + i);
+        char*                        pDst     = static_cast<char*>(pBufferAddress) + copyInfo.srcBuffer.footprintOffset;
+        for (uint32_t row = 0; row < level.rowCount; ++row) {
+            std::memcpy(pDst + row * copyInfo.srcBuffer.imageRowStride, pSrc + row * level.rowStride, level.rowStride);
+        }
+    }
+
+    stagingBuffer->UnmapMemory();
+
+    // Only the uploaded levels leave the shader resource state
+    return mQueue->CopyBufferToImage(
+        copyInfos,
+        stagingBuffer,
+        mImage,
+        firstLevel,
+        levelCount,
+        0,
+        1,
+        grfx::RESOURCE_STATE_SHADER_RESOURCE,
+        grfx::RESOURCE_STATE_SHADER_RESOURCE);
+}
+
+Result StreamingTexture::UpdateSampledImageView()
+{
+    grfx::SampledImageViewCreateInfo ci = grfx::SampledImageViewCreateInfo::GuessFromImage(mImage);
+    ci.mipLevel                         = mResidentLevel;
+    ci.mipLevelCount                    = mImage->GetMipLevelCount() - mResidentLevel;
+
+    grfx::SampledImageViewPtr view;
+    Result                    ppxres = mQueue->GetDevice()->CreateSampledImageView(&ci, &view);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    if (mSampledImageView) {
+        mRetiredViews.push_back(mSampledImageView);
+    }
+    mSampledImageView = view;
+
+    return ppx::SUCCESS;
+}
+
+} // namespace ppx
@@ -0,0 +1,350 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ppx/texture_container.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace ppx {
+
+// clang-format off
+constexpr uint32_t kDDSMagic              = 0x20534444; // "DDS "
+constexpr size_t   kDDSHeaderSize         = 124;
+constexpr size_t   kDDSHeaderDX10Size     = 20;
+constexpr uint32_t kDDSFlagMipMapCount    = 0x20000;
+constexpr uint32_t kDDSPixelFormatFourCC  = 0x4;
+constexpr uint32_t kDDSPixelFormatRGB     = 0x40;
+constexpr uint32_t kDDSCaps2CubeMap       = 0x200;
+constexpr uint32_t kDDSCaps2Volume        = 0x200000;
+constexpr uint32_t kDDSResourceTexture2D  = 3;
+constexpr uint32_t kDDSMiscTextureCube    = 0x4;
+
+constexpr uint8_t  kKTX2Identifier[12]    = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+constexpr size_t   kKTX2HeaderSize        = 80;
+constexpr size_t   kKTX2LevelIndexSize    = 24;
+// clang-format on
+
+static constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+{
+    return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+}
+
+static uint32_t ReadU32(const char* pData, size_t offset)
+{
+    uint32_t value = 0;
+    std::memcpy(&value, pData + offset, sizeof(value));
+    return value;
+}
+
+static uint64_t ReadU64(const char* pData, size_t offset)
+{
+    uint64_t value = 0;
+    std::memcpy(&value, pData + offset, sizeof(value));
+    return value;
+}
+
+static grfx::Format DXGIFormatToGrfx(uint32_t value)
+{
+    // clang-format off
+    switch (value) {
+        default: break;
+        case 2  : return grfx::FORMAT_R32G32B32A32_FLOAT; break;
+        case 10 : return grfx::FORMAT_R16G16B16A16_FLOAT; break;
+        case 28 : return grfx::FORMAT_R8G8B8A8_UNORM; break;
+        case 29 : return grfx::FORMAT_R8G8B8A8_SRGB; break;
+        case 49 : return grfx::FORMAT_R8G8_UNORM; break;
+        case 61 : return grfx::FORMAT_R8_UNORM; break;
+        case 71 : return grfx::FORMAT_BC1_RGBA_UNORM; break;
+        case 72 : return grfx::FORMAT_BC1_RGBA_SRGB; break;
+        case 74 : return grfx::FORMAT_BC2_UNORM; break;
+        case 75 : return grfx::FORMAT_BC2_SRGB; break;
+        case 77 : return grfx::FORMAT_BC3_UNORM; break;
+        case 78 : return grfx::FORMAT_BC3_SRGB; break;
+        case 80 : return grfx::FORMAT_BC4_UNORM; break;
+        case 81 : return grfx::FORMAT_BC4_SNORM; break;
+        case 83 : return grfx::FORMAT_BC5_UNORM; break;
+        case 84 : return grfx::FORMAT_BC5_SNORM; break;
+        case 87 : return grfx::FORMAT_B8G8R8A8_UNORM; break;
+        case 91 : return grfx::FORMAT_B8G8R8A8_SRGB; break;
+        case 95 : return grfx::FORMAT_BC6H_UFLOAT; break;
+        case 96 : return grfx::FORMAT_BC6H_SFLOAT; break;
+        case 98 : return grfx::FORMAT_BC7_UNORM; break;
+        case 99 : return grfx::FORMAT_BC7_SRGB; break;
+    }
+    // clang-format on
+    return grfx::FORMAT_UNDEFINED;
+}
+
+static grfx::Format VkFormatToGrfx(uint32_t value)
+{
+    // clang-format off
+    switch (value) {
+        default: break;
+        case 9   : return grfx::FORMAT_R8_UNORM; break;
+        case 16  : return grfx::FORMAT_R8G8_UNORM; break;
+        case 37  : return grfx::FORMAT_R8G8B8A8_UNORM; break;
+        case 43  : return grfx::FORMAT_R8G8B8A8_SRGB; break;
+        case 44  : return grfx::FORMAT_B8G8R8A8_UNORM; break;
+        case 50  : return grfx::FORMAT_B8G8R8A8_SRGB; break;
+        case 97  : return grfx::FORMAT_R16G16B16A16_FLOAT; break;
+        case 109 : return grfx::FORMAT_R32G32B32A32_FLOAT; break;
+        case 131 : return grfx::FORMAT_BC1_RGB_UNORM; break;
+        case 132 : return grfx::FORMAT_BC1_RGB_SRGB; break;
+        case 133 : return grfx::FORMAT_BC1_RGBA_UNORM; break;
+        case 134 : return grfx::FORMAT_BC1_RGBA_SRGB; break;
+        case 135 : return grfx::FORMAT_BC2_UNORM; break;
+        case 136 : return grfx::FORMAT_BC2_SRGB; break;
+        case 137 : return grfx::FORMAT_BC3_UNORM; break;
+        case 138 : return grfx::FORMAT_BC3_SRGB; break;
+        case 139 : return grfx::FORMAT_BC4_UNORM; break;
+        case 140 : return grfx::FORMAT_BC4_SNORM; break;
+        case 141 : return grfx::FORMAT_BC5_UNORM; break;
+        case 142 : return grfx::FORMAT_BC5_SNORM; break;
+        case 143 : return grfx::FORMAT_BC6H_UFLOAT; break;
+        case 144 : return grfx::FORMAT_BC6H_SFLOAT; break;
+        case 145 : return grfx::FORMAT_BC7_UNORM; break;
+        case 146 : return grfx::FORMAT_BC7_SRGB; break;
+    }
+    // clang-format on
+    return grfx::FORMAT_UNDEFINED;
+}
+
+static grfx::Format FourCCToGrfx(uint32_t fourCC)
+{
+    // clang-format off
+    switch (fourCC) {
+        default: break;
+        case MakeFourCC('D', 'X', 'T', '1') : return grfx::FORMAT_BC1_RGBA_UNORM; break;
+        case MakeFourCC('D', 'X', 'T', '2') :
+        case MakeFourCC('D', 'X', 'T', '3') : return grfx::FORMAT_BC2_UNORM; break;
+        case MakeFourCC('D', 'X', 'T', '4') :
+        case MakeFourCC('D', 'X', 'T', '5') : return grfx::FORMAT_BC3_UNORM; break;
+        case MakeFourCC('A', 'T', 'I', '1') :
+        case MakeFourCC('B', 'C', '4', 'U') : return grfx::FORMAT_BC4_UNORM; break;
+        case MakeFourCC('B', 'C', '4', 'S') : return grfx::FORMAT_BC4_SNORM; break;
+        case MakeFourCC('A', 'T', 'I', '2') :
+        case MakeFourCC('B', 'C', '5', 'U') : return grfx::FORMAT_BC5_UNORM; break;
+        case MakeFourCC('B', 'C', '5', 'S') : return grfx::FORMAT_BC5_SNORM; break;
+        case 113                            : return grfx::FORMAT_R16G16B16A16_FLOAT; break;
+        case 116                            : return grfx::FORMAT_R32G32B32A32_FLOAT; break;
+    }
+    // clang-format on
+    return grfx::FORMAT_UNDEFINED;
+}
+
+// -------------------------------------------------------------------------------------------------
+// TextureContainer
+// -------------------------------------------------------------------------------------------------
+Result TextureContainer::Open(const std::filesystem::path& path)
+{
+    if (!ppx::fs::path_exists(path)) {
+        return ppx::ERROR_PATH_DOES_NOT_EXIST;
+    }
+
+    if (!mFile.OpenMapped(path)) {
+        return ppx::ERROR_IMAGE_FILE_LOAD_FAILED;
+    }
+
+    const char* pData = nullptr;
+    if (mFile.IsMapped()) {
+        pData = static_cast<const char*>(mFile.GetMappedData());
+    }
+    else {
+        mFileData.resize(mFile.GetLength());
+        if (mFile.Read(mFileData.data(), mFileData.size()) != mFileData.size()) {
+            return ppx::ERROR_IMAGE_FILE_LOAD_FAILED;
+        }
+        pData = mFileData.data();
+    }
+
+    Result ppxres = Parse(pData, mFile.GetLength());
+    if (Failed(ppxres)) {
+        PPX_LOG_ERROR("Unsupported or invalid texture container '" << path << "'");
+        return ppxres;
+    }
+
+    return ppx::SUCCESS;
+}
+
+Result TextureContainer::Parse(const char* pData, size_t size)
+{
+    PPX_ASSERT_NULL_ARG(pData);
+
+    mData   = pData;
+    mType   = TEXTURE_CONTAINER_TYPE_UNDEFINED;
+    mFormat = grfx::FORMAT_UNDEFINED;
+    mLevels.clear();
+
+    if ((size >= sizeof(kKTX2Identifier)) && (std::memcmp(pData, kKTX2Identifier, sizeof(kKTX2Identifier)) == 0)) {
+        return ParseKTX2(pData, size);
+    }
+    if ((size >= 4) && (ReadU32(pData, 0) == kDDSMagic)) {
+        return ParseDDS(pData, size);
+    }
+    return ppx::ERROR_IMAGE_INVALID_FORMAT;
+}
+
+Result TextureContainer::AddLevel(uint32_t level, uint64_t offset, uint64_t size, size_t fileSize)
+{
+    const grfx::FormatDesc* pDesc      = grfx::GetFormatDescription(mFormat);
+    const uint32_t          blockWidth = pDesc->blockWidth;
+
+    TextureContainerLevel desc = {};
+    desc.width                 = std::max<uint32_t>(mBaseWidth >> level, 1);
+    desc.height                = std::max<uint32_t>(mBaseHeight >> level, 1);
+    desc.rowStride             = ((desc.width + blockWidth - 1) / blockWidth) * pDesc->bytesPerTexel;
+    desc.rowCount              = (desc.height + blockWidth - 1) / blockWidth;
+    desc.offset                = offset;
+    desc.size                  = static_cast<uint64_t>(desc.rowStride) * desc.rowCount;
+
+    if ((size < desc.size) || (desc.offset + desc.size > fileSize)) {
+        PPX_LOG_ERROR("Texture container level " << level << " is truncated");
+        return ppx::ERROR_BAD_DATA_SOURCE;
+    }
+
+    mLevels.push_back(desc);
+    return ppx::SUCCESS;
+}
+
+Result TextureContainer::ParseDDS(const char* pData, size_t size)
+{
+    if (size < 4 + kDDSHeaderSize) {
+        return ppx::ERROR_BAD_DATA_SOURCE;
+    }
+
+    const char*    pHeader    = pData + 4;
+    const uint32_t flags      = ReadU32(pHeader, 4);
+    const uint32_t height     = ReadU32(pHeader, 8);
+    const uint32_t width      = ReadU32(pHeader, 12);
+    const uint32_t mipCount   = ReadU32(pHeader, 24);
+    const uint32_t pfFlags    = ReadU32(pHeader, 76);
+    const uint32_t fourCC     = ReadU32(pHeader, 80);
+    const uint32_t bitCount   = ReadU32(pHeader, 84);
+    const uint32_t redMask    = ReadU32(pHeader, 88);
+    const uint32_t blueMask   = ReadU32(pHeader, 96);
+    const uint32_t caps2      = ReadU32(pHeader, 108);
+    uint64_t       dataOffset = 4 + kDDSHeaderSize;
+
+    if ((ReadU32(pHeader, 0) != kDDSHeaderSize) || (caps2 & (kDDSCaps2CubeMap | kDDSCaps2Volume))) {
+        return ppx::ERROR_IMAGE_INVALID_FORMAT;
+    }
+
+    if ((pfFlags & kDDSPixelFormatFourCC) && (fourCC == MakeFourCC('D', 'X', '1', '0'))) {
+        if (size < dataOffset + kDDSHeaderDX10Size) {
+            return ppx::ERROR_BAD_DATA_SOURCE;
+        }
+        const char* pHeaderDX10 = pData + dataOffset;
+        if ((ReadU32(pHeaderDX10, 4) != kDDSResourceTexture2D) || (ReadU32(pHeaderDX10, 8) & kDDSMiscTextureCube) || (ReadU32(pHeaderDX10, 12) > 1)) {
+            return ppx::ERROR_IMAGE_INVALID_FORMAT;
+        }
+        mFormat = DXGIFormatToGrfx(ReadU32(pHeaderDX10, 0));
+        dataOffset += kDDSHeaderDX10Size;
+    }
+    else if (pfFlags & kDDSPixelFormatFourCC) {
+        mFormat = FourCCToGrfx(fourCC);
+    }
+    else if ((pfFlags & kDDSPixelFormatRGB) && (bitCount == 32)) {
+        mFormat = (redMask == 0xFF) ? grfx::FORMAT_R8G8B8A8_UNORM : ((blueMask == 0xFF) ? grfx::FORMAT_B8G8R8A8_UNORM : grfx::FORMAT_UNDEFINED);
+    }
+
+    if ((mFormat == grfx::FORMAT_UNDEFINED) || (width == 0) || (height == 0)) {
+        return ppx::ERROR_IMAGE_INVALID_FORMAT;
+    }
+
+    mType       = TEXTURE_CONTAINER_TYPE_DDS;
+    mBaseWidth  = width;
+    mBaseHeight = height;
+
+    // Levels are stored largest first, back to back
+    const uint32_t levelCount = ((flags & kDDSFlagMipMapCount) && (mipCount > 0)) ? mipCount : 1;
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        Result ppxres = AddLevel(level, dataOffset, size - std::min<uint64_t>(dataOffset, size), size);
+        if (Failed(ppxres)) {
+            mLevels.clear();
+            return ppxres;
+        }
+        dataOffset += mLevels.back().size;
+    }
+
+    return ppx::SUCCESS;
+}
+
+Result TextureContainer::ParseKTX2(const char* pData, size_t size)
+{
+    if (size < kKTX2HeaderSize) {
+        return ppx::ERROR_BAD_DATA_SOURCE;
+    }
+
+    const uint32_t vkFormat    = ReadU32(pData, 12);
+    const uint32_t width       = ReadU32(pData, 20);
+    const uint32_t height      = ReadU32(pData, 24);
+    const uint32_t depth       = ReadU32(pData, 28);
+    const uint32_t layerCount  = ReadU32(pData, 32);
+    const uint32_t faceCount   = ReadU32(pData, 36);
+    const uint32_t levelCount  = std::max<uint32_t>(ReadU32(pData, 40), 1);
+    const uint32_t compression = ReadU32(pData, 44);
+
+    if ((depth > 1) || (layerCount > 1) || (faceCount != 1) || (compression != 0)) {
+        return ppx::ERROR_IMAGE_INVALID_FORMAT;
+    }
+
+    mFormat = VkFormatToGrfx(vkFormat);
+    if ((mFormat == grfx::FORMAT_UNDEFINED) || (width == 0) || (height == 0)) {
+        return ppx::ERROR_IMAGE_INVALID_FORMAT;
+    }
+    if (size < kKTX2HeaderSize + levelCount * kKTX2LevelIndexSize) {
+        return ppx::ERROR_BAD_DATA_SOURCE;
+    }
+
+    mType       = TEXTURE_CONTAINER_TYPE_KTX2;
+    mBaseWidth  = width;
+    mBaseHeight = height;
+
+    // The level index is ordered largest first, the data itself is stored smallest first
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        const size_t indexOffset = kKTX2HeaderSize + level * kKTX2LevelIndexSize;
+        Result       ppxres      = AddLevel(level, ReadU64(pData, indexOffset), ReadU64(pData, indexOffset + 8), size);
+        if (Failed(ppxres)) {
+            mLevels.clear();
+            return ppxres;
+        }
+    }
+
+    return ppx::SUCCESS;
+}
+
+const TextureContainerLevel& TextureContainer::GetLevel(uint32_t level) const
+{
+    PPX_ASSERT_MSG(level < mLevels.size(), "level out of range");
+    return mLevels[level];
+}
+
+const char* TextureContainer::GetLevelData(uint32_t level) const
+{
+    if (level >= mLevels.size()) {
+        return nullptr;
+    }
+    return mData + mLevels[level].offset;
+}
+
+bool TextureContainer::IsContainerFile(const std::filesystem::path& path)
+{
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
+    return (extension == ".dds") || (extension == ".ktx2");
+}
+
+} // namespace ppx
@@ -0,0 +1,830 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ppx/virtual_texture.h"
+#include "ppx/bitmap.h"
+#include "ppx/util.h"
+#include "ppx/grfx/grfx_device.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace ppx {
+
+// clang-format off
+constexpr uint32_t kMaxVirtualTextureLevels    = 16;    // 4 bits in the tile key
+constexpr uint32_t kMaxVirtualTexturePages     = 16384; // 14 bits in the tile key
+constexpr uint32_t kMaxVirtualTextureSlots     = 256;   // 8 bits in the page table entry
+constexpr uint32_t kPageTableEntryResidentBit  = 1u << 24;
+// clang-format on
+
+static bool IsPowerOfTwo(uint32_t value)
+{
+    return (value != 0) && ((value & (value - 1)) == 0);
+}
+
+// -------------------------------------------------------------------------------------------------
+// MipmapTileSource
+// -------------------------------------------------------------------------------------------------
+Result MipmapTileSource::ReadTile(const VirtualTextureTile& tile, uint32_t tileSize, uint32_t border, uint8_t* pTexels)
+{
+    PPX_ASSERT_NULL_ARG(pTexels);
+
+    const Bitmap* pMip = mMipmap->GetMip(tile.level);
+    if (IsNull(pMip) || (pMip->GetFormat() != Bitmap::FORMAT_RGBA_UINT8)) {
+        return ppx::ERROR_IMAGE_INVALID_FORMAT;
+    }
+
+    const int32_t  maxX      = static_cast<int32_t>(pMip->GetWidth()) - 1;
+    const int32_t  maxY      = static_cast<int32_t>(pMip->GetHeight()) - 1;
+    const int32_t  originX   = static_cast<int32_t>(tile.x * tileSize) - static_cast<int32_t>(border);
+    const int32_t  originY   = static_cast<int32_t>(tile.y * tileSize) - static_cast<int32_t>(border);
+    const uint32_t texelSize = tileSize + 2 * border;
+
+    for (uint32_t row = 0; row < texelSize; ++row) {
+        const uint32_t y    = static_cast<uint32_t>(std::clamp(originY + static_cast<int32_t>(row), 0, maxY));
+        uint8_t*       pDst = pTexels + row * texelSize * 4;
+        for (uint32_t col = 0; col < texelSize; ++col) {
+            const uint32_t x = static_cast<uint32_t>(std::clamp(originX + static_cast<int32_t>(col), 0, maxX));
+            std::memcpy(pDst + col * 4, pMip->GetPixelAddress(x, y), 4);
+        }
+    }
+
+    return ppx::SUCCESS;
+}
+
+// -------------------------------------------------------------------------------------------------
+// VirtualTextureTileCache
+// -------------------------------------------------------------------------------------------------
+void VirtualTextureTileCache::SetCapacity(uint32_t tileCount)
+{
+    mCapacity = tileCount;
+    while (mEntries.size() > mCapacity) {
+        mLookup.erase(mEntries.back().key);
+        mEntries.pop_back();
+    }
+}
+
+const std::vector<uint8_t>* VirtualTextureTileCache::Find(uint32_t key)
+{
+    auto it = mLookup.find(key);
+    if (it == mLookup.end()) {
+        ++mMissCount;
+        return nullptr;
+    }
+
+    ++mHitCount;
+    mEntries.splice(mEntries.begin(), mEntries, it->second);
+    return &it->second->texels;
+}
+
+void VirtualTextureTileCache::Insert(uint32_t key, std::vector<uint8_t>&& texels)
+{
+    auto it = mLookup.find(key);
+    if (it != mLookup.end()) {
+        it->second->texels = std::move(texels);
+        mEntries.splice(mEntries.begin(), mEntries, it->second);
+        return;
+    }
+
+    if (mCapacity == 0) {
+        return;
+    }
+    while (mEntries.size() >= mCapacity) {
+        mLookup.erase(mEntries.back().key);
+        mEntries.pop_back();
+    }
+
+    mEntries.push_front(Entry{key, std::move(texels)});
+    mLookup[key] = mEntries.begin();
+}
+
+void VirtualTextureTileCache::ResetCounters()
+{
+    mHitCount  = 0;
+    mMissCount = 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+// VirtualTexturePageTable
+// -------------------------------------------------------------------------------------------------
+Result VirtualTexturePageTable::Initialize(uint32_t pageCountX, uint32_t pageCountY, uint32_t slotCountX, uint32_t slotCountY)
+{
+    if (!IsPowerOfTwo(pageCountX) || !IsPowerOfTwo(pageCountY) || (pageCountX > kMaxVirtualTexturePages) || (pageCountY > kMaxVirtualTexturePages)) {
+        PPX_LOG_ERROR("Virtual texture page counts must be powers of two no larger than " << kMaxVirtualTexturePages);
+        return ppx::ERROR_INVALID_CREATE_ARGUMENT;
+    }
+    if ((slotCountX == 0) || (slotCountY == 0) || (slotCountX > kMaxVirtualTextureSlots) || (slotCountY > kMaxVirtualTextureSlots)) {
+        PPX_LOG_ERROR("Virtual texture atlas must hold between 1 and " << kMaxVirtualTextureSlots << " tiles per axis");
+        return ppx::ERROR_INVALID_CREATE_ARGUMENT;
+    }
+
+    mPageCountX = pageCountX;
+    mPageCountY = pageCountY;
+    mLevelCount = 1;
+    while ((GetPageCountX(mLevelCount - 1) > 1) || (GetPageCountY(mLevelCount - 1) > 1)) {
+        ++mLevelCount;
+    }
+    PPX_ASSERT_MSG(mLevelCount <= kMaxVirtualTextureLevels, "too many virtual texture levels");
+
+    mLevelOffsets.resize(mLevelCount);
+    uint32_t offset = 0;
+    for (uint32_t level = 0; level < mLevelCount; ++level) {
+        mLevelOffsets[level] = offset;
+        offset += GetPageCountX(level) * GetPageCountY(level);
+    }
+
+    mSlotCountX = slotCountX;
+    mSlots.assign(slotCountX * slotCountY, Slot{});
+    mLookup.clear();
+    mDirty = true;
+
+    return ppx::SUCCESS;
+}
+
+bool VirtualTexturePageTable::IsValid(const VirtualTextureTile& tile) const
+{
+    return (tile.level < mLevelCount) && (tile.x < GetPageCountX(tile.level)) && (tile.y < GetPageCountY(tile.level));
+}
+
+bool VirtualTexturePageTable::Touch(const VirtualTextureTile& tile, uint64_t frame)
+{
+    auto it = mLookup.find(tile.GetKey());
+    if (it == mLookup.end()) {
+        return false;
+    }
+
+    Slot& slot         = mSlots[it->second];
+    slot.lastUsedFrame = std::max(slot.lastUsedFrame, frame);
+    return true;
+}
+
+bool VirtualTexturePageTable::Allocate(const VirtualTextureTile& tile, uint64_t frame, bool pinned, uint32_t* pSlotX, uint32_t* pSlotY)
+{
+    PPX_ASSERT_NULL_ARG(pSlotX);
+    PPX_ASSERT_NULL_ARG(pSlotY);
+
+    const uint32_t key   = tile.GetKey();
+    uint32_t       index = UINT32_MAX;
+
+    auto it = mLookup.find(key);
+    if (it != mLookup.end()) {
+        index = it->second;
+    }
+    else {
+        // Prefer a free slot, otherwise the least recently used one that is
+        // not needed by the current frame.
+        uint64_t oldestFrame = UINT64_MAX;
+        for (uint32_t i = 0; i < CountU32(mSlots); ++i) {
+            const Slot& slot = mSlots[i];
+            if (slot.key == UINT32_MAX) {
+                index = i;
+                break;
+            }
+            if (!slot.pinned && (slot.lastUsedFrame < frame) && (slot.lastUsedFrame < oldestFrame)) {
+                oldestFrame = slot.lastUsedFrame;
+                index       = i;
+            }
+        }
+        if (index == UINT32_MAX) {
+            return false;
+        }
+
+        if (mSlots[index].key != UINT32_MAX) {
+            mLookup.erase(mSlots[index].key);
+        }
+        mSlots[index].key = key;
+        mLookup[key]      = index;
+        mDirty            = true;
+    }
+
+    Slot& slot         = mSlots[index];
+    slot.lastUsedFrame = std::max(slot.lastUsedFrame, frame);
+    slot.pinned        = slot.pinned || pinned;
+
+    *pSlotX = index % mSlotCountX;
+    *pSlotY = index / mSlotCountX;
+    return true;
+}
+
+void VirtualTexturePageTable::BuildEntries(std::vector<uint32_t>& entries) const
+{
+    const uint32_t lastLevel = mLevelCount - 1;
+    entries.resize(mLevelOffsets[lastLevel] + GetPageCountX(lastLevel) * GetPageCountY(lastLevel));
+
+    // Coarsest level first so that missing pages can copy their parent's entry
+    for (uint32_t i = 0; i < mLevelCount; ++i) {
+        const uint32_t level       = lastLevel - i;
+        const uint32_t pageCountX  = GetPageCountX(level);
+        const uint32_t pageCountY  = GetPageCountY(level);
+        uint32_t*      pEntries    = entries.data() + mLevelOffsets[level];
+        const uint32_t parentCount = (level < lastLevel) ? GetPageCountX(level + 1) : 0;
+
+        for (uint32_t y = 0; y < pageCountY; ++y) {
+            for (uint32_t x = 0; x < pageCountX; ++x) {
+                uint32_t entry = 0;
+
+                auto it = mLookup.find(VirtualTextureTile{level, x, y}.GetKey());
+                if (it != mLookup.end()) {
+                    const uint32_t slotX = it->second % mSlotCountX;
+                    const uint32_t slotY = it->second / mSlotCountX;
+                    entry                = slotX | (slotY << 8) | (level << 16) | kPageTableEntryResidentBit;
+                }
+                else if (level < lastLevel) {
+                    entry = entries[mLevelOffsets[level + 1] + (y >> 1) * parentCount + (x >> 1)];
+                }
+
+                pEntries[y * pageCountX + x] = entry;
+            }
+        }
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// VirtualTexture
+// -------------------------------------------------------------------------------------------------
+Result VirtualTexture::Initialize(grfx::Device* pDevice, const VirtualTextureCreateInfo& createInfo)
+{
+    PPX_ASSERT_NULL_ARG(pDevice);
+    PPX_ASSERT_NULL_ARG(createInfo.pSource);
+    if (!IsNull(mDevice)) {
+        return ppx::ERROR_SINGLE_INIT_ONLY;
+    }
+
+    const grfx::FormatDesc* pFormatDesc = grfx::GetFormatDescription(createInfo.format);
+    if ((pFormatDesc->bytesPerTexel != 4) || (pFormatDesc->blockWidth != 1) || (createInfo.tileSize == 0)) {
+        PPX_LOG_ERROR("Virtual textures require a 4 byte per texel uncompressed format");
+        return ppx::ERROR_INVALID_CREATE_ARGUMENT;
+    }
+    if (((createInfo.width % createInfo.tileSize) != 0) || ((createInfo.height % createInfo.tileSize) != 0)) {
+        PPX_LOG_ERROR("Virtual texture size must be a multiple of the tile size");
+        return ppx::ERROR_INVALID_CREATE_ARGUMENT;
+    }
+    if ((createInfo.frameCount == 0) || (createInfo.maxUploadsPerFrame == 0) || (createInfo.renderWidth == 0) || (createInfo.renderHeight == 0) || (createInfo.feedbackDivisor == 0)) {
+        return ppx::ERROR_INVALID_CREATE_ARGUMENT;
+    }
+
+    Result ppxres = mPageTable.Initialize(
+        createInfo.width / createInfo.tileSize,
+        createInfo.height / createInfo.tileSize,
+        createInfo.atlasTileCountX,
+        createInfo.atlasTileCountY);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    mDevice      = pDevice;
+    mCreateInfo  = createInfo;
+    mFrameNumber = 0;
+    mCache.SetCapacity(createInfo.cacheTileCount);
+
+    // Row stride and texture offset alignment to handle DX's requirements
+    mRowStrideAlignment = grfx::IsDx12(mDevice->GetApi()) ? PPX_D3D12_TEXTURE_DATA_PITCH_ALIGNMENT : 1;
+    mOffsetAlignment    = grfx::IsDx12(mDevice->GetApi()) ? PPX_D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT : 1;
+
+    const uint32_t physicalTileSize = GetPhysicalTileSize();
+
+    // Physical tile atlas
+    {
+        grfx::ImageCreateInfo ci       = {};
+        ci.type                        = grfx::IMAGE_TYPE_2D;
+        ci.width                       = createInfo.atlasTileCountX * physicalTileSize;
+        ci.height                      = createInfo.atlasTileCountY * physicalTileSize;
+        ci.depth                       = 1;
+        ci.format                      = createInfo.format;
+        ci.mipLevelCount               = 1;
+        ci.arrayLayerCount             = 1;
+        ci.usageFlags.bits.transferDst = true;
+        ci.usageFlags.bits.sampled     = true;
+        ci.memoryUsage                 = grfx::MEMORY_USAGE_GPU_ONLY;
+        ci.initialState                = grfx::RESOURCE_STATE_SHADER_RESOURCE;
+
+        ppxres = mDevice->CreateImage(&ci, &mAtlas);
+        if (Failed(ppxres)) {
+            Shutdown();
+            return ppxres;
+        }
+
+        grfx::SampledImageViewCreateInfo viewCreateInfo = grfx::SampledImageViewCreateInfo::GuessFromImage(mAtlas);
+        ppxres                                          = mDevice->CreateSampledImageView(&viewCreateInfo, &mAtlasView);
+        if (Failed(ppxres)) {
+            Shutdown();
+            return ppxres;
+        }
+    }
+
+    // Page table, one mip level per virtual level
+    {
+        grfx::ImageCreateInfo ci       = {};
+        ci.type                        = grfx::IMAGE_TYPE_2D;
+        ci.width                       = mPageTable.GetPageCountX(0);
+        ci.height                      = mPageTable.GetPageCountY(0);
+        ci.depth                       = 1;
+        ci.format                      = grfx::FORMAT_R8G8B8A8_UINT;
+        ci.mipLevelCount               = mPageTable.GetLevelCount();
+        ci.arrayLayerCount             = 1;
+        ci.usageFlags.bits.transferDst = true;
+        ci.usageFlags.bits.sampled     = true;
+        ci.memoryUsage                 = grfx::MEMORY_USAGE_GPU_ONLY;
+        ci.initialState                = grfx::RESOURCE_STATE_SHADER_RESOURCE;
+
+        ppxres = mDevice->CreateImage(&ci, &mPageTableImage);
+        if (Failed(ppxres)) {
+            Shutdown();
+            return ppxres;
+        }
+
+        grfx::SampledImageViewCreateInfo viewCreateInfo = grfx::SampledImageViewCreateInfo::GuessFromImage(mPageTableImage);
+        ppxres                                          = mDevice->CreateSampledImageView(&viewCreateInfo, &mPageTableView);
+        if (Failed(ppxres)) {
+            Shutdown();
+            return ppxres;
+        }
+    }
+
+    // Feedback target, cleared to 0 which means no request
+    const uint32_t feedbackWidth  = std::max<uint32_t>(createInfo.renderWidth / createInfo.feedbackDivisor, 1);
+    const uint32_t feedbackHeight = std::max<uint32_t>(createInfo.renderHeight / createInfo.feedbackDivisor, 1);
+    {
+        grfx::DrawPassCreateInfo ci                   = {};
+        ci.width                                      = feedbackWidth;
+        ci.height                                     = feedbackHeight;
+        ci.renderTargetCount                          = 1;
+        ci.renderTargetFormats[0]                     = grfx::FORMAT_R32_UINT;
+        ci.depthStencilFormat                         = grfx::FORMAT_D32_FLOAT;
+        ci.renderTargetUsageFlags[0].bits.transferSrc = true;
+        ci.renderTargetInitialStates[0]               = grfx::RESOURCE_STATE_RENDER_TARGET;
+        ci.depthStencilInitialState                   = grfx::RESOURCE_STATE_DEPTH_STENCIL_WRITE;
+        ci.renderTargetClearValues[0]                 = {0, 0, 0, 0};
+        ci.depthStencilClearValue                     = {1.0f, 0xFF};
+
+        ppxres = mDevice->CreateDrawPass(&ci, &mFeedbackDrawPass);
+        if (Failed(ppxres)) {
+            Shutdown();
+            return ppxres;
+        }
+    }
+
+    // Staging holds maxUploadsPerFrame tiles followed by the whole page table
+    mTileStagingSize        = RoundUp<uint64_t>(static_cast<uint64_t>(RoundUp<uint32_t>(physicalTileSize * 4, mRowStrideAlignment)) * physicalTileSize, mOffsetAlignment);
+    mPageTableStagingOffset = mTileStagingSize * createInfo.maxUploadsPerFrame;
+
+    uint64_t stagingSize = mPageTableStagingOffset;
+    for (uint32_t level = 0; level < mPageTable.GetLevelCount(); ++level) {
+        const uint64_t rowStride = RoundUp<uint32_t>(mPageTable.GetPageCountX(level) * 4, mRowStrideAlignment);
+        stagingSize += RoundUp<uint64_t>(rowStride * mPageTable.GetPageCountY(level), mOffsetAlignment);
+    }
+
+    mPerFrame.resize(createInfo.frameCount);
+    for (auto& frame : mPerFrame) {
+        grfx::BufferCreateInfo ci      = {};
+        ci.size                        = stagingSize;
+        ci.usageFlags.bits.transferSrc = true;
+        ci.memoryUsage                 = grfx::MEMORY_USAGE_CPU_TO_GPU;
+
+        ppxres = mDevice->CreateBuffer(&ci, &frame.stagingBuffer);
+        if (Failed(ppxres)) {
+            Shutdown();
+            return ppxres;
+        }
+
+        // Sized for the largest row pitch either API may use
+        ci                             = {};
+        ci.size                        = static_cast<uint64_t>(RoundUp<uint32_t>(feedbackWidth * 4, PPX_D3D12_TEXTURE_DATA_PITCH_ALIGNMENT)) * feedbackHeight;
+        ci.usageFlags.bits.transferDst = true;
+        ci.memoryUsage                 = grfx::MEMORY_USAGE_GPU_TO_CPU;
+        ci.initialState                = grfx::RESOURCE_STATE_COPY_DST;
+
+        ppxres = mDevice->CreateBuffer(&ci, &frame.feedbackBuffer);
+        if (Failed(ppxres)) {
+            Shutdown();
+            return ppxres;
+        }
+    }
+
+    // The coarsest tile covers the whole texture and is what every page
+    // falls back to, load it now and keep it resident.
+    {
+        const VirtualTextureTile root = {mPageTable.GetLevelCount() - 1, 0, 0};
+        std::vector<uint8_t>     texels(physicalTileSize * physicalTileSize * 4);
+
+        ppxres = mCreateInfo.pSource->ReadTile(root, mCreateInfo.tileSize, mCreateInfo.tileBorder, texels.data());
+        if (Failed(ppxres)) {
+            Shutdown();
+            return ppxres;
+        }
+
+        uint32_t slotX = 0;
+        uint32_t slotY = 0;
+        mPageTable.Allocate(root, mFrameNumber, true, &slotX, &slotY);
+
+        void* pStagingData = nullptr;
+        ppxres             = mPerFrame[0].stagingBuffer->MapMemory(0, &pStagingData);
+        if (Failed(ppxres)) {
+            Shutdown();
+            return ppxres;
+        }
+        StageTile(mPerFrame[0], static_cast<char*>(pStagingData), slotX, slotY, texels);
+        StagePageTable(mPerFrame[0], static_cast<char*>(pStagingData));
+        mPerFrame[0].stagingBuffer->UnmapMemory();
+    }
+
+    mStopLoader   = false;
+    mLoaderThread = std::thread(&VirtualTexture::LoaderThreadFunc, this);
+
+    return ppx::SUCCESS;
+}
+
+void VirtualTexture::Shutdown()
+{
+    if (mLoaderThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mLoaderMutex);
+            mStopLoader = true;
+        }
+        mLoaderCondition.notify_all();
+        mLoaderThread.join();
+    }
+    mLoadQueue.clear();
+    mQueuedKeys.clear();
+    mCompletedLoads.clear();
+
+    if (IsNull(mDevice)) {
+        return;
+    }
+
+    for (auto& frame : mPerFrame) {
+        if (frame.stagingBuffer) {
+            mDevice->DestroyBuffer(frame.stagingBuffer);
+        }
+        if (frame.feedbackBuffer) {
+            mDevice->DestroyBuffer(frame.feedbackBuffer);
+        }
+    }
+    mPerFrame.clear();
+
+    if (mFeedbackDrawPass) {
+        mDevice->DestroyDrawPass(mFeedbackDrawPass);
+        mFeedbackDrawPass.Reset();
+    }
+    if (mPageTableView) {
+        mDevice->DestroySampledImageView(mPageTableView);
+        mPageTableView.Reset();
+    }
+    if (mPageTableImage) {
+        mDevice->DestroyImage(mPageTableImage);
+        mPageTableImage.Reset();
+    }
+    if (mAtlasView) {
+        mDevice->DestroySampledImageView(mAtlasView);
+        mAtlasView.Reset();
+    }
+    if (mAtlas) {
+        mDevice->DestroyImage(mAtlas);
+        mAtlas.Reset();
+    }
+
+    mDevice = nullptr;
+}
+
+Result VirtualTexture::Update(uint32_t frameIndex)
+{
+    PPX_ASSERT_MSG(!IsNull(mDevice), "VirtualTexture is not initialized");
+    PPX_ASSERT_MSG(frameIndex < mPerFrame.size(), "frameIndex out of range");
+
+    PerFrame& frame = mPerFrame[frameIndex];
+    ++mFrameNumber;
+    mStats = {};
+
+    // Move tiles the loader finished into the cache
+    {
+        std::lock_guard<std::mutex> lock(mLoaderMutex);
+        for (auto& elem : mCompletedLoads) {
+            mQueuedKeys.erase(elem.first);
+            mCache.Insert(elem.first, std::move(elem.second));
+        }
+        mCompletedLoads.clear();
+    }
+
+    std::vector<uint32_t> requests;
+    if (frame.feedbackPending) {
+        ReadFeedback(frame, requests);
+        frame.feedbackPending = false;
+    }
+
+    // Requested tiles and all of their ancestors are needed this frame: the
+    // ancestors are what missing tiles fall back to.
+    std::unordered_set<uint32_t> needed;
+    for (uint32_t key : requests) {
+        VirtualTextureTile tile = VirtualTextureTile::FromKey(key);
+        if (!mPageTable.IsValid(tile)) {
+            continue;
+        }
+
+        mStats.requestedTiles += 1;
+        if (mPageTable.Touch(tile, mFrameNumber)) {
+            mStats.residentHits += 1;
+        }
+        needed.insert(key);
+
+        while (tile.level + 1 < mPageTable.GetLevelCount()) {
+            tile = tile.GetParent();
+            if (!needed.insert(tile.GetKey()).second) {
+                break;
+            }
+            mPageTable.Touch(tile, mFrameNumber);
+        }
+    }
+
+    // Upload coarse tiles first, they fix the largest areas of the screen
+    std::vector<uint32_t> missing;
+    for (uint32_t key : needed) {
+        if (!mPageTable.IsResident(VirtualTextureTile::FromKey(key))) {
+            missing.push_back(key);
+        }
+    }
+    std::sort(missing.begin(), missing.end(), [](uint32_t a, uint32_t b) {
+        return ((a >> 28) != (b >> 28)) ? ((a >> 28) > (b >> 28)) : (a < b);
+    });
+
+    void*  pStagingData = nullptr;
+    Result ppxres       = frame.stagingBuffer->MapMemory(0, &pStagingData);
+    if (Failed(ppxres)) {
+        return ppxres;
+    }
+
+    std::vector<uint32_t> loads;
+    for (uint32_t key : missing) {
+        const std::vector<uint8_t>* pTexels = mCache.Find(key);
+        if (IsNull(pTexels)) {
+            mStats.cacheMisses += 1;
+            loads.push_back(key);
+            continue;
+        }
+        mStats.cacheHits += 1;
+
+        // Tiles over the budget stay in the cache until a later frame
+        if (frame.atlasCopies.size() >= mCreateInfo.maxUploadsPerFrame) {
+            continue;
+        }
+
+        uint32_t slotX = 0;
+        uint32_t slotY = 0;
+        if (!mPageTable.Allocate(VirtualTextureTile::FromKey(key), mFrameNumber, false, &slotX, &slotY)) {
+            // Every slot is in use by this frame, the atlas is too small for
+            // the current view.
+            break;
+        }
+        StageTile(frame, static_cast<char*>(pStagingData), slotX, slotY, *pTexels);
+    }
+
+    if (mPageTable.IsDirty()) {
+        StagePageTable(frame, static_cast<char*>(pStagingData));
+    }
+
+    frame.stagingBuffer->UnmapMemory();
+
+    QueueLoads(loads);
+
+    mStats.residentTiles = mPageTable.GetResidentCount();
+    {
+        std::lock_guard<std::mutex> lock(mLoaderMutex);
+        mStats.pendingLoads = static_cast<uint32_t>(mQueuedKeys.size());
+    }
+
+    return ppx::SUCCESS;
+}
+
+void VirtualTexture::ReadFeedback(PerFrame& frame, std::vector<uint32_t>& requests)
+{
+    grfx::Image*   pImage = mFeedbackDrawPass->GetRenderTargetTexture(0)->GetImage();
+    const uint32_t width  = pImage->GetWidth();
+    const uint32_t height = pImage->GetHeight();
+
+    void* pData = nullptr;
+    if (Failed(frame.feedbackBuffer->MapMemory(0, &pData))) {
+        return;
+    }
+
+    // Neighboring texels mostly request the same tile, skip runs before
+    // hitting the set.
+    std::unordered_set<uint32_t> unique;
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint32_t* pRow     = reinterpret_cast<const uint32_t*>(static_cast<const char*>(pData) + y * frame.feedbackRowPitch);
+        uint32_t        previous = 0;
+        for (uint32_t x = 0; x < width; ++x) {
+            const uint32_t value = pRow[x];
+            if ((value == 0) || (value == previous)) {
+                continue;
+            }
+            previous = value;
+            unique.insert(value - 1);
+        }
+    }
+
+    frame.feedbackBuffer->UnmapMemory();
+
+    requests.assign(unique.begin(), unique.end());
+}
+
+void VirtualTexture::StageTile(PerFrame& frame, char* pStagingData, uint32_t slotX, uint32_t slotY, const std::vector<uint8_t>& texels)
+{
+    const uint32_t physicalTileSize = GetPhysicalTileSize();
+    const uint32_t srcRowStride     = physicalTileSize * 4;
+    const uint32_t dstRowStride     = RoundUp<uint32_t>(srcRowStride, mRowStrideAlignment);
+    const uint64_t offset           = mTileStagingSize * frame.atlasCopies.size();
+
+    for (uint32_t row = 0; row < physicalTileSize; ++row) {
+        std::memcpy(pStagingData + offset + row * dstRowStride, texels.data() + row * srcRowStride, srcRowStride);
+    }
+
+    grfx::BufferToImageCopyInfo copyInfo = {};
+    copyInfo.srcBuffer.imageWidth        = physicalTileSize;
+    copyInfo.srcBuffer.imageHeight       = physicalTileSize;
+    copyInfo.srcBuffer.imageRowStride    = dstRowStride;
+    copyInfo.srcBuffer.footprintOffset   = offset;
+    copyInfo.srcBuffer.footprintWidth    = physicalTileSize;
+    copyInfo.srcBuffer.footprintHeight   = physicalTileSize;
+    copyInfo.srcBuffer.footprintDepth    = 1;
+    copyInfo.dstImage.mipLevel           = 0;
+    copyInfo.dstImage.arrayLayer         = 0;
+    copyInfo.dstImage.arrayLayerCount    = 1;
+    copyInfo.dstImage.x                  = slotX * physicalTileSize;
+    copyInfo.dstImage.y                  = slotY * physicalTileSize;
+    copyInfo.dstImage.z                  = 0;
+    copyInfo.dstImage.width              = physicalTileSize;
+    copyInfo.dstImage.height             = physicalTileSize;
+    copyInfo.dstImage.depth              = 1;
+    frame.atlasCopies.push_back(copyInfo);
+
+    mStats.uploadedTiles += 1;
+    mStats.uploadedBytes += srcRowStride * physicalTileSize;
+}
+
+void VirtualTexture::StagePageTable(PerFrame& frame, char* pStagingData)
+{
+    mPageTable.BuildEntries(mPageTableEntries);
+    mPageTable.ClearDirty();
+
+    frame.pageTableCopies.clear();
+
+    uint64_t offset = mPageTableStagingOffset;
+    for (uint32_t level = 0; level < mPageTable.GetLevelCount(); ++level) {
+        const uint32_t  pageCountX   = mPageTable.GetPageCountX(level);
+        const uint32_t  pageCountY   = mPageTable.GetPageCountY(level);
+        const uint32_t  srcRowStride = pageCountX * 4;
+        const uint32_t  dstRowStride = RoundUp<uint32_t>(srcRowStride, mRowStrideAlignment);
+        const uint32_t* pSrc         = mPageTableEntries.data() + mPageTable.GetLevelOffset(level);
+
+        for (uint32_t row = 0; row < pageCountY; ++row) {
+            std::memcpy(pStagingData + offset + row * dstRowStride, pSrc + row * pageCountX, srcRowStride);
+        }
+
+        grfx::BufferToImageCopyInfo copyInfo = {};
+        copyInfo.srcBuffer.imageWidth        = pageCountX;
+        copyInfo.srcBuffer.imageHeight       = pageCountY;
+        copyInfo.srcBuffer.imageRowStride    = dstRowStride;
+        copyInfo.srcBuffer.footprintOffset   = offset;
+        copyInfo.srcBuffer.footprintWidth    = pageCountX;
+        copyInfo.srcBuffer.footprintHeight   = pageCountY;
+        copyInfo.srcBuffer.footprintDepth    = 1;
+        copyInfo.dstImage.mipLevel           = level;
+        copyInfo.dstImage.arrayLayer         = 0;
+        copyInfo.dstImage.arrayLayerCount    = 1;
+        copyInfo.dstImage.x                  = 0;
+        copyInfo.dstImage.y                  = 0;
+        copyInfo.dstImage.z                  = 0;
+        copyInfo.dstImage.width              = pageCountX;
+        copyInfo.dstImage.height             = pageCountY;
+        copyInfo.dstImage.depth              = 1;
+        frame.pageTableCopies.push_back(copyInfo);
+
+        offset += RoundUp<uint64_t>(static_cast<uint64_t>(dstRowStride) * pageCountY, mOffsetAlignment);
+        mStats.uploadedBytes += srcRowStride * pageCountY;
+    }
+}
+
+void VirtualTexture::RecordUploads(grfx::CommandBuffer* pCommandBuffer, uint32_t frameIndex)
+{
+    PPX_ASSERT_NULL_ARG(pCommandBuffer);
+    PPX_ASSERT_MSG(frameIndex < mPerFrame.size(), "frameIndex out of range");
+
+    PerFrame& frame = mPerFrame[frameIndex];
+
+    if (!frame.atlasCopies.empty()) {
+        pCommandBuffer->TransitionImageLayout(mAtlas, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_COPY_DST);
+        pCommandBuffer->CopyBufferToImage(frame.atlasCopies, frame.stagingBuffer, mAtlas);
+        pCommandBuffer->TransitionImageLayout(mAtlas, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_COPY_DST, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+        frame.atlasCopies.clear();
+    }
+
+    if (!frame.pageTableCopies.empty()) {
+        pCommandBuffer->TransitionImageLayout(mPageTableImage, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_COPY_DST);
+        pCommandBuffer->CopyBufferToImage(frame.pageTableCopies, frame.stagingBuffer, mPageTableImage);
+        pCommandBuffer->TransitionImageLayout(mPageTableImage, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_COPY_DST, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+        frame.pageTableCopies.clear();
+    }
+}
+
+void VirtualTexture::RecordFeedbackReadback(grfx::CommandBuffer* pCommandBuffer, uint32_t frameIndex)
+{
+    PPX_ASSERT_NULL_ARG(pCommandBuffer);
+    PPX_ASSERT_MSG(frameIndex < mPerFrame.size(), "frameIndex out of range");
+
+    PerFrame&    frame  = mPerFrame[frameIndex];
+    grfx::Image* pImage = mFeedbackDrawPass->GetRenderTargetTexture(0)->GetImage();
+
+    pCommandBuffer->TransitionImageLayout(pImage, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_RENDER_TARGET, grfx::RESOURCE_STATE_COPY_SRC);
+
+    grfx::ImageToBufferCopyInfo copyInfo = {};
+    copyInfo.extent                      = {pImage->GetWidth(), pImage->GetHeight(), 0};
+    grfx::ImageToBufferOutputPitch pitch = pCommandBuffer->CopyImageToBuffer(&copyInfo, pImage, frame.feedbackBuffer);
+
+    pCommandBuffer->TransitionImageLayout(pImage, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_COPY_SRC, grfx::RESOURCE_STATE_RENDER_TARGET);
+
+    frame.feedbackRowPitch = pitch.rowPitch;
+    frame.feedbackPending  = true;
+}
+
+VirtualTextureShaderParams VirtualTexture::GetShaderParams() const
+{
+    const uint32_t physicalTileSize = GetPhysicalTileSize();
+
+    VirtualTextureShaderParams params = {};
+    params.virtualSize[0]             = static_cast<float>(mCreateInfo.width);
+    params.virtualSize[1]             = static_cast<float>(mCreateInfo.height);
+    params.pageCount[0]               = static_cast<float>(mPageTable.GetPageCountX(0));
+    params.pageCount[1]               = static_cast<float>(mPageTable.GetPageCountY(0));
+    params.atlasSize[0]               = static_cast<float>(mCreateInfo.atlasTileCountX * physicalTileSize);
+    params.atlasSize[1]               = static_cast<float>(mCreateInfo.atlasTileCountY * physicalTileSize);
+    params.tileSize                   = static_cast<float>(mCreateInfo.tileSize);
+    params.tileBorder                 = static_cast<float>(mCreateInfo.tileBorder);
+    params.maxLevel                   = mPageTable.GetLevelCount() - 1;
+    // The feedback target is smaller than the render target, which makes
+    // its derivatives larger by the same factor.
+    params.feedbackLodBias = -std::log2(static_cast<float>(mCreateInfo.feedbackDivisor));
+    return params;
+}
+
+void VirtualTexture::QueueLoads(const std::vector<uint32_t>& keys)
+{
+    if (keys.empty()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mLoaderMutex);
+        for (uint32_t key : keys) {
+            if (mQueuedKeys.size() >= mCreateInfo.maxPendingLoads) {
+                break;
+            }
+            if (mQueuedKeys.insert(key).second) {
+                mLoadQueue.push_back(key);
+            }
+        }
+    }
+    mLoaderCondition.notify_one();
+}
+
+void VirtualTexture::LoaderThreadFunc()
+{
+    const uint32_t physicalTileSize = GetPhysicalTileSize();
+
+    for (;;) {
+        uint32_t key = 0;
+        {
+            std::unique_lock<std::mutex> lock(mLoaderMutex);
+            mLoaderCondition.wait(lock, [this] { return mStopLoader || !mLoadQueue.empty(); });
+            if (mStopLoader) {
+                return;
+            }
+            key = mLoadQueue.front();
+            mLoadQueue.pop_front();
+        }
+
+        std::vector<uint8_t> texels(physicalTileSize * physicalTileSize * 4);
+
+        Result ppxres = mCreateInfo.pSource->ReadTile(VirtualTextureTile::FromKey(key), mCreateInfo.tileSize, mCreateInfo.tileBorder, texels.data());
+        if (Failed(ppxres)) {
+            // Keep the cleared tile so the request is not retried every frame
+            PPX_LOG_ERROR("Failed to read virtual texture tile " << key << ": " << ToString(ppxres));
+        }
+
+        std::lock_guard<std::mutex> lock(mLoaderMutex);
+        mCompletedLoads.emplace_back(key, std::move(texels));
+    }
+}
+
+} // namespace ppx
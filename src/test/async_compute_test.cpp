@@ -0,0 +1,62 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include "ppx/async_compute.h"
+
+namespace ppx {
+
+TEST(AsyncComputeTest, ComputeStatsNoOverlap)
+{
+    AsyncComputeStats stats = AsyncComputeScheduler::ComputeStats({{0.0, 2.0}, {2.0, 3.0}}, {{3.0, 5.0}});
+    EXPECT_DOUBLE_EQ(stats.graphicsBusyMs, 3.0);
+    EXPECT_DOUBLE_EQ(stats.computeBusyMs, 2.0);
+    EXPECT_DOUBLE_EQ(stats.overlapMs, 0.0);
+    EXPECT_DOUBLE_EQ(stats.frameMs, 5.0);
+    EXPECT_DOUBLE_EQ(stats.overlapRatio, 0.0);
+}
+
+TEST(AsyncComputeTest, ComputeStatsFullOverlap)
+{
+    AsyncComputeStats stats = AsyncComputeScheduler::ComputeStats({{1.0, 6.0}}, {{2.0, 4.0}});
+    EXPECT_DOUBLE_EQ(stats.graphicsBusyMs, 5.0);
+    EXPECT_DOUBLE_EQ(stats.computeBusyMs, 2.0);
+    EXPECT_DOUBLE_EQ(stats.overlapMs, 2.0);
+    EXPECT_DOUBLE_EQ(stats.frameMs, 5.0);
+    EXPECT_DOUBLE_EQ(stats.overlapRatio, 1.0);
+}
+
+TEST(AsyncComputeTest, ComputeStatsPartialOverlapMergesSpans)
+{
+    // Graphics spans [0, 4] and [3, 6] merge into [0, 6]
+    AsyncComputeStats stats = AsyncComputeScheduler::ComputeStats({{3.0, 6.0}, {0.0, 4.0}}, {{5.0, 8.0}, {-1.0, 1.0}});
+    EXPECT_DOUBLE_EQ(stats.graphicsBusyMs, 6.0);
+    EXPECT_DOUBLE_EQ(stats.computeBusyMs, 5.0);
+    EXPECT_DOUBLE_EQ(stats.overlapMs, 2.0);
+    EXPECT_DOUBLE_EQ(stats.frameMs, 9.0);
+    EXPECT_DOUBLE_EQ(stats.overlapRatio, 0.4);
+}
+
+TEST(AsyncComputeTest, ComputeStatsNoComputeWork)
+{
+    AsyncComputeStats stats = AsyncComputeScheduler::ComputeStats({{0.0, 1.5}}, {});
+    EXPECT_DOUBLE_EQ(stats.graphicsBusyMs, 1.5);
+    EXPECT_DOUBLE_EQ(stats.computeBusyMs, 0.0);
+    EXPECT_DOUBLE_EQ(stats.overlapMs, 0.0);
+    EXPECT_DOUBLE_EQ(stats.frameMs, 1.5);
+    EXPECT_DOUBLE_EQ(stats.overlapRatio, 0.0);
+}
+
+} // namespace ppx
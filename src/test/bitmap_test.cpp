@@ -0,0 +1,290 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include "ppx/bitmap.h"
+#include "ppx/mipmap.h"
+#include "ppx/util.h"
+
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <utility>
+
+namespace ppx {
+namespace {
+
+// 4x4 bitmap with pixel (x, y) = x + 10 * y
+Bitmap MakeIndexBitmap()
+{
+    Bitmap bitmap = Bitmap::Create(4, 4, Bitmap::FORMAT_R_UINT8);
+    for (uint32_t y = 0; y < 4; ++y) {
+        for (uint32_t x = 0; x < 4; ++x) {
+            *bitmap.GetPixel8u(x, y) = static_cast<uint8_t>(x + 10 * y);
+        }
+    }
+    return bitmap;
+}
+
+bool IsHalfNaN(uint16_t value)
+{
+    return ((value & 0x7C00) == 0x7C00) && ((value & 0x3FF) != 0);
+}
+
+// Writes an uncompressed 2x1 Radiance file. RGBE pixels (128, 64, 192, 129)
+// and (32, 255, 0, 129) decode to (1.0, 0.5, 1.5) and (0.25, 255 / 128, 0),
+// which half floats represent exactly.
+std::filesystem::path WriteTestHDR()
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "ppx_bitmap_test.hdr";
+
+    std::ofstream os(path, std::ios::binary);
+    os << "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y 1 +X 2\n";
+    const unsigned char pixels[] = {128, 64, 192, 129, 32, 255, 0, 129};
+    os.write(reinterpret_cast<const char*>(pixels), sizeof(pixels));
+    return path;
+}
+
+const float kTestHDRPixels[2][4] = {
+    {1.0f, 0.5f, 1.5f, 1.0f},
+    {0.25f, 255.0f / 128.0f, 0.0f, 1.0f},
+};
+
+TEST(BitmapTest, MoveKeepsStorage)
+{
+    Bitmap      bitmap = MakeIndexBitmap();
+    const char* pData  = bitmap.GetData();
+
+    Bitmap moved = std::move(bitmap);
+    EXPECT_EQ(moved.GetData(), pData);
+    EXPECT_EQ(*moved.GetPixel8u(3, 2), 23);
+    EXPECT_FALSE(bitmap.IsOk());
+
+    Bitmap assigned;
+    assigned = std::move(moved);
+    EXPECT_EQ(assigned.GetData(), pData);
+    EXPECT_FALSE(moved.IsOk());
+
+    // Copies stay deep
+    Bitmap copy = assigned;
+    EXPECT_NE(copy.GetData(), pData);
+    EXPECT_EQ(*copy.GetPixel8u(3, 2), 23);
+}
+
+TEST(BitmapTest, SubView)
+{
+    Bitmap     bitmap = MakeIndexBitmap();
+    BitmapView view   = bitmap.GetView(1, 2, 2, 2);
+    ASSERT_TRUE(view.IsOk());
+    EXPECT_FALSE(view.IsTightlyPacked());
+    EXPECT_EQ(view.GetRowStride(), bitmap.GetRowStride());
+    EXPECT_EQ(*view.GetPixelAddress(0, 0), 21);
+    EXPECT_EQ(*view.GetPixelAddress(1, 1), 32);
+    EXPECT_EQ(view.GetPixelAddress(2, 0), nullptr);
+
+    EXPECT_FALSE(bitmap.GetView(3, 3, 2, 1).IsOk());
+
+    Bitmap packed = Bitmap::Create(2, 2, Bitmap::FORMAT_R_UINT8);
+    ASSERT_EQ(view.CopyTo(packed.GetView()), ppx::SUCCESS);
+    EXPECT_EQ(*packed.GetPixel8u(0, 0), 21);
+    EXPECT_EQ(*packed.GetPixel8u(1, 1), 32);
+
+    Bitmap wrongSize = Bitmap::Create(3, 2, Bitmap::FORMAT_R_UINT8);
+    EXPECT_NE(view.CopyTo(wrongSize.GetView()), ppx::SUCCESS);
+}
+
+TEST(MipmapTest, AdoptsLevel0)
+{
+    const Bitmap source = MakeIndexBitmap();
+    Mipmap       reference(source, 3);
+    ASSERT_TRUE(reference.IsOk());
+
+    Bitmap      bitmap = source;
+    const char* pData  = bitmap.GetData();
+
+    Mipmap mipmap(std::move(bitmap), 3);
+    ASSERT_TRUE(mipmap.IsOk());
+    ASSERT_EQ(mipmap.GetLevelCount(), 3u);
+    EXPECT_EQ(mipmap.GetMip(0)->GetData(), pData);
+    EXPECT_EQ(mipmap.GetMip(2)->GetWidth(), 1u);
+    EXPECT_EQ(*mipmap.GetMip(1)->GetPixel8u(1, 0), *reference.GetMip(1)->GetPixel8u(1, 0));
+    EXPECT_EQ(*mipmap.GetMip(2)->GetPixel8u(0, 0), *reference.GetMip(2)->GetPixel8u(0, 0));
+
+    Mipmap moved = std::move(mipmap);
+    EXPECT_EQ(moved.GetMip(0)->GetData(), pData);
+    EXPECT_EQ(*moved.GetMip(1)->GetPixel8u(1, 0), *reference.GetMip(1)->GetPixel8u(1, 0));
+}
+
+TEST(MipmapTest, ReferencesView)
+{
+    Bitmap bitmap = MakeIndexBitmap();
+    Mipmap mipmap(bitmap.GetView(), 2);
+    ASSERT_TRUE(mipmap.IsOk());
+    EXPECT_EQ(mipmap.GetMip(0)->GetData(), bitmap.GetData());
+
+    Mipmap copied(bitmap, 2);
+    ASSERT_TRUE(copied.IsOk());
+    EXPECT_NE(copied.GetMip(0)->GetData(), bitmap.GetData());
+    EXPECT_EQ(*copied.GetMip(1)->GetPixel8u(1, 1), *mipmap.GetMip(1)->GetPixel8u(1, 1));
+}
+
+TEST(HalfFloatTest, RoundTripIsExactForAllHalves)
+{
+    for (uint32_t i = 0; i <= 0xFFFF; ++i) {
+        const uint16_t half   = static_cast<uint16_t>(i);
+        const uint16_t result = FloatToHalf(HalfToFloat(half));
+        if (IsHalfNaN(half)) {
+            EXPECT_TRUE(IsHalfNaN(result)) << std::hex << half;
+            EXPECT_EQ(half & 0x8000, result & 0x8000) << std::hex << half;
+            continue;
+        }
+        ASSERT_EQ(result, half) << std::hex << half;
+    }
+}
+
+TEST(HalfFloatTest, NormalValues)
+{
+    EXPECT_EQ(FloatToHalf(1.0f), 0x3C00);
+    EXPECT_EQ(FloatToHalf(-2.0f), 0xC000);
+    EXPECT_EQ(FloatToHalf(0.5f), 0x3800);
+    EXPECT_EQ(FloatToHalf(65504.0f), 0x7BFF);
+    EXPECT_EQ(FloatToHalf(std::ldexp(1.0f, -14)), 0x0400);
+
+    EXPECT_EQ(HalfToFloat(0x3C00), 1.0f);
+    EXPECT_EQ(HalfToFloat(0x7BFF), 65504.0f);
+    EXPECT_EQ(HalfToFloat(0x3555), 0.25f * (1.0f + 0x155 / 1024.0f));
+}
+
+TEST(HalfFloatTest, RoundsToNearestEven)
+{
+    // Halfway between 1 and the next half rounds down to the even mantissa,
+    // halfway above that rounds up
+    EXPECT_EQ(FloatToHalf(1.0f + std::ldexp(1.0f, -11)), 0x3C00);
+    EXPECT_EQ(FloatToHalf(1.0f + 3.0f * std::ldexp(1.0f, -11)), 0x3C02);
+    EXPECT_EQ(FloatToHalf(1.0f + std::ldexp(1.0f, -11) + std::ldexp(1.0f, -20)), 0x3C01);
+
+    // Rounding may carry into the exponent
+    EXPECT_EQ(FloatToHalf(2.0f - std::ldexp(1.0f, -12)), 0x4000);
+}
+
+TEST(HalfFloatTest, Denormals)
+{
+    const float smallest = std::ldexp(1.0f, -24);
+    EXPECT_EQ(HalfToFloat(0x0001), smallest);
+    EXPECT_EQ(HalfToFloat(0x03FF), 1023.0f * smallest);
+    EXPECT_EQ(HalfToFloat(0x8001), -smallest);
+
+    EXPECT_EQ(FloatToHalf(smallest), 0x0001);
+    EXPECT_EQ(FloatToHalf(1023.0f * smallest), 0x03FF);
+    EXPECT_EQ(FloatToHalf(3.0f * smallest), 0x0003);
+
+    // Ties round to even, anything below half the smallest denormal is zero
+    EXPECT_EQ(FloatToHalf(0.5f * smallest), 0x0000);
+    EXPECT_EQ(FloatToHalf(1.5f * smallest), 0x0002);
+    EXPECT_EQ(FloatToHalf(0.75f * smallest), 0x0001);
+    EXPECT_EQ(FloatToHalf(1e-10f), 0x0000);
+    EXPECT_EQ(FloatToHalf(-1e-10f), 0x8000);
+
+    // Largest denormal rounds up into the smallest normal
+    EXPECT_EQ(FloatToHalf(1023.5f * smallest), 0x0400);
+}
+
+TEST(HalfFloatTest, SignedZero)
+{
+    EXPECT_EQ(FloatToHalf(0.0f), 0x0000);
+    EXPECT_EQ(FloatToHalf(-0.0f), 0x8000);
+    EXPECT_TRUE(std::signbit(HalfToFloat(0x8000)));
+    EXPECT_EQ(HalfToFloat(0x8000), 0.0f);
+}
+
+TEST(HalfFloatTest, InfinityAndNaN)
+{
+    const float inf = std::numeric_limits<float>::infinity();
+    EXPECT_EQ(FloatToHalf(inf), 0x7C00);
+    EXPECT_EQ(FloatToHalf(-inf), 0xFC00);
+    EXPECT_EQ(HalfToFloat(0x7C00), inf);
+    EXPECT_EQ(HalfToFloat(0xFC00), -inf);
+
+    // Out of range values overflow to infinity, 65520 is the first value
+    // that rounds up past the largest half
+    EXPECT_EQ(FloatToHalf(65519.0f), 0x7BFF);
+    EXPECT_EQ(FloatToHalf(65520.0f), 0x7C00);
+    EXPECT_EQ(FloatToHalf(1e10f), 0x7C00);
+    EXPECT_EQ(FloatToHalf(-1e10f), 0xFC00);
+
+    EXPECT_TRUE(IsHalfNaN(FloatToHalf(std::numeric_limits<float>::quiet_NaN())));
+    EXPECT_TRUE(std::isnan(HalfToFloat(0x7E00)));
+    EXPECT_TRUE(std::isnan(HalfToFloat(0x7C01)));
+
+    // A NaN whose payload sits only in the bits half drops stays NaN
+    uint32_t bits = 0x7F800001;
+    float    nan  = 0;
+    std::memcpy(&nan, &bits, sizeof(nan));
+    EXPECT_TRUE(IsHalfNaN(FloatToHalf(nan)));
+}
+
+TEST(BitmapTest, LoadHDRAsFloat)
+{
+    const std::filesystem::path path = WriteTestHDR();
+
+    Bitmap bitmap;
+    ASSERT_EQ(Bitmap::LoadFile(path, &bitmap), ppx::SUCCESS);
+    ASSERT_EQ(bitmap.GetFormat(), Bitmap::FORMAT_RGBA_FLOAT);
+    ASSERT_EQ(bitmap.GetWidth(), 2u);
+    ASSERT_EQ(bitmap.GetHeight(), 1u);
+
+    for (uint32_t x = 0; x < 2; ++x) {
+        const float* pPixel = bitmap.GetPixel32f(x, 0);
+        for (uint32_t c = 0; c < 4; ++c) {
+            EXPECT_EQ(pPixel[c], kTestHDRPixels[x][c]) << "pixel " << x << " channel " << c;
+        }
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST(BitmapTest, LoadHDRAsHalfFloat)
+{
+    const std::filesystem::path path = WriteTestHDR();
+
+    Bitmap bitmap;
+    ASSERT_EQ(Bitmap::LoadFile(path, &bitmap, BitmapLoadOptions().HalfFloat()), ppx::SUCCESS);
+    ASSERT_EQ(bitmap.GetFormat(), Bitmap::FORMAT_RGBA_FLOAT16);
+    ASSERT_EQ(bitmap.GetPixelStride(), 8u);
+
+    for (uint32_t x = 0; x < 2; ++x) {
+        const uint16_t* pPixel = reinterpret_cast<const uint16_t*>(bitmap.GetPixelAddress(x, 0));
+        for (uint32_t c = 0; c < 4; ++c) {
+            EXPECT_EQ(pPixel[c], FloatToHalf(kTestHDRPixels[x][c])) << "pixel " << x << " channel " << c;
+            EXPECT_EQ(HalfToFloat(pPixel[c]), kTestHDRPixels[x][c]) << "pixel " << x << " channel " << c;
+        }
+    }
+
+    // Native keeps the three channels of the file
+    Bitmap native;
+    ASSERT_EQ(Bitmap::LoadFile(path, &native, BitmapLoadOptions::Native().AllowRGB()), ppx::SUCCESS);
+    ASSERT_EQ(native.GetFormat(), Bitmap::FORMAT_RGB_FLOAT16);
+    const uint16_t* pPixel = reinterpret_cast<const uint16_t*>(native.GetPixelAddress(1, 0));
+    EXPECT_EQ(HalfToFloat(pPixel[0]), kTestHDRPixels[1][0]);
+    EXPECT_EQ(HalfToFloat(pPixel[1]), kTestHDRPixels[1][1]);
+    EXPECT_EQ(HalfToFloat(pPixel[2]), kTestHDRPixels[1][2]);
+
+    std::filesystem::remove(path);
+}
+
+} // namespace
+} // namespace ppx
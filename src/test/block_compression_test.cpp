@@ -0,0 +1,438 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include "ppx/block_compression.h"
+#include "ppx/job_system.h"
+
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace ppx {
+namespace {
+
+// Reference decoders for the subset of the formats the encoder produces.
+
+void ExpandRGB565(uint16_t value, int* pColor)
+{
+    int r     = (value >> 11) & 0x1F;
+    int g     = (value >> 5) & 0x3F;
+    int b     = value & 0x1F;
+    pColor[0] = (r << 3) | (r >> 2);
+    pColor[1] = (g << 2) | (g >> 4);
+    pColor[2] = (b << 3) | (b >> 2);
+}
+
+void DecodeBC1(const uint8_t* pBlock, uint8_t* pTexels)
+{
+    uint16_t color0 = static_cast<uint16_t>(pBlock[0] | (pBlock[1] << 8));
+    uint16_t color1 = static_cast<uint16_t>(pBlock[2] | (pBlock[3] << 8));
+
+    int palette[4][4] = {};
+    ExpandRGB565(color0, palette[0]);
+    ExpandRGB565(color1, palette[1]);
+    palette[0][3] = 255;
+    palette[1][3] = 255;
+    for (int c = 0; c < 3; ++c) {
+        if (color0 > color1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = (color0 > color1) ? 255 : 0;
+
+    uint32_t bits = pBlock[4] | (pBlock[5] << 8) | (pBlock[6] << 16) | (static_cast<uint32_t>(pBlock[7]) << 24);
+    for (uint32_t i = 0; i < 16; ++i) {
+        uint32_t index = (bits >> (2 * i)) & 0x3;
+        for (uint32_t c = 0; c < 4; ++c) {
+            pTexels[4 * i + c] = static_cast<uint8_t>(palette[index][c]);
+        }
+    }
+}
+
+void DecodeBC4(const uint8_t* pBlock, uint8_t* pTexels, uint32_t channel)
+{
+    int values[8] = {pBlock[0], pBlock[1]};
+    if (values[0] > values[1]) {
+        for (int i = 1; i < 7; ++i) {
+            values[i + 1] = ((7 - i) * values[0] + i * values[1]) / 7;
+        }
+    }
+    else {
+        for (int i = 1; i < 5; ++i) {
+            values[i + 1] = ((5 - i) * values[0] + i * values[1]) / 5;
+        }
+        values[6] = 0;
+        values[7] = 255;
+    }
+
+    uint64_t bits = 0;
+    for (uint32_t i = 0; i < 6; ++i) {
+        bits |= static_cast<uint64_t>(pBlock[2 + i]) << (8 * i);
+    }
+    for (uint32_t i = 0; i < 16; ++i) {
+        pTexels[4 * i + channel] = static_cast<uint8_t>(values[(bits >> (3 * i)) & 0x7]);
+    }
+}
+
+uint32_t ReadBits(const uint8_t* pBlock, uint32_t* pOffset, uint32_t bitCount)
+{
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < bitCount; ++i, ++(*pOffset)) {
+        value |= ((pBlock[*pOffset >> 3] >> (*pOffset & 7)) & 1) << i;
+    }
+    return value;
+}
+
+// Mode 6 only, which is the only mode the encoder writes.
+void DecodeBC7(const uint8_t* pBlock, uint8_t* pTexels)
+{
+    static const int kWeights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    uint32_t offset = 0;
+    ASSERT_EQ(ReadBits(pBlock, &offset, 7), 1u << 6);
+
+    int endpoints[2][4] = {};
+    for (int c = 0; c < 4; ++c) {
+        endpoints[0][c] = static_cast<int>(ReadBits(pBlock, &offset, 7));
+        endpoints[1][c] = static_cast<int>(ReadBits(pBlock, &offset, 7));
+    }
+    int pBit0 = static_cast<int>(ReadBits(pBlock, &offset, 1));
+    int pBit1 = static_cast<int>(ReadBits(pBlock, &offset, 1));
+    for (int c = 0; c < 4; ++c) {
+        endpoints[0][c] = (endpoints[0][c] << 1) | pBit0;
+        endpoints[1][c] = (endpoints[1][c] << 1) | pBit1;
+    }
+
+    for (uint32_t i = 0; i < 16; ++i) {
+        int w = kWeights[ReadBits(pBlock, &offset, (i == 0) ? 3 : 4)];
+        for (int c = 0; c < 4; ++c) {
+            pTexels[4 * i + c] = static_cast<uint8_t>(((64 - w) * endpoints[0][c] + w * endpoints[1][c] + 32) >> 6);
+        }
+    }
+}
+
+// Texels along a line through RGBA space, which every format here can
+// represent up to its index precision.
+void FillGradient(uint8_t* pTexels)
+{
+    for (uint32_t i = 0; i < 16; ++i) {
+        uint8_t* pTexel = pTexels + 4 * i;
+        pTexel[0]       = static_cast<uint8_t>(40 + 6 * i);
+        pTexel[1]       = static_cast<uint8_t>(200 - 4 * i);
+        pTexel[2]       = static_cast<uint8_t>(10 + 3 * i);
+        pTexel[3]       = static_cast<uint8_t>(255 - 5 * i);
+    }
+}
+
+int MaxError(const uint8_t* pExpected, const uint8_t* pActual, uint32_t channelCount)
+{
+    int maxError = 0;
+    for (uint32_t i = 0; i < 16; ++i) {
+        for (uint32_t c = 0; c < channelCount; ++c) {
+            maxError = std::max(maxError, std::abs(static_cast<int>(pExpected[4 * i + c]) - static_cast<int>(pActual[4 * i + c])));
+        }
+    }
+    return maxError;
+}
+
+} // namespace
+
+TEST(BlockCompressionTest, BC1SolidColorIsExact)
+{
+    uint8_t texels[64];
+    for (uint32_t i = 0; i < 16; ++i) {
+        texels[4 * i + 0] = 255;
+        texels[4 * i + 1] = 0;
+        texels[4 * i + 2] = 255;
+        texels[4 * i + 3] = 255;
+    }
+
+    uint8_t block[8];
+    EXPECT_EQ(CompressBlock(grfx::FORMAT_BC1_RGB_UNORM, texels, reinterpret_cast<char*>(block)), ppx::SUCCESS);
+
+    uint8_t decoded[64];
+    DecodeBC1(block, decoded);
+    EXPECT_EQ(MaxError(texels, decoded, 4), 0);
+}
+
+TEST(BlockCompressionTest, BC1Gradient)
+{
+    uint8_t texels[64];
+    FillGradient(texels);
+
+    uint8_t block[8];
+    EXPECT_EQ(CompressBlock(grfx::FORMAT_BC1_RGB_UNORM, texels, reinterpret_cast<char*>(block)), ppx::SUCCESS);
+
+    uint8_t decoded[64];
+    DecodeBC1(block, decoded);
+    EXPECT_LE(MaxError(texels, decoded, 3), 20);
+}
+
+TEST(BlockCompressionTest, BC1TransparentTexels)
+{
+    uint8_t texels[64];
+    FillGradient(texels);
+    texels[3]  = 0;
+    texels[63] = 0;
+
+    uint8_t block[8];
+    EXPECT_EQ(CompressBlock(grfx::FORMAT_BC1_RGBA_UNORM, texels, reinterpret_cast<char*>(block)), ppx::SUCCESS);
+
+    uint8_t decoded[64];
+    DecodeBC1(block, decoded);
+    for (uint32_t i = 0; i < 16; ++i) {
+        EXPECT_EQ(decoded[4 * i + 3], (texels[4 * i + 3] < 128) ? 0 : 255);
+    }
+}
+
+TEST(BlockCompressionTest, BC3Gradient)
+{
+    uint8_t texels[64];
+    FillGradient(texels);
+
+    uint8_t block[16];
+    EXPECT_EQ(CompressBlock(grfx::FORMAT_BC3_UNORM, texels, reinterpret_cast<char*>(block)), ppx::SUCCESS);
+
+    uint8_t decoded[64];
+    DecodeBC1(block + 8, decoded);
+    DecodeBC4(block, decoded, 3);
+    EXPECT_LE(MaxError(texels, decoded, 4), 20);
+    EXPECT_LE(std::abs(static_cast<int>(texels[3]) - static_cast<int>(decoded[3])), 2);
+    EXPECT_LE(std::abs(static_cast<int>(texels[63]) - static_cast<int>(decoded[63])), 2);
+}
+
+TEST(BlockCompressionTest, BC5Gradient)
+{
+    uint8_t texels[64];
+    FillGradient(texels);
+
+    uint8_t block[16];
+    EXPECT_EQ(CompressBlock(grfx::FORMAT_BC5_UNORM, texels, reinterpret_cast<char*>(block)), ppx::SUCCESS);
+
+    uint8_t decoded[64] = {};
+    DecodeBC4(block, decoded, 0);
+    DecodeBC4(block + 8, decoded, 1);
+    EXPECT_LE(MaxError(texels, decoded, 2), 7);
+}
+
+TEST(BlockCompressionTest, BC7Gradient)
+{
+    uint8_t texels[64];
+    FillGradient(texels);
+
+    uint8_t block[16];
+    EXPECT_EQ(CompressBlock(grfx::FORMAT_BC7_UNORM, texels, reinterpret_cast<char*>(block)), ppx::SUCCESS);
+
+    uint8_t decoded[64];
+    DecodeBC7(block, decoded);
+    EXPECT_LE(MaxError(texels, decoded, 4), 5);
+}
+
+TEST(BlockCompressionTest, BC7OpaqueStaysOpaque)
+{
+    uint8_t texels[64];
+    FillGradient(texels);
+    for (uint32_t i = 0; i < 16; ++i) {
+        texels[4 * i + 3] = 255;
+    }
+
+    uint8_t block[16];
+    EXPECT_EQ(CompressBlock(grfx::FORMAT_BC7_SRGB, texels, reinterpret_cast<char*>(block)), ppx::SUCCESS);
+
+    uint8_t decoded[64];
+    DecodeBC7(block, decoded);
+    for (uint32_t i = 0; i < 16; ++i) {
+        EXPECT_EQ(decoded[4 * i + 3], 255);
+    }
+}
+
+TEST(BlockCompressionTest, UnsupportedFormat)
+{
+    uint8_t texels[64] = {};
+    char    block[16];
+    EXPECT_FALSE(IsBlockCompressionSupported(grfx::FORMAT_BC6H_UFLOAT));
+    EXPECT_EQ(CompressBlock(grfx::FORMAT_BC6H_UFLOAT, texels, block), ppx::ERROR_IMAGE_INVALID_FORMAT);
+}
+
+TEST(BlockCompressionTest, CompressMipmapLevels)
+{
+    Mipmap mipmap(8, 8, Bitmap::FORMAT_RGBA_UINT8, 4);
+    ASSERT_TRUE(mipmap.IsOk());
+    for (uint32_t level = 0; level < mipmap.GetLevelCount(); ++level) {
+        Bitmap* pMip = mipmap.GetMip(level);
+        std::memset(pMip->GetData(), 0x80, static_cast<size_t>(pMip->GetFootprintSize()));
+    }
+
+    JobSystem jobs;
+    jobs.Initialize(2);
+
+    CompressedMipmap compressed;
+    ASSERT_EQ(CompressMipmap(mipmap, grfx::FORMAT_BC7_UNORM, &compressed, &jobs), ppx::SUCCESS);
+    ASSERT_EQ(compressed.GetLevelCount(), 4u);
+    EXPECT_EQ(compressed.GetBlockCountX(0), 2u);
+    EXPECT_EQ(compressed.GetBlockCountX(3), 1u);
+    EXPECT_EQ(compressed.GetRowStride(0), 32u);
+    EXPECT_EQ(compressed.GetDataSize(0), 64u);
+    EXPECT_EQ(compressed.GetDataSize(3), 16u);
+
+    for (uint32_t level = 0; level < compressed.GetLevelCount(); ++level) {
+        uint8_t decoded[64];
+        DecodeBC7(reinterpret_cast<const uint8_t*>(compressed.GetData(level)), decoded);
+        EXPECT_LE(std::abs(static_cast<int>(decoded[0]) - 0x80), 1);
+    }
+}
+
+TEST(BlockCompressionTest, CachedResultsMatch)
+{
+    const std::filesystem::path cacheDirectory = std::filesystem::temp_directory_path() / "ppx_block_compression_test";
+    std::filesystem::remove_all(cacheDirectory);
+
+    Mipmap mipmap(16, 16, Bitmap::FORMAT_RGBA_UINT8, 3);
+    ASSERT_TRUE(mipmap.IsOk());
+    for (uint32_t level = 0; level < mipmap.GetLevelCount(); ++level) {
+        Bitmap* pMip = mipmap.GetMip(level);
+        for (uint32_t y = 0; y < pMip->GetHeight(); ++y) {
+            for (uint32_t x = 0; x < pMip->GetWidth(); ++x) {
+                uint8_t* pPixel = pMip->GetPixel8u(x, y);
+                pPixel[0]       = static_cast<uint8_t>(x * 16);
+                pPixel[1]       = static_cast<uint8_t>(y * 16);
+                pPixel[2]       = static_cast<uint8_t>(level * 64);
+                pPixel[3]       = 255;
+            }
+        }
+    }
+
+    JobSystem jobs;
+    jobs.Initialize(2);
+
+    CompressedMipmap compressed;
+    ASSERT_EQ(CompressMipmapCached(mipmap, grfx::FORMAT_BC1_RGBA_UNORM, cacheDirectory, &compressed, &jobs), ppx::SUCCESS);
+
+    std::vector<std::filesystem::path> entries;
+    for (const auto& entry : std::filesystem::directory_iterator(cacheDirectory)) {
+        entries.push_back(entry.path());
+    }
+    ASSERT_EQ(entries.size(), 1u);
+    const auto writeTime = std::filesystem::last_write_time(entries[0]);
+
+    // The second call is served from the cache file written by the first
+    CompressedMipmap cached;
+    ASSERT_EQ(CompressMipmapCached(mipmap, grfx::FORMAT_BC1_RGBA_UNORM, cacheDirectory, &cached, &jobs), ppx::SUCCESS);
+    EXPECT_EQ(std::filesystem::last_write_time(entries[0]), writeTime);
+    EXPECT_EQ(cached.GetFormat(), grfx::FORMAT_BC1_RGBA_UNORM);
+    ASSERT_EQ(cached.GetLevelCount(), compressed.GetLevelCount());
+    for (uint32_t level = 0; level < compressed.GetLevelCount(); ++level) {
+        ASSERT_EQ(cached.GetDataSize(level), compressed.GetDataSize(level));
+        EXPECT_EQ(0, std::memcmp(cached.GetData(level), compressed.GetData(level), static_cast<size_t>(compressed.GetDataSize(level))));
+    }
+
+    // Another format is keyed separately
+    CompressedMipmap other;
+    ASSERT_EQ(CompressMipmapCached(mipmap, grfx::FORMAT_BC7_UNORM, cacheDirectory, &other, &jobs), ppx::SUCCESS);
+    EXPECT_EQ(other.GetFormat(), grfx::FORMAT_BC7_UNORM);
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator(cacheDirectory), std::filesystem::directory_iterator()), 2);
+
+    std::filesystem::remove_all(cacheDirectory);
+}
+
+TEST(BlockCompressionTest, CorruptCacheFileIsReencoded)
+{
+    const std::filesystem::path cacheDirectory = std::filesystem::temp_directory_path() / "ppx_block_compression_corrupt_test";
+    std::filesystem::remove_all(cacheDirectory);
+
+    Mipmap mipmap(16, 16, Bitmap::FORMAT_RGBA_UINT8, 3);
+    ASSERT_TRUE(mipmap.IsOk());
+    for (uint32_t level = 0; level < mipmap.GetLevelCount(); ++level) {
+        Bitmap* pMip = mipmap.GetMip(level);
+        for (uint32_t y = 0; y < pMip->GetHeight(); ++y) {
+            for (uint32_t x = 0; x < pMip->GetWidth(); ++x) {
+                uint8_t* pPixel = pMip->GetPixel8u(x, y);
+                pPixel[0]       = static_cast<uint8_t>(x * 16);
+                pPixel[1]       = static_cast<uint8_t>(255 - y * 16);
+                pPixel[2]       = static_cast<uint8_t>(level * 64);
+                pPixel[3]       = 255;
+            }
+        }
+    }
+
+    JobSystem jobs;
+    jobs.Initialize(2);
+
+    CompressedMipmap expected;
+    ASSERT_EQ(CompressMipmap(mipmap, grfx::FORMAT_BC1_RGBA_UNORM, &expected, &jobs), ppx::SUCCESS);
+
+    CompressedMipmap compressed;
+    ASSERT_EQ(CompressMipmapCached(mipmap, grfx::FORMAT_BC1_RGBA_UNORM, cacheDirectory, &compressed, &jobs), ppx::SUCCESS);
+
+    std::vector<std::filesystem::path> entries;
+    for (const auto& entry : std::filesystem::directory_iterator(cacheDirectory)) {
+        entries.push_back(entry.path());
+    }
+    ASSERT_EQ(entries.size(), 1u);
+    const uintmax_t fileSize = std::filesystem::file_size(entries[0]);
+
+    // Header fields after magic and version: format, width, height, levelCount
+    const uint32_t corruptHeaders[][4] = {
+        {static_cast<uint32_t>(grfx::FORMAT_BC1_RGBA_UNORM), 0xFFFFFFFF, 0xFFFFFFFF, 32},
+        {static_cast<uint32_t>(grfx::FORMAT_BC1_RGBA_UNORM), 16, 16, 6},
+        {static_cast<uint32_t>(grfx::FORMAT_BC1_RGBA_UNORM), 32, 16, 3},
+        {static_cast<uint32_t>(grfx::FORMAT_R8G8B8A8_UNORM), 16, 16, 3},
+    };
+    for (const auto& fields : corruptHeaders) {
+        {
+            std::fstream fs(entries[0], std::ios::binary | std::ios::in | std::ios::out);
+            ASSERT_TRUE(fs.is_open());
+            fs.seekp(2 * sizeof(uint32_t));
+            fs.write(reinterpret_cast<const char*>(fields), sizeof(fields));
+        }
+
+        CompressedMipmap loaded;
+        EXPECT_NE(CompressedMipmap::LoadFile(entries[0], &loaded), ppx::SUCCESS);
+
+        // The corrupt file is a cache miss: the result is re-encoded and the
+        // cache file is rewritten with a valid header.
+        CompressedMipmap reencoded;
+        ASSERT_EQ(CompressMipmapCached(mipmap, grfx::FORMAT_BC1_RGBA_UNORM, cacheDirectory, &reencoded, &jobs), ppx::SUCCESS);
+        ASSERT_EQ(reencoded.GetLevelCount(), expected.GetLevelCount());
+        EXPECT_EQ(reencoded.GetWidth(0), 16u);
+        EXPECT_EQ(reencoded.GetHeight(0), 16u);
+        for (uint32_t level = 0; level < expected.GetLevelCount(); ++level) {
+            ASSERT_EQ(reencoded.GetDataSize(level), expected.GetDataSize(level));
+            EXPECT_EQ(0, std::memcmp(reencoded.GetData(level), expected.GetData(level), static_cast<size_t>(expected.GetDataSize(level))));
+        }
+
+        EXPECT_EQ(std::filesystem::file_size(entries[0]), fileSize);
+        EXPECT_EQ(CompressedMipmap::LoadFile(entries[0], &loaded), ppx::SUCCESS);
+    }
+
+    // A truncated file is also a cache miss
+    std::filesystem::resize_file(entries[0], fileSize - 1);
+    CompressedMipmap truncated;
+    EXPECT_NE(CompressedMipmap::LoadFile(entries[0], &truncated), ppx::SUCCESS);
+    ASSERT_EQ(CompressMipmapCached(mipmap, grfx::FORMAT_BC1_RGBA_UNORM, cacheDirectory, &truncated, &jobs), ppx::SUCCESS);
+    EXPECT_EQ(std::filesystem::file_size(entries[0]), fileSize);
+
+    std::filesystem::remove_all(cacheDirectory);
+}
+
+} // namespace ppx
@@ -0,0 +1,74 @@
+// Copyright 2022 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "gtest/gtest.h"
+
+#include "ppx/bounding_volume.h"
+#include "ppx/camera.h"
+
+using namespace ppx;
+
+TEST(AABBTest, Expand)
+{
+    AABB aabb(float3(0, 0, 0));
+    aabb.Expand(float3(1, -2, 3));
+    EXPECT_EQ(aabb.GetMin(), float3(0, -2, 0));
+    EXPECT_EQ(aabb.GetMax(), float3(1, 0, 3));
+    EXPECT_EQ(aabb.GetCenter(), float3(0.5f, -1.0f, 1.5f));
+}
+
+TEST(FrustumTest, ContainsPoint)
+{
+    PerspCamera camera(float3(0, 0, 10), float3(0, 0, 0), float3(0, 1, 0), 60.0f, 1.0f, 1.0f, 100.0f);
+    Frustum     frustum = camera.GetFrustum();
+
+    EXPECT_TRUE(frustum.Contains(float3(0, 0, 0)));
+    EXPECT_TRUE(frustum.Contains(float3(0, 0, -80)));
+    // Behind the camera
+    EXPECT_FALSE(frustum.Contains(float3(0, 0, 20)));
+    // Closer than the near plane
+    EXPECT_FALSE(frustum.Contains(float3(0, 0, 9.5f)));
+    // Beyond the far plane
+    EXPECT_FALSE(frustum.Contains(float3(0, 0, -100)));
+    // Far off to the sides
+    EXPECT_FALSE(frustum.Contains(float3(100, 0, 0)));
+    EXPECT_FALSE(frustum.Contains(float3(0, -100, 0)));
+}
+
+TEST(FrustumTest, PlanesAreNormalized)
+{
+    PerspCamera camera(float3(3, 4, 5), float3(0, 0, 0), float3(0, 1, 0), 45.0f, 1.5f);
+    Frustum     frustum = camera.GetFrustum();
+    for (uint32_t i = 0; i < Frustum::PLANE_COUNT; ++i) {
+        EXPECT_NEAR(glm::length(float3(frustum.GetPlanes()[i])), 1.0f, 1e-4f);
+    }
+}
+
+TEST(FrustumTest, IntersectsAABB)
+{
+    PerspCamera camera(float3(0, 0, 10), float3(0, 0, 0), float3(0, 1, 0), 60.0f, 1.0f, 1.0f, 100.0f);
+    Frustum     frustum = camera.GetFrustum();
+
+    // Fully inside
+    EXPECT_TRUE(frustum.Intersects(AABB(float3(-1, -1, -1), float3(1, 1, 1))));
+    // Straddling the near plane
+    EXPECT_TRUE(frustum.Intersects(AABB(float3(-1, -1, 8), float3(1, 1, 12))));
+    // Larger than the frustum
+    EXPECT_TRUE(frustum.Intersects(AABB(float3(-1000, -1000, -1000), float3(1000, 1000, 1000))));
+    // Behind the camera
+    EXPECT_FALSE(frustum.Intersects(AABB(float3(-1, -1, 11), float3(1, 1, 13))));
+    // Off to the right
+    EXPECT_FALSE(frustum.Intersects(AABB(float3(90, -1, -1), float3(92, 1, 1))));
+}
@@ -0,0 +1,179 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include "ppx/cube_map.h"
+#include "ppx/graphics_util.h"
+#include "ppx/job_system.h"
+
+#include <cstring>
+#include <filesystem>
+
+namespace ppx {
+namespace {
+
+// 3x2 bitmap with pixel (x, y) = x + 10 * y
+Bitmap MakeIndexBitmap()
+{
+    Bitmap bitmap = Bitmap::Create(3, 2, Bitmap::FORMAT_R_UINT8);
+    for (uint32_t y = 0; y < 2; ++y) {
+        for (uint32_t x = 0; x < 3; ++x) {
+            *bitmap.GetPixel8u(x, y) = static_cast<uint8_t>(x + 10 * y);
+        }
+    }
+    return bitmap;
+}
+
+TEST(CubeMapTest, FaceOpRotate90)
+{
+    Bitmap src = MakeIndexBitmap();
+    Bitmap dst = Bitmap::Create(2, 3, Bitmap::FORMAT_R_UINT8);
+    ASSERT_EQ(ApplyCubeFaceOp(src, grfx_util::CUBE_FACE_OP_ROTATE_90, &dst), ppx::SUCCESS);
+
+    // Clockwise: the bottom left corner becomes the top left corner
+    EXPECT_EQ(*dst.GetPixel8u(0, 0), 10);
+    EXPECT_EQ(*dst.GetPixel8u(1, 0), 0);
+    EXPECT_EQ(*dst.GetPixel8u(0, 2), 12);
+    EXPECT_EQ(*dst.GetPixel8u(1, 2), 2);
+
+    // Sizes must be swapped
+    Bitmap wrongSize = Bitmap::Create(3, 2, Bitmap::FORMAT_R_UINT8);
+    EXPECT_NE(ApplyCubeFaceOp(src, grfx_util::CUBE_FACE_OP_ROTATE_90, &wrongSize), ppx::SUCCESS);
+}
+
+TEST(CubeMapTest, FaceOpRotate270AndFlips)
+{
+    Bitmap src = MakeIndexBitmap();
+    Bitmap dst = Bitmap::Create(2, 3, Bitmap::FORMAT_R_UINT8);
+    ASSERT_EQ(ApplyCubeFaceOp(src, grfx_util::CUBE_FACE_OP_ROTATE_270, &dst), ppx::SUCCESS);
+    EXPECT_EQ(*dst.GetPixel8u(0, 0), 2);
+    EXPECT_EQ(*dst.GetPixel8u(1, 0), 12);
+    EXPECT_EQ(*dst.GetPixel8u(0, 2), 0);
+
+    Bitmap same = Bitmap::Create(3, 2, Bitmap::FORMAT_R_UINT8);
+    ASSERT_EQ(ApplyCubeFaceOp(src, grfx_util::CUBE_FACE_OP_ROTATE_180, &same), ppx::SUCCESS);
+    EXPECT_EQ(*same.GetPixel8u(0, 0), 12);
+    EXPECT_EQ(*same.GetPixel8u(2, 1), 0);
+
+    ASSERT_EQ(ApplyCubeFaceOp(src, grfx_util::CUBE_FACE_OP_INVERT_HORIZONTAL, &same), ppx::SUCCESS);
+    EXPECT_EQ(*same.GetPixel8u(0, 0), 2);
+    EXPECT_EQ(*same.GetPixel8u(0, 1), 12);
+
+    ASSERT_EQ(ApplyCubeFaceOp(src, grfx_util::CUBE_FACE_OP_INVERT_VERTICAL, &same), ppx::SUCCESS);
+    EXPECT_EQ(*same.GetPixel8u(0, 0), 10);
+    EXPECT_EQ(*same.GetPixel8u(2, 1), 2);
+}
+
+TEST(CubeMapTest, ConstantEnvironment)
+{
+    JobSystem jobSystem;
+    jobSystem.Initialize(2);
+
+    Bitmap latLong = Bitmap::Create(64, 32, Bitmap::FORMAT_RGBA_FLOAT);
+    latLong.Fill(0.25f, 0.5f, 1.0f, 1.0f);
+
+    CubeMap environment;
+    ASSERT_EQ(ConvertLatLongToCubeMap(latLong, 16, UINT32_MAX, &environment, &jobSystem), ppx::SUCCESS);
+    EXPECT_EQ(environment.GetLevelCount(), 5u);
+    EXPECT_EQ(environment.GetFaceSize(4), 1u);
+    for (uint32_t face = 0; face < CUBE_MAP_FACE_COUNT; ++face) {
+        const float* pTexel = environment.GetTexels(face, 2) + 4 * 5;
+        EXPECT_NEAR(pTexel[0], 0.25f, 1e-5f);
+        EXPECT_NEAR(pTexel[2], 1.0f, 1e-5f);
+    }
+
+    // A constant environment convolves to the same constant
+    CubeMap irradiance;
+    ASSERT_EQ(ComputeIrradianceCubeMap(environment, 4, &irradiance, &jobSystem), ppx::SUCCESS);
+    for (uint32_t face = 0; face < CUBE_MAP_FACE_COUNT; ++face) {
+        const float* pTexel = irradiance.GetTexels(face, 0);
+        EXPECT_NEAR(pTexel[0], 0.25f, 0.01f);
+        EXPECT_NEAR(pTexel[1], 0.5f, 0.01f);
+        EXPECT_NEAR(pTexel[2], 1.0f, 0.01f);
+    }
+
+    CubeMap prefiltered;
+    ASSERT_EQ(ComputePrefilteredCubeMap(environment, 8, 3, 16, &prefiltered, &jobSystem), ppx::SUCCESS);
+    EXPECT_EQ(prefiltered.GetLevelCount(), 3u);
+    for (uint32_t level = 0; level < prefiltered.GetLevelCount(); ++level) {
+        const float* pTexel = prefiltered.GetTexels(CUBE_MAP_FACE_NEG_Y, level);
+        EXPECT_NEAR(pTexel[1], 0.5f, 1e-4f);
+    }
+}
+
+TEST(CubeMapTest, LatLongOrientation)
+{
+    // Top half red, bottom half green: +Y must be red, -Y green
+    Bitmap latLong = Bitmap::Create(32, 16, Bitmap::FORMAT_RGBA_UINT8);
+    for (uint32_t y = 0; y < 16; ++y) {
+        for (uint32_t x = 0; x < 32; ++x) {
+            uint8_t* pPixel = latLong.GetPixel8u(x, y);
+            pPixel[0]       = (y < 8) ? 255 : 0;
+            pPixel[1]       = (y < 8) ? 0 : 255;
+            pPixel[2]       = 0;
+            pPixel[3]       = 255;
+        }
+    }
+
+    CubeMap environment;
+    ASSERT_EQ(ConvertLatLongToCubeMap(latLong, 4, 1, &environment), ppx::SUCCESS);
+    const float* pPosY = environment.GetTexels(CUBE_MAP_FACE_POS_Y, 0);
+    const float* pNegY = environment.GetTexels(CUBE_MAP_FACE_NEG_Y, 0);
+    EXPECT_NEAR(pPosY[0], 1.0f, 1e-5f);
+    EXPECT_NEAR(pNegY[1], 1.0f, 1e-5f);
+}
+
+TEST(CubeMapTest, CachedResultsMatch)
+{
+    const std::filesystem::path cacheDirectory = std::filesystem::temp_directory_path() / "ppx_cube_map_test";
+    std::filesystem::remove_all(cacheDirectory);
+
+    Bitmap latLong = Bitmap::Create(32, 16, Bitmap::FORMAT_RGBA_FLOAT);
+    for (uint32_t y = 0; y < 16; ++y) {
+        for (uint32_t x = 0; x < 32; ++x) {
+            float* pPixel = latLong.GetPixel32f(x, y);
+            pPixel[0]     = static_cast<float>(x) / 32.0f;
+            pPixel[1]     = static_cast<float>(y) / 16.0f;
+            pPixel[2]     = 0.5f;
+            pPixel[3]     = 1.0f;
+        }
+    }
+
+    IBLCubeMapOptions options      = {};
+    options.environmentSize        = 8;
+    options.irradianceSize         = 4;
+    options.prefilteredLevelCount  = 3;
+    options.prefilteredSampleCount = 8;
+
+    CubeMap irradiance;
+    CubeMap prefiltered;
+    ASSERT_EQ(ComputeIBLCubeMapsCached(latLong, options, cacheDirectory, &irradiance, &prefiltered), ppx::SUCCESS);
+
+    CubeMap cachedIrradiance;
+    CubeMap cachedPrefiltered;
+    ASSERT_EQ(ComputeIBLCubeMapsCached(latLong, options, cacheDirectory, &cachedIrradiance, &cachedPrefiltered), ppx::SUCCESS);
+    ASSERT_EQ(cachedPrefiltered.GetLevelCount(), prefiltered.GetLevelCount());
+    EXPECT_EQ(cachedIrradiance.GetFaceSize(), 4u);
+    for (uint32_t level = 0; level < prefiltered.GetLevelCount(); ++level) {
+        for (uint32_t face = 0; face < CUBE_MAP_FACE_COUNT; ++face) {
+            EXPECT_EQ(0, std::memcmp(prefiltered.GetTexels(face, level), cachedPrefiltered.GetTexels(face, level), prefiltered.GetFaceDataSize(level)));
+        }
+    }
+
+    std::filesystem::remove_all(cacheDirectory);
+}
+
+} // namespace
+} // namespace ppx
@@ -0,0 +1,91 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include "ppx/frame_capture.h"
+
+#include <sstream>
+#include <vector>
+
+namespace ppx {
+namespace {
+
+TEST(FrameCaptureTest, ParseFrameRange)
+{
+    uint64_t start = 0;
+    uint64_t count = 0;
+    EXPECT_EQ(ParseFrameRange("100:10", &start, &count), ppx::SUCCESS);
+    EXPECT_EQ(start, 100u);
+    EXPECT_EQ(count, 10u);
+
+    EXPECT_EQ(ParseFrameRange("0:0", &start, &count), ppx::SUCCESS);
+    EXPECT_EQ(start, 0u);
+    EXPECT_EQ(count, 0u);
+
+    EXPECT_NE(ParseFrameRange("100", &start, &count), ppx::SUCCESS);
+    EXPECT_NE(ParseFrameRange(":10", &start, &count), ppx::SUCCESS);
+    EXPECT_NE(ParseFrameRange("1:2:3", &start, &count), ppx::SUCCESS);
+    EXPECT_NE(ParseFrameRange("-1:2", &start, &count), ppx::SUCCESS);
+    EXPECT_NE(ParseFrameRange("a:b", &start, &count), ppx::SUCCESS);
+}
+
+TEST(FrameCaptureTest, ParseEncoding)
+{
+    FrameCaptureEncoding encoding = FRAME_CAPTURE_ENCODING_PPM;
+    EXPECT_EQ(ParseFrameCaptureEncoding("png", &encoding), ppx::SUCCESS);
+    EXPECT_EQ(encoding, FRAME_CAPTURE_ENCODING_PNG);
+    EXPECT_EQ(ParseFrameCaptureEncoding("raw", &encoding), ppx::SUCCESS);
+    EXPECT_EQ(encoding, FRAME_CAPTURE_ENCODING_RAW);
+    EXPECT_NE(ParseFrameCaptureEncoding("jpg", &encoding), ppx::SUCCESS);
+    EXPECT_STREQ(GetFrameCaptureExtension(FRAME_CAPTURE_ENCODING_PPM), ".ppm");
+}
+
+TEST(FrameCaptureTest, WriteRawDropsRowPadding)
+{
+    // 2x2 RGBA with a row pitch of 12 bytes
+    std::vector<unsigned char> texels = {
+        1, 2, 3, 4, 5, 6, 7, 8, 0xEE, 0xEE, 0xEE, 0xEE, //
+        9, 10, 11, 12, 13, 14, 15, 16, 0xEE, 0xEE, 0xEE, 0xEE};
+
+    std::stringstream stream(std::ios::out | std::ios::in | std::ios::binary);
+    ASSERT_EQ(WriteCapturedFrame(stream, FRAME_CAPTURE_ENCODING_RAW, grfx::FORMAT_R8G8B8A8_UNORM, texels.data(), 2, 2, 12), ppx::SUCCESS);
+
+    std::string want = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+    EXPECT_EQ(stream.str(), want);
+}
+
+TEST(FrameCaptureTest, WritePPMSwizzlesBGRA)
+{
+    std::vector<unsigned char> texels = {3, 2, 1, 255, 6, 5, 4, 255};
+
+    std::stringstream stream(std::ios::out | std::ios::in | std::ios::binary);
+    ASSERT_EQ(WriteCapturedFrame(stream, FRAME_CAPTURE_ENCODING_PPM, grfx::FORMAT_B8G8R8A8_UNORM, texels.data(), 2, 1, 8), ppx::SUCCESS);
+
+    std::string ppm = stream.str();
+    ASSERT_GE(ppm.size(), 6u);
+    EXPECT_EQ(ppm.substr(0, 2), "P6");
+    EXPECT_EQ(ppm.substr(ppm.size() - 6), std::string({1, 2, 3, 4, 5, 6}));
+}
+
+TEST(FrameCaptureTest, PNGRequires8BitRGBA)
+{
+    std::vector<float> texels(4, 0.0f);
+
+    std::stringstream stream(std::ios::out | std::ios::in | std::ios::binary);
+    EXPECT_NE(WriteCapturedFrame(stream, FRAME_CAPTURE_ENCODING_PNG, grfx::FORMAT_R32G32B32A32_FLOAT, texels.data(), 1, 1, 16), ppx::SUCCESS);
+}
+
+} // namespace
+} // namespace ppx
@@ -0,0 +1,249 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include "ppx/frame_graph.h"
+#include "ppx/grfx/grfx_image.h"
+
+namespace ppx {
+namespace {
+
+// Schedule() needs no device, these tests never create GPU objects.
+// Imported images only need to exist, the graph does not look at them
+// before Execute().
+class TestImage
+    : public grfx::Image
+{
+public:
+    virtual Result MapMemory(uint64_t offset, void** ppMappedAddress) override { return ppx::ERROR_FAILED; }
+    virtual void   UnmapMemory() override {}
+
+protected:
+    virtual Result CreateApiObjects(const grfx::ImageCreateInfo* pCreateInfo) override { return ppx::SUCCESS; }
+    virtual void   DestroyApiObjects() override {}
+};
+
+FrameGraphTextureDesc MakeDesc(uint32_t width = 64, uint32_t height = 64)
+{
+    FrameGraphTextureDesc desc = {};
+    desc.width                 = width;
+    desc.height                = height;
+    desc.format                = grfx::FORMAT_R8G8B8A8_UNORM;
+    return desc;
+}
+
+const FrameGraphExecuteFn kNoop = [](FrameGraphPassContext&) {};
+
+TEST(FrameGraphTest, DeclarationOrderIsKept)
+{
+    FrameGraph               graph;
+    const FrameGraphResource a      = graph.CreateTexture("A", MakeDesc());
+    const FrameGraphResource b      = graph.CreateTexture("B", MakeDesc());
+    const FrameGraphResource output = graph.CreateTexture("Output", MakeDesc());
+
+    graph.AddPass("WriteA", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Write(a, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    graph.AddPass("WriteB", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Write(b, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    graph.AddPass("Combine", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Read(a).Read(b).Write(output, grfx::RESOURCE_STATE_UNORDERED_ACCESS).SetSideEffect();
+
+    ASSERT_EQ(graph.Schedule(), ppx::SUCCESS);
+    EXPECT_EQ(graph.GetPassExecutionIndex("WriteA"), 0);
+    EXPECT_EQ(graph.GetPassExecutionIndex("WriteB"), 1);
+    EXPECT_EQ(graph.GetPassExecutionIndex("Combine"), 2);
+}
+
+TEST(FrameGraphTest, ProducerDeclaredAfterConsumerRunsFirst)
+{
+    FrameGraph               graph;
+    const FrameGraphResource a = graph.CreateTexture("A", MakeDesc());
+    const FrameGraphResource b = graph.CreateTexture("B", MakeDesc());
+
+    graph.AddPass("Consume", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Read(b).SetSideEffect();
+    graph.AddPass("ProduceB", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Read(a).Write(b, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    graph.AddPass("ProduceA", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Write(a, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+
+    ASSERT_EQ(graph.Schedule(), ppx::SUCCESS);
+    EXPECT_EQ(graph.GetPassExecutionIndex("ProduceA"), 0);
+    EXPECT_EQ(graph.GetPassExecutionIndex("ProduceB"), 1);
+    EXPECT_EQ(graph.GetPassExecutionIndex("Consume"), 2);
+    EXPECT_EQ(graph.GetStats().culledPassCount, 0);
+}
+
+TEST(FrameGraphTest, IndependentPassesKeepDeclarationOrder)
+{
+    FrameGraph               graph;
+    const FrameGraphResource a = graph.CreateTexture("A", MakeDesc());
+
+    graph.AddPass("Independent0", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).SetSideEffect();
+    graph.AddPass("Consume", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Read(a).SetSideEffect();
+    graph.AddPass("Independent1", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).SetSideEffect();
+    graph.AddPass("Produce", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Write(a, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+
+    // Consume waits for Produce, everything else stays where it was declared
+    ASSERT_EQ(graph.Schedule(), ppx::SUCCESS);
+    EXPECT_EQ(graph.GetPassExecutionIndex("Independent0"), 0);
+    EXPECT_EQ(graph.GetPassExecutionIndex("Independent1"), 1);
+    EXPECT_EQ(graph.GetPassExecutionIndex("Produce"), 2);
+    EXPECT_EQ(graph.GetPassExecutionIndex("Consume"), 3);
+}
+
+TEST(FrameGraphTest, WriteAfterReadIsOrdered)
+{
+    FrameGraph               graph;
+    const FrameGraphResource a = graph.CreateTexture("A", MakeDesc());
+
+    // The second write overwrites what Read0 reads, Read1 sees the second write
+    graph.AddPass("Write0", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Write(a, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    graph.AddPass("Read0", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Read(a).SetSideEffect();
+    graph.AddPass("Write1", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Write(a, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    graph.AddPass("Read1", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Read(a).SetSideEffect();
+
+    ASSERT_EQ(graph.Schedule(), ppx::SUCCESS);
+    EXPECT_LT(graph.GetPassExecutionIndex("Write0"), graph.GetPassExecutionIndex("Read0"));
+    EXPECT_LT(graph.GetPassExecutionIndex("Read0"), graph.GetPassExecutionIndex("Write1"));
+    EXPECT_LT(graph.GetPassExecutionIndex("Write1"), graph.GetPassExecutionIndex("Read1"));
+}
+
+TEST(FrameGraphTest, ImportedReadBeforeWriteSeesPreviousContent)
+{
+    TestImage                image;
+    FrameGraph               graph;
+    const FrameGraphResource history = graph.ImportImage("History", &image);
+
+    // The read wants last frame's content, so it must not move after the write
+    graph.AddPass("ReadHistory", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Read(history).SetSideEffect();
+    graph.AddPass("WriteHistory", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Write(history, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+
+    ASSERT_EQ(graph.Schedule(), ppx::SUCCESS);
+    EXPECT_EQ(graph.GetPassExecutionIndex("ReadHistory"), 0);
+    EXPECT_EQ(graph.GetPassExecutionIndex("WriteHistory"), 1);
+    EXPECT_FALSE(graph.IsPassCulled("WriteHistory"));
+}
+
+TEST(FrameGraphTest, ReadWithoutWriterFails)
+{
+    FrameGraph               graph;
+    const FrameGraphResource a = graph.CreateTexture("A", MakeDesc());
+
+    graph.AddPass("Read", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Read(a).SetSideEffect();
+
+    EXPECT_EQ(graph.Schedule(), ppx::ERROR_FAILED);
+}
+
+TEST(FrameGraphTest, CycleFails)
+{
+    FrameGraph               graph;
+    const FrameGraphResource a = graph.CreateTexture("A", MakeDesc());
+    const FrameGraphResource b = graph.CreateTexture("B", MakeDesc());
+
+    graph.AddPass("P0", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Read(b).Write(a, grfx::RESOURCE_STATE_UNORDERED_ACCESS).SetSideEffect();
+    graph.AddPass("P1", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Read(a).Write(b, grfx::RESOURCE_STATE_UNORDERED_ACCESS).SetSideEffect();
+
+    // P1 sees P0's write of A, P0 sees P1's write of B
+    EXPECT_EQ(graph.Schedule(), ppx::ERROR_FAILED);
+}
+
+TEST(FrameGraphTest, UnconsumedPassesAreCulled)
+{
+    FrameGraph               graph;
+    const FrameGraphResource a      = graph.CreateTexture("A", MakeDesc());
+    const FrameGraphResource unused = graph.CreateTexture("Unused", MakeDesc());
+    const FrameGraphResource output = graph.CreateTexture("Output", MakeDesc());
+
+    graph.AddPass("WriteA", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Write(a, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    graph.AddPass("WriteUnused", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Read(a).Write(unused, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    graph.AddPass("WriteOutput", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Read(a).Write(output, grfx::RESOURCE_STATE_UNORDERED_ACCESS).SetSideEffect();
+
+    ASSERT_EQ(graph.Schedule(), ppx::SUCCESS);
+    EXPECT_FALSE(graph.IsPassCulled("WriteA"));
+    EXPECT_TRUE(graph.IsPassCulled("WriteUnused"));
+    EXPECT_FALSE(graph.IsPassCulled("WriteOutput"));
+    EXPECT_EQ(graph.GetStats().passCount, 3);
+    EXPECT_EQ(graph.GetStats().culledPassCount, 1);
+
+    // Culled passes do not keep their resources alive
+    EXPECT_EQ(graph.GetStats().transientResourceCount, 2);
+}
+
+TEST(FrameGraphTest, CullingFollowsReorderedProducers)
+{
+    FrameGraph               graph;
+    const FrameGraphResource a = graph.CreateTexture("A", MakeDesc());
+
+    // The producer is declared after its only consumer and must survive
+    graph.AddPass("Consume", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Read(a).SetSideEffect();
+    graph.AddPass("Produce", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Write(a, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+
+    ASSERT_EQ(graph.Schedule(), ppx::SUCCESS);
+    EXPECT_FALSE(graph.IsPassCulled("Produce"));
+    EXPECT_FALSE(graph.IsPassCulled("Consume"));
+}
+
+TEST(FrameGraphTest, DisjointLifetimesSharePhysicalTexture)
+{
+    FrameGraph               graph;
+    const FrameGraphResource a      = graph.CreateTexture("A", MakeDesc());
+    const FrameGraphResource b      = graph.CreateTexture("B", MakeDesc());
+    const FrameGraphResource c      = graph.CreateTexture("C", MakeDesc());
+    const FrameGraphResource output = graph.CreateTexture("Output", MakeDesc(32, 32));
+
+    // A is dead once B is written, so C can take its texture. B is alive
+    // while C is written and needs its own.
+    graph.AddPass("WriteA", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Write(a, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    graph.AddPass("WriteB", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Read(a).Write(b, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    graph.AddPass("WriteC", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Read(b).Write(c, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    graph.AddPass("WriteOutput", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Read(c).Write(output, grfx::RESOURCE_STATE_UNORDERED_ACCESS).SetSideEffect();
+
+    ASSERT_EQ(graph.Schedule(), ppx::SUCCESS);
+
+    const FrameGraphStats& stats = graph.GetStats();
+    EXPECT_EQ(stats.transientResourceCount, 4);
+    EXPECT_EQ(stats.physicalTextureCount, 3);
+
+    const uint64_t size64 = 64 * 64 * 4;
+    const uint64_t size32 = 32 * 32 * 4;
+    EXPECT_EQ(stats.unaliasedTransientMemorySize, 3 * size64 + size32);
+    EXPECT_EQ(stats.transientMemorySize, 2 * size64 + size32);
+}
+
+TEST(FrameGraphTest, OverlappingLifetimesDoNotShare)
+{
+    FrameGraph               graph;
+    const FrameGraphResource a = graph.CreateTexture("A", MakeDesc());
+    const FrameGraphResource b = graph.CreateTexture("B", MakeDesc());
+
+    graph.AddPass("WriteA", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Write(a, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    graph.AddPass("WriteB", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Write(b, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    graph.AddPass("ReadBoth", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Read(a).Read(b).SetSideEffect();
+
+    ASSERT_EQ(graph.Schedule(), ppx::SUCCESS);
+    EXPECT_EQ(graph.GetStats().physicalTextureCount, 2);
+}
+
+TEST(FrameGraphTest, PhysicalTexturesAreReusedAcrossSchedules)
+{
+    FrameGraph graph;
+    for (uint32_t frame = 0; frame < 3; ++frame) {
+        graph.Reset();
+
+        const FrameGraphResource a = graph.CreateTexture("A", MakeDesc());
+        graph.AddPass("WriteA", FRAME_GRAPH_PASS_TYPE_COMPUTE, kNoop).Write(a, grfx::RESOURCE_STATE_UNORDERED_ACCESS).SetSideEffect();
+
+        ASSERT_EQ(graph.Schedule(), ppx::SUCCESS);
+        EXPECT_EQ(graph.GetStats().physicalTextureCount, 1);
+    }
+}
+
+} // namespace
+} // namespace ppx
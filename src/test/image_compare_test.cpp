@@ -0,0 +1,175 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include "ppx/image_compare.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace ppx {
+namespace {
+
+Bitmap CreateGradient(uint32_t width, uint32_t height)
+{
+    Bitmap bitmap = Bitmap::Create(width, height, Bitmap::FORMAT_RGBA_UINT8);
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            uint8_t* pPixel = reinterpret_cast<uint8_t*>(bitmap.GetPixelAddress(x, y));
+            pPixel[0]       = static_cast<uint8_t>(x * 4);
+            pPixel[1]       = static_cast<uint8_t>(y * 4);
+            pPixel[2]       = static_cast<uint8_t>((x + y) * 2);
+            pPixel[3]       = 0xFF;
+        }
+    }
+    return bitmap;
+}
+
+TEST(ImageCompareTest, IdenticalImages)
+{
+    Bitmap reference = CreateGradient(37, 29);
+
+    ImageCompareOptions options;
+    options.computeFLIP = true;
+    ImageCompareResult result;
+    ASSERT_EQ(CompareImages(reference, reference, options, &result), ppx::SUCCESS);
+    EXPECT_EQ(result.pixelCount, 37u * 29u);
+    EXPECT_EQ(result.differentPixelCount, 0u);
+    EXPECT_EQ(result.meanSquaredError, 0.0);
+    EXPECT_TRUE(std::isinf(result.psnr));
+    EXPECT_DOUBLE_EQ(result.ssim, 1.0);
+    EXPECT_EQ(result.maxFLIP, 0.0f);
+}
+
+TEST(ImageCompareTest, KnownDifference)
+{
+    Bitmap reference = CreateGradient(60, 16);
+    Bitmap test      = CreateGradient(60, 16);
+
+    // Every red channel of the first row is 10 steps brighter
+    for (uint32_t x = 0; x < 60; ++x) {
+        uint8_t* pPixel = reinterpret_cast<uint8_t*>(test.GetPixelAddress(x, 0));
+        pPixel[0] += 10;
+        pPixel[3] = 0; // Ignored by default
+    }
+
+    ImageCompareOptions options;
+    options.threshold = 9;
+    ImageCompareResult result;
+    ASSERT_EQ(CompareImages(reference, test, options, &result), ppx::SUCCESS);
+    EXPECT_EQ(result.differentPixelCount, 60u);
+    EXPECT_FLOAT_EQ(result.maxDifference, 10.0f / 255.0f);
+
+    const double mse = (60.0 * 100.0) / (60.0 * 16.0 * 3.0) / (255.0 * 255.0);
+    EXPECT_NEAR(result.meanSquaredError, mse, 1e-12);
+    EXPECT_NEAR(result.psnr, -10.0 * std::log10(mse), 1e-6);
+
+    options.threshold = 10;
+    ASSERT_EQ(CompareImages(reference, test, options, &result), ppx::SUCCESS);
+    EXPECT_EQ(result.differentPixelCount, 0u);
+
+    options.compareAlpha = true;
+    ASSERT_EQ(CompareImages(reference, test, options, &result), ppx::SUCCESS);
+    EXPECT_EQ(result.differentPixelCount, 60u);
+}
+
+TEST(ImageCompareTest, MaskExcludesPixels)
+{
+    Bitmap reference = CreateGradient(20, 20);
+    Bitmap test      = CreateGradient(20, 20);
+    Bitmap mask      = Bitmap::Create(20, 20, Bitmap::FORMAT_R_UINT8);
+    for (uint32_t y = 0; y < 20; ++y) {
+        for (uint32_t x = 0; x < 20; ++x) {
+            *reinterpret_cast<uint8_t*>(mask.GetPixelAddress(x, y)) = 0;
+        }
+    }
+    reinterpret_cast<uint8_t*>(test.GetPixelAddress(3, 4))[1] ^= 0xFF;
+    *reinterpret_cast<uint8_t*>(mask.GetPixelAddress(3, 4)) = 255;
+
+    ImageCompareOptions options;
+    options.pMask           = &mask;
+    options.computeFLIP     = true;
+    options.generateHeatmap = true;
+    ImageCompareResult result;
+    ASSERT_EQ(CompareImages(reference, test, options, &result), ppx::SUCCESS);
+    EXPECT_EQ(result.pixelCount, 399u);
+    EXPECT_EQ(result.differentPixelCount, 0u);
+    EXPECT_EQ(result.meanSquaredError, 0.0);
+    EXPECT_DOUBLE_EQ(result.ssim, 1.0);
+    EXPECT_EQ(result.maxFLIP, 0.0f);
+
+    const uint8_t* pExcluded = reinterpret_cast<const uint8_t*>(result.heatmap.GetPixelAddress(3, 4));
+    EXPECT_EQ(pExcluded[2], 64);
+}
+
+TEST(ImageCompareTest, NoiseLowersSSIMAndRaisesFLIP)
+{
+    Bitmap   reference = CreateGradient(64, 64);
+    Bitmap   test      = CreateGradient(64, 64);
+    uint32_t state     = 1;
+    for (uint32_t y = 0; y < 64; ++y) {
+        for (uint32_t x = 0; x < 64; ++x) {
+            uint8_t* pPixel = reinterpret_cast<uint8_t*>(test.GetPixelAddress(x, y));
+            for (uint32_t c = 0; c < 3; ++c) {
+                state     = state * 1664525u + 1013904223u;
+                pPixel[c] = static_cast<uint8_t>(std::min(255, std::max(0, pPixel[c] + static_cast<int>(state >> 28) - 8)));
+            }
+        }
+    }
+
+    ImageCompareOptions options;
+    options.computeFLIP     = true;
+    options.generateHeatmap = true;
+    options.heatmapMetric   = IMAGE_COMPARE_METRIC_FLIP;
+    ImageCompareResult result;
+    ASSERT_EQ(CompareImages(reference, test, options, &result), ppx::SUCCESS);
+    EXPECT_LT(result.ssim, 0.99);
+    EXPECT_GT(result.ssim, 0.0);
+    EXPECT_GT(result.meanFLIP, 0.0);
+    EXPECT_LE(result.maxFLIP, 1.0f);
+    EXPECT_EQ(result.heatmap.GetWidth(), 64u);
+    EXPECT_EQ(result.heatmap.GetHeight(), 64u);
+}
+
+TEST(ImageCompareTest, ConvertsFormats)
+{
+    Bitmap reference = CreateGradient(8, 8);
+    Bitmap test      = Bitmap::Create(8, 8, Bitmap::FORMAT_RGBA_FLOAT);
+    for (uint32_t y = 0; y < 8; ++y) {
+        for (uint32_t x = 0; x < 8; ++x) {
+            const uint8_t* pSrc = reinterpret_cast<const uint8_t*>(reference.GetPixelAddress(x, y));
+            float*         pDst = reinterpret_cast<float*>(test.GetPixelAddress(x, y));
+            for (uint32_t c = 0; c < 4; ++c) {
+                pDst[c] = pSrc[c] / 255.0f;
+            }
+        }
+    }
+
+    ImageCompareOptions options;
+    ImageCompareResult  result;
+    ASSERT_EQ(CompareImages(reference, test, options, &result), ppx::SUCCESS);
+    EXPECT_EQ(result.differentPixelCount, 0u);
+}
+
+TEST(ImageCompareTest, SizeMismatch)
+{
+    ImageCompareOptions options;
+    ImageCompareResult  result;
+    EXPECT_EQ(CompareImages(CreateGradient(8, 8), CreateGradient(8, 9), options, &result), ppx::ERROR_BITMAP_FOOTPRINT_MISMATCH);
+}
+
+} // namespace
+} // namespace ppx
@@ -0,0 +1,79 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include "ppx/job_system.h"
+
+#include <atomic>
+#include <vector>
+
+namespace ppx {
+
+TEST(JobSystemTest, RunsEveryJobOnceWithoutWorkers)
+{
+    JobSystem jobs;
+    jobs.Initialize(0);
+    EXPECT_EQ(jobs.GetThreadCount(), 1u);
+
+    std::vector<uint32_t> runCounts(16, 0);
+    jobs.Run(16, [&runCounts](uint32_t jobIndex, uint32_t threadIndex) {
+        EXPECT_EQ(threadIndex, 0u);
+        ++runCounts[jobIndex];
+    });
+
+    for (uint32_t count : runCounts) {
+        EXPECT_EQ(count, 1u);
+    }
+}
+
+TEST(JobSystemTest, RunsEveryJobOnceWithWorkers)
+{
+    JobSystem jobs;
+    jobs.Initialize(3);
+    EXPECT_EQ(jobs.GetThreadCount(), 4u);
+
+    std::vector<std::atomic<uint32_t>> runCounts(1000);
+    std::atomic<bool>                  badThreadIndex = false;
+    jobs.Run(1000, [&](uint32_t jobIndex, uint32_t threadIndex) {
+        if (threadIndex >= 4) {
+            badThreadIndex = true;
+        }
+        ++runCounts[jobIndex];
+    });
+
+    EXPECT_FALSE(badThreadIndex);
+    for (auto& count : runCounts) {
+        EXPECT_EQ(count.load(), 1u);
+    }
+}
+
+TEST(JobSystemTest, RunsConsecutiveBatches)
+{
+    JobSystem jobs;
+    jobs.Initialize(2);
+
+    std::atomic<uint32_t> total = 0;
+    for (uint32_t batch = 0; batch < 100; ++batch) {
+        jobs.Run(batch % 7, [&total](uint32_t, uint32_t) { ++total; });
+    }
+
+    uint32_t expected = 0;
+    for (uint32_t batch = 0; batch < 100; ++batch) {
+        expected += batch % 7;
+    }
+    EXPECT_EQ(total.load(), expected);
+}
+
+} // namespace ppx
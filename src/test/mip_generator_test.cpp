@@ -0,0 +1,362 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include "ppx/bitmap.h"
+#include "ppx/fs.h"
+#include "ppx/graphics_util.h"
+#include "ppx/image_compare.h"
+#include "ppx/mip_generator.h"
+#include "ppx/mipmap.h"
+#include "ppx/pixel_conversion.h"
+#include "ppx/grfx/grfx_buffer.h"
+#include "ppx/grfx/grfx_command.h"
+#include "ppx/grfx/grfx_device.h"
+#include "ppx/grfx/grfx_gpu.h"
+#include "ppx/grfx/grfx_instance.h"
+#include "ppx/grfx/grfx_queue.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ppx {
+namespace {
+
+// Compares the mips MipGenerator builds against the CPU mips of Mipmap for
+// every format MipGenerator::IsFormatFilterable() accepts. These tests need a
+// GPU and the compiled GenerateMips shader in the build directory, they are
+// skipped when either is missing rather than reported as passing.
+
+#if defined(PPX_D3D12)
+const grfx::Api kApi        = grfx::API_DX_12_0;
+const char*     kShaderPath = "assets/basic/shaders/dxil/GenerateMips.cs.dxil";
+#else
+const grfx::Api kApi        = grfx::API_VK_1_1;
+const char*     kShaderPath = "assets/basic/shaders/spv/GenerateMips.cs.spv";
+#endif
+
+void WritePixel(Bitmap& bitmap, uint32_t x, uint32_t y, const float* pRGBA)
+{
+    const uint32_t channelCount = bitmap.GetChannelCount();
+    switch (Bitmap::ChannelDataType(bitmap.GetFormat())) {
+        default: break;
+        case Bitmap::DATA_TYPE_UINT8: {
+            uint8_t* pPixel = bitmap.GetPixel8u(x, y);
+            for (uint32_t c = 0; c < channelCount; ++c) {
+                pPixel[c] = static_cast<uint8_t>(std::lround(pRGBA[c] * 255.0f));
+            }
+        } break;
+        case Bitmap::DATA_TYPE_UINT16: {
+            uint16_t* pPixel = bitmap.GetPixel16u(x, y);
+            for (uint32_t c = 0; c < channelCount; ++c) {
+                pPixel[c] = static_cast<uint16_t>(std::lround(pRGBA[c] * 65535.0f));
+            }
+        } break;
+        case Bitmap::DATA_TYPE_FLOAT: {
+            float* pPixel = bitmap.GetPixel32f(x, y);
+            for (uint32_t c = 0; c < channelCount; ++c) {
+                pPixel[c] = pRGBA[c];
+            }
+        } break;
+        case Bitmap::DATA_TYPE_FLOAT16: {
+            ConvertFloatToHalf(pRGBA, reinterpret_cast<uint16_t*>(bitmap.GetPixelAddress(x, y)), channelCount);
+        } break;
+    }
+}
+
+class MipGeneratorTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        auto bytecode = fs::load_file(kShaderPath);
+        if (!bytecode.has_value()) {
+            GTEST_SKIP() << "GenerateMips shader not found at " << kShaderPath;
+        }
+
+        grfx::InstanceCreateInfo instanceCreateInfo = {};
+        instanceCreateInfo.api                      = kApi;
+        instanceCreateInfo.enableSwapchain          = false;
+        instanceCreateInfo.applicationName          = "mip_generator_test";
+        if (Failed(grfx::CreateInstance(&instanceCreateInfo, &mInstance))) {
+            GTEST_SKIP() << "no graphics instance available";
+        }
+
+        grfx::GpuPtr gpu;
+        if ((mInstance->GetGpuCount() == 0) || Failed(mInstance->GetGpu(0, &gpu))) {
+            GTEST_SKIP() << "no GPU available";
+        }
+
+        grfx::DeviceCreateInfo deviceCreateInfo = {};
+        deviceCreateInfo.pGpu                   = gpu;
+        deviceCreateInfo.graphicsQueueCount     = 1;
+        ASSERT_EQ(mInstance->CreateDevice(&deviceCreateInfo, &mDevice), ppx::SUCCESS);
+        mQueue = mDevice->GetGraphicsQueue();
+
+        ASSERT_EQ(mMipGenerator.Initialize(mDevice, bytecode.value()), ppx::SUCCESS);
+    }
+
+    void TearDown() override
+    {
+        mMipGenerator.Shutdown();
+        if (mDevice) {
+            mInstance->DestroyDevice(mDevice);
+        }
+        if (mInstance) {
+            grfx::DestroyInstance(mInstance);
+        }
+    }
+
+    // Copies one mip level of pTexture to the CPU
+    Result ReadLevel(grfx::Texture* pTexture, uint32_t level, Bitmap::Format format, Bitmap* pBitmap)
+    {
+        const uint32_t width  = std::max(pTexture->GetWidth() >> level, 1u);
+        const uint32_t height = std::max(pTexture->GetHeight() >> level, 1u);
+
+        // Row pitch can be aligned up to 256 bytes by the API
+        const uint64_t rowSize = static_cast<uint64_t>(width) * Bitmap::FormatSize(format);
+        const uint64_t size    = (rowSize + 255) / 256 * 256 * height;
+
+        grfx::BufferCreateInfo bufferCreateInfo      = {};
+        bufferCreateInfo.size                        = size;
+        bufferCreateInfo.initialState                = grfx::RESOURCE_STATE_COPY_DST;
+        bufferCreateInfo.usageFlags.bits.transferDst = 1;
+        bufferCreateInfo.memoryUsage                 = grfx::MEMORY_USAGE_GPU_TO_CPU;
+
+        grfx::BufferPtr buffer;
+        Result          ppxres = mDevice->CreateBuffer(&bufferCreateInfo, &buffer);
+        if (Failed(ppxres)) {
+            return ppxres;
+        }
+
+        grfx::CommandBufferPtr cmdBuffer;
+        ppxres = mQueue->CreateCommandBuffer(&cmdBuffer);
+        if (Failed(ppxres)) {
+            mDevice->DestroyBuffer(buffer);
+            return ppxres;
+        }
+
+        grfx::ImageToBufferOutputPitch pitch = {};
+        ppxres                               = cmdBuffer->Begin();
+        if (Success(ppxres)) {
+            grfx::Image* pImage = pTexture->GetImage();
+            cmdBuffer->TransitionImageLayout(pImage, level, 1, 0, 1, grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_COPY_SRC);
+
+            grfx::ImageToBufferCopyInfo copyInfo = {};
+            copyInfo.srcImage.mipLevel           = level;
+            copyInfo.extent                      = {width, height, 1};
+            pitch                                = cmdBuffer->CopyImageToBuffer(&copyInfo, pImage, buffer);
+
+            cmdBuffer->TransitionImageLayout(pImage, level, 1, 0, 1, grfx::RESOURCE_STATE_COPY_SRC, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+            ppxres = cmdBuffer->End();
+        }
+
+        if (Success(ppxres)) {
+            grfx::SubmitInfo submitInfo   = {};
+            submitInfo.commandBufferCount = 1;
+            submitInfo.ppCommandBuffers   = &cmdBuffer;
+
+            ppxres = mQueue->Submit(&submitInfo);
+            if (Success(ppxres)) {
+                ppxres = mQueue->WaitIdle();
+            }
+        }
+
+        void* pMapped = nullptr;
+        if (Success(ppxres)) {
+            ppxres = buffer->MapMemory(0, &pMapped);
+        }
+        if (Success(ppxres)) {
+            Bitmap mapped = Bitmap::Create(width, height, format, pitch.rowPitch, static_cast<char*>(pMapped), &ppxres);
+            if (Success(ppxres)) {
+                ppxres = Bitmap::Create(width, height, format, pBitmap);
+            }
+            if (Success(ppxres)) {
+                ppxres = mapped.GetView().CopyTo(pBitmap->GetView());
+            }
+            buffer->UnmapMemory();
+        }
+
+        mQueue->DestroyCommandBuffer(cmdBuffer);
+        mDevice->DestroyBuffer(buffer);
+
+        return ppxres;
+    }
+
+    void CompareWithCpuMips(Bitmap::Format format, uint32_t width, uint32_t height)
+    {
+        // Formats outside the core storage image set are optional
+        if (!mMipGenerator.IsFormatSupported(grfx_util::ToGrfxFormat(format))) {
+            GTEST_SKIP() << "device cannot write format " << static_cast<uint32_t>(format) << " as a storage image";
+        }
+
+        Bitmap bitmap = Bitmap::Create(width, height, format);
+        ASSERT_TRUE(bitmap.IsOk());
+
+        // Values stay in [0, 1], the range images are compared in
+        for (uint32_t y = 0; y < height; ++y) {
+            for (uint32_t x = 0; x < width; ++x) {
+                float rgba[4] = {};
+                rgba[0]       = static_cast<float>(x) / static_cast<float>(width);
+                rgba[1]       = static_cast<float>(y) / static_cast<float>(height);
+                rgba[2]       = static_cast<float>((x * 7 + y * 3) % 16) / 15.0f;
+                rgba[3]       = 1.0f - rgba[0] * 0.5f;
+                WritePixel(bitmap, x, y, rgba);
+            }
+        }
+
+        const uint32_t levelCount = Mipmap::CalculateLevelCount(width, height);
+        Mipmap         cpuMips(bitmap.GetView(), levelCount);
+        ASSERT_TRUE(cpuMips.IsOk());
+
+        grfx::TexturePtr texture;
+        const auto       options = grfx_util::TextureOptions().MipLevelCount(levelCount).GpuMipGenerator(&mMipGenerator);
+        ASSERT_EQ(grfx_util::CreateTextureFromBitmap(mQueue, &bitmap, &texture, options), ppx::SUCCESS);
+
+        ImageCompareOptions compareOptions = {};
+        compareOptions.threshold           = 1;
+        compareOptions.compareAlpha        = true;
+        compareOptions.computeSSIM         = false;
+
+        for (uint32_t level = 1; level < levelCount; ++level) {
+            Bitmap gpuMip;
+            ASSERT_EQ(ReadLevel(texture, level, format, &gpuMip), ppx::SUCCESS);
+
+            ImageCompareResult result;
+            ASSERT_EQ(CompareImages(*cpuMips.GetMip(level), gpuMip, compareOptions, &result), ppx::SUCCESS);
+            EXPECT_EQ(result.differentPixelCount, 0u) << "format " << static_cast<uint32_t>(format) << " level " << level << " max difference " << result.maxDifference;
+        }
+
+        mDevice->DestroyTexture(texture);
+    }
+
+protected:
+    grfx::InstancePtr mInstance;
+    grfx::DevicePtr   mDevice;
+    grfx::QueuePtr    mQueue;
+    MipGenerator      mMipGenerator;
+};
+
+} // namespace
+
+TEST(MipGeneratorFormatTest, SupportedFormatsHaveBitmapFormats)
+{
+    // The CPU fallback and the comparisons below need a bitmap format for
+    // every format the generator writes.
+    const Bitmap::Format formats[] = {
+        Bitmap::FORMAT_R_UINT8,
+        Bitmap::FORMAT_RG_UINT8,
+        Bitmap::FORMAT_RGBA_UINT8,
+        Bitmap::FORMAT_RGBA_UINT16,
+        Bitmap::FORMAT_R_FLOAT16,
+        Bitmap::FORMAT_RG_FLOAT16,
+        Bitmap::FORMAT_RGBA_FLOAT16,
+        Bitmap::FORMAT_R_FLOAT,
+        Bitmap::FORMAT_RG_FLOAT,
+        Bitmap::FORMAT_RGBA_FLOAT,
+    };
+    for (Bitmap::Format format : formats) {
+        EXPECT_TRUE(MipGenerator::IsFormatFilterable(grfx_util::ToGrfxFormat(format))) << static_cast<uint32_t>(format);
+    }
+    EXPECT_FALSE(MipGenerator::IsFormatFilterable(grfx::FORMAT_R8G8B8A8_SRGB));
+    EXPECT_FALSE(MipGenerator::IsFormatFilterable(grfx::FORMAT_R8G8B8_UNORM));
+    EXPECT_FALSE(MipGenerator::IsFormatFilterable(grfx::FORMAT_BC1_RGBA_UNORM));
+}
+
+TEST_F(MipGeneratorTest, DefaultGeneratorIsUsed)
+{
+    Bitmap bitmap = Bitmap::Create(64, 32, Bitmap::FORMAT_RGBA_UINT8);
+    ASSERT_TRUE(bitmap.IsOk());
+    bitmap.Fill<uint8_t>(64, 128, 192, 255);
+
+    // Only textures whose mips are built on the GPU get storage usage
+    auto hasGpuMips = [&](const grfx_util::TextureOptions& options) -> bool {
+        grfx::TexturePtr texture;
+        EXPECT_EQ(grfx_util::CreateTextureFromBitmap(mQueue, &bitmap, &texture, options), ppx::SUCCESS);
+        if (!texture) {
+            return false;
+        }
+        const bool storage = texture->GetImage()->GetUsageFlags().bits.storage;
+        mDevice->DestroyTexture(texture);
+        return storage;
+    };
+
+    const auto options = grfx_util::TextureOptions().MipLevelCount(PPX_REMAINING_MIP_LEVELS);
+    EXPECT_FALSE(hasGpuMips(options));
+
+    mDevice->SetDefaultMipGenerator(&mMipGenerator);
+    EXPECT_TRUE(hasGpuMips(options));
+    EXPECT_FALSE(hasGpuMips(grfx_util::TextureOptions(options).GpuMips(false)));
+    EXPECT_FALSE(hasGpuMips(grfx_util::TextureOptions(options).MipLevelCount(1)));
+    mDevice->SetDefaultMipGenerator(nullptr);
+}
+
+TEST_F(MipGeneratorTest, R8MatchesCpu)
+{
+    CompareWithCpuMips(Bitmap::FORMAT_R_UINT8, 64, 32);
+}
+
+TEST_F(MipGeneratorTest, RG8MatchesCpu)
+{
+    CompareWithCpuMips(Bitmap::FORMAT_RG_UINT8, 64, 32);
+}
+
+TEST_F(MipGeneratorTest, RGBA8MatchesCpu)
+{
+    CompareWithCpuMips(Bitmap::FORMAT_RGBA_UINT8, 64, 32);
+}
+
+TEST_F(MipGeneratorTest, RGBA16MatchesCpu)
+{
+    CompareWithCpuMips(Bitmap::FORMAT_RGBA_UINT16, 64, 32);
+}
+
+TEST_F(MipGeneratorTest, R16FloatMatchesCpu)
+{
+    CompareWithCpuMips(Bitmap::FORMAT_R_FLOAT16, 64, 32);
+}
+
+TEST_F(MipGeneratorTest, RG16FloatMatchesCpu)
+{
+    CompareWithCpuMips(Bitmap::FORMAT_RG_FLOAT16, 64, 32);
+}
+
+TEST_F(MipGeneratorTest, RGBA16FloatMatchesCpu)
+{
+    CompareWithCpuMips(Bitmap::FORMAT_RGBA_FLOAT16, 64, 32);
+}
+
+TEST_F(MipGeneratorTest, R32FloatMatchesCpu)
+{
+    CompareWithCpuMips(Bitmap::FORMAT_R_FLOAT, 64, 32);
+}
+
+TEST_F(MipGeneratorTest, RG32FloatMatchesCpu)
+{
+    CompareWithCpuMips(Bitmap::FORMAT_RG_FLOAT, 64, 32);
+}
+
+TEST_F(MipGeneratorTest, RGBA32FloatMatchesCpu)
+{
+    CompareWithCpuMips(Bitmap::FORMAT_RGBA_FLOAT, 64, 32);
+}
+
+TEST_F(MipGeneratorTest, OddSizeMatchesCpu)
+{
+    // Odd sizes use partial texel weights on the GPU
+    CompareWithCpuMips(Bitmap::FORMAT_RGBA_UINT8, 37, 19);
+}
+
+} // namespace ppx
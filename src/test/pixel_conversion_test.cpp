@@ -0,0 +1,204 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include "ppx/bitmap.h"
+#include "ppx/pixel_conversion.h"
+#include "ppx/util.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace ppx {
+namespace {
+
+// Odd count so that every kernel also runs its scalar tail
+const size_t kPixelCount = 37;
+
+std::vector<uint8_t> MakeBytes(size_t count)
+{
+    std::vector<uint8_t> bytes(count);
+    for (size_t i = 0; i < count; ++i) {
+        bytes[i] = static_cast<uint8_t>(i * 7 + 3);
+    }
+    return bytes;
+}
+
+TEST(PixelConversionTest, SwizzleRB8)
+{
+    std::vector<uint8_t> src = MakeBytes(kPixelCount * 4);
+    std::vector<uint8_t> dst(src.size());
+    SwizzleRB8(src.data(), dst.data(), kPixelCount);
+    for (size_t i = 0; i < kPixelCount; ++i) {
+        EXPECT_EQ(dst[4 * i + 0], src[4 * i + 2]);
+        EXPECT_EQ(dst[4 * i + 1], src[4 * i + 1]);
+        EXPECT_EQ(dst[4 * i + 2], src[4 * i + 0]);
+        EXPECT_EQ(dst[4 * i + 3], src[4 * i + 3]);
+    }
+
+    // In place twice is the identity
+    SwizzleRB8(dst.data(), dst.data(), kPixelCount);
+    EXPECT_EQ(dst, src);
+}
+
+TEST(PixelConversionTest, PackAndExpandRGB8)
+{
+    std::vector<uint8_t> rgba = MakeBytes(kPixelCount * 4);
+    std::vector<uint8_t> rgb(kPixelCount * 3);
+    PackRGBA8ToRGB8(rgba.data(), rgb.data(), kPixelCount);
+    for (size_t i = 0; i < kPixelCount; ++i) {
+        EXPECT_EQ(rgb[3 * i + 0], rgba[4 * i + 0]);
+        EXPECT_EQ(rgb[3 * i + 2], rgba[4 * i + 2]);
+    }
+
+    std::vector<uint8_t> expanded(kPixelCount * 4);
+    ExpandRGB8ToRGBA8(rgb.data(), expanded.data(), kPixelCount, 0x42);
+    for (size_t i = 0; i < kPixelCount; ++i) {
+        EXPECT_EQ(expanded[4 * i + 1], rgba[4 * i + 1]);
+        EXPECT_EQ(expanded[4 * i + 3], 0x42);
+    }
+
+    // BGRA to RGB in place
+    std::vector<uint8_t> bgra = rgba;
+    PackRGBA8ToRGB8(bgra.data(), bgra.data(), kPixelCount, /* swapRB= */ true);
+    for (size_t i = 0; i < kPixelCount; ++i) {
+        EXPECT_EQ(bgra[3 * i + 0], rgba[4 * i + 2]);
+        EXPECT_EQ(bgra[3 * i + 1], rgba[4 * i + 1]);
+        EXPECT_EQ(bgra[3 * i + 2], rgba[4 * i + 0]);
+    }
+}
+
+TEST(PixelConversionTest, HalfToFloatMatchesScalarForAllValues)
+{
+    std::vector<uint16_t> halves(65536);
+    for (size_t i = 0; i < halves.size(); ++i) {
+        halves[i] = static_cast<uint16_t>(i);
+    }
+    std::vector<float> floats(halves.size());
+    ConvertHalfToFloat(halves.data(), floats.data(), halves.size());
+    for (size_t i = 0; i < halves.size(); ++i) {
+        float expected = HalfToFloat(halves[i]);
+        if (std::isnan(expected)) {
+            EXPECT_TRUE(std::isnan(floats[i])) << i;
+        }
+        else {
+            EXPECT_EQ(std::memcmp(&expected, &floats[i], sizeof(float)), 0) << i;
+        }
+    }
+}
+
+TEST(PixelConversionTest, FloatToHalfMatchesScalar)
+{
+    std::vector<float> floats = {
+        0.0f,
+        -0.0f,
+        1.0f,
+        -2.5f,
+        65504.0f,
+        65519.0f,
+        65520.0f,
+        1.0e10f,
+        -1.0e10f,
+        std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::quiet_NaN(),
+        6.103515625e-05f, // Smallest normal
+        5.9604645e-08f,   // Smallest denormal
+        2.9802322e-08f,   // Halfway to the smallest denormal
+        3.0e-08f,
+        1.0e-10f,
+        1.00048828125f, // Halfway, rounds to even
+        1.00146484375f, // Halfway, rounds to even
+    };
+    for (uint32_t i = 0; i < 1000; ++i) {
+        floats.push_back(std::ldexp(static_cast<float>(i * 2654435761u % 100000) / 100000.0f, static_cast<int>(i % 48) - 30));
+    }
+
+    std::vector<uint16_t> halves(floats.size());
+    ConvertFloatToHalf(floats.data(), halves.data(), floats.size());
+    for (size_t i = 0; i < floats.size(); ++i) {
+        EXPECT_EQ(halves[i], FloatToHalf(floats[i])) << floats[i];
+    }
+}
+
+TEST(PixelConversionTest, Unorm)
+{
+    std::vector<uint8_t> bytes(256 + 5);
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<uint8_t>(i);
+    }
+    std::vector<float> floats(bytes.size());
+    ConvertUnorm8ToFloat(bytes.data(), floats.data(), bytes.size());
+    EXPECT_EQ(floats[0], 0.0f);
+    EXPECT_EQ(floats[255], 1.0f);
+    EXPECT_NEAR(floats[128], 128.0f / 255.0f, 1e-7f);
+
+    std::vector<uint8_t> roundTrip(bytes.size());
+    ConvertFloatToUnorm8(floats.data(), roundTrip.data(), floats.size());
+    EXPECT_EQ(roundTrip, bytes);
+
+    std::vector<float>   outOfRange = {-1.0f, 2.0f, std::numeric_limits<float>::quiet_NaN(), 0.5f};
+    std::vector<uint8_t> clamped(outOfRange.size());
+    ConvertFloatToUnorm8(outOfRange.data(), clamped.data(), outOfRange.size());
+    EXPECT_EQ(clamped[0], 0);
+    EXPECT_EQ(clamped[1], 255);
+    EXPECT_EQ(clamped[2], 0);
+    EXPECT_EQ(clamped[3], 128);
+
+    std::vector<uint16_t> shorts = {0, 1, 32768, 65535, 12345, 54321, 7, 65534, 2};
+    std::vector<float>    shortFloats(shorts.size());
+    std::vector<uint16_t> shortRoundTrip(shorts.size());
+    ConvertUnorm16ToFloat(shorts.data(), shortFloats.data(), shorts.size());
+    ConvertFloatToUnorm16(shortFloats.data(), shortRoundTrip.data(), shorts.size());
+    EXPECT_EQ(shortFloats[3], 1.0f);
+    EXPECT_EQ(shortRoundTrip, shorts);
+}
+
+TEST(PixelConversionTest, SRGB)
+{
+    std::vector<uint8_t> bytes(256 * 4);
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<uint8_t>(i / 4);
+    }
+    std::vector<float> linear(bytes.size());
+    DecodeSRGB8(bytes.data(), linear.data(), 256, 4);
+    EXPECT_NEAR(linear[4 * 128 + 0], SRGBToLinear(128.0f / 255.0f), 1e-6f);
+    EXPECT_NEAR(linear[4 * 128 + 3], 128.0f / 255.0f, 1e-6f);
+
+    std::vector<uint8_t> encoded(bytes.size());
+    EncodeSRGB8(linear.data(), encoded.data(), 256, 4);
+    EXPECT_EQ(encoded, bytes);
+}
+
+TEST(PixelConversionTest, FillPixels)
+{
+    const uint8_t        pixel[3] = {1, 2, 3};
+    std::vector<uint8_t> dst(kPixelCount * 3);
+    FillPixels(dst.data(), pixel, 3, kPixelCount);
+    for (size_t i = 0; i < kPixelCount; ++i) {
+        EXPECT_EQ(dst[3 * i + 0], 1);
+        EXPECT_EQ(dst[3 * i + 2], 3);
+    }
+
+    Bitmap bitmap = Bitmap::Create(5, 3, Bitmap::FORMAT_RG_FLOAT16);
+    bitmap.Fill(0.5f, -2.0f, 0.0f, 0.0f);
+    const uint16_t* pPixel = reinterpret_cast<const uint16_t*>(bitmap.GetPixelAddress(4, 2));
+    EXPECT_EQ(pPixel[0], FloatToHalf(0.5f));
+    EXPECT_EQ(pPixel[1], FloatToHalf(-2.0f));
+}
+
+} // namespace
+} // namespace ppx
@@ -216,6 +216,35 @@ TEST(PPMExport, AlphaIsIgnored)
     EXPECT_EQ(data->texels, wantTexels);
 }
 
+TEST(PPMExport, ExportBGRAWideRows)
+{
+    // Wide enough to exercise the vectorized path and its scalar tail
+    const uint32_t             width  = 21;
+    const uint32_t             height = 2;
+    std::vector<unsigned char> texels(width * height * 4);
+    std::vector<unsigned char> wantTexels;
+    for (uint32_t i = 0; i < width * height; ++i) {
+        texels[4 * i + 0] = static_cast<unsigned char>(3 * i + 2);
+        texels[4 * i + 1] = static_cast<unsigned char>(3 * i + 1);
+        texels[4 * i + 2] = static_cast<unsigned char>(3 * i + 0);
+        texels[4 * i + 3] = 255;
+        wantTexels.push_back(static_cast<unsigned char>(3 * i + 0));
+        wantTexels.push_back(static_cast<unsigned char>(3 * i + 1));
+        wantTexels.push_back(static_cast<unsigned char>(3 * i + 2));
+    }
+
+    std::stringstream buffer(std::stringstream::out | std::stringstream::in | std::ios::binary);
+    Result            res = ExportToPPM(buffer, grfx::FORMAT_B8G8R8A8_UNORM, texels.data(), width, height, width * 4);
+    EXPECT_EQ(res, 0);
+
+    auto data = PPMData::FromStream(std::move(buffer));
+    ASSERT_TRUE(data.has_value());
+
+    EXPECT_EQ(data->width, width);
+    EXPECT_EQ(data->height, height);
+    EXPECT_EQ(data->texels, wantTexels);
+}
+
 TEST(PPMExport, RowStrideLargerThanRowBytes)
 {
     std::stringstream          buffer(std::stringstream::out | std::stringstream::in | std::ios::binary);
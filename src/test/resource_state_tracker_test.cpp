@@ -0,0 +1,307 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include "ppx/grfx/grfx_buffer.h"
+#include "ppx/grfx/grfx_image.h"
+#include "ppx/grfx/grfx_resource_state_tracker.h"
+
+namespace ppx {
+namespace {
+
+// Images and buffers without API objects, the tracker only reads their
+// create info.
+class TestImage
+    : public grfx::Image
+{
+public:
+    TestImage(uint32_t mipLevelCount, uint32_t arrayLayerCount, grfx::ResourceState initialState)
+    {
+        mCreateInfo.mipLevelCount   = mipLevelCount;
+        mCreateInfo.arrayLayerCount = arrayLayerCount;
+        mCreateInfo.initialState    = initialState;
+    }
+
+    virtual Result MapMemory(uint64_t offset, void** ppMappedAddress) override { return ppx::ERROR_FAILED; }
+    virtual void   UnmapMemory() override {}
+
+protected:
+    virtual Result CreateApiObjects(const grfx::ImageCreateInfo* pCreateInfo) override { return ppx::SUCCESS; }
+    virtual void   DestroyApiObjects() override {}
+};
+
+class TestBuffer
+    : public grfx::Buffer
+{
+public:
+    TestBuffer(grfx::ResourceState initialState)
+    {
+        mCreateInfo.initialState = initialState;
+    }
+
+    virtual Result MapMemory(uint64_t offset, void** ppMappedAddress) override { return ppx::ERROR_FAILED; }
+    virtual void   UnmapMemory() override {}
+
+protected:
+    virtual Result CreateApiObjects(const grfx::BufferCreateInfo* pCreateInfo) override { return ppx::SUCCESS; }
+    virtual void   DestroyApiObjects() override {}
+};
+
+struct TakenBarriers
+{
+    std::vector<grfx::ImageBarrier>  images;
+    std::vector<grfx::BufferBarrier> buffers;
+};
+
+TakenBarriers Take(grfx::ResourceStateTracker& tracker)
+{
+    TakenBarriers barriers;
+    tracker.TakePendingBarriers(&barriers.images, &barriers.buffers);
+    return barriers;
+}
+
+TEST(ResourceStateTrackerTest, IsUnorderedAccessBarrier)
+{
+    EXPECT_TRUE(grfx::IsUnorderedAccessBarrier(grfx::RESOURCE_STATE_UNORDERED_ACCESS, grfx::RESOURCE_STATE_UNORDERED_ACCESS));
+    EXPECT_TRUE(grfx::IsUnorderedAccessBarrier(grfx::RESOURCE_STATE_GENERAL, grfx::RESOURCE_STATE_GENERAL));
+    EXPECT_FALSE(grfx::IsUnorderedAccessBarrier(grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_SHADER_RESOURCE));
+    EXPECT_FALSE(grfx::IsUnorderedAccessBarrier(grfx::RESOURCE_STATE_SHADER_RESOURCE, grfx::RESOURCE_STATE_UNORDERED_ACCESS));
+    EXPECT_FALSE(grfx::IsUnorderedAccessBarrier(grfx::RESOURCE_STATE_UNORDERED_ACCESS, grfx::RESOURCE_STATE_SHADER_RESOURCE));
+}
+
+TEST(ResourceStateTrackerTest, UntrackedResourcesAreInInitialState)
+{
+    TestImage                  image(2, 3, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    TestBuffer                 buffer(grfx::RESOURCE_STATE_VERTEX_BUFFER);
+    grfx::ResourceStateTracker tracker;
+
+    EXPECT_EQ(tracker.GetState(&image, 1, 2), grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    EXPECT_EQ(tracker.GetState(&buffer), grfx::RESOURCE_STATE_VERTEX_BUFFER);
+    EXPECT_FALSE(tracker.HasPendingBarriers());
+}
+
+TEST(ResourceStateTrackerTest, RequireCurrentStateDefersNothing)
+{
+    TestImage                  image(1, 1, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    TestBuffer                 buffer(grfx::RESOURCE_STATE_VERTEX_BUFFER);
+    grfx::ResourceStateTracker tracker;
+
+    tracker.Require(&image, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    tracker.Require(&buffer, grfx::RESOURCE_STATE_VERTEX_BUFFER);
+    EXPECT_FALSE(tracker.HasPendingBarriers());
+}
+
+TEST(ResourceStateTrackerTest, RequireFoldsIntoPendingBarrier)
+{
+    TestImage                  image(1, 1, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    TestBuffer                 buffer(grfx::RESOURCE_STATE_VERTEX_BUFFER);
+    grfx::ResourceStateTracker tracker;
+
+    tracker.Require(&image, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_RENDER_TARGET);
+    tracker.Require(&image, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_COPY_SRC);
+    tracker.Require(&buffer, grfx::RESOURCE_STATE_COPY_DST);
+    tracker.Require(&buffer, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+
+    TakenBarriers barriers = Take(tracker);
+    ASSERT_EQ(barriers.images.size(), 1);
+    EXPECT_EQ(barriers.images[0].beforeState, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    EXPECT_EQ(barriers.images[0].afterState, grfx::RESOURCE_STATE_COPY_SRC);
+    ASSERT_EQ(barriers.buffers.size(), 1);
+    EXPECT_EQ(barriers.buffers[0].beforeState, grfx::RESOURCE_STATE_VERTEX_BUFFER);
+    EXPECT_EQ(barriers.buffers[0].afterState, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+
+    EXPECT_EQ(tracker.GetState(&image, 0, 0), grfx::RESOURCE_STATE_COPY_SRC);
+    EXPECT_EQ(tracker.GetState(&buffer), grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    EXPECT_FALSE(tracker.HasPendingBarriers());
+}
+
+TEST(ResourceStateTrackerTest, UndoneTransitionIsDropped)
+{
+    TestImage                  image(1, 1, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    TestBuffer                 buffer(grfx::RESOURCE_STATE_VERTEX_BUFFER);
+    grfx::ResourceStateTracker tracker;
+
+    tracker.Require(&image, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_RENDER_TARGET);
+    tracker.Require(&image, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    tracker.Require(&buffer, grfx::RESOURCE_STATE_COPY_DST);
+    tracker.Require(&buffer, grfx::RESOURCE_STATE_VERTEX_BUFFER);
+
+    TakenBarriers barriers = Take(tracker);
+    EXPECT_TRUE(barriers.images.empty());
+    EXPECT_TRUE(barriers.buffers.empty());
+}
+
+TEST(ResourceStateTrackerTest, UnorderedAccessRequiredAgainDefersBarrier)
+{
+    TestImage                  image(1, 1, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    TestBuffer                 buffer(grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    grfx::ResourceStateTracker tracker;
+
+    tracker.Require(&image, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    tracker.Require(&buffer, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    EXPECT_TRUE(tracker.HasPendingBarriers());
+
+    TakenBarriers barriers = Take(tracker);
+    ASSERT_EQ(barriers.images.size(), 1);
+    EXPECT_EQ(barriers.images[0].beforeState, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    EXPECT_EQ(barriers.images[0].afterState, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    ASSERT_EQ(barriers.buffers.size(), 1);
+    EXPECT_EQ(barriers.buffers[0].beforeState, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    EXPECT_EQ(barriers.buffers[0].afterState, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+}
+
+TEST(ResourceStateTrackerTest, GeneralRequiredAgainDefersBarrier)
+{
+    TestImage                  image(1, 1, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    grfx::ResourceStateTracker tracker;
+
+    // The first require transitions, the second one after the dispatch
+    // writing the image orders those writes.
+    tracker.Require(&image, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_GENERAL);
+    TakenBarriers barriers = Take(tracker);
+    ASSERT_EQ(barriers.images.size(), 1);
+    EXPECT_EQ(barriers.images[0].beforeState, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    EXPECT_EQ(barriers.images[0].afterState, grfx::RESOURCE_STATE_GENERAL);
+
+    tracker.Require(&image, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_GENERAL);
+    barriers = Take(tracker);
+    ASSERT_EQ(barriers.images.size(), 1);
+    EXPECT_EQ(barriers.images[0].beforeState, grfx::RESOURCE_STATE_GENERAL);
+    EXPECT_EQ(barriers.images[0].afterState, grfx::RESOURCE_STATE_GENERAL);
+}
+
+TEST(ResourceStateTrackerTest, UnorderedAccessRoundTripKeepsBarrier)
+{
+    TestBuffer                 buffer(grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    grfx::ResourceStateTracker tracker;
+
+    // Leaving and returning to UNORDERED_ACCESS before the flush still
+    // needs the writes made before the require ordered.
+    tracker.Require(&buffer, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    tracker.Require(&buffer, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+
+    TakenBarriers barriers = Take(tracker);
+    ASSERT_EQ(barriers.buffers.size(), 1);
+    EXPECT_EQ(barriers.buffers[0].beforeState, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    EXPECT_EQ(barriers.buffers[0].afterState, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+}
+
+TEST(ResourceStateTrackerTest, UnorderedAccessRequiredTwiceDefersOneBarrier)
+{
+    TestImage                  image(4, 1, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    grfx::ResourceStateTracker tracker;
+
+    tracker.Require(&image, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+    tracker.Require(&image, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_UNORDERED_ACCESS);
+
+    TakenBarriers barriers = Take(tracker);
+    ASSERT_EQ(barriers.images.size(), 1);
+    EXPECT_EQ(barriers.images[0].mipLevel, 0);
+    EXPECT_EQ(barriers.images[0].mipLevelCount, 4);
+}
+
+TEST(ResourceStateTrackerTest, WholeImageMergesIntoOneBarrier)
+{
+    TestImage                  image(4, 6, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    grfx::ResourceStateTracker tracker;
+
+    tracker.Require(&image, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_COPY_DST);
+
+    TakenBarriers barriers = Take(tracker);
+    ASSERT_EQ(barriers.images.size(), 1);
+    EXPECT_EQ(barriers.images[0].mipLevel, 0);
+    EXPECT_EQ(barriers.images[0].mipLevelCount, 4);
+    EXPECT_EQ(barriers.images[0].arrayLayer, 0);
+    EXPECT_EQ(barriers.images[0].arrayLayerCount, 6);
+}
+
+TEST(ResourceStateTrackerTest, SubresourceRangesMerge)
+{
+    TestImage                  image(4, 2, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    grfx::ResourceStateTracker tracker;
+
+    // Mip 1 is already in COPY_DST, the remaining mips of the range split
+    // into mip 0 and mips 2-3, each merged across both layers.
+    tracker.SetState(&image, 1, 1, 0, PPX_REMAINING_ARRAY_LAYERS, grfx::RESOURCE_STATE_COPY_DST);
+    tracker.Require(&image, 0, PPX_REMAINING_MIP_LEVELS, 0, PPX_REMAINING_ARRAY_LAYERS, grfx::RESOURCE_STATE_COPY_DST);
+
+    TakenBarriers barriers = Take(tracker);
+    ASSERT_EQ(barriers.images.size(), 2);
+    EXPECT_EQ(barriers.images[0].mipLevel, 0);
+    EXPECT_EQ(barriers.images[0].mipLevelCount, 1);
+    EXPECT_EQ(barriers.images[0].arrayLayer, 0);
+    EXPECT_EQ(barriers.images[0].arrayLayerCount, 2);
+    EXPECT_EQ(barriers.images[1].mipLevel, 2);
+    EXPECT_EQ(barriers.images[1].mipLevelCount, 2);
+    EXPECT_EQ(barriers.images[1].arrayLayer, 0);
+    EXPECT_EQ(barriers.images[1].arrayLayerCount, 2);
+
+    for (uint32_t layer = 0; layer < 2; ++layer) {
+        for (uint32_t mip = 0; mip < 4; ++mip) {
+            EXPECT_EQ(tracker.GetState(&image, mip, layer), grfx::RESOURCE_STATE_COPY_DST);
+        }
+    }
+}
+
+TEST(ResourceStateTrackerTest, DifferentTransitionsDoNotMerge)
+{
+    TestImage                  image(2, 1, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    grfx::ResourceStateTracker tracker;
+
+    tracker.SetState(&image, 1, 1, 0, 1, grfx::RESOURCE_STATE_RENDER_TARGET);
+    tracker.Require(&image, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_COPY_SRC);
+
+    TakenBarriers barriers = Take(tracker);
+    ASSERT_EQ(barriers.images.size(), 2);
+    for (const grfx::ImageBarrier& barrier : barriers.images) {
+        EXPECT_EQ(barrier.mipLevelCount, 1);
+        EXPECT_EQ(barrier.afterState, grfx::RESOURCE_STATE_COPY_SRC);
+        EXPECT_EQ(barrier.beforeState, (barrier.mipLevel == 0) ? grfx::RESOURCE_STATE_SHADER_RESOURCE : grfx::RESOURCE_STATE_RENDER_TARGET);
+    }
+}
+
+TEST(ResourceStateTrackerTest, BarriersAreGroupedByImage)
+{
+    TestImage                  imageA(2, 1, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    TestImage                  imageB(2, 1, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    grfx::ResourceStateTracker tracker;
+
+    // Interleaved requires still merge per image
+    tracker.Require(&imageA, 0, 1, 0, 1, grfx::RESOURCE_STATE_COPY_DST);
+    tracker.Require(&imageB, 0, 1, 0, 1, grfx::RESOURCE_STATE_COPY_DST);
+    tracker.Require(&imageA, 1, 1, 0, 1, grfx::RESOURCE_STATE_COPY_DST);
+    tracker.Require(&imageB, 1, 1, 0, 1, grfx::RESOURCE_STATE_COPY_DST);
+
+    TakenBarriers barriers = Take(tracker);
+    ASSERT_EQ(barriers.images.size(), 2);
+    EXPECT_NE(barriers.images[0].pImage, barriers.images[1].pImage);
+    EXPECT_EQ(barriers.images[0].mipLevelCount, 2);
+    EXPECT_EQ(barriers.images[1].mipLevelCount, 2);
+}
+
+TEST(ResourceStateTrackerTest, ResetForgetsStates)
+{
+    TestImage                  image(1, 1, grfx::RESOURCE_STATE_SHADER_RESOURCE);
+    grfx::ResourceStateTracker tracker;
+
+    tracker.Require(&image, PPX_ALL_SUBRESOURCES, grfx::RESOURCE_STATE_COPY_DST);
+    tracker.Reset();
+
+    EXPECT_FALSE(tracker.HasPendingBarriers());
+    EXPECT_EQ(tracker.GetState(&image, 0, 0), grfx::RESOURCE_STATE_SHADER_RESOURCE);
+}
+
+} // namespace
+} // namespace ppx
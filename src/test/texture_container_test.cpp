@@ -0,0 +1,152 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include "ppx/texture_container.h"
+
+#include <cstring>
+#include <vector>
+
+namespace ppx {
+namespace {
+
+void WriteU32(std::vector<char>& data, size_t offset, uint32_t value)
+{
+    std::memcpy(data.data() + offset, &value, sizeof(value));
+}
+
+void WriteU64(std::vector<char>& data, size_t offset, uint64_t value)
+{
+    std::memcpy(data.data() + offset, &value, sizeof(value));
+}
+
+// Legacy DDS header with a FourCC pixel format and a full mip chain.
+std::vector<char> MakeDDS(uint32_t width, uint32_t height, uint32_t mipCount, const char* fourCC, size_t payloadSize)
+{
+    std::vector<char> data(128 + payloadSize, 0);
+    std::memcpy(data.data(), "DDS ", 4);
+    WriteU32(data, 4, 124);
+    WriteU32(data, 8, 0x1007 | 0x20000);
+    WriteU32(data, 12, height);
+    WriteU32(data, 16, width);
+    WriteU32(data, 28, mipCount);
+    WriteU32(data, 76, 32);
+    WriteU32(data, 80, 0x4);
+    std::memcpy(data.data() + 84, fourCC, 4);
+    return data;
+}
+
+TEST(TextureContainerTest, ParsesDDSWithMipChain)
+{
+    // BC1 8x8: 2x2 blocks, then 1x1 block for 4x4, 2x2 and 1x1.
+    std::vector<char> data = MakeDDS(8, 8, 4, "DXT1", 32 + 8 + 8 + 8);
+
+    TextureContainer container;
+    ASSERT_EQ(container.Parse(data.data(), data.size()), ppx::SUCCESS);
+    EXPECT_EQ(container.GetType(), TEXTURE_CONTAINER_TYPE_DDS);
+    EXPECT_EQ(container.GetFormat(), grfx::FORMAT_BC1_RGBA_UNORM);
+    EXPECT_EQ(container.GetWidth(), 8u);
+    EXPECT_EQ(container.GetHeight(), 8u);
+    ASSERT_EQ(container.GetLevelCount(), 4u);
+
+    EXPECT_EQ(container.GetLevel(0).rowStride, 16u);
+    EXPECT_EQ(container.GetLevel(0).rowCount, 2u);
+    EXPECT_EQ(container.GetLevel(0).offset, 128u);
+    EXPECT_EQ(container.GetLevel(0).size, 32u);
+    EXPECT_EQ(container.GetLevel(3).width, 1u);
+    EXPECT_EQ(container.GetLevel(3).offset, 128u + 48u);
+    EXPECT_EQ(container.GetLevel(3).size, 8u);
+    EXPECT_EQ(container.GetLevelData(1), data.data() + 160);
+}
+
+TEST(TextureContainerTest, ParsesDDSWithDX10Header)
+{
+    std::vector<char> data = MakeDDS(4, 4, 1, "DX10", 20 + 16);
+    WriteU32(data, 128, 98); // DXGI_FORMAT_BC7_UNORM
+    WriteU32(data, 132, 3);  // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+    WriteU32(data, 140, 1);
+
+    TextureContainer container;
+    ASSERT_EQ(container.Parse(data.data(), data.size()), ppx::SUCCESS);
+    EXPECT_EQ(container.GetFormat(), grfx::FORMAT_BC7_UNORM);
+    ASSERT_EQ(container.GetLevelCount(), 1u);
+    EXPECT_EQ(container.GetLevel(0).offset, 148u);
+    EXPECT_EQ(container.GetLevel(0).size, 16u);
+}
+
+TEST(TextureContainerTest, RejectsTruncatedDDS)
+{
+    std::vector<char> data = MakeDDS(8, 8, 4, "DXT1", 32 + 8);
+
+    TextureContainer container;
+    EXPECT_EQ(container.Parse(data.data(), data.size()), ppx::ERROR_BAD_DATA_SOURCE);
+    EXPECT_FALSE(container.IsOk());
+}
+
+TEST(TextureContainerTest, RejectsDDSCubeMap)
+{
+    std::vector<char> data = MakeDDS(4, 4, 1, "DXT1", 6 * 8);
+    WriteU32(data, 112, 0x200 | 0xFC00);
+
+    TextureContainer container;
+    EXPECT_EQ(container.Parse(data.data(), data.size()), ppx::ERROR_IMAGE_INVALID_FORMAT);
+}
+
+TEST(TextureContainerTest, ParsesKTX2WithSmallestLevelFirst)
+{
+    // RGBA8 4x2 with two levels: 32 bytes and 8 bytes. KTX2 stores the
+    // smallest level first in the file.
+    const uint8_t identifier[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+    std::vector<char> data(80 + 2 * 24 + 8 + 32, 0);
+    std::memcpy(data.data(), identifier, sizeof(identifier));
+    WriteU32(data, 12, 37); // VK_FORMAT_R8G8B8A8_UNORM
+    WriteU32(data, 16, 1);
+    WriteU32(data, 20, 4);
+    WriteU32(data, 24, 2);
+    WriteU32(data, 36, 1);
+    WriteU32(data, 40, 2);
+    WriteU64(data, 80, 136);
+    WriteU64(data, 88, 32);
+    WriteU64(data, 104, 128);
+    WriteU64(data, 112, 8);
+
+    TextureContainer container;
+    ASSERT_EQ(container.Parse(data.data(), data.size()), ppx::SUCCESS);
+    EXPECT_EQ(container.GetType(), TEXTURE_CONTAINER_TYPE_KTX2);
+    EXPECT_EQ(container.GetFormat(), grfx::FORMAT_R8G8B8A8_UNORM);
+    ASSERT_EQ(container.GetLevelCount(), 2u);
+    EXPECT_EQ(container.GetLevel(0).rowStride, 16u);
+    EXPECT_EQ(container.GetLevel(0).rowCount, 2u);
+    EXPECT_EQ(container.GetLevel(0).offset, 136u);
+    EXPECT_EQ(container.GetLevel(1).width, 2u);
+    EXPECT_EQ(container.GetLevel(1).height, 1u);
+    EXPECT_EQ(container.GetLevel(1).offset, 128u);
+
+    // Supercompressed payloads cannot be copied straight to the GPU.
+    WriteU32(data, 44, 1);
+    EXPECT_EQ(container.Parse(data.data(), data.size()), ppx::ERROR_IMAGE_INVALID_FORMAT);
+}
+
+TEST(TextureContainerTest, IsContainerFile)
+{
+    EXPECT_TRUE(TextureContainer::IsContainerFile("textures/box.dds"));
+    EXPECT_TRUE(TextureContainer::IsContainerFile("textures/box.KTX2"));
+    EXPECT_FALSE(TextureContainer::IsContainerFile("textures/box.ktx"));
+    EXPECT_FALSE(TextureContainer::IsContainerFile("textures/box.png"));
+}
+
+} // namespace
+} // namespace ppx
@@ -0,0 +1,174 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+
+#include "ppx/virtual_texture.h"
+
+#include <vector>
+
+namespace ppx {
+namespace {
+
+uint32_t MakeEntry(uint32_t slotX, uint32_t slotY, uint32_t level)
+{
+    return slotX | (slotY << 8) | (level << 16) | (1u << 24);
+}
+
+TEST(VirtualTextureTest, TileKeyRoundTrip)
+{
+    VirtualTextureTile tile = {3, 100, 2000};
+    VirtualTextureTile back = VirtualTextureTile::FromKey(tile.GetKey());
+    EXPECT_EQ(back.level, 3u);
+    EXPECT_EQ(back.x, 100u);
+    EXPECT_EQ(back.y, 2000u);
+
+    VirtualTextureTile parent = tile.GetParent();
+    EXPECT_EQ(parent.level, 4u);
+    EXPECT_EQ(parent.x, 50u);
+    EXPECT_EQ(parent.y, 1000u);
+}
+
+TEST(VirtualTextureTest, TileCacheEvictsLeastRecentlyUsed)
+{
+    VirtualTextureTileCache cache;
+    cache.SetCapacity(2);
+
+    cache.Insert(1, std::vector<uint8_t>(4, 1));
+    cache.Insert(2, std::vector<uint8_t>(4, 2));
+    ASSERT_NE(cache.Find(1), nullptr);
+
+    // 2 is now the least recently used
+    cache.Insert(3, std::vector<uint8_t>(4, 3));
+    EXPECT_EQ(cache.GetSize(), 2u);
+    EXPECT_TRUE(cache.Contains(1));
+    EXPECT_FALSE(cache.Contains(2));
+    EXPECT_TRUE(cache.Contains(3));
+
+    EXPECT_EQ(cache.Find(2), nullptr);
+    EXPECT_EQ((*cache.Find(3))[0], 3);
+    EXPECT_EQ(cache.GetHitCount(), 2u);
+    EXPECT_EQ(cache.GetMissCount(), 1u);
+
+    cache.SetCapacity(1);
+    EXPECT_EQ(cache.GetSize(), 1u);
+    EXPECT_TRUE(cache.Contains(3));
+}
+
+TEST(VirtualTextureTest, PageTableLevels)
+{
+    VirtualTexturePageTable pageTable;
+    EXPECT_EQ(pageTable.Initialize(3, 4, 2, 2), ppx::ERROR_INVALID_CREATE_ARGUMENT);
+    EXPECT_EQ(pageTable.Initialize(4, 4, 0, 2), ppx::ERROR_INVALID_CREATE_ARGUMENT);
+    ASSERT_EQ(pageTable.Initialize(8, 2, 2, 2), ppx::SUCCESS);
+
+    EXPECT_EQ(pageTable.GetLevelCount(), 4u);
+    EXPECT_EQ(pageTable.GetPageCountX(2), 2u);
+    EXPECT_EQ(pageTable.GetPageCountY(2), 1u);
+    EXPECT_EQ(pageTable.GetLevelOffset(1), 16u);
+    EXPECT_TRUE(pageTable.IsValid({3, 0, 0}));
+    EXPECT_FALSE(pageTable.IsValid({1, 0, 1}));
+    EXPECT_FALSE(pageTable.IsValid({4, 0, 0}));
+}
+
+TEST(VirtualTextureTest, PageTableEvictsOldestUnpinnedSlot)
+{
+    VirtualTexturePageTable pageTable;
+    ASSERT_EQ(pageTable.Initialize(4, 4, 2, 1), ppx::SUCCESS);
+
+    uint32_t slotX = 0;
+    uint32_t slotY = 0;
+    ASSERT_TRUE(pageTable.Allocate({2, 0, 0}, 1, true, &slotX, &slotY));
+    ASSERT_TRUE(pageTable.Allocate({0, 0, 0}, 1, false, &slotX, &slotY));
+    EXPECT_EQ(slotX, 1u);
+    EXPECT_EQ(pageTable.GetResidentCount(), 2u);
+
+    // Both slots were used during frame 1
+    EXPECT_FALSE(pageTable.Allocate({0, 1, 0}, 1, false, &slotX, &slotY));
+
+    // The pinned root survives, the other tile is replaced
+    ASSERT_TRUE(pageTable.Allocate({0, 1, 0}, 2, false, &slotX, &slotY));
+    EXPECT_EQ(slotX, 1u);
+    EXPECT_TRUE(pageTable.IsResident({2, 0, 0}));
+    EXPECT_FALSE(pageTable.IsResident({0, 0, 0}));
+    EXPECT_TRUE(pageTable.IsResident({0, 1, 0}));
+
+    // Touching keeps a tile alive for the frame
+    EXPECT_TRUE(pageTable.Touch({0, 1, 0}, 3));
+    EXPECT_FALSE(pageTable.Allocate({0, 2, 0}, 3, false, &slotX, &slotY));
+    EXPECT_FALSE(pageTable.Touch({0, 2, 0}, 3));
+}
+
+TEST(VirtualTextureTest, PageTableEntriesFallBackToAncestor)
+{
+    VirtualTexturePageTable pageTable;
+    ASSERT_EQ(pageTable.Initialize(4, 4, 4, 1), ppx::SUCCESS);
+    EXPECT_TRUE(pageTable.IsDirty());
+
+    uint32_t slotX = 0;
+    uint32_t slotY = 0;
+    ASSERT_TRUE(pageTable.Allocate({2, 0, 0}, 1, true, &slotX, &slotY));
+    ASSERT_TRUE(pageTable.Allocate({1, 1, 0}, 1, false, &slotX, &slotY));
+    ASSERT_TRUE(pageTable.Allocate({0, 3, 0}, 1, false, &slotX, &slotY));
+
+    std::vector<uint32_t> entries;
+    pageTable.BuildEntries(entries);
+    ASSERT_EQ(entries.size(), 16u + 4u + 1u);
+
+    const uint32_t* pLevel0 = entries.data() + pageTable.GetLevelOffset(0);
+    const uint32_t* pLevel1 = entries.data() + pageTable.GetLevelOffset(1);
+    EXPECT_EQ(entries[pageTable.GetLevelOffset(2)], MakeEntry(0, 0, 2));
+    EXPECT_EQ(pLevel1[0], MakeEntry(0, 0, 2));
+    EXPECT_EQ(pLevel1[1], MakeEntry(1, 0, 1));
+    EXPECT_EQ(pLevel0[0], MakeEntry(0, 0, 2));
+    EXPECT_EQ(pLevel0[2], MakeEntry(1, 0, 1));
+    EXPECT_EQ(pLevel0[3], MakeEntry(2, 0, 0));
+    EXPECT_EQ(pLevel0[3 * 4 + 3], MakeEntry(0, 0, 2));
+}
+
+TEST(VirtualTextureTest, MipmapTileSourceClampsBorder)
+{
+    Mipmap mipmap(4, 4, Bitmap::FORMAT_RGBA_UINT8, 2);
+    ASSERT_TRUE(mipmap.IsOk());
+    Bitmap* pMip = mipmap.GetMip(0);
+    for (uint32_t y = 0; y < 4; ++y) {
+        for (uint32_t x = 0; x < 4; ++x) {
+            uint8_t* pPixel = reinterpret_cast<uint8_t*>(pMip->GetPixelAddress(x, y));
+            pPixel[0]       = static_cast<uint8_t>(x);
+            pPixel[1]       = static_cast<uint8_t>(y);
+            pPixel[2]       = 0;
+            pPixel[3]       = 255;
+        }
+    }
+
+    // Tile (1, 0) of size 2 with a 1 texel border covers x in [1, 4] and y in [-1, 2]
+    MipmapTileSource     source(&mipmap);
+    std::vector<uint8_t> texels(4 * 4 * 4);
+    ASSERT_EQ(source.ReadTile({0, 1, 0}, 2, 1, texels.data()), ppx::SUCCESS);
+
+    auto texel = [&](uint32_t col, uint32_t row) { return texels.data() + (row * 4 + col) * 4; };
+    EXPECT_EQ(texel(0, 0)[0], 1);
+    EXPECT_EQ(texel(0, 0)[1], 0);
+    EXPECT_EQ(texel(3, 0)[0], 3);
+    EXPECT_EQ(texel(1, 1)[0], 2);
+    EXPECT_EQ(texel(1, 1)[1], 0);
+    EXPECT_EQ(texel(3, 3)[0], 3);
+    EXPECT_EQ(texel(3, 3)[1], 2);
+
+    // Levels past the end of the mipmap cannot be read
+    EXPECT_NE(source.ReadTile({2, 0, 0}, 2, 1, texels.data()), ppx::SUCCESS);
+}
+
+} // namespace
+} // namespace ppx
@@ -0,0 +1,260 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares a rendered image against a golden image.
+//
+// Exit codes: 0 if every requested limit holds, 1 if one does not, 2 on
+// usage or I/O errors.
+
+#include "ppx/image_compare.h"
+#include "ppx/job_system.h"
+#include "ppx/string_util.h"
+#include "ppx/timer.h"
+
+#include <cstdio>
+#include <iostream>
+#include <optional>
+#include <string>
+
+namespace {
+
+const int kExitPass  = 0;
+const int kExitFail  = 1;
+const int kExitError = 2;
+
+const char* kUsage = R"(usage: ppx_image_compare [options] <reference> <test>
+
+options:
+  --threshold <n>               Per channel difference, in 8-bit steps, below which pixels match (default 0)
+  --mask <path>                 Tolerance mask: 255 excludes a pixel, other values raise its threshold
+  --compare-alpha               Include alpha in the comparison
+  --no-ssim                     Skip SSIM
+  --flip                        Compute the FLIP-like perceptual error
+  --heatmap <path>              Write a PNG heatmap of the errors
+  --heatmap-metric <metric>     diff, ssim or flip (default diff)
+  --max-different-pixels <n>    Fail if more pixels differ
+  --min-psnr <dB>               Fail if PSNR is lower
+  --min-ssim <value>            Fail if SSIM is lower
+  --max-flip <value>            Fail if the mean FLIP error is higher
+)";
+
+struct Options
+{
+    std::string              reference;
+    std::string              test;
+    std::string              mask;
+    std::string              heatmap;
+    ppx::ImageCompareOptions compare;
+    std::optional<uint64_t>  maxDifferentPixels;
+    std::optional<double>    minPSNR;
+    std::optional<double>    minSSIM;
+    std::optional<double>    maxFLIP;
+};
+
+template <typename T>
+bool ParseValue(int argc, char** argv, int& i, T& value)
+{
+    if (i + 1 >= argc) {
+        std::cerr << "missing value for " << argv[i] << std::endl;
+        return false;
+    }
+    ++i;
+    return ppx::string_util::Parse(argv[i], value) == ppx::SUCCESS;
+}
+
+template <typename T>
+bool ParseValue(int argc, char** argv, int& i, std::optional<T>& value)
+{
+    T parsed = {};
+    if (!ParseValue(argc, argv, i, parsed)) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+bool ParseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        bool              ok  = true;
+        if (arg == "--threshold") {
+            ok = ParseValue(argc, argv, i, options.compare.threshold);
+        }
+        else if (arg == "--mask") {
+            ok = ParseValue(argc, argv, i, options.mask);
+        }
+        else if (arg == "--compare-alpha") {
+            options.compare.compareAlpha = true;
+        }
+        else if (arg == "--no-ssim") {
+            options.compare.computeSSIM = false;
+        }
+        else if (arg == "--flip") {
+            options.compare.computeFLIP = true;
+        }
+        else if (arg == "--heatmap") {
+            ok = ParseValue(argc, argv, i, options.heatmap);
+        }
+        else if (arg == "--heatmap-metric") {
+            std::string metric;
+            ok = ParseValue(argc, argv, i, metric);
+            if (metric == "diff") {
+                options.compare.heatmapMetric = ppx::IMAGE_COMPARE_METRIC_DIFFERENCE;
+            }
+            else if (metric == "ssim") {
+                options.compare.heatmapMetric = ppx::IMAGE_COMPARE_METRIC_SSIM;
+                options.compare.computeSSIM   = true;
+            }
+            else if (metric == "flip") {
+                options.compare.heatmapMetric = ppx::IMAGE_COMPARE_METRIC_FLIP;
+                options.compare.computeFLIP   = true;
+            }
+            else {
+                std::cerr << "unknown heatmap metric: " << metric << std::endl;
+                ok = false;
+            }
+        }
+        else if (arg == "--max-different-pixels") {
+            ok = ParseValue(argc, argv, i, options.maxDifferentPixels);
+        }
+        else if (arg == "--min-psnr") {
+            ok = ParseValue(argc, argv, i, options.minPSNR);
+        }
+        else if (arg == "--min-ssim") {
+            ok = ParseValue(argc, argv, i, options.minSSIM);
+            options.compare.computeSSIM = true;
+        }
+        else if (arg == "--max-flip") {
+            ok = ParseValue(argc, argv, i, options.maxFLIP);
+            options.compare.computeFLIP = true;
+        }
+        else if ((arg.size() > 2) && (arg.compare(0, 2, "--") == 0)) {
+            std::cerr << "unknown option: " << arg << std::endl;
+            ok = false;
+        }
+        else if (options.reference.empty()) {
+            options.reference = arg;
+        }
+        else if (options.test.empty()) {
+            options.test = arg;
+        }
+        else {
+            std::cerr << "unexpected argument: " << arg << std::endl;
+            ok = false;
+        }
+
+        if (!ok) {
+            return false;
+        }
+    }
+
+    if (options.reference.empty() || options.test.empty()) {
+        std::cerr << "expected a reference and a test image" << std::endl;
+        return false;
+    }
+    options.compare.generateHeatmap = !options.heatmap.empty();
+    return true;
+}
+
+bool Check(const char* name, bool passed)
+{
+    if (!passed) {
+        std::cout << "FAIL: " << name << std::endl;
+    }
+    return passed;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::cerr << kUsage;
+        return kExitError;
+    }
+
+    ppx::Bitmap reference;
+    ppx::Bitmap test;
+    ppx::Bitmap mask;
+    if (ppx::Bitmap::LoadFile(options.reference, &reference) != ppx::SUCCESS) {
+        std::cerr << "failed to load " << options.reference << std::endl;
+        return kExitError;
+    }
+    if (ppx::Bitmap::LoadFile(options.test, &test) != ppx::SUCCESS) {
+        std::cerr << "failed to load " << options.test << std::endl;
+        return kExitError;
+    }
+    if (!options.mask.empty()) {
+        if (ppx::Bitmap::LoadFile(options.mask, &mask) != ppx::SUCCESS) {
+            std::cerr << "failed to load " << options.mask << std::endl;
+            return kExitError;
+        }
+        options.compare.pMask = &mask;
+    }
+
+    ppx::JobSystem jobSystem;
+    jobSystem.Initialize(ppx::JobSystem::GetDefaultWorkerCount());
+
+    ppx::Timer::InitializeStaticData();
+    ppx::Timer timer;
+    timer.Start();
+    ppx::ImageCompareResult result;
+    ppx::Result             ppxres = ppx::CompareImages(reference, test, options.compare, &result, &jobSystem);
+    if (ppxres != ppx::SUCCESS) {
+        std::cerr << "comparison failed: " << ppx::ToString(ppxres) << std::endl;
+        return kExitError;
+    }
+    const double elapsedMs = timer.MillisSinceStart();
+
+    std::printf("size:             %ux%u\n", reference.GetWidth(), reference.GetHeight());
+    std::printf("compared pixels:  %llu\n", static_cast<unsigned long long>(result.pixelCount));
+    std::printf("different pixels: %llu\n", static_cast<unsigned long long>(result.differentPixelCount));
+    std::printf("max difference:   %.6f\n", result.maxDifference);
+    std::printf("MAE:              %.6f\n", result.meanAbsoluteError);
+    std::printf("MSE:              %.8f\n", result.meanSquaredError);
+    std::printf("PSNR:             %.3f dB\n", result.psnr);
+    if (options.compare.computeSSIM) {
+        std::printf("SSIM:             %.6f\n", result.ssim);
+    }
+    if (options.compare.computeFLIP) {
+        std::printf("FLIP mean:        %.6f\n", result.meanFLIP);
+        std::printf("FLIP max:         %.6f\n", result.maxFLIP);
+    }
+    std::printf("time:             %.2f ms\n", elapsedMs);
+
+    if (!options.heatmap.empty()) {
+        if (ppx::Bitmap::SaveFilePNG(options.heatmap, &result.heatmap) != ppx::SUCCESS) {
+            std::cerr << "failed to write " << options.heatmap << std::endl;
+            return kExitError;
+        }
+    }
+
+    bool passed = true;
+    if (options.maxDifferentPixels) {
+        passed = Check("different pixels", result.differentPixelCount <= *options.maxDifferentPixels) && passed;
+    }
+    if (options.minPSNR) {
+        passed = Check("PSNR", result.psnr >= *options.minPSNR) && passed;
+    }
+    if (options.minSSIM) {
+        passed = Check("SSIM", result.ssim >= *options.minSSIM) && passed;
+    }
+    if (options.maxFLIP) {
+        passed = Check("FLIP", result.meanFLIP <= *options.maxFLIP) && passed;
+    }
+    std::cout << (passed ? "PASS" : "FAIL") << std::endl;
+    return passed ? kExitPass : kExitFail;
+}